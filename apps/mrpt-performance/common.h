@@ -33,6 +33,10 @@ void register_tests_graphslam();
 void register_tests_CObservation3DRangeScan();
 void register_tests_atan2lut();
 void register_tests_strings();
+void register_tests_pf();
+void register_tests_rrt();
+void register_tests_kf();
+void register_tests_serialization();
 // -------------------------------------------------
 
 using TestFunctor =
@@ -8,7 +8,10 @@
    +------------------------------------------------------------------------+ */
 
 #include <mrpt/obs/CObservation3DRangeScan.h>
+#include <mrpt/maps/CSimplePointsMap.h>
+#include <mrpt/maps/CColouredPointsMap.h>
 #include <mrpt/utils/CFileGZInputStream.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
 #include <mrpt/random.h>
 #include <mrpt/utils/CTimeLogger.h>
 #include <mrpt/system/filesystem.h>
@@ -84,6 +87,48 @@ double obs3d_test_depth_to_3d(int a, int b)
 	return t;
 }
 
+// Projection straight into a point map, as done when building maps from
+// RGBD observations.
+// a: 0=CSimplePointsMap, 1=CColouredPointsMap, 2=CSimplePointsMap in world
+//    coordinates (sensor+robot pose), 3=like 2, with a region of interest
+// b: decimation, +0x100 to split rows among 4 threads
+template <class MAP>
+double obs3d_test_depth_to_map(int a, int b)
+{
+	CObservation3DRangeScan obs;
+	CFileGZInputStream(rgbd_test_rawlog_file) >> obs;
+
+	T3DPointsProjectionParams pp;
+	pp.decimation = b & 0xff;
+	if (a >= 2)
+	{
+		static const CPose3D robotPose(1.0, 2.0, 0.0, 0.3, 0.0, 0.0);
+		pp.takeIntoAccountSensorPoseOnRobot = true;
+		pp.robotPoseInTheWorld = &robotPose;
+	}
+	if (a == 3)
+	{
+		// Central half of the image:
+		pp.roi_col_min = obs.rangeImage.cols() / 4;
+		pp.roi_col_max = obs.rangeImage.cols() * 3 / 4;
+		pp.roi_row_min = obs.rangeImage.rows() / 4;
+		pp.roi_row_max = obs.rangeImage.rows() * 3 / 4;
+	}
+	CWorkerThreadsPool pool(4);
+	if (b & 0x100) pp.threadPool = &pool;
+
+	MAP map;
+	obs.project3DPointsFromDepthImageInto(map, pp);  // Build the LUT
+
+	CTicTac tictac;
+	const int N = 100;
+	for (int i = 0; i < N; i++)
+		obs.project3DPointsFromDepthImageInto(map, pp);
+	const double t = tictac.Tac() / N;
+	dummy_do_nothing_with_string(mrpt::format("%u", (unsigned)map.size()));
+	return t;
+}
+
 double obs3d_test_depth_to_2d_scan(int useMinFilter, int useMaxFilter)
 {
 	CObservation3DRangeScan obs1;
@@ -214,5 +259,41 @@ void register_tests_CObservation3DRangeScan()
 			TestData(
 				"3DRangeScan: 320x240 Depth->2D scan + min/max_filters",
 				obs3d_test_depth_to_2d_scan, 1, 1));
+		lstTests.push_back(
+			TestData(
+				"3DRangeScan: 320x240 Depth->CSimplePointsMap",
+				obs3d_test_depth_to_map<CSimplePointsMap>, 0, 1));
+		lstTests.push_back(
+			TestData(
+				"3DRangeScan: 320x240 Depth->CColouredPointsMap",
+				obs3d_test_depth_to_map<CColouredPointsMap>, 1, 1));
+		lstTests.push_back(
+			TestData(
+				"3DRangeScan: 320x240 Depth->CSimplePointsMap (world coords)",
+				obs3d_test_depth_to_map<CSimplePointsMap>, 2, 1));
+		lstTests.push_back(
+			TestData(
+				"3DRangeScan: 320x240 Depth->CSimplePointsMap (world coords,"
+				"decimation=2)",
+				obs3d_test_depth_to_map<CSimplePointsMap>, 2, 2));
+		lstTests.push_back(
+			TestData(
+				"3DRangeScan: 320x240 Depth->CSimplePointsMap (world coords,"
+				"decimation=4)",
+				obs3d_test_depth_to_map<CSimplePointsMap>, 2, 4));
+		lstTests.push_back(
+			TestData(
+				"3DRangeScan: 320x240 Depth->CSimplePointsMap (world coords,"
+				"ROI)",
+				obs3d_test_depth_to_map<CSimplePointsMap>, 3, 1));
+		lstTests.push_back(
+			TestData(
+				"3DRangeScan: 320x240 Depth->CSimplePointsMap (world coords,"
+				"4 threads)",
+				obs3d_test_depth_to_map<CSimplePointsMap>, 2, 0x101));
+		lstTests.push_back(
+			TestData(
+				"3DRangeScan: 320x240 Depth->CColouredPointsMap (4 threads)",
+				obs3d_test_depth_to_map<CColouredPointsMap>, 1, 0x101));
 	}
 }
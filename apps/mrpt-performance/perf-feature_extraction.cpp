@@ -9,6 +9,7 @@
 
 #include <mrpt/utils/CImage.h>
 #include <mrpt/vision/CFeatureExtraction.h>
+#include <mrpt/vision/tracking.h>
 
 #include "common.h"
 
@@ -269,11 +270,70 @@ double feature_extraction_test_FASTER(int N, int threshold)
 	return T;
 }
 
+// ------------------------------------------------------
+//				Benchmark: feature tracking
+//	2000 FAST features tracked between two 640x480 images displaced by
+//	(3,2) pixels.
+//	num_threads: passed to the tracker as "num_threads"
+//	video: if !=0, the tracked pair is swapped at each iteration, so the
+//	       new image of one call is the old image of the next one.
+// ------------------------------------------------------
+template <class TRACKER>
+double feature_tracking_test(int num_threads, int video)
+{
+	CImage img, img1, img2;
+	getTestImage(0, img);
+	img.grayscaleInPlace();
+	img.scaleImage(648, 488);
+	img.extract_patch(img1, 0, 0, 640, 480);
+	img.extract_patch(img2, 3, 2, 640, 480);
+
+	TSimpleFeatureList corners, feats;
+	CFeatureExtraction::detectFeatures_SSE2_FASTER9(img1, corners, 20);
+	for (size_t i = 0; i < corners.size() && feats.size() < 2000;
+		 i += std::max<size_t>(1, corners.size() / 2000))
+		feats.push_back(corners[i]);
+
+	TRACKER tracker;
+	tracker.extra_params["num_threads"] = num_threads;
+
+	const int N = 20;
+	CTicTac tictac;
+	for (int i = 0; i < N; i++)
+	{
+		TSimpleFeatureList f = feats;
+		if (video && (i & 1))
+			tracker.trackFeatures(img2, img1, f);
+		else
+			tracker.trackFeatures(img1, img2, f);
+	}
+	return tictac.Tac() / N;
+}
+
 // ------------------------------------------------------
 // register_tests_feature_extraction
 // ------------------------------------------------------
 void register_tests_feature_extraction()
 {
+	lstTests.push_back(
+		TestData(
+			"feature_tracking [640x480]: CFeatureTracker_KL (2000 feats)",
+			feature_tracking_test<CFeatureTracker_KL>, 1, 0));
+	lstTests.push_back(
+		TestData(
+			"feature_tracking [640x480]: CFeatureTracker_PyrLK (2000 feats)",
+			feature_tracking_test<CFeatureTracker_PyrLK>, 1, 0));
+	lstTests.push_back(
+		TestData(
+			"feature_tracking [640x480]: CFeatureTracker_PyrLK (2000 feats, "
+			"video)",
+			feature_tracking_test<CFeatureTracker_PyrLK>, 1, 1));
+	lstTests.push_back(
+		TestData(
+			"feature_tracking [640x480]: CFeatureTracker_PyrLK (2000 feats, "
+			"video, 4 threads)",
+			feature_tracking_test<CFeatureTracker_PyrLK>, 4, 1));
+
 	lstTests.push_back(
 		TestData(
 			"feature_extraction [640x480]: Harris",
@@ -9,6 +9,7 @@
 
 #include <mrpt/utils/CImage.h>
 #include <mrpt/vision/CFeatureExtraction.h>
+#include <mrpt/random.h>
 
 #include "common.h"
 
@@ -259,6 +260,47 @@ double feature_matching_test_FAST_SAD(int w, int h)
 	return T;
 }
 
+// ------------------------------------------------------
+//		Benchmark: brute-force ORB descriptor matching
+// ------------------------------------------------------
+// a1: number of features in each list, a2: number of threads
+double feature_matching_test_ORB_descriptors(int a1, int a2)
+{
+	auto& rnd = mrpt::random::getRandomGenerator();
+	rnd.randomize(123);
+
+	// Random 32-byte descriptors: the right list has the same ones than the
+	// left one, with a few flipped bits.
+	CFeatureList featsL, featsR;
+	for (int i = 0; i < a1; i++)
+	{
+		CFeature::Ptr fL = mrpt::make_aligned_shared<CFeature>();
+		fL->x = rnd.drawUniform(0, 640);
+		fL->y = rnd.drawUniform(0, 480);
+		fL->descriptors.ORB.resize(32);
+		for (auto& b : fL->descriptors.ORB)
+			b = static_cast<uint8_t>(rnd.drawUniform32bit());
+		CFeature::Ptr fR = mrpt::make_aligned_shared<CFeature>(*fL);
+		for (int k = 0; k < 8; k++)
+			fR->descriptors.ORB[rnd.drawUniform32bit() % 32] ^=
+				uint8_t(1 << (rnd.drawUniform32bit() % 8));
+		featsL.push_back(fL);
+		featsR.push_back(fR);
+	}
+
+	TMatchingOptions opt;
+	opt.matching_method = TMatchingOptions::mmDescriptorORB;
+	opt.useEpipolarRestriction = false;
+	opt.useXRestriction = false;
+	opt.numThreads = a2;
+	CMatchedFeatureList matches;
+
+	const size_t N = 10;
+	CTicTac tictac;
+	for (size_t i = 0; i < N; i++) matchFeatures(featsL, featsR, matches, opt);
+	return tictac.Tac() / N;
+}
+
 // ------------------------------------------------------
 // register_tests_feature_extraction
 // ------------------------------------------------------
@@ -287,4 +329,12 @@ void register_tests_feature_matching()
 		TestData(
 			"feature_matching [640x480]: FAST + SAD",
 			feature_matching_test_FAST_SAD, 640, 480));
+	lstTests.push_back(
+		TestData(
+			"feature_matching: ORB descriptors, 1000 feats",
+			feature_matching_test_ORB_descriptors, 1000, 1));
+	lstTests.push_back(
+		TestData(
+			"feature_matching: ORB descriptors, 1000 feats, 4 threads",
+			feature_matching_test_ORB_descriptors, 1000, 4));
 }
@@ -58,6 +58,38 @@ double graphslam_levmarq_solve(int nVertices, int N)
 	return ret;
 }
 
+// Like graphslam_levmarq_solve(), but using all CPU cores and reusing the
+// Hessian structure and its symbolic factorization between calls:
+template <class GRAPH_TYPE>
+double graphslam_levmarq_solve_cached(int nVertices, int N)
+{
+	GRAPH_TYPE graph;
+	GraphSlamLevMarqTest<GRAPH_TYPE>::create_ring_path(graph, nVertices);
+
+	TParametersDouble params;
+	params["max_iterations"] = 1000;
+	params["num_threads"] = 0;
+
+	graphslam::TLevMarqSolverCache cache;
+	CTimeLogger timer;
+
+	for (long i = 0; i < N; i++)
+	{
+		GRAPH_TYPE graph0 = graph;
+
+		graphslam::TResultInfoSpaLevMarq levmarq_info;
+
+		timer.enter("test");
+
+		graphslam::optimize_graph_spa_levmarq(
+			graph0, levmarq_info, nullptr, params, {}, &cache);
+		timer.leave("test");
+	}
+	const double ret = timer.getMeanTime("test");
+	timer.clear(true);  // this disables dump to cout upon destruction
+	return ret;
+}
+
 // ------------------------------------------------------
 // register_tests_graphslam
 // ------------------------------------------------------
@@ -80,4 +112,12 @@ void register_tests_graphslam()
 		TestData(
 			"graphslam(3d): levmarq 100 KFs/451 edges",
 			graphslam_levmarq_solve<CNetworkOfPoses3D>, 100, 2));
+	lstTests.push_back(
+		TestData(
+			"graphslam(3d): levmarq 300 KFs/4501 edges",
+			graphslam_levmarq_solve<CNetworkOfPoses3D>, 300, 5));
+	lstTests.push_back(
+		TestData(
+			"graphslam(3d): levmarq 300 KFs/4501 edges, cached solver",
+			graphslam_levmarq_solve_cached<CNetworkOfPoses3D>, 300, 5));
 }
@@ -151,8 +151,12 @@ double grid_test_8(int a1, int a2)
 		SCAN_VALID_1);
 
 	COccupancyGridMap2D gridmap(-20, 20, -20, 20, 0.05f);
+	gridmap.likelihoodOptions.likelihoodMethod =
+		static_cast<COccupancyGridMap2D::TLikelihoodMethod>(a1);
 
 	// test 8: Likelihood computation
+	// a2!=0: the map is updated with a new scan every a2 evaluations, as
+	// in a RBPF, to account for the cost of refreshing cached data.
 	const long N = 5000;
 
 	CPose3D pose3D(0, 0, 0);
@@ -162,6 +166,14 @@ double grid_test_8(int a1, int a2)
 	CTicTac tictac;
 	for (long i = 0; i < N; i++)
 	{
+		if (a2 && (i % a2) == 0)
+		{
+			const CPose3D pose_ins(
+				getRandomGenerator().drawUniform(-0.1, 0.1),
+				getRandomGenerator().drawUniform(-0.1, 0.1), 0);
+			gridmap.insertObservation(&scan1, &pose_ins);
+		}
+
 		CPose2D pose(
 			getRandomGenerator().drawUniform(-1.0, 1.0),
 			getRandomGenerator().drawUniform(-1.0, 1.0),
@@ -213,6 +225,39 @@ double grid_test_9(int a1, int a2)
 	return tictac.Tac() / a1;
 }
 
+double grid_test_10(int a1, int a2)
+{
+	// test 10: laserScanSimulator, in a room of 40x40m with the room scan
+	// inserted at its center.
+	// a1!=0: skip free space with the distance field.
+	CObservation2DRangeScan scan1;
+	scan1.aperture = M_PIf;
+	scan1.rightToLeft = true;
+	scan1.loadFromVectors(
+		sizeof(SCAN_RANGES_1) / sizeof(SCAN_RANGES_1[0]), SCAN_RANGES_1,
+		SCAN_VALID_1);
+
+	COccupancyGridMap2D gridmap(-20, 20, -20, 20, 0.05f);
+	CPose3D pose3D(0, 0, 0);
+	gridmap.insertObservation(&scan1, &pose3D);
+
+	COccupancyGridMap2D::RAYTRACE_USE_DISTANCE_FIELD = (a1 != 0);
+
+	const long N = 200;
+	CObservation2DRangeScan scan;
+	scan.aperture = M_2PIf;
+	scan.maxRange = 30.0f;
+	CTicTac tictac;
+	for (long i = 0; i < N; i++)
+	{
+		const CPose2D pose(0.01 * (i % 10), 0, 0.01 * i);
+		gridmap.laserScanSimulator(scan, pose, 0.6f, 1081);
+	}
+	const double T = tictac.Tac() / N;
+	COccupancyGridMap2D::RAYTRACE_USE_DISTANCE_FIELD = true;
+	return T;
+}
+
 // ------------------------------------------------------
 // register_tests_grids
 // ------------------------------------------------------
@@ -228,7 +273,32 @@ void register_tests_grids()
 	lstTests.push_back(
 		TestData("gridmap2D: insert scan with widening", grid_test_5_6, 1));
 	lstTests.push_back(TestData("gridmap2D: resize", grid_test_7));
-	lstTests.push_back(TestData("gridmap2D: computeLikelihood", grid_test_8));
+	lstTests.push_back(
+		TestData(
+			"gridmap2D: computeLikelihood (LF Thrun)", grid_test_8,
+			COccupancyGridMap2D::lmLikelihoodField_Thrun));
+	lstTests.push_back(
+		TestData(
+			"gridmap2D: computeLikelihood (LF dist. transform)", grid_test_8,
+			COccupancyGridMap2D::lmLikelihoodField_DistanceTransform));
+	lstTests.push_back(
+		TestData(
+			"gridmap2D: computeLikelihood (LF Thrun, map updated/100 evals)",
+			grid_test_8, COccupancyGridMap2D::lmLikelihoodField_Thrun, 100));
+	lstTests.push_back(
+		TestData(
+			"gridmap2D: computeLikelihood (LF dist. transform, map "
+			"updated/100 evals)",
+			grid_test_8, COccupancyGridMap2D::lmLikelihoodField_DistanceTransform,
+			100));
 	lstTests.push_back(
 		TestData("gridmap2D: determineMatching2D", grid_test_9, 5000));
+	lstTests.push_back(
+		TestData(
+			"gridmap2D: laserScanSimulator (1081 rays, step by step)",
+			grid_test_10, 0));
+	lstTests.push_back(
+		TestData(
+			"gridmap2D: laserScanSimulator (1081 rays, distance field)",
+			grid_test_10, 1));
 }
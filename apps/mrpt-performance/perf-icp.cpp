@@ -13,6 +13,7 @@
 #include <mrpt/slam/CMetricMapBuilderICP.h>
 #include <mrpt/maps/CMultiMetricMap.h>
 #include <mrpt/obs/CRawlog.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
 
 #include "common.h"
 
@@ -22,6 +23,7 @@ using namespace mrpt::slam;
 using namespace mrpt::maps;
 using namespace mrpt::obs;
 using namespace mrpt::random;
+using namespace mrpt::poses;
 using namespace std;
 
 // ------------------------------------------------------
@@ -124,6 +126,50 @@ double icp_test_1(int a1, int a2)
 #endif
 }
 
+// ------------------------------------------------------
+//	Benchmark: ICP correspondence search between two
+//  random point clouds of 100k points
+// ------------------------------------------------------
+// a1: 0=2D, 1=3D matching, a2: number of threads
+double icp_test_matching(int a1, int a2)
+{
+	CRandomGenerator rng(1234);
+	CSimplePointsMap m1, m2;
+	for (int i = 0; i < 100000; i++)
+	{
+		m1.insertPoint(
+			rng.drawUniform(-20, 20), rng.drawUniform(-20, 20),
+			rng.drawUniform(-2, 2));
+		m2.insertPoint(
+			rng.drawUniform(-20, 20), rng.drawUniform(-20, 20),
+			rng.drawUniform(-2, 2));
+	}
+
+	CWorkerThreadsPool pool(a2);
+	TMatchingParams params;
+	params.maxDistForCorrespondence = 0.3f;
+	params.threadPool = a2 > 1 ? &pool : nullptr;
+
+	const CPose3D pose(0.1, -0.2, 0.0, 0.05, 0, 0);
+	TMatchingPairList corrs;
+	TMatchingExtraResults extra;
+	// Build the KD-trees first:
+	float dist_sq;
+	m1.kdTreeClosestPoint3D(0, 0, 0, dist_sq);
+	m1.kdTreeClosestPoint2D(0, 0, dist_sq);
+
+	const long N = 10;
+	CTicTac tictac;
+	for (long i = 0; i < N; i++)
+	{
+		if (a1)
+			m1.determineMatching3D(&m2, pose, corrs, params, extra);
+		else
+			m1.determineMatching2D(&m2, CPose2D(pose), corrs, params, extra);
+	}
+	return tictac.Tac() / N;
+}
+
 // ------------------------------------------------------
 // register_tests_icpslam
 // ------------------------------------------------------
@@ -135,4 +181,20 @@ void register_tests_icpslam()
 	lstTests.push_back(
 		TestData(
 			"icp-slam (match grid): Run with sample dataset", icp_test_1, 1));
+	lstTests.push_back(
+		TestData(
+			"icp: determineMatching2D 100k points, 1 thread",
+			icp_test_matching, 0, 1));
+	lstTests.push_back(
+		TestData(
+			"icp: determineMatching2D 100k points, 4 threads",
+			icp_test_matching, 0, 4));
+	lstTests.push_back(
+		TestData(
+			"icp: determineMatching3D 100k points, 1 thread",
+			icp_test_matching, 1, 1));
+	lstTests.push_back(
+		TestData(
+			"icp: determineMatching3D 100k points, 4 threads",
+			icp_test_matching, 1, 4));
 }
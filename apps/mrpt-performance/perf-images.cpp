@@ -10,6 +10,7 @@
 #include <mrpt/utils/CImage.h>
 #include <mrpt/utils/TStereoCamera.h>
 #include <mrpt/utils/CConfigFileMemory.h>
+#include <mrpt/utils/CMemoryStream.h>
 #include <mrpt/system/filesystem.h>
 #include <mrpt/vision/CImagePyramid.h>
 #include <mrpt/vision/CStereoRectifyMap.h>
@@ -361,11 +362,78 @@ double stereoimage_rectify(int, int)
 	return tictac.Tac() / N;
 }
 
+// ------------------------------------------------------
+//	Benchmark: image de-serialization, eager or lazy decoding
+//	a1: 0=640x480 grayscale (ZIP), 1=640x480 RGB (JPEG)
+//	a2: bit 0: lazy decoding, bit 1: serialize again after reading
+// ------------------------------------------------------
+double image_serialization(int a1, int a2)
+{
+	CImage img(640, 480, a1 ? CH_RGB : CH_GRAY);
+	getRandomGenerator().randomize(123);
+	img.filledRectangle(0, 0, 639, 479, TColor(0, 0, 0));
+	for (int i = 0; i < 5000; i++)
+		img.line(
+			getRandomGenerator().drawUniform(0, 639),
+			getRandomGenerator().drawUniform(0, 479),
+			getRandomGenerator().drawUniform(0, 639),
+			getRandomGenerator().drawUniform(0, 479),
+			TColor(getRandomGenerator().drawUniform32bit()));
+
+	CMemoryStream buf, out;
+	buf << img;
+
+	const bool old_flag = CImage::DISABLE_LAZY_DECODING;
+	CImage::DISABLE_LAZY_DECODING = (a2 & 1) == 0;
+
+	const size_t N = 50;
+	CTicTac tictac;
+	for (size_t i = 0; i < N; i++)
+	{
+		CImage img2;
+		buf.Seek(0);
+		buf >> img2;
+		if (a2 & 2)
+		{
+			out.Clear();
+			out << img2;
+		}
+	}
+	const double T = tictac.Tac() / N;
+	CImage::DISABLE_LAZY_DECODING = old_flag;
+	return T;
+}
+
 // ------------------------------------------------------
 // register_tests_image
 // ------------------------------------------------------
 void register_tests_image()
 {
+	lstTests.push_back(
+		TestData(
+			"images: Deserialize gray 640x480 (eager)", image_serialization, 0,
+			0));
+	lstTests.push_back(
+		TestData(
+			"images: Deserialize gray 640x480 (lazy)", image_serialization, 0,
+			1));
+	lstTests.push_back(
+		TestData(
+			"images: Deserialize RGB 640x480 (eager)", image_serialization, 1,
+			0));
+	lstTests.push_back(
+		TestData(
+			"images: Deserialize RGB 640x480 (lazy)", image_serialization, 1,
+			1));
+	lstTests.push_back(
+		TestData(
+			"images: Deserialize+serialize RGB 640x480 (eager)",
+			image_serialization, 1, 2));
+	lstTests.push_back(
+		TestData(
+			"images: Deserialize+serialize RGB 640x480 (lazy)",
+			image_serialization, 1, 3));
+
 	lstTests.push_back(
 		TestData(
 			"images: Save as JPEG (640x480, quality=95%)", image_test_1, 640,
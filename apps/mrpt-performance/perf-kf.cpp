@@ -0,0 +1,116 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/slam/CRangeBearingKFSLAM2D.h>
+#include <mrpt/obs/CActionCollection.h>
+#include <mrpt/obs/CActionRobotMovement2D.h>
+#include <mrpt/obs/CObservationBearingRange.h>
+#include <mrpt/obs/CSensoryFrame.h>
+
+#include "common.h"
+
+using namespace mrpt;
+using namespace mrpt::bayes;
+using namespace mrpt::slam;
+using namespace mrpt::obs;
+using namespace mrpt::poses;
+using namespace mrpt::math;
+using namespace mrpt::utils;
+using namespace std;
+
+// A robot driving along a straight road with two rows of landmarks, one every
+// meter, observed (with known IDs) up to 5m away.
+static void kf_simul_step(
+	CRangeBearingKFSLAM2D& slam, const CPose2D& pose, const CPose2D& incr)
+{
+	CActionRobotMovement2D act;
+	CActionRobotMovement2D::TMotionModelOptions opts;
+	act.computeFromOdometry(incr, opts);
+	CActionCollection::Ptr acts =
+		mrpt::make_aligned_shared<CActionCollection>();
+	acts->insert(act);
+
+	CObservationBearingRange::Ptr obs =
+		mrpt::make_aligned_shared<CObservationBearingRange>();
+	obs->maxSensorDistance = 5;
+	obs->fieldOfView_yaw = 2 * M_PI;
+	for (int i = int(pose.x()) - 5; i <= int(pose.x()) + 5; i++)
+	{
+		for (int side = 0; side < 2; side++)
+		{
+			TPoint2D p;
+			pose.inverseComposePoint(TPoint2D(i, side ? 2 : -2), p);
+			if (i < 0 || p.norm() > obs->maxSensorDistance) continue;
+			CObservationBearingRange::TMeasurement m;
+			m.range = p.norm();
+			m.yaw = atan2(p.y, p.x);
+			m.pitch = 0;
+			m.landmarkID = 2 * i + side;
+			obs->sensedData.push_back(m);
+		}
+	}
+	CSensoryFrame::Ptr SF = mrpt::make_aligned_shared<CSensoryFrame>();
+	SF->insert(obs);
+
+	slam.processActionObservation(acts, SF);
+}
+
+// a1: TKFMethod, a2: number of landmarks in the map
+double kf_test_slam2d(int a1, int a2)
+{
+	const CPose2D incr(0.5, 0, 0);
+	CPose2D pose;
+	CRangeBearingKFSLAM2D slam;
+
+	// Build the map with the fastest method:
+	slam.KF_options.method = kfEKFCompressed;
+	while (slam.getNumberOfLandmarksInTheMap() + 12 < size_t(a2))
+	{
+		pose = pose + incr;
+		kf_simul_step(slam, pose, incr);
+	}
+
+	slam.KF_options.method = TKFMethod(a1);
+	slam.makeSureStateIsUpToDate();
+	const int N = 20;
+	CTicTac tictac;
+	for (int i = 0; i < N; i++)
+	{
+		pose = pose + incr;
+		kf_simul_step(slam, pose, incr);
+	}
+	return tictac.Tac() / N;
+}
+
+// ------------------------------------------------------
+// register_tests_kf
+// ------------------------------------------------------
+void register_tests_kf()
+{
+	lstTests.push_back(
+		TestData(
+			"KF-SLAM 2D: 300 LMs, kfEKFNaive (time/step)", kf_test_slam2d,
+			kfEKFNaive, 300));
+	lstTests.push_back(
+		TestData(
+			"KF-SLAM 2D: 300 LMs, kfEKFAlaDavison (time/step)",
+			kf_test_slam2d, kfEKFAlaDavison, 300));
+	lstTests.push_back(
+		TestData(
+			"KF-SLAM 2D: 300 LMs, kfEKFCompressed (time/step)",
+			kf_test_slam2d, kfEKFCompressed, 300));
+	lstTests.push_back(
+		TestData(
+			"KF-SLAM 2D: 1000 LMs, kfEKFAlaDavison (time/step)",
+			kf_test_slam2d, kfEKFAlaDavison, 1000));
+	lstTests.push_back(
+		TestData(
+			"KF-SLAM 2D: 1000 LMs, kfEKFCompressed (time/step)",
+			kf_test_slam2d, kfEKFCompressed, 1000));
+}
@@ -0,0 +1,129 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/slam/CMonteCarloLocalization2D.h>
+#include <mrpt/maps/CMultiMetricMap.h>
+#include <mrpt/maps/COccupancyGridMap2D.h>
+#include <mrpt/obs/CActionCollection.h>
+#include <mrpt/obs/CActionRobotMovement2D.h>
+#include <mrpt/obs/CObservation2DRangeScan.h>
+#include <mrpt/obs/CSensoryFrame.h>
+#include <mrpt/random.h>
+
+#include "common.h"
+
+using namespace mrpt;
+using namespace mrpt::bayes;
+using namespace mrpt::slam;
+using namespace mrpt::maps;
+using namespace mrpt::obs;
+using namespace mrpt::poses;
+using namespace mrpt::random;
+using namespace mrpt::utils;
+using namespace std;
+
+// ------------------------------------------------------
+//				Benchmark Particle filters
+// ------------------------------------------------------
+// a1: number of threads, a2: number of particles
+double pf_test_mcl2d(int a1, int a2)
+{
+	// A 20x20m room with some obstacles:
+	COccupancyGridMap2D grid(-11, 11, -11, 11, 0.05f);
+	for (float t = -10; t <= 10; t += 0.025f)
+	{
+		grid.setPos(t, -10, 0.01f);
+		grid.setPos(t, 10, 0.01f);
+		grid.setPos(-10, t, 0.01f);
+		grid.setPos(10, t, 0.01f);
+	}
+	for (float t = 0; t <= 4; t += 0.025f)
+	{
+		grid.setPos(2 + t, 3, 0.01f);
+		grid.setPos(-5, -6 + t, 0.01f);
+	}
+
+	CMultiMetricMap metricMap;
+	metricMap.maps.push_back(
+		CMetricMap::Ptr(COccupancyGridMap2D::Create(grid)));
+
+	getRandomGenerator().randomize(1234);
+
+	CMonteCarloLocalization2D pdf(a2);
+	pdf.options.metricMap = &metricMap;
+	pdf.resetUniform(-2, 2, -2, 2);
+
+	CParticleFilter PF;
+	PF.m_options.PF_algorithm = CParticleFilter::pfStandardProposal;
+	PF.m_options.adaptiveSampleSize = false;
+	PF.m_options.numThreads = a1;
+
+	const CPose2D odoIncr(0.1, 0, DEG2RAD(2.0));
+	CActionRobotMovement2D act;
+	act.computeFromOdometry(
+		odoIncr, CActionRobotMovement2D::TMotionModelOptions());
+	CActionCollection acts;
+	acts.insert(act);
+
+	CPose2D gtPose(0, 0, 0);
+	const size_t N = 10;
+	double T = 0;
+	for (size_t i = 0; i < N; i++)
+	{
+		gtPose = gtPose + odoIncr;
+
+		CObservation2DRangeScan::Ptr scan =
+			mrpt::make_aligned_shared<CObservation2DRangeScan>();
+		scan->maxRange = 30;
+		scan->aperture = M_PIf;
+		grid.laserScanSimulator(*scan, gtPose, 0.5f, 361);
+		CSensoryFrame sf;
+		sf.insert(scan);
+
+		CTicTac tictac;
+		PF.executeOn(pdf, &acts, &sf);
+		T += tictac.Tac();
+	}
+	return T / N;
+}
+
+// ------------------------------------------------------
+// register_tests_pf
+// ------------------------------------------------------
+void register_tests_pf()
+{
+	lstTests.push_back(
+		TestData(
+			"pf: MCL2D step, 10000 particles, 1 thread", pf_test_mcl2d, 1,
+			10000));
+	lstTests.push_back(
+		TestData(
+			"pf: MCL2D step, 10000 particles, 2 threads", pf_test_mcl2d, 2,
+			10000));
+	lstTests.push_back(
+		TestData(
+			"pf: MCL2D step, 10000 particles, 4 threads", pf_test_mcl2d, 4,
+			10000));
+	lstTests.push_back(
+		TestData(
+			"pf: MCL2D step, 10000 particles, 8 threads", pf_test_mcl2d, 8,
+			10000));
+	lstTests.push_back(
+		TestData(
+			"pf: MCL2D step, 100000 particles, 1 thread", pf_test_mcl2d, 1,
+			100000));
+	lstTests.push_back(
+		TestData(
+			"pf: MCL2D step, 100000 particles, 4 threads", pf_test_mcl2d, 4,
+			100000));
+	lstTests.push_back(
+		TestData(
+			"pf: MCL2D step, 100000 particles, 8 threads", pf_test_mcl2d, 8,
+			100000));
+}
@@ -0,0 +1,121 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/nav/planners/TMoveTree.h>
+#include <mrpt/random.h>
+
+#include "common.h"
+
+using namespace mrpt;
+using namespace mrpt::nav;
+using namespace mrpt::math;
+using namespace mrpt::utils;
+using namespace std;
+
+typedef TMoveTree<TNodeSE2, TMoveEdgeSE2_TP> TTreeSE2;
+
+static TNodeSE2 randomNode()
+{
+	auto& rnd = mrpt::random::getRandomGenerator();
+	return TNodeSE2(
+		TPose2D(
+			rnd.drawUniform(-50.0, 50.0), rnd.drawUniform(-50.0, 50.0),
+			rnd.drawUniform(-M_PI, M_PI)));
+}
+
+// Grows an RRT-like tree up to "a1" nodes: each new random pose is linked
+// to its nearest node in the tree.
+// a2=0: TMoveTree::getNearestNode()
+// a2=1: exhaustive search, for reference.
+double rrt_test_grow_tree(int a1, int a2)
+{
+	const size_t N = a1;
+	const PoseDistanceMetric<TNodeSE2> metric;
+	mrpt::random::getRandomGenerator().randomize(333);
+
+	TTreeSE2 tree;
+	tree.insertNode(0, TNodeSE2(TPose2D(0, 0, 0)));
+
+	CTicTac tictac;
+	for (size_t i = 1; i < N; i++)
+	{
+		const TNodeSE2 q = randomNode();
+		TNodeID nearest = INVALID_NODEID;
+		if (a2 == 0)
+			nearest = tree.getNearestNode(q, metric);
+		else
+		{
+			double min_d = std::numeric_limits<double>::max();
+			for (const auto& n : tree.getAllNodes())
+			{
+				const double d = metric.distance(TNodeSE2(n.second.state), q);
+				if (d < min_d)
+				{
+					min_d = d;
+					nearest = n.first;
+				}
+			}
+		}
+		tree.insertNodeAndEdge(
+			nearest, tree.getNextFreeNodeID(), q,
+			TMoveEdgeSE2_TP(nearest, q.state));
+	}
+	return tictac.Tac() / N;
+}
+
+// Queries "a2" random poses against a tree with "a1" nodes.
+double rrt_test_query(int a1, int a2)
+{
+	const PoseDistanceMetric<TNodeSE2> metric;
+	mrpt::random::getRandomGenerator().randomize(333);
+
+	TTreeSE2 tree;
+	for (int i = 0; i < a1; i++) tree.insertNode(i, randomNode());
+	// Make sure the index is built:
+	tree.getNearestNode(randomNode(), metric);
+
+	CTicTac tictac;
+	TNodeID sum = 0;
+	for (int i = 0; i < a2; i++)
+		sum += tree.getNearestNode(randomNode(), metric);
+	const double t = tictac.Tac() / a2;
+	dummy_do_nothing_with_string(mrpt::format("%u", (unsigned int)sum));
+	return t;
+}
+
+// ------------------------------------------------------
+// register_tests_rrt
+// ------------------------------------------------------
+void register_tests_rrt()
+{
+	lstTests.push_back(
+		TestData(
+			"TMoveTree: grow to 1k nodes [linear search] (time/node)",
+			rrt_test_grow_tree, 1000, 1));
+	lstTests.push_back(
+		TestData(
+			"TMoveTree: grow to 10k nodes [linear search] (time/node)",
+			rrt_test_grow_tree, 10000, 1));
+	lstTests.push_back(
+		TestData(
+			"TMoveTree: grow to 1k nodes (time/node)", rrt_test_grow_tree,
+			1000, 0));
+	lstTests.push_back(
+		TestData(
+			"TMoveTree: grow to 10k nodes (time/node)", rrt_test_grow_tree,
+			10000, 0));
+	lstTests.push_back(
+		TestData(
+			"TMoveTree: grow to 100k nodes (time/node)", rrt_test_grow_tree,
+			100000, 0));
+	lstTests.push_back(
+		TestData(
+			"TMoveTree: getNearestNode() 100k nodes", rrt_test_query, 100000,
+			10000));
+}
@@ -0,0 +1,116 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/obs/CObservation2DRangeScan.h>
+#include <mrpt/obs/CObservationIMU.h>
+#include <mrpt/obs/CObservationOdometry.h>
+#include <mrpt/utils/CMemoryStream.h>
+
+#include "common.h"
+
+using namespace mrpt;
+using namespace mrpt::obs;
+using namespace mrpt::utils;
+using namespace std;
+
+// A synthetic rawlog of small observations, as in a typical dataset of a
+// mobile robot: for every 10 observations, 6 IMU readings, 3 odometry
+// readings and one (short) 2D scan.
+static void serialization_write_rawlog(CStream& out, int nObs, bool dict)
+{
+	CObservationIMU imu;
+	imu.sensorLabel = "IMU";
+	for (size_t k = 0; k < imu.rawMeasurements.size(); k++)
+	{
+		imu.rawMeasurements[k] = 0.1 * k;
+		imu.dataIsPresent[k] = (k < 6);
+	}
+	CObservationOdometry odo;
+	odo.sensorLabel = "ODOMETRY";
+	CObservation2DRangeScan scan;
+	scan.sensorLabel = "LASER";
+	scan.aperture = M_PIf;
+	scan.resizeScan(61);
+	for (size_t k = 0; k < 61; k++)
+	{
+		scan.setScanRange(k, SCAN_RANGES_1[6 * k]);
+		scan.setScanRangeValidity(k, SCAN_VALID_1[6 * k] != 0);
+	}
+
+	out.enableClassDictionary(dict);
+	for (int i = 0; i < nObs; i++)
+	{
+		const mrpt::system::TTimeStamp t = 10000000 + i * 10000;
+		switch (i % 10)
+		{
+			case 2:
+			case 5:
+			case 8:
+				odo.timestamp = t;
+				odo.odometry.x(0.01 * i);
+				out.WriteObject(odo);
+				break;
+			case 9:
+				scan.timestamp = t;
+				out.WriteObject(scan);
+				break;
+			default:
+				imu.timestamp = t;
+				out.WriteObject(imu);
+				break;
+		}
+	}
+}
+
+// a1: number of observations, a2: class dictionary mode
+double serialization_test_write(int a1, int a2)
+{
+	CMemoryStream buf;
+	CTicTac tictac;
+	serialization_write_rawlog(buf, a1, a2 != 0);
+	return tictac.Tac() / a1;
+}
+
+// a1: number of observations, a2: class dictionary mode
+double serialization_test_read(int a1, int a2)
+{
+	CMemoryStream buf;
+	serialization_write_rawlog(buf, a1, a2 != 0);
+	buf.Seek(0);
+
+	CTicTac tictac;
+	for (int i = 0; i < a1; i++)
+	{
+		CSerializable::Ptr o = buf.ReadObject();
+	}
+	return tictac.Tac() / a1;
+}
+
+// ------------------------------------------------------
+// register_tests_serialization
+// ------------------------------------------------------
+void register_tests_serialization()
+{
+	lstTests.push_back(
+		TestData(
+			"Serialization: write 1M small obs (time/obs)",
+			serialization_test_write, 1000000, 0));
+	lstTests.push_back(
+		TestData(
+			"Serialization: write 1M small obs, class dictionary (time/obs)",
+			serialization_test_write, 1000000, 1));
+	lstTests.push_back(
+		TestData(
+			"Serialization: read 1M small obs (time/obs)",
+			serialization_test_read, 1000000, 0));
+	lstTests.push_back(
+		TestData(
+			"Serialization: read 1M small obs, class dictionary (time/obs)",
+			serialization_test_read, 1000000, 1));
+}
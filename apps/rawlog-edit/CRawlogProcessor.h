@@ -13,7 +13,16 @@
 #include <mrpt/obs/CRawlog.h>
 #include <mrpt/utils/CFileGZInputStream.h>
 #include <mrpt/utils/CTicTac.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
 #include <mrpt/system/os.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 // Aparently, TCLAP headers can't be included in more than one source file
 //  or duplicated linking symbols appear! -> Use forward declarations instead:
@@ -22,6 +31,10 @@ namespace TCLAP
 {
 class CmdLine;
 }
+// Defined in rawlog-edit_main.cpp:
+template <typename T>
+bool getArgValue(
+	TCLAP::CmdLine& cmdline, const std::string& arg_name, T& out_val);
 
 namespace mrpt
 {
@@ -44,6 +57,9 @@ class CRawlogProcessor
 	uint64_t m_filSize;
 	size_t m_rawlogEntry;
 	double m_timToParse;  // Public variable, at end will hold ellapsed time.
+	// Number of threads for processOneEntry() (from "--threads", default=1).
+	// Only used if supportsParallelProcessing() returns true.
+	size_t m_num_threads;
 
 	// Ctor
 	CRawlogProcessor(
@@ -53,53 +69,104 @@ class CRawlogProcessor
 		  m_cmdline(_cmdline),
 		  verbose(_verbose),
 		  m_last_console_update(mrpt::system::now()),
-		  m_rawlogEntry(0)
+		  m_rawlogEntry(0),
+		  m_num_threads(1)
 	{
 		m_filSize = _in_rawlog.getTotalBytesCount();
+		getArgValue<size_t>(_cmdline, "threads", m_num_threads);
+		if (m_num_threads == 0)
+			m_num_threads =
+				std::max(1u, std::thread::hardware_concurrency());
 	}
 
 	// The main method:
 	void doProcessRawlog()
+	{
+		m_timParse.Tic();
+
+		if (m_num_threads > 1 && supportsParallelProcessing())
+			doProcessRawlogPipelined();
+		else
+			doProcessRawlogSequential();
+
+		if (verbose) std::cout << "\n";  // new line after the "\r".
+
+		m_timToParse = m_timParse.Tac();
+
+	}  // end doProcessRawlog
+
+	// Reimplement to return true if processOneEntry() can be safely invoked
+	// from several threads at once, for different entries. OnPostProcess()
+	// is always invoked from one single thread, in the order of the entries.
+	virtual bool supportsParallelProcessing() const { return false; }
+
+	// The virtual method of the user to be invoked for each read object:
+	//  Return false to abort and stop the read loop.
+	virtual bool processOneEntry(
+		mrpt::obs::CActionCollection::Ptr& actions,
+		mrpt::obs::CSensoryFrame::Ptr& SF,
+		mrpt::obs::CObservation::Ptr& obs) = 0;
+
+	// This method can be reimplemented to save the modified object to an output
+	// stream.
+	virtual void OnPostProcess(
+		mrpt::obs::CActionCollection::Ptr& actions,
+		mrpt::obs::CSensoryFrame::Ptr& SF, mrpt::obs::CObservation::Ptr& obs)
+	{
+		MRPT_UNUSED_PARAM(actions);
+		MRPT_UNUSED_PARAM(SF);
+		MRPT_UNUSED_PARAM(obs);
+		// Default: Do nothing
+	}
+
+   protected:
+	// Abort if the user presses ESC:
+	bool userWantsToAbort()
+	{
+		if (mrpt::system::os::kbhit())
+			if (27 == mrpt::system::os::getch())
+			{
+				std::cerr << "Aborted since user pressed ESC.\n";
+				return true;
+			}
+		return false;
+	}
+
+	// Update status to the console?
+	void showProgress(uint64_t fil_pos)
+	{
+		const mrpt::system::TTimeStamp tNow = mrpt::system::now();
+		if (mrpt::system::timeDifference(m_last_console_update, tNow) > 0.25)
+		{
+			m_last_console_update = tNow;
+			if (verbose)
+			{
+				std::cout << mrpt::format(
+					"Progress: %7u objects --- Pos: %9sB/%c%9sB \r",
+					(unsigned int)m_rawlogEntry,
+					mrpt::system::unitsFormat(fil_pos).c_str(),
+					(fil_pos > m_filSize ? '>' : ' '),
+					mrpt::system::unitsFormat(m_filSize)
+						.c_str());  // \r -> don't go to the next line...
+
+				std::cout.flush();
+			}
+		}
+	}
+
+	void doProcessRawlogSequential()
 	{
 		// The 3 different objects we can read from a rawlog:
 		mrpt::obs::CActionCollection::Ptr actions;
 		mrpt::obs::CSensoryFrame::Ptr SF;
 		mrpt::obs::CObservation::Ptr obs;
 
-		m_timParse.Tic();
-
 		// Parse the entire rawlog:
 		while (mrpt::obs::CRawlog::getActionObservationPairOrObservation(
 			m_in_rawlog, actions, SF, obs, m_rawlogEntry))
 		{
-			// Abort if the user presses ESC:
-			if (mrpt::system::os::kbhit())
-				if (27 == mrpt::system::os::getch())
-				{
-					std::cerr << "Aborted since user pressed ESC.\n";
-					break;
-				}
-
-			// Update status to the console?
-			const mrpt::system::TTimeStamp tNow = mrpt::system::now();
-			if (mrpt::system::timeDifference(m_last_console_update, tNow) >
-				0.25)
-			{
-				m_last_console_update = tNow;
-				uint64_t fil_pos = m_in_rawlog.getPosition();
-				if (verbose)
-				{
-					std::cout << mrpt::format(
-						"Progress: %7u objects --- Pos: %9sB/%c%9sB \r",
-						(unsigned int)m_rawlogEntry,
-						mrpt::system::unitsFormat(fil_pos).c_str(),
-						(fil_pos > m_filSize ? '>' : ' '),
-						mrpt::system::unitsFormat(m_filSize)
-							.c_str());  // \r -> don't go to the next line...
-
-					std::cout.flush();
-				}
-			}
+			if (userWantsToAbort()) break;
+			showProgress(m_in_rawlog.getPosition());
 
 			// Do whatever:
 			bool process_ret = processOneEntry(actions, SF, obs);
@@ -121,30 +188,124 @@ class CRawlogProcessor
 				break;
 			}
 		};  // end while
+	}
 
-		if (verbose) std::cout << "\n";  // new line after the "\r".
+	// Three-stage pipeline: one thread reads (and decompresses) entries from
+	// the input rawlog, m_num_threads workers run processOneEntry() on them,
+	// and this thread invokes OnPostProcess() on the processed entries in
+	// their original order. At most MAX_ENTRIES_PER_THREAD*m_num_threads
+	// entries are in memory at once.
+	void doProcessRawlogPipelined()
+	{
+		const size_t MAX_ENTRIES_PER_THREAD = 4;
 
-		m_timToParse = m_timParse.Tac();
+		struct TEntry
+		{
+			mrpt::obs::CActionCollection::Ptr actions;
+			mrpt::obs::CSensoryFrame::Ptr SF;
+			mrpt::obs::CObservation::Ptr obs;
+			size_t rawlogEntry;
+			uint64_t filePos;
+			std::future<bool> processed;
+		};
+		typedef std::shared_ptr<TEntry> entry_ptr_t;
+
+		mrpt::utils::CWorkerThreadsPool workers(m_num_threads);
+		std::deque<entry_ptr_t> queue;  // In rawlog order
+		std::mutex queue_mtx;
+		std::condition_variable queue_cv;
+		bool reader_done = false, stop = false;
+		std::exception_ptr reader_error;
+
+		std::thread reader([&]() {
+			try
+			{
+				size_t rawlogEntry = m_rawlogEntry;
+				for (;;)
+				{
+					{
+						std::unique_lock<std::mutex> lk(queue_mtx);
+						queue_cv.wait(lk, [&]() {
+							return stop ||
+								   queue.size() <
+									   MAX_ENTRIES_PER_THREAD * m_num_threads;
+						});
+						if (stop) break;
+					}
+					entry_ptr_t e = std::make_shared<TEntry>();
+					if (!mrpt::obs::CRawlog::
+							getActionObservationPairOrObservation(
+								m_in_rawlog, e->actions, e->SF, e->obs,
+								rawlogEntry))
+						break;
+					e->rawlogEntry = rawlogEntry;
+					e->filePos = m_in_rawlog.getPosition();
+					e->processed = workers.enqueue([this, e]() {
+						return processOneEntry(e->actions, e->SF, e->obs);
+					});
+
+					std::lock_guard<std::mutex> lk(queue_mtx);
+					queue.push_back(e);
+					queue_cv.notify_all();
+				}
+			}
+			catch (...)
+			{
+				reader_error = std::current_exception();
+			}
+			std::lock_guard<std::mutex> lk(queue_mtx);
+			reader_done = true;
+			queue_cv.notify_all();
+		});
 
-	}  // end doProcessRawlog
+		std::exception_ptr error;
+		try
+		{
+			for (;;)
+			{
+				entry_ptr_t e;
+				{
+					std::unique_lock<std::mutex> lk(queue_mtx);
+					queue_cv.wait(
+						lk, [&]() { return !queue.empty() || reader_done; });
+					if (queue.empty()) break;
+					e = queue.front();
+					queue.pop_front();
+					queue_cv.notify_all();
+				}
+				// Rethrows exceptions from the worker, if any:
+				const bool process_ret = e->processed.get();
 
-	// The virtual method of the user to be invoked for each read object:
-	//  Return false to abort and stop the read loop.
-	virtual bool processOneEntry(
-		mrpt::obs::CActionCollection::Ptr& actions,
-		mrpt::obs::CSensoryFrame::Ptr& SF,
-		mrpt::obs::CObservation::Ptr& obs) = 0;
+				m_rawlogEntry = e->rawlogEntry;
+				if (userWantsToAbort()) break;
+				showProgress(e->filePos);
 
-	// This method can be reimplemented to save the modified object to an output
-	// stream.
-	virtual void OnPostProcess(
-		mrpt::obs::CActionCollection::Ptr& actions,
-		mrpt::obs::CSensoryFrame::Ptr& SF, mrpt::obs::CObservation::Ptr& obs)
-	{
-		MRPT_UNUSED_PARAM(actions);
-		MRPT_UNUSED_PARAM(SF);
-		MRPT_UNUSED_PARAM(obs);
-		// Default: Do nothing
+				OnPostProcess(e->actions, e->SF, e->obs);
+
+				if (!process_ret)
+				{
+					std::cerr << "\nParsing stopped due to request from Rawlog "
+								 "filter implementation.\n";
+					break;
+				}
+			}
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		// Stop the reader and wait for pending work:
+		{
+			std::lock_guard<std::mutex> lk(queue_mtx);
+			stop = true;
+			queue_cv.notify_all();
+		}
+		reader.join();
+		workers.clear();
+
+		if (error) std::rethrow_exception(error);
+		if (reader_error) std::rethrow_exception(reader_error);
 	}
 
 };  // end CRawlogProcessor
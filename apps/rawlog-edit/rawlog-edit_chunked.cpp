@@ -0,0 +1,134 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include "rawlog-edit-declarations.h"
+#include <mrpt/obs/CChunkedRawlog.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
+#include <algorithm>
+#include <thread>
+
+using namespace mrpt;
+using namespace mrpt::utils;
+using namespace mrpt::obs;
+using namespace mrpt::system;
+using namespace mrpt::rawlogtools;
+using namespace std;
+
+// ======================================================================
+//		op_export_chunked
+// ======================================================================
+DECLARE_OP_FUNCTION(op_export_chunked)
+{
+	// A class to do this operation:
+	class CRawlogProcessor_ExportChunked : public CRawlogProcessor
+	{
+	   protected:
+		CChunkedRawlogWriter& m_out;
+
+	   public:
+		CRawlogProcessor_ExportChunked(
+			CFileGZInputStream& in_rawlog, TCLAP::CmdLine& cmdline,
+			bool verbose, CChunkedRawlogWriter& out)
+			: CRawlogProcessor(in_rawlog, cmdline, verbose), m_out(out)
+		{
+		}
+
+		bool processOneEntry(
+			CActionCollection::Ptr& actions, CSensoryFrame::Ptr& SF,
+			CObservation::Ptr& obs) override
+		{
+			if (actions) m_out.write(actions);
+			if (SF) m_out.write(SF);
+			if (obs) m_out.write(obs);
+			return true;
+		}
+	};
+
+	// Check the output file, as TOutputRawlogCreator does for plain
+	// rawlogs:
+	string out_file;
+	if (!getArgValue<string>(cmdline, "output", out_file))
+		throw runtime_error(
+			"This operation requires an output file. Use '-o file' or "
+			"'--output file'.");
+	if (fileExists(out_file) && !isFlagSet(cmdline, "overwrite"))
+		throw runtime_error(
+			string("*ABORTING*: Output file already exists: ") + out_file +
+			string(
+				"\n. Select a different output path, remove the file or "
+				"force overwrite with '-w' or '--overwrite'."));
+
+	CChunkedRawlogWriter out_rawlog;
+	if (!out_rawlog.open(out_file))
+		throw runtime_error(
+			string("*ABORTING*: Cannot open output file: ") + out_file);
+	size_t chunk_kb;
+	if (getArgValue<size_t>(cmdline, "chunk-size", chunk_kb))
+	{
+		ASSERT_(chunk_kb > 0);
+		out_rawlog.blockSize = chunk_kb * 1024;
+	}
+
+	// Process
+	// ---------------------------------
+	CRawlogProcessor_ExportChunked proc(
+		in_rawlog, cmdline, verbose, out_rawlog);
+	proc.doProcessRawlog();
+	out_rawlog.close();
+
+	// Dump statistics:
+	// ---------------------------------
+	VERBOSE_COUT << "Time to process file (sec)        : " << proc.m_timToParse
+				 << "\n";
+	VERBOSE_COUT << "Exported objects                  : " << out_rawlog.size()
+				 << "\n";
+}
+
+// ======================================================================
+//		op_import_chunked
+// ======================================================================
+DECLARE_OP_FUNCTION(op_import_chunked)
+{
+	MRPT_UNUSED_PARAM(in_rawlog);
+	string in_file;
+	getArgValue<string>(cmdline, "input", in_file);
+
+	CChunkedRawlogReader chunked;
+	if (!chunked.open(in_file))
+		throw runtime_error(
+			string("*ABORTING*: Cannot open input file: ") + in_file);
+	VERBOSE_COUT << "Chunked rawlog with " << chunked.size() << " objects in "
+				 << chunked.blockCount() << " blocks.\n";
+
+	TOutputRawlogCreator outrawlog;
+
+	// Decode groups of blocks in parallel and write them out in order:
+	CWorkerThreadsPool pool(
+		std::max(1u, std::thread::hardware_concurrency()));
+	const size_t BATCH = 1000;
+	std::vector<CSerializable::Ptr> objs;
+	for (size_t first = 0; first < chunked.size(); first += BATCH)
+	{
+		const size_t last = std::min(first + BATCH, chunked.size());
+		chunked.getObjects(first, last, objs, &pool);
+		for (const auto& o : objs) outrawlog.out_rawlog << o;
+
+		if (verbose)
+		{
+			cout << mrpt::format(
+				"Progress: %7u/%u objects\r", (unsigned int)last,
+				(unsigned int)chunked.size());
+			cout.flush();
+		}
+	}
+	if (verbose) cout << "\n";
+
+	VERBOSE_COUT << "Imported objects                  : " << chunked.size()
+				 << "\n";
+}
@@ -11,6 +11,7 @@
 #include <mrpt/obs/CObservation3DRangeScan.h>
 #include <mrpt/obs/CObservationImage.h>
 #include <mrpt/obs/CObservationStereoImages.h>
+#include <atomic>
 
 using namespace mrpt;
 using namespace mrpt::utils;
@@ -35,8 +36,8 @@ DECLARE_OP_FUNCTION(op_externalize)
 		string outDir;
 
 	   public:
-		size_t entries_converted;
-		size_t entries_skipped;  // Already external
+		std::atomic<size_t> entries_converted;
+		std::atomic<size_t> entries_skipped;  // Already external
 
 		CRawlogProcessor_Externalize(
 			CFileGZInputStream& in_rawlog, TCLAP::CmdLine& cmdline,
@@ -188,6 +189,8 @@ DECLARE_OP_FUNCTION(op_externalize)
 			return true;
 		}
 
+		// Each observation is saved to its own external files:
+		bool supportsParallelProcessing() const override { return true; }
 		// This method can be reimplemented to save the modified object to an
 		// output stream.
 		virtual void OnPostProcess(
@@ -213,7 +216,7 @@ DECLARE_OP_FUNCTION(op_externalize)
 	VERBOSE_COUT << "Time to process file (sec)        : " << proc.m_timToParse
 				 << "\n";
 	VERBOSE_COUT << "Entries converted                 : "
-				 << proc.entries_converted << "\n";
+				 << proc.entries_converted.load() << "\n";
 	VERBOSE_COUT << "Entries skipped (already external): "
-				 << proc.entries_skipped << "\n";
+				 << proc.entries_skipped.load() << "\n";
 }
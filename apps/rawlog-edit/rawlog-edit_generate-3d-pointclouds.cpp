@@ -9,6 +9,7 @@
 
 #include "rawlog-edit-declarations.h"
 #include <mrpt/obs/CObservation3DRangeScan.h>
+#include <atomic>
 
 using namespace mrpt;
 using namespace mrpt::utils;
@@ -30,7 +31,7 @@ DECLARE_OP_FUNCTION(op_generate_3d_pointclouds)
 		TOutputRawlogCreator outrawlog;
 
 	   public:
-		size_t entries_modified;
+		std::atomic<size_t> entries_modified;
 
 		CRawlogProcessor_Generate3DPointClouds(
 			CFileGZInputStream& in_rawlog, TCLAP::CmdLine& cmdline,
@@ -58,6 +59,8 @@ DECLARE_OP_FUNCTION(op_generate_3d_pointclouds)
 			return true;
 		}
 
+		// Each observation is projected independently:
+		bool supportsParallelProcessing() const override { return true; }
 		// This method can be reimplemented to save the modified object to an
 		// output stream.
 		virtual void OnPostProcess(
@@ -83,5 +86,5 @@ DECLARE_OP_FUNCTION(op_generate_3d_pointclouds)
 	VERBOSE_COUT << "Time to process file (sec)        : " << proc.m_timToParse
 				 << "\n";
 	VERBOSE_COUT << "Entries modified                  : "
-				 << proc.entries_modified << "\n";
+				 << proc.entries_modified.load() << "\n";
 }
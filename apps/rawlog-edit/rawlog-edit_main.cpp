@@ -66,6 +66,8 @@ DECLARE_OP_FUNCTION(op_stereo_rectify);
 DECLARE_OP_FUNCTION(op_rename_externals);
 DECLARE_OP_FUNCTION(op_list_timestamps);
 DECLARE_OP_FUNCTION(op_remap_timestamps);
+DECLARE_OP_FUNCTION(op_export_chunked);
+DECLARE_OP_FUNCTION(op_import_chunked);
 
 // Declare the supported command line switches ===========
 TCLAP::CmdLine cmd(
@@ -121,6 +123,19 @@ TCLAP::ValueArg<double> arg_to_time(
 	"seconds.",
 	false, 0, "T1", cmd);
 
+TCLAP::ValueArg<size_t> arg_threads(
+	"", "threads",
+	"Number of threads for processing observations in those operations that "
+	"support it (--externalize, --generate-3d-pointclouds, "
+	"--stereo-rectify). 0 means one per CPU core.",
+	false, 1, "N", cmd);
+
+TCLAP::ValueArg<size_t> arg_chunk_size(
+	"", "chunk-size",
+	"Size of each compressed block (before compression) for "
+	"--export-chunked, in KiB.",
+	false, 1024, "KB", cmd);
+
 TCLAP::ValueArg<double> arg_odo_KL(
 	"", "odo-KL",
 	"Constant from encoder ticks to meters (left wheel), used in "
@@ -453,6 +468,27 @@ int main(int argc, char** argv)
 				cmd, false));
 		ops_functors["rename-externals"] = &op_rename_externals;
 
+		arg_ops.push_back(
+			new TCLAP::SwitchArg(
+				"", "export-chunked",
+				"Op: convert the input rawlog into a chunked rawlog, made of "
+				"independently compressed blocks plus an index, which allows "
+				"random access to any observation (see "
+				"mrpt::obs::CChunkedRawlogReader).\n"
+				"Requires: -o (or --output)\n"
+				"Optional: --chunk-size\n",
+				cmd, false));
+		ops_functors["export-chunked"] = &op_export_chunked;
+
+		arg_ops.push_back(
+			new TCLAP::SwitchArg(
+				"", "import-chunked",
+				"Op: convert a chunked rawlog (generated with "
+				"--export-chunked) back into a plain rawlog file.\n"
+				"Requires: -o (or --output)\n",
+				cmd, false));
+		ops_functors["import-chunked"] = &op_import_chunked;
+
 		// --------------- End of list of possible operations --------
 
 		// Parse arguments:
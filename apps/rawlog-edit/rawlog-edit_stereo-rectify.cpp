@@ -9,6 +9,9 @@
 
 #include "rawlog-edit-declarations.h"
 #include <mrpt/vision/CStereoRectifyMap.h>
+#include <atomic>
+#include <mutex>
+#include <set>
 
 using namespace mrpt;
 using namespace mrpt::utils;
@@ -34,14 +37,16 @@ DECLARE_OP_FUNCTION(op_stereo_rectify)
 		string imgFileExtension;
 		double rectify_alpha;  // [0,1] see cvStereoRectify()
 
-		bool m_this_obs_is_ok;
-
 		mrpt::vision::CStereoRectifyMap rectify_map;
+		std::mutex rectify_map_mtx;
 
-		size_t m_num_external_files_failures;
+		std::atomic<size_t> m_num_external_files_failures;
+		/** Observations to be dropped due to missing external files */
+		std::set<const CObservation*> m_dropped_obs;
+		std::mutex m_dropped_obs_mtx;
 
 	   public:
-		size_t m_changedCams;
+		std::atomic<size_t> m_changedCams;
 
 		CRawlogProcessor_StereoRectify(
 			CFileGZInputStream& in_rawlog, TCLAP::CmdLine& cmdline,
@@ -132,8 +137,6 @@ DECLARE_OP_FUNCTION(op_stereo_rectify)
 
 		bool processOneObservation(CObservation::Ptr& obs)
 		{
-			m_this_obs_is_ok = true;
-
 			if (strCmpI(obs->sensorLabel, target_label))
 			{
 				if (IS_CLASS(obs, CObservationStereoImages))
@@ -145,11 +148,14 @@ DECLARE_OP_FUNCTION(op_stereo_rectify)
 					try
 					{
 						// Already initialized the rectification map?
-						if (!rectify_map.isSet())
 						{
-							// On the first ocassion, initialize map:
-							rectify_map.setAlpha(rectify_alpha);
-							rectify_map.setFromCamParams(*o);
+							std::lock_guard<std::mutex> lk(rectify_map_mtx);
+							if (!rectify_map.isSet())
+							{
+								// On the first ocassion, initialize map:
+								rectify_map.setAlpha(rectify_alpha);
+								rectify_map.setFromCamParams(*o);
+							}
 						}
 
 						// This is needed to raise an exception of the correct
@@ -160,7 +166,9 @@ DECLARE_OP_FUNCTION(op_stereo_rectify)
 						// This call rectifies the images in-place and also
 						// updates
 						// all the camera parameters as needed:
-						rectify_map.rectify(*o);
+						// (The internal memory cache can't be shared by
+						// several threads)
+						rectify_map.rectify(*o, m_num_threads <= 1);
 
 						const string label_time = format(
 							"%s_%f", o->sensorLabel.c_str(),
@@ -184,15 +192,18 @@ DECLARE_OP_FUNCTION(op_stereo_rectify)
 					catch (mrpt::utils::CExceptionExternalImageNotFound&)
 					{
 						const size_t MAX_FAILURES = 1000;
-						m_num_external_files_failures++;
-
-						if (m_num_external_files_failures < MAX_FAILURES)
+						if (++m_num_external_files_failures < MAX_FAILURES)
 						{
-							m_this_obs_is_ok = false;
+							{
+								std::lock_guard<std::mutex> lk(
+									m_dropped_obs_mtx);
+								m_dropped_obs.insert(obs.get());
+							}
 							cerr << "\n *WARNING*: Dropping one observation "
-									"due to missing external image file at "
-									"rawlog entry "
-								 << m_rawlogEntry << endl;
+									"due to missing external image file, "
+									"with timestamp "
+								 << dateTimeLocalToString(o->timestamp)
+								 << endl;
 						}
 						else
 						{
@@ -206,6 +217,8 @@ DECLARE_OP_FUNCTION(op_stereo_rectify)
 			return true;
 		}
 
+		// Each stereo pair is rectified and saved independently:
+		bool supportsParallelProcessing() const override { return true; }
 		// This method can be reimplemented to save the modified object to an
 		// output stream.
 		virtual void OnPostProcess(
@@ -213,7 +226,24 @@ DECLARE_OP_FUNCTION(op_stereo_rectify)
 			mrpt::obs::CSensoryFrame::Ptr& SF,
 			mrpt::obs::CObservation::Ptr& obs)
 		{
-			if (!m_this_obs_is_ok) return;
+			// Remove dropped observations:
+			{
+				std::lock_guard<std::mutex> lk(m_dropped_obs_mtx);
+				if (!m_dropped_obs.empty())
+				{
+					if (obs && m_dropped_obs.erase(obs.get())) return;
+					if (SF)
+					{
+						for (auto it = SF->begin(); it != SF->end();)
+						{
+							if (m_dropped_obs.erase(it->get()))
+								it = SF->erase(it);
+							else
+								++it;
+						}
+					}
+				}
+			}
 
 			ASSERT_((actions && SF) || obs)
 			if (actions)
@@ -232,6 +262,6 @@ DECLARE_OP_FUNCTION(op_stereo_rectify)
 	// ---------------------------------
 	VERBOSE_COUT << "Time to process file (sec)        : " << proc.m_timToParse
 				 << "\n";
-	VERBOSE_COUT << "Number of modified entries        : " << proc.m_changedCams
-				 << "\n";
+	VERBOSE_COUT << "Number of modified entries        : "
+				 << proc.m_changedCams.load() << "\n";
 }
@@ -36,6 +36,9 @@ COccupancyConfig::COccupancyConfig()
 		"lmLikelihoodField_II", COccupancyGridMap2D::lmLikelihoodField_II);
 	m_ui->likelihoodMethod->addItem(
 		"lmConsensusOWA", COccupancyGridMap2D::lmConsensusOWA);
+	m_ui->likelihoodMethod->addItem(
+		"lmLikelihoodField_DistanceTransform",
+		COccupancyGridMap2D::lmLikelihoodField_DistanceTransform);
 
 	COccupancyGridMap2D::TMapDefinition* def =
 		new COccupancyGridMap2D::TMapDefinition();
@@ -23,6 +23,9 @@
 	- All pointer typedefs are now in their respective classes.
 	- Using a variant type from the mapbox variant library, and added serialization with variants(To be replaced by std::variant eventually).
 - <b>Detailed list of changes:</b>
+	- Changes in apps:
+		- [rawlog-edit](http://www.mrpt.org/list-of-mrpt-apps/application-rawlog-edit/): New operations `--export-chunked` and `--import-chunked` to convert to/from chunked rawlog files.
+		- [rawlog-edit](http://www.mrpt.org/list-of-mrpt-apps/application-rawlog-edit/): New argument `--threads` to run `--externalize`, `--generate-3d-pointclouds` and `--stereo-rectify` as a pipeline of one reader thread, several worker threads and an ordered writer.
 	- Changes in libraries:
 		- \ref mrpt_base_grp
 			- Removed functions (replaced by C++11/14 standard library):
@@ -31,16 +34,58 @@
 			- Added: mrpt::make_aligned_shared<> template
 			- mrpt::utils::CConfigFileBase::write() now supports enum types.
 			- New method mrpt::utils::CStream::ReadPOD() and macro `MRPT_READ_POD()` for reading unaligned POD variables.-
+			- New class mrpt::utils::CWorkerThreadsPool: a pool of persistent worker threads.
+			- New class mrpt::utils::CWorkerThreadsPoolHolder, to keep a thread pool in options structures without sharing it between their copies.
+			- mrpt::math::KDTreeCapable queries no longer write to shared internal buffers, so they can be run from several threads once the index is built.
+			- New option mrpt::bayes::CParticleFilter::TParticleFilterOptions::numThreads to draw motion samples and evaluate particle weights in parallel, with per-thread random streams for reproducible results.
+			- mrpt::poses::CPoseRandomSampler::drawSample() can now take an explicit random generator.
+			- mrpt::math::KDTreeCapable keeps an incremental index: appended points are indexed in small sub-trees which are logarithmically merged (see `kdtree_mark_as_appended()`), and points can be removed with tombstones (`kdtree_mark_as_removed()`).
+			- New methods mrpt::math::CSparseMatrix::getValuesPtr() and mrpt::math::CSparseMatrix::getColumnCompressedIndex() to refill a column-compressed matrix keeping its sparsity pattern.
+			- mrpt::poses::FrameTransformer keeps a bounded history of transforms per parent-child pair and can look up transforms at any past time (interpolating, with SLERP in SE(3)) and between any two frames of a tree, not only parent-child pairs. Frames can be referred to by integer IDs (mrpt::poses::FrameTransformer::getFrameID()), and look-ups from several threads never block on publishers.
+			- mrpt::utils::CImage keeps images read from a stream in their serialized (JPEG, ZIP or raw) form until their pixels are first accessed (see mrpt::utils::CImage::isCompressedResident() and mrpt::utils::CImage::DISABLE_LAZY_DECODING). Encoded images are shared between copies and written back to streams as they were read, without decoding and re-encoding them, even in builds without OpenCV.
+			- New class dictionary mode for mrpt::utils::CStream (see mrpt::utils::CStream::enableClassDictionary()): the class name of serialized objects is written only once per stream and later objects only store a short class ID, which makes smaller and faster to read streams of many small objects. Streams in the standard and the new format are both read transparently.
+		- \ref mrpt_bayes_grp
+			- New Kalman filter method mrpt::bayes::kfEKFCompressed (compressed EKF): each iteration only updates the vehicle and the landmarks in an active local region, and the exact update of the rest of the map is deferred until the robot leaves that region (see mrpt::bayes::TKF_options::compressed_max_idle_landmarks and mrpt::bayes::CKalmanFilterCapable::makeSureStateIsUpToDate()). It works with the same user callbacks as the other methods.
 		- \ref mrpt_slam_grp
 			- rbpf-slam: Add support for simplemap continuation.
+			- Particle filters evaluate the observation likelihood of all particles at once, via the new virtual method mrpt::slam::PF_implementation::PF_SLAM_computeObservationLikelihoodForParticles(), reimplemented in mrpt::slam::CMonteCarloLocalization2D and mrpt::maps::CMultiMetricMapPDF.
+			- Particle filters can run the prediction and weighting stages of their particles in parallel (see mrpt::bayes::CParticleFilter::TParticleFilterOptions::numThreads). The auxiliary PFs (pfAuxiliaryPFStandard, pfAuxiliaryPFOptimal) evaluate the first stage weights and each round of rejection sampling of all particles in one batch.
+			- mrpt::slam::CICP::Align3D() supports two new algorithms: point-to-plane ICP (mrpt::slam::icpPointToPlane) and Generalized-ICP (mrpt::slam::icpGICP), solved with Gauss-Newton in SE(3) and an optional robust kernel. See the new option mrpt::slam::CICP::TConfigParams::normals_num_neighbors.
+			- mrpt::slam::CICP can look for correspondences in parallel (new option mrpt::slam::CICP::TConfigParams::numThreads).
 		- \ref mrpt_nav_grp
 			- Removed deprecated mrpt::nav::THolonomicMethod.
 			- mrpt::nav::CAbstractNavigator: callbacks in mrpt::nav::CRobot2NavInterface are now invoked *after* `navigationStep()` to avoid problems if user code invokes the navigator API to change its state.
 			- Added methods to load/save mrpt::nav::TWaypointSequence to configuration files.
+			- mrpt::nav::TMoveTree::getNearestNode() looks for candidate nodes in an incrementally-updated KD-tree instead of evaluating the metric for all nodes, which speeds up RRT planners (mrpt::nav::PlannerRRT_SE2_TPS) with large trees.
+			- mrpt::nav::CAbstractPTGBasedReactive can evaluate its PTGs (TP-Obstacles, holonomic method and scores) in parallel on a persistent pool of threads (new option `num_threads` in mrpt::nav::CAbstractPTGBasedReactive::TAbstractPTGNavigatorParams), with the same results than the serial evaluation. The time of each stage is saved in mrpt::nav::CLogFileRecord::values.
 		- \ref mrpt_comms_grp [NEW IN MRPT 2.0.0]
 			- This new module has been created to hold all serial devices & networking classes, with minimal dependencies.
 		- \ref mrpt_maps_grp
 			- Added optional "channel" attribute to CReflectivityGrdMap2D and CObservationReflectivity to support different colors of light.
+			- New likelihood method mrpt::maps::COccupancyGridMap2D::lmLikelihoodField_DistanceTransform: likelihood field evaluated from an exact, incrementally-updated distance transform of the grid.
+			- New methods mrpt::maps::CMetricMap::computeObservationLikelihoodBatch() and mrpt::maps::CMetricMap::computeObservationsLikelihoodBatch() to evaluate many poses at once, optionally in parallel. Specialized versions for mrpt::maps::COccupancyGridMap2D, mrpt::maps::CPointsMap and mrpt::maps::CMultiMetricMap.
+			- mrpt::maps::CPointsMap no longer rebuilds its whole KD-tree after inserting new points or observations (without fusion), only the new points are indexed.
+			- New map class mrpt::maps::CVoxelHashPointsMap: a point cloud stored in a spatial hash of voxels with a bounded number of points each, with constant-time insertion and downsampling, nearest-neighbor searches without a KD-tree, and removal of far away voxels.
+			- mrpt::maps::COccupancyGridMap2D can now store its cells in fixed-size tiles allocated on demand (see mrpt::maps::COccupancyGridMap2D::setTiledStorage() and the `tiledStorage` creation option), so growing the grid does not copy existing cells and unexplored areas take no memory. With tiled storage, the const mrpt::maps::COccupancyGridMap2D::getRow() returns a copy of the row, and the non-const one switches the map back to dense storage.
+			- Tiles of mrpt::maps::COccupancyGridMap2D are shared between copies of a map and duplicated only when modified (copy-on-write), so duplicating RBPF particles with tiled grids only copies pointers to tiles. See mrpt::maps::COccupancyGridMap2D::getSharedTilesCount().
+			- New method mrpt::maps::COccupancyGridMap2D::insertObservationsBatch() to insert many 2D scans at once, tracing their rays in parallel, with exactly the same result than inserting them one by one.
+			- New methods mrpt::maps::CPointsMap::getPointsNormals() and mrpt::maps::CPointsMap::getPointsPlaneCovariances() to estimate the local surface around each point, cached until the map is modified.
+			- mrpt::maps::CPointsMap::determineMatching2D() and mrpt::maps::CPointsMap::determineMatching3D() transform points with vectorized Eigen expressions and run the KD-tree queries in parallel chunks if a thread pool is given in the new field mrpt::maps::TMatchingParams::threadPool.
+			- The sensor simulators of mrpt::maps::COccupancyGridMap2D (laserScanSimulator(), sonarSimulator(), laserScanSimulatorWithUncertainty()) skip free space along each ray with a cached distance field of the grid, with exactly the same results as stepping cell by cell (see mrpt::maps::COccupancyGridMap2D::RAYTRACE_USE_DISTANCE_FIELD), and can split the rays of a scan among the threads of a mrpt::utils::CWorkerThreadsPool.
+		- \ref mrpt_graphslam_grp
+			- mrpt::graphslam::optimize_graph_spa_levmarq() builds the block structure of the Hessian only once and updates it in place on each iteration, reuses the symbolic Cholesky factorization (fill-reducing ordering) between iterations and, through the new optional mrpt::graphslam::TLevMarqSolverCache argument, between calls with the same graph structure. Jacobians and errors can be evaluated in parallel (new parameter `num_threads`).
+		- \ref mrpt_obs_grp
+			- mrpt::obs::CObservation3DRangeScan::project3DPointsFromDepthImage() can be run from several threads at once (its look-up table is now per-thread).
+			- New classes mrpt::obs::CChunkedRawlogWriter and mrpt::obs::CChunkedRawlogReader for a new chunked rawlog file format: independently compressed blocks of objects plus an index of timestamps, sensor labels and classes, which allows memory-mapped, random access to any object, searching by timestamp and decoding blocks in parallel.
+			- mrpt::obs::CObservation3DRangeScan::project3DPointsFromDepthImageInto() filters, projects, colors and transforms each pixel in one single pass, writing points directly into the destination map without intermediate buffers. New options in mrpt::obs::T3DPointsProjectionParams: `decimation`, a region of interest (`roi_*`) and a `threadPool` to project rows in parallel.
+			- New functions mrpt::obs::simulateRangeScan() to simulate full mrpt::obs::CObservation2DRangeScan and mrpt::obs::CObservation3DRangeScan observations by ray tracing an mrpt::opengl::COpenGLScene.
+		- \ref mrpt_opengl_grp
+			- mrpt::opengl::COpenGLScene::traceRay() uses a bounding volume hierarchy over all the triangles and objects of the scene in world coordinates (new class mrpt::opengl::CRayTracingBVH), lazily rebuilt when objects change and just refit when they only move (see mrpt::opengl::COpenGLScene::TRACERAY_USE_BVH). New method mrpt::opengl::COpenGLScene::traceRays() to trace many rays from one origin in packets, optionally in parallel.
+			- New virtual methods mrpt::opengl::CRenderizable::getTrianglesForRayTracing() and mrpt::opengl::CRenderizable::getGeometryVersion().
+		- \ref mrpt_vision_grp
+			- New feature tracker mrpt::vision::CFeatureTracker_PyrLK: a pyramidal Lucas-Kanade tracker which does not rely on OpenCV's cvCalcOpticalFlowPyrLK(). It precomputes the Scharr gradients of each pyramid level, reuses the pyramid of the last image while tracking a video, interpolates patches with SSE2 and can track features in parallel (`num_threads` parameter).
+			- mrpt::vision::matchFeatures() matches SIFT, SURF and ORB descriptors with a brute-force search over descriptors packed into contiguous, aligned matrices (new class mrpt::vision::CDescriptorMatrix and functions mrpt::vision::find_best_two_descriptor_matches() and mrpt::vision::match_descriptors()), with SSE2 Euclidean distances and hardware popcount for Hamming distances, optionally in parallel (new option mrpt::vision::TMatchingOptions::numThreads). mrpt::vision::TMatchingOptions::enable_robust_1to1_match now keeps only mutual best matches.
+			- mrpt::vision::bundle_adj_full() keeps the block structure of the reduced camera system and the symbolic analysis of its Cholesky decomposition between iterations, computes the Schur complement of the points in parallel (new `num_threads` parameter) and can solve the reduced system with preconditioned conjugate gradient (`linear_solver`=1) for large problems.
 	- BUG FIXES:
 		- Fix reactive navigator inconsistent state if navigation API is called from within rnav callbacks.
 		- Fix incorrect evaluation of "ASSERT" formulas in mrpt::nav::CMultiObjectiveMotionOptimizerBase
@@ -48,6 +93,19 @@
 		- Fix == operator on CPose3D: it now uses an epsilon for comparing the rotation matrices.
 		- Fix accessing unaligned POD variables deserializing CObservationGPS (via the new `MRPT_READ_POD()` macro).
 		- Fix segfault in CMetricMap::loadFromSimpleMap() if the provided CMetricMap has empty smart pointers.
+		- Fix outdated KD-tree after mrpt::maps::CPointsMap::fuseWith().
+		- Fix wrong cells being checked by mrpt::maps::COccupancyGridMap2D::computeClearance() (and hence, Voronoi diagrams) in non-square grids.
+		- Fix wrong ray end points in mrpt::maps::COccupancyGridMap2D when inserting 2D scans with `insertionOptions.decimation` greater than 1.
+		- Fix mrpt::graphslam::optimize_graph_spa_levmarq() accumulating the Hessian of all past iterations instead of using that at the current estimate, which made it converge very slowly.
+		- Fix memory leak in mrpt::math::CSparseMatrix::CholeskyDecomp for non positive-definite matrices.
+		- Fix mrpt::random::CRandomGenerator::randomize() not discarding the gaussian sample cached from the previous sequence, which made gaussian draws not reproducible for a given seed.
+		- Fix mrpt::nav::PoseDistanceMetric<mrpt::nav::TNodeSE2> discarding nodes which could be the nearest one for (squared) distances below 1.
+		- Fix wrong 3D points from mrpt::obs::CObservation3DRangeScan::project3DPointsFromDepthImageInto() with `range_is_depth=false`, and with the look-up table but not SSE2 if there were invalid pixels.
+		- Fix mrpt::obs::CObservation3DRangeScan::project3DPointsFromDepthImageInto() with SSE2 applying range masks differently than without it.
+		- Fix ORB matching in mrpt::vision::matchFeatures(): Hamming distances above 255 wrapped around, and mrpt::vision::TMatchingOptions::maxORB_dist was left uninitialized.
+		- Fix build errors projecting 3D range scans into mrpt::maps::CColouredPointsMap and mrpt::maps::CWeightedPointsMap.
+		- Fix mrpt::utils::CImage deserialization in builds without OpenCV leaving the rest of the stream unreadable, which prevented loading any rawlog with images.
+		- Fix mrpt::opengl::CEllipsoid::getBoundingBox() returning a flat box for 3D ellipsoids.
 
 
 <hr>
@@ -13,6 +13,7 @@
 #include <mrpt/utils/COutputLogger.h>
 #include <mrpt/utils/CLoadableOptions.h>
 #include <mrpt/utils/TEnumType.h>
+#include <mrpt/utils/CWorkerThreadsPoolHolder.h>
 
 namespace mrpt
 {
@@ -167,6 +168,37 @@ class CParticleFilter : public mrpt::utils::COutputLogger
 		 * perform rejection sampling, but just the most-likely (ML) particle
 		 * found in the preliminary weight-determination stage. */
 		bool pfAuxFilterOptimal_MLE;
+
+		/** Number of threads used to draw the motion samples and to evaluate
+		 * the observation likelihood of particles (default=1: do everything
+		 * in the caller thread). Particles are split into `numThreads`
+		 * contiguous chunks, each one drawing random samples from its own
+		 * random stream (seeded from the global random generator), so results
+		 * are reproducible for a given seed and number of threads.
+		 * Resampling is always done serially.
+		 * \note Motion sampling is only parallel in the fixed sample size
+		 * path of pfStandardProposal. With pfAuxiliaryPFStandard and
+		 * pfAuxiliaryPFOptimal, samples are drawn in the caller thread and
+		 * the observation likelihoods of all particles (first stage weights
+		 * and, with a fixed sample size, each round of rejection sampling)
+		 * are evaluated in batches spread among the threads, so their result
+		 * does not depend on the number of threads (>1). Likelihoods are
+		 * only evaluated in parallel if the particle filter implementation
+		 * supports batched likelihoods.
+		 */
+		unsigned int numThreads;
+
+		/** Returns the pool of worker threads to be used according to
+		 * numThreads, or nullptr if numThreads<=1. The pool is created on the
+		 * first call and kept alive, but it is not shared with copies of this
+		 * struct. */
+		mrpt::utils::CWorkerThreadsPool* getThreadPool() const
+		{
+			return m_threadPool.get(numThreads);
+		}
+
+	   private:
+		mrpt::utils::CWorkerThreadsPoolHolder m_threadPool;
 	};
 
 	/** Statistics for being returned from the "execute" method. */
@@ -414,6 +414,30 @@ class CSparseMatrix
 		return sparse_matrix.nz < 0;
 	}  // <0 means "column compressed", ">=0" means triplet.
 
+	/** Number of entries stored in a column-compressed matrix (structural
+	 * non-zeros, which may hold actual zeros). \sa getValuesPtr */
+	inline size_t getNonZeroCount() const
+	{
+		ASSERT_(isColumnCompressed());
+		return sparse_matrix.p[sparse_matrix.n];
+	}
+
+	/** Returns the position of the entry (row,col) of a column-compressed
+	 * matrix in the array returned by getValuesPtr(), or -1 if the entry is
+	 * not stored. Takes O(number of entries in column `col`) time.
+	 * \sa getValuesPtr */
+	int getColumnCompressedIndex(const size_t row, const size_t col) const;
+
+	/** Direct access to the array of getNonZeroCount() values of a
+	 * column-compressed matrix. It allows refilling a matrix with a fixed
+	 * sparsity pattern (e.g. before CholeskyDecomp::update()) without
+	 * rebuilding it from a triplet. \sa getColumnCompressedIndex */
+	inline double* getValuesPtr()
+	{
+		ASSERT_(isColumnCompressed());
+		return sparse_matrix.x;
+	}
+
 	/** @} */
 
 	/** @name Cholesky factorization
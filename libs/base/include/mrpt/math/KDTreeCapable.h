@@ -15,11 +15,28 @@
 #include <mrpt/otherlibs/nanoflann/nanoflann.hpp>
 #include <mrpt/math/lightweight_geom_data.h>
 #include <memory>  // unique_ptr
+#include <algorithm>  // sort
+#include <cstdint>
+#include <vector>
 
 namespace mrpt
 {
 namespace math
 {
+namespace detail
+{
+/** Gives the type of a nanoflann metric (e.g. L2_Simple_Adaptor<T,DS,D>)
+ * over a different dataset class */
+template <class METRIC, class NEW_DATASET>
+struct TRebindKDTreeMetric;
+template <template <class, class, class> class METRIC, class T, class DS,
+		  class D, class NEW_DATASET>
+struct TRebindKDTreeMetric<METRIC<T, DS, D>, NEW_DATASET>
+{
+	typedef METRIC<T, NEW_DATASET, D> type;
+};
+}
+
 /** \addtogroup kdtree_grp KD-Trees
   *  \ingroup mrpt_base_grp
   *  @{ */
@@ -62,7 +79,9 @@ namespace math
  *  \endcode
  *
  * The KD-tree index will be built on demand only upon call of any of the query
- * methods provided by this class.
+ * methods provided by this class. Once the index is up-to-date, queries do not
+ * modify any internal state, so they can be run in parallel from several
+ * threads (make one first query from a single thread to build the index).
  *
  *  Notice that there is only ONE internal cached KD-tree, so if a method to
  * query a 2D point is called,
@@ -138,11 +157,10 @@ class KDTreeCapable
 		nanoflann::KNNResultSet<num_t> resultSet(knn);
 		resultSet.init(&ret_index, &out_dist_sqr);
 
-		m_kdtree2d_data.query_point[0] = x0;
-		m_kdtree2d_data.query_point[1] = y0;
-		m_kdtree2d_data.index->findNeighbors(
-			resultSet, &m_kdtree2d_data.query_point[0],
-			nanoflann::SearchParams());
+		const num_t query_point[2] = {x0, y0};
+		m_kdtree2d_data.findNeighbors(
+			resultSet, &query_point[0], nanoflann::SearchParams(),
+			m_kdtree_removed);
 
 		// Copy output to user vars:
 		out_x = derived().kdtree_get_pt(ret_index, 0);
@@ -166,11 +184,10 @@ class KDTreeCapable
 		nanoflann::KNNResultSet<num_t> resultSet(knn);
 		resultSet.init(&ret_index, &out_dist_sqr);
 
-		m_kdtree2d_data.query_point[0] = x0;
-		m_kdtree2d_data.query_point[1] = y0;
-		m_kdtree2d_data.index->findNeighbors(
-			resultSet, &m_kdtree2d_data.query_point[0],
-			nanoflann::SearchParams());
+		const num_t query_point[2] = {x0, y0};
+		m_kdtree2d_data.findNeighbors(
+			resultSet, &query_point[0], nanoflann::SearchParams(),
+			m_kdtree_removed);
 
 		return ret_index;
 		MRPT_END
@@ -240,11 +257,10 @@ class KDTreeCapable
 		nanoflann::KNNResultSet<num_t> resultSet(knn);
 		resultSet.init(&ret_indexes[0], &ret_sqdist[0]);
 
-		m_kdtree2d_data.query_point[0] = x0;
-		m_kdtree2d_data.query_point[1] = y0;
-		m_kdtree2d_data.index->findNeighbors(
-			resultSet, &m_kdtree2d_data.query_point[0],
-			nanoflann::SearchParams());
+		const num_t query_point[2] = {x0, y0};
+		m_kdtree2d_data.findNeighbors(
+			resultSet, &query_point[0], nanoflann::SearchParams(),
+			m_kdtree_removed);
 
 		// Copy output to user vars:
 		out_x1 = derived().kdtree_get_pt(ret_indexes[0], 0);
@@ -309,11 +325,10 @@ class KDTreeCapable
 		nanoflann::KNNResultSet<num_t> resultSet(knn);
 		resultSet.init(&ret_indexes[0], &out_dist_sqr[0]);
 
-		m_kdtree2d_data.query_point[0] = x0;
-		m_kdtree2d_data.query_point[1] = y0;
-		m_kdtree2d_data.index->findNeighbors(
-			resultSet, &m_kdtree2d_data.query_point[0],
-			nanoflann::SearchParams());
+		const num_t query_point[2] = {x0, y0};
+		m_kdtree2d_data.findNeighbors(
+			resultSet, &query_point[0], nanoflann::SearchParams(),
+			m_kdtree_removed);
 
 		for (size_t i = 0; i < knn; i++)
 		{
@@ -371,11 +386,10 @@ class KDTreeCapable
 		nanoflann::KNNResultSet<num_t> resultSet(knn);
 		resultSet.init(&out_idx[0], &out_dist_sqr[0]);
 
-		m_kdtree2d_data.query_point[0] = x0;
-		m_kdtree2d_data.query_point[1] = y0;
-		m_kdtree2d_data.index->findNeighbors(
-			resultSet, &m_kdtree2d_data.query_point[0],
-			nanoflann::SearchParams());
+		const num_t query_point[2] = {x0, y0};
+		m_kdtree2d_data.findNeighbors(
+			resultSet, &query_point[0], nanoflann::SearchParams(),
+			m_kdtree_removed);
 		MRPT_END
 	}
 
@@ -421,12 +435,10 @@ class KDTreeCapable
 		nanoflann::KNNResultSet<num_t> resultSet(knn);
 		resultSet.init(&ret_index, &out_dist_sqr);
 
-		m_kdtree3d_data.query_point[0] = x0;
-		m_kdtree3d_data.query_point[1] = y0;
-		m_kdtree3d_data.query_point[2] = z0;
-		m_kdtree3d_data.index->findNeighbors(
-			resultSet, &m_kdtree3d_data.query_point[0],
-			nanoflann::SearchParams());
+		const num_t query_point[3] = {x0, y0, z0};
+		m_kdtree3d_data.findNeighbors(
+			resultSet, &query_point[0], nanoflann::SearchParams(),
+			m_kdtree_removed);
 
 		// Copy output to user vars:
 		out_x = derived().kdtree_get_pt(ret_index, 0);
@@ -451,12 +463,10 @@ class KDTreeCapable
 		nanoflann::KNNResultSet<num_t> resultSet(knn);
 		resultSet.init(&ret_index, &out_dist_sqr);
 
-		m_kdtree3d_data.query_point[0] = x0;
-		m_kdtree3d_data.query_point[1] = y0;
-		m_kdtree3d_data.query_point[2] = z0;
-		m_kdtree3d_data.index->findNeighbors(
-			resultSet, &m_kdtree3d_data.query_point[0],
-			nanoflann::SearchParams());
+		const num_t query_point[3] = {x0, y0, z0};
+		m_kdtree3d_data.findNeighbors(
+			resultSet, &query_point[0], nanoflann::SearchParams(),
+			m_kdtree_removed);
 
 		return ret_index;
 		MRPT_END
@@ -517,12 +527,10 @@ class KDTreeCapable
 		nanoflann::KNNResultSet<num_t> resultSet(knn);
 		resultSet.init(&ret_indexes[0], &out_dist_sqr[0]);
 
-		m_kdtree3d_data.query_point[0] = x0;
-		m_kdtree3d_data.query_point[1] = y0;
-		m_kdtree3d_data.query_point[2] = z0;
-		m_kdtree3d_data.index->findNeighbors(
-			resultSet, &m_kdtree3d_data.query_point[0],
-			nanoflann::SearchParams());
+		const num_t query_point[3] = {x0, y0, z0};
+		m_kdtree3d_data.findNeighbors(
+			resultSet, &query_point[0], nanoflann::SearchParams(),
+			m_kdtree_removed);
 
 		for (size_t i = 0; i < knn; i++)
 		{
@@ -575,12 +583,10 @@ class KDTreeCapable
 		nanoflann::KNNResultSet<num_t> resultSet(knn);
 		resultSet.init(&out_idx[0], &out_dist_sqr[0]);
 
-		m_kdtree3d_data.query_point[0] = x0;
-		m_kdtree3d_data.query_point[1] = y0;
-		m_kdtree3d_data.query_point[2] = z0;
-		m_kdtree3d_data.index->findNeighbors(
-			resultSet, &m_kdtree3d_data.query_point[0],
-			nanoflann::SearchParams());
+		const num_t query_point[3] = {x0, y0, z0};
+		m_kdtree3d_data.findNeighbors(
+			resultSet, &query_point[0], nanoflann::SearchParams(),
+			m_kdtree_removed);
 
 		for (size_t i = 0; i < knn; i++)
 		{
@@ -636,9 +642,8 @@ class KDTreeCapable
 		if (m_kdtree3d_data.m_num_points != 0)
 		{
 			const num_t xyz[3] = {x0, y0, z0};
-			m_kdtree3d_data.index->radiusSearch(
-				&xyz[0], maxRadiusSqr, out_indices_dist,
-				nanoflann::SearchParams());
+			m_kdtree3d_data.radiusSearch(
+				&xyz[0], maxRadiusSqr, out_indices_dist, m_kdtree_removed);
 		}
 		return out_indices_dist.size();
 		MRPT_END
@@ -670,9 +675,8 @@ class KDTreeCapable
 		if (m_kdtree2d_data.m_num_points != 0)
 		{
 			const num_t xyz[2] = {x0, y0};
-			m_kdtree2d_data.index->radiusSearch(
-				&xyz[0], maxRadiusSqr, out_indices_dist,
-				nanoflann::SearchParams());
+			m_kdtree2d_data.radiusSearch(
+				&xyz[0], maxRadiusSqr, out_indices_dist, m_kdtree_removed);
 		}
 		return out_indices_dist.size();
 		MRPT_END
@@ -709,12 +713,10 @@ class KDTreeCapable
 		nanoflann::KNNResultSet<num_t> resultSet(knn);
 		resultSet.init(&out_idx[0], &out_dist_sqr[0]);
 
-		m_kdtree3d_data.query_point[0] = x0;
-		m_kdtree3d_data.query_point[1] = y0;
-		m_kdtree3d_data.query_point[2] = z0;
-		m_kdtree3d_data.index->findNeighbors(
-			resultSet, &m_kdtree3d_data.query_point[0],
-			nanoflann::SearchParams());
+		const num_t query_point[3] = {x0, y0, z0};
+		m_kdtree3d_data.findNeighbors(
+			resultSet, &query_point[0], nanoflann::SearchParams(),
+			m_kdtree_removed);
 		MRPT_END
 	}
 
@@ -736,7 +738,114 @@ class KDTreeCapable
 		m_kdtree_is_uptodate = false;
 	}
 
+	/** To be called by child classes instead of kdtree_mark_as_outdated() when
+	 * the only change in the data points is that new ones have been appended
+	 * at the end, while the existing ones keep their indices and values.
+	 * In that case, the next query will only index the new points in a small
+	 * sub-tree instead of rebuilding the whole KD-tree. Sub-trees are merged
+	 * such that each one is, at least, twice larger than the next one, so
+	 * there are at most O(log N) sub-trees to look at in each query and each
+	 * point is re-indexed O(log N) times in the amortized sense. */
+	inline void kdtree_mark_as_appended() const {}
+	/** To be called by child classes when the point with index `idx` must be
+	 * ignored in subsequent queries, while all other points keep their
+	 * indices (i.e. "lazy" deletion via a tombstone). The removed points are
+	 * actually dropped from the index the next time it is rebuilt, which
+	 * happens automatically once there are more removed than alive points
+	 * in it. Tombstones are cleared by kdtree_mark_as_outdated(). */
+	void kdtree_mark_as_removed(const size_t idx) const
+	{
+		check_kdTree_uptodate();
+		if (m_kdtree_removed.size() <= idx) m_kdtree_removed.resize(idx + 1, 0);
+		if (m_kdtree_removed[idx]) return;  // Already removed
+		m_kdtree_removed[idx] = 1;
+		m_kdtree2d_data.mark_as_removed(idx);
+		m_kdtree3d_data.mark_as_removed(idx);
+	}
+
+	/** Returns true if the given point was marked with
+	 * kdtree_mark_as_removed() */
+	inline bool kdtree_is_removed(const size_t idx) const
+	{
+		return idx < m_kdtree_removed.size() && m_kdtree_removed[idx] != 0;
+	}
+
    private:
+	/** Dataset adaptor for one sub-tree: it exposes either a range of
+	 * consecutive points [first,last) of the derived class, or an explicit
+	 * list of indices, if some of the points in the range have been removed.
+	 */
+	struct TSubTreeDataset
+	{
+		const Derived* data = nullptr;
+		size_t first = 0, last = 0;
+		/** Empty: use the whole range [first,last) */
+		std::vector<size_t> ids;
+		/** Whether this sub-tree holds all the points of the dataset */
+		bool is_whole_dataset = false;
+
+		inline size_t global_index(const size_t i) const
+		{
+			return ids.empty() ? first + i : ids[i];
+		}
+		inline size_t kdtree_get_point_count() const
+		{
+			return ids.empty() ? last - first : ids.size();
+		}
+		inline num_t kdtree_get_pt(const size_t i, int dim) const
+		{
+			return data->kdtree_get_pt(global_index(i), dim);
+		}
+		template <typename T>
+		inline auto kdtree_distance(
+			const T* p1, const size_t i, size_t size) const
+			-> decltype(data->kdtree_distance(p1, i, size))
+		{
+			return data->kdtree_distance(p1, global_index(i), size);
+		}
+		template <class BBOX>
+		bool kdtree_get_bbox(BBOX& bb) const
+		{
+			return is_whole_dataset && data->kdtree_get_bbox(bb);
+		}
+	};
+
+	/** The same metric than the one given as template argument, but over a
+	 * sub-tree dataset instead of the derived class */
+	typedef
+		typename detail::TRebindKDTreeMetric<metric_t, TSubTreeDataset>::type
+			subtree_metric_t;
+
+	/** A nanoflann result set wrapper which translates sub-tree indices into
+	 * indices in the derived class, and filters out removed points */
+	template <class RESULTSET>
+	struct TSubTreeResultSet
+	{
+		RESULTSET& result;
+		const TSubTreeDataset& dataset;
+		const std::vector<uint8_t>& removed;
+
+		TSubTreeResultSet(
+			RESULTSET& r, const TSubTreeDataset& ds,
+			const std::vector<uint8_t>& rem)
+			: result(r), dataset(ds), removed(rem)
+		{
+		}
+		inline size_t size() const { return result.size(); }
+		inline bool full() const { return result.full(); }
+		inline auto worstDist() const -> decltype(result.worstDist())
+		{
+			return result.worstDist();
+		}
+		template <typename DIST, typename IDX>
+		inline void addPoint(DIST dist, IDX index)
+		{
+			const size_t idx = dataset.global_index(index);
+			if (idx < removed.size() && removed[idx]) return;
+			result.addPoint(dist, idx);
+		}
+	};
+
 	/** Internal structure with the KD-tree representation (mainly used to avoid
 	 * copying pointers with the = operator) */
 	template <int _DIM = -1>
@@ -757,91 +866,176 @@ class KDTreeCapable
 		}
 
 		/** Free memory (if allocated)  */
-		inline void clear() noexcept { index.reset(); }
-		typedef nanoflann::KDTreeSingleIndexAdaptor<metric_t, Derived, _DIM>
+		inline void clear() noexcept
+		{
+			subtrees.clear();
+			m_num_points = 0;
+			m_num_indexed = 0;
+			m_num_dead = 0;
+		}
+		typedef nanoflann::KDTreeSingleIndexAdaptor<subtree_metric_t,
+													TSubTreeDataset, _DIM>
 			kdtree_index_t;
 
-		/** nullptr or the up-to-date index */
-		std::unique_ptr<kdtree_index_t> index;
+		struct TSubTree
+		{
+			TSubTreeDataset dataset;
+			/** The index over `dataset` (which must not be moved) */
+			std::unique_ptr<kdtree_index_t> index;
+			/** Number of points in the index which were removed after
+			 * building it */
+			size_t num_dead = 0;
+		};
+
+		/** The sub-trees, sorted by the range of points they hold */
+		std::vector<std::unique_ptr<TSubTree>> subtrees;
 
-		std::vector<num_t> query_point;
 		/** Dimensionality. typ: 2,3 */
 		size_t m_dim = _DIM;
+		/** Number of (not removed) points in the index */
 		size_t m_num_points = 0;
+		/** Points [0,m_num_indexed) are already in some sub-tree */
+		size_t m_num_indexed = 0;
+		/** Number of removed points still in some sub-tree */
+		size_t m_num_dead = 0;
+
+		void mark_as_removed(const size_t idx)
+		{
+			if (idx >= m_num_indexed) return;  // Will be skipped when indexed
+			// Find its sub-tree:
+			for (auto it = subtrees.rbegin(); it != subtrees.rend(); ++it)
+			{
+				if ((*it)->dataset.first <= idx)
+				{
+					(*it)->num_dead++;
+					m_num_dead++;
+					m_num_points--;
+					break;
+				}
+			}
+		}
+
+		/** Search over all the sub-trees, returning the indices of the points
+		 * in the derived class in `result` */
+		template <class RESULTSET>
+		void findNeighbors(
+			RESULTSET& result, const num_t* query,
+			const nanoflann::SearchParams& params,
+			const std::vector<uint8_t>& removed) const
+		{
+			for (const auto& st : subtrees)
+			{
+				TSubTreeResultSet<RESULTSET> rs(result, st->dataset, removed);
+				st->index->findNeighbors(rs, query, params);
+			}
+		}
+
+		/** Like nanoflann's radiusSearch(), over all the sub-trees */
+		void radiusSearch(
+			const num_t* query, const num_t radius,
+			std::vector<std::pair<size_t, num_t>>& out_indices_dist,
+			const std::vector<uint8_t>& removed) const
+		{
+			nanoflann::RadiusResultSet<num_t, size_t> resultSet(
+				radius, out_indices_dist);
+			findNeighbors(
+				resultSet, query, nanoflann::SearchParams(), removed);
+			std::sort(
+				out_indices_dist.begin(), out_indices_dist.end(),
+				nanoflann::IndexDist_Sorter());
+		}
+
+		/** Brings the index up-to-date with the current data points:
+		 *  indexes new points only, merging sub-trees as needed; or rebuilds
+		 * everything if there are too many removed points. */
+		void update(
+			const Derived& data, const std::vector<uint8_t>& removed,
+			const size_t leaf_max_size)
+		{
+			const size_t N = data.kdtree_get_point_count();
+			if (N < m_num_indexed || m_num_dead > m_num_points)
+				clear();  // Full rebuild
+			if (N == m_num_indexed) return;  // Up-to-date
+
+			// Merge with the last sub-trees while they are not much larger
+			// than the new one:
+			size_t first = m_num_indexed;
+			while (!subtrees.empty() &&
+				   subtrees.back()->dataset.last - subtrees.back()->dataset.first <=
+					   2 * (N - first))
+			{
+				first = subtrees.back()->dataset.first;
+				m_num_dead -= subtrees.back()->num_dead;
+				subtrees.pop_back();
+			}
+
+			std::unique_ptr<TSubTree> st(new TSubTree);
+			TSubTreeDataset& ds = st->dataset;
+			ds.data = &data;
+			ds.first = first;
+			ds.last = N;
+			size_t nRemovedInRange = 0;
+			for (size_t i = first; i < N && i < removed.size(); i++)
+				if (removed[i]) nRemovedInRange++;
+			if (nRemovedInRange)
+			{
+				ds.ids.reserve(N - first - nRemovedInRange);
+				for (size_t i = first; i < N; i++)
+					if (i >= removed.size() || !removed[i]) ds.ids.push_back(i);
+			}
+			ds.is_whole_dataset = (first == 0 && !nRemovedInRange);
+
+			// Points already in the merged sub-trees were already counted:
+			m_num_points += (N - m_num_indexed);
+			for (size_t i = m_num_indexed; i < N && i < removed.size(); i++)
+				if (removed[i]) m_num_points--;
+			m_num_indexed = N;
+
+			if (ds.kdtree_get_point_count() == 0) return;
+			st->index.reset(
+				new kdtree_index_t(
+					m_dim, ds,
+					nanoflann::KDTreeSingleIndexAdaptorParams(leaf_max_size)));
+			st->index->buildIndex();
+			subtrees.push_back(std::move(st));
+		}
 	};
 
 	mutable TKDTreeDataHolder<2> m_kdtree2d_data;
 	mutable TKDTreeDataHolder<3> m_kdtree3d_data;
-	mutable TKDTreeDataHolder<> m_kdtreeNd_data;
 	/** whether the KD tree needs to be rebuilt or not. */
 	mutable bool m_kdtree_is_uptodate;
+	/** Tombstones: nonzero for points marked with kdtree_mark_as_removed() */
+	mutable std::vector<uint8_t> m_kdtree_removed;
 
-	/// Rebuild, if needed the KD-tree for 2D (nDims=2), 3D (nDims=3), ...
-	/// asking the child class for the data points.
-	void rebuild_kdTree_2D() const
+	/** Discards all indices and tombstones, if the data has changed */
+	void check_kdTree_uptodate() const
 	{
-		typedef typename TKDTreeDataHolder<2>::kdtree_index_t tree2d_t;
-
 		if (!m_kdtree_is_uptodate)
 		{
 			m_kdtree2d_data.clear();
 			m_kdtree3d_data.clear();
-			m_kdtreeNd_data.clear();
-		}
-
-		if (!m_kdtree2d_data.index)
-		{
-			// Erase previous tree:
-			m_kdtree2d_data.clear();
-			// And build new index:
-			const size_t N = derived().kdtree_get_point_count();
-			m_kdtree2d_data.m_num_points = N;
-			m_kdtree2d_data.m_dim = 2;
-			m_kdtree2d_data.query_point.resize(2);
-			if (N)
-			{
-				m_kdtree2d_data.index.reset(
-					new tree2d_t(
-						2, derived(), nanoflann::KDTreeSingleIndexAdaptorParams(
-										  kdtree_search_params.leaf_max_size)));
-				m_kdtree2d_data.index->buildIndex();
-			}
+			m_kdtree_removed.clear();
 			m_kdtree_is_uptodate = true;
 		}
 	}
 
 	/// Rebuild, if needed the KD-tree for 2D (nDims=2), 3D (nDims=3), ...
 	/// asking the child class for the data points.
-	void rebuild_kdTree_3D() const
+	void rebuild_kdTree_2D() const
 	{
-		typedef typename TKDTreeDataHolder<3>::kdtree_index_t tree3d_t;
-
-		if (!m_kdtree_is_uptodate)
-		{
-			m_kdtree2d_data.clear();
-			m_kdtree3d_data.clear();
-			m_kdtreeNd_data.clear();
-		}
+		check_kdTree_uptodate();
+		m_kdtree2d_data.update(
+			derived(), m_kdtree_removed, kdtree_search_params.leaf_max_size);
+	}
 
-		if (!m_kdtree3d_data.index)
-		{
-			// Erase previous tree:
-			m_kdtree3d_data.clear();
-			// And build new index:
-			const size_t N = derived().kdtree_get_point_count();
-			m_kdtree3d_data.m_num_points = N;
-			m_kdtree3d_data.m_dim = 3;
-			m_kdtree3d_data.query_point.resize(3);
-			if (N)
-			{
-				m_kdtree3d_data.index.reset(
-					new tree3d_t(
-						3, derived(), nanoflann::KDTreeSingleIndexAdaptorParams(
-										  kdtree_search_params.leaf_max_size)));
-				m_kdtree3d_data.index->buildIndex();
-			}
-			m_kdtree_is_uptodate = true;
-		}
+	/// Rebuild, if needed the KD-tree for 2D (nDims=2), 3D (nDims=3), ...
+	/// asking the child class for the data points.
+	void rebuild_kdTree_3D() const
+	{
+		check_kdTree_uptodate();
+		m_kdtree3d_data.update(
+			derived(), m_kdtree_removed, kdtree_search_params.leaf_max_size);
 	}
 
 };  // end of KDTreeCapable
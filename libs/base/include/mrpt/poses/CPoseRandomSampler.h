@@ -19,6 +19,10 @@
 
 namespace mrpt
 {
+namespace random
+{
+class CRandomGenerator;
+}
 namespace poses
 {
 /** An efficient generator of random samples drawn from a given 2D (CPosePDF) or
@@ -60,9 +64,9 @@ class CPoseRandomSampler
 	void clear();
 
 	/** Used internally: sample from m_pdf2D */
-	void do_sample_2D(CPose2D& p) const;
+	void do_sample_2D(CPose2D& p, mrpt::random::CRandomGenerator& rng) const;
 	/** Used internally: sample from m_pdf3D */
-	void do_sample_3D(CPose3D& p) const;
+	void do_sample_3D(CPose3D& p, mrpt::random::CRandomGenerator& rng) const;
 
    public:
 	/** Default constructor */
@@ -113,6 +117,18 @@ class CPoseRandomSampler
 	  */
 	CPose3D& drawSample(CPose3D& p) const;
 
+	/** Like drawSample(CPose2D&), but drawing random numbers from the given
+	 * generator instead of the global one, so that several threads can draw
+	 * samples at once, each with its own independent random stream.
+	 * This method is thread-safe as long as each thread uses a different
+	 * `rng` and the PDF is not modified meanwhile.
+	 * \sa mrpt::random::getRandomGenerator()
+	 */
+	CPose2D& drawSample(CPose2D& p, mrpt::random::CRandomGenerator& rng) const;
+
+	/** \overload */
+	CPose3D& drawSample(CPose3D& p, mrpt::random::CRandomGenerator& rng) const;
+
 	/** Return true if samples can be generated, which only requires a previous
 	 * call to setPosePDF */
 	bool isPrepared() const;
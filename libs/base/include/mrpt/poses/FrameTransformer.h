@@ -9,11 +9,14 @@
 #pragma once
 
 #include <mrpt/system/datetime.h>
-#include <mrpt/utils/aligned_containers.h>
-//#include <mrpt/poses/CPose3DInterpolator.h>
 #include <mrpt/poses/SE_traits.h>
-#include <string>
+#include <atomic>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace mrpt
 {
@@ -85,6 +88,30 @@ class FrameTransformerInterface
 
 /** See docs in FrameTransformerInterface.
 *   This class is an implementation for standalone (non ROS) applications.
+*
+* Frames form a tree (or a forest): each frame may have one parent, set by
+* the last sendTransform() where it appeared as `child_frame`.
+* lookupTransform() composes the chain of transforms between any two frames
+* of the same tree.
+*
+* A bounded history of the latest transforms (see getHistoryLength()) is
+* kept for each parent-child pair, such that lookups can be done for any
+* time within the stored history, interpolating between the two closest
+* transforms (linear interpolation in SE(2), SLERP in SE(3)). Publishing a
+* transform with `timestamp=INVALID_TIMESTAMP` makes it a "static" one,
+* valid at any time.
+*
+* Frame names are mapped to integer IDs (see getFrameID()), which can be
+* used instead of strings in the time-critical overloads of sendTransform()
+* and lookupTransform().
+*
+* Thread safety: all methods can be invoked from different threads at once.
+* Look-ups never block: the frames tree is kept as an immutable snapshot
+* replaced by writers when a frame or a parent-child edge is added (RCU-like),
+* and the history of each edge is a ring buffer protected by a sequence
+* lock, so readers just retry in the rare event of reading while a new
+* transform is being published for that same edge.
+*
 * \ingroup poses_grp
 * \sa FrameTransformerInterface
 */
@@ -93,9 +120,16 @@ class FrameTransformer : public FrameTransformerInterface<DIM>
 {
    public:
 	typedef FrameTransformerInterface<DIM> base_t;
+	/** Integer IDs of frames */
+	typedef uint32_t frame_id_t;
+	static const frame_id_t INVALID_FRAME_ID = static_cast<frame_id_t>(-1);
 
-	FrameTransformer();
+	/** \param[in] historyLength Maximum number of transforms kept in the
+	 * history of each parent-child pair (>=1) */
+	FrameTransformer(const size_t historyLength = 100);
 	~FrameTransformer();
+	FrameTransformer(const FrameTransformer&) = delete;
+	FrameTransformer& operator=(const FrameTransformer&) = delete;
 
 	// See base docs
 	virtual void sendTransform(
@@ -125,31 +159,87 @@ class FrameTransformer : public FrameTransformerInterface<DIM>
 		return ret;
 	}
 
-   protected:
-	// double m_max_extrapolation_time;  //!< for extrapolation in the past or
-	// in the future [s]
-	// double m_max_age_pose_cache;      //!< Max age of stored poses [s]
+	/** \overload Publishes a transform between frames given by their IDs
+	 * \exception std::exception If the IDs are unknown, or if the new edge
+	 * would create a loop in the frames tree. */
+	void sendTransform(
+		const frame_id_t parent_frame, const frame_id_t child_frame,
+		const typename base_t::pose_t& child_wrt_parent,
+		const mrpt::system::TTimeStamp& timestamp = mrpt::system::now());
 
-	struct TF_TreeEdge
+	/** \overload Looks up the pose of `target_frame` wrt `source_frame`,
+	 * given their IDs. If `query_time` is INVALID_TIMESTAMP, the latest
+	 * transform of each parent-child pair in the chain is used. */
+	FrameLookUpStatus lookupTransform(
+		const frame_id_t target_frame, const frame_id_t source_frame,
+		typename base_t::lightweight_pose_t& child_wrt_parent,
+		const mrpt::system::TTimeStamp query_time = INVALID_TIMESTAMP) const;
+
+	/** Returns the ID of a frame, registering it if it did not exist yet */
+	frame_id_t getFrameID(const std::string& frame_name);
+	/** Returns the ID of a frame, or INVALID_FRAME_ID if it is unknown */
+	frame_id_t findFrameID(const std::string& frame_name) const;
+	/** Returns the name of a frame given its ID \exception std::exception If
+	 * the ID is unknown */
+	std::string getFrameName(const frame_id_t id) const;
+	/** Maximum number of transforms kept for each parent-child pair */
+	size_t getHistoryLength() const { return m_history_length; }
+
+   protected:
+	struct TStampedPose
 	{
-		// TODO: CPose{2,3}DInterpolator?
-		typename base_t::pose_t pose;
+		typename base_t::lightweight_pose_t pose;
 		mrpt::system::TTimeStamp timestamp;
+	};
 
-		TF_TreeEdge(
-			const typename base_t::pose_t& pose_,
-			const mrpt::system::TTimeStamp& timestamp_)
-			: pose(pose_), timestamp(timestamp_)
+	/** Ring buffer with the history of transforms of one child frame wrt its
+	 * parent, sorted by timestamp. It is written under m_write_mtx, and read
+	 * without locks using the sequence number `seq`, which is odd while
+	 * the buffer is being modified. */
+	struct TEdgeHistory
+	{
+		TEdgeHistory(const size_t capacity)
+			: ring(capacity), seq(0), first(0), count(0)
 		{
 		}
-		TF_TreeEdge() : timestamp(INVALID_TIMESTAMP) {}
+		/** Adds a transform, keeping the buffer sorted by timestamp */
+		void insert(const TStampedPose& p);
+		/** Returns the transform at time `t`, interpolating if needed, or the
+		 * latest one for `t=INVALID_TIMESTAMP` */
+		FrameLookUpStatus poseAt(
+			const mrpt::system::TTimeStamp t,
+			typename base_t::lightweight_pose_t& out) const;
+
+		std::vector<TStampedPose> ring;
+		std::atomic<uint64_t> seq;
+		/** Index in `ring` of the oldest transform, and number of them */
+		std::atomic<size_t> first, count;
+	};
+
+	struct TFrame
+	{
+		std::string name;
+		frame_id_t parent = INVALID_FRAME_ID;
+		/** The history of this frame wrt its parent (empty for roots) */
+		std::shared_ptr<TEdgeHistory> edge;
+		/** Cached chain of frames from this one up to the root of its tree,
+		 * both included */
+		std::vector<frame_id_t> chain_to_root;
+	};
+
+	/** An immutable snapshot of all frames and the edges between them */
+	struct TFramesTree
+	{
+		/** Indexed by frame_id_t */
+		std::vector<TFrame> frames;
+		std::map<std::string, frame_id_t> ids;
 	};
 
-	// map: [parent] -> { [child] -> relPoseChildWRTParent }
-	typedef std::map<std::string, typename mrpt::aligned_containers<
-									  std::string, TF_TreeEdge>::map_t>
-		pose_tree_t;
-	pose_tree_t m_pose_edges_buffer;
+	const size_t m_history_length;
+	/** The current frames tree, which readers get with std::atomic_load() */
+	std::shared_ptr<const TFramesTree> m_tree;
+	/** Serializes writers */
+	std::mutex m_write_mtx;
 };
 
 }  // ns
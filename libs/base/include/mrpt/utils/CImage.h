@@ -15,6 +15,8 @@
 #include <mrpt/utils/CCanvas.h>
 #include <mrpt/utils/TCamera.h>
 #include <mrpt/utils/exceptions.h>
+#include <atomic>
+#include <mutex>
 
 // Add for declaration of mexplus::from template specialization
 DECLARE_MEXPLUS_FROM(mrpt::utils::CImage)
@@ -232,6 +234,15 @@ class CImage : public mrpt::utils::CSerializable, public CCanvas
 	  *  (Default = 95) */
 	static int SERIALIZATION_JPEG_QUALITY;
 
+	/** By default, images read through the CSerializable interface keep their
+	 * encoded (JPEG, ZIP or raw) data as read from the stream, and only decode
+	 * it on the first access to their pixels. Until then, they take just the
+	 * memory of the encoded data and are serialized again by copying it as is.
+	 * See isCompressedResident(). Set this flag to true to always decode
+	 * images while reading them.
+	  *  (Default = false) */
+	static bool DISABLE_LAZY_DECODING;
+
 	/** @} */
 
 	// ================================================================
@@ -796,9 +807,10 @@ class CImage : public mrpt::utils::CSerializable, public CCanvas
 		return tmp;
 	}
 
-	/** For external storage image objects only, this method makes sure the
-	 * image is loaded in memory. Note that usually images are loaded on-the-fly
-	 * on first access and there's no need to call this.
+	/** For external storage or compressed-resident image objects only, this
+	 * method makes sure the image is loaded (decoded) in memory. Note that
+	 * usually images are loaded on-the-fly on first access and there's no need
+	 * to call this.
 	  * \unload
 	  */
 	inline void forceLoad() const { makeSureImageIsLoaded(); }
@@ -812,6 +824,20 @@ class CImage : public mrpt::utils::CSerializable, public CCanvas
 	  */
 	void unload() const noexcept;
 
+	/** Returns true if this image was read from a stream and still holds its
+	 * data in the serialized, encoded form (JPEG, ZIP or raw bytes), which
+	 * will be decoded on the first access to its pixels. Its size and number
+	 * of channels are known without decoding it, and it can be serialized
+	 * again without a decode/encode round trip. Copies of such an image share
+	 * the encoded data. Decoding is thread-safe: the pixels of the same image
+	 * can be accessed for the first time from several threads at once, and
+	 * only one of them decodes it (unlike externally stored images).
+	  * \sa DISABLE_LAZY_DECODING, forceLoad */
+	bool isCompressedResident() const noexcept
+	{
+		return m_compressedResident.load(std::memory_order_acquire);
+	}
+
 	/** @}  */
 	// ================================================================
 
@@ -1086,6 +1112,23 @@ class CImage : public mrpt::utils::CSerializable, public CCanvas
 	/** The file name of a external storage image. */
 	mutable std::string m_externalFile;
 
+	/** The encoded image of a compressed-resident image, as found in its
+	 * serialized form \sa isCompressedResident */
+	struct TCompressedImage
+	{
+		int32_t width, height;
+		bool color, originTopLeft;
+		/** Everything serialized after the external storage flag */
+		std::vector<uint8_t> data;
+	};
+	mutable std::shared_ptr<const TCompressedImage> m_compressed;
+	/** Whether m_compressed is still to be decoded into img. The encoded
+	 * image is kept after decoding it (until the image is released), so
+	 * threads which saw it not decoded yet can still read its header. */
+	mutable std::atomic<bool> m_compressedResident{false};
+	/** Serializes the decoding of m_compressed */
+	mutable std::mutex m_decode_mtx;
+
 	/** @} */
 
 	/**  Resize the buffers in "img" to accomodate a new image size and/or
@@ -1103,6 +1146,15 @@ class CImage : public mrpt::utils::CSerializable, public CCanvas
 	 * \exception CExceptionExternalImageNotFound */
 	void makeSureImageIsLoaded() const;
 
+	/** Reads the pixels, as serialized after the external storage flag */
+	void readImageContents(mrpt::utils::CStream& in, int version);
+	/** Reads the serialized pixels into m_compressed, without decoding them.
+	 * Only for serialization versions >=7. */
+	void readCompressedImage(mrpt::utils::CStream& in);
+	/** Decodes m_compressed into img, once, even if called from several
+	 * threads at once. */
+	void decodeCompressedImage() const;
+
 };  // End of class
 }  // end of namespace utils
 }  // end of namespace mrpt
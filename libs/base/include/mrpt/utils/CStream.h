@@ -17,6 +17,7 @@
 #include <mrpt/utils/variant.h>
 
 #include <mrpt/otherlibs/mapbox/variant.hpp>
+#include <unordered_map>
 #include <vector>
 #include <type_traits>  // remove_reference_t
 
@@ -35,6 +36,12 @@ class CMessage;
  *    can be directly written and read to and from any CStream easily.
  *  Please, it is recomendable to read CSerializable documentation also.
  *
+ * Each object written with WriteObject() is preceded by the name of its
+ * class. Streams with many small objects may enable the class dictionary
+ * mode instead (see enableClassDictionary()), where each class name is
+ * written only once per stream and later objects only store a short ID.
+ * Objects in both formats are read transparently.
+ *
  * \ingroup mrpt_base_grp
  * \sa CFileStream, CMemoryStream,CSerializable
  */
@@ -61,17 +68,29 @@ class CStream
 
 	/** Read the object */
 	void internal_ReadObject(
-		CSerializable* newObj, const std::string& className, bool isOldFormat,
-		int8_t version);
+		CSerializable* newObj, const TRuntimeClassId* classId,
+		bool isOldFormat, int8_t version);
+
+	/** Read the object Header.
+	 * \return The class of the stored object, or nullptr for a nullptr.
+	 * \exception std::exception If the class is not registered. */
+	const TRuntimeClassId* internal_ReadObjectHeader(
+		bool& isOldFormat, int8_t& version);
 
-	/** Read the object Header*/
-	void internal_ReadObjectHeader(
-		std::string& className, bool& isOldFormat, int8_t& version);
+   private:
+	/** Whether WriteObject() uses the class dictionary */
+	bool m_class_dict_enabled;
+	/** Class dictionary for writing: class (nullptr for nullptr objects)
+	 * to ID */
+	std::unordered_map<const TRuntimeClassId*, uint32_t> m_class_dict_write;
+	/** Class dictionary for reading: ID to class (nullptr for nullptr
+	 * objects), and whether that ID has been defined already */
+	std::vector<std::pair<const TRuntimeClassId*, bool>> m_class_dict_read;
 
    public:
 	/* Constructor
 	 */
-	CStream() {}
+	CStream() : m_class_dict_enabled(false) {}
 	/* Destructor
 	 */
 	virtual ~CStream();
@@ -192,7 +211,35 @@ class CStream
 	 */
 	virtual uint64_t getPosition() = 0;
 
+	/** Enables or disables the class dictionary mode (default: disabled) for
+	 * the objects written from now on: the first object of each class writes
+	 * its class name and assigns it an ID, and the following objects of the
+	 * same class only write that ID (1-2 bytes). This saves most of the
+	 * per-object header in streams of many small objects (e.g. rawlogs of
+	 * IMU or odometry observations), and the look-up of the class by its
+	 * name while reading them.
+	 *
+	 * Reading does not need any setting: objects written in either mode can
+	 * be read by any stream. However, objects written in this mode can only
+	 * be read after reading (or seeking back over) the first object of their
+	 * class, so a reader cannot start at arbitrary positions of the stream.
+	 * Use resetClassDictionary() at the same points while writing and
+	 * reading to split the stream into independent parts.
+	 * \note [New in MRPT 2.0.0]
+	 * \sa resetClassDictionary
+	 */
+	void enableClassDictionary(bool enable = true)
+	{
+		m_class_dict_enabled = enable;
+	}
+	/** \sa enableClassDictionary */
+	bool isClassDictionaryEnabled() const { return m_class_dict_enabled; }
+	/** Forgets all the class IDs written to or read from this stream so far.
+	 * \sa enableClassDictionary */
+	void resetClassDictionary();
+
 	/** Writes an object to the stream.
+	 * \sa enableClassDictionary
 	 */
 	void WriteObject(const CSerializable* o);
 	void WriteObject(const CSerializable& o) { WriteObject(&o); }
@@ -217,17 +264,14 @@ class CStream
 	typename T::Ptr ReadObject()
 	{
 		CSerializable::Ptr obj;
-		std::string strClassName;
 		bool isOldFormat;
 		int8_t version;
-		internal_ReadObjectHeader(strClassName, isOldFormat, version);
-		if (strClassName != "nullptr")
-		{
-			const TRuntimeClassId* classId = findRegisteredClass(strClassName);
+		const TRuntimeClassId* classId =
+			internal_ReadObjectHeader(isOldFormat, version);
+		if (classId)
 			obj.reset(dynamic_cast<CSerializable*>(classId->createObject()));
-		}
 		internal_ReadObject(
-			obj.get() /* may be nullptr */, strClassName, isOldFormat,
+			obj.get() /* may be nullptr */, classId, isOldFormat,
 			version);  // must be called to read the END FLAG byte
 		if (!obj)
 		{
@@ -282,20 +326,13 @@ class CStream
 	typename mrpt::utils::variant<T...> ReadVariant()
 	{
 		CSerializable::Ptr obj;
-		std::string strClassName;
 		bool isOldFormat;
 		int8_t version;
-		internal_ReadObjectHeader(strClassName, isOldFormat, version);
-		const TRuntimeClassId* classId = findRegisteredClass(strClassName);
-		if (!classId)
-			THROW_EXCEPTION_FMT(
-				"Stored object has class '%s' which is not registered!",
-				strClassName.c_str())
-		if (strClassName != "nullptr")
-		{
+		const TRuntimeClassId* classId =
+			internal_ReadObjectHeader(isOldFormat, version);
+		if (classId)
 			obj.reset(dynamic_cast<CSerializable*>(classId->createObject()));
-		}
-		internal_ReadObject(obj.get(), strClassName, isOldFormat, version);
+		internal_ReadObject(obj.get(), classId, isOldFormat, version);
 		if (!obj)
 		{
 			return mrpt::utils::variant<T...>();
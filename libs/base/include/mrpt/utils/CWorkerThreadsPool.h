@@ -0,0 +1,178 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+#ifndef CWorkerThreadsPool_H
+#define CWorkerThreadsPool_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace mrpt
+{
+namespace utils
+{
+/** A simple pool of persistent worker threads, which run the tasks enqueued
+ * with enqueue() in FIFO order. Threads are created once (at construction or
+ * by resize()) and kept alive until clear() or destruction, so the cost of
+ * thread creation is not paid again for each parallel job.
+ *
+ * Besides enqueueing arbitrary tasks, parallelChunks() offers a blocking
+ * "parallel for" over an index range, split into contiguous chunks in a
+ * deterministic way (i.e. the chunk boundaries only depend on the range
+ * length and the number of threads), which is useful for reproducible
+ * results.
+ *
+ *  Usage example:
+ * \code
+ *  mrpt::utils::CWorkerThreadsPool pool(4);
+ *  auto fut = pool.enqueue([](int a, int b) { return a + b; }, 2, 3);
+ *  int r = fut.get();  // r=5
+ *
+ *  std::vector<double> v(1000);
+ *  pool.parallelChunks(
+ *     v.size(), [&](size_t first, size_t last, size_t chunkIdx) {
+ *        for (size_t i = first; i < last; i++) v[i] = std::sqrt(i);
+ *     });
+ * \endcode
+ *
+ * \ingroup mrpt_base_grp
+ */
+class CWorkerThreadsPool
+{
+   public:
+	/** Creates a pool with `num_threads` threads. Zero means no threads: all
+	 * tasks will be run synchronously in the caller thread. */
+	explicit CWorkerThreadsPool(std::size_t num_threads = 0);
+	/** Waits for all pending tasks to be done and stops all threads */
+	~CWorkerThreadsPool();
+
+	CWorkerThreadsPool(const CWorkerThreadsPool&) = delete;
+	CWorkerThreadsPool& operator=(const CWorkerThreadsPool&) = delete;
+
+	/** Waits for all pending tasks, then changes the number of threads. */
+	void resize(std::size_t num_threads);
+
+	/** Waits for all pending tasks to be done and stops all threads. */
+	void clear();
+
+	/** Number of worker threads (0: tasks run in the caller thread) */
+	std::size_t size() const { return m_threads.size(); }
+
+	/** Number of enqueued tasks not yet started */
+	std::size_t pendingTasks() const;
+
+	/** Enqueues a new task, returning a std::future for its result.
+	 * If the pool has no threads, the task is run immediately. */
+	template <class F, class... Args>
+	auto enqueue(F&& f, Args&&... args)
+		-> std::future<typename std::result_of<F(Args...)>::type>
+	{
+		using return_type = typename std::result_of<F(Args...)>::type;
+
+		auto task = std::make_shared<std::packaged_task<return_type()>>(
+			std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+
+		std::future<return_type> res = task->get_future();
+		if (m_threads.empty())
+		{
+			(*task)();
+			return res;
+		}
+		{
+			std::unique_lock<std::mutex> lock(m_queue_mutex);
+			m_tasks.emplace([task]() { (*task)(); });
+		}
+		m_condition.notify_one();
+		return res;
+	}
+
+	/** Runs `f(first, last, chunkIndex)` over [0,N) split into at most
+	 * `max(1,size())` contiguous chunks of (almost) equal length, and blocks
+	 * until all of them are done. The chunk with index 0 is run in the caller
+	 * thread. Exceptions thrown by `f` are rethrown here, once all chunks
+	 * have finished.
+	 * \note Do not call this from within a task running in this same pool,
+	 * since it may deadlock waiting for its own workers.
+	 * \return The number of chunks actually used.
+	 */
+	template <class FUNCTOR>
+	std::size_t parallelChunks(std::size_t N, FUNCTOR&& f)
+	{
+		const std::size_t nChunks = numChunksFor(N);
+		if (nChunks <= 1)
+		{
+			if (N) f(std::size_t(0), N, std::size_t(0));
+			return N ? 1 : 0;
+		}
+		std::vector<std::future<void>> futs;
+		futs.reserve(nChunks - 1);
+		for (std::size_t c = 1; c < nChunks; c++)
+			futs.emplace_back(enqueue(
+				[&f, c, N, nChunks]() {
+					f(chunkStart(N, nChunks, c), chunkStart(N, nChunks, c + 1),
+					  c);
+				}));
+		std::exception_ptr err;
+		try
+		{
+			f(std::size_t(0), chunkStart(N, nChunks, 1), std::size_t(0));
+		}
+		catch (...)
+		{
+			err = std::current_exception();
+		}
+		for (auto& fut : futs)
+		{
+			try
+			{
+				fut.get();
+			}
+			catch (...)
+			{
+				if (!err) err = std::current_exception();
+			}
+		}
+		if (err) std::rethrow_exception(err);
+		return nChunks;
+	}
+
+	/** The number of chunks parallelChunks() will use for N items */
+	std::size_t numChunksFor(std::size_t N) const
+	{
+		const std::size_t n = m_threads.empty() ? 1 : m_threads.size();
+		return N < n ? N : n;
+	}
+
+	/** First index of chunk `c` out of `nChunks` over [0,N) */
+	static std::size_t chunkStart(
+		std::size_t N, std::size_t nChunks, std::size_t c)
+	{
+		return (N * c) / nChunks;
+	}
+
+   private:
+	std::vector<std::thread> m_threads;
+	std::queue<std::function<void()>> m_tasks;
+	mutable std::mutex m_queue_mutex;
+	std::condition_variable m_condition;
+	bool m_do_stop;
+
+	void workerThreadLoop();
+};
+
+}  // End of namespace
+}  // End of namespace
+#endif
@@ -0,0 +1,53 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+#ifndef CWorkerThreadsPoolHolder_H
+#define CWorkerThreadsPoolHolder_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+namespace mrpt
+{
+namespace utils
+{
+class CWorkerThreadsPool;
+
+/** Owns a CWorkerThreadsPool created on demand. It is meant to be a member of
+ * options structures with a number of threads field, so the threads are not
+ * created again in each call to the algorithm.
+ *
+ * Copying or assigning a holder neither copies nor shares its pool: the
+ * target is left empty and creates its own pool when first needed. Hence,
+ * different copies of the same options can be used from different threads.
+ *
+ * \ingroup mrpt_base_grp
+ */
+class CWorkerThreadsPoolHolder
+{
+   public:
+	CWorkerThreadsPoolHolder();
+	CWorkerThreadsPoolHolder(const CWorkerThreadsPoolHolder&);
+	CWorkerThreadsPoolHolder& operator=(const CWorkerThreadsPoolHolder& o);
+	~CWorkerThreadsPoolHolder();
+
+	/** Returns a pool with `num_threads` threads, or nullptr if
+	 * `num_threads<=1`. The pool is created in the first call, and a new one
+	 * replaces it if a later call asks for a different number of threads
+	 * (the returned pointer is only valid until then). */
+	CWorkerThreadsPool* get(std::size_t num_threads) const;
+
+   private:
+	mutable std::unique_ptr<CWorkerThreadsPool> m_pool;
+	mutable std::mutex m_pool_mutex;
+};
+
+}  // End of namespace
+}  // End of namespace
+#endif
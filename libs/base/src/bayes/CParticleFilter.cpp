@@ -111,7 +111,8 @@ CParticleFilter::TParticleFilterOptions::TParticleFilterOptions()
 	  resamplingMethod(prMultinomial),
 	  max_loglikelihood_dyn_range(15),
 	  pfAuxFilterStandard_FirstStageWeightsMonteCarlo(false),
-	  pfAuxFilterOptimal_MLE(false)
+	  pfAuxFilterOptimal_MLE(false),
+	  numThreads(1)
 {
 }
 
@@ -149,6 +150,10 @@ void CParticleFilter::TParticleFilterOptions::saveToConfigFile(
 		pfAuxFilterStandard_FirstStageWeightsMonteCarlo,
 		"Only for PF_algorithm==pfAuxiliaryPFStandard");
 	MRPT_SAVE_CONFIG_VAR_COMMENT(pfAuxFilterOptimal_MLE, "See doxygen docs.");
+	MRPT_SAVE_CONFIG_VAR_COMMENT(
+		numThreads,
+		"Number of threads for motion sampling and particle weighting "
+		"(default=1)");
 }
 
 /*---------------------------------------------------------------
@@ -191,6 +196,7 @@ void CParticleFilter::TParticleFilterOptions::loadFromConfigFile(
 		section.c_str());
 	MRPT_LOAD_CONFIG_VAR(
 		pfAuxFilterOptimal_MLE, bool, iniFile, section.c_str());
+	MRPT_LOAD_CONFIG_VAR(numThreads, int, iniFile, section.c_str());
 
 	MRPT_END
 }
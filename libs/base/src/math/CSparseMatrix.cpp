@@ -274,6 +274,16 @@ void CSparseMatrix::compressFromTriplet()
 	// internal buffers, now set to NULL.
 }
 
+int CSparseMatrix::getColumnCompressedIndex(
+	const size_t row, const size_t col) const
+{
+	ASSERT_(isColumnCompressed())
+	ASSERT_BELOW_(col, size_t(sparse_matrix.n))
+	for (int p = sparse_matrix.p[col]; p < sparse_matrix.p[col + 1]; p++)
+		if (sparse_matrix.i[p] == int(row)) return p;
+	return -1;
+}
+
 /** save as a dense matrix to a text file \return False on any error.
 */
 bool CSparseMatrix::saveToTextFile_dense(const std::string& filName)
@@ -371,8 +381,12 @@ CSparseMatrix::CholeskyDecomp::CholeskyDecomp(const CSparseMatrix& SM)
 		cs_chol(&m_originalSM->sparse_matrix, m_symbolic_structure);
 
 	if (!m_numeric_structure)
+	{
+		// The destructor won't be called:
+		cs_sfree(m_symbolic_structure);
 		throw mrpt::math::CExceptionNotDefPos(
 			"CSparseMatrix::CholeskyDecomp: Not positive definite matrix.");
+	}
 }
 
 // Destructor:
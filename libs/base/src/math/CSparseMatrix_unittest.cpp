@@ -100,6 +100,38 @@ TEST(SparseMatrix, InitFromTriplet)
 	EXPECT_TRUE(dense_out1 == dense_out2);
 }
 
+TEST(SparseMatrix, UpdateValuesInPlace)
+{
+	CSparseMatrix SM(10, 20);
+	SM.insert_entry(2, 2, 4.0);
+	SM.insert_entry(6, 8, -2.0);
+	SM.insert_entry(1, 8, 0.0);
+	SM.compressFromTriplet();
+	EXPECT_EQ(SM.getNonZeroCount(), 3u);
+
+	const int idx22 = SM.getColumnCompressedIndex(2, 2);
+	const int idx68 = SM.getColumnCompressedIndex(6, 8);
+	const int idx18 = SM.getColumnCompressedIndex(1, 8);
+	ASSERT_GE(idx22, 0);
+	ASSERT_GE(idx68, 0);
+	ASSERT_GE(idx18, 0);
+	EXPECT_EQ(SM.getColumnCompressedIndex(2, 8), -1);
+	EXPECT_EQ(SM.getColumnCompressedIndex(0, 0), -1);
+
+	double* vals = SM.getValuesPtr();
+	EXPECT_EQ(vals[idx22], 4.0);
+	EXPECT_EQ(vals[idx68], -2.0);
+	vals[idx22] = 1.0;
+	vals[idx18] = 3.0;
+
+	CMatrixDouble D;
+	SM.get_dense(D);
+	EXPECT_EQ(D(2, 2), 1.0);
+	EXPECT_EQ(D(1, 8), 3.0);
+	EXPECT_EQ(D(6, 8), -2.0);
+	EXPECT_EQ(D.array().abs().sum(), 6.0);
+}
+
 TEST(SparseMatrix, InitFromSparse)
 {
 	CMatrixDouble D(4, 5);
@@ -0,0 +1,153 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/math/KDTreeCapable.h>
+#include <mrpt/random.h>
+#include <gtest/gtest.h>
+#include <limits>
+
+using namespace mrpt;
+using namespace mrpt::math;
+using namespace mrpt::random;
+using namespace std;
+
+// A minimal point cloud, to test the KD-tree index in isolation:
+class TestPointCloud : public KDTreeCapable<TestPointCloud>
+{
+   public:
+	std::vector<TPoint3Df> pts;
+
+	void append(const TPoint3Df& p)
+	{
+		pts.push_back(p);
+		kdtree_mark_as_appended();
+	}
+	void remove(size_t idx) { kdtree_mark_as_removed(idx); }
+	void modify(size_t idx, const TPoint3Df& p)
+	{
+		pts[idx] = p;
+		kdtree_mark_as_outdated();
+	}
+	bool isRemoved(size_t idx) const { return kdtree_is_removed(idx); }
+	// KDTreeCapable interface:
+	inline size_t kdtree_get_point_count() const { return pts.size(); }
+	inline float kdtree_get_pt(const size_t idx, int dim) const
+	{
+		return dim == 0 ? pts[idx].x : (dim == 1 ? pts[idx].y : pts[idx].z);
+	}
+	inline float kdtree_distance(
+		const float* p1, const size_t idx_p2, size_t size) const
+	{
+		float d = 0;
+		for (size_t i = 0; i < size; i++)
+			d += square(p1[i] - kdtree_get_pt(idx_p2, i));
+		return d;
+	}
+	template <typename BBOX>
+	bool kdtree_get_bbox(BBOX& bb) const
+	{
+		return false;
+	}
+};
+
+static float bruteForceClosestSqr(
+	const TestPointCloud& pc, const TPoint3Df& q, size_t dims)
+{
+	float best = std::numeric_limits<float>::max();
+	for (size_t i = 0; i < pc.pts.size(); i++)
+	{
+		if (pc.isRemoved(i)) continue;
+		float d = square(pc.pts[i].x - q.x) + square(pc.pts[i].y - q.y);
+		if (dims == 3) d += square(pc.pts[i].z - q.z);
+		best = std::min(best, d);
+	}
+	return best;
+}
+
+static TPoint3Df randomPoint()
+{
+	auto& rnd = getRandomGenerator();
+	return TPoint3Df(
+		rnd.drawUniform(-10.0, 10.0), rnd.drawUniform(-10.0, 10.0),
+		rnd.drawUniform(-10.0, 10.0));
+}
+
+static void checkQueries(const TestPointCloud& pc)
+{
+	for (int k = 0; k < 50; k++)
+	{
+		const TPoint3Df q = randomPoint();
+		float d2, d3;
+		const size_t i2 = pc.kdTreeClosestPoint2D(q.x, q.y, d2);
+		const size_t i3 = pc.kdTreeClosestPoint3D(q.x, q.y, q.z, d3);
+		EXPECT_FALSE(pc.isRemoved(i2));
+		EXPECT_FALSE(pc.isRemoved(i3));
+		EXPECT_NEAR(d2, bruteForceClosestSqr(pc, q, 2), 1e-4f);
+		EXPECT_NEAR(d3, bruteForceClosestSqr(pc, q, 3), 1e-4f);
+
+		std::vector<std::pair<size_t, float>> found;
+		const float R2 = 4.0f;
+		pc.kdTreeRadiusSearch3D(q.x, q.y, q.z, R2, found);
+		size_t nExpected = 0;
+		for (size_t i = 0; i < pc.pts.size(); i++)
+			if (!pc.isRemoved(i) && square(pc.pts[i].x - q.x) +
+											square(pc.pts[i].y - q.y) +
+											square(pc.pts[i].z - q.z) <
+										R2)
+				nExpected++;
+		EXPECT_EQ(found.size(), nExpected);
+		for (size_t i = 1; i < found.size(); i++)
+			EXPECT_LE(found[i - 1].second, found[i].second);
+	}
+}
+
+TEST(KDTreeCapable, IncrementalAppend)
+{
+	getRandomGenerator().randomize(123);
+	TestPointCloud pc;
+	// Grow the cloud in small batches, querying in between, so most queries
+	// run over several sub-trees:
+	for (int batch = 0; batch < 40; batch++)
+	{
+		const size_t n = 1 + (batch % 7) * 20;
+		for (size_t i = 0; i < n; i++) pc.append(randomPoint());
+		checkQueries(pc);
+	}
+	// A change in existing points forces a full rebuild:
+	pc.modify(0, TPoint3Df(100, 100, 100));
+	float d;
+	EXPECT_EQ(pc.kdTreeClosestPoint3D(99, 99, 99, d), 0u);
+	checkQueries(pc);
+}
+
+TEST(KDTreeCapable, RemoveWithTombstones)
+{
+	getRandomGenerator().randomize(321);
+	TestPointCloud pc;
+	for (size_t i = 0; i < 500; i++) pc.append(randomPoint());
+	checkQueries(pc);
+
+	// Remove points one by one, checking that they are never returned
+	// (including after the automatic rebuild once most are removed):
+	for (int iter = 0; iter < 8; iter++)
+	{
+		for (size_t i = 0; i < 50; i++)
+			pc.remove(getRandomGenerator().drawUniform32bit() % pc.pts.size());
+		for (size_t i = 0; i < 30; i++) pc.append(randomPoint());
+		checkQueries(pc);
+	}
+
+	// Removing a point exactly at the query location:
+	pc.append(TPoint3Df(50, 50, 50));
+	float d;
+	const size_t idx = pc.kdTreeClosestPoint3D(50, 50, 50, d);
+	EXPECT_EQ(idx, pc.pts.size() - 1);
+	pc.remove(idx);
+	EXPECT_NE(pc.kdTreeClosestPoint3D(50, 50, 50, d), idx);
+}
@@ -206,17 +206,23 @@ void CPoseRandomSampler::setPosePDF(const CPosePDF::Ptr& pdf)
 					drawSample
   ---------------------------------------------------------------*/
 CPose2D& CPoseRandomSampler::drawSample(CPose2D& p) const
+{
+	return drawSample(p, getRandomGenerator());
+}
+
+CPose2D& CPoseRandomSampler::drawSample(
+	CPose2D& p, CRandomGenerator& rng) const
 {
 	MRPT_START
 
 	if (m_pdf2D)
 	{
-		do_sample_2D(p);
+		do_sample_2D(p, rng);
 	}
 	else if (m_pdf3D)
 	{
 		CPose3D q;
-		do_sample_3D(q);
+		do_sample_3D(q, rng);
 		p.x(q.x());
 		p.y(q.y());
 		p.phi(q.yaw());
@@ -232,18 +238,24 @@ CPose2D& CPoseRandomSampler::drawSample(CPose2D& p) const
 					drawSample
   ---------------------------------------------------------------*/
 CPose3D& CPoseRandomSampler::drawSample(CPose3D& p) const
+{
+	return drawSample(p, getRandomGenerator());
+}
+
+CPose3D& CPoseRandomSampler::drawSample(
+	CPose3D& p, CRandomGenerator& rng) const
 {
 	MRPT_START
 
 	if (m_pdf2D)
 	{
 		CPose2D q;
-		do_sample_2D(q);
+		do_sample_2D(q, rng);
 		p.setFromValues(q.x(), q.y(), 0, q.phi(), 0, 0);
 	}
 	else if (m_pdf3D)
 	{
-		do_sample_3D(p);
+		do_sample_3D(p, rng);
 	}
 	else
 		THROW_EXCEPTION("No associated pdf: setPosePDF must be called first.");
@@ -255,7 +267,8 @@ CPose3D& CPoseRandomSampler::drawSample(CPose3D& p) const
 /*---------------------------------------------------------------
 				  do_sample_2D: Sample from a 2D PDF
   ---------------------------------------------------------------*/
-void CPoseRandomSampler::do_sample_2D(CPose2D& p) const
+void CPoseRandomSampler::do_sample_2D(
+	CPose2D& p, CRandomGenerator& rng) const
 {
 	MRPT_START
 	ASSERT_(m_pdf2D);
@@ -270,7 +283,7 @@ void CPoseRandomSampler::do_sample_2D(CPose2D& p) const
 		rndVector.setZero();
 		for (size_t i = 0; i < 3; i++)
 		{
-			double rnd = getRandomGenerator().drawGaussian1D_normalized();
+			double rnd = rng.drawGaussian1D_normalized();
 			for (size_t d = 0; d < 3; d++)
 				rndVector[d] += (m_fastdraw_gauss_Z3.get_unsafe(d, i) * rnd);
 		}
@@ -292,9 +305,24 @@ void CPoseRandomSampler::do_sample_2D(CPose2D& p) const
 		// -------------------------------------
 		//      Particles: just sample as usual
 		// -------------------------------------
+		// (Same algorithm than CPosePDFParticles::drawSingleSample(), but
+		// using the given random generator)
 		const CPosePDFParticles* pdf =
 			static_cast<const CPosePDFParticles*>(m_pdf2D.get());
-		pdf->drawSingleSample(p);
+		ASSERT_(!pdf->m_particles.empty());
+		const double uni = rng.drawUniform(0.0, 0.9999);
+		double cum = 0;
+		for (const auto& part : pdf->m_particles)
+		{
+			cum += exp(part.log_w);
+			if (uni <= cum)
+			{
+				p = *part.d;
+				return;
+			}
+		}
+		// Might not come here normally:
+		p = *pdf->m_particles.rbegin()->d;
 	}
 	else
 		THROW_EXCEPTION_FMT(
@@ -306,7 +334,8 @@ void CPoseRandomSampler::do_sample_2D(CPose2D& p) const
 /*---------------------------------------------------------------
 				  do_sample_3D: Sample from a 3D PDF
   ---------------------------------------------------------------*/
-void CPoseRandomSampler::do_sample_3D(CPose3D& p) const
+void CPoseRandomSampler::do_sample_3D(
+	CPose3D& p, CRandomGenerator& rng) const
 {
 	MRPT_START
 	ASSERT_(m_pdf3D);
@@ -321,7 +350,7 @@ void CPoseRandomSampler::do_sample_3D(CPose3D& p) const
 		rndVector.setZero();
 		for (size_t i = 0; i < 6; i++)
 		{
-			double rnd = getRandomGenerator().drawGaussian1D_normalized();
+			double rnd = rng.drawGaussian1D_normalized();
 			for (size_t d = 0; d < 6; d++)
 				rndVector[d] += (m_fastdraw_gauss_Z6.get_unsafe(d, i) * rnd);
 		}
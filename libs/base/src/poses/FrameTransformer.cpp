@@ -10,7 +10,12 @@
 #include "base-precomp.h"  // Precompiled headers
 
 #include <mrpt/poses/FrameTransformer.h>  // for FrameTransformer, FrameTran...
+#include <mrpt/poses/CPose2D.h>
+#include <mrpt/poses/CPose3D.h>
+#include <mrpt/math/slerp.h>
+#include <mrpt/math/wrap2pi.h>
 #include <string>  // for string
+#include <thread>
 #include <mrpt/system/datetime.h>  // for TTimeStamp, INVALID_TIMESTAMP
 #include <mrpt/utils/mrpt_macros.h>  // for ASSERTMSG_
 
@@ -38,27 +43,248 @@ template class FrameTransformerInterface<3>;
 
 // ------- FrameTransformer --------
 template <int DIM>
-FrameTransformer<DIM>::FrameTransformer()
+const typename FrameTransformer<DIM>::frame_id_t
+	FrameTransformer<DIM>::INVALID_FRAME_ID;
+
+template <int DIM>
+FrameTransformer<DIM>::FrameTransformer(const size_t historyLength)
+	: m_history_length(historyLength), m_tree(std::make_shared<TFramesTree>())
 {
+	ASSERT_(historyLength >= 1);
 }
 template <int DIM>
 FrameTransformer<DIM>::~FrameTransformer()
 {
 }
 
+// Interpolation between two poses, for t in [0,1]:
+static void interpolatePose(
+	const mrpt::math::TPose2D& a, const mrpt::math::TPose2D& b,
+	const double t, mrpt::math::TPose2D& p)
+{
+	p.x = a.x + t * (b.x - a.x);
+	p.y = a.y + t * (b.y - a.y);
+	p.phi = mrpt::math::wrapToPi(
+		a.phi + t * mrpt::math::angDistance(a.phi, b.phi));
+}
+static void interpolatePose(
+	const mrpt::math::TPose3D& a, const mrpt::math::TPose3D& b,
+	const double t, mrpt::math::TPose3D& p)
+{
+	mrpt::poses::CPose3D pp(mrpt::poses::UNINITIALIZED_POSE);
+	mrpt::math::slerp(mrpt::poses::CPose3D(a), mrpt::poses::CPose3D(b), t, pp);
+	p = mrpt::math::TPose3D(pp);
+}
+
+template <int DIM>
+void FrameTransformer<DIM>::TEdgeHistory::insert(const TStampedPose& p)
+{
+	const size_t cap = ring.size();
+	size_t f = first.load(std::memory_order_relaxed);
+	size_t n = count.load(std::memory_order_relaxed);
+
+	// Begin of write: make the sequence number odd.
+	const uint64_t s = seq.load(std::memory_order_relaxed);
+	seq.store(s + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	auto at = [&](size_t i) -> TStampedPose& { return ring[(f + i) % cap]; };
+	// Static transforms replace any former history, and vice versa:
+	if (n > 0 && (p.timestamp == INVALID_TIMESTAMP ||
+				  at(n - 1).timestamp == INVALID_TIMESTAMP))
+		n = 0;
+
+	// Position of the new transform, normally at the end:
+	size_t k = n;
+	while (k > 0 && at(k - 1).timestamp > p.timestamp) k--;
+	if (k > 0 && at(k - 1).timestamp == p.timestamp)
+		at(k - 1) = p;  // Replace the existing one
+	else if (!(n == cap && k == 0))  // Otherwise, it's older than all of them
+	{
+		if (n == cap)
+		{
+			// Drop the oldest one:
+			f = (f + 1) % cap;
+			n--;
+			k--;
+		}
+		for (size_t i = n; i > k; i--) at(i) = at(i - 1);
+		at(k) = p;
+		n++;
+	}
+	first.store(f, std::memory_order_relaxed);
+	count.store(n, std::memory_order_relaxed);
+
+	// End of write:
+	seq.store(s + 2, std::memory_order_release);
+}
+
+template <int DIM>
+FrameLookUpStatus FrameTransformer<DIM>::TEdgeHistory::poseAt(
+	const mrpt::system::TTimeStamp t,
+	typename base_t::lightweight_pose_t& out) const
+{
+	const size_t cap = ring.size();
+	TStampedPose a, b;
+	FrameLookUpStatus ret;
+	for (;;)
+	{
+		const uint64_t s = seq.load(std::memory_order_acquire);
+		if (s & 1)
+		{
+			std::this_thread::yield();  // A writer is busy with this edge
+			continue;
+		}
+		// Contents read here may be inconsistent if a writer starts in the
+		// meanwhile, but indices are always kept within bounds and the
+		// values are discarded below in that case:
+		const size_t f = first.load(std::memory_order_relaxed) % cap;
+		const size_t n = std::min(count.load(std::memory_order_relaxed), cap);
+		auto at = [&](size_t i) -> const TStampedPose& {
+			return ring[(f + i) % cap];
+		};
+		ret = LKUP_GOOD;
+		if (n == 0)
+			ret = LKUP_EXTRAPOLATION_ERROR;
+		else if (
+			t == INVALID_TIMESTAMP || at(n - 1).timestamp == INVALID_TIMESTAMP)
+			a = b = at(n - 1);  // Latest, or static, transform
+		else
+		{
+			// First transform at or after "t":
+			size_t lo = 0, hi = n;
+			while (lo < hi)
+			{
+				const size_t mid = (lo + hi) / 2;
+				if (at(mid).timestamp < t)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			if (lo == n || (lo == 0 && at(0).timestamp != t))
+				ret = LKUP_EXTRAPOLATION_ERROR;
+			else
+			{
+				b = at(lo);
+				a = at(lo > 0 ? lo - 1 : 0);
+			}
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (seq.load(std::memory_order_relaxed) == s) break;
+	}
+	if (ret != LKUP_GOOD) return ret;
+
+	if (t == INVALID_TIMESTAMP || b.timestamp == t ||
+		b.timestamp == INVALID_TIMESTAMP)
+		out = b.pose;
+	else
+		interpolatePose(
+			a.pose, b.pose,
+			double(t - a.timestamp) / double(b.timestamp - a.timestamp), out);
+	return LKUP_GOOD;
+}
+
+template <int DIM>
+typename FrameTransformer<DIM>::frame_id_t FrameTransformer<DIM>::findFrameID(
+	const std::string& frame_name) const
+{
+	const auto tree = std::atomic_load(&m_tree);
+	const auto it = tree->ids.find(frame_name);
+	return it == tree->ids.end() ? INVALID_FRAME_ID : it->second;
+}
+
+template <int DIM>
+typename FrameTransformer<DIM>::frame_id_t FrameTransformer<DIM>::getFrameID(
+	const std::string& frame_name)
+{
+	const frame_id_t id = findFrameID(frame_name);
+	if (id != INVALID_FRAME_ID) return id;
+
+	std::lock_guard<std::mutex> lock(m_write_mtx);
+	// Another writer might have just added it:
+	const auto it = m_tree->ids.find(frame_name);
+	if (it != m_tree->ids.end()) return it->second;
+
+	std::shared_ptr<TFramesTree> tree = std::make_shared<TFramesTree>(*m_tree);
+	const frame_id_t new_id = static_cast<frame_id_t>(tree->frames.size());
+	TFrame f;
+	f.name = frame_name;
+	f.chain_to_root.push_back(new_id);
+	tree->frames.push_back(f);
+	tree->ids[frame_name] = new_id;
+	std::atomic_store(&m_tree, std::shared_ptr<const TFramesTree>(tree));
+	return new_id;
+}
+
+template <int DIM>
+std::string FrameTransformer<DIM>::getFrameName(const frame_id_t id) const
+{
+	const auto tree = std::atomic_load(&m_tree);
+	ASSERT_BELOW_(id, tree->frames.size());
+	return tree->frames[id].name;
+}
+
 template <int DIM>
 void FrameTransformer<DIM>::sendTransform(
 	const std::string& parent_frame, const std::string& child_frame,
 	const typename base_t::pose_t& child_wrt_parent,
 	const mrpt::system::TTimeStamp& timestamp)
 {
-	m_pose_edges_buffer[parent_frame][child_frame] =
-		TF_TreeEdge(child_wrt_parent, timestamp);
+	sendTransform(
+		getFrameID(parent_frame), getFrameID(child_frame), child_wrt_parent,
+		timestamp);
 }
 
-// future work: allow graph traversal and do pose chain composition?
-// We dont need to replicate the full functionality of ROS tf, though... just
-// what we really need.
+template <int DIM>
+void FrameTransformer<DIM>::sendTransform(
+	const frame_id_t parent_frame, const frame_id_t child_frame,
+	const typename base_t::pose_t& child_wrt_parent,
+	const mrpt::system::TTimeStamp& timestamp)
+{
+	MRPT_START
+	std::lock_guard<std::mutex> lock(m_write_mtx);
+	// Only writers replace m_tree, and they hold m_write_mtx, so there is no
+	// need for atomic_load() here.
+	const TFramesTree& cur_tree = *m_tree;
+	ASSERT_BELOW_(parent_frame, cur_tree.frames.size());
+	ASSERT_BELOW_(child_frame, cur_tree.frames.size());
+	ASSERT_(parent_frame != child_frame);
+
+	std::shared_ptr<TEdgeHistory> edge = cur_tree.frames[child_frame].edge;
+	if (!edge || cur_tree.frames[child_frame].parent != parent_frame)
+	{
+		// New edge: make a new tree with it.
+		for (const frame_id_t f : cur_tree.frames[parent_frame].chain_to_root)
+			if (f == child_frame)
+				THROW_EXCEPTION_FMT(
+					"Frame `%s` cannot be a child of `%s`: it would create a "
+					"loop",
+					cur_tree.frames[child_frame].name.c_str(),
+					cur_tree.frames[parent_frame].name.c_str());
+
+		std::shared_ptr<TFramesTree> tree =
+			std::make_shared<TFramesTree>(cur_tree);
+		edge = std::make_shared<TEdgeHistory>(m_history_length);
+		tree->frames[child_frame].parent = parent_frame;
+		tree->frames[child_frame].edge = edge;
+		// Update the cached chains:
+		for (size_t i = 0; i < tree->frames.size(); i++)
+		{
+			auto& chain = tree->frames[i].chain_to_root;
+			chain.clear();
+			for (frame_id_t f = i; f != INVALID_FRAME_ID;
+				 f = tree->frames[f].parent)
+				chain.push_back(f);
+		}
+		std::atomic_store(&m_tree, std::shared_ptr<const TFramesTree>(tree));
+	}
+
+	TStampedPose p;
+	p.pose = typename base_t::lightweight_pose_t(child_wrt_parent);
+	p.timestamp = timestamp;
+	edge->insert(p);
+	MRPT_END
+}
 
 template <int DIM>
 FrameLookUpStatus FrameTransformer<DIM>::lookupTransform(
@@ -69,25 +295,54 @@ FrameLookUpStatus FrameTransformer<DIM>::lookupTransform(
 	ASSERTMSG_(
 		timeout_secs == .0,
 		"timeout_secs!=0: Blocking calls not supported yet!");
-	ASSERTMSG_(
-		query_time == INVALID_TIMESTAMP,
-		"`query_time` different than 'latest' not supported yet!");
 
-	const auto& it_src = m_pose_edges_buffer.find(source_frame);
-	if (it_src == m_pose_edges_buffer.end())
-	{
+	return lookupTransform(
+		findFrameID(target_frame), findFrameID(source_frame),
+		child_wrt_parent, query_time);
+}
+
+template <int DIM>
+FrameLookUpStatus FrameTransformer<DIM>::lookupTransform(
+	const frame_id_t target_frame, const frame_id_t source_frame,
+	typename base_t::lightweight_pose_t& child_wrt_parent,
+	const mrpt::system::TTimeStamp query_time) const
+{
+	typedef typename base_t::pose_t pose_t;
+
+	const auto tree = std::atomic_load(&m_tree);
+	if (target_frame >= tree->frames.size() ||
+		source_frame >= tree->frames.size())
 		return LKUP_UNKNOWN_FRAME;
-	}
+	const auto& chain_t = tree->frames[target_frame].chain_to_root;
+	const auto& chain_s = tree->frames[source_frame].chain_to_root;
+	if (chain_t.back() != chain_s.back()) return LKUP_NO_CONNECTIVITY;
 
-	const auto& it_dst = it_src->second.find(target_frame);
-	if (it_dst == it_src->second.end())
+	// Skip the common part of both chains, up to the lowest common ancestor
+	// of both frames:
+	size_t nt = chain_t.size(), ns = chain_s.size();
+	while (nt > 0 && ns > 0 && chain_t[nt - 1] == chain_s[ns - 1])
 	{
-		return LKUP_NO_CONNECTIVITY;
+		nt--;
+		ns--;
 	}
 
-	const TF_TreeEdge& te = it_dst->second;
-	child_wrt_parent = te.pose;
-
+	// Poses of both frames wrt their common ancestor:
+	pose_t target_wrt_anc, source_wrt_anc;
+	typename base_t::lightweight_pose_t p;
+	for (size_t i = nt; i-- > 0;)
+	{
+		const auto ret = tree->frames[chain_t[i]].edge->poseAt(query_time, p);
+		if (ret != LKUP_GOOD) return ret;
+		target_wrt_anc = target_wrt_anc + pose_t(p);
+	}
+	for (size_t i = ns; i-- > 0;)
+	{
+		const auto ret = tree->frames[chain_s[i]].edge->poseAt(query_time, p);
+		if (ret != LKUP_GOOD) return ret;
+		source_wrt_anc = source_wrt_anc + pose_t(p);
+	}
+	child_wrt_parent =
+		typename base_t::lightweight_pose_t(target_wrt_anc - source_wrt_anc);
 	return LKUP_GOOD;
 }
 
@@ -10,7 +10,10 @@
 #include <mrpt/poses/FrameTransformer.h>
 #include <mrpt/poses/CPose2D.h>
 #include <mrpt/poses/CPose3D.h>
+#include <mrpt/math/wrap2pi.h>
 #include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
 
 template <int DIM>
 void run_tf_test1(const mrpt::poses::CPose2D& A2B_)
@@ -45,3 +48,159 @@ TEST(FrameTransformer, SimplePublishAndLookup)
 	run_tf_test1<2>(test_A2B);
 	run_tf_test1<3>(test_A2B);
 }
+
+static bool posesNear(
+	const mrpt::math::TPose2D& a, const mrpt::math::TPose2D& b,
+	const double eps = 1e-6)
+{
+	return std::abs(a.x - b.x) < eps && std::abs(a.y - b.y) < eps &&
+		   std::abs(mrpt::math::angDistance(a.phi, b.phi)) < eps;
+}
+
+TEST(FrameTransformer, ChainsOfFrames)
+{
+	using namespace mrpt::poses;
+	using mrpt::math::TPose2D;
+
+	// map -> odom -> base_link -> laser
+	//                          -> camera
+	// world2 (disconnected)
+	const CPose2D map2odom(1.0, 2.0, 0.5), odom2base(3.0, -1.0, -0.2),
+		base2laser(0.2, 0.0, 0.0), base2cam(0.1, 0.1, 1.57);
+	FrameTransformer<2> tf;
+	tf.sendTransform("map", "odom", map2odom);
+	tf.sendTransform("odom", "base_link", odom2base);
+	tf.sendTransform("base_link", "laser", base2laser);
+	tf.sendTransform("base_link", "camera", base2cam);
+	tf.sendTransform("world2", "foo", CPose2D());
+
+	TPose2D p;
+	EXPECT_EQ(tf.lookupTransform("laser", "map", p), LKUP_GOOD);
+	EXPECT_TRUE(posesNear(p, TPose2D(map2odom + odom2base + base2laser)));
+	EXPECT_EQ(tf.lookupTransform("map", "laser", p), LKUP_GOOD);
+	EXPECT_TRUE(
+		posesNear(p, TPose2D(CPose2D() - (map2odom + odom2base + base2laser))));
+	EXPECT_EQ(tf.lookupTransform("camera", "laser", p), LKUP_GOOD);
+	EXPECT_TRUE(posesNear(p, TPose2D(base2cam - base2laser)));
+	EXPECT_EQ(tf.lookupTransform("odom", "odom", p), LKUP_GOOD);
+	EXPECT_TRUE(posesNear(p, TPose2D(0, 0, 0)));
+
+	EXPECT_EQ(tf.lookupTransform("laser", "foo", p), LKUP_NO_CONNECTIVITY);
+	EXPECT_EQ(tf.lookupTransform("laser", "none", p), LKUP_UNKNOWN_FRAME);
+
+	// Integer IDs:
+	const auto id_map = tf.findFrameID("map"), id_cam = tf.findFrameID("camera");
+	ASSERT_NE(id_map, FrameTransformer<2>::INVALID_FRAME_ID);
+	EXPECT_EQ(tf.getFrameName(id_cam), std::string("camera"));
+	EXPECT_EQ(tf.findFrameID("none"), FrameTransformer<2>::INVALID_FRAME_ID);
+	EXPECT_EQ(tf.lookupTransform(id_cam, id_map, p), LKUP_GOOD);
+	EXPECT_TRUE(posesNear(p, TPose2D(map2odom + odom2base + base2cam)));
+
+	// Re-parenting a frame:
+	tf.sendTransform("map", "base_link", CPose2D(1, 1, 0));
+	EXPECT_EQ(tf.lookupTransform("laser", "map", p), LKUP_GOOD);
+	EXPECT_TRUE(posesNear(p, TPose2D(CPose2D(1, 1, 0) + base2laser)));
+	// Loops are not allowed:
+	EXPECT_THROW(tf.sendTransform("laser", "map", CPose2D()), std::exception);
+}
+
+TEST(FrameTransformer, InterpolationAndHistory)
+{
+	using namespace mrpt::poses;
+	using mrpt::math::TPose2D;
+	using mrpt::math::TPose3D;
+	using mrpt::system::TTimeStamp;
+
+	const TTimeStamp t0 = mrpt::system::now();
+	const TTimeStamp dt = 10000000;  // 1 s
+	FrameTransformer<2> tf2(10);
+	FrameTransformer<3> tf3(10);
+	EXPECT_EQ(tf2.getHistoryLength(), 10u);
+	// Published out of order:
+	for (int i : {0, 2, 1, 3, 4})
+	{
+		tf2.sendTransform(
+			"odom", "base", CPose2D(i, 2 * i, 0.1 * i), t0 + i * dt);
+		tf3.sendTransform(
+			"odom", "base", CPose3D(i, 2 * i, 0, 0.1 * i, 0, 0), t0 + i * dt);
+	}
+	// A static transform:
+	tf2.sendTransform("base", "laser", CPose2D(1, 0, 0), INVALID_TIMESTAMP);
+
+	TPose2D p;
+	TPose3D p3;
+	EXPECT_EQ(tf2.lookupTransform("base", "odom", p, t0 + dt), LKUP_GOOD);
+	EXPECT_TRUE(posesNear(p, TPose2D(1, 2, 0.1)));
+	EXPECT_EQ(
+		tf2.lookupTransform("base", "odom", p, t0 + 5 * dt / 2), LKUP_GOOD);
+	EXPECT_TRUE(posesNear(p, TPose2D(2.5, 5, 0.25)));
+	EXPECT_EQ(
+		tf3.lookupTransform("base", "odom", p3, t0 + 5 * dt / 2), LKUP_GOOD);
+	EXPECT_NEAR(p3.x, 2.5, 1e-6);
+	EXPECT_NEAR(p3.y, 5.0, 1e-6);
+	EXPECT_NEAR(p3.yaw, 0.25, 1e-6);
+	EXPECT_EQ(tf2.lookupTransform("laser", "odom", p, t0 + dt / 2), LKUP_GOOD);
+	EXPECT_TRUE(posesNear(p, TPose2D(CPose2D(0.5, 1, 0.05) + CPose2D(1, 0, 0))));
+	// Latest:
+	EXPECT_EQ(tf2.lookupTransform("base", "odom", p), LKUP_GOOD);
+	EXPECT_TRUE(posesNear(p, TPose2D(4, 8, 0.4)));
+	// Out of the stored history:
+	EXPECT_EQ(
+		tf2.lookupTransform("base", "odom", p, t0 + 5 * dt),
+		LKUP_EXTRAPOLATION_ERROR);
+	EXPECT_EQ(
+		tf2.lookupTransform("base", "odom", p, t0 - dt),
+		LKUP_EXTRAPOLATION_ERROR);
+
+	// Only the latest 10 transforms are kept:
+	for (int i = 5; i < 20; i++)
+		tf2.sendTransform("odom", "base", CPose2D(i, 2 * i, 0), t0 + i * dt);
+	EXPECT_EQ(
+		tf2.lookupTransform("base", "odom", p, t0 + 9 * dt),
+		LKUP_EXTRAPOLATION_ERROR);
+	EXPECT_EQ(tf2.lookupTransform("base", "odom", p, t0 + 10 * dt), LKUP_GOOD);
+	EXPECT_TRUE(posesNear(p, TPose2D(10, 20, 0)));
+}
+
+TEST(FrameTransformer, ConcurrentPublishAndLookup)
+{
+	using namespace mrpt::poses;
+	using mrpt::math::TPose2D;
+	using mrpt::system::TTimeStamp;
+
+	FrameTransformer<2> tf(20);
+	const TTimeStamp t0 = mrpt::system::now();
+	tf.sendTransform("odom", "base", CPose2D(0, 0, 0), t0);
+	const auto id_odom = tf.findFrameID("odom"),
+			   id_base = tf.findFrameID("base");
+
+	// The writer publishes poses with y=2*x, such that inconsistent reads
+	// would be detected:
+	const int N = 20000;
+	std::atomic<bool> failed(false);
+	std::thread writer([&]() {
+		for (int i = 1; i < N; i++)
+			tf.sendTransform(
+				id_odom, id_base, CPose2D(i, 2 * i, 0), t0 + i * 1000);
+	});
+	std::vector<std::thread> readers;
+	for (int r = 0; r < 2; r++)
+		readers.emplace_back([&]() {
+			TPose2D p;
+			for (int i = 0; i < N; i++)
+			{
+				if (tf.lookupTransform(id_base, id_odom, p) != LKUP_GOOD ||
+					std::abs(p.y - 2 * p.x) > 1e-9)
+					failed = true;
+				// Any time within the history, interpolated:
+				const auto ret = tf.lookupTransform(
+					id_base, id_odom, p, t0 + (i * 997) % (N * 1000));
+				if ((ret != LKUP_GOOD && ret != LKUP_EXTRAPOLATION_ERROR) ||
+					(ret == LKUP_GOOD && std::abs(p.y - 2 * p.x) > 1e-6))
+					failed = true;
+			}
+		});
+	writer.join();
+	for (auto& t : readers) t.join();
+	EXPECT_FALSE(failed);
+}
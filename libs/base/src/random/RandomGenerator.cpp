@@ -34,6 +34,8 @@ CRandomGenerator & mrpt::random::getRandomGenerator()
 void CRandomGenerator::MT19937_initializeGenerator(const uint32_t& seed)
 {
 	m_MT19937.seed(seed);
+	// Discard any gaussian sample cached from the previous sequence:
+	m_normdistribution.reset();
 }
 
 uint64_t CRandomGenerator::drawUniform64bit() { return m_uint64(m_MT19937); }
@@ -49,6 +49,7 @@ IMPLEMENTS_SERIALIZABLE(CImage, CSerializable, mrpt::utils)
 bool CImage::DISABLE_ZIP_COMPRESSION = false;
 bool CImage::DISABLE_JPEG_COMPRESSION = false;
 int CImage::SERIALIZATION_JPEG_QUALITY = 95;
+bool CImage::DISABLE_LAZY_DECODING = false;
 
 static std::string IMAGES_PATH_BASE(".");
 
@@ -115,7 +116,12 @@ CImage& CImage::operator=(const CImage& o)
 	m_imgIsExternalStorage = o.m_imgIsExternalStorage;
 	m_imgIsReadOnly = false;
 
-	if (!o.m_imgIsExternalStorage)
+	if (o.isCompressedResident())
+	{  // Share the encoded image
+		m_compressed = o.m_compressed;
+		m_compressedResident.store(true, std::memory_order_release);
+	}
+	else if (!o.m_imgIsExternalStorage)
 	{  // A normal image
 #if MRPT_HAS_OPENCV
 		ASSERTMSG_(
@@ -141,6 +147,10 @@ void CImage::swap(CImage& o)
 	std::swap(m_imgIsReadOnly, o.m_imgIsReadOnly);
 	std::swap(m_imgIsExternalStorage, o.m_imgIsExternalStorage);
 	std::swap(m_externalFile, o.m_externalFile);
+	std::swap(m_compressed, o.m_compressed);
+	m_compressedResident.store(o.m_compressedResident.exchange(
+		m_compressedResident.load(std::memory_order_acquire),
+		std::memory_order_acq_rel));
 }
 
 /*---------------------------------------------------------------
@@ -174,9 +184,9 @@ void CImage::copyFastFrom(CImage& o)
 {
 	MRPT_START
 	if (this == &o) return;
-	if (o.m_imgIsExternalStorage)
+	if (o.m_imgIsExternalStorage || o.isCompressedResident())
 	{
-		// Just copy the reference to the ext. file:
+		// Just copy the reference to the ext. file or the encoded image:
 		*this = o;
 	}
 	else
@@ -512,13 +522,17 @@ unsigned char* CImage::get_unsafe(
 void CImage::writeToStream(mrpt::utils::CStream& out, int* version) const
 {
 #if !MRPT_HAS_OPENCV
+	// Compressed-resident images can be written back as read:
 	if (version)
-		*version = 100;
+		*version = isCompressedResident() ? 8 : 100;
 	else
 	{
 		out << m_imgIsExternalStorage;
 
-		if (m_imgIsExternalStorage) out << m_externalFile;
+		if (m_imgIsExternalStorage)
+			out << m_externalFile;
+		else if (isCompressedResident())
+			out.WriteBuffer(&m_compressed->data[0], m_compressed->data.size());
 		// Nothing else to serialize!
 	}
 #else
@@ -533,6 +547,11 @@ void CImage::writeToStream(mrpt::utils::CStream& out, int* version) const
 		{
 			out << m_externalFile;
 		}
+		else if (isCompressedResident())
+		{
+			// Not decoded yet: just copy the encoded image as read.
+			out.WriteBuffer(&m_compressed->data[0], m_compressed->data.size());
+		}
 		else
 		{  // Normal image loaded in memory:
 			ASSERT_(img != nullptr);
@@ -638,20 +657,6 @@ void CImage::writeToStream(mrpt::utils::CStream& out, int* version) const
  ---------------------------------------------------------------*/
 void CImage::readFromStream(mrpt::utils::CStream& in, int version)
 {
-#if !MRPT_HAS_OPENCV
-	if (version == 100)
-	{
-		in >> m_imgIsExternalStorage;
-		if (m_imgIsExternalStorage)
-			in >> m_externalFile;
-		else
-		{
-			THROW_EXCEPTION(
-				"[CImage] Cannot deserialize image since MRPT has been "
-				"compiled without OpenCV")
-		}
-	}
-#else
 	releaseIpl();  // First, free current image.
 
 	switch (version)
@@ -660,8 +665,15 @@ void CImage::readFromStream(mrpt::utils::CStream& in, int version)
 		{
 			in >> m_imgIsExternalStorage;
 			if (m_imgIsExternalStorage) in >> m_externalFile;
+#if !MRPT_HAS_OPENCV
+			else
+				THROW_EXCEPTION(
+					"[CImage] Cannot deserialize image since MRPT has been "
+					"compiled without OpenCV")
+#endif
 		}
 		break;
+#if MRPT_HAS_OPENCV
 		case 0:
 		{
 			uint32_t width, height, nChannels, imgLength;
@@ -689,6 +701,7 @@ void CImage::readFromStream(mrpt::utils::CStream& in, int version)
 			loadFromStreamAsJPEG(aux);
 		}
 		break;
+#endif
 		case 2:
 		case 3:
 		case 4:
@@ -708,134 +721,211 @@ void CImage::readFromStream(mrpt::utils::CStream& in, int version)
 				// Just the file name:
 				in >> m_externalFile;
 			}
+			else if (
+				version >= 7 &&
+				(!CImage::DISABLE_LAZY_DECODING || !MRPT_HAS_OPENCV))
+			{
+				// Keep the encoded image, and decode it on demand:
+				readCompressedImage(in);
+			}
 			else
 			{  // Normal, the whole image data:
+				readImageContents(in, version);
+			}
+		}
+		break;
+		default:
+			MRPT_THROW_UNKNOWN_SERIALIZATION_VERSION(version)
+	};
+}
+
+void CImage::readImageContents(mrpt::utils::CStream& in, int version)
+{
+#if MRPT_HAS_OPENCV
+	// Version 2: Color->JPEG, GrayScale->BYTE's array!
+	uint8_t hasColor;
+	in >> hasColor;
+	if (!hasColor)
+	{
+		// GRAY SCALE:
+		int32_t width, height, origin, imageSize;
+		in >> width >> height >> origin >> imageSize;
+
+		changeSize(width, height, 1, origin == 0);
+		ASSERT_(imageSize == ((IplImage*)img)->imageSize);
+
+		if (version == 2)
+		{
+			// RAW BYTES:
+			in.ReadBuffer(((IplImage*)img)->imageData, imageSize);
+		}
+		else
+		{
+			// Version 3: ZIP compression!
+			bool imageIsZIP = true;
+
+			// Version 4: Skip zip if the image size <= 16Kb
+			// Version 5: Use CImage::DISABLE_ZIP_COMPRESSION
+			if (version == 4 && imageSize <= 16 * 1024)
+				imageIsZIP = false;
+
+			if (version >= 5)
+			{
+				// It is stored int the stream:
+				in >> imageIsZIP;
+			}
+
+			if (imageIsZIP)
+			{
+				uint32_t zipDataLen;
+				in >> zipDataLen;
+
+				size_t outDataBufferSize = imageSize;
+				size_t outDataActualSize;
 
-				// Version 2: Color->JPEG, GrayScale->BYTE's array!
-				uint8_t hasColor;
-				in >> hasColor;
-				if (!hasColor)
+				compress::zip::decompress(
+					in, zipDataLen, ((IplImage*)img)->imageData,
+					outDataBufferSize, outDataActualSize);
+
+				ASSERT_(outDataActualSize == outDataBufferSize);
+			}
+			else
+			{
+				// Raw bytes:
+				in.ReadBuffer(
+					((IplImage*)img)->imageData,
+					((IplImage*)img)->imageSize);
+			}
+		}
+	}
+	else
+	{
+		bool loadJPEG = true;
+
+		if (version >= 7)
+		{
+			int32_t width, height;
+			in >> width >> height;
+
+			if (width >= 1 && height >= 1)
+			{
+				loadJPEG = true;
+			}
+			else
+			{
+				loadJPEG = false;
+
+				if (width < 0 && height < 0)
 				{
-					// GRAY SCALE:
-					int32_t width, height, origin, imageSize;
-					in >> width >> height >> origin >> imageSize;
+					// v8: raw image:
+					const int32_t real_w = -width;
+					const int32_t real_h = -height;
 
-					changeSize(width, height, 1, origin == 0);
-					ASSERT_(imageSize == ((IplImage*)img)->imageSize);
+					this->changeSize(real_w, real_h, 3, true);
 
-					if (version == 2)
-					{
-						// RAW BYTES:
-						in.ReadBuffer(((IplImage*)img)->imageData, imageSize);
-					}
-					else
+					const IplImage* ipl =
+						static_cast<const IplImage*>(img);
+					const size_t bytes_per_row = ipl->width * 3;
+					for (int y = 0; y < ipl->height; y++)
 					{
-						// Version 3: ZIP compression!
-						bool imageIsZIP = true;
-
-						// Version 4: Skip zip if the image size <= 16Kb
-						// Version 5: Use CImage::DISABLE_ZIP_COMPRESSION
-						if (version == 4 && imageSize <= 16 * 1024)
-							imageIsZIP = false;
-
-						if (version >= 5)
-						{
-							// It is stored int the stream:
-							in >> imageIsZIP;
-						}
-
-						if (imageIsZIP)
-						{
-							uint32_t zipDataLen;
-							in >> zipDataLen;
-
-							size_t outDataBufferSize = imageSize;
-							size_t outDataActualSize;
-
-							compress::zip::decompress(
-								in, zipDataLen, ((IplImage*)img)->imageData,
-								outDataBufferSize, outDataActualSize);
-
-							ASSERT_(outDataActualSize == outDataBufferSize);
-						}
-						else
-						{
-							// Raw bytes:
-							in.ReadBuffer(
-								((IplImage*)img)->imageData,
-								((IplImage*)img)->imageSize);
-						}
+						const size_t nRead = in.ReadBuffer(
+							&ipl->imageData[y * ipl->widthStep],
+							bytes_per_row);
+						if (nRead != bytes_per_row)
+							THROW_EXCEPTION(
+								"Error: Truncated data stream "
+								"while parsing raw image?")
 					}
 				}
 				else
 				{
-					bool loadJPEG = true;
-
-					if (version >= 7)
-					{
-						int32_t width, height;
-						in >> width >> height;
-
-						if (width >= 1 && height >= 1)
-						{
-							loadJPEG = true;
-						}
-						else
-						{
-							loadJPEG = false;
-
-							if (width < 0 && height < 0)
-							{
-								// v8: raw image:
-								const int32_t real_w = -width;
-								const int32_t real_h = -height;
-
-								this->changeSize(real_w, real_h, 3, true);
-
-								const IplImage* ipl =
-									static_cast<const IplImage*>(img);
-								const size_t bytes_per_row = ipl->width * 3;
-								for (int y = 0; y < ipl->height; y++)
-								{
-									const size_t nRead = in.ReadBuffer(
-										&ipl->imageData[y * ipl->widthStep],
-										bytes_per_row);
-									if (nRead != bytes_per_row)
-										THROW_EXCEPTION(
-											"Error: Truncated data stream "
-											"while parsing raw image?")
-								}
-							}
-							else
-							{
-								// it's a 0xN or Nx0 image: just resize and load
-								// nothing:
-								this->changeSize(width, height, 3, true);
-							}
-						}
-					}
-
-					// COLOR IMAGE: JPEG
-					if (loadJPEG)
-					{
-						CMemoryStream aux;
-						uint32_t nBytes;
-						in >> nBytes;
-						aux.changeSize(nBytes + 10);
-						in.ReadBuffer(aux.getRawBufferData(), nBytes);
-						aux.Seek(0);
-						loadFromStreamAsJPEG(aux);
-					}
+					// it's a 0xN or Nx0 image: just resize and load
+					// nothing:
+					this->changeSize(width, height, 3, true);
 				}
 			}
 		}
-		break;
-		default:
-			MRPT_THROW_UNKNOWN_SERIALIZATION_VERSION(version)
-	};
+
+		// COLOR IMAGE: JPEG
+		if (loadJPEG)
+		{
+			CMemoryStream aux;
+			uint32_t nBytes;
+			in >> nBytes;
+			aux.changeSize(nBytes + 10);
+			in.ReadBuffer(aux.getRawBufferData(), nBytes);
+			aux.Seek(0);
+			loadFromStreamAsJPEG(aux);
+		}
+	}
+#else
+	MRPT_UNUSED_PARAM(in);
+	MRPT_UNUSED_PARAM(version);
+	THROW_EXCEPTION(
+		"[CImage] Cannot decode image since MRPT has been compiled without "
+		"OpenCV")
 #endif
 }
 
+void CImage::readCompressedImage(mrpt::utils::CStream& in)
+{
+	// Parse just the headers, copying them (which also normalizes their
+	// endianness) into the buffer, followed by the encoded pixels as is:
+	auto comp = std::make_shared<TCompressedImage>();
+	CMemoryStream hdr;
+	size_t nBytes = 0;
+
+	uint8_t hasColor;
+	in >> hasColor;
+	hdr << hasColor;
+	comp->color = hasColor != 0;
+	if (!hasColor)
+	{
+		int32_t width, height, origin, imageSize;
+		bool imageIsZIP;
+		in >> width >> height >> origin >> imageSize >> imageIsZIP;
+		hdr << width << height << origin << imageSize << imageIsZIP;
+		ASSERT_(width >= 0 && height >= 0 && imageSize >= 0);
+		comp->width = width;
+		comp->height = height;
+		comp->originTopLeft = (origin == 0);
+		nBytes = imageSize;
+		if (imageIsZIP)
+		{
+			uint32_t zipDataLen;
+			in >> zipDataLen;
+			hdr << zipDataLen;
+			nBytes = zipDataLen;
+		}
+	}
+	else
+	{
+		int32_t width, height;
+		in >> width >> height;
+		hdr << width << height;
+		comp->width = std::abs(width);
+		comp->height = std::abs(height);
+		comp->originTopLeft = true;
+		if (width >= 1 && height >= 1)
+		{  // JPEG
+			uint32_t jpegLen;
+			in >> jpegLen;
+			hdr << jpegLen;
+			nBytes = jpegLen;
+		}
+		else if (width < 0 && height < 0)
+			nBytes = size_t(3) * comp->width * comp->height;  // v8: raw
+	}
+
+	const size_t hdrLen = hdr.getTotalBytesCount();
+	comp->data.resize(hdrLen + nBytes);
+	std::memcpy(&comp->data[0], hdr.getRawBufferData(), hdrLen);
+	if (nBytes && in.ReadBuffer(&comp->data[hdrLen], nBytes) != nBytes)
+		THROW_EXCEPTION("Error: Truncated data stream while reading image")
+	m_compressed = comp;
+	m_compressedResident.store(true, std::memory_order_release);
+}
+
 /*---------------------------------------------------------------
   Implements the writing to a mxArray for Matlab
  ---------------------------------------------------------------*/
@@ -855,6 +945,12 @@ mxArray* CImage::writeToMatlab() const
  ---------------------------------------------------------------*/
 void CImage::getSize(TImageSize& s) const
 {
+	if (isCompressedResident())
+	{
+		s.x = m_compressed->width;
+		s.y = m_compressed->height;
+		return;
+	}
 #if MRPT_HAS_OPENCV
 	makeSureImageIsLoaded();  // For delayed loaded images stored externally
 	ASSERT_(img != nullptr);
@@ -868,6 +964,7 @@ void CImage::getSize(TImageSize& s) const
  ---------------------------------------------------------------*/
 size_t CImage::getWidth() const
 {
+	if (isCompressedResident()) return m_compressed->width;
 #if MRPT_HAS_OPENCV
 	makeSureImageIsLoaded();  // For delayed loaded images stored externally
 	ASSERT_(img != nullptr);
@@ -896,6 +993,7 @@ size_t CImage::getRowStride() const
  ---------------------------------------------------------------*/
 size_t CImage::getHeight() const
 {
+	if (isCompressedResident()) return m_compressed->height;
 #if MRPT_HAS_OPENCV
 	makeSureImageIsLoaded();  // For delayed loaded images stored externally
 	ASSERT_(img != nullptr);
@@ -910,6 +1008,7 @@ size_t CImage::getHeight() const
  ---------------------------------------------------------------*/
 bool CImage::isColor() const
 {
+	if (isCompressedResident()) return m_compressed->color;
 #if MRPT_HAS_OPENCV
 	makeSureImageIsLoaded();  // For delayed loaded images stored externally
 	ASSERT_(img != nullptr);
@@ -924,6 +1023,7 @@ bool CImage::isColor() const
  ---------------------------------------------------------------*/
 TImageChannels CImage::getChannelCount() const
 {
+	if (isCompressedResident()) return m_compressed->color ? 3 : 1;
 #if MRPT_HAS_OPENCV
 	makeSureImageIsLoaded();  // For delayed loaded images stored externally
 	ASSERT_(img != nullptr);
@@ -938,6 +1038,7 @@ TImageChannels CImage::getChannelCount() const
  ---------------------------------------------------------------*/
 bool CImage::isOriginTopLeft() const
 {
+	if (isCompressedResident()) return m_compressed->originTopLeft;
 #if MRPT_HAS_OPENCV
 	makeSureImageIsLoaded();  // For delayed loaded images stored externally
 	ASSERT_(img != nullptr);
@@ -1341,6 +1442,8 @@ void CImage::update_patch(
 	const CImage& patch, const unsigned int col_, const unsigned int row_)
 {
 #if MRPT_HAS_OPENCV
+	makeSureImageIsLoaded();  // For delayed loaded images stored externally
+	patch.makeSureImageIsLoaded();
 	IplImage* ipl_int = ((IplImage*)img);
 	IplImage* ipl_ext = ((IplImage*)patch.img);
 	ASSERT_(ipl_int);
@@ -1918,6 +2021,8 @@ void CImage::unload() const noexcept
  ---------------------------------------------------------------*/
 void CImage::releaseIpl(bool thisIsExternalImgUnload) noexcept
 {
+	m_compressedResident.store(false, std::memory_order_release);
+	m_compressed.reset();
 #if MRPT_HAS_OPENCV
 	if (img && !m_imgIsReadOnly)
 	{
@@ -1939,6 +2044,11 @@ void CImage::releaseIpl(bool thisIsExternalImgUnload) noexcept
  ---------------------------------------------------------------*/
 void CImage::makeSureImageIsLoaded() const
 {
+	if (isCompressedResident())
+	{
+		decodeCompressedImage();
+		return;
+	}
 	if (img != nullptr) return;  // OK, continue
 
 	if (m_imgIsExternalStorage)
@@ -1966,6 +2076,30 @@ void CImage::makeSureImageIsLoaded() const
 		THROW_EXCEPTION("img is nullptr in a non-externally stored image.");
 }
 
+/*---------------------------------------------------------------
+				decodeCompressedImage
+ ---------------------------------------------------------------*/
+void CImage::decodeCompressedImage() const
+{
+	std::lock_guard<std::mutex> lock(m_decode_mtx);
+	// Another thread may have decoded it while we waited:
+	if (!m_compressedResident.load(std::memory_order_relaxed)) return;
+
+	// Decode into a temporary image, so other threads can keep reading
+	// m_compressed meanwhile:
+	CMemoryStream in;
+	in.assignMemoryNotOwn(&m_compressed->data[0], m_compressed->data.size());
+	CImage decoded;
+	decoded.readImageContents(in, 8);
+
+	CImage* me = const_cast<CImage*>(this);
+	me->img = decoded.img;
+	me->m_imgIsReadOnly = false;
+	decoded.img = nullptr;
+	// Publish the pixels:
+	m_compressedResident.store(false, std::memory_order_release);
+}
+
 /*---------------------------------------------------------------
 				getExternalStorageFileAbsolutePath
  ---------------------------------------------------------------*/
@@ -1996,6 +2130,8 @@ void CImage::getExternalStorageFileAbsolutePath(std::string& out_path) const
 void CImage::flipVertical(bool also_swapRB)
 {
 #if MRPT_HAS_OPENCV
+	makeSureImageIsLoaded();  // For delayed loaded images stored externally
+	ASSERT_(img != nullptr);
 	IplImage* ptr = (IplImage*)img;
 	int options = CV_CVTIMG_FLIP;
 	if (also_swapRB) options |= CV_CVTIMG_SWAP_RB;
@@ -2006,6 +2142,8 @@ void CImage::flipVertical(bool also_swapRB)
 void CImage::flipHorizontal()
 {
 #if MRPT_HAS_OPENCV
+	makeSureImageIsLoaded();  // For delayed loaded images stored externally
+	ASSERT_(img != nullptr);
 	IplImage* ptr = (IplImage*)img;
 	cvFlip(ptr, nullptr, 1);
 #endif
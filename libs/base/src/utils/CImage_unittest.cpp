@@ -0,0 +1,229 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/utils/CImage.h>
+#include <mrpt/utils/CMemoryStream.h>
+#include <gtest/gtest.h>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace mrpt::utils;
+
+#if MRPT_HAS_OPENCV  // Pixels cannot be decoded without OpenCV
+
+static void fillTestImage(
+	CImage& img, unsigned int w, unsigned int h, TImageChannels ch)
+{
+	img.resize(w, h, ch, true);
+	for (unsigned int r = 0; r < h; r++)
+		for (unsigned int c = 0; c < w; c++)
+			for (unsigned int k = 0; k < ch; k++)
+				*img.get_unsafe(c, r, k) = (r * 7 + c * 3 + k * 50) % 256;
+}
+
+static bool sameBytes(CMemoryStream& a, CMemoryStream& b)
+{
+	return a.getTotalBytesCount() == b.getTotalBytesCount() &&
+		   0 == std::memcmp(
+					a.getRawBufferData(), b.getRawBufferData(),
+					a.getTotalBytesCount());
+}
+
+static void testLazyDecoding(const CImage& orig)
+{
+	CMemoryStream buf1;
+	buf1 << orig;
+
+	// Decoded while reading, for reference:
+	CImage ref;
+	CImage::DISABLE_LAZY_DECODING = true;
+	buf1.Seek(0);
+	buf1 >> ref;
+	CImage::DISABLE_LAZY_DECODING = false;
+	EXPECT_FALSE(ref.isCompressedResident());
+
+	CImage img;
+	buf1.Seek(0);
+	buf1 >> img;
+	EXPECT_TRUE(img.isCompressedResident());
+
+	// No need to decode for these:
+	EXPECT_EQ(img.getWidth(), orig.getWidth());
+	EXPECT_EQ(img.getHeight(), orig.getHeight());
+	EXPECT_EQ(img.isColor(), orig.isColor());
+	EXPECT_EQ(img.getChannelCount(), orig.getChannelCount());
+	EXPECT_EQ(img.isOriginTopLeft(), orig.isOriginTopLeft());
+	EXPECT_TRUE(img.isCompressedResident());
+
+	// Written again as read:
+	CMemoryStream buf2;
+	buf2 << img;
+	EXPECT_TRUE(sameBytes(buf1, buf2));
+
+	// Copies share the encoded image, and are decoded independently:
+	const CImage copy = img;
+	EXPECT_TRUE(copy.isCompressedResident());
+	for (unsigned int r = 0; r < ref.getHeight(); r++)
+		for (unsigned int c = 0; c < ref.getWidth(); c++)
+			for (unsigned int k = 0; k < ref.getChannelCount(); k++)
+				ASSERT_EQ(*copy.get_unsafe(c, r, k), *ref.get_unsafe(c, r, k));
+	EXPECT_FALSE(copy.isCompressedResident());
+	EXPECT_TRUE(img.isCompressedResident());
+
+	img.forceLoad();
+	EXPECT_FALSE(img.isCompressedResident());
+	CMemoryStream buf3, buf4;
+	buf3 << img;
+	buf4 << ref;
+	EXPECT_TRUE(sameBytes(buf3, buf4));
+}
+
+TEST(CImage, LazyDecodingColor)
+{
+	CImage img;
+	fillTestImage(img, 64, 48, CH_RGB);
+	testLazyDecoding(img);  // JPEG
+
+	CImage::DISABLE_JPEG_COMPRESSION = true;
+	testLazyDecoding(img);  // Raw
+	CImage::DISABLE_JPEG_COMPRESSION = false;
+}
+
+TEST(CImage, LazyDecodingGray)
+{
+	CImage img;
+	fillTestImage(img, 20, 10, CH_GRAY);
+	testLazyDecoding(img);  // Raw
+	fillTestImage(img, 200, 100, CH_GRAY);
+	testLazyDecoding(img);  // ZIP
+}
+
+TEST(CImage, LazyDecodingThenModify)
+{
+	CImage orig;
+	fillTestImage(orig, 200, 100, CH_GRAY);
+	CMemoryStream buf;
+	buf << orig;
+	buf.Seek(0);
+	CImage img;
+	buf >> img;
+	ASSERT_TRUE(img.isCompressedResident());
+
+	// Modified images must be encoded again:
+	*img.get_unsafe(10, 5) = 255;
+	*orig.get_unsafe(10, 5) = 255;
+	CMemoryStream buf1, buf2;
+	buf1 << img;
+	buf2 << orig;
+	EXPECT_TRUE(sameBytes(buf1, buf2));
+}
+
+TEST(CImage, LazyDecodingThenFlip)
+{
+	CImage orig;
+	fillTestImage(orig, 64, 48, CH_RGB);
+	CImage::DISABLE_JPEG_COMPRESSION = true;
+	CMemoryStream buf;
+	buf << orig;
+	CImage::DISABLE_JPEG_COMPRESSION = false;
+
+	for (int op = 0; op < 3; op++)
+	{
+		CImage img, ref = orig;
+		buf.Seek(0);
+		buf >> img;
+		ASSERT_TRUE(img.isCompressedResident());
+		switch (op)
+		{
+			case 0:
+				img.flipVertical();
+				ref.flipVertical();
+				break;
+			case 1:
+				img.flipHorizontal();
+				ref.flipHorizontal();
+				break;
+			case 2:
+				img.flipVertical(true);
+				ref.flipVertical(true);
+				break;
+		};
+		EXPECT_FALSE(img.isCompressedResident());
+		for (unsigned int r = 0; r < ref.getHeight(); r++)
+			for (unsigned int c = 0; c < ref.getWidth(); c++)
+				for (unsigned int k = 0; k < 3; k++)
+					ASSERT_EQ(*img.get_unsafe(c, r, k), *ref.get_unsafe(c, r, k));
+	}
+
+	// Lazy image as target and as patch of update_patch():
+	CImage patch, img, ref = orig;
+	buf.Seek(0);
+	buf >> patch;
+	buf.Seek(0);
+	buf >> img;
+	ASSERT_TRUE(patch.isCompressedResident());
+	ASSERT_TRUE(img.isCompressedResident());
+	CImage piece;
+	orig.extract_patch(piece, 0, 0, 10, 8);
+	img.update_patch(piece, 5, 4);
+	ref.update_patch(piece, 5, 4);
+	CImage big(128, 96, CH_RGB), bigRef(128, 96, CH_RGB);
+	big.update_patch(patch, 32, 16);
+	bigRef.update_patch(orig, 32, 16);
+	for (unsigned int r = 0; r < ref.getHeight(); r++)
+		for (unsigned int c = 0; c < ref.getWidth(); c++)
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				ASSERT_EQ(*img.get_unsafe(c, r, k), *ref.get_unsafe(c, r, k));
+				ASSERT_EQ(
+					*big.get_unsafe(c + 32, r + 16, k),
+					*bigRef.get_unsafe(c + 32, r + 16, k));
+			}
+}
+
+TEST(CImage, LazyDecodingFromSeveralThreads)
+{
+	CImage orig;
+	fillTestImage(orig, 320, 240, CH_RGB);
+	CMemoryStream buf;
+	buf << orig;
+	CImage ref;
+	CImage::DISABLE_LAZY_DECODING = true;
+	buf.Seek(0);
+	buf >> ref;
+	CImage::DISABLE_LAZY_DECODING = false;
+
+	for (int rep = 0; rep < 10; rep++)
+	{
+		CImage img;
+		buf.Seek(0);
+		buf >> img;
+		ASSERT_TRUE(img.isCompressedResident());
+
+		// All threads access the pixels for the first time at once:
+		const unsigned int nThreads = 4;
+		std::vector<unsigned int> nWrong(nThreads, 0);
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < nThreads; t++)
+			threads.emplace_back([&, t]() {
+				for (unsigned int r = t; r < ref.getHeight(); r += nThreads)
+					for (unsigned int c = 0; c < ref.getWidth(); c++)
+						for (unsigned int k = 0; k < 3; k++)
+							if (*img.get_unsafe(c, r, k) !=
+								*ref.get_unsafe(c, r, k))
+								nWrong[t]++;
+			});
+		for (auto& th : threads) th.join();
+		for (unsigned int t = 0; t < nThreads; t++) EXPECT_EQ(nWrong[t], 0u);
+		EXPECT_FALSE(img.isCompressedResident());
+	}
+}
+
+#endif
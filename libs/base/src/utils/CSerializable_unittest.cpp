@@ -248,3 +248,98 @@ TEST(SerializeTestBase, CastSmartPointers)
 	EXPECT_TRUE(IS_CLASS(p3, CPose2D));
 	EXPECT_TRUE(IS_CLASS(p4, CPose2D));
 }
+
+// Writes a sequence of objects of a few classes (and nullptrs), switching the
+// class dictionary on and off:
+static void writeClassDictTestObjects(CStream& buf, bool dict, size_t N)
+{
+	buf.enableClassDictionary(dict);
+	for (size_t i = 0; i < N; i++)
+	{
+		if (i == N / 2 && dict) buf.enableClassDictionary(false);
+		if (i == 3 * N / 4 && dict) buf.enableClassDictionary(true);
+		switch (i % 4)
+		{
+			case 0:
+				buf.WriteObject(CPose2D(i, 1.0, 0.5));
+				break;
+			case 1:
+				buf.WriteObject(CPoint3D(1.0, i, 2.0));
+				break;
+			case 2:
+				buf.WriteObject(CPose2D(2.0, i, -0.5));
+				break;
+			default:
+				buf.WriteObject(nullptr);
+				break;
+		}
+	}
+}
+
+static void checkClassDictTestObjects(CStream& buf, size_t N)
+{
+	for (size_t i = 0; i < N; i++)
+	{
+		CSerializable::Ptr o = buf.ReadObject();
+		switch (i % 4)
+		{
+			case 0:
+			case 2:
+			{
+				ASSERT_TRUE(o && IS_CLASS(o, CPose2D)) << "i=" << i;
+				const auto p = std::dynamic_pointer_cast<CPose2D>(o);
+				EXPECT_EQ(i % 4 ? 2.0 : double(i), p->x());
+				break;
+			}
+			case 1:
+				ASSERT_TRUE(o && IS_CLASS(o, CPoint3D)) << "i=" << i;
+				EXPECT_EQ(
+					double(i), std::dynamic_pointer_cast<CPoint3D>(o)->y());
+				break;
+			default:
+				EXPECT_FALSE(o) << "i=" << i;
+				break;
+		}
+	}
+}
+
+TEST(SerializeTestBase, ClassDictionary)
+{
+	const size_t N = 400;
+	CMemoryStream bufStd, bufDict;
+	writeClassDictTestObjects(bufStd, false, N);
+	writeClassDictTestObjects(bufDict, true, N);
+	// Only a half of the objects have short headers:
+	EXPECT_LT(bufDict.getTotalBytesCount(), bufStd.getTotalBytesCount());
+
+	// Streams in any format can be read without setting anything, and read
+	// again after seeking back:
+	for (int pass = 0; pass < 2; pass++)
+	{
+		bufStd.Seek(0);
+		checkClassDictTestObjects(bufStd, N);
+		bufDict.Seek(0);
+		checkClassDictTestObjects(bufDict, N);
+	}
+
+	// Objects after a reset in the writer can be read from there:
+	CMemoryStream buf;
+	buf.enableClassDictionary();
+	buf.WriteObject(CPose2D(1, 2, 3));
+	buf.resetClassDictionary();
+	const uint64_t pos = buf.getPosition();
+	buf.WriteObject(CPose2D(4, 5, 6));
+	buf.WriteObject(CPose2D(7, 8, 9));
+	buf.Seek(pos);
+	EXPECT_EQ(4.0, std::dynamic_pointer_cast<CPose2D>(buf.ReadObject())->x());
+	EXPECT_EQ(7.0, std::dynamic_pointer_cast<CPose2D>(buf.ReadObject())->x());
+
+	// But not after an object whose class was defined before that point:
+	CMemoryStream buf2;
+	buf2.enableClassDictionary();
+	buf2.WriteObject(CPose2D(1, 2, 3));
+	const uint64_t pos2 = buf2.getPosition();
+	buf2.WriteObject(CPose2D(4, 5, 6));
+	buf2.Seek(pos2);
+	EXPECT_THROW(buf2.ReadObject(), std::exception);
+}
@@ -18,12 +18,22 @@
 #include <map>
 #include <iostream>
 #include <cstdarg>
+#include <cstring>
 
 #include "internal_class_registry.h"
 
 // 8 bits:
 #define SERIALIZATION_END_FLAG 0x88
 
+// First byte of object headers in the class dictionary mode. Standard
+// headers start with (0x80 | class name length), and names are never
+// longer than 120 chars, so these values are never used by them.
+// Header of the first object of a class: flag, ID (varint), name length,
+// name.
+#define SERIALIZATION_CLASS_DICT_DEFINE 0xFE
+// Header of the next objects of that class: flag, ID (varint).
+#define SERIALIZATION_CLASS_DICT_REF 0xFD
+
 using namespace mrpt;
 using namespace mrpt::utils;
 using namespace mrpt::system;
@@ -155,6 +165,12 @@ CStream& utils::operator<<(mrpt::utils::CStream& out, const std::string& str)
 /*---------------------------------------------------------------
 			Writes an object to the stream.
  ---------------------------------------------------------------*/
+void CStream::resetClassDictionary()
+{
+	m_class_dict_write.clear();
+	m_class_dict_read.clear();
+}
+
 void CStream::WriteObject(const CSerializable* o)
 {
 	MRPT_START
@@ -162,22 +178,51 @@ void CStream::WriteObject(const CSerializable* o)
 	int version;
 
 	// First, the "classname".
-	const char* className;
-	if (o != nullptr)
+	const TRuntimeClassId* classId =
+		o != nullptr ? o->GetRuntimeClass() : nullptr;
+	const char* className = classId ? classId->className : "nullptr";
+
+	if (!m_class_dict_enabled)
 	{
-		className = o->GetRuntimeClass()->className;
+		int8_t classNamLen = strlen(className);
+		int8_t classNamLen_mod = classNamLen | 0x80;
+
+		(*this) << classNamLen_mod;
+		this->WriteBuffer(className, classNamLen);
 	}
 	else
 	{
-		className = "nullptr";
+		// The class name only the first time, then its ID:
+		uint8_t buf[2 + 5 + 1 + 120];
+		size_t n = 0;
+		auto it = m_class_dict_write.find(classId);
+		const bool isNew = (it == m_class_dict_write.end());
+		if (isNew)
+		{
+			const uint32_t newID = m_class_dict_write.size();
+			it = m_class_dict_write.insert(std::make_pair(classId, newID))
+					 .first;
+		}
+		buf[n++] = isNew ? SERIALIZATION_CLASS_DICT_DEFINE
+						 : SERIALIZATION_CLASS_DICT_REF;
+		// Variable-length ID: 7 bits per byte, MSB set if more bytes follow
+		uint32_t id = it->second;
+		do
+		{
+			buf[n++] = (id & 0x7F) | (id > 0x7F ? 0x80 : 0);
+			id >>= 7;
+		} while (id);
+		if (isNew)
+		{
+			const size_t len = strlen(className);
+			ASSERT_(len <= 120);
+			buf[n++] = uint8_t(len);
+			memcpy(&buf[n], className, len);
+			n += len;
+		}
+		this->WriteBuffer(buf, n);
 	}
 
-	int8_t classNamLen = strlen(className);
-	int8_t classNamLen_mod = classNamLen | 0x80;
-
-	(*this) << classNamLen_mod;
-	this->WriteBuffer(className, classNamLen);
-
 	// Next, the version number:
 	if (o != nullptr)
 	{
@@ -417,12 +462,13 @@ CStream& utils::operator>>(mrpt::utils::CStream& in, char* s)
 //#define CSTREAM_VERBOSE     1
 #define CSTREAM_VERBOSE 0
 
-void CStream::internal_ReadObjectHeader(
-	std::string& strClassName, bool& isOldFormat, int8_t& version)
+const TRuntimeClassId* CStream::internal_ReadObjectHeader(
+	bool& isOldFormat, int8_t& version)
 {
 	uint8_t lengthReadClassName = 255;
 	char readClassName[260];
 	readClassName[0] = 0;
+	const TRuntimeClassId* classId = nullptr;
 
 	try
 	{
@@ -433,42 +479,103 @@ void CStream::internal_ReadObjectHeader(
 				(void*)&lengthReadClassName, sizeof(lengthReadClassName)))
 			THROW_EXCEPTION("Cannot read object header from stream! (EOF?)");
 
-		// Is in old format (< MRPT 0.5.5)?
-		if (!(lengthReadClassName & 0x80))
+		if (lengthReadClassName == SERIALIZATION_CLASS_DICT_DEFINE ||
+			lengthReadClassName == SERIALIZATION_CLASS_DICT_REF)
 		{
-			isOldFormat = true;
-			uint8_t buf[3];
-			if (3 != ReadBuffer(buf, 3))
-				THROW_EXCEPTION(
-					"Cannot read object header from stream! (EOF?)");
-			if (buf[0] || buf[1] || buf[2])
-				THROW_EXCEPTION(
-					"Expecting 0x00 00 00 while parsing old streaming header "
-					"(Perhaps it's a gz-compressed stream? Use a GZ-stream for "
-					"reading)");
+			// Class dictionary mode:
+			isOldFormat = false;
+			uint32_t id = 0;
+			for (int shift = 0;; shift += 7)
+			{
+				uint8_t b;
+				if (shift > 28 || 1 != ReadBuffer(&b, 1))
+					THROW_EXCEPTION("Cannot read object class ID from stream!");
+				id |= uint32_t(b & 0x7F) << shift;
+				if (!(b & 0x80)) break;
+			}
+			if (lengthReadClassName == SERIALIZATION_CLASS_DICT_DEFINE)
+			{
+				uint8_t len;
+				if (1 != ReadBuffer(&len, 1) || len > 120 ||
+					len != ReadBuffer(readClassName, len))
+					THROW_EXCEPTION(
+						"Cannot read object class name from stream!");
+				readClassName[len] = '\0';
+
+				if (strcmp(readClassName, "nullptr"))
+				{
+					classId = findRegisteredClass(readClassName);
+					if (!classId)
+						THROW_EXCEPTION_FMT(
+							"Stored object has class '%s' which is not "
+							"registered!",
+							readClassName);
+				}
+				if (id >= m_class_dict_read.size())
+					m_class_dict_read.resize(
+						id + 1, std::make_pair(nullptr, false));
+				m_class_dict_read[id] = std::make_pair(classId, true);
+			}
+			else
+			{
+				if (id >= m_class_dict_read.size() ||
+					!m_class_dict_read[id].second)
+					THROW_EXCEPTION_FMT(
+						"Object class ID %u not defined in this stream! "
+						"(Reading from the middle of a stream written with "
+						"CStream::enableClassDictionary()?)",
+						static_cast<unsigned int>(id));
+				classId = m_class_dict_read[id].first;
+				strcpy(
+					readClassName, classId ? classId->className : "nullptr");
+			}
 		}
 		else
 		{
-			isOldFormat = false;
-		}
+			// Is in old format (< MRPT 0.5.5)?
+			if (!(lengthReadClassName & 0x80))
+			{
+				isOldFormat = true;
+				uint8_t buf[3];
+				if (3 != ReadBuffer(buf, 3))
+					THROW_EXCEPTION(
+						"Cannot read object header from stream! (EOF?)");
+				if (buf[0] || buf[1] || buf[2])
+					THROW_EXCEPTION(
+						"Expecting 0x00 00 00 while parsing old streaming "
+						"header (Perhaps it's a gz-compressed stream? Use a "
+						"GZ-stream for reading)");
+			}
+			else
+			{
+				isOldFormat = false;
+			}
 
-		// Remove MSB:
-		lengthReadClassName &= 0x7F;
+			// Remove MSB:
+			lengthReadClassName &= 0x7F;
 
-		// Sensible class name size?
-		if (lengthReadClassName > 120)
-			THROW_EXCEPTION(
-				"Class name has more than 120 chars. This probably means a "
-				"corrupted binary stream.");
+			// Sensible class name size?
+			if (lengthReadClassName > 120)
+				THROW_EXCEPTION(
+					"Class name has more than 120 chars. This probably means a "
+					"corrupted binary stream.");
 
-		if (((size_t)lengthReadClassName) !=
-			ReadBuffer(readClassName, lengthReadClassName))
-			THROW_EXCEPTION("Cannot read object class name from stream!");
+			if (((size_t)lengthReadClassName) !=
+				ReadBuffer(readClassName, lengthReadClassName))
+				THROW_EXCEPTION("Cannot read object class name from stream!");
 
-		readClassName[lengthReadClassName] = '\0';
+			readClassName[lengthReadClassName] = '\0';
 
-		// Pass to string class:
-		strClassName = readClassName;
+			if (strcmp(readClassName, "nullptr"))
+			{
+				classId = findRegisteredClass(readClassName);
+				if (!classId)
+					THROW_EXCEPTION_FMT(
+						"Stored object has class '%s' which is not "
+						"registered!",
+						readClassName);
+			}
+		}
 
 		// Next, the version number:
 		if (isOldFormat)
@@ -483,7 +590,7 @@ void CStream::internal_ReadObjectHeader(
 			version = int8_t(version_old);
 		}
 		else if (
-			strClassName != "nullptr" &&
+			classId &&
 			sizeof(version) != ReadBuffer((void*)&version, sizeof(version)))
 		{
 			THROW_EXCEPTION(
@@ -492,7 +599,7 @@ void CStream::internal_ReadObjectHeader(
 
 // In MRPT 0.5.5 an end flag was introduced:
 #if CSTREAM_VERBOSE
-		cerr << "[CStream::ReadObject] readClassName:" << strClassName
+		cerr << "[CStream::ReadObject] readClassName:" << readClassName
 			 << " version: " << version << endl;
 #endif
 	}
@@ -518,10 +625,11 @@ void CStream::internal_ReadObjectHeader(
 	{
 		THROW_EXCEPTION("Unexpected runtime error!");
 	}
+	return classId;
 }  // end method
 
 void CStream::internal_ReadObject(
-	CSerializable* obj, const std::string& strClassName, bool isOldFormat,
+	CSerializable* obj, const TRuntimeClassId* classId, bool isOldFormat,
 	int8_t version)
 {
 	try
@@ -541,7 +649,7 @@ void CStream::internal_ReadObject(
 				THROW_EXCEPTION_FMT(
 					"end-flag missing: There is a bug in the deserialization "
 					"method of class: '%s'",
-					strClassName.c_str());
+					classId ? classId->className : "nullptr");
 		}
 	}
 	catch (std::bad_alloc&)
@@ -565,22 +673,16 @@ void CStream::internal_ReadObject(
  ---------------------------------------------------------------*/
 void CStream::ReadObject(CSerializable* existingObj)
 {
-	std::string strClassName;
 	bool isOldFormat;
 	int8_t version;
 
-	internal_ReadObjectHeader(strClassName, isOldFormat, version);
+	const TRuntimeClassId* id2 =
+		internal_ReadObjectHeader(isOldFormat, version);
 
-	ASSERT_(existingObj && strClassName != "nullptr");
-	ASSERT_(strClassName != "nullptr");
+	ASSERT_(existingObj && id2);
 
 	const TRuntimeClassId* id = existingObj->GetRuntimeClass();
-	const TRuntimeClassId* id2 = findRegisteredClass(strClassName);
 
-	if (!id2)
-		THROW_EXCEPTION_FMT(
-			"Stored object has class '%s' which is not registered!",
-			strClassName.c_str());
 	if (id != id2)
 		THROW_EXCEPTION(
 			format(
@@ -588,7 +690,7 @@ void CStream::ReadObject(CSerializable* existingObj)
 				"%s\n Expected: %s",
 				id2->className, id->className));
 
-	internal_ReadObject(existingObj, strClassName, isOldFormat, version);
+	internal_ReadObject(existingObj, id2, isOldFormat, version);
 }
 
 /*---------------------------------------------------------------
@@ -0,0 +1,67 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include "base-precomp.h"  // Precompiled headers
+
+#include <mrpt/utils/CWorkerThreadsPool.h>
+
+using namespace mrpt::utils;
+
+CWorkerThreadsPool::CWorkerThreadsPool(std::size_t num_threads)
+	: m_do_stop(false)
+{
+	resize(num_threads);
+}
+
+CWorkerThreadsPool::~CWorkerThreadsPool() { clear(); }
+void CWorkerThreadsPool::resize(std::size_t num_threads)
+{
+	if (num_threads == m_threads.size()) return;
+	clear();
+
+	m_do_stop = false;
+	for (std::size_t i = 0; i < num_threads; i++)
+		m_threads.emplace_back([this]() { workerThreadLoop(); });
+}
+
+void CWorkerThreadsPool::clear()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_queue_mutex);
+		m_do_stop = true;
+	}
+	m_condition.notify_all();
+	// Threads only quit once the queue is empty:
+	for (auto& t : m_threads)
+		if (t.joinable()) t.join();
+	m_threads.clear();
+}
+
+std::size_t CWorkerThreadsPool::pendingTasks() const
+{
+	std::unique_lock<std::mutex> lock(m_queue_mutex);
+	return m_tasks.size();
+}
+
+void CWorkerThreadsPool::workerThreadLoop()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_queue_mutex);
+			m_condition.wait(
+				lock, [this] { return m_do_stop || !m_tasks.empty(); });
+			if (m_do_stop && m_tasks.empty()) return;
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+		}
+		task();
+	}
+}
@@ -0,0 +1,43 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include "base-precomp.h"  // Precompiled headers
+
+#include <mrpt/utils/CWorkerThreadsPoolHolder.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
+
+using namespace mrpt::utils;
+
+CWorkerThreadsPoolHolder::CWorkerThreadsPoolHolder() {}
+// Copies do not share the pool:
+CWorkerThreadsPoolHolder::CWorkerThreadsPoolHolder(
+	const CWorkerThreadsPoolHolder&)
+{
+}
+
+CWorkerThreadsPoolHolder& CWorkerThreadsPoolHolder::operator=(
+	const CWorkerThreadsPoolHolder& o)
+{
+	if (this != &o)
+	{
+		std::unique_lock<std::mutex> lock(m_pool_mutex);
+		m_pool.reset();
+	}
+	return *this;
+}
+
+CWorkerThreadsPoolHolder::~CWorkerThreadsPoolHolder() {}
+CWorkerThreadsPool* CWorkerThreadsPoolHolder::get(std::size_t num_threads) const
+{
+	if (num_threads <= 1) return nullptr;
+	std::unique_lock<std::mutex> lock(m_pool_mutex);
+	if (!m_pool || m_pool->size() != num_threads)
+		m_pool.reset(new CWorkerThreadsPool(num_threads));
+	return m_pool.get();
+}
@@ -0,0 +1,103 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/utils/CWorkerThreadsPool.h>
+#include <mrpt/utils/CWorkerThreadsPoolHolder.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <numeric>
+
+using namespace mrpt::utils;
+
+TEST(CWorkerThreadsPool, enqueue)
+{
+	for (size_t nThreads : {0, 1, 3})
+	{
+		CWorkerThreadsPool pool(nThreads);
+		EXPECT_EQ(pool.size(), nThreads);
+
+		std::vector<std::future<int>> futs;
+		for (int i = 0; i < 20; i++)
+			futs.emplace_back(pool.enqueue([](int a) { return 2 * a; }, i));
+		for (int i = 0; i < 20; i++) EXPECT_EQ(futs[i].get(), 2 * i);
+	}
+}
+
+TEST(CWorkerThreadsPool, parallelChunks)
+{
+	for (size_t nThreads : {0, 1, 2, 4})
+	{
+		CWorkerThreadsPool pool(nThreads);
+		for (size_t N : {0, 1, 3, 100, 1001})
+		{
+			std::vector<int> v(N, 0);
+			std::atomic<size_t> nCalls(0);
+			const size_t nChunks = pool.parallelChunks(
+				N, [&](size_t first, size_t last, size_t chunk) {
+					EXPECT_EQ(
+						first, CWorkerThreadsPool::chunkStart(
+								   N, pool.numChunksFor(N), chunk));
+					for (size_t i = first; i < last; i++) v[i]++;
+					nCalls++;
+				});
+			EXPECT_EQ(nChunks, nCalls.load());
+			EXPECT_EQ(nChunks, pool.numChunksFor(N));
+			// Each element visited exactly once:
+			EXPECT_EQ(std::accumulate(v.begin(), v.end(), 0), int(N));
+			for (int x : v) EXPECT_EQ(x, 1);
+		}
+	}
+}
+
+TEST(CWorkerThreadsPool, resize)
+{
+	CWorkerThreadsPool pool(2);
+	std::atomic<int> cnt(0);
+	for (int i = 0; i < 50; i++) pool.enqueue([&cnt]() { cnt++; });
+	pool.resize(3);  // Waits for pending tasks
+	EXPECT_EQ(cnt.load(), 50);
+	EXPECT_EQ(pool.size(), 3u);
+	pool.clear();
+	EXPECT_EQ(pool.size(), 0u);
+}
+
+TEST(CWorkerThreadsPoolHolder, get)
+{
+	CWorkerThreadsPoolHolder h;
+	EXPECT_TRUE(h.get(0) == nullptr);
+	EXPECT_TRUE(h.get(1) == nullptr);
+
+	CWorkerThreadsPool* p = h.get(3);
+	ASSERT_TRUE(p != nullptr);
+	EXPECT_EQ(p->size(), 3u);
+	EXPECT_EQ(h.get(3), p);  // Kept alive
+	EXPECT_EQ(h.get(2)->size(), 2u);
+}
+
+TEST(CWorkerThreadsPoolHolder, copiesDoNotSharePools)
+{
+	CWorkerThreadsPoolHolder h1;
+	CWorkerThreadsPool* p1 = h1.get(2);
+
+	CWorkerThreadsPoolHolder h2(h1);
+	CWorkerThreadsPool* p2 = h2.get(2);
+	ASSERT_TRUE(p2 != nullptr);
+	EXPECT_NE(p1, p2);
+
+	CWorkerThreadsPoolHolder h3;
+	h3.get(4);
+	h3 = h1;
+	CWorkerThreadsPool* p3 = h3.get(2);
+	EXPECT_NE(p1, p3);
+	EXPECT_EQ(p3->size(), 2u);
+
+	// The source pool is untouched:
+	EXPECT_EQ(h1.get(2), p1);
+	EXPECT_EQ(p1->size(), 2u);
+}
@@ -42,7 +42,12 @@ enum TKFMethod
 	kfEKFNaive = 0,
 	kfEKFAlaDavison,
 	kfIKFFull,
-	kfIKF
+	kfIKF,
+	/** Compressed EKF: only the vehicle and the landmarks in the active local
+	 * region are updated at each step, while the update of the rest of the
+	 * map is deferred until the robot leaves that region. See
+	 * bayes::CKalmanFilterCapable::makeSureStateIsUpToDate() */
+	kfEKFCompressed
 };
 
 // Forward declaration:
@@ -59,6 +64,7 @@ struct TKF_options : public mrpt::utils::CLoadableOptions
 		: method(kfEKFNaive),
 		  verbosity_level(verb_level_ref),
 		  IKF_iterations(5),
+		  compressed_max_idle_landmarks(50),
 		  enable_profiler(false),
 		  use_analytic_transition_jacobian(true),
 		  use_analytic_observation_jacobian(true),
@@ -75,6 +81,8 @@ struct TKF_options : public mrpt::utils::CLoadableOptions
 		verbosity_level = iniFile.read_enum<mrpt::utils::VerbosityLevel>(
 			section, "verbosity_level", verbosity_level);
 		MRPT_LOAD_CONFIG_VAR(IKF_iterations, int, iniFile, section);
+		MRPT_LOAD_CONFIG_VAR(
+			compressed_max_idle_landmarks, int, iniFile, section);
 		MRPT_LOAD_CONFIG_VAR(enable_profiler, bool, iniFile, section);
 		MRPT_LOAD_CONFIG_VAR(
 			use_analytic_transition_jacobian, bool, iniFile, section);
@@ -102,6 +110,9 @@ struct TKF_options : public mrpt::utils::CLoadableOptions
 				.c_str());
 		out.printf(
 			"IKF_iterations                          = %i\n", IKF_iterations);
+		out.printf(
+			"compressed_max_idle_landmarks           = %i\n",
+			compressed_max_idle_landmarks);
 		out.printf(
 			"enable_profiler                         = %c\n",
 			enable_profiler ? 'Y' : 'N');
@@ -113,6 +124,11 @@ struct TKF_options : public mrpt::utils::CLoadableOptions
 	mrpt::utils::VerbosityLevel& verbosity_level;
 	/** Number of refinement iterations, only for the IKF method. */
 	int IKF_iterations;
+	/** Only for the kfEKFCompressed method: the active local region is
+	 * closed (and the deferred global update applied) when it contains more
+	 * than this number of landmarks which were not predicted in the last
+	 * iteration (default=50). */
+	int compressed_max_idle_landmarks;
 	/** If enabled (default=false), detailed timing information will be dumped
 	 * to the console thru a CTimerLog at the end of the execution. */
 	bool enable_profiler;
@@ -285,6 +301,7 @@ class CKalmanFilterCapable : public mrpt::utils::COutputLogger
 	inline void getLandmarkMean(size_t idx, KFArray_FEAT& feat) const
 	{
 		ASSERT_(idx < getNumberOfLandmarksInTheMap())
+		makeSureStateIsUpToDate();
 		::memcpy(
 			&feat[0], &m_xkk[VEH_SIZE + idx * FEAT_SIZE],
 			FEAT_SIZE * sizeof(m_xkk[0]));
@@ -295,6 +312,7 @@ class CKalmanFilterCapable : public mrpt::utils::COutputLogger
 	  */
 	inline void getLandmarkCov(size_t idx, KFMatrix_FxF& feat_cov) const
 	{
+		makeSureStateIsUpToDate();
 		m_pkk.extractMatrix(
 			VEH_SIZE + idx * FEAT_SIZE, VEH_SIZE + idx * FEAT_SIZE, feat_cov);
 	}
@@ -310,6 +328,23 @@ class CKalmanFilterCapable : public mrpt::utils::COutputLogger
 
 	/** @} */
 
+   public:
+	/** With the kfEKFCompressed method, the means and covariances of the
+	 * landmarks out of the active local region are not updated at each
+	 * iteration: this method applies all the pending updates, so m_xkk and
+	 * m_pkk hold the complete, current state of the filter. It is a cheap
+	 * no-op for the other methods or if there is nothing pending.
+	 *  Derived classes must call it before reading the parts of m_xkk or
+	 * m_pkk related to landmarks (except from within the virtual methods
+	 * invoked by runOneKalmanIteration()).
+	 */
+	void makeSureStateIsUpToDate() const
+	{
+		if (m_CEKF_state_len != 0)
+			const_cast<KFCLASS*>(this)->CEKF_globalUpdate();
+	}
+
+   protected:
 	mrpt::utils::CTimeLogger m_timLogger;
 
 	/** @name Virtual methods for Kalman Filter implementation
@@ -613,6 +648,8 @@ class CKalmanFilterCapable : public mrpt::utils::COutputLogger
 	CKalmanFilterCapable()
 		: mrpt::utils::COutputLogger("CKalmanFilterCapable"),
 		  KF_options(this->m_min_verbosity_level),
+		  m_CEKF_num_lms0(0),
+		  m_CEKF_state_len(0),
 		  m_user_didnt_implement_jacobian(true)
 	/** Default constructor */ {}
 	/** Destructor */
@@ -639,6 +676,24 @@ class CKalmanFilterCapable : public mrpt::utils::COutputLogger
 	KFMatrix dh_dx_full_obs;
 	KFMatrix aux_K_dh_dx;
 
+	/** @name State of the compressed EKF (kfEKFCompressed)
+		@{ */
+	/** The landmarks in the active local region. The first m_CEKF_num_lms0
+	 * ones were already there when the region was created. */
+	vector_size_t m_CEKF_active_lms;
+	size_t m_CEKF_num_lms0;
+	/** Length of the state vector, or 0 if there is no active region. */
+	size_t m_CEKF_state_len;
+	/** Auxiliary matrices of the compressed filter: the cross covariances
+	 * between the active region (A) and the rest of the map (B) are
+	 * \f$ P_{AB} = \Phi P_{A_0B} \f$, and the pending global update is
+	 * \f$ P_{BB} \leftarrow P_{BB} - P_{BA_0} \Psi P_{A_0B} \f$,
+	 * \f$ x_B \leftarrow x_B + P_{BA_0} \theta \f$, with \f$ A_0 \f$ the
+	 * active region at the time it was created. */
+	KFMatrix m_CEKF_phi, m_CEKF_psi;
+	KFVector m_CEKF_theta;
+	/** @} */
+
    protected:
 	/** The main entry point, executes one complete step: prediction + update.
 	  *  It is protected since derived classes must provide a problem-specific
@@ -651,6 +706,20 @@ class CKalmanFilterCapable : public mrpt::utils::COutputLogger
    private:
 	mutable bool m_user_didnt_implement_jacobian;
 
+	/** Compressed EKF: creates a new active region (with the state up to date)
+	 * if there is none, or if it does not contain all the given landmarks or
+	 * has too many idle ones. Returns true if a global update was applied. */
+	bool CEKF_activateLandmarks(const vector_size_t& lm_idxs);
+	/** Compressed EKF: applies the pending global update and closes the active
+	 * region. */
+	void CEKF_globalUpdate();
+	/** Compressed EKF: a new landmark has been appended to the state vector,
+	 * with the given Jacobian wrt the vehicle pose. */
+	void CEKF_addNewLandmark(const KFMatrix_FxV& dyn_dxv);
+	/** Compressed EKF: the indices in the state vector of the vehicle and the
+	 * landmarks in the active region, in the order of the rows of Phi. */
+	void CEKF_getActiveStateIndices(vector_size_t& idxs) const;
+
 	/** Auxiliary functions for Jacobian numeric estimation */
 	static void KF_aux_estimate_trans_jacobian(
 		const KFArray_VEH& x, const std::pair<KFCLASS*, KFArray_ACT>& dat,
@@ -691,6 +760,7 @@ struct TEnumTypeFiller<bayes::TKFMethod>
 		m_map.insert(bayes::kfEKFAlaDavison, "kfEKFAlaDavison");
 		m_map.insert(bayes::kfIKFFull, "kfIKFFull");
 		m_map.insert(bayes::kfIKF, "kfIKF");
+		m_map.insert(bayes::kfEKFCompressed, "kfEKFCompressed");
 	}
 };
 }  // End of namespace
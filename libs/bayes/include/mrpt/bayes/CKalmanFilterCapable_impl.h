@@ -32,6 +32,18 @@ void CKalmanFilterCapable<VEH_SIZE, OBS_SIZE, FEAT_SIZE, ACT_SIZE,
 	ASSERT_(size_t(m_xkk.size()) == m_pkk.getColCount())
 	ASSERT_(size_t(m_xkk.size()) >= VEH_SIZE)
 
+	// The compressed EKF only makes sense for SLAM-like problems:
+	const bool compressed =
+		FEAT_SIZE != 0 && KF_options.method == kfEKFCompressed;
+	const TKFMethod method =
+		(KF_options.method == kfEKFCompressed && !compressed)
+			? kfEKFNaive
+			: KF_options.method;
+	if (!compressed)
+		makeSureStateIsUpToDate();  // In case the method was just changed.
+	else if (m_CEKF_state_len != size_t(m_xkk.size()))
+		m_CEKF_state_len = 0;  // The filter was reset: forget the region.
+
 	// =============================================================
 	//  1. CREATE ACTION MATRIX u FROM ODOMETRY
 	// =============================================================
@@ -140,10 +152,15 @@ void CKalmanFilterCapable<VEH_SIZE, OBS_SIZE, FEAT_SIZE, ACT_SIZE,
 		// ====================================
 		//  3.2:  All Pxy_i
 		// ====================================
-		// Now, update the cov. of landmarks, if any:
+		// Now, update the cov. of landmarks, if any (with the compressed
+		// EKF, only those in the active region, the rest goes into Phi):
+		const bool in_region = compressed && m_CEKF_state_len != 0;
+		const size_t N_upd_lms =
+			in_region ? m_CEKF_active_lms.size() : N_map;
 		KFMatrix_VxF aux;
-		for (size_t i = 0; i < N_map; i++)
+		for (size_t j = 0; j < N_upd_lms; j++)
 		{
+			const size_t i = in_region ? m_CEKF_active_lms[j] : j;
 			aux = dfv_dxv *
 				  Eigen::Block<typename KFMatrix::Base, VEH_SIZE, FEAT_SIZE>(
 					  m_pkk, 0, VEH_SIZE + i * FEAT_SIZE);
@@ -153,6 +170,9 @@ void CKalmanFilterCapable<VEH_SIZE, OBS_SIZE, FEAT_SIZE, ACT_SIZE,
 			Eigen::Block<typename KFMatrix::Base, FEAT_SIZE, VEH_SIZE>(
 				m_pkk, VEH_SIZE + i * FEAT_SIZE, 0) = aux.transpose();
 		}
+		if (in_region)
+			m_CEKF_phi.topRows(VEH_SIZE) =
+				dfv_dxv * m_CEKF_phi.topRows(VEH_SIZE);
 
 		// =============================================================
 		//  4. NOW WE CAN OVERWRITE THE NEW STATE VECTOR
@@ -258,6 +278,14 @@ void CKalmanFilterCapable<VEH_SIZE, OBS_SIZE, FEAT_SIZE, ACT_SIZE,
 			missing_predictions_to_add.clear();
 		}
 
+		// Compressed EKF: all the landmarks involved in S must be in the
+		// active region. Otherwise, the pending global update is applied
+		// and a new region is created, so the predictions are now stale:
+		if (compressed && CEKF_activateLandmarks(predictLMidxs))
+			OnObservationModel(
+				mrpt::math::sequenceStdVec<size_t, 1>(0, N_map),
+				all_predictions);
+
 		Hxs.resize(N_pred);  // Append new entries, if needed.
 		Hys.resize(N_pred);
 
@@ -467,7 +495,7 @@ void CKalmanFilterCapable<VEH_SIZE, OBS_SIZE, FEAT_SIZE, ACT_SIZE,
 	{
 		m_timLogger.enter("KF:8.update stage");
 
-		switch (KF_options.method)
+		switch (method)
 		{
 			// -----------------------
 			//  FULL KF- METHOD
@@ -495,9 +523,8 @@ void CKalmanFilterCapable<VEH_SIZE, OBS_SIZE, FEAT_SIZE, ACT_SIZE,
 							.size();  // SLAM: # of observed known landmarks
 
 				// Just one, or several update iterations??
-				const size_t nKF_iterations = (KF_options.method == kfEKFNaive)
-												  ? 1
-												  : KF_options.IKF_iterations;
+				const size_t nKF_iterations =
+					(method == kfEKFNaive) ? 1 : KF_options.IKF_iterations;
 
 				const KFVector xkk_0 = m_xkk;
 
@@ -889,6 +916,93 @@ void CKalmanFilterCapable<VEH_SIZE, OBS_SIZE, FEAT_SIZE, ACT_SIZE,
 			}
 			break;
 
+			// --------------------------------------------------------------------
+			// - Compressed EKF: update of the active local region only
+			// --------------------------------------------------------------------
+			case kfEKFCompressed:
+			{
+				// Only observations of known landmarks, which are all in
+				// the active region (see CEKF_activateLandmarks()):
+				const size_t N_upd = data_association.size() -
+									 std::count(
+										 data_association.begin(),
+										 data_association.end(), -1);
+				if (N_upd == 0) break;
+
+				vector_size_t idxA;
+				CEKF_getActiveStateIndices(idxA);
+				const size_t nA = idxA.size();
+
+				m_timLogger.enter("KF:8.update stage:1.CEKF:build K");
+
+				KFVector ytilde(OBS_SIZE * N_upd);
+				dh_dx_full_obs.zeros(OBS_SIZE * N_upd, nA);
+				vector_size_t S_idxs;
+				S_idxs.reserve(OBS_SIZE * N_upd);
+				for (size_t i = 0; i < data_association.size(); ++i)
+				{
+					if (data_association[i] < 0) continue;
+					const size_t lm_idx =
+						static_cast<size_t>(data_association[i]);
+					const size_t idx_in_pred =
+						mrpt::utils::find_in_vector(lm_idx, predictLMidxs);
+					const size_t idx_in_A =
+						mrpt::utils::find_in_vector(lm_idx, m_CEKF_active_lms);
+					ASSERTDEB_(
+						idx_in_pred != string::npos &&
+						idx_in_A != string::npos)
+
+					const size_t row = S_idxs.size();
+					Eigen::Block<typename KFMatrix::Base, OBS_SIZE, VEH_SIZE>(
+						dh_dx_full_obs, row, 0) = Hxs[idx_in_pred];
+					Eigen::Block<typename KFMatrix::Base, OBS_SIZE, FEAT_SIZE>(
+						dh_dx_full_obs, row, VEH_SIZE + idx_in_A * FEAT_SIZE) =
+						Hys[idx_in_pred];
+
+					KFArray_OBS ytilde_i = Z[i];
+					OnSubstractObservationVectors(
+						ytilde_i, all_predictions[lm_idx]);
+					for (size_t k = 0; k < OBS_SIZE; k++)
+					{
+						ytilde[row + k] = ytilde_i[k];
+						S_idxs.push_back(idx_in_pred * OBS_SIZE + k);
+					}
+				}
+				KFMatrix S_observed;
+				S.extractSubmatrixSymmetrical(S_idxs, S_observed);
+				S_observed.inv(S_1);
+
+				// K = P_AA * (~dh_dx) * S.inv()
+				m_pkk.extractSubmatrixSymmetrical(idxA, Pkk_subset);
+				K.multiply_ABt(Pkk_subset, dh_dx_full_obs);
+				K *= S_1;
+
+				m_timLogger.leave("KF:8.update stage:1.CEKF:build K");
+				m_timLogger.enter("KF:8.update stage:2.CEKF:update");
+
+				// Accumulate the deferred update of the rest of the map,
+				// before modifying Phi:
+				const KFMatrix H_phi = dh_dx_full_obs * m_CEKF_phi;
+				const KFMatrix H_phi_t_S_1 = H_phi.transpose() * S_1;
+				m_CEKF_psi += H_phi_t_S_1 * H_phi;
+				m_CEKF_theta += H_phi_t_S_1 * ytilde;
+				m_CEKF_phi -= K * H_phi;
+
+				// Mean and covariance of the active region:
+				const KFVector dx = K * ytilde;
+				for (size_t r = 0; r < nA; r++) m_xkk[idxA[r]] += dx[r];
+
+				// P_AA = P_AA - K * dh_dx * P_AA
+				const KFMatrix K_H_P = K * (dh_dx_full_obs * Pkk_subset);
+				for (size_t r = 0; r < nA; r++)
+					for (size_t c = r; c < nA; c++)
+						m_pkk(idxA[r], idxA[c]) = m_pkk(idxA[c], idxA[r]) =
+							Pkk_subset(r, c) - K_H_P(r, c);
+
+				m_timLogger.leave("KF:8.update stage:2.CEKF:update");
+			}
+			break;
+
 			// --------------------------------------------------------------------
 			// - IKF method, processing each observation scalar secuentially:
 			// --------------------------------------------------------------------
@@ -1191,6 +1305,133 @@ void CKalmanFilterCapable<VEH_SIZE, OBS_SIZE, FEAT_SIZE, ACT_SIZE,
 	MRPT_END
 }  // End of "runOneKalmanIteration"
 
+template <size_t VEH_SIZE, size_t OBS_SIZE, size_t FEAT_SIZE, size_t ACT_SIZE,
+		  typename KFTYPE>
+void CKalmanFilterCapable<VEH_SIZE, OBS_SIZE, FEAT_SIZE, ACT_SIZE, KFTYPE>::
+	CEKF_getActiveStateIndices(vector_size_t& idxs) const
+{
+	idxs.resize(VEH_SIZE + FEAT_SIZE * m_CEKF_active_lms.size());
+	for (size_t i = 0; i < VEH_SIZE; i++) idxs[i] = i;
+	size_t n = VEH_SIZE;
+	for (const size_t lm_idx : m_CEKF_active_lms)
+		for (size_t k = 0; k < FEAT_SIZE; k++)
+			idxs[n++] = VEH_SIZE + lm_idx * FEAT_SIZE + k;
+}
+
+template <size_t VEH_SIZE, size_t OBS_SIZE, size_t FEAT_SIZE, size_t ACT_SIZE,
+		  typename KFTYPE>
+bool CKalmanFilterCapable<VEH_SIZE, OBS_SIZE, FEAT_SIZE, ACT_SIZE, KFTYPE>::
+	CEKF_activateLandmarks(const vector_size_t& lm_idxs)
+{
+	if (m_CEKF_state_len != 0)
+	{
+		std::vector<bool> is_active(getNumberOfLandmarksInTheMap(), false);
+		for (const size_t lm_idx : m_CEKF_active_lms) is_active[lm_idx] = true;
+		bool all_active = true;
+		for (const size_t lm_idx : lm_idxs)
+			if (!is_active[lm_idx])
+			{
+				all_active = false;
+				break;
+			}
+		const size_t max_idle =
+			std::max(0, KF_options.compressed_max_idle_landmarks);
+		if (all_active &&
+			m_CEKF_active_lms.size() <= lm_idxs.size() + max_idle)
+			return false;  // Keep working in the current region.
+	}
+
+	const bool had_region = (m_CEKF_state_len != 0);
+	CEKF_globalUpdate();
+
+	// Start a new region, with Phi=I, Psi=0, theta=0:
+	m_CEKF_active_lms = lm_idxs;
+	m_CEKF_num_lms0 = lm_idxs.size();
+	const size_t n0 = VEH_SIZE + FEAT_SIZE * m_CEKF_num_lms0;
+	m_CEKF_phi.setIdentity(n0, n0);
+	m_CEKF_psi.setZero(n0, n0);
+	m_CEKF_theta.setZero(n0);
+	m_CEKF_state_len = m_xkk.size();
+	return had_region;
+}
+
+template <size_t VEH_SIZE, size_t OBS_SIZE, size_t FEAT_SIZE, size_t ACT_SIZE,
+		  typename KFTYPE>
+void CKalmanFilterCapable<VEH_SIZE, OBS_SIZE, FEAT_SIZE, ACT_SIZE,
+						  KFTYPE>::CEKF_globalUpdate()
+{
+	if (m_CEKF_state_len == 0) return;
+	if (m_CEKF_state_len != size_t(m_xkk.size()))
+	{
+		// The filter has been reset, there is nothing to update:
+		m_CEKF_state_len = 0;
+		return;
+	}
+	m_timLogger.enter("KF:CEKF global update");
+
+	// A: the active region (A0: the region when created), B: the rest.
+	vector_size_t idxA, idxB;
+	CEKF_getActiveStateIndices(idxA);
+	std::vector<bool> in_A(m_xkk.size(), false);
+	for (const size_t i : idxA) in_A[i] = true;
+	for (size_t i = 0; i < in_A.size(); i++)
+		if (!in_A[i]) idxB.push_back(i);
+
+	const size_t nA = idxA.size(), nB = idxB.size();
+	const size_t n0 = VEH_SIZE + FEAT_SIZE * m_CEKF_num_lms0;
+	if (nB > 0)
+	{
+		// P_A0B, still as it was when the region was created:
+		KFMatrix P_A0B(n0, nB);
+		for (size_t r = 0; r < n0; r++)
+			for (size_t c = 0; c < nB; c++)
+				P_A0B(r, c) = m_pkk(idxA[r], idxB[c]);
+
+		// x_B = x_B + P_BA0 * theta
+		const KFVector dx = P_A0B.transpose() * m_CEKF_theta;
+		for (size_t c = 0; c < nB; c++) m_xkk[idxB[c]] += dx[c];
+
+		// P_BB = P_BB - P_BA0 * Psi * P_A0B (column by column, to avoid
+		// another BxB matrix):
+		const KFMatrix psi_P_A0B = m_CEKF_psi * P_A0B;
+		KFVector col;
+		for (size_t c = 0; c < nB; c++)
+		{
+			col = P_A0B.leftCols(c + 1).transpose() * psi_P_A0B.col(c);
+			for (size_t r = 0; r <= c; r++)
+			{
+				m_pkk(idxB[r], idxB[c]) -= col[r];
+				if (r != c) m_pkk(idxB[c], idxB[r]) = m_pkk(idxB[r], idxB[c]);
+			}
+		}
+
+		// P_AB = Phi * P_A0B
+		const KFMatrix P_AB = m_CEKF_phi * P_A0B;
+		for (size_t r = 0; r < nA; r++)
+			for (size_t c = 0; c < nB; c++)
+				m_pkk(idxA[r], idxB[c]) = m_pkk(idxB[c], idxA[r]) = P_AB(r, c);
+	}
+
+	m_CEKF_state_len = 0;
+	m_CEKF_active_lms.clear();
+	m_timLogger.leave("KF:CEKF global update");
+}
+
+template <size_t VEH_SIZE, size_t OBS_SIZE, size_t FEAT_SIZE, size_t ACT_SIZE,
+		  typename KFTYPE>
+void CKalmanFilterCapable<VEH_SIZE, OBS_SIZE, FEAT_SIZE, ACT_SIZE, KFTYPE>::
+	CEKF_addNewLandmark(const KFMatrix_FxV& dyn_dxv)
+{
+	if (m_CEKF_state_len == 0) return;
+	// The new landmark joins the active region. Its cross covariances with
+	// the rest of the map are dyn_dxv * P_vB = (dyn_dxv * Phi_v) * P_A0B:
+	const size_t nA = m_CEKF_phi.rows();
+	m_CEKF_phi.conservativeResize(nA + FEAT_SIZE, m_CEKF_phi.cols());
+	m_CEKF_phi.bottomRows(FEAT_SIZE) = dyn_dxv * m_CEKF_phi.topRows(VEH_SIZE);
+	m_CEKF_active_lms.push_back((m_CEKF_state_len - VEH_SIZE) / FEAT_SIZE);
+	m_CEKF_state_len += FEAT_SIZE;
+}
+
 template <size_t VEH_SIZE, size_t OBS_SIZE, size_t FEAT_SIZE, size_t ACT_SIZE,
 		  typename KFTYPE>
 void CKalmanFilterCapable<VEH_SIZE, OBS_SIZE, FEAT_SIZE, ACT_SIZE, KFTYPE>::
@@ -1352,6 +1593,7 @@ void addNewLandmarks(
 				P_yn_yn += dyn_dhn_R_dyn_dhnT;
 
 			obj.internal_getPkk().insertMatrix(idx, idx, P_yn_yn);
+			obj.CEKF_addNewLandmark(dyn_dxv);
 
 			obj.getProfiler().leave("KF:9.create new LMs");
 		}
@@ -354,6 +354,10 @@ class CLevMarqGSO
 
 	// Use second thread for graph optimization
 	std::thread m_thread_optimize;
+	/**\brief Hessian structure and symbolic factorization of the last
+	 * optimization, reused by the next one if the graph structure is the same
+	 */
+	mrpt::graphslam::TLevMarqSolverCache m_levmarq_cache;
 
 	/**\brief Enumeration that defines the behaviors towards using or ignoring a
 	 * newly added loop closure to fully optimize the graph
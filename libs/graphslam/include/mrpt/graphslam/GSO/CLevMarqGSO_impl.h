@@ -470,7 +470,8 @@ void CLevMarqGSO<GRAPH_T>::_optimizeGraph(bool is_full_update /*=false*/)
 	// Execute the optimization
 	mrpt::graphslam::optimize_graph_spa_levmarq(
 		*(this->m_graph), levmarq_info, nodes_to_optimize, opt_params.cfg,
-		&CLevMarqGSO<GRAPH_T>::levMarqFeedback);  // functor feedback
+		&CLevMarqGSO<GRAPH_T>::levMarqFeedback,  // functor feedback
+		&m_levmarq_cache);
 
 	if (is_full_update)
 	{
@@ -11,15 +11,56 @@
 
 #include <mrpt/graphslam/types.h>
 #include <mrpt/utils/TParameters.h>
-#include <mrpt/utils/stl_containers_utils.h>  // find_in_vector()
+#include <mrpt/utils/stl_containers_utils.h>
 #include <mrpt/graphslam/levmarq_impl.h>  // Aux classes
 
+#include <algorithm>
 #include <iterator>  // ostream_iterator
+#include <memory>
+#include <thread>
 
 namespace mrpt
 {
 namespace graphslam
 {
+/** Solver data which optimize_graph_spa_levmarq() can keep between calls:
+ * the sparsity pattern of the Hessian and its symbolic Cholesky analysis
+ * (the fill-reducing ordering and elimination tree). Both only depend on the
+ * set of nodes to optimize and on which pairs of them are connected by
+ * edges, so they are reused as long as this structure does not change (e.g.
+ * when re-optimizing a graph whose edges have been updated, or after adding
+ * edges between nodes which were already connected), and transparently
+ * rebuilt otherwise.
+ * \ingroup mrpt_graphslam_grp */
+struct TLevMarqSolverCache
+{
+	TLevMarqSolverCache() : block_dim(0) {}
+	TLevMarqSolverCache(const TLevMarqSolverCache&) = delete;
+	TLevMarqSolverCache& operator=(const TLevMarqSolverCache&) = delete;
+
+	/** Forgets all the cached data */
+	void clear()
+	{
+		chol.reset();  // It refers to sp_H
+		sp_H.clear();
+		block_dim = 0;
+		H_block_colrow.clear();
+		block_value_idx.clear();
+	}
+
+	/** Size of each Hessian block (the dimension of poses) */
+	size_t block_dim;
+	/** (column,row) of each non-zero block in the upper triangle of H */
+	std::vector<std::pair<size_t, size_t>> H_block_colrow;
+	/** For each block, the index of its entries (in row-major order) in
+	 * the values of sp_H, -1 for the lower half of diagonal blocks */
+	std::vector<int> block_value_idx;
+	/** The upper triangle of the damped Hessian */
+	mrpt::math::CSparseMatrix sp_H;
+	/** Cholesky factorization of sp_H, whose symbolic part is reused */
+	std::unique_ptr<mrpt::math::CSparseMatrix::CholeskyDecomp> chol;
+};
+
 /** Optimize a graph of pose constraints using the Sparse Pose Adjustment (SPA)
   *sparse representation and a Levenberg-Marquardt optimizer.
   *  This method works for all types of graphs derived from \a CNetworkOfPoses
@@ -46,6 +87,10 @@ namespace graphslam
   * \param[in] functor_feedback Optional: a pointer to a user function can be
   *set here to be called on each LM loop iteration (eg to refresh the current
   *state and error, refresh a GUI, etc.)
+  * \param[in,out] solver_cache Optional: if provided, the structure of the
+  *sparse Hessian and its symbolic Cholesky analysis are kept there and reused
+  *in successive calls with the same graph topology (see TLevMarqSolverCache).
+  *Within one call they are always built only once.
   *
   * List of optional parameters by name in "extra_params":
   *		- "verbose": (default=0) If !=0, produce verbose ouput.
@@ -62,6 +107,9 @@ namespace graphslam
   *		- "e2": (default=1e-6) Lev-marq algorithm iteration stopping criterion
   *#2:
   *|delta_incr| < e2*(x_norm+e2)
+  *		- "num_threads": (default=1) Number of threads for evaluating the
+  *Jacobians and errors of all edges on each iteration. 0 means as many as CPU
+  *cores.
   *
   * \note The following graph types are supported:
   *mrpt::graphs::CNetworkOfPoses2D, mrpt::graphs::CNetworkOfPoses3D,
@@ -82,7 +130,8 @@ void optimize_graph_spa_levmarq(
 	const mrpt::utils::TParametersDouble& extra_params =
 		mrpt::utils::TParametersDouble(),
 	typename graphslam_traits<GRAPH_T>::TFunctorFeedback functor_feedback =
-		typename graphslam_traits<GRAPH_T>::TFunctorFeedback())
+		typename graphslam_traits<GRAPH_T>::TFunctorFeedback(),
+	TLevMarqSolverCache* solver_cache = nullptr)
 {
 	using namespace mrpt;
 	using namespace mrpt::poses;
@@ -212,17 +261,22 @@ void optimize_graph_spa_levmarq(
 	const size_t nObservations = lstObservationData.size();
 	ASSERT_ABOVE_(nObservations, 0)
 
-	// Cholesky object, as a pointer to reuse it between iterations:
+	// The sparsity pattern of the Hessian and its symbolic Cholesky analysis,
+	// which are kept between calls if the user provides a cache object:
+	TLevMarqSolverCache local_cache;
+	TLevMarqSolverCache& cache = solver_cache ? *solver_cache : local_cache;
 
-	typedef std::unique_ptr<CSparseMatrix::CholeskyDecomp>
-		SparseCholeskyDecompPtr;
-	SparseCholeskyDecompPtr ptrCh;
+	// Threads for evaluating Jacobians & errors:
+	size_t num_threads = extra_params.getWithDefaultVal("num_threads", 1);
+	if (!num_threads) num_threads = std::thread::hardware_concurrency();
+	std::unique_ptr<CWorkerThreadsPool> threadPool;
+	if (num_threads > 1) threadPool.reset(new CWorkerThreadsPool(num_threads));
 
 	// The list of Jacobians: for each constraint i->j,
 	//  we need the pair of Jacobians: { dh(xi,xj)_dxi, dh(xi,xj)_dxj },
 	//  which are "first" and "second" in each pair.
-	// Index of the map are the node IDs {i,j} for each contraint.
-	typename gst::map_pairIDs_pairJacobs_t lstJacobians;
+	// i \in [0,nObservations-1], in same order than lstObservationData
+	typename gst::vector_pairJacobs_t lstJacobians;
 	// The vector of errors: err_k = SE(2/3)::pseudo_Ln( P_i * EDGE_ij *
 	// inv(P_j) )
 	typename mrpt::aligned_containers<typename gst::Array_O>::vector_t
@@ -234,41 +288,148 @@ void optimize_graph_spa_levmarq(
 	// ===================================
 	profiler.enter("optimize_graph_spa_levmarq.Jacobians&err");
 	double total_sqr_err = computeJacobiansAndErrors<GRAPH_T>(
-		graph, lstObservationData, lstJacobians, errs);
+		graph, lstObservationData, lstJacobians, errs, threadPool.get());
 	profiler.leave("optimize_graph_spa_levmarq.Jacobians&err");
 
 	// Only once (since this will be static along iterations), build a quick
-	// look-up table with the
-	//  indices of the free nodes associated to the (first_id,second_id) of each
-	//  Jacobian pair:
+	// look-up table with the indices of the free nodes associated to the
+	// (first_id,second_id) of each observation: "relatedFreeNodeIndex" means
+	// into [0,nFreeNodes-1], as ordered in "nodes_to_optimize", or
+	// string::npos if that node is fixed.
 	// ------------------------------------------------------------------------
-	vector<pair<size_t, size_t>>
-		observationIndex_to_relatedFreeNodeIndex;  // "relatedFreeNodeIndex"
-	// means into
-	// [0,nFreeNodes-1], or "-1"
-	// if that node is fixed, as
-	// ordered in
-	// "nodes_to_optimize"
-	observationIndex_to_relatedFreeNodeIndex.reserve(nObservations);
-	ASSERTDEB_(lstJacobians.size() == nObservations)
-	for (typename gst::map_pairIDs_pairJacobs_t::const_iterator itJ =
-			 lstJacobians.begin();
-		 itJ != lstJacobians.end(); ++itJ)
+	profiler.enter("optimize_graph_spa_levmarq.sp_H:structure");
+	const vector<TNodeID> free_node_IDs(
+		nodes_to_optimize->begin(), nodes_to_optimize->end());
+	auto freeNodeIndex = [&free_node_IDs](const TNodeID id) -> size_t {
+		const auto it =
+			std::lower_bound(free_node_IDs.begin(), free_node_IDs.end(), id);
+		return (it != free_node_IDs.end() && *it == id)
+				   ? size_t(it - free_node_IDs.begin())
+				   : string::npos;
+	};
+	vector<pair<size_t, size_t>> observationIndex_to_relatedFreeNodeIndex(
+		nObservations);
+	for (size_t idxObs = 0; idxObs < nObservations; idxObs++)
 	{
-		const TNodeID id1 = itJ->first.first;
-		const TNodeID id2 = itJ->first.second;
-		observationIndex_to_relatedFreeNodeIndex.push_back(
-			std::make_pair(
-				mrpt::utils::find_in_vector(id1, *nodes_to_optimize),
-				mrpt::utils::find_in_vector(id2, *nodes_to_optimize)));
+		const TPairNodeIDs& ids = lstObservationData[idxObs].edge->first;
+		observationIndex_to_relatedFreeNodeIndex[idxObs] = std::make_pair(
+			freeNodeIndex(ids.first), freeNodeIndex(ids.second));
 	}
 
+	// ======================================================================
+	// Block-sparse structure of the upper triangular part of the Hessian
+	// matrix H = J^t * J: one DIMS_POSE x DIMS_POSE block for each free node
+	// (the diagonal) and for each pair of free nodes connected by an edge.
+	// It only depends on the graph topology, so it is built once here and
+	// the blocks are then accumulated in place on each iteration.
+	//  - H_block_colrow[b]: the (column,row) of the b'th block, with both
+	//    indices in [0,nFreeNodes-1] and row<=col, sorted by column.
+	// ======================================================================
+	vector<pair<size_t, size_t>> H_block_colrow;
+	H_block_colrow.reserve(nFreeNodes + nObservations);
+	for (size_t i = 0; i < nFreeNodes; i++)
+		H_block_colrow.push_back(std::make_pair(i, i));
+	for (size_t idxObs = 0; idxObs < nObservations; idxObs++)
+	{
+		const pair<size_t, size_t>& idxs =
+			observationIndex_to_relatedFreeNodeIndex[idxObs];
+		if (idxs.first != string::npos && idxs.second != string::npos)
+			H_block_colrow.push_back(
+				std::make_pair(
+					std::max(idxs.first, idxs.second),
+					std::min(idxs.first, idxs.second)));
+	}
+	std::sort(H_block_colrow.begin(), H_block_colrow.end());
+	H_block_colrow.erase(
+		std::unique(H_block_colrow.begin(), H_block_colrow.end()),
+		H_block_colrow.end());
+	const size_t nBlocks = H_block_colrow.size();
+
+	// For each observation, the blocks where its terms Ji^t*Inf*Ji,
+	// Jj^t*Inf*Jj and Ji^t*Inf*Jj are accumulated, with "i" the node with the
+	// lowest ID, or string::npos if not applicable:
+	struct TObservationBlocks
+	{
+		size_t ii, jj, ij;
+		/** false if "i" is the second node in the edge */
+		bool edge_straight;
+	};
+	auto findBlock = [&H_block_colrow](const size_t row, const size_t col) {
+		return size_t(
+			std::lower_bound(
+				H_block_colrow.begin(), H_block_colrow.end(),
+				std::make_pair(col, row)) -
+			H_block_colrow.begin());
+	};
+	vector<TObservationBlocks> observationIndex_to_HBlocks(nObservations);
+	for (size_t idxObs = 0; idxObs < nObservations; idxObs++)
+	{
+		const TPairNodeIDs& ids = lstObservationData[idxObs].edge->first;
+		const pair<size_t, size_t>& idxs =
+			observationIndex_to_relatedFreeNodeIndex[idxObs];
+		TObservationBlocks& ob = observationIndex_to_HBlocks[idxObs];
+
+		// We sort IDs such as "i" < "j" and we can build just the
+		// upper triangular part of the Hessian.
+		ob.edge_straight = ids.first < ids.second;
+		const size_t idx_i = ob.edge_straight ? idxs.first : idxs.second;
+		const size_t idx_j = ob.edge_straight ? idxs.second : idxs.first;
+		const bool is_i_free_node = idx_i != string::npos;
+		const bool is_j_free_node = idx_j != string::npos;
+
+		ob.ii = is_i_free_node ? findBlock(idx_i, idx_i) : string::npos;
+		ob.jj = is_j_free_node ? findBlock(idx_j, idx_j) : string::npos;
+		ob.ij = (is_i_free_node && is_j_free_node) ? findBlock(idx_i, idx_j)
+												   : string::npos;
+	}
+
+	// Scalar sparse matrix for the upper triangular part of H, with all the
+	// entries of those blocks. Only if the structure changed since the last
+	// call, rebuild it and drop the symbolic Cholesky decomposition (the
+	// fill-reducing ordering), which is otherwise reused:
+	if (cache.block_dim != DIMS_POSE || cache.H_block_colrow != H_block_colrow)
+	{
+		cache.clear();
+		cache.block_dim = DIMS_POSE;
+		cache.H_block_colrow = H_block_colrow;
+
+		CSparseMatrix& sp_H = cache.sp_H;
+		sp_H.clear(nFreeNodes * DIMS_POSE, nFreeNodes * DIMS_POSE);
+		for (size_t b = 0; b < nBlocks; b++)
+		{
+			const size_t col_offset = H_block_colrow[b].first * DIMS_POSE;
+			const size_t row_offset = H_block_colrow[b].second * DIMS_POSE;
+			const bool is_diag =
+				H_block_colrow[b].first == H_block_colrow[b].second;
+			for (size_t c = 0; c < DIMS_POSE; c++)
+				for (size_t r = 0; r < (is_diag ? c + 1 : DIMS_POSE); r++)
+					sp_H.insert_entry_fast(row_offset + r, col_offset + c, 0);
+		}
+		sp_H.compressFromTriplet();
+
+		// Index of each block entry in the values of sp_H, -1 for the lower
+		// half of diagonal blocks:
+		cache.block_value_idx.assign(nBlocks * DIMS_POSE * DIMS_POSE, -1);
+		for (size_t b = 0; b < nBlocks; b++)
+		{
+			const size_t col_offset = H_block_colrow[b].first * DIMS_POSE;
+			const size_t row_offset = H_block_colrow[b].second * DIMS_POSE;
+			const bool is_diag =
+				H_block_colrow[b].first == H_block_colrow[b].second;
+			int* idxs = &cache.block_value_idx[b * DIMS_POSE * DIMS_POSE];
+			for (size_t c = 0; c < DIMS_POSE; c++)
+				for (size_t r = 0; r < (is_diag ? c + 1 : DIMS_POSE); r++)
+					idxs[r * DIMS_POSE + c] = sp_H.getColumnCompressedIndex(
+						row_offset + r, col_offset + c);
+		}
+	}
+	profiler.leave("optimize_graph_spa_levmarq.sp_H:structure");
+
 	// other important vars for the main loop:
 	CVectorDouble grad(nFreeNodes * DIMS_POSE);
 	grad.setZero();
-	typedef typename mrpt::aligned_containers<
-		TNodeID, typename gst::matrix_VxV_t>::map_t map_ID2matrix_VxV_t;
-	vector<map_ID2matrix_VxV_t> H_map(nFreeNodes);
+	typename mrpt::aligned_containers<typename gst::matrix_VxV_t>::vector_t
+		H_blocks(nBlocks);
 
 	double lambda = initial_lambda;  // Will be actually set on first iteration.
 	double v = 1;  // was 2, changed since it's modified in the first pass.
@@ -308,51 +469,36 @@ void optimize_graph_spa_levmarq(
 			// "lstObservationData":
 			ASSERT_EQUAL_(lstJacobians.size(), lstObservationData.size())
 
+			for (size_t idx_obs = 0; idx_obs < nObservations; ++idx_obs)
 			{
-				size_t idx_obs;
-				typename gst::map_pairIDs_pairJacobs_t::const_iterator itJ;
-
-				for (idx_obs = 0, itJ = lstJacobians.begin();
-					 itJ != lstJacobians.end(); ++itJ, ++idx_obs)
-				{
-					ASSERTDEB_(
-						itJ->first ==
-						lstObservationData[idx_obs].edge->first)  // make sure
-					// they're in
-					// the
-					// expected
-					// order!
-
-					//  grad[k] += J^t_{i->k} * Inf.Matrix * errs_i
-					//    k: [0,nFreeNodes-1]     <-- IDs.first & IDs.second
-					//    i: [0,nObservations-1]  <--- idx_obs
-
-					// Get the corresponding indices in the vector of "free
-					// variables" being optimized:
-					const size_t idx1 =
-						observationIndex_to_relatedFreeNodeIndex[idx_obs].first;
-					const size_t idx2 =
-						observationIndex_to_relatedFreeNodeIndex[idx_obs]
-							.second;
-
-					if (idx1 != string::npos)
-						detail::AuxErrorEval<typename gst::edge_t, gst>::
-							multiply_Jt_W_err(
-								itJ->second.first /* J */,
-								lstObservationData[idx_obs].edge /* W */,
-								errs[idx_obs] /* err */,
-								grad_parts[idx1] /* out */
-								);
-
-					if (idx2 != string::npos)
-						detail::AuxErrorEval<typename gst::edge_t, gst>::
-							multiply_Jt_W_err(
-								itJ->second.second /* J */,
-								lstObservationData[idx_obs].edge /* W */,
-								errs[idx_obs] /* err */,
-								grad_parts[idx2] /* out */
-								);
-				}
+				//  grad[k] += J^t_{i->k} * Inf.Matrix * errs_i
+				//    k: [0,nFreeNodes-1]     <-- IDs.first & IDs.second
+				//    i: [0,nObservations-1]  <--- idx_obs
+
+				// Get the corresponding indices in the vector of "free
+				// variables" being optimized:
+				const size_t idx1 =
+					observationIndex_to_relatedFreeNodeIndex[idx_obs].first;
+				const size_t idx2 =
+					observationIndex_to_relatedFreeNodeIndex[idx_obs].second;
+
+				if (idx1 != string::npos)
+					detail::AuxErrorEval<typename gst::edge_t, gst>::
+						multiply_Jt_W_err(
+							lstJacobians[idx_obs].first /* J */,
+							lstObservationData[idx_obs].edge /* W */,
+							errs[idx_obs] /* err */,
+							grad_parts[idx1] /* out */
+							);
+
+				if (idx2 != string::npos)
+					detail::AuxErrorEval<typename gst::edge_t, gst>::
+						multiply_Jt_W_err(
+							lstJacobians[idx_obs].second /* J */,
+							lstObservationData[idx_obs].edge /* W */,
+							errs[idx_obs] /* err */,
+							grad_parts[idx2] /* out */
+							);
 			}
 
 			// build the gradient as a single vector:
@@ -377,92 +523,56 @@ void optimize_graph_spa_levmarq(
 				break;
 			}
 
-			profiler.enter("optimize_graph_spa_levmarq.sp_H:build map");
+			profiler.enter("optimize_graph_spa_levmarq.sp_H:build blocks");
 			// ======================================================================
-			// Build sparse representation of the upper triangular part of
-			//  the Hessian matrix H = J^t * J
-			//
-			// Sparse memory structure is a vector of maps, such as:
-			//  - H_map[i]: corresponds to the i'th column of H.
-			//              Here "i" corresponds to [0,N-1] indices of
-			//              appearance in the map "*nodes_to_optimize".
-			//  - H_map[i][j] is the entry for the j'th row, with "j" also in
-			//  the range [0,N-1] as ordered in "*nodes_to_optimize".
+			// Accumulate the blocks of the upper triangular part of the
+			// Hessian matrix H = J^t * J (see "H_block_colrow" above)
 			// ======================================================================
-			{
-				size_t idxObs;
-				typename gst::map_pairIDs_pairJacobs_t::const_iterator
-					itJacobPair;
+			for (size_t b = 0; b < nBlocks; b++) H_blocks[b].setZero();
 
-				for (idxObs = 0, itJacobPair = lstJacobians.begin();
-					 idxObs < nObservations; ++itJacobPair, ++idxObs)
+			for (size_t idxObs = 0; idxObs < nObservations; ++idxObs)
+			{
+				const TObservationBlocks& ob =
+					observationIndex_to_HBlocks[idxObs];
+
+				// Take references to both Jacobians (wrt pose "i" and pose
+				// "j"), taking into account the possible
+				// switch in their order:
+				const typename gst::matrix_VxV_t& J1 =
+					ob.edge_straight ? lstJacobians[idxObs].first
+									 : lstJacobians[idxObs].second;
+				const typename gst::matrix_VxV_t& J2 =
+					ob.edge_straight ? lstJacobians[idxObs].second
+									 : lstJacobians[idxObs].first;
+
+				typename gst::matrix_VxV_t JtJ(
+					mrpt::math::UNINITIALIZED_MATRIX);
+				// Is "i" a free (to be optimized) node? -> Ji^t * Inf *  Ji
+				if (ob.ii != string::npos)
+				{
+					detail::AuxErrorEval<typename gst::edge_t, gst>::
+						multiplyJtLambdaJ(
+							J1, JtJ, lstObservationData[idxObs].edge);
+					H_blocks[ob.ii] += JtJ;
+				}
+				// Is "j" a free (to be optimized) node? -> Jj^t * Inf *  Jj
+				if (ob.jj != string::npos)
+				{
+					detail::AuxErrorEval<typename gst::edge_t, gst>::
+						multiplyJtLambdaJ(
+							J2, JtJ, lstObservationData[idxObs].edge);
+					H_blocks[ob.jj] += JtJ;
+				}
+				// Are both "i" and "j" free nodes? -> Ji^t * Inf *  Jj
+				if (ob.ij != string::npos)
 				{
-					// We sort IDs such as "i" < "j" and we can build just the
-					// upper triangular part of the Hessian.
-					const bool edge_straight =
-						itJacobPair->first.first < itJacobPair->first.second;
-
-					// Indices in the "H_map" vector:
-					const size_t idx_i =
-						edge_straight
-							? observationIndex_to_relatedFreeNodeIndex[idxObs]
-								  .first
-							: observationIndex_to_relatedFreeNodeIndex[idxObs]
-								  .second;
-					const size_t idx_j =
-						edge_straight
-							? observationIndex_to_relatedFreeNodeIndex[idxObs]
-								  .second
-							: observationIndex_to_relatedFreeNodeIndex[idxObs]
-								  .first;
-
-					const bool is_i_free_node = idx_i != string::npos;
-					const bool is_j_free_node = idx_j != string::npos;
-
-					// Take references to both Jacobians (wrt pose "i" and pose
-					// "j"), taking into account the possible
-					// switch in their order:
-
-					const typename gst::matrix_VxV_t& J1 =
-						edge_straight ? itJacobPair->second.first
-									  : itJacobPair->second.second;
-					const typename gst::matrix_VxV_t& J2 =
-						edge_straight ? itJacobPair->second.second
-									  : itJacobPair->second.first;
-
-					// Is "i" a free (to be optimized) node? -> Ji^t * Inf *  Ji
-					if (is_i_free_node)
-					{
-						typename gst::matrix_VxV_t JtJ(
-							mrpt::math::UNINITIALIZED_MATRIX);
-						detail::AuxErrorEval<typename gst::edge_t, gst>::
-							multiplyJtLambdaJ(
-								J1, JtJ, lstObservationData[idxObs].edge);
-						H_map[idx_i][idx_i] += JtJ;
-					}
-					// Is "j" a free (to be optimized) node? -> Jj^t * Inf *  Jj
-					if (is_j_free_node)
-					{
-						typename gst::matrix_VxV_t JtJ(
-							mrpt::math::UNINITIALIZED_MATRIX);
-						detail::AuxErrorEval<typename gst::edge_t, gst>::
-							multiplyJtLambdaJ(
-								J2, JtJ, lstObservationData[idxObs].edge);
-						H_map[idx_j][idx_j] += JtJ;
-					}
-					// Are both "i" and "j" free nodes? -> Ji^t * Inf *  Jj
-					if (is_i_free_node && is_j_free_node)
-					{
-						typename gst::matrix_VxV_t JtJ(
-							mrpt::math::UNINITIALIZED_MATRIX);
-						detail::AuxErrorEval<typename gst::edge_t, gst>::
-							multiplyJ1tLambdaJ2(
-								J1, J2, JtJ, lstObservationData[idxObs].edge);
-						H_map[idx_j][idx_i] += JtJ;
-					}
+					detail::AuxErrorEval<typename gst::edge_t, gst>::
+						multiplyJ1tLambdaJ2(
+							J1, J2, JtJ, lstObservationData[idxObs].edge);
+					H_blocks[ob.ij] += JtJ;
 				}
 			}
-			profiler.leave("optimize_graph_spa_levmarq.sp_H:build map");
+			profiler.leave("optimize_graph_spa_levmarq.sp_H:build blocks");
 
 			// Just in the first iteration, we need to calculate an estimate for
 			// the first value of "lamdba":
@@ -471,21 +581,14 @@ void optimize_graph_spa_levmarq(
 				profiler.enter(
 					"optimize_graph_spa_levmarq.lambda_init");  // ---\  .
 				double H_diagonal_max = 0;
-				for (size_t i = 0; i < nFreeNodes; i++)
-					for (typename map_ID2matrix_VxV_t::const_iterator it =
-							 H_map[i].begin();
-						 it != H_map[i].end(); ++it)
-					{
-						const size_t j =
-							it->first;  // entry submatrix is for (i,j).
-						if (i == j)
-						{
-							for (size_t k = 0; k < DIMS_POSE; k++)
-								mrpt::utils::keep_max(
-									H_diagonal_max,
-									it->second.get_unsafe(k, k));
-						}
-					}
+				for (size_t b = 0; b < nBlocks; b++)
+				{
+					if (H_block_colrow[b].first != H_block_colrow[b].second)
+						continue;
+					for (size_t k = 0; k < DIMS_POSE; k++)
+						mrpt::utils::keep_max(
+							H_diagonal_max, H_blocks[b].get_unsafe(k, k));
+				}
 				lambda = tau * H_diagonal_max;
 
 				profiler.leave(
@@ -499,7 +602,7 @@ void optimize_graph_spa_levmarq(
 			utils::keep_max(lambda, 1e-200);  // JL: Avoids underflow!
 			v = 2;
 #if 0
-					{ mrpt::math::CMatrixDouble H; sp_H.get_dense(H); H.saveToTextFile("d:\\H.txt"); }
+					{ mrpt::math::CMatrixDouble H; cache.sp_H.get_dense(H); H.saveToTextFile("d:\\H.txt"); }
 #endif
 		}  // end "have_to_recompute_H_and_grad"
 
@@ -517,48 +620,24 @@ void optimize_graph_spa_levmarq(
 		}
 
 		profiler.enter("optimize_graph_spa_levmarq.sp_H:build");
-		// Now, build the actual sparse matrix H:
-		// Note: we only need to fill out the upper diagonal part, since
-		// Cholesky will later on ignore the other part.
-		CSparseMatrix sp_H(nFreeNodes * DIMS_POSE, nFreeNodes * DIMS_POSE);
-		for (size_t i = 0; i < nFreeNodes; i++)
+		// Now, fill in the actual sparse matrix H, whose structure was already
+		// built above: we only need to copy the values of the blocks and add
+		// the lambda*I term from the Lev-Marq. algorithm to the diagonal.
 		{
-			const size_t i_offset = i * DIMS_POSE;
-
-			for (typename map_ID2matrix_VxV_t::const_iterator it =
-					 H_map[i].begin();
-				 it != H_map[i].end(); ++it)
+			double* sp_H_values = cache.sp_H.getValuesPtr();
+			for (size_t b = 0; b < nBlocks; b++)
 			{
-				const size_t j = it->first;  // entry submatrix is for (i,j).
-				const size_t j_offset = j * DIMS_POSE;
-
-				// For i==j (diagonal blocks), it's different, since we only
-				// need to insert their
-				// upper-diagonal half and also we have to add the lambda*I to
-				// the diagonal from the Lev-Marq. algorithm:
-				if (i == j)
-				{
-					for (size_t r = 0; r < DIMS_POSE; r++)
-					{
-						// c=r: add lambda from LM
-						sp_H.insert_entry_fast(
-							j_offset + r, i_offset + r,
-							it->second.get_unsafe(r, r) + lambda);
-						// c>r:
-						for (size_t c = r + 1; c < DIMS_POSE; c++)
-							sp_H.insert_entry_fast(
-								j_offset + r, i_offset + c,
-								it->second.get_unsafe(r, c));
-					}
-				}
-				else
-				{
-					sp_H.insert_submatrix(j_offset, i_offset, it->second);
-				}
+				const bool is_diag =
+					H_block_colrow[b].first == H_block_colrow[b].second;
+				const int* idxs =
+					&cache.block_value_idx[b * DIMS_POSE * DIMS_POSE];
+				for (size_t r = 0; r < DIMS_POSE; r++)
+					for (size_t c = is_diag ? r : 0; c < DIMS_POSE; c++)
+						sp_H_values[idxs[r * DIMS_POSE + c]] =
+							H_blocks[b].get_unsafe(r, c) +
+							((is_diag && r == c) ? lambda : 0);
 			}
-		}  // end for each free node, build sp_H
-
-		sp_H.compressFromTriplet();
+		}
 		profiler.leave("optimize_graph_spa_levmarq.sp_H:build");
 
 		// Use the cparse Cholesky decomposition to efficiently solve:
@@ -569,16 +648,18 @@ void optimize_graph_spa_levmarq(
 		// current solution in this step
 		try
 		{
+			// The symbolic analysis is done only once, then only the numeric
+			// factorization is updated:
 			profiler.enter("optimize_graph_spa_levmarq.sp_H:chol");
-			if (!ptrCh.get())
-				ptrCh = SparseCholeskyDecompPtr(
-					new CSparseMatrix::CholeskyDecomp(sp_H));
+			if (!cache.chol)
+				cache.chol.reset(
+					new CSparseMatrix::CholeskyDecomp(cache.sp_H));
 			else
-				ptrCh.get()->update(sp_H);
+				cache.chol->update(cache.sp_H);
 			profiler.leave("optimize_graph_spa_levmarq.sp_H:chol");
 
 			profiler.enter("optimize_graph_spa_levmarq.sp_H:backsub");
-			ptrCh->backsub(grad, delta);
+			cache.chol->backsub(grad, delta);
 			profiler.leave("optimize_graph_spa_levmarq.sp_H:backsub");
 		}
 		catch (CExceptionNotDefPos&)
@@ -673,13 +754,14 @@ void optimize_graph_spa_levmarq(
 			// =============================================================
 			// Compute Jacobians & errors with the new "graph.nodes" info:
 			// =============================================================
-			typename gst::map_pairIDs_pairJacobs_t new_lstJacobians;
+			typename gst::vector_pairJacobs_t new_lstJacobians;
 			typename mrpt::aligned_containers<typename gst::Array_O>::vector_t
 				new_errs;
 
 			profiler.enter("optimize_graph_spa_levmarq.Jacobians&err");
 			double new_total_sqr_err = computeJacobiansAndErrors<GRAPH_T>(
-				graph, lstObservationData, new_lstJacobians, new_errs);
+				graph, lstObservationData, new_lstJacobians, new_errs,
+				threadPool.get());
 			profiler.leave("optimize_graph_spa_levmarq.Jacobians&err");
 
 			// Now, to decide whether to accept the change:
@@ -12,6 +12,7 @@
 #include <mrpt/graphs/CNetworkOfPoses.h>
 #include <mrpt/utils/CTimeLogger.h>
 #include <mrpt/math/CSparseMatrix.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
 
 #include <memory>
 
@@ -183,65 +184,62 @@ struct AuxErrorEval<CPose3DPDFGaussianInf, gst>
 
 // Compute, at once, jacobians and the error vectors for each constraint in
 // "lstObservationData", returns the overall squared error.
+// Jacobians and errors are stored in the same order than the observations.
+// If a thread pool is given, the observations are split among its threads.
 template <class GRAPH_T>
 double computeJacobiansAndErrors(
 	const GRAPH_T& graph,
 	const std::vector<typename graphslam_traits<GRAPH_T>::observation_info_t>&
 		lstObservationData,
-	typename graphslam_traits<GRAPH_T>::map_pairIDs_pairJacobs_t& lstJacobians,
+	typename graphslam_traits<GRAPH_T>::vector_pairJacobs_t& lstJacobians,
 	typename mrpt::aligned_containers<
-		typename graphslam_traits<GRAPH_T>::Array_O>::vector_t& errs)
+		typename graphslam_traits<GRAPH_T>::Array_O>::vector_t& errs,
+	mrpt::utils::CWorkerThreadsPool* threadPool = nullptr)
 {
 	MRPT_UNUSED_PARAM(graph);
 	typedef graphslam_traits<GRAPH_T> gst;
 
-	lstJacobians.clear();
-	errs.clear();
-
 	const size_t nObservations = lstObservationData.size();
+	lstJacobians.resize(nObservations);
+	errs.resize(nObservations);
 
-	for (size_t i = 0; i < nObservations; i++)
-	{
-		const typename gst::observation_info_t& obs = lstObservationData[i];
-		typename gst::edge_const_iterator it = obs.edge;
-		const typename gst::graph_t::constraint_t::type_value* EDGE_POSE =
-			obs.edge_mean;
-		typename gst::graph_t::constraint_t::type_value* P1 = obs.P1;
-		typename gst::graph_t::constraint_t::type_value* P2 = obs.P2;
-
-		const mrpt::utils::TPairNodeIDs& ids = it->first;
-		const typename gst::graph_t::edge_t& edge = it->second;
-
-		// Compute the residual pose error of these pair of nodes + its
-		// constraint,
-		//  that is: P1DP2inv = P1 * EDGE * inv(P2)
-		typename gst::graph_t::constraint_t::type_value P1DP2inv(
-			mrpt::poses::UNINITIALIZED_POSE);
+	auto lambdaJacobsErrs = [&](size_t first, size_t last, size_t) {
+		for (size_t i = first; i < last; i++)
 		{
-			typename gst::graph_t::constraint_t::type_value P1D(
+			const typename gst::observation_info_t& obs = lstObservationData[i];
+			const typename gst::graph_t::constraint_t::type_value* EDGE_POSE =
+				obs.edge_mean;
+			const typename gst::graph_t::constraint_t::type_value* P1 = obs.P1;
+			const typename gst::graph_t::constraint_t::type_value* P2 = obs.P2;
+			const typename gst::graph_t::edge_t& edge = obs.edge->second;
+
+			// Compute the residual pose error of these pair of nodes + its
+			// constraint,
+			//  that is: P1DP2inv = P1 * EDGE * inv(P2)
+			typename gst::graph_t::constraint_t::type_value P1DP2inv(
 				mrpt::poses::UNINITIALIZED_POSE);
-			P1D.composeFrom(*P1, *EDGE_POSE);
-			const typename gst::graph_t::constraint_t::type_value P2inv =
-				-(*P2);  // Pose inverse (NOT just switching signs!)
-			P1DP2inv.composeFrom(P1D, P2inv);
+			{
+				typename gst::graph_t::constraint_t::type_value P1D(
+					mrpt::poses::UNINITIALIZED_POSE);
+				P1D.composeFrom(*P1, *EDGE_POSE);
+				const typename gst::graph_t::constraint_t::type_value P2inv =
+					-(*P2);  // Pose inverse (NOT just switching signs!)
+				P1DP2inv.composeFrom(P1D, P2inv);
+			}
+
+			// The error vector:
+			detail::AuxErrorEval<typename gst::edge_t, gst>::
+				computePseudoLnError(P1DP2inv, errs[i], edge);
+
+			// Compute the jacobians:
+			gst::SE_TYPE::jacobian_dP1DP2inv_depsilon(
+				P1DP2inv, &lstJacobians[i].first, &lstJacobians[i].second);
 		}
-
-		// Add to vector of errors:
-		errs.resize(errs.size() + 1);
-		detail::AuxErrorEval<typename gst::edge_t, gst>::computePseudoLnError(
-			P1DP2inv, errs.back(), edge);
-
-		// Compute the jacobians:
-		alignas(16)
-			std::pair<mrpt::utils::TPairNodeIDs, typename gst::TPairJacobs>
-				newMapEntry;
-		newMapEntry.first = ids;
-		gst::SE_TYPE::jacobian_dP1DP2inv_depsilon(
-			P1DP2inv, &newMapEntry.second.first, &newMapEntry.second.second);
-
-		// And insert into map of jacobians:
-		lstJacobians.insert(lstJacobians.end(), newMapEntry);
-	}
+	};
+	if (threadPool)
+		threadPool->parallelChunks(nObservations, lambdaJacobsErrs);
+	else
+		lambdaJacobsErrs(0, nObservations, 0);
 
 	// return overall square error:  (Was:
 	// std::accumulate(...,mrpt::math::squareNorm_accum<>), but led to GCC
@@ -251,6 +249,29 @@ double computeJacobiansAndErrors(
 	return ret_err;
 }
 
+// Compute, at once, jacobians and the error vectors for each constraint in
+// "lstObservationData", returns the overall squared error.
+template <class GRAPH_T>
+double computeJacobiansAndErrors(
+	const GRAPH_T& graph,
+	const std::vector<typename graphslam_traits<GRAPH_T>::observation_info_t>&
+		lstObservationData,
+	typename graphslam_traits<GRAPH_T>::map_pairIDs_pairJacobs_t& lstJacobians,
+	typename mrpt::aligned_containers<
+		typename graphslam_traits<GRAPH_T>::Array_O>::vector_t& errs)
+{
+	typename graphslam_traits<GRAPH_T>::vector_pairJacobs_t jacobs;
+	const double ret_err = computeJacobiansAndErrors<GRAPH_T>(
+		graph, lstObservationData, jacobs, errs);
+
+	lstJacobians.clear();
+	for (size_t i = 0; i < jacobs.size(); i++)
+		lstJacobians.insert(
+			lstJacobians.end(),
+			std::make_pair(lstObservationData[i].edge->first, jacobs[i]));
+	return ret_err;
+}
+
 }  // end of NS
 }  // end of NS
 
@@ -46,6 +46,8 @@ struct graphslam_traits
 	typedef typename mrpt::aligned_containers<mrpt::utils::TPairNodeIDs,
 											  TPairJacobs>::multimap_t
 		map_pairIDs_pairJacobs_t;
+	typedef typename mrpt::aligned_containers<TPairJacobs>::vector_t
+		vector_pairJacobs_t;
 
 	/** Auxiliary struct used in graph-slam implementation: It holds the
 	 * relevant information for each of the constraints being taking into
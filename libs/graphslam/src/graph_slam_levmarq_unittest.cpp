@@ -48,11 +48,69 @@ class GraphSlamLevMarqTester : public GraphSlamLevMarqTest<my_graph_t>,
 			graph, levmarq_info, nullptr, params);
 
 		// Do some basic checks on the results:
-		EXPECT_GE(levmarq_info.num_iters, 10U);
-		EXPECT_LE(levmarq_info.final_total_sq_error, 1e-2);
+		EXPECT_GE(levmarq_info.num_iters, 2U);
+		EXPECT_LE(levmarq_info.final_total_sq_error, 1e-6);
 
 	}  // end test_ring_path
 
+	// Optimize with several threads and reusing the solver structures between
+	// calls, which must give the same results than a plain call:
+	void test_threads_and_solver_cache()
+	{
+		my_graph_t graph_initial;
+		GraphSlamLevMarqTest<my_graph_t>::create_ring_path(graph_initial);
+
+		TParametersDouble params;
+		params["max_iterations"] = 1000;
+
+		my_graph_t graph_ref = graph_initial;
+		graphslam::TResultInfoSpaLevMarq info_ref;
+		graphslam::optimize_graph_spa_levmarq(
+			graph_ref, info_ref, nullptr, params);
+
+		params["num_threads"] = 3;
+		graphslam::TLevMarqSolverCache cache;
+		for (int pass = 0; pass < 2; pass++)
+		{
+			my_graph_t graph = graph_initial;
+			graphslam::TResultInfoSpaLevMarq info;
+			graphslam::optimize_graph_spa_levmarq(
+				graph, info, nullptr, params, {}, &cache);
+			EXPECT_TRUE(cache.chol);
+			EXPECT_EQ(info.num_iters, info_ref.num_iters);
+			EXPECT_NEAR(
+				info.final_total_sq_error, info_ref.final_total_sq_error,
+				1e-9);
+			for (const auto& n : graph_ref.nodes)
+				EXPECT_NEAR(
+					0, (graph.nodes[n.first].getAsVectorVal() -
+						n.second.getAsVectorVal())
+						   .array()
+						   .abs()
+						   .sum(),
+					1e-9);
+		}
+
+		// A new edge between nodes which were not connected changes the
+		// structure of the problem:
+		my_graph_t graph = graph_initial;
+		TNodeID other = 1;
+		while (graph.edges.count(TPairNodeIDs(0, other)) ||
+			   graph.edges.count(TPairNodeIDs(other, 0)))
+			other++;
+		GraphSlamLevMarqTest<my_graph_t>::addEdge(
+			0, other, graph_ref.nodes, graph);
+		my_graph_t graph2 = graph;
+
+		graphslam::TResultInfoSpaLevMarq info, info2;
+		graphslam::optimize_graph_spa_levmarq(
+			graph, info, nullptr, params, {}, &cache);
+		graphslam::optimize_graph_spa_levmarq(graph2, info2, nullptr, params);
+		EXPECT_EQ(info.num_iters, info2.num_iters);
+		EXPECT_NEAR(
+			info.final_total_sq_error, info2.final_total_sq_error, 1e-9);
+	}
+
 	void test_graph_bin_serialization()
 	{
 		my_graph_t graph;
@@ -99,6 +157,11 @@ TEST_F(GraphSlamLevMarqTester2D, OptimizeSampleRingPath)
 		test_ring_path();
 	}
 }
+TEST_F(GraphSlamLevMarqTester2D, ThreadsAndSolverCache)
+{
+	getRandomGenerator().randomize(123);
+	test_threads_and_solver_cache();
+}
 TEST_F(GraphSlamLevMarqTester2D, BinarySerialization)
 {
 	getRandomGenerator().randomize(123);
@@ -113,6 +176,11 @@ TEST_F(GraphSlamLevMarqTester3D, OptimizeSampleRingPath)
 		test_ring_path();
 	}
 }
+TEST_F(GraphSlamLevMarqTester3D, ThreadsAndSolverCache)
+{
+	getRandomGenerator().randomize(123);
+	test_threads_and_solver_cache();
+}
 TEST_F(GraphSlamLevMarqTester3D, BinarySerialization)
 {
 	getRandomGenerator().randomize(123);
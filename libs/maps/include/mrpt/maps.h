@@ -32,6 +32,7 @@ MRPT_WARNING(
 #include <mrpt/maps/CPointsMap.h>
 #include <mrpt/maps/CSimplePointsMap.h>
 #include <mrpt/maps/CWeightedPointsMap.h>
+#include <mrpt/maps/CVoxelHashPointsMap.h>
 #include <mrpt/maps/COctoMap.h>
 #include <mrpt/maps/CColouredOctoMap.h>
 
@@ -401,7 +401,12 @@ class PointCloudAdapter<mrpt::maps::CColouredPointsMap>
 	/** Get number of points */
 	inline size_t size() const { return m_obj.size(); }
 	/** Set number of points (to uninitialized values) */
-	inline void resize(const size_t N) { m_obj.resize(N); }
+	inline void resize(const size_t N)
+	{
+		m_obj.resize(N);
+		// All points are going to be overwritten:
+		m_obj.mark_as_modified();
+	}
 	/** Get XYZ coordinates of i'th point */
 	template <typename T>
 	inline void getPointXYZ(const size_t idx, T& x, T& y, T& z) const
@@ -480,6 +485,11 @@ class PointCloudAdapter<mrpt::maps::CColouredPointsMap>
 		m_obj.setPointColor_fast(idx, r / 255.f, g / 255.f, b / 255.f);
 	}
 
+	/** Not supported: point maps must be dense */
+	inline void setInvalidPoint(const size_t idx)
+	{
+		THROW_EXCEPTION("mrpt::maps::CColouredPointsMap needs to be dense");
+	}
 };  // end of PointCloudAdapter<mrpt::maps::CColouredPointsMap>
 
 template <>
@@ -25,6 +25,9 @@
 #include <mrpt/utils/TEnumType.h>
 
 #include <mrpt/config.h>
+
+#include <memory>
+#include <mutex>
 #if (                                                \
 	!defined(OCCUPANCY_GRIDMAP_CELL_SIZE_8BITS) &&   \
 	!defined(OCCUPANCY_GRIDMAP_CELL_SIZE_16BITS)) || \
@@ -59,6 +62,14 @@ namespace maps
  *		- Laser scans simulation for the map contents
  *		- Entropy and information methods (See computeEntropy)
  *
+ * Cells are stored by default in a single dense array. For very large
+ *environments, a tiled storage can be selected with setTiledStorage(): cells
+ *are then kept in square tiles which are only allocated when some of their
+ *cells are modified, so unexplored areas take no memory and growing the grid
+ *never copies the existing cells. Tiles are also shared between copies of a
+ *map and only duplicated when modified (copy-on-write), so copying a map
+ *(e.g. duplicating RBPF particles at resampling) is cheap.
+ *
  * \ingroup mrpt_maps_grp
  **/
 class COccupancyGridMap2D : public CMetricMap,
@@ -92,6 +103,10 @@ class COccupancyGridMap2D : public CMetricMap,
 	/** (Default:1.0) Can be set to <1 if a more fine raytracing is needed in
 	 * sonarSimulator() and laserScanSimulator(), or >1 to speed it up. */
 	static double RAYTRACE_STEP_SIZE_IN_CELL_UNITS;
+	/** (Default:true) If enabled, the sensor simulators skip free space along
+	 * each ray by looking up a precomputed distance field of the grid (see
+	 * simulateScanRay()). Simulated ranges are identical either way. */
+	static bool RAYTRACE_USE_DISTANCE_FIELD;
 
    protected:
 	friend class CMultiMetricMap;
@@ -102,8 +117,22 @@ class COccupancyGridMap2D : public CMetricMap,
 	/** Lookup tables for log-odds */
 	static CLogOddsGridMapLUT<cellType> & get_logodd_lut();
 
-	/** Store of cell occupancy values. Order: row by row, from left to right */
+	/** Store of cell occupancy values. Order: row by row, from left to right.
+	 * Empty if the tiled storage is enabled (see setTiledStorage()) */
 	std::vector<cellType> map;
+	/** Whether cells are stored in m_tiles instead of in "map" */
+	bool m_tiled;
+	/** One tile: TILE_SIZE x TILE_SIZE cells, row by row. Tiles are shared
+	 * between copies of the map until modified (copy-on-write). */
+	typedef std::shared_ptr<std::vector<cellType>> tile_ptr_t;
+	/** Tile directory, used instead of "map" with tiled storage: one entry
+	 * per tile, row by row. Tiles not allocated yet are empty pointers, and
+	 * all their cells have the value m_tiles_default */
+	std::vector<tile_ptr_t> m_tiles;
+	/** The size of the tile directory, in tiles */
+	uint32_t m_tiles_x, m_tiles_y;
+	/** Value of all cells in tiles not allocated yet */
+	cellType m_tiles_default;
 	/** The size of the grid in cells */
 	uint32_t size_x, size_y;
 	/** The limits of the grid in "units" (meters) */
@@ -117,6 +146,68 @@ class COccupancyGridMap2D : public CMetricMap,
 	std::vector<double> precomputedLikelihood;
 	bool precomputedLikelihoodToBeRecomputed;
 
+	/** Exact distance transform used by the lmLikelihoodField_DistanceTransform
+	 * method: squared distance (in meters^2) from each cell to its closest
+	 * occupied cell, saturated at TLikelihoodOptions::LF_maxCorrsDistance.
+	 * \sa updateLikelihoodDistanceTransform */
+	std::vector<float> m_likelihoodDT;
+	/** Binarized occupancy (1=occupied) of each cell as seen the last time
+	 * m_likelihoodDT was updated. Used to find out which cells changed. */
+	std::vector<uint8_t> m_likelihoodDT_occupied;
+	/** One flag per block of TILE_SIZE x TILE_SIZE cells (row by row), set
+	 * when some cell of the block is written (see markCellModified()). Only
+	 * these blocks are checked for changes in m_likelihoodDT_occupied. */
+	std::vector<uint8_t> m_likelihoodDT_dirty;
+	/** The number of blocks per row in m_likelihoodDT_dirty */
+	uint32_t m_likelihoodDT_dirty_x;
+	/** Resolution and max. distance m_likelihoodDT was built for */
+	float m_likelihoodDT_resolution, m_likelihoodDT_maxDist;
+	/** Set to true whenever the map contents change */
+	bool m_likelihoodDT_ToBeUpdated;
+
+	/** Distance field used by the sensor simulators to skip free space.
+	 * Copies of the map do not share it: they rebuild it when first needed.
+	 * \sa getSimulatorDistanceField */
+	struct TSimulatorDistanceField
+	{
+		/** Chessboard distance (in cells, saturated at 255) from each cell to
+		 * the closest cell where rays stop, or to the outside of the grid.
+		 * Replaced (never modified) when rebuilt, so simulators running
+		 * in other threads can keep using the old one. */
+		std::shared_ptr<const std::vector<uint8_t>> dist;
+		/** The free threshold (log-odds) `dist` was built for */
+		cellType threshold_free_int;
+		/** Set to true whenever the map contents change */
+		bool toBeUpdated;
+		std::mutex mtx;
+
+		TSimulatorDistanceField() : threshold_free_int(0), toBeUpdated(true)
+		{
+		}
+		TSimulatorDistanceField(const TSimulatorDistanceField&)
+			: TSimulatorDistanceField()
+		{
+		}
+		TSimulatorDistanceField& operator=(const TSimulatorDistanceField&)
+		{
+			toBeUpdated = true;
+			return *this;
+		}
+	};
+	mutable TSimulatorDistanceField m_simulDF;
+
+	/** Returns the distance field of the grid for rays which stop at cells
+	 * with a value <= threshold_free_int, rebuilding it if the map has
+	 * changed or it was built for another threshold. Thread-safe. */
+	std::shared_ptr<const std::vector<uint8_t>> getSimulatorDistanceField(
+		const cellType threshold_free_int) const;
+	/** Ray tracing of simulateScanRay(), without noise. `dist_field` may be
+	 * nullptr, or the distance field for `threshold_free_int`. */
+	void internal_simulateScanRay(
+		const double x, const double y, const double angle_direction,
+		float& out_range, bool& out_valid, const double max_range_meters,
+		const cellType threshold_free_int, const uint8_t* dist_field) const;
+
 	/** Used for Voronoi calculation.Same struct as "map", but contains a "0" if
 	 * not a basis point. */
 	mrpt::utils::CDynamicGrid<uint8_t> m_basis_map;
@@ -142,21 +233,90 @@ class COccupancyGridMap2D : public CMetricMap,
 	/** Internally used to speed-up entropy calculation */
 	static std::vector<float> entropyTable;
 
+	/** Returns a tile for writing: allocates it if needed, or makes a private
+	 * copy of it if it is shared with other maps (copy-on-write) */
+	inline std::vector<cellType>& mutableTile(tile_ptr_t& tile)
+	{
+		if (!tile)
+			tile = std::make_shared<std::vector<cellType>>(
+				TILE_SIZE * TILE_SIZE, m_tiles_default);
+		else if (tile.use_count() > 1)
+			tile = std::make_shared<std::vector<cellType>>(*tile);
+		return *tile;
+	}
+	/** Records that cell (x,y) is going to be written, for the incremental
+	 * update of m_likelihoodDT (limits are not checked). The caller must set
+	 * m_likelihoodDT_ToBeUpdated too. */
+	inline void markCellModified(unsigned x, unsigned y)
+	{
+		const size_t i = (x >> TILE_SIZE_LOG2) +
+						 (y >> TILE_SIZE_LOG2) * size_t(m_likelihoodDT_dirty_x);
+		if (i < m_likelihoodDT_dirty.size()) m_likelihoodDT_dirty[i] = 1;
+	}
+	/** Returns a pointer to a cell for writing, given its index (without
+	 * checking limits), and marks it with markCellModified(). With tiled
+	 * storage, this allocates or unshares the tile if needed. */
+	inline cellType* cellPtr(unsigned x, unsigned y)
+	{
+		markCellModified(x, y);
+		if (!m_tiled) return &map[x + y * size_x];
+		std::vector<cellType>& tile = mutableTile(
+			m_tiles[(x >> TILE_SIZE_LOG2) + (y >> TILE_SIZE_LOG2) * m_tiles_x]);
+		return &tile
+			[(x & (TILE_SIZE - 1)) + ((y & (TILE_SIZE - 1)) << TILE_SIZE_LOG2)];
+	}
+	/** Returns the value of a cell, given its index (without checking
+	 * limits) */
+	inline cellType cellValue(unsigned x, unsigned y) const
+	{
+		if (!m_tiled) return map[x + y * size_x];
+		const tile_ptr_t& tile =
+			m_tiles[(x >> TILE_SIZE_LOG2) + (y >> TILE_SIZE_LOG2) * m_tiles_x];
+		if (!tile) return m_tiles_default;
+		return (*tile)
+			[(x & (TILE_SIZE - 1)) + ((y & (TILE_SIZE - 1)) << TILE_SIZE_LOG2)];
+	}
+	/** Gets the cells [cx0,cx1] of row `cy` (all the row by default): returns
+	 * a pointer to the storage itself with dense storage, or to `buf`, filled
+	 * in with one block copy per tile, with tiled storage. */
+	const cellType* getRowData(
+		unsigned cy, std::vector<cellType>& buf, unsigned cx0 = 0,
+		int cx1 = -1) const;
+	/** Overwrites all the cells of row `cy` (`size_x` values). With tiled
+	 * storage, tiles are not allocated for blocks of default-valued cells. */
+	void setRowData(unsigned cy, const cellType* row);
+	/** getRow() with tiled storage: a copy of row `cy` in a thread-local
+	 * buffer */
+	const cellType* internal_getRowTiled(unsigned cy) const;
+	/** Used by resizeGrid() with tiled storage: moves the tiles by
+	 * (extra_x,extra_y) cells (multiples of TILE_SIZE) within the new tile
+	 * directory. Cells not in the old grid get `new_cells_value`. */
+	void internal_resizeTiles(
+		unsigned int extra_x, unsigned int extra_y, unsigned int new_size_x,
+		unsigned int new_size_y, cellType new_cells_value);
+
 	/** Change the contents [0,1] of a cell, given its index */
 	inline void setCell_nocheck(int x, int y, float value)
 	{
-		map[x + y * size_x] = p2l(value);
+		*cellPtr(x, y) = p2l(value);
+		m_likelihoodDT_ToBeUpdated = true;
+		m_simulDF.toBeUpdated = true;
 	}
 
 	/** Read the real valued [0,1] contents of a cell, given its index */
 	inline float getCell_nocheck(int x, int y) const
 	{
-		return l2p(map[x + y * size_x]);
+		return l2p(cellValue(x, y));
 	}
 	/** Changes a cell by its absolute index (Do not use it normally) */
 	inline void setRawCell(unsigned int cellIndex, cellType b)
 	{
-		if (cellIndex < size_x * size_y) map[cellIndex] = b;
+		if (cellIndex < size_x * size_y)
+		{
+			*cellPtr(cellIndex % size_x, cellIndex / size_x) = b;
+			m_likelihoodDT_ToBeUpdated = true;
+			m_simulDF.toBeUpdated = true;
+		}
 	}
 
 	/** One of the methods that can be selected for implementing
@@ -196,6 +356,11 @@ class COccupancyGridMap2D : public CMetricMap,
 		const mrpt::obs::CObservation* obs,
 		const mrpt::poses::CPose2D& takenFrom);
 
+	/** Recomputes the exact distance transform within the cell window
+	 * [x0,x1]x[y0,y1], using the occupancy in a window enlarged by the
+	 * saturation distance (so the result is exact inside the window). */
+	void internal_updateLikelihoodDT_window(int x0, int x1, int y0, int y1);
+
 	/** Clear the map: It set all cells to their default occupancy value (0.5),
 	 * without changing the resolution (the grid extension is reset to the
 	 * default values). */
@@ -217,13 +382,67 @@ class COccupancyGridMap2D : public CMetricMap,
 		const mrpt::poses::CPose3D* robotPose = nullptr) override;
 
    public:
-	/** Read-only access to the raw cell contents (cells are in log-odd units)
-	 */
+	/** Read-only access to the raw cell contents (cells are in log-odd units).
+	 * \note This is empty with tiled storage. \sa setTiledStorage */
 	const std::vector<cellType>& getRawMap() const { return this->map; }
+
+	/** Edge length of the square tiles used by the tiled storage, in cells
+	 * (as a power of 2) */
+	static const unsigned TILE_SIZE_LOG2 = 6;
+	static const unsigned TILE_SIZE = 1u << TILE_SIZE_LOG2;
+
+	/** Selects between the default dense storage of cells (a single array,
+	 * row by row) and the tiled storage, where the grid is split in square
+	 * tiles of TILE_SIZE x TILE_SIZE cells which are only allocated when some
+	 * of their cells are modified. With tiled storage:
+	 *  - Unexplored areas take no memory.
+	 *  - resizeGrid() never copies the existing cells, it only rearranges the
+	 *    tile directory (the grid is grown by whole tiles at its left/bottom
+	 *    sides to that end).
+	 *  - Cells are not contiguous, so getRawMap() is empty, the const
+	 *    getRow() returns a copy of the row and the non-const getRow()
+	 *    switches the map back to dense storage. getRowSpan() gives direct
+	 *    access to the cells of each tile instead.
+	 *  - Copies of the map share their tiles, which are only duplicated when
+	 *    one of the copies modifies them (copy-on-write).
+	 *
+	 * The current contents of the map are kept.
+	 * \sa isTiledStorage, getAllocatedTilesCount, getSharedTilesCount */
+	void setTiledStorage(bool enable);
+	/** Whether tiled storage is used \sa setTiledStorage */
+	bool isTiledStorage() const { return m_tiled; }
+	/** Number of tiles currently in memory (zero with dense storage)
+	 * \sa setTiledStorage */
+	size_t getAllocatedTilesCount() const;
+	/** Number of tiles currently shared with other copies of this map (see
+	 * setTiledStorage) */
+	size_t getSharedTilesCount() const;
 	/** Performs the Bayesian fusion of a new observation of a cell  \sa
 	 * updateInfoChangeOnly, updateCell_fast_occupied, updateCell_fast_free */
 	void updateCell(int x, int y, float v);
 
+	/** Inserts a sequence of observations, each one from the robot pose with
+	 * the same index, exactly as calling insertObservation() for each of
+	 * them in order would do, but faster.
+	 *
+	 * Runs of consecutive mrpt::obs::CObservation2DRangeScan's inserted as
+	 * simple rays (i.e. with TInsertionOptions::wideningBeamsWithDistance
+	 * disabled) are processed in blocks: the grid is first grown as needed
+	 * for the whole block, then the rays of all its scans are traced, split
+	 * by scans among threads, into lists of cell updates, which are finally
+	 * applied split by bands of rows among threads. Since each band applies
+	 * its updates in the original order of the scans, the resulting cells are
+	 * bit-identical to those of serial insertion. Other observations are
+	 * inserted one by one with insertObservation().
+	 *
+	 * \param threadPool If not nullptr, the work is split among its threads.
+	 * \return The number of observations actually inserted.
+	 * \sa insertObservation */
+	size_t insertObservationsBatch(
+		const std::vector<const mrpt::obs::CObservation*>& obs,
+		const std::vector<mrpt::math::TPose3D>& robotPoses,
+		mrpt::utils::CWorkerThreadsPool* threadPool = nullptr);
+
 	/** An internal structure for storing data related to counting the new
 	 * information apported by some observation */
 	struct TUpdateCellsInfoChangeOnly
@@ -368,7 +587,11 @@ class COccupancyGridMap2D : public CMetricMap,
 			static_cast<unsigned int>(y) >= size_y)
 			return;
 		else
-			map[x + y * size_x] = p2l(value);
+		{
+			*cellPtr(x, y) = p2l(value);
+			m_likelihoodDT_ToBeUpdated = true;
+			m_simulDF.toBeUpdated = true;
+		}
 	}
 
 	/** Read the real valued [0,1] contents of a cell, given its index */
@@ -379,29 +602,66 @@ class COccupancyGridMap2D : public CMetricMap,
 			static_cast<unsigned int>(y) >= size_y)
 			return 0.5f;
 		else
-			return l2p(map[x + y * size_x]);
+			return l2p(cellValue(x, y));
 	}
 
 	/** Access to a "row": mainly used for drawing grid as a bitmap efficiently,
-	 * do not use it normally */
+	 * do not use it normally.
+	 * \note Writing through the returned pointer requires contiguous cells,
+	 * so with tiled storage this first switches the map to dense storage
+	 * (see setTiledStorage()). Use the const version or getRowSpan() to only
+	 * read the row. */
 	inline cellType* getRow(int cy)
 	{
-		if (cy < 0 || static_cast<unsigned int>(cy) >= size_y)
-			return nullptr;
-		else
-			return &map[0 + cy * size_x];
+		if (cy < 0 || static_cast<unsigned int>(cy) >= size_y) return nullptr;
+		if (m_tiled) setTiledStorage(false);
+		// The caller may modify any cell of the row:
+		m_likelihoodDT_ToBeUpdated = true;
+		m_simulDF.toBeUpdated = true;
+		for (unsigned cx = 0; cx < size_x; cx += TILE_SIZE)
+			markCellModified(cx, cy);
+		return &map[0 + cy * size_x];
 	}
 
 	/** Access to a "row": mainly used for drawing grid as a bitmap efficiently,
-	 * do not use it normally */
+	 * do not use it normally.
+	 * \note With tiled storage, this returns a copy of the row in a buffer
+	 * owned by the calling thread, which is only valid until the next call
+	 * to this method from that thread. getRowSpan() reads the cells in place
+	 * instead. */
 	inline const cellType* getRow(int cy) const
 	{
-		if (cy < 0 || static_cast<unsigned int>(cy) >= size_y)
-			return nullptr;
-		else
-			return &map[0 + cy * size_x];
+		if (cy < 0 || static_cast<unsigned int>(cy) >= size_y) return nullptr;
+		if (m_tiled) return internal_getRowTiled(cy);
+		return &map[0 + cy * size_x];
 	}
 
+	/** Read-only access to the cells of a row, with any storage, without
+	 * copying them: returns a pointer to the cells [cx,cx+n) of row `cy`,
+	 * where `n` is the number of them which are contiguous in memory, up to
+	 * `cx_last` (all of them with dense storage, or those up to the end of
+	 * the tile with tiled storage). Returns nullptr for tiles not allocated
+	 * yet, whose cells all have the value getTilesDefaultCell(). Limits are
+	 * not checked. */
+	inline const cellType* getRowSpan(
+		unsigned cx, unsigned cy, unsigned cx_last, unsigned& n) const
+	{
+		if (!m_tiled)
+		{
+			n = cx_last - cx + 1;
+			return &map[cx + cy * size_x];
+		}
+		n = std::min(cx_last, cx | (TILE_SIZE - 1)) - cx + 1;
+		const tile_ptr_t& tile =
+			m_tiles[(cx >> TILE_SIZE_LOG2) + (cy >> TILE_SIZE_LOG2) * m_tiles_x];
+		if (!tile) return nullptr;
+		return &(*tile)
+			[(cx & (TILE_SIZE - 1)) + ((cy & (TILE_SIZE - 1)) << TILE_SIZE_LOG2)];
+	}
+	/** The value of all the cells in tiles not allocated yet, with tiled
+	 * storage \sa getRowSpan */
+	inline cellType getTilesDefaultCell() const { return m_tiles_default; }
+
 	/** Change the contents [0,1] of a cell, given its coordinates */
 	inline void setPos(float x, float y, float value)
 	{
@@ -561,7 +821,12 @@ class COccupancyGridMap2D : public CMetricMap,
 		lmCellsDifference,
 		lmLikelihoodField_Thrun,
 		lmLikelihoodField_II,
-		lmConsensusOWA
+		lmConsensusOWA,
+		/** Same model than lmLikelihoodField_Thrun, but evaluated with O(1)
+		 * lookups into an exact Euclidean distance transform of the grid,
+		 * which is built in linear time and incrementally updated only
+		 * around changed cells. See updateLikelihoodDistanceTransform() */
+		lmLikelihoodField_DistanceTransform
 		// Remember: Update TEnumType below if new values are added here!
 	};
 
@@ -802,6 +1067,9 @@ class COccupancyGridMap2D : public CMetricMap,
 	*D, 2D, 3D, ... Default is D=1
 	 * \param angleNoiseStd [IN] The sigma of an optional Gaussian noise added
 	*to the angles at which ranges are measured (in radians).
+	 * \param threadPool [IN] If not nullptr, rays are split among its
+	*threads. Only used without angle noise, so the random numbers drawn (and
+	*hence the simulated scan) are the same as in serial simulation.
 	 *
 	* \sa laserScanSimulatorWithUncertainty(), sonarSimulator(),
 	*COccupancyGridMap2D::RAYTRACE_STEP_SIZE_IN_CELL_UNITS
@@ -810,7 +1078,8 @@ class COccupancyGridMap2D : public CMetricMap,
 		mrpt::obs::CObservation2DRangeScan& inout_Scan,
 		const mrpt::poses::CPose2D& robotPose, float threshold = 0.6f,
 		size_t N = 361, float noiseStd = 0, unsigned int decimation = 1,
-		float angleNoiseStd = mrpt::utils::DEG2RAD(0)) const;
+		float angleNoiseStd = mrpt::utils::DEG2RAD(0),
+		mrpt::utils::CWorkerThreadsPool* threadPool = nullptr) const;
 
 	/** Simulates the observations of a sonar rig into the current grid map.
 	 *   The simulated ranges are stored in a CObservationRange object, which is
@@ -840,8 +1109,16 @@ class COccupancyGridMap2D : public CMetricMap,
 		float angleNoiseStd = mrpt::utils::DEG2RAD(0.f)) const;
 
 	/** Simulate just one "ray" in the grid map. This method is used internally
-	 * to sonarSimulator and laserScanSimulator. \sa
-	 * COccupancyGridMap2D::RAYTRACE_STEP_SIZE_IN_CELL_UNITS */
+	 * to sonarSimulator and laserScanSimulator.
+	 *
+	 * The ray advances in steps of RAYTRACE_STEP_SIZE_IN_CELL_UNITS cells
+	 * until it reaches a cell with an occupancy >= 1-threshold_free. Unless
+	 * RAYTRACE_USE_DISTANCE_FIELD is disabled, it jumps over as many steps
+	 * at once as fit in the free space around the current cell, which is
+	 * looked up in a distance field of the grid. This field is built the
+	 * first time it is needed after each change of the map or of the
+	 * threshold.
+	 * \sa COccupancyGridMap2D::RAYTRACE_STEP_SIZE_IN_CELL_UNITS */
 	void simulateScanRay(
 		const double x, const double y, const double angle_direction,
 		float& out_range, bool& out_valid, const double max_range_meters,
@@ -905,6 +1182,9 @@ class COccupancyGridMap2D : public CMetricMap,
 		/** (Default: 0.6f) The minimum occupancy threshold to consider a cell
 		 * to be occupied */
 		float threshold;
+		/** (Default: nullptr) If set, the rays of each simulated scan are
+		 * split among the threads of this pool */
+		mrpt::utils::CWorkerThreadsPool* threadPool;
 		/** @} */
 
 		TLaserSimulUncertaintyParams();
@@ -950,6 +1230,35 @@ class COccupancyGridMap2D : public CMetricMap,
 		const CPointsMap* pm,
 		const mrpt::poses::CPose2D* relativePose = nullptr);
 
+	/** Like computeLikelihoodField_Thrun(), but looking up the distance to
+	 * the closest occupied cell in a precomputed distance transform instead
+	 * of searching a window around each point.
+	 * \sa updateLikelihoodDistanceTransform */
+	double computeLikelihoodField_DistanceTransform(
+		const CPointsMap* pm,
+		const mrpt::poses::CPose2D* relativePose = nullptr);
+
+	/** Brings the distance transform used by
+	 * lmLikelihoodField_DistanceTransform up to date with the current map
+	 * contents. The first time (or after a change of size, resolution or
+	 * LF_maxCorrsDistance) it is built for the whole grid in O(N); after that,
+	 * only the blocks of TILE_SIZE x TILE_SIZE cells written since the last
+	 * update are checked for cells whose occupied/free state changed, and
+	 * the field is recomputed around each group of adjacent changed blocks,
+	 * up to LF_maxCorrsDistance from the changed cells. It is automatically called when needed,
+	 * but can be invoked in advance to avoid the delay of the first
+	 * likelihood evaluation after a map update.
+	 * \sa getLikelihoodDistanceTransform */
+	void updateLikelihoodDistanceTransform();
+
+	/** Read-only access to the squared distances (in meters^2) to the closest
+	 * occupied cell, saturated at LF_maxCorrsDistance^2, in the same order
+	 * than getRawMap(). Call updateLikelihoodDistanceTransform() first. */
+	const std::vector<float>& getLikelihoodDistanceTransform() const
+	{
+		return m_likelihoodDT;
+	}
+
 	/** Computes the likelihood [0,1] of a set of points, given the current grid
 	 * map as reference.
 	  * \param pm The points map
@@ -1144,9 +1453,21 @@ class COccupancyGridMap2D : public CMetricMap,
 		const mrpt::obs::CObservation* obs,
 		const mrpt::poses::CPose3D& takenFrom) override;
 	// See docs in base class
+	void internal_computeObservationLikelihoodBatch(
+		const mrpt::obs::CObservation* obs,
+		const std::vector<mrpt::math::TPose3D>& takenFrom,
+		std::vector<double>& out_logliks,
+		mrpt::utils::CWorkerThreadsPool* threadPool) override;
+	// See docs in base class
 	bool internal_canComputeObservationLikelihood(
 		const mrpt::obs::CObservation* obs) const override;
 
+	/** The core of computeLikelihoodField_DistanceTransform(), which only
+	 * reads the (already up-to-date) distance transform, hence it is safe to
+	 * call it from several threads at once. */
+	double internal_likelihoodField_DT(
+		const CPointsMap& pm, const mrpt::math::TPose2D& pose) const;
+
 	/** Returns a byte with the occupancy of the 8 sorrounding cells.
 	 * \param cx The cell index
 	 * \param cy The cell index
@@ -1169,6 +1490,8 @@ class COccupancyGridMap2D : public CMetricMap,
 	MAP_DEFINITION_START(COccupancyGridMap2D)
 	/** See COccupancyGridMap2D::COccupancyGridMap2D */
 	float min_x, max_x, min_y, max_y, resolution;
+	/** See COccupancyGridMap2D::setTiledStorage (default=false) */
+	bool tiledStorage;
 	/** Observations insertion options */
 	mrpt::maps::COccupancyGridMap2D::TInsertionOptions insertionOpts;
 	/** Probabilistic observation likelihood options */
@@ -1197,6 +1520,8 @@ struct TEnumTypeFiller<mrpt::maps::COccupancyGridMap2D::TLikelihoodMethod>
 		MRPT_FILL_ENUM_MEMBER(COccupancyGridMap2D, lmLikelihoodField_Thrun);
 		MRPT_FILL_ENUM_MEMBER(COccupancyGridMap2D, lmLikelihoodField_II);
 		MRPT_FILL_ENUM_MEMBER(COccupancyGridMap2D, lmConsensusOWA);
+		MRPT_FILL_ENUM_MEMBER(
+			COccupancyGridMap2D, lmLikelihoodField_DistanceTransform);
 	}
 };
 }
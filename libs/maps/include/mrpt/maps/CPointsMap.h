@@ -581,7 +581,7 @@ class CPointsMap : public CMetricMap,
 	inline void insertPoint(float x, float y, float z = 0)
 	{
 		insertPointFast(x, y, z);
-		mark_as_modified();
+		mark_as_appended();
 	}
 	/// \overload
 	inline void insertPoint(const mrpt::math::TPoint3D& p)
@@ -943,6 +943,12 @@ class CPointsMap : public CMetricMap,
 	virtual double internal_computeObservationLikelihood(
 		const mrpt::obs::CObservation* obs,
 		const mrpt::poses::CPose3D& takenFrom) override;
+	// See docs in base class
+	void internal_computeObservationLikelihoodBatch(
+		const mrpt::obs::CObservation* obs,
+		const std::vector<mrpt::math::TPose3D>& takenFrom,
+		std::vector<double>& out_logliks,
+		mrpt::utils::CWorkerThreadsPool* threadPool) override;
 
 	/** @name PCL library support
 		@{ */
@@ -1061,6 +1067,27 @@ class CPointsMap : public CMetricMap,
 	}
 	/** @} */
 
+	/** @name Local surface estimation
+		@{ */
+	/** Returns the unit normal of the plane which best fits each point and its
+	 * `knn` nearest neighbors, with an arbitrary sign, or (0,0,0) for points
+	 * whose neighborhood is degenerate (e.g. less than 3 points in the map).
+	 * Normals are estimated on the first call and cached until the map is
+	 * modified, along with its KD-tree.
+	 * \sa getPointsPlaneCovariances */
+	const std::vector<mrpt::math::TPoint3Df>& getPointsNormals(
+		const size_t knn = 10) const;
+
+	/** Returns, for each point, the covariance of a point lying on its local
+	 * plane (see getPointsNormals()), as used by Generalized-ICP: \f$ R
+	 * \textrm{diag}(\epsilon,1,1) R^T \f$, with the first column of
+	 * \f$ R \f$ being the normal and \f$ \epsilon=10^{-3} \f$. Points with a
+	 * degenerate neighborhood get the identity. Cached like the normals.
+	 * \sa getPointsNormals */
+	const std::vector<mrpt::math::CMatrixFixedNumeric<float, 3, 3>>&
+		getPointsPlaneCovariances(const size_t knn = 10) const;
+	/** @} */
+
 	/** Users normally don't need to call this. Called by this class or children
 	 * classes, set m_largestDistanceFromOriginIsUpdated=false, invalidates the
 	 * kd-tree cache, and such. */
@@ -1068,9 +1095,22 @@ class CPointsMap : public CMetricMap,
 	{
 		m_largestDistanceFromOriginIsUpdated = false;
 		m_boundingBoxIsUpdated = false;
+		m_local_planes.knn = 0;
 		kdtree_mark_as_outdated();
 	}
 
+	/** Like mark_as_modified(), but for changes which only consist of new
+	 * points appended at the end of the map, without modifying existing ones:
+	 * the KD-tree index of the existing points is kept, and only the new ones
+	 * will be indexed in the next query. */
+	inline void mark_as_appended() const
+	{
+		m_largestDistanceFromOriginIsUpdated = false;
+		m_boundingBoxIsUpdated = false;
+		m_local_planes.knn = 0;
+		kdtree_mark_as_appended();
+	}
+
    protected:
 	/** The point coordinates */
 	std::vector<float> x, y, z;
@@ -1092,6 +1132,35 @@ class CPointsMap : public CMetricMap,
 	mutable float m_bb_min_x, m_bb_max_x, m_bb_min_y, m_bb_max_y, m_bb_min_z,
 		m_bb_max_z;
 
+	/** Cache of getPointsNormals() and getPointsPlaneCovariances() */
+	struct TLocalPlanesCache
+	{
+		TLocalPlanesCache() : knn(0) {}
+		/** The number of neighbors used, 0 if the cache is not valid */
+		size_t knn;
+		std::vector<mrpt::math::TPoint3Df> normals;
+		std::vector<mrpt::math::CMatrixFixedNumeric<float, 3, 3>> covs;
+	};
+	mutable TLocalPlanesCache m_local_planes;
+	/** Updates m_local_planes, if needed */
+	void updateLocalPlanes(const size_t knn) const;
+
+	/** Common implementation of determineMatching2D() (is3D=false, matching
+	 * with the 2D KD-tree) and determineMatching3D() (is3D=true) */
+	void determineMatchingBatch(
+		const CPointsMap& otherMap, const mrpt::poses::CPose3D& otherMapPose,
+		const bool is3D, mrpt::utils::TMatchingPairList& correspondences,
+		const TMatchingParams& params,
+		TMatchingExtraResults& extraResults) const;
+
+	/** Log-likelihood of the points of a scan, seen from `takenFrom`, used by
+	 * internal_computeObservationLikelihood(). Only KD-tree queries are done
+	 * here, so it can be called from several threads once the KD-tree is
+	 * built. */
+	double internal_computeScanPointsLikelihood(
+		const CPointsMap& scanPoints,
+		const mrpt::poses::CPose3D& takenFrom) const;
+
 	/** This is a common version of CMetricMap::insertObservation() for point
 	 * maps (actually, CMetricMap::internal_insertObservation),
 	  *   so derived classes don't need to worry implementing that method unless
@@ -1191,7 +1260,12 @@ class PointCloudAdapter<mrpt::maps::CPointsMap>
 	/** Get number of points */
 	inline size_t size() const { return m_obj.size(); }
 	/** Set number of points (to uninitialized values) */
-	inline void resize(const size_t N) { m_obj.resize(N); }
+	inline void resize(const size_t N)
+	{
+		m_obj.resize(N);
+		// All points are going to be overwritten:
+		m_obj.mark_as_modified();
+	}
 	/** Get XYZ coordinates of i'th point */
 	template <typename T>
 	inline void getPointXYZ(const size_t idx, T& x, T& y, T& z) const
@@ -1204,6 +1278,12 @@ class PointCloudAdapter<mrpt::maps::CPointsMap>
 	{
 		m_obj.setPointFast(idx, x, y, z);
 	}
+
+	/** Not supported: point maps must be dense */
+	inline void setInvalidPoint(const size_t idx)
+	{
+		THROW_EXCEPTION("mrpt::maps::CPointsMap needs to be dense");
+	}
 };  // end of PointCloudAdapter<mrpt::maps::CPointsMap>
 }
 
@@ -177,7 +177,12 @@ class PointCloudAdapter<mrpt::maps::CSimplePointsMap>
 	/** Get number of points */
 	inline size_t size() const { return m_obj.size(); }
 	/** Set number of points (to uninitialized values) */
-	inline void resize(const size_t N) { m_obj.resize(N); }
+	inline void resize(const size_t N)
+	{
+		m_obj.resize(N);
+		// All points are going to be overwritten:
+		m_obj.mark_as_modified();
+	}
 	/** Get XYZ coordinates of i'th point */
 	template <typename T>
 	inline void getPointXYZ(const size_t idx, T& x, T& y, T& z) const
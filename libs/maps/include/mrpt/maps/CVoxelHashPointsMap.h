@@ -0,0 +1,235 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+#ifndef CVoxelHashPointsMap_H
+#define CVoxelHashPointsMap_H
+
+#include <mrpt/maps/CMetricMap.h>
+#include <mrpt/maps/CPointsMap.h>
+#include <mrpt/utils/CSerializable.h>
+#include <mrpt/utils/CLoadableOptions.h>
+#include <mrpt/math/lightweight_geom_data.h>
+#include <mrpt/poses/CPose3D.h>
+#include <mrpt/obs/obs_frwds.h>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace mrpt
+{
+namespace maps
+{
+/** A 3D point cloud map stored in a sparse spatial hash of cubic voxels, each
+ * one holding a bounded number of points.
+ *
+ * Compared to mrpt::maps::CSimplePointsMap:
+ *  - Inserting a point takes constant time: there is no global KD-tree to be
+ *    rebuilt, and the downsampling (see TInsertionOptions) only checks the
+ *    few points in the target voxel.
+ *  - Nearest neighbour and radius searches only visit the voxels around the
+ *    query point (see nn_single_search(), nn_radius_search()).
+ *  - Whole voxels far from a given location can be cheaply dropped with
+ *    removeVoxelsFartherThan(), which keeps the memory bounded for
+ *    long-running mapping with 3D LIDARs.
+ *
+ * Observations are inserted by converting them into points exactly as
+ * mrpt::maps::CSimplePointsMap does, so any observation supported by points
+ * maps can be inserted here. This map can be the reference map ("m1") in
+ * mrpt::slam::CICP::Align3D(), via determineMatching3D(), and be part of a
+ * mrpt::maps::CMultiMetricMap, with the name `CVoxelHashPointsMap` or
+ * `voxelHashPointsMap` in configuration files.
+ *
+ * \note The `this_idx` field in the pairings returned by
+ * determineMatching3D() is only meaningful within each matching result:
+ * points in this map do not have a stable index.
+ * \ingroup mrpt_maps_grp
+ * \sa CSimplePointsMap, CMetricMap
+ */
+class CVoxelHashPointsMap : public mrpt::maps::CMetricMap
+{
+	DEFINE_SERIALIZABLE(CVoxelHashPointsMap)
+
+   public:
+	/** Integer coordinates of a voxel */
+	struct TVoxelIndex
+	{
+		TVoxelIndex(int32_t ix_ = 0, int32_t iy_ = 0, int32_t iz_ = 0)
+			: ix(ix_), iy(iy_), iz(iz_)
+		{
+		}
+		int32_t ix, iy, iz;
+		bool operator==(const TVoxelIndex& o) const
+		{
+			return ix == o.ix && iy == o.iy && iz == o.iz;
+		}
+	};
+	/** Hash functor for TVoxelIndex */
+	struct TVoxelIndexHash
+	{
+		std::size_t operator()(const TVoxelIndex& v) const
+		{
+			// Large primes, as in Teschner et al. (2003), "Optimized Spatial
+			// Hashing for Collision Detection of Deformable Objects".
+			return static_cast<std::size_t>(
+				(static_cast<uint64_t>(v.ix) * 73856093u) ^
+				(static_cast<uint64_t>(v.iy) * 19349663u) ^
+				(static_cast<uint64_t>(v.iz) * 83492791u));
+		}
+	};
+	/** The contents of one voxel */
+	struct TVoxel
+	{
+		std::vector<mrpt::math::TPoint3Df> points;
+	};
+	typedef std::unordered_map<TVoxelIndex, TVoxel, TVoxelIndexHash>
+		voxel_map_t;
+
+	/** Constructor, with the edge length of voxels (in meters) */
+	CVoxelHashPointsMap(double voxel_size = 0.20);
+
+	/** Clears the map and changes the edge length of voxels (in meters) */
+	void setVoxelSize(double voxel_size);
+	/** The edge length of voxels (in meters) */
+	double getVoxelSize() const { return m_voxel_size; }
+	/** The total number of points in the map */
+	size_t size() const { return m_num_points; }
+	/** The number of non-empty voxels in the map */
+	size_t voxelCount() const { return m_voxels.size(); }
+	/** Read-only access to the raw voxels */
+	const voxel_map_t& voxels() const { return m_voxels; }
+
+	/** Inserts a point, in global coordinates, unless its voxel is already
+	 * full or it is closer than
+	 * TInsertionOptions::minDistBetweenPoints to another point in the same
+	 * voxel.
+	 * \return true if the point was actually inserted. */
+	bool insertPoint(float x, float y, float z);
+	/** \overload */
+	bool insertPoint(const mrpt::math::TPoint3Df& p)
+	{
+		return insertPoint(p.x, p.y, p.z);
+	}
+	/** Inserts all the points of a points map, transformed by the given pose
+	 * (use a default-constructed pose for none). \return The number of points
+	 * actually inserted */
+	size_t insertPointsFrom(
+		const mrpt::maps::CPointsMap& pts,
+		const mrpt::poses::CPose3D& pose = mrpt::poses::CPose3D());
+
+	/** Returns all the points in the map (in an unspecified order) */
+	void getAllPoints(std::vector<mrpt::math::TPoint3Df>& out_pts) const;
+
+	/** Finds the closest point to `query` within a distance of `max_dist`.
+	 * \return false if there is no point within that distance.
+	 * \sa nn_radius_search */
+	bool nn_single_search(
+		const mrpt::math::TPoint3Df& query, float max_dist,
+		mrpt::math::TPoint3Df& out_closest, float& out_dist_sqr) const;
+
+	/** Finds all the points within a distance of `radius` from `query`,
+	 * sorted by ascending distance.
+	 * \sa nn_single_search */
+	void nn_radius_search(
+		const mrpt::math::TPoint3Df& query, float radius,
+		std::vector<mrpt::math::TPoint3Df>& out_points,
+		std::vector<float>& out_dists_sqr) const;
+
+	/** Removes all the voxels whose center is farther than `max_dist` from
+	 * `center`. \return The number of removed points */
+	size_t removeVoxelsFartherThan(
+		const mrpt::math::TPoint3D& center, double max_dist);
+
+	/** Returns the voxel containing a given point */
+	TVoxelIndex voxelIndex(float x, float y, float z) const
+	{
+		return TVoxelIndex(
+			coord2idx(x * m_voxel_size_inv), coord2idx(y * m_voxel_size_inv),
+			coord2idx(z * m_voxel_size_inv));
+	}
+
+	// See docs in base class
+	bool isEmpty() const override;
+	void determineMatching3D(
+		const mrpt::maps::CMetricMap* otherMap,
+		const mrpt::poses::CPose3D& otherMapPose,
+		mrpt::utils::TMatchingPairList& correspondences,
+		const TMatchingParams& params,
+		TMatchingExtraResults& extraResults) const override;
+	float compute3DMatchingRatio(
+		const mrpt::maps::CMetricMap* otherMap,
+		const mrpt::poses::CPose3D& otherMapPose,
+		const TMatchingRatioParams& params) const override;
+	/** Saves all points as a text file "<filNamePrefix>.txt", one "X Y Z" per
+	 * line. */
+	void saveMetricMapRepresentationToFile(
+		const std::string& filNamePrefix) const override;
+	void getAs3DObject(mrpt::opengl::CSetOfObjects::Ptr& outObj) const override;
+
+	/** Options used when inserting points and observations */
+	struct TInsertionOptions : public utils::CLoadableOptions
+	{
+		TInsertionOptions();
+		void loadFromConfigFile(
+			const mrpt::utils::CConfigFileBase& source,
+			const std::string& section) override;  // See base docs
+		void dumpToTextStream(
+			mrpt::utils::CStream& out) const override;  // See base docs
+
+		/** Maximum number of points stored in each voxel: new points falling
+		 * into a full voxel are discarded (default=20) */
+		uint32_t maxPointsPerVoxel;
+		/** New points closer than this distance (in meters) to some other
+		 * point in the same voxel are discarded. Zero disables this check
+		 * (default=0.05) */
+		float minDistBetweenPoints;
+	};
+	TInsertionOptions insertionOptions;
+
+	/** Options for the observation likelihood; they have the same meaning
+	 * than in mrpt::maps::CPointsMap */
+	mrpt::maps::CPointsMap::TLikelihoodOptions likelihoodOptions;
+
+	MAP_DEFINITION_START(CVoxelHashPointsMap)
+	/** See CVoxelHashPointsMap::CVoxelHashPointsMap */
+	double voxel_size;
+	mrpt::maps::CVoxelHashPointsMap::TInsertionOptions insertionOpts;
+	mrpt::maps::CPointsMap::TLikelihoodOptions likelihoodOpts;
+	MAP_DEFINITION_END(CVoxelHashPointsMap, )
+
+   protected:
+	double m_voxel_size, m_voxel_size_inv;
+	voxel_map_t m_voxels;
+	size_t m_num_points;
+
+	static int32_t coord2idx(float xs)
+	{
+		return static_cast<int32_t>(std::floor(xs));
+	}
+
+	const mrpt::math::TPoint3Df* internal_nn_single_search(
+		const mrpt::math::TPoint3Df& query, float max_dist,
+		float& out_dist_sqr) const;
+	double internal_computeScanPointsLikelihood(
+		const mrpt::maps::CPointsMap& scanPoints,
+		const mrpt::poses::CPose3D& takenFrom) const;
+
+	// See docs in base class
+	void internal_clear() override;
+	bool internal_insertObservation(
+		const mrpt::obs::CObservation* obs,
+		const mrpt::poses::CPose3D* robotPose = nullptr) override;
+	double internal_computeObservationLikelihood(
+		const mrpt::obs::CObservation* obs,
+		const mrpt::poses::CPose3D& takenFrom) override;
+};  // End of class def.
+
+}  // End of namespace
+}  // End of namespace
+
+#endif
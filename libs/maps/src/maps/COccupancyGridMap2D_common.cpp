@@ -16,6 +16,8 @@
 #include <mrpt/maps/CSimplePointsMap.h>
 #include <mrpt/utils/CStream.h>
 #include <mrpt/poses/CPose3D.h>
+#include <algorithm>
+#include <cstring>
 
 using namespace mrpt;
 using namespace mrpt::math;
@@ -34,7 +36,8 @@ COccupancyGridMap2D::TMapDefinition::TMapDefinition()
 	  max_x(10.0f),
 	  min_y(-10.0f),
 	  max_y(10.0f),
-	  resolution(0.10f)
+	  resolution(0.10f),
+	  tiledStorage(false)
 {
 }
 
@@ -50,6 +53,7 @@ void COccupancyGridMap2D::TMapDefinition::loadFromConfigFile_map_specific(
 	MRPT_LOAD_CONFIG_VAR(min_y, float, source, sSectCreation);
 	MRPT_LOAD_CONFIG_VAR(max_y, float, source, sSectCreation);
 	MRPT_LOAD_CONFIG_VAR(resolution, float, source, sSectCreation);
+	MRPT_LOAD_CONFIG_VAR(tiledStorage, bool, source, sSectCreation);
 
 	// [<sectionName>+"_occupancyGrid_##_insertOpts"]
 	insertionOpts.loadFromConfigFile(
@@ -68,6 +72,7 @@ void COccupancyGridMap2D::TMapDefinition::dumpToTextStream_map_specific(
 	LOADABLEOPTS_DUMP_VAR(min_y, float);
 	LOADABLEOPTS_DUMP_VAR(max_y, float);
 	LOADABLEOPTS_DUMP_VAR(resolution, float);
+	LOADABLEOPTS_DUMP_VAR(tiledStorage, bool);
 
 	this->insertionOpts.dumpToTextStream(out);
 	this->likelihoodOpts.dumpToTextStream(out);
@@ -80,6 +85,7 @@ mrpt::maps::CMetricMap* COccupancyGridMap2D::internal_CreateFromMapDefinition(
 		*dynamic_cast<const COccupancyGridMap2D::TMapDefinition*>(&_def);
 	COccupancyGridMap2D* obj = new COccupancyGridMap2D(
 		def.min_x, def.max_x, def.min_y, def.max_y, def.resolution);
+	if (def.tiledStorage) obj->setTiledStorage(true);
 	obj->insertionOptions = def.insertionOpts;
 	obj->likelihoodOptions = def.likelihoodOpts;
 	return obj;
@@ -106,6 +112,11 @@ CLogOddsGridMapLUT<COccupancyGridMap2D::cellType> & COccupancyGridMap2D::get_log
 COccupancyGridMap2D::COccupancyGridMap2D(
 	float min_x, float max_x, float min_y, float max_y, float resolution)
 	: map(),
+	  m_tiled(false),
+	  m_tiles(),
+	  m_tiles_x(0),
+	  m_tiles_y(0),
+	  m_tiles_default(0),
 	  size_x(0),
 	  size_y(0),
 	  x_min(),
@@ -115,6 +126,13 @@ COccupancyGridMap2D::COccupancyGridMap2D(
 	  resolution(),
 	  precomputedLikelihood(),
 	  precomputedLikelihoodToBeRecomputed(true),
+	  m_likelihoodDT(),
+	  m_likelihoodDT_occupied(),
+	  m_likelihoodDT_dirty(),
+	  m_likelihoodDT_dirty_x(0),
+	  m_likelihoodDT_resolution(0),
+	  m_likelihoodDT_maxDist(0),
+	  m_likelihoodDT_ToBeUpdated(true),
 	  m_basis_map(),
 	  m_voronoi_diagram(),
 	  m_is_empty(true),
@@ -145,11 +163,19 @@ void COccupancyGridMap2D::copyMapContentFrom(const COccupancyGridMap2D& o)
 	size_x = o.size_x;
 	size_y = o.size_y;
 	map = o.map;
+	m_tiled = o.m_tiled;
+	m_tiles = o.m_tiles;
+	m_tiles_x = o.m_tiles_x;
+	m_tiles_y = o.m_tiles_y;
+	m_tiles_default = o.m_tiles_default;
 
 	m_basis_map.clear();
 	m_voronoi_diagram.clear();
 
 	precomputedLikelihoodToBeRecomputed = true;
+
+	m_likelihoodDT_ToBeUpdated = true;
+	m_simulDF.toBeUpdated = true;
 	m_is_empty = o.m_is_empty;
 }
 
@@ -171,6 +197,8 @@ void COccupancyGridMap2D::setSize(
 
 	// For the precomputed likelihood trick:
 	precomputedLikelihoodToBeRecomputed = true;
+	m_likelihoodDT_ToBeUpdated = true;
+	m_simulDF.toBeUpdated = true;
 
 	// Adjust sizes to adapt them to full sized cells acording to the
 	// resolution:
@@ -202,7 +230,16 @@ void COccupancyGridMap2D::setSize(
 #endif
 
 	// Cells memory:
-	map.resize(size_x * size_y, p2l(default_value));
+	if (!m_tiled)
+		map.resize(size_x * size_y, p2l(default_value));
+	else
+	{
+		// Tiles will be allocated on demand:
+		m_tiles_x = (size_x + TILE_SIZE - 1) >> TILE_SIZE_LOG2;
+		m_tiles_y = (size_y + TILE_SIZE - 1) >> TILE_SIZE_LOG2;
+		m_tiles.resize(m_tiles_x * m_tiles_y);
+		m_tiles_default = p2l(default_value);
+	}
 
 	// Free these buffers also:
 	m_basis_map.clear();
@@ -248,6 +285,12 @@ void COccupancyGridMap2D::resizeGrid(
 
 	// For the precomputed likelihood trick:
 	precomputedLikelihoodToBeRecomputed = true;
+	m_likelihoodDT_ToBeUpdated = true;
+	m_simulDF.toBeUpdated = true;
+	// Cells move: the distance field will be rebuilt from scratch, so there
+	// is no need to track modified blocks until then:
+	m_likelihoodDT.clear();
+	m_likelihoodDT_dirty.clear();
 
 	// Add an additional margin:
 	if (additionalMargin)
@@ -275,6 +318,22 @@ void COccupancyGridMap2D::resizeGrid(
 	if (fabs(new_y_max / resolution - round(new_y_max / resolution)) > 0.05f)
 		new_y_max = resolution * round(new_y_max / resolution);
 
+	if (m_tiled)
+	{
+		// Grow by whole tiles at the left/bottom sides, so the existing tiles
+		// can be reused as they are:
+		const unsigned int extraLeft =
+			round((x_min - new_x_min) / resolution);
+		const unsigned int extraBottom =
+			round((y_min - new_y_min) / resolution);
+		const unsigned int nTilesLeft =
+			(extraLeft + TILE_SIZE - 1) >> TILE_SIZE_LOG2;
+		const unsigned int nTilesBottom =
+			(extraBottom + TILE_SIZE - 1) >> TILE_SIZE_LOG2;
+		new_x_min = x_min - nTilesLeft * TILE_SIZE * resolution;
+		new_y_min = y_min - nTilesBottom * TILE_SIZE * resolution;
+	}
+
 	// Change size: 4 sides extensions:
 	extra_x_izq = round((x_min - new_x_min) / resolution);
 	extra_y_arr = round((y_min - new_y_min) / resolution);
@@ -297,6 +356,22 @@ void COccupancyGridMap2D::resizeGrid(
 	assert(0 == (new_size_x % 16));
 #endif
 
+	if (m_tiled)
+	{
+		internal_resizeTiles(
+			extra_x_izq, extra_y_arr, new_size_x, new_size_y,
+			p2l(new_cells_default_value));
+
+		x_min = new_x_min;
+		x_max = new_x_max;
+		y_min = new_y_min;
+		y_max = new_y_max;
+
+		m_basis_map.clear();
+		m_voronoi_diagram.clear();
+		return;
+	}
+
 	// Reserve new mem block
 	new_map.resize(new_size_x * new_size_y, p2l(new_cells_default_value));
 
@@ -344,6 +419,12 @@ void COccupancyGridMap2D::freeMap()
 
 	// Free map and sectors
 	map.clear();
+	m_tiles.clear();
+	m_tiles_x = m_tiles_y = 0;
+	m_likelihoodDT.clear();
+	m_likelihoodDT_occupied.clear();
+	m_likelihoodDT_dirty.clear();
+	m_likelihoodDT_dirty_x = 0;
 
 	m_basis_map.clear();
 	m_voronoi_diagram.clear();
@@ -352,12 +433,180 @@ void COccupancyGridMap2D::freeMap()
 
 	// For the precomputed likelihood trick:
 	precomputedLikelihoodToBeRecomputed = true;
+	m_likelihoodDT_ToBeUpdated = true;
+	m_simulDF.toBeUpdated = true;
 
 	m_is_empty = true;
 
 	MRPT_END
 }
 
+/*---------------------------------------------------------------
+						setTiledStorage
+  ---------------------------------------------------------------*/
+void COccupancyGridMap2D::setTiledStorage(bool enable)
+{
+	if (enable == m_tiled) return;
+
+	std::vector<cellType> rowBuf;
+	if (enable)
+	{
+		std::vector<cellType> cells;
+		cells.swap(map);
+		m_tiled = true;
+		m_tiles_x = (size_x + TILE_SIZE - 1) >> TILE_SIZE_LOG2;
+		m_tiles_y = (size_y + TILE_SIZE - 1) >> TILE_SIZE_LOG2;
+		m_tiles.assign(m_tiles_x * m_tiles_y, tile_ptr_t());
+		m_tiles_default = p2l(0.5f);
+		for (unsigned int cy = 0; cy < size_y; cy++)
+			setRowData(cy, &cells[cy * size_x]);
+	}
+	else
+	{
+		std::vector<cellType> cells(size_x * size_y);
+		for (unsigned int cy = 0; cy < size_y; cy++)
+		{
+			const cellType* row = getRowData(cy, rowBuf);
+			std::copy(row, row + size_x, cells.begin() + cy * size_x);
+		}
+		m_tiled = false;
+		m_tiles.clear();
+		m_tiles_x = m_tiles_y = 0;
+		map.swap(cells);
+	}
+}
+
+size_t COccupancyGridMap2D::getAllocatedTilesCount() const
+{
+	size_t n = 0;
+	for (const auto& t : m_tiles)
+		if (t) n++;
+	return n;
+}
+
+size_t COccupancyGridMap2D::getSharedTilesCount() const
+{
+	size_t n = 0;
+	for (const auto& t : m_tiles)
+		if (t && t.use_count() > 1) n++;
+	return n;
+}
+
+const COccupancyGridMap2D::cellType* COccupancyGridMap2D::getRowData(
+	unsigned cy, std::vector<cellType>& buf, unsigned cx0, int cx1) const
+{
+	if (!m_tiled) return &map[cx0 + cy * size_x];
+
+	const unsigned last = cx1 < 0 ? size_x - 1 : static_cast<unsigned>(cx1);
+	if (!size_x || last < cx0) return nullptr;
+	buf.resize(last - cx0 + 1);
+
+	// Copy the row in blocks, one per tile:
+	const tile_ptr_t* tiles_row = &m_tiles[(cy >> TILE_SIZE_LOG2) * m_tiles_x];
+	const unsigned offset_y = (cy & (TILE_SIZE - 1)) << TILE_SIZE_LOG2;
+	for (unsigned cx = cx0; cx <= last;)
+	{
+		const unsigned tx = cx >> TILE_SIZE_LOG2;
+		const unsigned n =
+			std::min(last + 1, (tx + 1) << TILE_SIZE_LOG2) - cx;
+		const tile_ptr_t& tile = tiles_row[tx];
+		cellType* dst = &buf[cx - cx0];
+		if (!tile)
+			std::fill(dst, dst + n, m_tiles_default);
+		else
+			std::memcpy(
+				dst, &(*tile)[(cx & (TILE_SIZE - 1)) + offset_y],
+				n * sizeof(cellType));
+		cx += n;
+	}
+	return &buf[0];
+}
+
+const COccupancyGridMap2D::cellType* COccupancyGridMap2D::internal_getRowTiled(
+	unsigned cy) const
+{
+	static thread_local std::vector<cellType> rowBuf;
+	return getRowData(cy, rowBuf);
+}
+
+void COccupancyGridMap2D::setRowData(unsigned cy, const cellType* row)
+{
+	m_likelihoodDT_ToBeUpdated = true;
+	m_simulDF.toBeUpdated = true;
+	for (unsigned cx = 0; cx < size_x; cx += TILE_SIZE)
+		markCellModified(cx, cy);
+	if (!m_tiled)
+	{
+		std::memcpy(&map[cy * size_x], row, size_x * sizeof(cellType));
+		return;
+	}
+
+	tile_ptr_t* tiles_row = &m_tiles[(cy >> TILE_SIZE_LOG2) * m_tiles_x];
+	const unsigned offset_y = (cy & (TILE_SIZE - 1)) << TILE_SIZE_LOG2;
+	for (unsigned cx = 0; cx < size_x;)
+	{
+		const unsigned tx = cx >> TILE_SIZE_LOG2;
+		const unsigned n =
+			std::min<unsigned>(size_x, (tx + 1) << TILE_SIZE_LOG2) - cx;
+		// Keep unallocated the tiles which would remain all default:
+		const cellType def = m_tiles_default;
+		if (!tiles_row[tx] &&
+			std::all_of(
+				row + cx, row + cx + n, [def](cellType c) { return c == def; }))
+		{
+			cx += n;
+			continue;
+		}
+		std::vector<cellType>& tile = mutableTile(tiles_row[tx]);
+		std::memcpy(
+			&tile[(cx & (TILE_SIZE - 1)) + offset_y], row + cx,
+			n * sizeof(cellType));
+		cx += n;
+	}
+}
+
+void COccupancyGridMap2D::internal_resizeTiles(
+	unsigned int extra_x, unsigned int extra_y, unsigned int new_size_x,
+	unsigned int new_size_y, cellType new_cells_value)
+{
+	assert(0 == (extra_x & (TILE_SIZE - 1)));
+	assert(0 == (extra_y & (TILE_SIZE - 1)));
+
+	const unsigned int old_size_x = size_x, old_size_y = size_y;
+	const unsigned int new_tiles_x =
+		(new_size_x + TILE_SIZE - 1) >> TILE_SIZE_LOG2;
+	const unsigned int new_tiles_y =
+		(new_size_y + TILE_SIZE - 1) >> TILE_SIZE_LOG2;
+	const unsigned int tx0 = extra_x >> TILE_SIZE_LOG2;
+	const unsigned int ty0 = extra_y >> TILE_SIZE_LOG2;
+
+	// Only the directory changes: tiles are moved, not copied.
+	std::vector<tile_ptr_t> new_tiles(new_tiles_x * new_tiles_y);
+	for (unsigned int ty = 0; ty < m_tiles_y; ty++)
+		for (unsigned int tx = 0; tx < m_tiles_x; tx++)
+			new_tiles[(tx + tx0) + (ty + ty0) * new_tiles_x].swap(
+				m_tiles[tx + ty * m_tiles_x]);
+	m_tiles.swap(new_tiles);
+	m_tiles_x = new_tiles_x;
+	m_tiles_y = new_tiles_y;
+	size_x = new_size_x;
+	size_y = new_size_y;
+
+	// New cells already have the default value of unallocated tiles, so
+	// they only need to be written if a different value was requested:
+	if (new_cells_value == m_tiles_default) return;
+	for (unsigned int cy = 0; cy < size_y; cy++)
+	{
+		const bool old_row = cy >= extra_y && cy < extra_y + old_size_y;
+		for (unsigned int cx = 0; cx < size_x; cx++)
+		{
+			if (old_row && cx >= extra_x && cx < extra_x + old_size_x)
+				continue;
+			*cellPtr(cx, cy) = new_cells_value;
+		}
+	}
+}
+
 /*---------------------------------------------------------------
   Computes the entropy and related values of this grid map.
 	out_H The target variable for absolute entropy, computed
@@ -407,16 +656,20 @@ void COccupancyGridMap2D::computeEntropy(TEntropyInfo& info) const
 
 	info.H = info.I = 0;
 	info.effectiveMappedCells = 0;
-	for (std::vector<cellType>::const_iterator it = map.begin();
-		 it != map.end(); ++it)
+	std::vector<cellType> rowBuf;
+	for (unsigned int cy = 0; cy < size_y; cy++)
 	{
-		cellTypeUnsigned i = static_cast<cellTypeUnsigned>(*it);
-		h = entropyTable[i];
-		info.H += h;
-		if (h < (MAX_H - 0.001f))
+		const cellType* row = getRowData(cy, rowBuf);
+		for (unsigned int cx = 0; cx < size_x; cx++)
 		{
-			info.effectiveMappedCells++;
-			info.I -= h;
+			cellTypeUnsigned i = static_cast<cellTypeUnsigned>(row[cx]);
+			h = entropyTable[i];
+			info.H += h;
+			if (h < (MAX_H - 0.001f))
+			{
+				info.effectiveMappedCells++;
+				info.I -= h;
+			}
 		}
 	}
 
@@ -460,6 +713,8 @@ void COccupancyGridMap2D::internal_clear()
 	// resetFeaturesCache();
 	// For the precomputed likelihood trick:
 	precomputedLikelihoodToBeRecomputed = true;
+	m_likelihoodDT_ToBeUpdated = true;
+	m_simulDF.toBeUpdated = true;
 }
 
 /*---------------------------------------------------------------
@@ -470,8 +725,17 @@ void COccupancyGridMap2D::fill(float default_value)
 	cellType defValue = p2l(default_value);
 	for (std::vector<cellType>::iterator it = map.begin(); it < map.end(); ++it)
 		*it = defValue;
+	if (m_tiled)
+	{
+		// Release all tiles:
+		m_tiles.assign(m_tiles.size(), tile_ptr_t());
+		m_tiles_default = defValue;
+	}
 	// For the precomputed likelihood trick:
 	precomputedLikelihoodToBeRecomputed = true;
+	m_likelihoodDT_ToBeUpdated = true;
+	m_likelihoodDT.clear();  // All cells changed: rebuild it from scratch
+	m_simulDF.toBeUpdated = true;
 	// resetFeaturesCache();
 }
 
@@ -486,7 +750,9 @@ void COccupancyGridMap2D::updateCell(int x, int y, float v)
 		return;
 
 	// Get the current contents of the cell:
-	cellType& theCell = map[x + y * size_x];
+	cellType& theCell = *cellPtr(x, y);
+	m_likelihoodDT_ToBeUpdated = true;
+	m_simulDF.toBeUpdated = true;
 
 	// Compute the new Bayesian-fused value of the cell:
 	if (updateInfoChangeOnly.enabled)
@@ -550,7 +816,11 @@ void COccupancyGridMap2D::subSample(int downRatio)
 	}
 
 	setSize(x_min, x_max, y_min, y_max, resolution);
-	map = newMap;
+	if (!m_tiled)
+		map = newMap;
+	else
+		for (unsigned int cy = 0; cy < size_y; cy++)
+			setRowData(cy, &newMap[cy * size_x]);
 }
 
 /*---------------------------------------------------------------
@@ -676,7 +946,7 @@ void COccupancyGridMap2D::determineMatching2D(
 			for (int cy = cy_min; cy <= cy_max; cy++)
 			{
 				// Is an occupied cell?
-				if (map[cx + cy * size_x] <
+				if (cellValue(cx, cy) <
 					thresholdCellValue)  //  getCell(cx,cy)<0.49)
 				{
 					const float residual_x = idx2x(cx) - x_local;
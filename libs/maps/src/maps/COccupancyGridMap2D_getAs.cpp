@@ -34,10 +34,11 @@ void COccupancyGridMap2D::getAsImage(
 		if (!forceRGB)
 		{  // 8bit gray-scale
 			img.resize(size_x, size_y, 1, true);  // verticalFlip);
-			const cellType* srcPtr = &map[0];
+			std::vector<cellType> rowBuf;
 			unsigned char* destPtr;
 			for (unsigned int y = 0; y < size_y; y++)
 			{
+				const cellType* srcPtr = getRowData(y, rowBuf);
 				if (!verticalFlip)
 					destPtr = img(0, size_y - 1 - y);
 				else
@@ -51,10 +52,11 @@ void COccupancyGridMap2D::getAsImage(
 		else
 		{  // 24bit RGB:
 			img.resize(size_x, size_y, 3, true);  // verticalFlip);
-			const cellType* srcPtr = &map[0];
+			std::vector<cellType> rowBuf;
 			unsigned char* destPtr;
 			for (unsigned int y = 0; y < size_y; y++)
 			{
+				const cellType* srcPtr = getRowData(y, rowBuf);
 				if (!verticalFlip)
 					destPtr = img(0, size_y - 1 - y);
 				else
@@ -75,10 +77,11 @@ void COccupancyGridMap2D::getAsImage(
 		if (!forceRGB)
 		{  // 8bit gray-scale
 			img.resize(size_x, size_y, 1, true);  // verticalFlip);
-			const cellType* srcPtr = &map[0];
+			std::vector<cellType> rowBuf;
 			unsigned char* destPtr;
 			for (unsigned int y = 0; y < size_y; y++)
 			{
+				const cellType* srcPtr = getRowData(y, rowBuf);
 				if (!verticalFlip)
 					destPtr = img(0, size_y - 1 - y);
 				else
@@ -99,10 +102,11 @@ void COccupancyGridMap2D::getAsImage(
 		else
 		{  // 24bit RGB:
 			img.resize(size_x, size_y, 3, true);  // verticalFlip);
-			const cellType* srcPtr = &map[0];
+			std::vector<cellType> rowBuf;
 			unsigned char* destPtr;
 			for (unsigned int y = 0; y < size_y; y++)
 			{
+				const cellType* srcPtr = getRowData(y, rowBuf);
 				if (!verticalFlip)
 					destPtr = img(0, size_y - 1 - y);
 				else
@@ -171,10 +175,10 @@ void COccupancyGridMap2D::getAs3DObject(
 	CImage imgColor(size_x, size_y, 1);
 	CImage imgTrans(size_x, size_y, 1);
 
-	const cellType* srcPtr = &map[0];
-
+	std::vector<cellType> rowBuf;
 	for (unsigned int y = 0; y < size_y; y++)
 	{
+		const cellType* srcPtr = getRowData(y, rowBuf);
 		unsigned char* destPtr_color = imgColor(0, y);
 		unsigned char* destPtr_trans = imgTrans(0, y);
 		for (unsigned int x = 0; x < size_x; x++)
@@ -12,7 +12,9 @@
 #include <mrpt/maps/COccupancyGridMap2D.h>
 #include <mrpt/obs/CObservation2DRangeScan.h>
 #include <mrpt/obs/CObservationRange.h>
+#include <mrpt/maps/CMetricMapEvents.h>
 #include <mrpt/utils/CStream.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
 #include <mrpt/utils/round.h>  // round()
 
 #if HAVE_ALLOCA_H
@@ -34,6 +36,234 @@ struct TLocalPoint
 	int cx, cy;
 };
 
+#define FRBITS 9
+
+namespace
+{
+/** The geometry of the grid a scan is ray-cast against. Batch insertion keeps
+ * the one each scan saw, since the grid may grow later on. */
+struct TRayCastGrid
+{
+	TRayCastGrid() : x_min(0), y_min(0), resolution(1), size_x(0), size_y(0) {}
+	explicit TRayCastGrid(const COccupancyGridMap2D& g)
+		: x_min(g.getXMin()),
+		  y_min(g.getYMin()),
+		  resolution(g.getResolution()),
+		  size_x(g.getSizeX()),
+		  size_y(g.getSizeY())
+	{
+	}
+	float x_min, y_min, resolution;
+	unsigned int size_x, size_y;
+
+	int x2idx(float x) const
+	{
+		return static_cast<int>((x - x_min) / resolution);
+	}
+	int y2idx(float y) const
+	{
+		return static_cast<int>((y - y_min) / resolution);
+	}
+};
+
+/** Computes the end point of each ray of a 2D scan inserted as simple rays
+ * (only rays 0, K, 2K,... are filled in), and updates the given bounding box
+ * with them. */
+void computeScanRayEnds(
+	const CObservation2DRangeScan& o, const CPose2D& laserPose,
+	bool sensorIsBottomwards,
+	const COccupancyGridMap2D::TInsertionOptions& opts, int K,
+	float* scanPoints_x, float* scanPoints_y, float& new_x_min,
+	float& new_x_max, float& new_y_min, float& new_y_max)
+{
+	const float maxDistanceInsertion = opts.maxDistanceInsertion;
+	const bool invalidAsFree = opts.considerInvalidRangesAsFreeSpace;
+	const size_t nRanges = o.scan.size();
+	const int N = nRanges;
+	const float px = laserPose.x(), py = laserPose.y();
+	float last_valid_range = maxDistanceInsertion;
+	double A, dAK;
+
+	if (o.rightToLeft ^ sensorIsBottomwards)
+	{
+		A = laserPose.phi() - 0.5 * o.aperture;
+		dAK = K * o.aperture / N;
+	}
+	else
+	{
+		A = laserPose.phi() + 0.5 * o.aperture;
+		dAK = -K * o.aperture / N;
+	}
+
+	new_x_max = -(numeric_limits<float>::max)();
+	new_x_min = (numeric_limits<float>::max)();
+	new_y_max = -(numeric_limits<float>::max)();
+	new_y_min = (numeric_limits<float>::max)();
+
+	for (size_t idx = 0; idx < nRanges; idx += K)
+	{
+		float& scanPoint_x = scanPoints_x[idx];
+		float& scanPoint_y = scanPoints_y[idx];
+		if (o.validRange[idx])
+		{
+			const float curRange = o.scan[idx];
+			float R = min(maxDistanceInsertion, curRange);
+
+			scanPoint_x = px + cos(A) * R;
+			scanPoint_y = py + sin(A) * R;
+			last_valid_range = curRange;
+		}
+		else
+		{
+			if (invalidAsFree)
+			{
+				// Invalid range:
+				float R = min(maxDistanceInsertion, 0.5f * last_valid_range);
+				scanPoint_x = px + cos(A) * R;
+				scanPoint_y = py + sin(A) * R;
+			}
+			else
+			{
+				scanPoint_x = px;
+				scanPoint_y = py;
+			}
+		}
+		A += dAK;
+
+		// Asjust size (will not change if not required):
+		new_x_max = max(new_x_max, scanPoint_x);
+		new_x_min = min(new_x_min, scanPoint_x);
+		new_y_max = max(new_y_max, scanPoint_y);
+		new_y_min = min(new_y_min, scanPoint_y);
+	}
+}
+
+/** Grows the grid, if needed, to fit the given bounding box of a scan plus
+ * some margin. */
+void resizeGridForScan(
+	COccupancyGridMap2D& grid, float new_x_min, float new_x_max,
+	float new_y_min, float new_y_max)
+{
+	// Add an extra margin:
+	float securMargen = 15 * grid.getResolution();
+
+	if (new_x_max > grid.getXMax() - securMargen)
+		new_x_max += 2 * securMargen;
+	else
+		new_x_max = grid.getXMax();
+	if (new_x_min < grid.getXMin() + securMargen)
+		new_x_min -= 2;
+	else
+		new_x_min = grid.getXMin();
+
+	if (new_y_max > grid.getYMax() - securMargen)
+		new_y_max += 2 * securMargen;
+	else
+		new_y_max = grid.getYMax();
+	if (new_y_min < grid.getYMin() + securMargen)
+		new_y_min -= 2;
+	else
+		new_y_min = grid.getYMin();
+
+	grid.resizeGrid(new_x_min, new_x_max, new_y_min, new_y_max, 0.5);
+}
+
+/** Traces the rays of a 2D scan from the sensor cell (cx0,cy0) to the end
+ * points computed by computeScanRayEnds(), calling `onFree(cx,cy)` for each
+ * cell along each ray and then `onOccupied(cx,cy)` for its end cell, if it
+ * was a valid, not truncated, range. */
+template <class FREE_FUNCTOR, class OCCUPIED_FUNCTOR>
+void castScanRays(
+	const CObservation2DRangeScan& o,
+	const COccupancyGridMap2D::TInsertionOptions& opts, int K, int cx0,
+	int cy0, const float* scanPoints_x, const float* scanPoints_y,
+	const TRayCastGrid& grid, FREE_FUNCTOR&& onFree,
+	OCCUPIED_FUNCTOR&& onOccupied)
+{
+	const float maxDistanceInsertion = opts.maxDistanceInsertion;
+	const bool invalidAsFree = opts.considerInvalidRangesAsFreeSpace;
+	const size_t nRanges = o.scan.size();
+
+	for (size_t idx = 0; idx < nRanges; idx += K)
+	{
+		if (!o.validRange[idx] && !invalidAsFree) continue;
+
+		// Starting position: Laser position
+		int cx = cx0;
+		int cy = cy0;
+
+		// Target, in cell indexes:
+		int trg_cx = grid.x2idx(scanPoints_x[idx]);
+		int trg_cy = grid.y2idx(scanPoints_y[idx]);
+
+		// The x> comparison implicitly holds if x<0
+		ASSERT_(
+			static_cast<unsigned int>(trg_cx) < grid.size_x &&
+			static_cast<unsigned int>(trg_cy) < grid.size_y);
+
+		// Use "fractional integers" to approximate float operations
+		//  during the ray tracing:
+		int Acx = trg_cx - cx;
+		int Acy = trg_cy - cy;
+
+		int Acx_ = abs(Acx);
+		int Acy_ = abs(Acy);
+
+		int nStepsRay = max(Acx_, Acy_);
+		if (!nStepsRay) continue;  // May be...
+
+		// Integers store "float values * 128"
+		float N_1 = 1.0f / nStepsRay;  // Avoid division twice.
+
+		// Increments at each raytracing step:
+		int frAcx = (Acx < 0 ? -1 : +1) * round((Acx_ << FRBITS) * N_1);
+		int frAcy = (Acy < 0 ? -1 : +1) * round((Acy_ << FRBITS) * N_1);
+
+		int frCX = cx << FRBITS;
+		int frCY = cy << FRBITS;
+
+		for (int nStep = 0; nStep < nStepsRay; nStep++)
+		{
+			onFree(cx, cy);
+
+			frCX += frAcx;
+			frCY += frAcy;
+
+			cx = frCX >> FRBITS;
+			cy = frCY >> FRBITS;
+		}
+
+		// And finally, the occupied cell at the end:
+		// Only if:
+		//  - It was a valid ray, and
+		//  - The ray was not truncated
+		if (o.validRange[idx] && o.scan[idx] < maxDistanceInsertion)
+			onOccupied(trg_cx, trg_cy);
+
+	}  // End of each range
+}
+
+/** A 2D scan being inserted by COccupancyGridMap2D::insertObservationsBatch()
+ */
+struct TBatchScan
+{
+	const CObservation2DRangeScan* obs;
+	CPose3D robotPose;
+	CPose2D laserPose;
+	bool sensorIsBottomwards;
+	/** Ray end points, and their bounding box */
+	std::vector<float> xs, ys;
+	float new_x_min, new_x_max, new_y_min, new_y_max;
+	/** The grid as seen by this scan in serial insertion */
+	TRayCastGrid grid;
+	int cx0, cy0;
+	/** Cells the grid grew, at its left/bottom sides, after this scan */
+	unsigned int off_x, off_y;
+	/** Linear indices of the cells to update, grouped by bands of rows */
+	std::vector<std::vector<uint32_t>> updates;
+};
+}  // namespace
+
 /*---------------------------------------------------------------
 					insertObservation
 
@@ -44,8 +274,6 @@ bool COccupancyGridMap2D::internal_insertObservation(
 {
 // 	MRPT_START   // Avoid "try" since we use "alloca"
 
-#define FRBITS 9
-
 	CPose2D robotPose2D;
 	CPose3D robotPose3D;
 
@@ -53,6 +281,8 @@ bool COccupancyGridMap2D::internal_insertObservation(
 	// resetFeaturesCache();
 	// For the precomputed likelihood trick:
 	precomputedLikelihoodToBeRecomputed = true;
+	m_likelihoodDT_ToBeUpdated = true;
+	m_simulDF.toBeUpdated = true;
 
 	if (robotPose)
 	{
@@ -100,7 +330,7 @@ bool COccupancyGridMap2D::internal_insertObservation(
 			// ---------------------------------------------
 			//		Insert the scan as simple rays:
 			// ---------------------------------------------
-			int cx, cy, N = o->scan.size();
+			int N = o->scan.size();
 			float px, py;
 			double A, dAK;
 
@@ -154,161 +384,31 @@ bool COccupancyGridMap2D::internal_insertObservation(
 				float* scanPoints_y =
 					(float*)mrpt_alloca(sizeof(float) * nRanges);
 
-				float *scanPoint_x, *scanPoint_y;
-
-				if (o->rightToLeft ^ sensorIsBottomwards)
-				{
-					A = laserPose.phi() - 0.5 * o->aperture;
-					dAK = K * o->aperture / N;
-				}
-				else
-				{
-					A = laserPose.phi() + 0.5 * o->aperture;
-					dAK = -K * o->aperture / N;
-				}
-
-				new_x_max = -(numeric_limits<float>::max)();
-				new_x_min = (numeric_limits<float>::max)();
-				new_y_max = -(numeric_limits<float>::max)();
-				new_y_min = (numeric_limits<float>::max)();
-
-				for (idx = 0, scanPoint_x = scanPoints_x,
-					scanPoint_y = scanPoints_y;
-					 idx < nRanges; idx += K, scanPoint_x++, scanPoint_y++)
-				{
-					if (o->validRange[idx])
-					{
-						curRange = o->scan[idx];
-						float R = min(maxDistanceInsertion, curRange);
-
-						*scanPoint_x = px + cos(A) * R;
-						*scanPoint_y = py + sin(A) * R;
-						last_valid_range = curRange;
-					}
-					else
-					{
-						if (invalidAsFree)
-						{
-							// Invalid range:
-							float R = min(
-								maxDistanceInsertion, 0.5f * last_valid_range);
-							*scanPoint_x = px + cos(A) * R;
-							*scanPoint_y = py + sin(A) * R;
-						}
-						else
-						{
-							*scanPoint_x = px;
-							*scanPoint_y = py;
-						}
-					}
-					A += dAK;
-
-					// Asjust size (will not change if not required):
-					new_x_max = max(new_x_max, *scanPoint_x);
-					new_x_min = min(new_x_min, *scanPoint_x);
-					new_y_max = max(new_y_max, *scanPoint_y);
-					new_y_min = min(new_y_min, *scanPoint_y);
-				}
-
-				// Add an extra margin:
-				float securMargen = 15 * resolution;
-
-				if (new_x_max > x_max - securMargen)
-					new_x_max += 2 * securMargen;
-				else
-					new_x_max = x_max;
-				if (new_x_min < x_min + securMargen)
-					new_x_min -= 2;
-				else
-					new_x_min = x_min;
-
-				if (new_y_max > y_max - securMargen)
-					new_y_max += 2 * securMargen;
-				else
-					new_y_max = y_max;
-				if (new_y_min < y_min + securMargen)
-					new_y_min -= 2;
-				else
-					new_y_min = y_min;
+				computeScanRayEnds(
+					*o, laserPose, sensorIsBottomwards, insertionOptions, K,
+					scanPoints_x, scanPoints_y, new_x_min, new_x_max,
+					new_y_min, new_y_max);
 
 				// -----------------------
 				//   Resize to make room:
 				// -----------------------
-				resizeGrid(new_x_min, new_x_max, new_y_min, new_y_max, 0.5);
-
-				// For updateCell_fast methods:
-				cellType* theMapArray = &map[0];
-				unsigned theMapSize_x = size_x;
-
-				int cx0 =
-					x2idx(px);  // Remember: This must be after the resizeGrid!!
-				int cy0 = y2idx(py);
+				resizeGridForScan(
+					*this, new_x_min, new_x_max, new_y_min, new_y_max);
 
 				// Insert rays:
-				for (idx = 0; idx < nRanges; idx += K)
-				{
-					if (!o->validRange[idx] && !invalidAsFree) continue;
-
-					// Starting position: Laser position
-					cx = cx0;
-					cy = cy0;
-
-					// Target, in cell indexes:
-					int trg_cx = x2idx(scanPoints_x[idx]);
-					int trg_cy = y2idx(scanPoints_y[idx]);
-
-					// The x> comparison implicitly holds if x<0
-					ASSERT_(
-						static_cast<unsigned int>(trg_cx) < size_x &&
-						static_cast<unsigned int>(trg_cy) < size_y);
-
-					// Use "fractional integers" to approximate float operations
-					//  during the ray tracing:
-					int Acx = trg_cx - cx;
-					int Acy = trg_cy - cy;
-
-					int Acx_ = abs(Acx);
-					int Acy_ = abs(Acy);
-
-					int nStepsRay = max(Acx_, Acy_);
-					if (!nStepsRay) continue;  // May be...
-
-					// Integers store "float values * 128"
-					float N_1 = 1.0f / nStepsRay;  // Avoid division twice.
-
-					// Increments at each raytracing step:
-					int frAcx =
-						(Acx < 0 ? -1 : +1) * round((Acx_ << FRBITS) * N_1);
-					int frAcy =
-						(Acy < 0 ? -1 : +1) * round((Acy_ << FRBITS) * N_1);
-
-					int frCX = cx << FRBITS;
-					int frCY = cy << FRBITS;
-
-					for (int nStep = 0; nStep < nStepsRay; nStep++)
-					{
+				castScanRays(
+					*o, insertionOptions, K, x2idx(px), y2idx(py),
+					scanPoints_x, scanPoints_y, TRayCastGrid(*this),
+					[&](int cx, int cy) {
 						updateCell_fast_free(
-							cx, cy, logodd_observation, logodd_thres_free,
-							theMapArray, theMapSize_x);
-
-						frCX += frAcx;
-						frCY += frAcy;
-
-						cx = frCX >> FRBITS;
-						cy = frCY >> FRBITS;
-					}
-
-					// And finally, the occupied cell at the end:
-					// Only if:
-					//  - It was a valid ray, and
-					//  - The ray was not truncated
-					if (o->validRange[idx] &&
-						o->scan[idx] < maxDistanceInsertion)
+							cellPtr(cx, cy), logodd_observation,
+							logodd_thres_free);
+					},
+					[&](int cx, int cy) {
 						updateCell_fast_occupied(
-							trg_cx, trg_cy, logodd_observation_occupied,
-							logodd_thres_occupied, theMapArray, theMapSize_x);
-
-				}  // End of each range
+							cellPtr(cx, cy), logodd_observation_occupied,
+							logodd_thres_occupied);
+					});
 
 				mrpt_alloca_free(scanPoints_x);
 				mrpt_alloca_free(scanPoints_y);
@@ -400,10 +500,6 @@ bool COccupancyGridMap2D::internal_insertObservation(
 				// -----------------------
 				resizeGrid(new_x_min, new_x_max, new_y_min, new_y_max, 0.5);
 
-				// For updateCell_fast methods:
-				cellType* theMapArray = &map[0];
-				unsigned theMapSize_x = size_x;
-
 				// int  cx0 = x2idx(px);		// Remember: This must be after
 				// the
 				// resizeGrid!!
@@ -510,8 +606,8 @@ bool COccupancyGridMap2D::internal_insertObservation(
 
 						for (int ccx = min_cx; ccx <= max_cx; ccx++)
 							updateCell_fast_free(
-								ccx, P0.cy, logodd_observation,
-								logodd_thres_free, theMapArray, theMapSize_x);
+								cellPtr(ccx, P0.cy), logodd_observation,
+								logodd_thres_free);
 					}
 					else
 					{
@@ -594,9 +690,8 @@ bool COccupancyGridMap2D::internal_insertObservation(
 
 								for (int ccx = R1.cx; ccx <= R2.cx; ccx++)
 									updateCell_fast_free(
-										ccx, R1.cy, logodd_observation,
-										logodd_thres_free, theMapArray,
-										theMapSize_x);
+										cellPtr(ccx, R1.cy), logodd_observation,
+										logodd_thres_free);
 							}
 
 							R1.frX += frAx_R1;
@@ -680,9 +775,8 @@ bool COccupancyGridMap2D::internal_insertObservation(
 								last_insert_cy = R1.cy;
 								for (int ccx = R1.cx; ccx <= R2.cx; ccx++)
 									updateCell_fast_free(
-										ccx, R1.cy, logodd_observation,
-										logodd_thres_free, theMapArray,
-										theMapSize_x);
+										cellPtr(ccx, R1.cy), logodd_observation,
+										logodd_thres_free);
 							}
 
 							R1.frX += frAx_R1;
@@ -732,9 +826,9 @@ bool COccupancyGridMap2D::internal_insertObservation(
 						if (P2.cx == P1.cx && P2.cy == P1.cy)
 						{
 							updateCell_fast_occupied(
-								P1.cx, P1.cy, logodd_observation_occupied,
-								logodd_thres_occupied, theMapArray,
-								theMapSize_x);
+								cellPtr(P1.cx, P1.cy),
+								logodd_observation_occupied,
+								logodd_thres_occupied);
 						}
 						else
 						{
@@ -761,9 +855,9 @@ bool COccupancyGridMap2D::internal_insertObservation(
 							for (int nStep = 0; nStep <= nSteps; nStep++)
 							{
 								updateCell_fast_occupied(
-									R1.cx, R1.cy, logodd_observation_occupied,
-									logodd_thres_occupied, theMapArray,
-									theMapSize_x);
+									cellPtr(R1.cx, R1.cy),
+									logodd_observation_occupied,
+									logodd_thres_occupied);
 
 								R1.frX += frAcxE;
 								R1.frY += frAcyE;
@@ -930,10 +1024,6 @@ bool COccupancyGridMap2D::internal_insertObservation(
 			// -----------------------
 			resizeGrid(new_x_min, new_x_max, new_y_min, new_y_max, 0.5);
 
-			// For updateCell_fast methods:
-			cellType* theMapArray = &map[0];
-			unsigned theMapSize_x = size_x;
-
 			// int  cx0 = x2idx(px);		// Remember: This must be after the
 			// resizeGrid!!
 			// int  cy0 = y2idx(py);
@@ -1029,8 +1119,8 @@ bool COccupancyGridMap2D::internal_insertObservation(
 
 					for (int ccx = min_cx; ccx <= max_cx; ccx++)
 						updateCell_fast_free(
-							ccx, P0.cy, logodd_observation, logodd_thres_free,
-							theMapArray, theMapSize_x);
+							cellPtr(ccx, P0.cy), logodd_observation,
+							logodd_thres_free);
 				}
 				else
 				{
@@ -1112,9 +1202,8 @@ bool COccupancyGridMap2D::internal_insertObservation(
 
 							for (int ccx = R1.cx; ccx <= R2.cx; ccx++)
 								updateCell_fast_free(
-									ccx, R1.cy, logodd_observation,
-									logodd_thres_free, theMapArray,
-									theMapSize_x);
+									cellPtr(ccx, R1.cy), logodd_observation,
+									logodd_thres_free);
 						}
 
 						R1.frX += frAx_R1;
@@ -1197,9 +1286,8 @@ bool COccupancyGridMap2D::internal_insertObservation(
 							last_insert_cy = R1.cy;
 							for (int ccx = R1.cx; ccx <= R2.cx; ccx++)
 								updateCell_fast_free(
-									ccx, R1.cy, logodd_observation,
-									logodd_thres_free, theMapArray,
-									theMapSize_x);
+									cellPtr(ccx, R1.cy), logodd_observation,
+									logodd_thres_free);
 						}
 
 						R1.frX += frAx_R1;
@@ -1248,8 +1336,8 @@ bool COccupancyGridMap2D::internal_insertObservation(
 					if (P2.cx == P1.cx && P2.cy == P1.cy)
 					{
 						updateCell_fast_occupied(
-							P1.cx, P1.cy, logodd_observation_occupied,
-							logodd_thres_occupied, theMapArray, theMapSize_x);
+							cellPtr(P1.cx, P1.cy), logodd_observation_occupied,
+							logodd_thres_occupied);
 					}
 					else
 					{
@@ -1276,9 +1364,9 @@ bool COccupancyGridMap2D::internal_insertObservation(
 						for (int nStep = 0; nStep <= nSteps; nStep++)
 						{
 							updateCell_fast_occupied(
-								R1.cx, R1.cy, logodd_observation_occupied,
-								logodd_thres_occupied, theMapArray,
-								theMapSize_x);
+								cellPtr(R1.cx, R1.cy),
+								logodd_observation_occupied,
+								logodd_thres_occupied);
 
 							R1.frX += frAcxE;
 							R1.frY += frAcyE;
@@ -1308,6 +1396,193 @@ bool COccupancyGridMap2D::internal_insertObservation(
 	//	MRPT_END
 }
 
+/*---------------------------------------------------------------
+					insertObservationsBatch
+ ---------------------------------------------------------------*/
+size_t COccupancyGridMap2D::insertObservationsBatch(
+	const std::vector<const CObservation*>& obs,
+	const std::vector<mrpt::math::TPose3D>& robotPoses,
+	CWorkerThreadsPool* threadPool)
+{
+	MRPT_START
+
+	ASSERT_EQUAL_(obs.size(), robotPoses.size());
+	if (!genericMapParams.enableObservationInsertion) return 0;
+
+	// Max. number of scans whose cell updates are kept in memory at once:
+	const size_t BLOCK_SIZE = 128;
+	// Flag for updates of occupied cells, in TBatchScan::updates:
+	const uint32_t OCCUPIED_FLAG = 0x80000000;
+
+	const int K = updateInfoChangeOnly.enabled
+					  ? updateInfoChangeOnly.laserRaysSkip
+					  : insertionOptions.decimation;
+
+	cellType logodd_observation =
+		p2l(insertionOptions.maxOccupancyUpdateCertainty);
+	cellType logodd_observation_occupied = 3 * logodd_observation;
+	// Assure minimum change in cells!
+	if (logodd_observation <= 0) logodd_observation = 1;
+	const cellType logodd_thres_occupied =
+		OCCGRID_CELLTYPE_MIN + logodd_observation_occupied;
+	const cellType logodd_thres_free =
+		OCCGRID_CELLTYPE_MAX - logodd_observation;
+
+	std::vector<TBatchScan> scans;
+	size_t nInserted = 0;
+	for (size_t i = 0; i < obs.size();)
+	{
+		// Gather the next block of scans to be inserted as simple rays:
+		scans.clear();
+		for (; i < obs.size() && scans.size() < BLOCK_SIZE; i++)
+		{
+			if (insertionOptions.wideningBeamsWithDistance ||
+				CLASS_ID(CObservation2DRangeScan) != obs[i]->GetRuntimeClass())
+				break;
+			const CObservation2DRangeScan* o =
+				static_cast<const CObservation2DRangeScan*>(obs[i]);
+			const CPose3D robotPose(robotPoses[i]);
+			const CPose3D sensorPose3D = robotPose + o->sensorPose;
+			// Same checks than in internal_insertObservation():
+			if (!o->isPlanarScan(insertionOptions.horizontalTolerance) ||
+				(insertionOptions.useMapAltitude &&
+				 fabs(insertionOptions.mapAltitude - sensorPose3D.z()) >
+					 0.001))
+				break;
+
+			scans.resize(scans.size() + 1);
+			TBatchScan& s = scans.back();
+			s.obs = o;
+			s.robotPose = robotPose;
+			s.laserPose = CPose2D(sensorPose3D);
+			s.sensorIsBottomwards =
+				sensorPose3D.getHomogeneousMatrixVal().get_unsafe(2, 2) < 0;
+		}
+		if (scans.empty())
+		{
+			// Anything else is inserted as usual, keeping the order:
+			const CPose3D robotPose(robotPoses[i]);
+			if (insertObservation(obs[i], &robotPose)) nInserted++;
+			i++;
+			continue;
+		}
+
+		// For the precomputed likelihood trick:
+		precomputedLikelihoodToBeRecomputed = true;
+		m_likelihoodDT_ToBeUpdated = true;
+		m_simulDF.toBeUpdated = true;
+
+		// 1) Ray end points, which do not depend on the grid:
+		auto computeEnds = [&](size_t first, size_t last, size_t) {
+			for (size_t k = first; k < last; k++)
+			{
+				TBatchScan& s = scans[k];
+				s.xs.resize(s.obs->scan.size());
+				s.ys.resize(s.obs->scan.size());
+				computeScanRayEnds(
+					*s.obs, s.laserPose, s.sensorIsBottomwards,
+					insertionOptions, K, s.xs.data(), s.ys.data(),
+					s.new_x_min, s.new_x_max, s.new_y_min, s.new_y_max);
+			}
+		};
+		if (threadPool)
+			threadPool->parallelChunks(scans.size(), computeEnds);
+		else
+			computeEnds(0, scans.size(), 0);
+
+		// 2) Grow the grid scan by scan, exactly as serial insertion does,
+		// keeping the grid each scan would see:
+		std::vector<unsigned int> grow_x(scans.size()), grow_y(scans.size());
+		for (size_t k = 0; k < scans.size(); k++)
+		{
+			TBatchScan& s = scans[k];
+			const float old_x_min = x_min, old_y_min = y_min;
+			resizeGridForScan(
+				*this, s.new_x_min, s.new_x_max, s.new_y_min, s.new_y_max);
+			grow_x[k] = round((old_x_min - x_min) / resolution);
+			grow_y[k] = round((old_y_min - y_min) / resolution);
+			s.grid = TRayCastGrid(*this);
+			s.cx0 = s.grid.x2idx(static_cast<float>(s.laserPose.x()));
+			s.cy0 = s.grid.y2idx(static_cast<float>(s.laserPose.y()));
+		}
+		for (size_t k = scans.size(), off_x = 0, off_y = 0; k-- > 0;)
+		{
+			scans[k].off_x = off_x;
+			scans[k].off_y = off_y;
+			off_x += grow_x[k];
+			off_y += grow_y[k];
+		}
+		ASSERT_(size_t(size_x) * size_y < OCCUPIED_FLAG);
+
+		// Bands of rows are made of whole rows of tiles, so two threads never
+		// allocate the same tile with tiled storage:
+		const unsigned int nBands =
+			threadPool ? std::max<size_t>(1, threadPool->size()) : 1;
+		const unsigned int tileRows = (size_y + TILE_SIZE - 1) / TILE_SIZE;
+		const unsigned int rowsPerBand =
+			((tileRows + nBands - 1) / nBands) * TILE_SIZE;
+
+		// 3) Trace the rays, split by scans:
+		auto traceRays = [&](size_t first, size_t last, size_t) {
+			for (size_t k = first; k < last; k++)
+			{
+				TBatchScan& s = scans[k];
+				s.updates.assign(nBands, std::vector<uint32_t>());
+				const auto addUpdate = [&](int cx, int cy, uint32_t flag) {
+					cx += s.off_x;
+					cy += s.off_y;
+					s.updates[cy / rowsPerBand].push_back(
+						(cx + cy * size_x) | flag);
+				};
+				castScanRays(
+					*s.obs, insertionOptions, K, s.cx0, s.cy0, s.xs.data(),
+					s.ys.data(), s.grid,
+					[&](int cx, int cy) { addUpdate(cx, cy, 0); },
+					[&](int cx, int cy) { addUpdate(cx, cy, OCCUPIED_FLAG); });
+			}
+		};
+		if (threadPool)
+			threadPool->parallelChunks(scans.size(), traceRays);
+		else
+			traceRays(0, scans.size(), 0);
+
+		// 4) Apply the updates, split by bands of rows, each band in the same
+		// order than serial insertion:
+		auto applyUpdates = [&](size_t first, size_t last, size_t) {
+			for (size_t band = first; band < last; band++)
+				for (const TBatchScan& s : scans)
+					for (const uint32_t u : s.updates[band])
+					{
+						const uint32_t idx = u & ~OCCUPIED_FLAG;
+						// Bands are made of whole rows of blocks, so threads
+						// never mark the same flag in markCellModified():
+						cellType* cell = cellPtr(idx % size_x, idx / size_x);
+						if (u & OCCUPIED_FLAG)
+							updateCell_fast_occupied(
+								cell, logodd_observation_occupied,
+								logodd_thres_occupied);
+						else
+							updateCell_fast_free(
+								cell, logodd_observation, logodd_thres_free);
+					}
+		};
+		if (threadPool)
+			threadPool->parallelChunks(nBands, applyUpdates);
+		else
+			applyUpdates(0, nBands, 0);
+
+		for (const TBatchScan& s : scans)
+		{
+			OnPostSuccesfulInsertObs(s.obs);
+			publishEvent(mrptEventMetricMapInsert(this, s.obs, &s.robotPose));
+		}
+		nInserted += scans.size();
+	}
+	return nInserted;
+
+	MRPT_END
+}
+
 /*---------------------------------------------------------------
 	Initilization of values, don't needed to be called directly.
   ---------------------------------------------------------------*/
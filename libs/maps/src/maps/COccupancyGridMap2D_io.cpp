@@ -66,13 +66,29 @@ void COccupancyGridMap2D::writeToStream(
 
 		out << size_x << size_y << x_min << x_max << y_min << y_max
 			<< resolution;
-		ASSERT_(size_x * size_y == map.size());
-
+		if (!m_tiled)
+		{
+			ASSERT_(size_x * size_y == map.size());
+#ifdef OCCUPANCY_GRIDMAP_CELL_SIZE_8BITS
+			out.WriteBuffer(&map[0], sizeof(map[0]) * size_x * size_y);
+#else
+			out.WriteBufferFixEndianness(&map[0], size_x * size_y);
+#endif
+		}
+		else
+		{
+			// Tiled storage: write the same dense, row-major stream
+			std::vector<cellType> rowBuf;
+			for (unsigned int y = 0; y < size_y; y++)
+			{
+				const cellType* row = getRowData(y, rowBuf);
 #ifdef OCCUPANCY_GRIDMAP_CELL_SIZE_8BITS
-		out.WriteBuffer(&map[0], sizeof(map[0]) * size_x * size_y);
+				out.WriteBuffer(row, sizeof(cellType) * size_x);
 #else
-		out.WriteBufferFixEndianness(&map[0], size_x * size_y);
+				out.WriteBufferFixEndianness(row, size_x);
 #endif
+			}
+		}
 
 		// insertionOptions:
 		out << insertionOptions.mapAltitude << insertionOptions.useMapAltitude
@@ -155,15 +171,16 @@ void COccupancyGridMap2D::readFromStream(mrpt::utils::CStream& in, int version)
 				new_x_min, new_x_max, new_y_min, new_y_max, new_resolution,
 				0.5);
 
-			ASSERT_(size_x * size_y == map.size());
+			// Read into a dense buffer, then move it into the grid storage:
+			std::vector<cellType> cells(size_t(size_x) * size_y);
 
 			if (bitsPerCellStream == MyBitsPerCell)
 			{
 // Perfect:
 #ifdef OCCUPANCY_GRIDMAP_CELL_SIZE_8BITS
-				in.ReadBuffer(&map[0], sizeof(map[0]) * map.size());
+				in.ReadBuffer(&cells[0], sizeof(cells[0]) * cells.size());
 #else
-				in.ReadBufferFixEndianness(&map[0], map.size());
+				in.ReadBufferFixEndianness(&cells[0], cells.size());
 #endif
 			}
 			else
@@ -172,21 +189,21 @@ void COccupancyGridMap2D::readFromStream(mrpt::utils::CStream& in, int version)
 #ifdef OCCUPANCY_GRIDMAP_CELL_SIZE_8BITS
 				// We are 8-bit, stream is 16-bit
 				ASSERT_(bitsPerCellStream == 16);
-				std::vector<uint16_t> auxMap(map.size());
+				std::vector<uint16_t> auxMap(cells.size());
 				in.ReadBuffer(&auxMap[0], sizeof(auxMap[0]) * auxMap.size());
 
-				size_t i, N = map.size();
-				uint8_t* ptrTrg = (uint8_t*)&map[0];
+				size_t i, N = cells.size();
+				uint8_t* ptrTrg = (uint8_t*)&cells[0];
 				const uint16_t* ptrSrc = (const uint16_t*)&auxMap[0];
 				for (i = 0; i < N; i++) *ptrTrg++ = (*ptrSrc++) >> 8;
 #else
 				// We are 16-bit, stream is 8-bit
 				ASSERT_(bitsPerCellStream == 8);
-				std::vector<uint8_t> auxMap(map.size());
+				std::vector<uint8_t> auxMap(cells.size());
 				in.ReadBuffer(&auxMap[0], sizeof(auxMap[0]) * auxMap.size());
 
-				size_t i, N = map.size();
-				uint16_t* ptrTrg = (uint16_t*)&map[0];
+				size_t i, N = cells.size();
+				uint16_t* ptrTrg = (uint16_t*)&cells[0];
 				const uint8_t* ptrSrc = (const uint8_t*)&auxMap[0];
 				for (i = 0; i < N; i++) *ptrTrg++ = (*ptrSrc++) << 8;
 #endif
@@ -196,8 +213,8 @@ void COccupancyGridMap2D::readFromStream(mrpt::utils::CStream& in, int version)
 			// log-odds:
 			if (version < 3)
 			{
-				size_t i, N = map.size();
-				cellType* ptr = &map[0];
+				size_t i, N = cells.size();
+				cellType* ptr = &cells[0];
 				for (i = 0; i < N; i++)
 				{
 					double p = cellTypeUnsigned(*ptr) * (1.0f / 0xFF);
@@ -207,8 +224,16 @@ void COccupancyGridMap2D::readFromStream(mrpt::utils::CStream& in, int version)
 				}
 			}
 
+			if (!m_tiled)
+				map.swap(cells);
+			else
+				for (unsigned int y = 0; y < size_y; y++)
+					setRowData(y, &cells[size_t(y) * size_x]);
+
 			// For the precomputed likelihood trick:
 			precomputedLikelihoodToBeRecomputed = true;
+			m_likelihoodDT_ToBeUpdated = true;
+			m_simulDF.toBeUpdated = true;
 
 			if (version >= 1)
 			{
@@ -307,6 +332,8 @@ bool COccupancyGridMap2D::loadFromBitmap(
 
 	// For the precomputed likelihood trick:
 	precomputedLikelihoodToBeRecomputed = true;
+	m_likelihoodDT_ToBeUpdated = true;
+	m_simulDF.toBeUpdated = true;
 
 	size_t bmpWidth = imgFl.getWidth();
 	size_t bmpHeight = imgFl.getHeight();
@@ -14,6 +14,9 @@
 #include <mrpt/obs/CObservationRange.h>
 #include <mrpt/maps/CSimplePointsMap.h>
 #include <mrpt/utils/CStream.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
+#include <array>
+#include <limits>
 
 using namespace mrpt;
 using namespace mrpt::math;
@@ -69,6 +72,7 @@ double COccupancyGridMap2D::internal_computeObservationLikelihood(
 			return computeObservationLikelihood_CellsDifference(obs, takenFrom);
 
 		case lmLikelihoodField_Thrun:
+		case lmLikelihoodField_DistanceTransform:
 			return computeObservationLikelihood_likelihoodField_Thrun(
 				obs, takenFrom);
 
@@ -458,8 +462,12 @@ double COccupancyGridMap2D::computeObservationLikelihood_likelihoodField_Thrun(
 		opts.horizontalTolerance = insertionOptions.horizontalTolerance;
 
 		// Compute the likelihood of the points in this grid map:
-		ret = computeLikelihoodField_Thrun(
-			o->buildAuxPointsMap<mrpt::maps::CPointsMap>(&opts), &takenFrom);
+		const CPointsMap* pts =
+			o->buildAuxPointsMap<mrpt::maps::CPointsMap>(&opts);
+		ret = likelihoodOptions.likelihoodMethod ==
+					  lmLikelihoodField_DistanceTransform
+				  ? computeLikelihoodField_DistanceTransform(pts, &takenFrom)
+				  : computeLikelihoodField_Thrun(pts, &takenFrom);
 
 	}  // end of observation is a scan range 2D
 	else if (IS_CLASS(obs, CObservationRange))
@@ -474,7 +482,10 @@ double COccupancyGridMap2D::computeObservationLikelihood_likelihoodField_Thrun(
 		pts.insertObservation(o);
 
 		// Compute the likelihood of the points in this grid map:
-		ret = computeLikelihoodField_Thrun(&pts, &takenFrom);
+		ret = likelihoodOptions.likelihoodMethod ==
+					  lmLikelihoodField_DistanceTransform
+				  ? computeLikelihoodField_DistanceTransform(&pts, &takenFrom)
+				  : computeLikelihoodField_Thrun(&pts, &takenFrom);
 	}
 
 	return ret;
@@ -569,8 +580,9 @@ double COccupancyGridMap2D::computeLikelihoodField_Thrun(
 		// Reset the precomputed likelihood values map
 		if (precomputedLikelihoodToBeRecomputed)
 		{
-			if (!map.empty())
-				precomputedLikelihood.assign(map.size(), LIK_LF_CACHE_INVALID);
+			if (size_x && size_y)
+				precomputedLikelihood.assign(
+					size_t(size_x) * size_y, LIK_LF_CACHE_INVALID);
 			else
 				precomputedLikelihood.clear();
 
@@ -650,10 +662,6 @@ double COccupancyGridMap2D::computeLikelihoodField_Thrun(
 
 				// Optimized code: this part will be invoked a *lot* of times:
 				{
-					cellType* mapPtr =
-						&map[xx1 + yy1 * size_x];  // Initial pointer position
-					unsigned incrAfterRow = size_x - ((xx2 - xx1) + 1);
-
 					signed int Ax0 = 10 * (xx1 - cx);
 					signed int Ay = 10 * (yy1 - cy);
 
@@ -666,20 +674,26 @@ double COccupancyGridMap2D::computeLikelihoodField_Thrun(
 							square((unsigned int)(Ay));  // Square is faster
 						// with unsigned.
 						signed short Ax = Ax0;
-						cellType cell;
 
-						for (int xx = xx1; xx <= xx2; xx++)
+						// Read the row in place, in contiguous spans (one
+						// per tile, with tiled storage):
+						for (int xx = xx1; xx <= xx2;)
 						{
-							if ((cell = *mapPtr++) < thresholdCellValue)
+							unsigned int n;
+							const cellType* mapPtr = getRowSpan(xx, yy, xx2, n);
+							for (unsigned int i = 0; i < n; i++, xx++)
 							{
-								unsigned int d =
-									square((unsigned int)(Ax)) + Ay2;
-								keep_min(occupiedMinDistInt, d);
+								const cellType cell =
+									mapPtr ? mapPtr[i] : m_tiles_default;
+								if (cell < thresholdCellValue)
+								{
+									unsigned int d =
+										square((unsigned int)(Ax)) + Ay2;
+									keep_min(occupiedMinDistInt, d);
+								}
+								Ax += 10;
 							}
-							Ax += 10;
 						}
-						// Go to (xx1,yy++)
-						mapPtr += incrAfterRow;
 						Ay += 10;
 					}
 
@@ -717,6 +731,359 @@ double COccupancyGridMap2D::computeLikelihoodField_Thrun(
 	MRPT_END
 }
 
+/** Exact 1D squared distance transform of the sampled function `f` of
+ * length `n` (Felzenszwalb & Huttenlocher, "Distance Transforms of Sampled
+ * Functions", 2012). `v` and `z` are scratch buffers of size n and n+1. */
+static void squaredDistanceTransform1D(
+	const float* f, const int n, float* d, int* v, float* z)
+{
+	const float INF = std::numeric_limits<float>::max();
+	int k = 0;
+	v[0] = 0;
+	z[0] = -INF;
+	z[1] = INF;
+	for (int q = 1; q < n; q++)
+	{
+		const float fq = f[q] + float(q) * q;
+		float s = (fq - (f[v[k]] + float(v[k]) * v[k])) / (2 * (q - v[k]));
+		while (s <= z[k])
+		{
+			k--;
+			s = (fq - (f[v[k]] + float(v[k]) * v[k])) / (2 * (q - v[k]));
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = INF;
+	}
+	k = 0;
+	for (int q = 0; q < n; q++)
+	{
+		while (z[k + 1] < q) k++;
+		d[q] = square(q - v[k]) + f[v[k]];
+	}
+}
+
+/*---------------------------------------------------------------
+				internal_updateLikelihoodDT_window
+ ---------------------------------------------------------------*/
+void COccupancyGridMap2D::internal_updateLikelihoodDT_window(
+	int x0, int x1, int y0, int y1)
+{
+	// Any obstacle closer than the saturation distance to a cell of the
+	// output window lies within this margin:
+	const int K = 1 + (int)ceil(m_likelihoodDT_maxDist / resolution);
+	const int ix0 = max(0, x0 - K), ix1 = min((int)size_x - 1, x1 + K);
+	const int iy0 = max(0, y0 - K), iy1 = min((int)size_y - 1, y1 + K);
+	const int W = ix1 - ix0 + 1, H = iy1 - iy0 + 1;
+	if (W <= 0 || H <= 0) return;
+
+	// Larger than any saturated distance, but finite, so the parabolas
+	// intersections remain well defined:
+	const float FAR_AWAY = 1e20f;
+	const float res2 = square(resolution);
+	const float maxDist2 = square(m_likelihoodDT_maxDist);
+
+	std::vector<float> rowsDT(W * H), f(max(W, H)), d(max(W, H)),
+		z(max(W, H) + 1);
+	std::vector<int> v(max(W, H));
+
+	// 1st pass: along rows
+	for (int cy = iy0; cy <= iy1; cy++)
+	{
+		const uint8_t* occ = &m_likelihoodDT_occupied[ix0 + cy * size_x];
+		for (int i = 0; i < W; i++) f[i] = occ[i] ? .0f : FAR_AWAY;
+		squaredDistanceTransform1D(
+			&f[0], W, &rowsDT[(cy - iy0) * W], &v[0], &z[0]);
+	}
+	// 2nd pass: along columns, only for the output window:
+	for (int cx = x0; cx <= x1; cx++)
+	{
+		for (int j = 0; j < H; j++) f[j] = rowsDT[(cx - ix0) + j * W];
+		squaredDistanceTransform1D(&f[0], H, &d[0], &v[0], &z[0]);
+		for (int cy = y0; cy <= y1; cy++)
+			m_likelihoodDT[cx + cy * size_x] =
+				min(maxDist2, d[cy - iy0] * res2);
+	}
+}
+
+/*---------------------------------------------------------------
+				updateLikelihoodDistanceTransform
+ ---------------------------------------------------------------*/
+void COccupancyGridMap2D::updateLikelihoodDistanceTransform()
+{
+	MRPT_START
+
+	const size_t N = size_t(size_x) * size_y;
+	const float maxDist = likelihoodOptions.LF_maxCorrsDistance;
+	// The field must be rebuilt if the parameters it depends on changed,
+	// even if no cell did:
+	const bool paramsChanged = m_likelihoodDT.size() != N ||
+							   m_likelihoodDT_resolution != resolution ||
+							   m_likelihoodDT_maxDist != maxDist;
+	if (!m_likelihoodDT_ToBeUpdated && !paramsChanged) return;
+	m_likelihoodDT_ToBeUpdated = false;
+
+	const cellType thresholdCellValue = p2l(0.5f);
+	const unsigned int blocks_x = (size_x + TILE_SIZE - 1) >> TILE_SIZE_LOG2;
+	const unsigned int blocks_y = (size_y + TILE_SIZE - 1) >> TILE_SIZE_LOG2;
+
+	if (paramsChanged)
+	{
+		// Full rebuild:
+		m_likelihoodDT_resolution = resolution;
+		m_likelihoodDT_maxDist = maxDist;
+		m_likelihoodDT.resize(N);
+		m_likelihoodDT_occupied.resize(N);
+		m_likelihoodDT_dirty.assign(size_t(blocks_x) * blocks_y, 0);
+		m_likelihoodDT_dirty_x = blocks_x;
+		std::vector<cellType> rowBuf;
+		for (unsigned int cy = 0; cy < size_y; cy++)
+		{
+			const cellType* row = getRowData(cy, rowBuf);
+			uint8_t* occ = &m_likelihoodDT_occupied[cy * size_x];
+			for (unsigned int cx = 0; cx < size_x; cx++)
+				occ[cx] = row[cx] < thresholdCellValue ? 1 : 0;
+		}
+		if (N) internal_updateLikelihoodDT_window(0, size_x - 1, 0, size_y - 1);
+		return;
+	}
+
+	// Incremental update: only blocks written since the last update may have
+	// changed. Adjacent ones are grouped (8-connectivity), and the field is
+	// recomputed once for the bounding box of the changed cells of each
+	// group, plus the saturation distance:
+	const int K = 1 + (int)ceil(maxDist / resolution);
+	std::vector<unsigned int> group;
+	std::vector<std::array<int, 4>> windows;  // x0,x1,y0,y1
+	for (unsigned int seed = 0; seed < m_likelihoodDT_dirty.size(); seed++)
+	{
+		if (!m_likelihoodDT_dirty[seed]) continue;
+		m_likelihoodDT_dirty[seed] = 0;
+		group.assign(1, seed);
+
+		int cx_min = size_x, cx_max = -1, cy_min = size_y, cy_max = -1;
+		for (size_t g = 0; g < group.size(); g++)
+		{
+			const unsigned int bx = group[g] % blocks_x,
+							   by = group[g] / blocks_x;
+			for (unsigned int ny = (by ? by - 1 : 0);
+				 ny <= std::min(by + 1, blocks_y - 1); ny++)
+				for (unsigned int nx = (bx ? bx - 1 : 0);
+					 nx <= std::min(bx + 1, blocks_x - 1); nx++)
+				{
+					uint8_t& d = m_likelihoodDT_dirty[nx + ny * blocks_x];
+					if (!d) continue;
+					d = 0;
+					group.push_back(nx + ny * blocks_x);
+				}
+
+			// Cells of this block whose binarized occupancy changed:
+			const unsigned int x0 = bx << TILE_SIZE_LOG2,
+							   y0 = by << TILE_SIZE_LOG2;
+			const unsigned int x1 = std::min(size_x, x0 + TILE_SIZE) - 1,
+							   y1 = std::min(size_y, y0 + TILE_SIZE) - 1;
+			for (unsigned int cy = y0; cy <= y1; cy++)
+			{
+				uint8_t* occ = &m_likelihoodDT_occupied[cy * size_x];
+				for (unsigned int cx = x0; cx <= x1; cx++)
+				{
+					const uint8_t o =
+						cellValue(cx, cy) < thresholdCellValue ? 1 : 0;
+					if (o == occ[cx]) continue;
+					occ[cx] = o;
+					keep_min(cx_min, (int)cx);
+					keep_max(cx_max, (int)cx);
+					keep_min(cy_min, (int)cy);
+					keep_max(cy_max, (int)cy);
+				}
+			}
+		}
+		if (cx_max < 0) continue;  // Written, but nothing changed
+
+		// Distances only change within the saturation distance of changed
+		// cells:
+		windows.push_back(
+			{{max(0, cx_min - K), min((int)size_x - 1, cx_max + K),
+			  max(0, cy_min - K), min((int)size_y - 1, cy_max + K)}});
+	}
+	// Once m_likelihoodDT_occupied is up to date for all groups:
+	for (const auto& w : windows)
+		internal_updateLikelihoodDT_window(w[0], w[1], w[2], w[3]);
+
+	MRPT_END
+}
+
+/*---------------------------------------------------------------
+			computeLikelihoodField_DistanceTransform
+ ---------------------------------------------------------------*/
+double COccupancyGridMap2D::computeLikelihoodField_DistanceTransform(
+	const CPointsMap* pm, const CPose2D* relativePose)
+{
+	MRPT_START
+
+	if (!pm->size()) return -100;  // No way to estimate this likelihood!!
+
+	updateLikelihoodDistanceTransform();
+	return internal_likelihoodField_DT(
+		*pm, relativePose ? TPose2D(*relativePose) : TPose2D(0, 0, 0));
+
+	MRPT_END
+}
+
+double COccupancyGridMap2D::internal_likelihoodField_DT(
+	const CPointsMap& pm, const TPose2D& pose) const
+{
+	const size_t N = pm.size();
+
+	const bool Product_T_OrSum_F = !likelihoodOptions.LF_alternateAverageMethod;
+	const float zHit = likelihoodOptions.LF_zHit;
+	const float zRandomTerm =
+		likelihoodOptions.LF_zRandom / likelihoodOptions.LF_maxRange;
+	const float Q = -0.5f / square(likelihoodOptions.LF_stdHit);
+	const double maxCorrDist_sq =
+		square(likelihoodOptions.LF_maxCorrsDistance);
+	const double minimumLik = zRandomTerm + zHit * exp(Q * maxCorrDist_sq);
+	const bool useSquareDist = likelihoodOptions.LF_useSquareDist;
+	const size_t decimation = N < 10 ? 1 : likelihoodOptions.LF_decimation;
+
+	const unsigned int size_x_1 = size_x - 1;
+	const unsigned int size_y_1 = size_y - 1;
+	const double x0 = pose.x, y0 = pose.y;
+	const double ccos = cos(pose.phi), ssin = sin(pose.phi);
+
+	const float* xs = &pm.getPointsBufferRef_x()[0];
+	const float* ys = &pm.getPointsBufferRef_y()[0];
+	const float* dt = m_likelihoodDT.empty() ? nullptr : &m_likelihoodDT[0];
+
+	// Points are processed in small blocks: first, all the cell indices are
+	// computed in a tight loop free of branches and memory lookups (which the
+	// compiler can vectorize), then the distances are looked up.
+	const size_t BLOCK = 64;
+	int cell_idx[BLOCK];
+
+	double ret = 0;
+	int M = 0;
+	for (size_t j0 = 0; j0 < N; j0 += BLOCK * decimation)
+	{
+		const size_t nBlock =
+			std::min(BLOCK, (N - j0 + decimation - 1) / decimation);
+
+		for (size_t k = 0; k < nBlock; k++)
+		{
+			const size_t j = j0 + k * decimation;
+			const double gx = x0 + xs[j] * ccos - ys[j] * ssin;
+			const double gy = y0 + xs[j] * ssin + ys[j] * ccos;
+			const int cx = static_cast<int>((gx - x_min) / resolution);
+			const int cy = static_cast<int>((gy - y_min) / resolution);
+			// Tip: Comparison cx<0 is implicit in (unsigned)(x)>size...
+			const bool inside = static_cast<unsigned>(cx) < size_x_1 &&
+								static_cast<unsigned>(cy) < size_y_1;
+			cell_idx[k] = inside ? cx + cy * static_cast<int>(size_x) : -1;
+		}
+
+		for (size_t k = 0; k < nBlock; k++)
+		{
+			double thisLik;
+			if (cell_idx[k] < 0)
+			{
+				// Outside of the map: likelihood for the max. correspondence
+				// distance.
+				thisLik = minimumLik;
+			}
+			else
+			{
+				float occupiedMinDist = dt[cell_idx[k]];
+				if (useSquareDist) occupiedMinDist *= occupiedMinDist;
+				thisLik = zRandomTerm + zHit * exp(Q * occupiedMinDist);
+			}
+
+			if (Product_T_OrSum_F)
+				ret += log(thisLik);
+			else
+			{
+				ret += thisLik;
+				M++;
+			}
+		}
+	}
+
+	if (!Product_T_OrSum_F) ret = log(ret / M);
+
+	return ret;
+}
+
+/*---------------------------------------------------------------
+			internal_computeObservationLikelihoodBatch
+ ---------------------------------------------------------------*/
+void COccupancyGridMap2D::internal_computeObservationLikelihoodBatch(
+	const CObservation* obs, const std::vector<TPose3D>& takenFrom,
+	std::vector<double>& out_logliks, CWorkerThreadsPool* threadPool)
+{
+	MRPT_START
+
+	// Only the distance transform method has a specific implementation,
+	// since it does not modify the map while evaluating poses:
+	const bool is_scan = IS_CLASS(obs, CObservation2DRangeScan);
+	if (likelihoodOptions.likelihoodMethod !=
+			lmLikelihoodField_DistanceTransform ||
+		(!is_scan && !IS_CLASS(obs, CObservationRange)))
+	{
+		CMetricMap::internal_computeObservationLikelihoodBatch(
+			obs, takenFrom, out_logliks, threadPool);
+		return;
+	}
+
+	// Build the points of the observation, only once for all the poses:
+	const CPointsMap* pts;
+	CSimplePointsMap rangePts;
+	if (is_scan)
+	{
+		const CObservation2DRangeScan* o =
+			static_cast<const CObservation2DRangeScan*>(obs);
+		// Same checks than in internal_computeObservationLikelihood():
+		if (!o->isPlanarScan(insertionOptions.horizontalTolerance) ||
+			(insertionOptions.useMapAltitude &&
+			 fabs(insertionOptions.mapAltitude - o->sensorPose.z()) > 0.01))
+		{
+			out_logliks.assign(takenFrom.size(), -10);
+			return;
+		}
+
+		CPointsMap::TInsertionOptions opts;
+		opts.minDistBetweenLaserPoints = resolution * 0.5f;
+		opts.isPlanarMap = true;  // Already filtered above!
+		opts.horizontalTolerance = insertionOptions.horizontalTolerance;
+		pts = o->buildAuxPointsMap<mrpt::maps::CPointsMap>(&opts);
+	}
+	else
+	{
+		rangePts.insertionOptions.minDistBetweenLaserPoints = resolution * 0.5f;
+		rangePts.insertObservation(obs);
+		pts = &rangePts;
+	}
+
+	if (!pts->size())
+	{
+		out_logliks.assign(takenFrom.size(), -100);
+		return;
+	}
+
+	updateLikelihoodDistanceTransform();
+
+	auto evalPoses = [&](size_t first, size_t last, size_t) {
+		for (size_t i = first; i < last; i++)
+			out_logliks[i] = internal_likelihoodField_DT(
+				*pts, TPose2D(takenFrom[i].x, takenFrom[i].y, takenFrom[i].yaw));
+	};
+	if (threadPool)
+		threadPool->parallelChunks(takenFrom.size(), evalPoses);
+	else
+		evalPoses(0, takenFrom.size(), 0);
+
+	MRPT_END
+}
+
 /*---------------------------------------------------------------
 					computeLikelihoodField_II
  ---------------------------------------------------------------*/
@@ -923,6 +1290,9 @@ void COccupancyGridMap2D::TLikelihoodOptions::dumpToTextStream(
 		case lmConsensusOWA:
 			out.printf("lmConsensusOWA");
 			break;
+		case lmLikelihoodField_DistanceTransform:
+			out.printf("lmLikelihoodField_DistanceTransform");
+			break;
 		default:
 			out.printf("UNKNOWN!!!");
 			break;
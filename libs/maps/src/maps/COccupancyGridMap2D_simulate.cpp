@@ -13,6 +13,7 @@
 #include <mrpt/obs/CObservation2DRangeScan.h>
 #include <mrpt/obs/CObservationRange.h>
 #include <mrpt/utils/round.h>  // round()
+#include <mrpt/utils/CWorkerThreadsPool.h>
 #include <mrpt/math/transform_gaussian.h>
 
 #include <mrpt/random.h>
@@ -26,12 +27,77 @@ using namespace mrpt::poses;
 using namespace std;
 
 double COccupancyGridMap2D::RAYTRACE_STEP_SIZE_IN_CELL_UNITS = 0.8;
+bool COccupancyGridMap2D::RAYTRACE_USE_DISTANCE_FIELD = true;
+
+std::shared_ptr<const std::vector<uint8_t>>
+	COccupancyGridMap2D::getSimulatorDistanceField(
+		const cellType threshold_free_int) const
+{
+	std::lock_guard<std::mutex> lock(m_simulDF.mtx);
+	if (m_simulDF.dist && !m_simulDF.toBeUpdated &&
+		m_simulDF.threshold_free_int == threshold_free_int)
+		return m_simulDF.dist;
+
+	// Chessboard distance transform (two passes with a 3x3 mask). Cells where
+	// rays stop are at distance 0, and the outside of the grid counts as such
+	// cells, so the distance of each cell is at most its distance to the
+	// closest border.
+	const int sx = static_cast<int>(size_x), sy = static_cast<int>(size_y);
+	auto df = std::make_shared<std::vector<uint8_t>>(size_x * size_y);
+	std::vector<uint8_t>& d = *df;
+	for (int y = 0; y < sy; y++)
+	{
+		uint8_t* row = &d[y * sx];
+		const int dy = std::min(y + 1, sy - y);
+		for (int x = 0; x < sx; x++)
+		{
+			if (cellValue(x, y) <= threshold_free_int)
+			{
+				row[x] = 0;
+				continue;
+			}
+			int v = std::min(std::min(x + 1, sx - x), dy);
+			if (x > 0) v = std::min(v, row[x - 1] + 1);
+			if (y > 0)
+			{
+				const uint8_t* up = row - sx;
+				v = std::min(v, up[x] + 1);
+				if (x > 0) v = std::min(v, up[x - 1] + 1);
+				if (x + 1 < sx) v = std::min(v, up[x + 1] + 1);
+			}
+			row[x] = static_cast<uint8_t>(std::min(v, 255));
+		}
+	}
+	for (int y = sy - 1; y >= 0; y--)
+	{
+		uint8_t* row = &d[y * sx];
+		for (int x = sx - 1; x >= 0; x--)
+		{
+			int v = row[x];
+			if (v <= 1) continue;
+			if (x + 1 < sx) v = std::min(v, row[x + 1] + 1);
+			if (y + 1 < sy)
+			{
+				const uint8_t* down = row + sx;
+				v = std::min(v, down[x] + 1);
+				if (x > 0) v = std::min(v, down[x - 1] + 1);
+				if (x + 1 < sx) v = std::min(v, down[x + 1] + 1);
+			}
+			row[x] = static_cast<uint8_t>(v);
+		}
+	}
+
+	m_simulDF.dist = df;
+	m_simulDF.threshold_free_int = threshold_free_int;
+	m_simulDF.toBeUpdated = false;
+	return m_simulDF.dist;
+}
 
 // See docs in header
 void COccupancyGridMap2D::laserScanSimulator(
 	mrpt::obs::CObservation2DRangeScan& inout_Scan, const CPose2D& robotPose,
 	float threshold, size_t N, float noiseStd, unsigned int decimation,
-	float angleNoiseStd) const
+	float angleNoiseStd, CWorkerThreadsPool* threadPool) const
 {
 	MRPT_START
 
@@ -52,16 +118,66 @@ void COccupancyGridMap2D::laserScanSimulator(
 		(inout_Scan.rightToLeft ? 1.0 : -1.0) * (inout_Scan.aperture / (N - 1));
 
 	const float free_thres = 1.0f - threshold;
+	const cellType free_thres_int = p2l(free_thres);
+	const auto df = RAYTRACE_USE_DISTANCE_FIELD
+						? getSimulatorDistanceField(free_thres_int)
+						: nullptr;
+	const uint8_t* df_ptr = df && !df->empty() ? &(*df)[0] : nullptr;
 
-	for (size_t i = 0; i < N; i += decimation, A += AA * decimation)
+	if (angleNoiseStd > 0 || !threadPool)
+	{
+		// Same as simulateScanRay() for each ray:
+		for (size_t i = 0; i < N; i += decimation, A += AA * decimation)
+		{
+			const double A_ =
+				A +
+				(angleNoiseStd > .0
+					 ? getRandomGenerator().drawGaussian1D_normalized() *
+						   angleNoiseStd
+					 : .0);
+			bool valid;
+			float out_range;
+			internal_simulateScanRay(
+				sensorPose.x(), sensorPose.y(), A_, out_range, valid,
+				inout_Scan.maxRange, free_thres_int, df_ptr);
+			if (noiseStd > 0 && valid)
+				out_range +=
+					noiseStd * getRandomGenerator().drawGaussian1D_normalized();
+			inout_Scan.setScanRange(i, out_range);
+			inout_Scan.setScanRangeValidity(i, valid);
+		}
+	}
+	else
 	{
-		bool valid;
-		float out_range;
-		simulateScanRay(
-			sensorPose.x(), sensorPose.y(), A, out_range, valid,
-			inout_Scan.maxRange, free_thres, noiseStd, angleNoiseStd);
-		inout_Scan.setScanRange(i, out_range);
-		inout_Scan.setScanRangeValidity(i, valid);
+		// Trace the rays in parallel, then add the noise to valid ranges in
+		// order, drawing the same random numbers as in serial simulation:
+		std::vector<double> angles;
+		for (size_t i = 0; i < N; i += decimation, A += AA * decimation)
+			angles.push_back(A);
+		threadPool->parallelChunks(
+			angles.size(), [&](size_t first, size_t last, size_t) {
+				for (size_t k = first; k < last; k++)
+				{
+					bool valid;
+					float out_range;
+					internal_simulateScanRay(
+						sensorPose.x(), sensorPose.y(), angles[k], out_range,
+						valid, inout_Scan.maxRange, free_thres_int, df_ptr);
+					inout_Scan.setScanRange(k * decimation, out_range);
+					inout_Scan.setScanRangeValidity(k * decimation, valid);
+				}
+			});
+		if (noiseStd > 0)
+		{
+			for (size_t i = 0; i < N; i += decimation)
+			{
+				if (!inout_Scan.getScanRangeValidity(i)) continue;
+				float out_range = inout_Scan.getScanRange(i);
+				out_range +=
+					noiseStd * getRandomGenerator().drawGaussian1D_normalized();
+				inout_Scan.setScanRange(i, out_range);
+			}
+		}
 	}
 
 	MRPT_END
@@ -119,6 +235,24 @@ void COccupancyGridMap2D::simulateScanRay(
 			 ? getRandomGenerator().drawGaussian1D_normalized() * angleNoiseStd
 			 : .0);
 
+	const cellType threshold_free_int = p2l(threshold_free);
+	const auto df = RAYTRACE_USE_DISTANCE_FIELD
+						? getSimulatorDistanceField(threshold_free_int)
+						: nullptr;
+	internal_simulateScanRay(
+		start_x, start_y, A_, out_range, out_valid, max_range_meters,
+		threshold_free_int, df && !df->empty() ? &(*df)[0] : nullptr);
+
+	// Add additive Gaussian noise:
+	if (noiseStd > 0 && out_valid)
+		out_range += noiseStd * getRandomGenerator().drawGaussian1D_normalized();
+}
+
+void COccupancyGridMap2D::internal_simulateScanRay(
+	const double start_x, const double start_y, const double A_,
+	float& out_range, bool& out_valid, const double max_range_meters,
+	const cellType threshold_free_int, const uint8_t* dist_field) const
+{
 // Unit vector in the directorion of the ray:
 #ifdef HAVE_SINCOS
 	double Arx, Ary;
@@ -147,19 +281,38 @@ void COccupancyGridMap2D::simulateScanRay(
 		RAYTRACE_STEP_SIZE_IN_CELL_UNITS * Arx * (1L << INTPRECNUMBIT));
 	const int64_t Aryi = static_cast<int64_t>(
 		RAYTRACE_STEP_SIZE_IN_CELL_UNITS * Ary * (1L << INTPRECNUMBIT));
+	// The longest move along x or y of one step:
+	const int64_t max_step_int =
+		std::max<int64_t>(1, std::max(std::abs(Arxi), std::abs(Aryi)));
 
 	cellType hitCellOcc_int = 0;  // p2l(0.5f)
-	const cellType threshold_free_int = p2l(threshold_free);
 	int x, y = int_y2idx(ryi);
 
 	while ((x = int_x2idx(rxi)) >= 0 && (y = int_y2idx(ryi)) >= 0 &&
 		   x < static_cast<int>(size_x) && y < static_cast<int>(size_y) &&
-		   (hitCellOcc_int = map[x + y * size_x]) > threshold_free_int &&
+		   (hitCellOcc_int = cellValue(x, y)) > threshold_free_int &&
 		   ray_len < max_ray_len)
 	{
-		rxi += Arxi;
-		ryi += Aryi;
-		ray_len++;
+		// If all cells at a chessboard distance < d from this one are free,
+		// moving up to d-1 cells along x and y (in fixed point, from any
+		// point in this cell) ends in one of them: take all the steps that
+		// fit in there at once. The result is exactly that of single steps.
+		unsigned int nSteps = 1;
+		if (dist_field)
+		{
+			const unsigned int d = dist_field[x + y * size_x];
+			if (d > 1)
+			{
+				const int64_t n =
+					(static_cast<int64_t>(d - 1) << INTPRECNUMBIT) /
+					max_step_int;
+				nSteps = static_cast<unsigned int>(std::max<int64_t>(
+					1, std::min<int64_t>(n, max_ray_len - ray_len)));
+			}
+		}
+		rxi += nSteps * Arxi;
+		ryi += nSteps * Aryi;
+		ray_len += nSteps;
 	}
 
 	// Store:
@@ -175,9 +328,6 @@ void COccupancyGridMap2D::simulateScanRay(
 	{  // No: The normal case:
 		out_range = RAYTRACE_STEP_SIZE_IN_CELL_UNITS * ray_len * resolution;
 		out_valid = (ray_len < max_ray_len);  // out_range<max_range_meters;
-		// Add additive Gaussian noise:
-		if (noiseStd > 0 && out_valid)
-			out_range += noiseStd * getRandomGenerator().drawGaussian1D_normalized();
 	}
 }
 
@@ -195,7 +345,8 @@ COccupancyGridMap2D::TLaserSimulUncertaintyParams::
 	  rangeNoiseStd(.0f),
 	  angleNoiseStd(.0f),
 	  decimation(1),
-	  threshold(.6f)
+	  threshold(.6f),
+	  threadPool(nullptr)
 {
 }
 
@@ -218,38 +369,25 @@ static void func_laserSimul_callback(
 	ASSERT_(fixed_param.params->decimation >= 1)
 	ASSERT_(fixed_param.params->nRays >= 2)
 
-	const size_t N = fixed_param.params->nRays;
+	const COccupancyGridMap2D::TLaserSimulUncertaintyParams& p =
+		*fixed_param.params;
+	const size_t N = p.nRays;
 
-	// Sensor pose in global coordinates
-	const CPose3D sensorPose3D =
-		CPose3D(x_pose[0], x_pose[1], .0, x_pose[2], .0, .0) +
-		fixed_param.params->sensorPose;
-	// Aproximation: grid is 2D !!!
-	const CPose2D sensorPose(sensorPose3D);
+	// Simulate the scan from this robot pose, without noise:
+	CObservation2DRangeScan scan;
+	scan.aperture = p.aperture;
+	scan.rightToLeft = p.rightToLeft;
+	scan.maxRange = p.maxRange;
+	scan.sensorPose = p.sensorPose;
+	fixed_param.grid->laserScanSimulator(
+		scan, CPose2D(x_pose[0], x_pose[1], x_pose[2]), p.threshold, N,
+		.0f /*noiseStd*/, p.decimation, .0f /*angleNoiseStd*/, p.threadPool);
 
 	// Scan size:
 	y_scanRanges.resize(N);
-
-	double A = sensorPose.phi() +
-			   (fixed_param.params->rightToLeft ? -0.5 : +0.5) *
-				   fixed_param.params->aperture;
-	const double AA = (fixed_param.params->rightToLeft ? 1.0 : -1.0) *
-					  (fixed_param.params->aperture / (N - 1));
-
-	const float free_thres = 1.0f - fixed_param.params->threshold;
-
-	for (size_t i = 0; i < N; i += fixed_param.params->decimation,
-				A += AA * fixed_param.params->decimation)
-	{
-		bool valid;
-		float range;
-
-		fixed_param.grid->simulateScanRay(
-			sensorPose.x(), sensorPose.y(), A, range, valid,
-			fixed_param.params->maxRange, free_thres, .0 /*noiseStd*/,
-			.0 /*angleNoiseStd*/);
-		y_scanRanges[i] = valid ? range : fixed_param.params->maxRange;
-	}
+	for (size_t i = 0; i < N; i += p.decimation)
+		y_scanRanges[i] =
+			scan.getScanRangeValidity(i) ? scan.getScanRange(i) : p.maxRange;
 }
 
 void COccupancyGridMap2D::laserScanSimulatorWithUncertainty(
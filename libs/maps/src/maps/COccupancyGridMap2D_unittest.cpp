@@ -8,8 +8,13 @@
    +------------------------------------------------------------------------+ */
 
 #include <mrpt/maps/COccupancyGridMap2D.h>
+#include <mrpt/maps/CSimplePointsMap.h>
 #include <mrpt/obs/CObservation2DRangeScan.h>
+#include <mrpt/utils/CMemoryStream.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
+#include <mrpt/random.h>
 #include <gtest/gtest.h>
+#include <cstring>
 
 using namespace mrpt;
 using namespace mrpt::maps;
@@ -17,6 +22,7 @@ using namespace mrpt::obs;
 using namespace mrpt::utils;
 using namespace mrpt::poses;
 using namespace mrpt::math;
+using namespace mrpt::random;
 using namespace std;
 
 TEST(COccupancyGridMap2DTests, insert2DScan)
@@ -105,3 +111,564 @@ TEST(COccupancyGridMap2DTests, insert2DScan)
 		// should have a high "freeness"
 	}
 }
+
+// Brute-force reference of the saturated squared distance to the closest
+// occupied cell:
+static float bruteForceSqrDistToOccupied(
+	const COccupancyGridMap2D& grid, int cx, int cy, float maxDist)
+{
+	float d2 = square(maxDist);
+	for (unsigned int y = 0; y < grid.getSizeY(); y++)
+		for (unsigned int x = 0; x < grid.getSizeX(); x++)
+			if (grid.getCell(x, y) < 0.5f)
+				keep_min(
+					d2, square(grid.getResolution()) *
+							(square(float(x) - cx) + square(float(y) - cy)));
+	return d2;
+}
+
+static void checkLikelihoodDistanceTransform(COccupancyGridMap2D& grid)
+{
+	const float maxDist = grid.likelihoodOptions.LF_maxCorrsDistance;
+	grid.updateLikelihoodDistanceTransform();
+	const std::vector<float>& dt = grid.getLikelihoodDistanceTransform();
+	ASSERT_EQ(dt.size(), grid.getSizeX() * grid.getSizeY());
+	for (unsigned int cy = 0; cy < grid.getSizeY(); cy++)
+		for (unsigned int cx = 0; cx < grid.getSizeX(); cx++)
+			EXPECT_NEAR(
+				dt[cx + cy * grid.getSizeX()],
+				bruteForceSqrDistToOccupied(grid, cx, cy, maxDist), 1e-4f)
+				<< "cx=" << cx << " cy=" << cy;
+}
+
+TEST(COccupancyGridMap2DTests, likelihoodDistanceTransform)
+{
+	COccupancyGridMap2D grid(-2.0f, 2.0f, -1.5f, 1.5f, 0.10f);
+	grid.likelihoodOptions.LF_maxCorrsDistance = 0.6f;
+
+	// Empty map: all distances saturated.
+	checkLikelihoodDistanceTransform(grid);
+
+	// Full build:
+	for (int i = 5; i < 30; i++) grid.setCell(i, 10, 0.1f);
+	grid.setCell(3, 3, 0.0f);
+	checkLikelihoodDistanceTransform(grid);
+
+	// Incremental updates, adding and removing obstacles:
+	grid.setCell(35, 25, 0.0f);
+	checkLikelihoodDistanceTransform(grid);
+	for (int i = 10; i < 20; i++) grid.setCell(i, 10, 0.9f);
+	checkLikelihoodDistanceTransform(grid);
+	grid.setCell(3, 3, 0.5f);
+	checkLikelihoodDistanceTransform(grid);
+
+	// Change of the saturation distance, without touching any cell: rebuild
+	grid.likelihoodOptions.LF_maxCorrsDistance = 1.0f;
+	checkLikelihoodDistanceTransform(grid);
+	grid.likelihoodOptions.LF_maxCorrsDistance = 0.3f;
+	checkLikelihoodDistanceTransform(grid);
+}
+
+TEST(COccupancyGridMap2DTests, likelihoodFieldDistanceTransformVsThrun)
+{
+	COccupancyGridMap2D grid(-5.0f, 5.0f, -5.0f, 5.0f, 0.05f);
+	for (int i = 20; i < 180; i++)
+	{
+		grid.setCell(i, 30, 0.05f);
+		grid.setCell(150, i, 0.05f);
+	}
+	grid.likelihoodOptions.LF_decimation = 1;
+
+	CSimplePointsMap pts;
+	for (int i = 0; i < 50; i++)
+		pts.insertPoint(-3.0f + i * 0.13f, -3.52f + 0.01f * (i % 7), 0);
+
+	// Also after changing the options the distance field depends on, with no
+	// change in the cells:
+	for (const float maxCorrDist : {0.3f, 1.0f, 0.3f})
+	{
+		grid.likelihoodOptions.LF_maxCorrsDistance = maxCorrDist;
+		for (int k = 0; k < 10; k++)
+		{
+			const CPose2D p(0.02 * k, 0.05 * k, DEG2RAD(2.0 * k));
+			grid.likelihoodOptions.enableLikelihoodCache = false;
+			const double lik_thrun =
+				grid.computeLikelihoodField_Thrun(&pts, &p);
+			const double lik_dt =
+				grid.computeLikelihoodField_DistanceTransform(&pts, &p);
+			EXPECT_NEAR(lik_thrun, lik_dt, 1e-3)
+				<< "pose: " << p << " maxCorrsDistance: " << maxCorrDist;
+		}
+	}
+}
+
+TEST(COccupancyGridMap2DTests, computeObservationLikelihoodBatch)
+{
+	// A synthetic scan of a round room:
+	CObservation2DRangeScan scan;
+	scan.aperture = M_2PIf;
+	scan.resizeScanAndAssign(360, 3.0f, true);
+
+	COccupancyGridMap2D grid(-5.0f, 5.0f, -5.0f, 5.0f, 0.05f);
+	grid.insertObservation(&scan);
+
+	std::vector<TPose3D> poses;
+	for (int k = 0; k < 25; k++)
+		poses.push_back(
+			TPose3D(0.04 * k - 0.5, 0.5 - 0.03 * k, 0, DEG2RAD(3.0 * k), 0, 0));
+
+	for (const auto method :
+		 {COccupancyGridMap2D::lmLikelihoodField_Thrun,
+		  COccupancyGridMap2D::lmLikelihoodField_DistanceTransform})
+	{
+		grid.likelihoodOptions.likelihoodMethod = method;
+
+		std::vector<double> expected(poses.size());
+		for (size_t i = 0; i < poses.size(); i++)
+			expected[i] =
+				grid.computeObservationLikelihood(&scan, CPose3D(poses[i]));
+
+		CWorkerThreadsPool pool(3);
+		for (CWorkerThreadsPool* p : {(CWorkerThreadsPool*)nullptr, &pool})
+		{
+			std::vector<double> logliks;
+			grid.computeObservationLikelihoodBatch(&scan, poses, logliks, p);
+			ASSERT_EQUAL_(logliks.size(), poses.size());
+			for (size_t i = 0; i < poses.size(); i++)
+				EXPECT_NEAR(expected[i], logliks[i], 1e-9)
+					<< "method: " << int(method) << " pose: " << poses[i];
+		}
+	}
+}
+
+// Checks that both maps hold the same cells, comparing them in metric
+// coordinates, since tiled grids grow in whole tiles:
+static void checkSameCells(
+	const COccupancyGridMap2D& dense, const COccupancyGridMap2D& tiled)
+{
+	EXPECT_LE(tiled.getXMin(), dense.getXMin() + 1e-3f);
+	EXPECT_LE(tiled.getYMin(), dense.getYMin() + 1e-3f);
+	EXPECT_GE(tiled.getXMax(), dense.getXMax() - 1e-3f);
+	EXPECT_GE(tiled.getYMax(), dense.getYMax() - 1e-3f);
+	for (unsigned int cy = 0; cy < dense.getSizeY(); cy++)
+		for (unsigned int cx = 0; cx < dense.getSizeX(); cx++)
+		{
+			const float x = dense.idx2x(cx), y = dense.idx2y(cy);
+			ASSERT_EQ(dense.getCell(cx, cy), tiled.getPos(x, y))
+				<< "x=" << x << " y=" << y;
+		}
+}
+
+static void insertRoomScans(COccupancyGridMap2D& grid)
+{
+	// A synthetic scan of a round room, seen from several poses:
+	CObservation2DRangeScan scan;
+	scan.aperture = M_2PIf;
+	scan.resizeScanAndAssign(360, 7.0f, true);
+	for (int k = 0; k < 8; k++)
+	{
+		const double a = k * M_PI / 4;
+		const CPose3D p(3.0 * cos(a), 3.0 * sin(a), 0, a, 0, 0);
+		grid.insertObservation(&scan, &p);
+	}
+}
+
+// The distance transform, updated after each change, must match the one
+// built from scratch for the same cells:
+static void checkLikelihoodDTVsRebuild(COccupancyGridMap2D& grid)
+{
+	grid.updateLikelihoodDistanceTransform();
+	COccupancyGridMap2D ref;
+	ref.copyMapContentFrom(grid);
+	ref.likelihoodOptions = grid.likelihoodOptions;
+	ref.updateLikelihoodDistanceTransform();
+	const std::vector<float>& dt = grid.getLikelihoodDistanceTransform();
+	const std::vector<float>& dt_ref = ref.getLikelihoodDistanceTransform();
+	ASSERT_EQ(dt.size(), dt_ref.size());
+	size_t nWrong = 0;
+	for (size_t i = 0; i < dt.size(); i++)
+		if (std::abs(dt[i] - dt_ref[i]) > 1e-6f) nWrong++;
+	EXPECT_EQ(nWrong, 0u);
+}
+
+TEST(COccupancyGridMap2DTests, likelihoodDistanceTransformBlocks)
+{
+	for (bool tiled : {false, true})
+	{
+		COccupancyGridMap2D grid(-15.0f, 15.0f, -12.0f, 12.0f, 0.10f);
+		grid.setTiledStorage(tiled);
+		grid.likelihoodOptions.LF_maxCorrsDistance = 0.5f;
+		grid.updateLikelihoodDistanceTransform();
+
+		// Distant changes, in different blocks of cells:
+		grid.setCell(10, 10, 0.0f);
+		grid.setCell(250, 200, 0.0f);
+		checkLikelihoodDTVsRebuild(grid);
+
+		// Across the border between blocks, and removals:
+		const unsigned B = COccupancyGridMap2D::TILE_SIZE;
+		for (unsigned i = B - 5; i < B + 5; i++) grid.setCell(i, B, 0.1f);
+		grid.setCell(10, 10, 0.9f);
+		checkLikelihoodDTVsRebuild(grid);
+		for (int k = 0; k < 10; k++) grid.updateCell(2 * B + 1, B - 1, 0.1f);
+		checkLikelihoodDTVsRebuild(grid);
+
+		// Observations:
+		insertRoomScans(grid);
+		checkLikelihoodDTVsRebuild(grid);
+
+		// Written, but with the same occupancy:
+		grid.setCell(250, 200, 0.2f);
+		checkLikelihoodDTVsRebuild(grid);
+
+		// Written through getRow() (with tiled storage, after switching to
+		// dense storage):
+		grid.getRow(2 * B)[3 * B] = grid.p2l(0.0f);
+		checkLikelihoodDTVsRebuild(grid);
+	}
+}
+
+TEST(COccupancyGridMap2DTests, tiledStorageMatchesDense)
+{
+	// Sizes which are not multiple of the tile size:
+	COccupancyGridMap2D dense(-12.0f, 12.0f, -11.0f, 13.0f, 0.05f);
+	COccupancyGridMap2D tiled(-12.0f, 12.0f, -11.0f, 13.0f, 0.05f);
+	tiled.setTiledStorage(true);
+	EXPECT_TRUE(tiled.isTiledStorage());
+	EXPECT_EQ(tiled.getAllocatedTilesCount(), 0u);
+
+	insertRoomScans(dense);
+	insertRoomScans(tiled);
+	ASSERT_EQ(dense.getSizeX(), tiled.getSizeX());
+	ASSERT_EQ(dense.getSizeY(), tiled.getSizeY());
+	checkSameCells(dense, tiled);
+
+	// Rows read in place, span by span:
+	for (unsigned int cy = 0; cy < tiled.getSizeY(); cy += 7)
+	{
+		const COccupancyGridMap2D::cellType* row = dense.getRow(cy);
+		for (unsigned int cx = 0; cx < tiled.getSizeX();)
+		{
+			unsigned int n;
+			const COccupancyGridMap2D::cellType* span =
+				tiled.getRowSpan(cx, cy, tiled.getSizeX() - 1, n);
+			ASSERT_GE(n, 1u);
+			for (unsigned int i = 0; i < n; i++, cx++)
+				ASSERT_EQ(
+					span ? span[i] : tiled.getTilesDefaultCell(), row[cx]);
+		}
+	}
+
+	// Rows copied by the const getRow():
+	const COccupancyGridMap2D& ctiled = tiled;
+	for (unsigned int cy = 0; cy < tiled.getSizeY(); cy += 7)
+	{
+		const COccupancyGridMap2D::cellType* row = ctiled.getRow(cy);
+		ASSERT_TRUE(row != nullptr);
+		ASSERT_EQ(
+			0, std::memcmp(
+				   row, dense.getRow(cy),
+				   tiled.getSizeX() * sizeof(COccupancyGridMap2D::cellType)));
+	}
+	EXPECT_TRUE(ctiled.getRow(-1) == nullptr);
+	EXPECT_TRUE(ctiled.getRow(tiled.getSizeY()) == nullptr);
+	EXPECT_TRUE(tiled.isTiledStorage());
+
+	// Single cell writes through the tiled path:
+	dense.setPos(1.0f, 1.0f, 0.2f);
+	tiled.setPos(1.0f, 1.0f, 0.2f);
+	checkSameCells(dense, tiled);
+
+	// Observation likelihoods do not depend on the storage:
+	CObservation2DRangeScan scan;
+	scan.aperture = M_2PIf;
+	scan.resizeScanAndAssign(180, 7.0f, true);
+	for (COccupancyGridMap2D::TLikelihoodMethod method :
+		 {COccupancyGridMap2D::lmLikelihoodField_Thrun,
+		  COccupancyGridMap2D::lmLikelihoodField_II,
+		  COccupancyGridMap2D::lmLikelihoodField_DistanceTransform})
+	{
+		dense.likelihoodOptions.likelihoodMethod = method;
+		tiled.likelihoodOptions.likelihoodMethod = method;
+		for (int k = 0; k < 5; k++)
+		{
+			const CPose3D p(0.1 * k, -0.2 * k, 0, DEG2RAD(5.0 * k), 0, 0);
+			EXPECT_NEAR(
+				dense.computeObservationLikelihood(&scan, p),
+				tiled.computeObservationLikelihood(&scan, p), 1e-6)
+				<< "method: " << int(method) << " pose: " << p;
+		}
+	}
+
+	// Conversions between both storages keep the contents:
+	COccupancyGridMap2D conv = tiled;
+	conv.setTiledStorage(false);
+	EXPECT_FALSE(conv.isTiledStorage());
+	ASSERT_TRUE(conv.getRow(0) != nullptr);
+	checkSameCells(dense, conv);
+	conv = dense;
+	conv.setTiledStorage(true);
+	checkSameCells(dense, conv);
+
+	// Writing through the non-const getRow() switches to dense storage:
+	conv.getRow(3)[5] = dense.p2l(0.9f);
+	dense.setCell(5, 3, 0.9f);
+	EXPECT_FALSE(conv.isTiledStorage());
+	checkSameCells(dense, conv);
+}
+
+TEST(COccupancyGridMap2DTests, tiledStorageGrows)
+{
+	COccupancyGridMap2D dense(-2.0f, 2.0f, -1.0f, 3.0f, 0.05f);
+	COccupancyGridMap2D tiled(-2.0f, 2.0f, -1.0f, 3.0f, 0.05f);
+	tiled.setTiledStorage(true);
+	for (COccupancyGridMap2D* m : {&dense, &tiled})
+		for (int i = 0; i < 40; i++)
+		{
+			m->setPos(-1.9f + i * 0.1f, 0.52f, 0.1f);
+			m->setPos(0.27f, -0.9f + i * 0.1f, 0.8f);
+		}
+	const size_t nTiles = tiled.getAllocatedTilesCount();
+
+	// Grow along all sides, twice:
+	for (COccupancyGridMap2D* m : {&dense, &tiled})
+	{
+		m->resizeGrid(-5.0f, 2.5f, -1.0f, 7.0f, 0.5f, false);
+		m->resizeGrid(-6.0f, 9.0f, -8.0f, 8.0f, 0.5f, false);
+	}
+	checkSameCells(dense, tiled);
+	EXPECT_FLOAT_EQ(tiled.getPos(-5.5f, -7.5f), 0.5f);
+	EXPECT_FLOAT_EQ(tiled.getPos(8.5f, 7.5f), 0.5f);
+	// Existing tiles were reused, and new areas are not allocated:
+	EXPECT_EQ(tiled.getAllocatedTilesCount(), nTiles);
+}
+
+TEST(COccupancyGridMap2DTests, tiledStorageIsSparse)
+{
+	COccupancyGridMap2D grid(-100.0f, 100.0f, -100.0f, 100.0f, 0.10f);
+	grid.setTiledStorage(true);
+
+	CObservation2DRangeScan scan;
+	scan.aperture = M_2PIf;
+	scan.resizeScanAndAssign(360, 2.0f, true);
+	grid.insertObservation(&scan);
+
+	// Only the tiles around the robot are allocated:
+	const size_t nTiles =
+		((grid.getSizeX() + COccupancyGridMap2D::TILE_SIZE - 1) /
+		 COccupancyGridMap2D::TILE_SIZE) *
+		((grid.getSizeY() + COccupancyGridMap2D::TILE_SIZE - 1) /
+		 COccupancyGridMap2D::TILE_SIZE);
+	EXPECT_GT(grid.getAllocatedTilesCount(), 0u);
+	EXPECT_LE(grid.getAllocatedTilesCount(), 9u);
+	EXPECT_GT(nTiles, 1000u);
+	EXPECT_GT(grid.getPos(1.0f, 0.0f), 0.51f);
+	EXPECT_LT(grid.getPos(2.0f, 0.0f), 0.49f);
+	EXPECT_FLOAT_EQ(grid.getPos(50.0f, 50.0f), 0.5f);
+
+	// Serialization keeps the format of dense grids:
+	CMemoryStream buf;
+	buf << grid;
+	COccupancyGridMap2D dense, tiled;
+	tiled.setTiledStorage(true);
+	for (COccupancyGridMap2D* m : {&dense, &tiled})
+	{
+		buf.Seek(0);
+		buf >> *m;
+		EXPECT_EQ(m->getSizeX(), grid.getSizeX());
+		EXPECT_EQ(m->getSizeY(), grid.getSizeY());
+		checkSameCells(*m, grid);
+	}
+	EXPECT_FALSE(dense.isTiledStorage());
+	EXPECT_TRUE(tiled.isTiledStorage());
+	EXPECT_LE(tiled.getAllocatedTilesCount(), grid.getAllocatedTilesCount());
+}
+
+TEST(COccupancyGridMap2DTests, tiledStorageCopyOnWrite)
+{
+	COccupancyGridMap2D grid(-20.0f, 20.0f, -20.0f, 20.0f, 0.05f);
+	grid.setTiledStorage(true);
+	CObservation2DRangeScan scan;
+	scan.aperture = M_2PIf;
+	scan.resizeScanAndAssign(360, 8.0f, true);
+	grid.insertObservation(&scan);
+	const size_t nTiles = grid.getAllocatedTilesCount();
+	EXPECT_EQ(grid.getSharedTilesCount(), 0u);
+
+	// Copies share all the tiles:
+	COccupancyGridMap2D copy1(grid), copy2;
+	copy2 = grid;
+	EXPECT_EQ(grid.getSharedTilesCount(), nTiles);
+	EXPECT_EQ(copy1.getSharedTilesCount(), nTiles);
+
+	// Modifying a copy only duplicates the tiles it writes to:
+	COccupancyGridMap2D dense(grid);
+	dense.setTiledStorage(false);
+	copy1.setPos(1.0f, 1.0f, 0.9f);
+	copy1.setPos(-15.0f, -15.0f, 0.9f);
+	EXPECT_EQ(copy1.getAllocatedTilesCount(), nTiles + 1);
+	EXPECT_EQ(copy1.getSharedTilesCount(), nTiles - 1);
+	EXPECT_EQ(copy2.getSharedTilesCount(), nTiles);
+	EXPECT_NEAR(copy1.getPos(1.0f, 1.0f), 0.9f, 0.01f);
+	EXPECT_NEAR(copy1.getPos(-15.0f, -15.0f), 0.9f, 0.01f);
+	checkSameCells(dense, grid);
+	checkSameCells(dense, copy2);
+
+	// Inserting a scan elsewhere:
+	const CPose3D robotPose(4.0, 2.0, 0);
+	copy2.insertObservation(&scan, &robotPose);
+	checkSameCells(dense, grid);
+	EXPECT_GT(copy2.getPos(11.9f, 2.0f), 0.51f);
+	EXPECT_FLOAT_EQ(grid.getPos(11.9f, 2.0f), 0.5f);
+
+	// The original is not shared any more once the copies are gone:
+	copy1 = COccupancyGridMap2D();
+	copy2 = COccupancyGridMap2D();
+	EXPECT_EQ(grid.getSharedTilesCount(), 0u);
+}
+
+TEST(COccupancyGridMap2DTests, insertObservationsBatch)
+{
+	getRandomGenerator().randomize(1234);
+
+	// Random scans along a path which makes the grid grow several times:
+	std::vector<CObservation2DRangeScan> scans(300);
+	std::vector<TPose3D> poses;
+	for (size_t i = 0; i < scans.size(); i++)
+	{
+		CObservation2DRangeScan& scan = scans[i];
+		scan.aperture = M_PIf;
+		scan.resizeScan(181);
+		for (size_t k = 0; k < scan.scan.size(); k++)
+		{
+			scan.setScanRange(
+				k, getRandomGenerator().drawUniform(0.5f, 12.0f));
+			scan.setScanRangeValidity(k, (k % 17) != 0);
+		}
+		poses.push_back(
+			TPose3D(0.1 * i, 4 * sin(0.02 * i), 0, 0.05 * i, 0, 0));
+	}
+	std::vector<const CObservation*> obs;
+	for (const auto& s : scans) obs.push_back(&s);
+	// A non-planar scan in between, which must be skipped as usual:
+	CObservation2DRangeScan tilted = scans[0];
+	tilted.sensorPose = CPose3D(0, 0, 0, 0, DEG2RAD(10.0), 0);
+	obs.insert(obs.begin() + 100, &tilted);
+	poses.insert(poses.begin() + 100, TPose3D(0, 0, 0, 0, 0, 0));
+
+	for (const bool tiledStorage : {false, true})
+		for (const int decimation : {1, 2})
+		{
+			COccupancyGridMap2D serial(-5.0f, 5.0f, -5.0f, 5.0f, 0.05f);
+			serial.setTiledStorage(tiledStorage);
+			serial.insertionOptions.decimation = decimation;
+			size_t nSerial = 0;
+			for (size_t i = 0; i < obs.size(); i++)
+			{
+				const CPose3D p(poses[i]);
+				if (serial.insertObservation(obs[i], &p)) nSerial++;
+			}
+			EXPECT_EQ(nSerial, scans.size());
+
+			CWorkerThreadsPool pool(3);
+			for (CWorkerThreadsPool* p :
+				 {(CWorkerThreadsPool*)nullptr, &pool})
+			{
+				COccupancyGridMap2D batch(-5.0f, 5.0f, -5.0f, 5.0f, 0.05f);
+				batch.setTiledStorage(tiledStorage);
+				batch.insertionOptions.decimation = decimation;
+				EXPECT_EQ(
+					batch.insertObservationsBatch(obs, poses, p), nSerial);
+				EXPECT_FALSE(batch.isEmpty());
+
+				// Bit-identical cells:
+				EXPECT_EQ(batch.getXMin(), serial.getXMin());
+				EXPECT_EQ(batch.getYMin(), serial.getYMin());
+				COccupancyGridMap2D g1 = serial, g2 = batch;
+				g1.setTiledStorage(false);
+				g2.setTiledStorage(false);
+				EXPECT_TRUE(g1.getRawMap() == g2.getRawMap());
+			}
+		}
+}
+
+static void simulateScans(
+	const COccupancyGridMap2D& grid, const bool useDistanceField,
+	CWorkerThreadsPool* pool, const float noiseStd, const float threshold,
+	std::vector<CObservation2DRangeScan>& scans)
+{
+	COccupancyGridMap2D::RAYTRACE_USE_DISTANCE_FIELD = useDistanceField;
+	getRandomGenerator().randomize(4321);
+	scans.clear();
+	for (int k = 0; k < 12; k++)
+	{
+		CObservation2DRangeScan scan;
+		scan.aperture = M_2PIf;
+		scan.maxRange = (k % 3) ? 30.0f : 4.0f;
+		scan.sensorPose = CPose3D(0.2, 0.1, 0.3, DEG2RAD(10.0), 0, 0);
+		const double a = k * M_PI / 6;
+		grid.laserScanSimulator(
+			scan, CPose2D(2.5 * cos(a), 2.5 * sin(a), a), threshold, 541,
+			noiseStd, 1 + (k % 2), 0, pool);
+		scans.push_back(scan);
+	}
+	COccupancyGridMap2D::RAYTRACE_USE_DISTANCE_FIELD = true;
+}
+
+static void checkSameSimulatedScans(
+	const std::vector<CObservation2DRangeScan>& s1,
+	const std::vector<CObservation2DRangeScan>& s2)
+{
+	ASSERT_EQ(s1.size(), s2.size());
+	for (size_t k = 0; k < s1.size(); k++)
+	{
+		ASSERT_EQ(s1[k].getScanSize(), s2[k].getScanSize());
+		for (size_t i = 0; i < s1[k].getScanSize(); i++)
+		{
+			EXPECT_EQ(s1[k].getScanRange(i), s2[k].getScanRange(i))
+				<< "scan #" << k << " ray #" << i;
+			EXPECT_EQ(
+				s1[k].getScanRangeValidity(i), s2[k].getScanRangeValidity(i))
+				<< "scan #" << k << " ray #" << i;
+		}
+	}
+}
+
+TEST(COccupancyGridMap2DTests, laserScanSimulatorDistanceField)
+{
+	COccupancyGridMap2D grid(-10.0f, 10.0f, -10.0f, 10.0f, 0.05f);
+	insertRoomScans(grid);
+	// Some obstacles in the room, and a few cells out of it:
+	for (int i = 0; i < 40; i++) grid.setPos(-1.0f + 0.05f * i, 0.5f, 0.0f);
+	grid.setPos(1.0f, -1.0f, 0.3f);
+	grid.setPos(9.0f, 9.0f, 0.0f);
+
+	CWorkerThreadsPool pool(3);
+	std::vector<CObservation2DRangeScan> ref, scans;
+	for (const float noiseStd : {0.0f, 0.05f})
+	{
+		simulateScans(grid, false, nullptr, noiseStd, 0.6f, ref);
+		simulateScans(grid, true, nullptr, noiseStd, 0.6f, scans);
+		checkSameSimulatedScans(ref, scans);
+		simulateScans(grid, true, &pool, noiseStd, 0.6f, scans);
+		checkSameSimulatedScans(ref, scans);
+	}
+
+	// Another threshold, and changes in the map, must rebuild the field:
+	simulateScans(grid, false, nullptr, 0, 0.75f, ref);
+	simulateScans(grid, true, &pool, 0, 0.75f, scans);
+	checkSameSimulatedScans(ref, scans);
+
+	for (int i = 0; i < 40; i++) grid.setPos(-1.0f + 0.05f * i, 0.5f, 0.5f);
+	grid.setPos(-2.0f, -2.0f, 0.0f);
+	simulateScans(grid, false, nullptr, 0, 0.6f, ref);
+	simulateScans(grid, true, &pool, 0, 0.6f, scans);
+	checkSameSimulatedScans(ref, scans);
+
+	// Copies do not keep a stale field:
+	COccupancyGridMap2D copy = grid;
+	copy.setPos(-2.0f, -2.0f, 0.5f);
+	simulateScans(copy, false, nullptr, 0, 0.6f, ref);
+	simulateScans(copy, true, nullptr, 0, 0.6f, scans);
+	checkSameSimulatedScans(ref, scans);
+}
@@ -264,7 +264,7 @@ int COccupancyGridMap2D::computeClearance(
 		static_cast<unsigned>(cy) >= size_y)
 		return 0;
 
-	if (map[cx + cy * size_y] < thresholdCellValue) return 0;
+	if (cellValue(cx, cy) < thresholdCellValue) return 0;
 
 	// Truco para acelerar MUCHO:
 	//  Si miramos un punto junto al mirado antes,
@@ -350,7 +350,7 @@ int COccupancyGridMap2D::computeClearance(
 				yy < static_cast<int>(size_y))
 			{
 				// if ( getCell(xx,yy)<=voroni_free_threshold )
-				if (map[xx + yy * size_y] < thresholdCellValue)
+				if (cellValue(xx, yy) < thresholdCellValue)
 				{
 					if (!dentro_obs)
 					{
@@ -588,7 +588,7 @@ float COccupancyGridMap2D::computeClearance(
 
 	for (xx = xx1; xx <= xx2; xx++)
 		for (yy = yy1; yy <= yy2; yy++)
-			if (map[xx + yy * size_x] < thresholdCellValue)
+			if (cellValue(xx, yy) < thresholdCellValue)
 				clearance_sq =
 					min(clearance_sq, square(resolution) *
 										  (square(xx - cx) + square(yy - cy)));
@@ -12,6 +12,7 @@
 #include <mrpt/utils/CConfigFile.h>
 #include <mrpt/utils/CTicTac.h>
 #include <mrpt/utils/CTimeLogger.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
 #include <mrpt/system/os.h>
 #include <mrpt/math/geometry.h>
 #include <mrpt/utils/CStream.h>
@@ -315,263 +316,142 @@ void CPointsMap::clipOutOfRange(const TPoint2D& p, float maxRange)
 }
 
 void CPointsMap::determineMatching2D(
-	const mrpt::maps::CMetricMap* otherMap2, const CPose2D& otherMapPose_,
+	const mrpt::maps::CMetricMap* otherMap2, const CPose2D& otherMapPose,
+	TMatchingPairList& correspondences, const TMatchingParams& params,
+	TMatchingExtraResults& extraResults) const
+{
+	MRPT_START
+	ASSERT_(otherMap2->GetRuntimeClass()->derivedFrom(CLASS_ID(CPointsMap)));
+	determineMatchingBatch(
+		*static_cast<const CPointsMap*>(otherMap2), CPose3D(otherMapPose),
+		false /*2D*/, correspondences, params, extraResults);
+	MRPT_END
+}
+
+void CPointsMap::determineMatchingBatch(
+	const CPointsMap& otherMap, const CPose3D& otherMapPose, const bool is3D,
 	TMatchingPairList& correspondences, const TMatchingParams& params,
 	TMatchingExtraResults& extraResults) const
 {
 	MRPT_START
 
 	extraResults = TMatchingExtraResults();  // Clear output
+	correspondences.clear();
 
 	ASSERT_ABOVE_(params.decimation_other_map_points, 0)
 	ASSERT_BELOW_(
 		params.offset_other_map_points, params.decimation_other_map_points)
-	ASSERT_(otherMap2->GetRuntimeClass()->derivedFrom(CLASS_ID(CPointsMap)));
-	const CPointsMap* otherMap = static_cast<const CPointsMap*>(otherMap2);
-
-	const TPose2D otherMapPose(
-		otherMapPose_.x(), otherMapPose_.y(), otherMapPose_.phi());
 
-	const size_t nLocalPoints = otherMap->size();
+	const size_t nLocalPoints = otherMap.size();
 	const size_t nGlobalPoints = this->size();
-	float _sumSqrDist = 0;
-	size_t _sumSqrCount = 0;
-	size_t nOtherMapPointsWithCorrespondence =
-		0;  // Number of points with one corrs. at least
+	const size_t decim = params.decimation_other_map_points;
+	const size_t offset = params.offset_other_map_points;
 
-	float local_x_min = std::numeric_limits<float>::max(),
-		  local_x_max = -std::numeric_limits<float>::max();
-	float global_x_min = std::numeric_limits<float>::max(),
-		  global_x_max = -std::numeric_limits<float>::max();
-	float local_y_min = std::numeric_limits<float>::max(),
-		  local_y_max = -std::numeric_limits<float>::max();
-	float global_y_min = std::numeric_limits<float>::max(),
-		  global_y_max = -std::numeric_limits<float>::max();
-
-	double maxDistForCorrespondenceSquared;
-	float x_local, y_local;
-	unsigned int localIdx;
-
-	const float *x_other_it, *y_other_it,
-		*z_other_it;  // *x_global_it,*y_global_it; //,*z_global_it;
-
-	// Prepare output: no correspondences initially:
-	correspondences.clear();
-	correspondences.reserve(nLocalPoints);
-	extraResults.correspondencesRatio = 0;
-
-	TMatchingPairList _correspondences;
-	_correspondences.reserve(nLocalPoints);
-
-	// Hay mapa global?
-	if (!nGlobalPoints) return;  // No
-
-	// Hay mapa local?
-	if (!nLocalPoints) return;  // No
-
-	const double sin_phi = sin(otherMapPose.phi);
-	const double cos_phi = cos(otherMapPose.phi);
-
-// Do matching only there is any chance of the two maps to overlap:
-// -----------------------------------------------------------
-
-// Translate and rotate all local points:
-
-#if MRPT_HAS_SSE2
-	// Number of 4-floats:
-	size_t nPackets = nLocalPoints / 4;
-	if ((nLocalPoints & 0x03) != 0) nPackets++;
-
-	// Pad with zeros to make sure we have a number of points multiple of 4
-	size_t nLocalPoints_4align = nLocalPoints;
-	size_t nExtraPad = 0;
-	if (0 != (nLocalPoints & 0x03))
-	{
-		nExtraPad = 4 - (nLocalPoints & 0x03);
-		nLocalPoints_4align += nExtraPad;
-	}
-
-	Eigen::Array<float, Eigen::Dynamic, 1> x_locals(nLocalPoints_4align),
-		y_locals(nLocalPoints_4align);
-
-	// We'll assume that the real allocated memory in the source buffers at
-	// least have room for a maximum
-	//  of 3 more floats, and pad with zeroes there (yeah, fuck
-	//  correct-constness....)
-	// JLBC OCT/2016: resize() methods in maps have been modified to enforce
-	// capacities to be 4*N by design,
-	// but will leave this code here just in case (for some edge cases?)
-	if (otherMap->x.capacity() < nLocalPoints_4align ||
-		otherMap->y.capacity() < nLocalPoints_4align)
+	// Empty maps?  Nothing to do
+	if (!nGlobalPoints || nLocalPoints <= offset) return;
+
+	// Transform the local points to be matched, with SIMD instructions (via
+	// Eigen) as long as they are contiguous in memory (no decimation):
+	// --------------------------------------------------------------------
+	const size_t nQueries = (nLocalPoints - offset + decim - 1) / decim;
+	const CMatrixDouble33& R = otherMapPose.getRotationMatrix();
+	const float r00 = R(0, 0), r01 = R(0, 1), r02 = R(0, 2);
+	const float r10 = R(1, 0), r11 = R(1, 1), r12 = R(1, 2);
+	const float r20 = R(2, 0), r21 = R(2, 1), r22 = R(2, 2);
+	const float tx = otherMapPose.x(), ty = otherMapPose.y(),
+				tz = otherMapPose.z();
+
+	Eigen::ArrayXf gx, gy, gz;
+	if (decim == 1)
 	{
-		// This will happen perhaps...once in a lifetime? Anyway:
-		const_cast<vector<float>*>(&otherMap->x)
-			->reserve(nLocalPoints_4align + 16);
-		const_cast<vector<float>*>(&otherMap->y)
-			->reserve(nLocalPoints_4align + 16);
+		const Eigen::Map<const Eigen::ArrayXf> cx(&otherMap.x[0], nQueries),
+			cy(&otherMap.y[0], nQueries), cz(&otherMap.z[0], nQueries);
+		gx = r00 * cx + r01 * cy + r02 * cz + tx;
+		gy = r10 * cx + r11 * cy + r12 * cz + ty;
+		if (is3D) gz = r20 * cx + r21 * cy + r22 * cz + tz;
 	}
-
-	if (nExtraPad)
-	{
-		float* ptr_in_x = const_cast<float*>(&otherMap->x[0]);
-		float* ptr_in_y = const_cast<float*>(&otherMap->y[0]);
-		for (size_t k = nExtraPad; k; k--)
-		{
-			ptr_in_x[nLocalPoints + k] = 0;
-			ptr_in_y[nLocalPoints + k] = 0;
-		}
-	}
-
-	const __m128 cos_4val =
-		_mm_set1_ps(cos_phi);  // load 4 copies of the same value
-	const __m128 sin_4val = _mm_set1_ps(sin_phi);
-	const __m128 x0_4val = _mm_set1_ps(otherMapPose.x);
-	const __m128 y0_4val = _mm_set1_ps(otherMapPose.y);
-
-	// For the bounding box:
-	__m128 x_mins = _mm_set1_ps(std::numeric_limits<float>::max());
-	__m128 x_maxs = _mm_set1_ps(std::numeric_limits<float>::min());
-	__m128 y_mins = x_mins;
-	__m128 y_maxs = x_maxs;
-
-	const float* ptr_in_x = &otherMap->x[0];
-	const float* ptr_in_y = &otherMap->y[0];
-	float* ptr_out_x = &x_locals[0];
-	float* ptr_out_y = &y_locals[0];
-
-	for (; nPackets; nPackets--, ptr_in_x += 4, ptr_in_y += 4, ptr_out_x += 4,
-					 ptr_out_y += 4)
+	else
 	{
-		const __m128 xs = _mm_loadu_ps(ptr_in_x);  // *Unaligned* load
-		const __m128 ys = _mm_loadu_ps(ptr_in_y);
-
-		const __m128 lxs = _mm_add_ps(
-			x0_4val,
-			_mm_sub_ps(_mm_mul_ps(xs, cos_4val), _mm_mul_ps(ys, sin_4val)));
-		const __m128 lys = _mm_add_ps(
-			y0_4val,
-			_mm_add_ps(_mm_mul_ps(xs, sin_4val), _mm_mul_ps(ys, cos_4val)));
-		_mm_store_ps(ptr_out_x, lxs);
-		_mm_store_ps(ptr_out_y, lys);
-
-		x_mins = _mm_min_ps(x_mins, lxs);
-		x_maxs = _mm_max_ps(x_maxs, lxs);
-		y_mins = _mm_min_ps(y_mins, lys);
-		y_maxs = _mm_max_ps(y_maxs, lys);
+		typedef Eigen::Map<const Eigen::ArrayXf, 0, Eigen::InnerStride<>>
+			strided_map_t;
+		const Eigen::InnerStride<> stride(decim);
+		const strided_map_t lx(&otherMap.x[offset], nQueries, stride),
+			ly(&otherMap.y[offset], nQueries, stride),
+			lz(&otherMap.z[offset], nQueries, stride);
+		gx = r00 * lx + r01 * ly + r02 * lz + tx;
+		gy = r10 * lx + r11 * ly + r12 * lz + ty;
+		if (is3D) gz = r20 * lx + r21 * ly + r22 * lz + tz;
 	}
 
-	// Recover the min/max:
-	alignas(16) float temp_nums[4];
-
-	_mm_store_ps(temp_nums, x_mins);
-	local_x_min =
-		min(min(temp_nums[0], temp_nums[1]), min(temp_nums[2], temp_nums[3]));
-	_mm_store_ps(temp_nums, y_mins);
-	local_y_min =
-		min(min(temp_nums[0], temp_nums[1]), min(temp_nums[2], temp_nums[3]));
-	_mm_store_ps(temp_nums, x_maxs);
-	local_x_max =
-		max(max(temp_nums[0], temp_nums[1]), max(temp_nums[2], temp_nums[3]));
-	_mm_store_ps(temp_nums, y_maxs);
-	local_y_max =
-		max(max(temp_nums[0], temp_nums[1]), max(temp_nums[2], temp_nums[3]));
-
-#else
-	// Non SSE2 version:
-	const Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, 1>> x_org(
-		const_cast<float*>(&otherMap->x[0]), otherMap->x.size(), 1);
-	const Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, 1>> y_org(
-		const_cast<float*>(&otherMap->y[0]), otherMap->y.size(), 1);
-
-	Eigen::Array<float, Eigen::Dynamic, 1> x_locals =
-		otherMapPose.x + cos_phi * x_org.array() - sin_phi * y_org.array();
-	Eigen::Array<float, Eigen::Dynamic, 1> y_locals =
-		otherMapPose.y + sin_phi * x_org.array() + cos_phi * y_org.array();
-
-	local_x_min = x_locals.minCoeff();
-	local_y_min = y_locals.minCoeff();
-	local_x_max = x_locals.maxCoeff();
-	local_y_max = y_locals.maxCoeff();
-#endif
-
-	// Find the bounding box:
-	float global_z_min, global_z_max;
+	// Only try doing a matching if there exist any chance of both maps
+	// touching/overlaping:
+	float global_x_min, global_x_max, global_y_min, global_y_max, global_z_min,
+		global_z_max;
 	this->boundingBox(
 		global_x_min, global_x_max, global_y_min, global_y_max, global_z_min,
 		global_z_max);
-
-	// Only try doing a matching if there exist any chance of both maps
-	// touching/overlaping:
-	if (local_x_min > global_x_max || local_x_max < global_x_min ||
-		local_y_min > global_y_max || local_y_max < global_y_min)
+	if (gx.minCoeff() > global_x_max || gx.maxCoeff() < global_x_min ||
+		gy.minCoeff() > global_y_max || gy.maxCoeff() < global_y_min)
 		return;  // We know for sure there is no matching at all
 
-	// Loop for each point in local map:
-	// --------------------------------------------------
-	for (localIdx = params.offset_other_map_points,
-		x_other_it = &otherMap->x[params.offset_other_map_points],
-		y_other_it = &otherMap->y[params.offset_other_map_points],
-		z_other_it = &otherMap->z[params.offset_other_map_points];
-		 localIdx < nLocalPoints;
-		 x_other_it += params.decimation_other_map_points,
-		y_other_it += params.decimation_other_map_points,
-		z_other_it += params.decimation_other_map_points,
-		localIdx += params.decimation_other_map_points)
-	{
-		// For speed-up:
-		x_local = x_locals[localIdx];  // *x_locals_it;
-		y_local = y_locals[localIdx];  // *y_locals_it;
-
-		// Find all the matchings in the requested distance:
-
-		// KD-TREE implementation =================================
-		// Use a KD-tree to look for the nearnest neighbor of:
-		//   (x_local, y_local, z_local)
-		// In "this" (global/reference) points map.
+	// Look for the closest point of each local point with the KD-tree, into
+	// structure-of-arrays buffers, in parallel chunks if requested:
+	// --------------------------------------------------------------------
+	std::vector<uint32_t> closest_idx(nQueries);
+	std::vector<float> closest_dist_sq(nQueries);
+	auto lambdaQueries = [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++)
+			closest_idx[i] = is3D ? kdTreeClosestPoint3D(
+										gx[i], gy[i], gz[i], closest_dist_sq[i])
+								  : kdTreeClosestPoint2D(
+										gx[i], gy[i], closest_dist_sq[i]);
+	};
+	// The first query (re)builds the KD-tree, if needed, from this thread:
+	lambdaQueries(0, 1);
+	if (params.threadPool && nQueries > 1)
+		params.threadPool->parallelChunks(
+			nQueries - 1, [&](size_t first, size_t last, size_t) {
+				lambdaQueries(first + 1, last + 1);
+			});
+	else
+		lambdaQueries(1, nQueries);
 
-		float tentativ_err_sq;
-		unsigned int tentativ_this_idx = kdTreeClosestPoint2D(
-			x_local, y_local,  // Look closest to this guy
-			tentativ_err_sq  // save here the min. distance squared
-			);
+	// Keep those within the matching thresholds, in order:
+	// --------------------------------------------------------------------
+	TMatchingPairList _correspondences;
+	_correspondences.reserve(nQueries);
+	double _sumSqrDist = 0;
 
+	for (size_t i = 0; i < nQueries; i++)
+	{
 		// Compute max. allowed distance:
-		maxDistForCorrespondenceSquared = square(
-			params.maxAngularDistForCorrespondence *
-				std::sqrt(
-					square(params.angularDistPivotPoint.x - x_local) +
-					square(params.angularDistPivotPoint.y - y_local)) +
+		double distToPivot = 0;
+		if (params.maxAngularDistForCorrespondence != 0)
+			distToPivot = std::sqrt(
+				square(params.angularDistPivotPoint.x - gx[i]) +
+				square(params.angularDistPivotPoint.y - gy[i]) +
+				(is3D ? square(params.angularDistPivotPoint.z - gz[i]) : 0));
+		const double maxDistForCorrespondenceSquared = square(
+			params.maxAngularDistForCorrespondence * distToPivot +
 			params.maxDistForCorrespondence);
 
 		// Distance below the threshold??
-		if (tentativ_err_sq < maxDistForCorrespondenceSquared)
-		{
-			// Save all the correspondences:
-			_correspondences.resize(_correspondences.size() + 1);
-
-			TMatchingPair& p = _correspondences.back();
-
-			p.this_idx = tentativ_this_idx;
-			p.this_x = x[tentativ_this_idx];
-			p.this_y = y[tentativ_this_idx];
-			p.this_z = z[tentativ_this_idx];
-
-			p.other_idx = localIdx;
-			p.other_x = *x_other_it;
-			p.other_y = *y_other_it;
-			p.other_z = *z_other_it;
-
-			p.errorSquareAfterTransformation = tentativ_err_sq;
-
-			// At least one:
-			nOtherMapPointsWithCorrespondence++;
-
-			// Accumulate the MSE:
-			_sumSqrDist += p.errorSquareAfterTransformation;
-			_sumSqrCount++;
-		}
-
-	}  // For each local point
+		if (closest_dist_sq[i] >= maxDistForCorrespondenceSquared) continue;
+
+		const size_t this_idx = closest_idx[i];
+		const size_t other_idx = offset + i * decim;
+		_correspondences.push_back(
+			TMatchingPair(
+				this_idx, other_idx, x[this_idx], y[this_idx], z[this_idx],
+				otherMap.x[other_idx], otherMap.y[other_idx],
+				otherMap.z[other_idx]));
+		_correspondences.back().errorSquareAfterTransformation =
+			closest_dist_sq[i];
+
+		// Accumulate the MSE:
+		_sumSqrDist += closest_dist_sq[i];
+	}
+	const size_t nOtherMapPointsWithCorrespondence = _correspondences.size();
 
 	// Additional consistency filter: "onlyKeepTheClosest" up to now
 	//  led to just one correspondence for each "local map" point, but
@@ -591,18 +471,15 @@ void CPointsMap::determineMatching2D(
 		correspondences.swap(_correspondences);
 	}
 
-	// If requested, copy sum of squared distances to output pointer:
-	// -------------------------------------------------------------------
-	if (_sumSqrCount)
-		extraResults.sumSqrDist =
-			_sumSqrDist / static_cast<double>(_sumSqrCount);
-	else
-		extraResults.sumSqrDist = 0;
-
-	// The ratio of points in the other map with corrs:
-	extraResults.correspondencesRatio = params.decimation_other_map_points *
-										nOtherMapPointsWithCorrespondence /
-										static_cast<float>(nLocalPoints);
+	// The mean squared distance and the ratio of points in the other map
+	// with correspondences:
+	extraResults.sumSqrDist =
+		nOtherMapPointsWithCorrespondence
+			? _sumSqrDist / nOtherMapPointsWithCorrespondence
+			: 0;
+	extraResults.correspondencesRatio =
+		decim * nOtherMapPointsWithCorrespondence /
+		static_cast<float>(nLocalPoints);
 
 	MRPT_END
 }
@@ -1092,169 +969,79 @@ void CPointsMap::determineMatching3D(
 	TMatchingExtraResults& extraResults) const
 {
 	MRPT_START
-
-	extraResults = TMatchingExtraResults();
-
-	ASSERT_ABOVE_(params.decimation_other_map_points, 0)
-	ASSERT_BELOW_(
-		params.offset_other_map_points, params.decimation_other_map_points)
-
 	ASSERT_(otherMap2->GetRuntimeClass()->derivedFrom(CLASS_ID(CPointsMap)));
-	const CPointsMap* otherMap = static_cast<const CPointsMap*>(otherMap2);
-
-	const size_t nLocalPoints = otherMap->size();
-	const size_t nGlobalPoints = this->size();
-	float _sumSqrDist = 0;
-	size_t _sumSqrCount = 0;
-	size_t nOtherMapPointsWithCorrespondence =
-		0;  // Number of points with one corrs. at least
-
-	float local_x_min = std::numeric_limits<float>::max(),
-		  local_x_max = -std::numeric_limits<float>::max();
-	float local_y_min = std::numeric_limits<float>::max(),
-		  local_y_max = -std::numeric_limits<float>::max();
-	float local_z_min = std::numeric_limits<float>::max(),
-		  local_z_max = -std::numeric_limits<float>::max();
-
-	double maxDistForCorrespondenceSquared;
-
-	// Prepare output: no correspondences initially:
-	correspondences.clear();
-	correspondences.reserve(nLocalPoints);
-
-	TMatchingPairList _correspondences;
-	_correspondences.reserve(nLocalPoints);
-
-	// Empty maps?  Nothing to do
-	if (!nGlobalPoints || !nLocalPoints) return;
+	determineMatchingBatch(
+		*static_cast<const CPointsMap*>(otherMap2), otherMapPose,
+		true /*3D*/, correspondences, params, extraResults);
+	MRPT_END
+}
 
-	// Try to do matching only if the bounding boxes have some overlap:
-	// Transform all local points:
-	vector<float> x_locals(nLocalPoints), y_locals(nLocalPoints),
-		z_locals(nLocalPoints);
+/*---------------------------------------------------------------
+				Local surface estimation
+---------------------------------------------------------------*/
+const std::vector<TPoint3Df>& CPointsMap::getPointsNormals(
+	const size_t knn) const
+{
+	updateLocalPlanes(knn);
+	return m_local_planes.normals;
+}
 
-	for (unsigned int localIdx = params.offset_other_map_points;
-		 localIdx < nLocalPoints;
-		 localIdx += params.decimation_other_map_points)
-	{
-		float x_local, y_local, z_local;
-		otherMapPose.composePoint(
-			otherMap->x[localIdx], otherMap->y[localIdx], otherMap->z[localIdx],
-			x_local, y_local, z_local);
-
-		x_locals[localIdx] = x_local;
-		y_locals[localIdx] = y_local;
-		z_locals[localIdx] = z_local;
-
-		// Find the bounding box:
-		local_x_min = min(local_x_min, x_local);
-		local_x_max = max(local_x_max, x_local);
-		local_y_min = min(local_y_min, y_local);
-		local_y_max = max(local_y_max, y_local);
-		local_z_min = min(local_z_min, z_local);
-		local_z_max = max(local_z_max, z_local);
-	}
+const std::vector<CMatrixFixedNumeric<float, 3, 3>>&
+	CPointsMap::getPointsPlaneCovariances(const size_t knn) const
+{
+	updateLocalPlanes(knn);
+	return m_local_planes.covs;
+}
 
-	// Find the bounding box:
-	float global_x_min, global_x_max, global_y_min, global_y_max, global_z_min,
-		global_z_max;
-	this->boundingBox(
-		global_x_min, global_x_max, global_y_min, global_y_max, global_z_min,
-		global_z_max);
+void CPointsMap::updateLocalPlanes(const size_t knn) const
+{
+	MRPT_START
+	ASSERT_ABOVE_(knn, 0)
+	if (m_local_planes.knn == knn) return;  // Up to date
 
-	// Solo hacer matching si existe alguna posibilidad de que
-	//  los dos mapas se toquen:
-	if (local_x_min > global_x_max || local_x_max < global_x_min ||
-		local_y_min > global_y_max || local_y_max < global_y_min)
-		return;  // No need to compute: matching is ZERO.
+	// Variance along the normal in Generalized-ICP covariances
+	// (Segal et al., 2009):
+	const double GICP_EPSILON = 1e-3;
 
-	// Loop for each point in local map:
-	// --------------------------------------------------
-	for (unsigned int localIdx = params.offset_other_map_points;
-		 localIdx < nLocalPoints;
-		 localIdx += params.decimation_other_map_points)
+	const size_t N = x.size();
+	std::vector<TPoint3Df>& normals = m_local_planes.normals;
+	std::vector<CMatrixFixedNumeric<float, 3, 3>>& covs = m_local_planes.covs;
+	normals.assign(N, TPoint3Df(0, 0, 0));
+	covs.resize(N);
+
+	const size_t k = std::min(knn, N);
+	std::vector<size_t> idxs;
+	std::vector<float> dists_sq;
+	for (size_t i = 0; i < N; i++)
 	{
-		// For speed-up:
-		const float x_local = x_locals[localIdx];
-		const float y_local = y_locals[localIdx];
-		const float z_local = z_locals[localIdx];
-
+		covs[i].setIdentity();
+		if (k < 3) continue;
+		kdTreeNClosestPoint3DIdx(x[i], y[i], z[i], k, idxs, dists_sq);
+
+		// Mean and covariance of the neighborhood:
+		Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+		Eigen::Matrix3d cov = Eigen::Matrix3d::Zero();
+		for (size_t j = 0; j < k; j++)
 		{
-			// KD-TREE implementation
-			// Use a KD-tree to look for the nearnest neighbor of:
-			//   (x_local, y_local, z_local)
-			// In "this" (global/reference) points map.
-
-			float tentativ_err_sq;
-			const unsigned int tentativ_this_idx = kdTreeClosestPoint3D(
-				x_local, y_local, z_local,  // Look closest to this guy
-				tentativ_err_sq  // save here the min. distance squared
-				);
-
-			// Compute max. allowed distance:
-			maxDistForCorrespondenceSquared = square(
-				params.maxAngularDistForCorrespondence *
-					params.angularDistPivotPoint.distanceTo(
-						TPoint3D(x_local, y_local, z_local)) +
-				params.maxDistForCorrespondence);
-
-			// Distance below the threshold??
-			if (tentativ_err_sq < maxDistForCorrespondenceSquared)
-			{
-				// Save all the correspondences:
-				_correspondences.resize(_correspondences.size() + 1);
-
-				TMatchingPair& p = _correspondences.back();
-
-				p.this_idx = tentativ_this_idx;
-				p.this_x = x[tentativ_this_idx];
-				p.this_y = y[tentativ_this_idx];
-				p.this_z = z[tentativ_this_idx];
-
-				p.other_idx = localIdx;
-				p.other_x = otherMap->x[localIdx];
-				p.other_y = otherMap->y[localIdx];
-				p.other_z = otherMap->z[localIdx];
-
-				p.errorSquareAfterTransformation = tentativ_err_sq;
-
-				// At least one:
-				nOtherMapPointsWithCorrespondence++;
-
-				// Accumulate the MSE:
-				_sumSqrDist += p.errorSquareAfterTransformation;
-				_sumSqrCount++;
-			}
-
-		}  // End of test_match
-	}  // For each local point
-
-	// Additional consistency filter: "onlyKeepTheClosest" up to now
-	//  led to just one correspondence for each "local map" point, but
-	//  many of them may have as corresponding pair the same "global point"!!
-	// -------------------------------------------------------------------------
-	if (params.onlyUniqueRobust)
-	{
-		ASSERTMSG_(
-			params.onlyKeepTheClosest,
-			"ERROR: onlyKeepTheClosest must be also set to true when "
-			"onlyUniqueRobust=true.");
-		_correspondences.filterUniqueRobustPairs(
-			nGlobalPoints, correspondences);
-	}
-	else
-	{
-		correspondences.swap(_correspondences);
+			const Eigen::Vector3d p(x[idxs[j]], y[idxs[j]], z[idxs[j]]);
+			mean += p;
+			cov += p * p.transpose();
+		}
+		mean /= k;
+		cov = cov / k - mean * mean.transpose();
+
+		// The normal is the eigenvector of the smallest eigenvalue:
+		Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig;
+		eig.computeDirect(cov);
+		const Eigen::Vector3d eVals = eig.eigenvalues();  // Ascending order
+		if (eig.info() != Eigen::Success || eVals[1] <= 0) continue;
+		const Eigen::Matrix3d& R = eig.eigenvectors();
+		normals[i] = TPoint3Df(R(0, 0), R(1, 0), R(2, 0));
+
+		const Eigen::Vector3d d(GICP_EPSILON, 1, 1);
+		covs[i] = (R * d.asDiagonal() * R.transpose()).cast<float>();
 	}
-
-	// If requested, copy sum of squared distances to output pointer:
-	// -------------------------------------------------------------------
-	extraResults.sumSqrDist =
-		(_sumSqrCount) ? _sumSqrDist / static_cast<double>(_sumSqrCount) : 0;
-	extraResults.correspondencesRatio = params.decimation_other_map_points *
-										nOtherMapPointsWithCorrespondence /
-										static_cast<float>(nLocalPoints);
-
+	m_local_planes.knn = knn;
 	MRPT_END
 }
 
@@ -1474,9 +1261,6 @@ void CPointsMap::compute3DDistanceToMesh(
 double CPointsMap::internal_computeObservationLikelihood(
 	const CObservation* obs, const CPose3D& takenFrom)
 {
-	// If not, this map is standalone: Compute the likelihood:
-	double ret = 0;
-
 	// This function depends on the observation type:
 	// -----------------------------------------------------
 	if (obs->GetRuntimeClass() == CLASS_ID(CObservation2DRangeScan))
@@ -1490,82 +1274,138 @@ double CPointsMap::internal_computeObservationLikelihood(
 		// observation:
 		const CPointsMap* scanPoints = o->buildAuxPointsMap<CPointsMap>();
 
-		float sumSqrDist = 0;
+		return internal_computeScanPointsLikelihood(*scanPoints, takenFrom);
+	}
 
-		const size_t N = scanPoints->x.size();
-		if (!N || !this->size()) return -100;
+	return 0;
+}
 
-		const float* xs = &scanPoints->x[0];
-		const float* ys = &scanPoints->y[0];
-		const float* zs = &scanPoints->z[0];
+void CPointsMap::internal_computeObservationLikelihoodBatch(
+	const CObservation* obs, const std::vector<TPose3D>& takenFrom,
+	std::vector<double>& out_logliks, CWorkerThreadsPool* threadPool)
+{
+	if (obs->GetRuntimeClass() != CLASS_ID(CObservation2DRangeScan))
+	{
+		out_logliks.assign(takenFrom.size(), 0);
+		return;
+	}
 
-		float closest_x, closest_y, closest_z;
-		float closest_err;
-		const float max_sqr_err = square(likelihoodOptions.max_corr_distance);
-		int nPtsForAverage = 0;
+	// The scan is converted into points only once for all the poses:
+	const CPointsMap* scanPoints =
+		static_cast<const CObservation2DRangeScan*>(obs)
+			->buildAuxPointsMap<CPointsMap>();
 
-		if (takenFrom.isHorizontal())
-		{
-			// optimized 2D version ---------------------------
-			TPose2D takenFrom2D = TPose2D(CPose2D(takenFrom));
+	if (!scanPoints->size() || !this->size())
+	{
+		out_logliks.assign(takenFrom.size(), -100);
+		return;
+	}
 
-			const float ccos = cos(takenFrom2D.phi);
-			const float csin = sin(takenFrom2D.phi);
+	std::vector<CPose3D> poses(takenFrom.size());
+	bool any2D = false, any3D = false;
+	for (size_t i = 0; i < takenFrom.size(); i++)
+	{
+		poses[i] = CPose3D(takenFrom[i]);
+		if (poses[i].isHorizontal())
+			any2D = true;
+		else
+			any3D = true;
+	}
 
-			for (size_t i = 0; i < N;
-				 i += likelihoodOptions.decimation, nPtsForAverage++)
-			{
-				// Transform the point from the scan reference to its global 3D
-				// position:
-				const float xg = takenFrom2D.x + ccos * xs[i] - csin * ys[i];
-				const float yg = takenFrom2D.y + csin * xs[i] + ccos * ys[i];
-
-				kdTreeClosestPoint2D(
-					xg, yg,  // Look for the closest to this guy
-					closest_x, closest_y,  // save here the closest match
-					closest_err  // save here the min. distance squared
-					);
+	// Build the KD-trees before (possibly) entering into parallel threads:
+	if (any2D) kdTreeClosestPoint2DsqrError(0, 0);
+	if (any3D)
+	{
+		float dx, dy, dz, dd;
+		kdTreeClosestPoint3D(0, 0, 0, dx, dy, dz, dd);
+	}
 
-				// Put a limit:
-				mrpt::utils::keep_min(closest_err, max_sqr_err);
+	auto evalPoses = [&](size_t first, size_t last, size_t) {
+		for (size_t i = first; i < last; i++)
+			out_logliks[i] =
+				internal_computeScanPointsLikelihood(*scanPoints, poses[i]);
+	};
+	if (threadPool)
+		threadPool->parallelChunks(poses.size(), evalPoses);
+	else
+		evalPoses(0, poses.size(), 0);
+}
 
-				sumSqrDist += closest_err;
-			}
-		}
-		else
-		{
-			// Generic 3D version ---------------------------
+double CPointsMap::internal_computeScanPointsLikelihood(
+	const CPointsMap& scanPoints, const CPose3D& takenFrom) const
+{
+	float sumSqrDist = 0;
 
-			for (size_t i = 0; i < N;
-				 i += likelihoodOptions.decimation, nPtsForAverage++)
-			{
-				// Transform the point from the scan reference to its global 3D
-				// position:
-				float xg, yg, zg;
-				takenFrom.composePoint(xs[i], ys[i], zs[i], xg, yg, zg);
-
-				kdTreeClosestPoint3D(
-					xg, yg, zg,  // Look for the closest to this guy
-					closest_x, closest_y,
-					closest_z,  // save here the closest match
-					closest_err  // save here the min. distance squared
-					);
+	const size_t N = scanPoints.x.size();
+	if (!N || !this->size()) return -100;
 
-				// Put a limit:
-				mrpt::utils::keep_min(closest_err, max_sqr_err);
+	const float* xs = &scanPoints.x[0];
+	const float* ys = &scanPoints.y[0];
+	const float* zs = &scanPoints.z[0];
 
-				sumSqrDist += closest_err;
-			}
+	float closest_x, closest_y, closest_z;
+	float closest_err;
+	const float max_sqr_err = square(likelihoodOptions.max_corr_distance);
+	int nPtsForAverage = 0;
+
+	if (takenFrom.isHorizontal())
+	{
+		// optimized 2D version ---------------------------
+		TPose2D takenFrom2D = TPose2D(CPose2D(takenFrom));
+
+		const float ccos = cos(takenFrom2D.phi);
+		const float csin = sin(takenFrom2D.phi);
+
+		for (size_t i = 0; i < N;
+			 i += likelihoodOptions.decimation, nPtsForAverage++)
+		{
+			// Transform the point from the scan reference to its global 3D
+			// position:
+			const float xg = takenFrom2D.x + ccos * xs[i] - csin * ys[i];
+			const float yg = takenFrom2D.y + csin * xs[i] + ccos * ys[i];
+
+			kdTreeClosestPoint2D(
+				xg, yg,  // Look for the closest to this guy
+				closest_x, closest_y,  // save here the closest match
+				closest_err  // save here the min. distance squared
+				);
+
+			// Put a limit:
+			mrpt::utils::keep_min(closest_err, max_sqr_err);
+
+			sumSqrDist += closest_err;
 		}
+	}
+	else
+	{
+		// Generic 3D version ---------------------------
 
-		sumSqrDist /= nPtsForAverage;
+		for (size_t i = 0; i < N;
+			 i += likelihoodOptions.decimation, nPtsForAverage++)
+		{
+			// Transform the point from the scan reference to its global 3D
+			// position:
+			float xg, yg, zg;
+			takenFrom.composePoint(xs[i], ys[i], zs[i], xg, yg, zg);
+
+			kdTreeClosestPoint3D(
+				xg, yg, zg,  // Look for the closest to this guy
+				closest_x, closest_y,
+				closest_z,  // save here the closest match
+				closest_err  // save here the min. distance squared
+				);
 
-		// Log-likelihood:
-		ret = -sumSqrDist / likelihoodOptions.sigma_dist;
+			// Put a limit:
+			mrpt::utils::keep_min(closest_err, max_sqr_err);
+
+			sumSqrDist += closest_err;
+		}
 	}
 
-	return ret;
-	/**/
+	sumSqrDist /= nPtsForAverage;
+
+	// Log-likelihood:
+	return -sumSqrDist / likelihoodOptions.sigma_dist;
 }
 
 namespace mrpt
@@ -1655,19 +1495,15 @@ void CPointsMap::addFrom(const CPointsMap& anotherMap)
 
 	const size_t nTot = nThis + nOther;
 
-	this->resize(nTot);
-
-	for (size_t i = 0, j = nThis; i < nOther; i++, j++)
-	{
-		this->x[j] = anotherMap.x[i];
-		this->y[j] = anotherMap.y[i];
-		this->z[j] = anotherMap.z[i];
-	}
+	// Append the points (resize() would invalidate the whole KD-tree):
+	this->reserve(nTot);
+	for (size_t i = 0; i < nOther; i++)
+		this->insertPointFast(anotherMap.x[i], anotherMap.y[i], anotherMap.z[i]);
 
 	// Also copy other data fields (color, ...)
 	addFrom_classSpecific(anotherMap, nThis);
 
-	mark_as_modified();
+	mark_as_appended();
 }
 
 /** Save the point cloud as a PCL PCD file, in either ASCII or binary format
@@ -1741,12 +1577,11 @@ void CPointsMap::insertAnotherMap(
 	const size_t N_this = size();
 	const size_t N_other = otherMap->size();
 
-	// Set the new size:
-	this->resize(N_this + N_other);
+	// Append the points (resize() would invalidate the whole KD-tree):
+	this->reserve(N_this + N_other);
 
 	mrpt::math::TPoint3Df pt;
-	size_t src, dst;
-	for (src = 0, dst = N_this; src < N_other; src++, dst++)
+	for (size_t src = 0; src < N_other; src++)
 	{
 		// Load the next point:
 		otherMap->getPointFast(src, pt.x, pt.y, pt.z);
@@ -1756,13 +1591,13 @@ void CPointsMap::insertAnotherMap(
 		otherPose.composePoint(pt.x, pt.y, pt.z, gx, gy, gz);
 
 		// Add to this map:
-		this->setPointFast(dst, gx, gy, gz);
+		this->insertPointFast(gx, gy, gz);
 	}
 
 	// Also copy other data fields (color, ...)
 	addFrom_classSpecific(*otherMap, N_this);
 
-	mark_as_modified();
+	mark_as_appended();
 }
 
 /** Helper method for ::copyFrom() */
@@ -1816,7 +1651,9 @@ bool CPointsMap::internal_insertObservation(
 		/********************************************************************
 					OBSERVATION TYPE: CObservation2DRangeScan
 		 ********************************************************************/
-		mark_as_modified();
+		// New points are appended, unless fused with existing ones, in which
+		// case fuseWith() marks the whole map as modified:
+		mark_as_appended();
 
 		const CObservation2DRangeScan* o =
 			static_cast<const CObservation2DRangeScan*>(obs);
@@ -1908,7 +1745,7 @@ bool CPointsMap::internal_insertObservation(
 		/********************************************************************
 					OBSERVATION TYPE: CObservation3DRangeScan
 		 ********************************************************************/
-		mark_as_modified();
+		mark_as_appended();
 
 		const CObservation3DRangeScan* o =
 			static_cast<const CObservation3DRangeScan*>(obs);
@@ -1974,7 +1811,7 @@ bool CPointsMap::internal_insertObservation(
 		/********************************************************************
 					OBSERVATION TYPE: CObservationRange  (IRs, Sonars, etc.)
 		 ********************************************************************/
-		mark_as_modified();
+		mark_as_appended();
 
 		const CObservationRange* o = static_cast<const CObservationRange*>(obs);
 
@@ -2019,7 +1856,7 @@ bool CPointsMap::internal_insertObservation(
 		/********************************************************************
 					OBSERVATION TYPE: CObservationVelodyneScan
 		 ********************************************************************/
-		mark_as_modified();
+		mark_as_appended();
 
 		const CObservationVelodyneScan* o =
 			static_cast<const CObservationVelodyneScan*>(obs);
@@ -2149,6 +1986,10 @@ void CPointsMap::fuseWith(
 			if (notFusedPoints) (*notFusedPoints).push_back(false);
 		}
 	}
+
+	// Existing points may have been modified, and the KD-tree was built
+	// above by determineMatching2D():
+	mark_as_modified();
 }
 
 void CPointsMap::loadFromVelodyneScan(
@@ -2161,7 +2002,10 @@ void CPointsMap::loadFromVelodyneScan(
 
 	if (scan.point_cloud.x.empty()) return;
 
-	this->mark_as_modified();
+	if (insertionOptions.addToExistingPointsMap)
+		this->mark_as_appended();
+	else
+		this->mark_as_modified();
 
 	// Insert vs. load and replace:
 	if (!insertionOptions.addToExistingPointsMap)
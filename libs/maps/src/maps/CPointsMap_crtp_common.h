@@ -29,7 +29,10 @@ struct loadFromRangeImpl
 		using namespace mrpt::poses;
 		using mrpt::math::square;
 		using mrpt::utils::DEG2RAD;
-		obj.mark_as_modified();
+		if (obj.insertionOptions.addToExistingPointsMap)
+			obj.mark_as_appended();
+		else
+			obj.mark_as_modified();
 
 		// If robot pose is supplied, compute sensor pose relative to it.
 		CPose3D sensorPose3D(UNINITIALIZED_POSE);
@@ -374,7 +377,10 @@ struct loadFromRangeImpl
 	{
 		using namespace mrpt::poses;
 		using mrpt::math::square;
-		obj.mark_as_modified();
+		if (obj.insertionOptions.addToExistingPointsMap)
+			obj.mark_as_appended();
+		else
+			obj.mark_as_modified();
 
 		// If robot pose is supplied, compute sensor pose relative to it.
 		CPose3D sensorPose3D(UNINITIALIZED_POSE);
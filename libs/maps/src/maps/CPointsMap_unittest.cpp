@@ -11,7 +11,11 @@
 #include <mrpt/maps/CWeightedPointsMap.h>
 #include <mrpt/maps/CColouredPointsMap.h>
 #include <mrpt/poses/CPoint2D.h>
+#include <mrpt/obs/CObservation2DRangeScan.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
+#include <mrpt/random/RandomGenerators.h>
 #include <gtest/gtest.h>
+#include <limits>
 
 using namespace mrpt;
 using namespace mrpt::maps;
@@ -141,6 +145,73 @@ void do_test_clipOutOfRange()
 	}
 }
 
+template <class MAP>
+float closest_sqr_dist_brute_force(const MAP& pts, float x, float y, float z)
+{
+	float best = std::numeric_limits<float>::max();
+	for (size_t i = 0; i < pts.size(); i++)
+	{
+		float px, py, pz;
+		pts.getPoint(i, px, py, pz);
+		best = std::min(
+			best, square(px - x) + square(py - y) + square(pz - z));
+	}
+	return best;
+}
+
+template <class MAP>
+void do_test_kdtree_incremental()
+{
+	MAP pts;
+	load_demo_9pts_map(pts);
+
+	CSimplePointsMap other;
+	load_demo_9pts_map(other);
+
+	// Grow the map with queries in between, so the KD-tree is incrementally
+	// updated with the new points only:
+	for (int i = 0; i < 20; i++)
+	{
+		if (i % 2)
+			pts.insertPoint(0.5f * i, -0.3f * i, 0.1f * i);
+		else
+			pts.insertAnotherMap(&other, CPose3D(3.0 * i, 1.0, 0.5, 0, 0, 0));
+
+		for (float q = -2; q < 60; q += 3.1f)
+		{
+			float d2;
+			pts.kdTreeClosestPoint3D(q, 0.2f * q, 0.1f, d2);
+			EXPECT_NEAR(
+				d2, closest_sqr_dist_brute_force(pts, q, 0.2f * q, 0.1f), 1e-4f);
+		}
+	}
+
+	// Modifications other than appending points rebuild the tree:
+	pts.setPoint(0, 100, 100, 100);
+	float d2;
+	EXPECT_EQ(pts.kdTreeClosestPoint3D(99, 99, 99, d2), 0u);
+	pts.clipOutOfRange(TPoint2D(0, 0), 50);
+	for (float q = -2; q < 60; q += 3.1f)
+	{
+		pts.kdTreeClosestPoint3D(q, 0.2f * q, 0.1f, d2);
+		EXPECT_NEAR(
+			d2, closest_sqr_dist_brute_force(pts, q, 0.2f * q, 0.1f), 1e-4f);
+	}
+
+	// Growing with resize() and then overwriting all points, from the first
+	// one, must not leave the old ones in the tree:
+	const size_t N = pts.size();
+	pts.resize(N + 10);
+	for (size_t i = 0; i < N + 10; i++)
+		pts.setPointFast(i, -10.0f - i, 5.0f, 0.3f * i);
+	for (float q = -2; q < 60; q += 3.1f)
+	{
+		pts.kdTreeClosestPoint3D(q, 0.2f * q, 0.1f, d2);
+		EXPECT_NEAR(
+			d2, closest_sqr_dist_brute_force(pts, q, 0.2f * q, 0.1f), 1e-4f);
+	}
+}
+
 TEST(CSimplePointsMapTests, insertPoints)
 {
 	do_test_insertPoints<CSimplePointsMap>();
@@ -185,3 +256,160 @@ TEST(CColouredPointsMapTests, clipOutOfRange)
 {
 	do_test_clipOutOfRange<CColouredPointsMap>();
 }
+
+TEST(CSimplePointsMapTests, computeObservationLikelihoodBatch)
+{
+	CObservation2DRangeScan scan;
+	scan.aperture = M_2PIf;
+	scan.resizeScanAndAssign(360, 3.0f, true);
+
+	CSimplePointsMap map;
+	map.insertObservation(&scan);
+
+	// Both the 2D (horizontal) and the 3D code paths:
+	std::vector<TPose3D> poses;
+	for (int k = 0; k < 20; k++)
+		poses.push_back(
+			TPose3D(
+				0.04 * k - 0.4, 0.4 - 0.03 * k, 0, DEG2RAD(5.0 * k),
+				k % 2 ? 0.0 : DEG2RAD(1.0 * k), 0));
+
+	std::vector<double> expected(poses.size());
+	for (size_t i = 0; i < poses.size(); i++)
+		expected[i] = map.computeObservationLikelihood(&scan, CPose3D(poses[i]));
+
+	CWorkerThreadsPool pool(3);
+	for (CWorkerThreadsPool* p : {(CWorkerThreadsPool*)nullptr, &pool})
+	{
+		std::vector<double> logliks;
+		map.computeObservationLikelihoodBatch(&scan, poses, logliks, p);
+		ASSERT_EQUAL_(logliks.size(), poses.size());
+		for (size_t i = 0; i < poses.size(); i++)
+			EXPECT_NEAR(expected[i], logliks[i], 1e-9) << "pose: " << poses[i];
+	}
+}
+
+TEST(CSimplePointsMapTests, kdTreeIncremental)
+{
+	do_test_kdtree_incremental<CSimplePointsMap>();
+}
+
+TEST(CColouredPointsMapTests, kdTreeIncremental)
+{
+	do_test_kdtree_incremental<CColouredPointsMap>();
+}
+
+TEST(CSimplePointsMapTests, getPointsNormals)
+{
+	// A tilted plane (z = 0.5 x), with a few isolated points far away:
+	CSimplePointsMap map;
+	for (int i = 0; i < 20; i++)
+		for (int j = 0; j < 20; j++)
+			map.insertPoint(i * 0.1f, j * 0.1f, i * 0.05f);
+	map.insertPoint(100, 0, 0);
+	map.insertPoint(0, 100, 0);
+
+	const auto& normals = map.getPointsNormals(8);
+	const auto& covs = map.getPointsPlaneCovariances(8);
+	ASSERT_EQUAL_(normals.size(), map.size());
+	ASSERT_EQUAL_(covs.size(), map.size());
+
+	const double k = 1.0 / std::sqrt(1.25);
+	for (size_t i = 0; i < 400; i++)
+	{
+		// Normals are unit vectors, up to their sign:
+		const TPoint3Df& n = normals[i];
+		EXPECT_NEAR(std::abs(n.x * -0.5 + n.z) * k, 1.0, 1e-4);
+		EXPECT_NEAR(n.y, 0, 1e-4);
+		// The covariance is thin along the normal:
+		const Eigen::Vector3f nv(n.x, n.y, n.z);
+		EXPECT_NEAR(nv.dot(covs[i] * nv), 1e-3, 1e-5);
+	}
+
+	// Cached until the map is modified:
+	EXPECT_EQ(&normals, &map.getPointsNormals(8));
+	map.insertPoint(0, 0, 1);
+	EXPECT_EQ(map.getPointsNormals(8).size(), map.size());
+}
+
+TEST(CSimplePointsMapTests, determineMatchingInParallel)
+{
+	// Two random point clouds, partially overlapping:
+	mrpt::random::CRandomGenerator rng(1234);
+	CSimplePointsMap m1, m2;
+	for (int i = 0; i < 5000; i++)
+	{
+		m1.insertPoint(
+			rng.drawUniform(-10, 10), rng.drawUniform(-10, 10),
+			rng.drawUniform(-1, 1));
+		m2.insertPoint(
+			rng.drawUniform(-5, 15), rng.drawUniform(-10, 10),
+			rng.drawUniform(-1, 1));
+	}
+	TMatchingParams params;
+	params.maxDistForCorrespondence = 0.2f;
+	params.maxAngularDistForCorrespondence = 0.01f;
+	params.angularDistPivotPoint = TPoint3D(1, 2, 0);
+
+	CWorkerThreadsPool pool(3);
+	for (int is3D = 0; is3D < 2; is3D++)
+		for (size_t decim = 1; decim <= 3; decim++)
+		{
+			params.decimation_other_map_points = decim;
+			params.offset_other_map_points = decim - 1;
+			const CPose3D pose =
+				is3D ? CPose3D(0.1, -0.2, 0.05, 0.1, 0.02, -0.03)
+					 : CPose3D(0.1, -0.2, 0, 0.1, 0, 0);
+
+			// Brute force matching:
+			size_t nExpected = 0;
+			for (size_t j = params.offset_other_map_points; j < m2.size();
+				 j += decim)
+			{
+				float lx, ly, lz, gx, gy, gz;
+				m2.getPoint(j, lx, ly, lz);
+				pose.composePoint(lx, ly, lz, gx, gy, gz);
+				float best = std::numeric_limits<float>::max();
+				for (size_t i = 0; i < m1.size(); i++)
+				{
+					float x, y, z;
+					m1.getPoint(i, x, y, z);
+					best = std::min(
+						best, square(x - gx) + square(y - gy) +
+								  (is3D ? square(z - gz) : 0.0f));
+				}
+				const double maxDist =
+					0.2 +
+					0.01 * std::sqrt(
+							   square(1 - gx) + square(2 - gy) +
+							   (is3D ? square(gz) : 0.0f));
+				if (best < square(maxDist)) nExpected++;
+			}
+
+			TMatchingPairList corrs[2];
+			TMatchingExtraResults extra[2];
+			for (int usePool = 0; usePool < 2; usePool++)
+			{
+				params.threadPool = usePool ? &pool : nullptr;
+				if (is3D)
+					m1.determineMatching3D(
+						&m2, pose, corrs[usePool], params, extra[usePool]);
+				else
+					m1.determineMatching2D(
+						&m2, CPose2D(pose), corrs[usePool], params,
+						extra[usePool]);
+			}
+			// Allow for a few ties and round-off errors at the threshold:
+			EXPECT_NEAR(corrs[0].size(), nExpected, 2 + nExpected / 1000);
+			ASSERT_EQUAL_(corrs[0].size(), corrs[1].size());
+			for (size_t k = 0; k < corrs[0].size(); k++)
+			{
+				EXPECT_EQ(corrs[0][k].this_idx, corrs[1][k].this_idx);
+				EXPECT_EQ(corrs[0][k].other_idx, corrs[1][k].other_idx);
+				EXPECT_EQ(corrs[0][k].other_idx % decim, decim - 1);
+			}
+			EXPECT_EQ(extra[0].sumSqrDist, extra[1].sumSqrDist);
+			EXPECT_EQ(
+				extra[0].correspondencesRatio, extra[1].correspondencesRatio);
+		}
+}
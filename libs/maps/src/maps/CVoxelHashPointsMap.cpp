@@ -0,0 +1,582 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include "maps-precomp.h"  // Precomp header
+
+#include <mrpt/maps/CVoxelHashPointsMap.h>
+#include <mrpt/maps/CSimplePointsMap.h>
+#include <mrpt/obs/CObservation2DRangeScan.h>
+#include <mrpt/utils/CConfigFileBase.h>
+#include <mrpt/utils/CStream.h>
+#include <mrpt/system/os.h>
+#include <mrpt/opengl/CPointCloud.h>
+#include <algorithm>
+#include <numeric>
+
+using namespace mrpt;
+using namespace mrpt::maps;
+using namespace mrpt::math;
+using namespace mrpt::obs;
+using namespace mrpt::poses;
+using namespace mrpt::utils;
+using namespace std;
+
+//  =========== Begin of Map definition ============
+MAP_DEFINITION_REGISTER(
+	"CVoxelHashPointsMap,voxelHashPointsMap", mrpt::maps::CVoxelHashPointsMap)
+
+CVoxelHashPointsMap::TMapDefinition::TMapDefinition() : voxel_size(0.20) {}
+void CVoxelHashPointsMap::TMapDefinition::loadFromConfigFile_map_specific(
+	const mrpt::utils::CConfigFileBase& source,
+	const std::string& sectionNamePrefix)
+{
+	// [<sectionNamePrefix>+"_creationOpts"]
+	const std::string sSectCreation =
+		sectionNamePrefix + string("_creationOpts");
+	MRPT_LOAD_CONFIG_VAR(voxel_size, double, source, sSectCreation);
+
+	insertionOpts.loadFromConfigFile(
+		source, sectionNamePrefix + string("_insertOpts"));
+	likelihoodOpts.loadFromConfigFile(
+		source, sectionNamePrefix + string("_likelihoodOpts"));
+}
+
+void CVoxelHashPointsMap::TMapDefinition::dumpToTextStream_map_specific(
+	mrpt::utils::CStream& out) const
+{
+	LOADABLEOPTS_DUMP_VAR(voxel_size, double);
+
+	this->insertionOpts.dumpToTextStream(out);
+	this->likelihoodOpts.dumpToTextStream(out);
+}
+
+mrpt::maps::CMetricMap* CVoxelHashPointsMap::internal_CreateFromMapDefinition(
+	const mrpt::maps::TMetricMapInitializer& _def)
+{
+	const CVoxelHashPointsMap::TMapDefinition& def =
+		*dynamic_cast<const CVoxelHashPointsMap::TMapDefinition*>(&_def);
+	CVoxelHashPointsMap* obj = new CVoxelHashPointsMap(def.voxel_size);
+	obj->insertionOptions = def.insertionOpts;
+	obj->likelihoodOptions = def.likelihoodOpts;
+	return obj;
+}
+//  =========== End of Map definition Block =========
+
+IMPLEMENTS_SERIALIZABLE(CVoxelHashPointsMap, CMetricMap, mrpt::maps)
+
+CVoxelHashPointsMap::CVoxelHashPointsMap(double voxel_size) : m_num_points(0)
+{
+	setVoxelSize(voxel_size);
+}
+
+void CVoxelHashPointsMap::setVoxelSize(double voxel_size)
+{
+	ASSERT_ABOVE_(voxel_size, 0)
+	m_voxel_size = voxel_size;
+	m_voxel_size_inv = 1.0 / voxel_size;
+	internal_clear();
+}
+
+void CVoxelHashPointsMap::internal_clear()
+{
+	m_voxels.clear();
+	m_num_points = 0;
+}
+
+bool CVoxelHashPointsMap::isEmpty() const { return m_num_points == 0; }
+bool CVoxelHashPointsMap::insertPoint(float x, float y, float z)
+{
+	TVoxel& vox = m_voxels[voxelIndex(x, y, z)];
+	if (vox.points.size() >= insertionOptions.maxPointsPerVoxel)
+	{
+		// Don't leave empty voxels behind (only if maxPointsPerVoxel==0):
+		if (vox.points.empty()) m_voxels.erase(voxelIndex(x, y, z));
+		return false;
+	}
+
+	if (insertionOptions.minDistBetweenPoints > 0)
+	{
+		const float minDist2 = square(insertionOptions.minDistBetweenPoints);
+		for (const auto& p : vox.points)
+			if (square(p.x - x) + square(p.y - y) + square(p.z - z) < minDist2)
+				return false;
+	}
+
+	vox.points.emplace_back(x, y, z);
+	m_num_points++;
+	return true;
+}
+
+size_t CVoxelHashPointsMap::insertPointsFrom(
+	const mrpt::maps::CPointsMap& pts, const mrpt::poses::CPose3D& pose)
+{
+	const vector<float>& xs = pts.getPointsBufferRef_x();
+	const vector<float>& ys = pts.getPointsBufferRef_y();
+	const vector<float>& zs = pts.getPointsBufferRef_z();
+
+	size_t nInserted = 0;
+	for (size_t i = 0; i < xs.size(); i++)
+	{
+		float gx, gy, gz;
+		pose.composePoint(xs[i], ys[i], zs[i], gx, gy, gz);
+		if (insertPoint(gx, gy, gz)) nInserted++;
+	}
+	return nInserted;
+}
+
+void CVoxelHashPointsMap::getAllPoints(std::vector<TPoint3Df>& out_pts) const
+{
+	out_pts.clear();
+	out_pts.reserve(m_num_points);
+	for (const auto& v : m_voxels)
+		out_pts.insert(
+			out_pts.end(), v.second.points.begin(), v.second.points.end());
+}
+
+/** Calls `f(voxel)` for each existing voxel within a (Chebyshev) distance
+ * of `ring` voxels from `c`, only visiting the outer shell of the cube. */
+template <class FUNCTOR>
+static void forEachVoxelInRing(
+	const CVoxelHashPointsMap::voxel_map_t& voxels,
+	const CVoxelHashPointsMap::TVoxelIndex& c, const int ring, FUNCTOR f)
+{
+	for (int dx = -ring; dx <= ring; dx++)
+		for (int dy = -ring; dy <= ring; dy++)
+		{
+			const bool xyOnShell = (dx == -ring || dx == ring || dy == -ring ||
+									dy == ring);
+			// Inside the shell in x and y: only the two z caps are needed.
+			const int dzStep = (xyOnShell || ring == 0) ? 1 : 2 * ring;
+			for (int dz = -ring; dz <= ring; dz += dzStep)
+			{
+				const auto it = voxels.find(
+					CVoxelHashPointsMap::TVoxelIndex(
+						c.ix + dx, c.iy + dy, c.iz + dz));
+				if (it != voxels.end()) f(it->second);
+			}
+		}
+}
+
+const TPoint3Df* CVoxelHashPointsMap::internal_nn_single_search(
+	const TPoint3Df& q, float max_dist, float& out_dist_sqr) const
+{
+	const TPoint3Df* best = nullptr;
+	out_dist_sqr = square(max_dist);
+	if (m_voxels.empty()) return best;
+
+	auto checkVoxel = [&](const TVoxel& vox) {
+		for (const auto& p : vox.points)
+		{
+			const float d2 =
+				square(p.x - q.x) + square(p.y - q.y) + square(p.z - q.z);
+			if (d2 < out_dist_sqr)
+			{
+				out_dist_sqr = d2;
+				best = &p;
+			}
+		}
+	};
+
+	// Points in voxels at ring "r" are, at least, (r-1)*voxel_size away:
+	const int maxRing = static_cast<int>(max_dist * m_voxel_size_inv) + 1;
+	const double cubeVoxels = mrpt::utils::square(2.0 * maxRing + 1) *
+							  (2.0 * maxRing + 1);
+	if (cubeVoxels > m_voxels.size())
+	{
+		// Sparse map: cheaper to go through all voxels:
+		for (const auto& v : m_voxels) checkVoxel(v.second);
+		return best;
+	}
+
+	const TVoxelIndex c = voxelIndex(q.x, q.y, q.z);
+	for (int ring = 0; ring <= maxRing; ring++)
+	{
+		if (ring > 0 && square((ring - 1) * m_voxel_size) >= out_dist_sqr)
+			break;
+		forEachVoxelInRing(m_voxels, c, ring, checkVoxel);
+	}
+	return best;
+}
+
+bool CVoxelHashPointsMap::nn_single_search(
+	const TPoint3Df& query, float max_dist, TPoint3Df& out_closest,
+	float& out_dist_sqr) const
+{
+	const TPoint3Df* p = internal_nn_single_search(query, max_dist, out_dist_sqr);
+	if (!p) return false;
+	out_closest = *p;
+	return true;
+}
+
+void CVoxelHashPointsMap::nn_radius_search(
+	const TPoint3Df& q, float radius, std::vector<TPoint3Df>& out_points,
+	std::vector<float>& out_dists_sqr) const
+{
+	std::vector<TPoint3Df> pts;
+	std::vector<float> dists;
+	const float r2 = square(radius);
+	auto checkVoxel = [&](const TVoxel& vox) {
+		for (const auto& p : vox.points)
+		{
+			const float d2 =
+				square(p.x - q.x) + square(p.y - q.y) + square(p.z - q.z);
+			if (d2 < r2)
+			{
+				pts.push_back(p);
+				dists.push_back(d2);
+			}
+		}
+	};
+
+	const int maxRing = static_cast<int>(radius * m_voxel_size_inv) + 1;
+	const double cubeVoxels = mrpt::utils::square(2.0 * maxRing + 1) *
+							  (2.0 * maxRing + 1);
+	if (cubeVoxels > m_voxels.size())
+	{
+		for (const auto& v : m_voxels) checkVoxel(v.second);
+	}
+	else
+	{
+		const TVoxelIndex c = voxelIndex(q.x, q.y, q.z);
+		for (int ring = 0; ring <= maxRing; ring++)
+			forEachVoxelInRing(m_voxels, c, ring, checkVoxel);
+	}
+
+	// Sort by distance:
+	std::vector<size_t> idxs(pts.size());
+	std::iota(idxs.begin(), idxs.end(), 0);
+	std::sort(idxs.begin(), idxs.end(), [&dists](size_t a, size_t b) {
+		return dists[a] < dists[b];
+	});
+	out_points.resize(idxs.size());
+	out_dists_sqr.resize(idxs.size());
+	for (size_t i = 0; i < idxs.size(); i++)
+	{
+		out_points[i] = pts[idxs[i]];
+		out_dists_sqr[i] = dists[idxs[i]];
+	}
+}
+
+size_t CVoxelHashPointsMap::removeVoxelsFartherThan(
+	const TPoint3D& center, double max_dist)
+{
+	const double max_dist2 = square(max_dist);
+	size_t nRemoved = 0;
+	for (auto it = m_voxels.begin(); it != m_voxels.end();)
+	{
+		const double cx = (it->first.ix + 0.5) * m_voxel_size,
+					 cy = (it->first.iy + 0.5) * m_voxel_size,
+					 cz = (it->first.iz + 0.5) * m_voxel_size;
+		if (square(cx - center.x) + square(cy - center.y) +
+				square(cz - center.z) >
+			max_dist2)
+		{
+			nRemoved += it->second.points.size();
+			it = m_voxels.erase(it);
+		}
+		else
+			++it;
+	}
+	m_num_points -= nRemoved;
+	return nRemoved;
+}
+
+void CVoxelHashPointsMap::writeToStream(
+	mrpt::utils::CStream& out, int* version) const
+{
+	if (version)
+		*version = 0;
+	else
+	{
+		out << genericMapParams << m_voxel_size
+			<< insertionOptions.maxPointsPerVoxel
+			<< insertionOptions.minDistBetweenPoints;
+		likelihoodOptions.writeToStream(out);
+
+		const uint32_t n = m_num_points;
+		out << n;
+		for (const auto& v : m_voxels)
+			for (const auto& p : v.second.points) out << p.x << p.y << p.z;
+	}
+}
+
+void CVoxelHashPointsMap::readFromStream(mrpt::utils::CStream& in, int version)
+{
+	switch (version)
+	{
+		case 0:
+		{
+			double voxel_size;
+			in >> genericMapParams >> voxel_size >>
+				insertionOptions.maxPointsPerVoxel >>
+				insertionOptions.minDistBetweenPoints;
+			likelihoodOptions.readFromStream(in);
+			setVoxelSize(voxel_size);
+
+			// Points were accepted in this same per-voxel order, so inserting
+			// them again rebuilds the same voxels:
+			uint32_t n;
+			in >> n;
+			for (uint32_t i = 0; i < n; i++)
+			{
+				float x, y, z;
+				in >> x >> y >> z;
+				insertPoint(x, y, z);
+			}
+		}
+		break;
+		default:
+			MRPT_THROW_UNKNOWN_SERIALIZATION_VERSION(version)
+	};
+}
+
+bool CVoxelHashPointsMap::internal_insertObservation(
+	const CObservation* obs, const CPose3D* robotPose)
+{
+	// Reuse the conversion of all kinds of observations into points, with
+	// the downsampling being done here, at the voxel level:
+	CSimplePointsMap pts;
+	pts.insertionOptions.minDistBetweenLaserPoints = 0;
+	pts.insertionOptions.also_interpolate = false;
+	if (!pts.insertObservation(obs, robotPose)) return false;
+
+	insertPointsFrom(pts);
+	return true;
+}
+
+double CVoxelHashPointsMap::internal_computeObservationLikelihood(
+	const CObservation* obs, const CPose3D& takenFrom)
+{
+	if (obs->GetRuntimeClass() == CLASS_ID(CObservation2DRangeScan))
+	{
+		// Reuse the points map cached within the observation:
+		const CPointsMap* scanPoints =
+			static_cast<const CObservation2DRangeScan*>(obs)
+				->buildAuxPointsMap<CPointsMap>();
+		return internal_computeScanPointsLikelihood(*scanPoints, takenFrom);
+	}
+
+	// Other observations: points in the robot frame of reference.
+	CSimplePointsMap pts;
+	pts.insertionOptions.minDistBetweenLaserPoints = 0;
+	pts.insertionOptions.also_interpolate = false;
+	if (!pts.insertObservation(obs)) return 0;
+	return internal_computeScanPointsLikelihood(pts, takenFrom);
+}
+
+double CVoxelHashPointsMap::internal_computeScanPointsLikelihood(
+	const CPointsMap& scanPoints, const CPose3D& takenFrom) const
+{
+	const size_t N = scanPoints.size();
+	if (!N || isEmpty()) return -100;
+
+	const vector<float>& xs = scanPoints.getPointsBufferRef_x();
+	const vector<float>& ys = scanPoints.getPointsBufferRef_y();
+	const vector<float>& zs = scanPoints.getPointsBufferRef_z();
+
+	const float max_dist = likelihoodOptions.max_corr_distance;
+	const float max_sqr_err = square(max_dist);
+	const size_t decim = std::max<size_t>(1, likelihoodOptions.decimation);
+
+	float sumSqrDist = 0;
+	int nPtsForAverage = 0;
+	for (size_t i = 0; i < N; i += decim, nPtsForAverage++)
+	{
+		TPoint3Df g;
+		takenFrom.composePoint(xs[i], ys[i], zs[i], g.x, g.y, g.z);
+
+		float closest_err;
+		if (!internal_nn_single_search(g, max_dist, closest_err))
+			closest_err = max_sqr_err;
+		sumSqrDist += closest_err;
+	}
+	sumSqrDist /= nPtsForAverage;
+
+	// Log-likelihood:
+	return -sumSqrDist / likelihoodOptions.sigma_dist;
+}
+
+void CVoxelHashPointsMap::determineMatching3D(
+	const mrpt::maps::CMetricMap* otherMap2, const CPose3D& otherMapPose,
+	TMatchingPairList& correspondences, const TMatchingParams& params,
+	TMatchingExtraResults& extraResults) const
+{
+	MRPT_START
+
+	extraResults = TMatchingExtraResults();
+	correspondences.clear();
+
+	ASSERT_ABOVE_(params.decimation_other_map_points, 0)
+	ASSERT_BELOW_(
+		params.offset_other_map_points, params.decimation_other_map_points)
+
+	ASSERT_(otherMap2->GetRuntimeClass()->derivedFrom(CLASS_ID(CPointsMap)));
+	const CPointsMap* otherMap = static_cast<const CPointsMap*>(otherMap2);
+
+	const size_t nLocalPoints = otherMap->size();
+	if (!nLocalPoints || isEmpty()) return;
+
+	const vector<float>& xs = otherMap->getPointsBufferRef_x();
+	const vector<float>& ys = otherMap->getPointsBufferRef_y();
+	const vector<float>& zs = otherMap->getPointsBufferRef_z();
+
+	// Points in this map have no stable index: give them one, in order of
+	// appearance, which is only valid within this result:
+	std::unordered_map<const TPoint3Df*, unsigned int> thisIndices;
+
+	TMatchingPairList _correspondences;
+	_correspondences.reserve(nLocalPoints);
+	float _sumSqrDist = 0;
+	size_t nOtherMapPointsWithCorrespondence = 0;
+
+	for (size_t localIdx = params.offset_other_map_points;
+		 localIdx < nLocalPoints;
+		 localIdx += params.decimation_other_map_points)
+	{
+		TPoint3Df g;
+		otherMapPose.composePoint(
+			xs[localIdx], ys[localIdx], zs[localIdx], g.x, g.y, g.z);
+
+		// Max. allowed distance:
+		const float maxDist = params.maxAngularDistForCorrespondence *
+								  params.angularDistPivotPoint.distanceTo(
+									  TPoint3D(g.x, g.y, g.z)) +
+							  params.maxDistForCorrespondence;
+
+		float err_sq;
+		const TPoint3Df* closest = internal_nn_single_search(g, maxDist, err_sq);
+		if (!closest) continue;
+
+		const auto itIdx = thisIndices.insert(
+			std::make_pair(closest, (unsigned int)thisIndices.size()));
+
+		_correspondences.resize(_correspondences.size() + 1);
+		TMatchingPair& p = _correspondences.back();
+
+		p.this_idx = itIdx.first->second;
+		p.this_x = closest->x;
+		p.this_y = closest->y;
+		p.this_z = closest->z;
+
+		p.other_idx = localIdx;
+		p.other_x = xs[localIdx];
+		p.other_y = ys[localIdx];
+		p.other_z = zs[localIdx];
+
+		p.errorSquareAfterTransformation = err_sq;
+
+		nOtherMapPointsWithCorrespondence++;
+		_sumSqrDist += err_sq;
+	}
+
+	if (params.onlyUniqueRobust)
+	{
+		ASSERTMSG_(
+			params.onlyKeepTheClosest,
+			"ERROR: onlyKeepTheClosest must be also set to true when "
+			"onlyUniqueRobust=true.");
+		_correspondences.filterUniqueRobustPairs(
+			thisIndices.size(), correspondences);
+	}
+	else
+	{
+		correspondences.swap(_correspondences);
+	}
+
+	extraResults.sumSqrDist =
+		nOtherMapPointsWithCorrespondence
+			? _sumSqrDist /
+				  static_cast<double>(nOtherMapPointsWithCorrespondence)
+			: 0;
+	extraResults.correspondencesRatio = params.decimation_other_map_points *
+										nOtherMapPointsWithCorrespondence /
+										static_cast<float>(nLocalPoints);
+
+	MRPT_END
+}
+
+float CVoxelHashPointsMap::compute3DMatchingRatio(
+	const mrpt::maps::CMetricMap* otherMap2,
+	const mrpt::poses::CPose3D& otherMapPose,
+	const TMatchingRatioParams& mrp) const
+{
+	const CMetricMap* otherPts =
+		otherMap2->GetRuntimeClass()->derivedFrom(CLASS_ID(CPointsMap))
+			? otherMap2
+			: otherMap2->getAsSimplePointsMap();
+	if (!otherPts) return 0;
+
+	TMatchingPairList correspondences;
+	TMatchingParams params;
+	TMatchingExtraResults extraResults;
+
+	params.maxDistForCorrespondence = mrp.maxDistForCorr;
+
+	this->determineMatching3D(
+		otherPts, otherMapPose, correspondences, params, extraResults);
+
+	return extraResults.correspondencesRatio;
+}
+
+void CVoxelHashPointsMap::saveMetricMapRepresentationToFile(
+	const std::string& filNamePrefix) const
+{
+	const std::string fil = filNamePrefix + std::string(".txt");
+	FILE* f = mrpt::system::os::fopen(fil.c_str(), "wt");
+	if (!f) return;
+	for (const auto& v : m_voxels)
+		for (const auto& p : v.second.points)
+			mrpt::system::os::fprintf(f, "%f %f %f\n", p.x, p.y, p.z);
+	mrpt::system::os::fclose(f);
+}
+
+void CVoxelHashPointsMap::getAs3DObject(
+	mrpt::opengl::CSetOfObjects::Ptr& outObj) const
+{
+	if (!genericMapParams.enableSaveAs3DObject) return;
+
+	opengl::CPointCloud::Ptr obj =
+		mrpt::make_aligned_shared<opengl::CPointCloud>();
+	obj->reserve(m_num_points);
+	for (const auto& v : m_voxels)
+		for (const auto& p : v.second.points) obj->insertPoint(p.x, p.y, p.z);
+	obj->setColor(0, 0, 1);
+	obj->enableColorFromZ(true);
+	obj->setGradientColors(TColorf(0.0, 0, 0), TColorf(0, 0, 1));
+
+	outObj->insert(obj);
+}
+
+/*---------------------------------------------------------------
+					TInsertionOptions
+ ---------------------------------------------------------------*/
+CVoxelHashPointsMap::TInsertionOptions::TInsertionOptions()
+	: maxPointsPerVoxel(20), minDistBetweenPoints(0.05f)
+{
+}
+
+void CVoxelHashPointsMap::TInsertionOptions::loadFromConfigFile(
+	const mrpt::utils::CConfigFileBase& iniFile, const std::string& section)
+{
+	MRPT_LOAD_CONFIG_VAR(maxPointsPerVoxel, int, iniFile, section);
+	MRPT_LOAD_CONFIG_VAR(minDistBetweenPoints, float, iniFile, section);
+}
+
+void CVoxelHashPointsMap::TInsertionOptions::dumpToTextStream(
+	mrpt::utils::CStream& out) const
+{
+	out.printf(
+		"\n----------- [CVoxelHashPointsMap::TInsertionOptions] ------------ "
+		"\n\n");
+
+	LOADABLEOPTS_DUMP_VAR(maxPointsPerVoxel, int);
+	LOADABLEOPTS_DUMP_VAR(minDistBetweenPoints, float);
+
+	out.printf("\n");
+}
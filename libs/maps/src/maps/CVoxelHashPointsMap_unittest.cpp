@@ -0,0 +1,185 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/maps/CVoxelHashPointsMap.h>
+#include <mrpt/maps/CSimplePointsMap.h>
+#include <mrpt/maps/TMetricMapInitializer.h>
+#include <mrpt/maps/TMetricMapTypesRegistry.h>
+#include <mrpt/utils/CConfigFileMemory.h>
+#include <mrpt/random.h>
+#include <gtest/gtest.h>
+#include <limits>
+
+using namespace mrpt;
+using namespace mrpt::maps;
+using namespace mrpt::math;
+using namespace mrpt::poses;
+using namespace mrpt::random;
+using namespace mrpt::utils;
+using namespace std;
+
+static void fillRandom(CVoxelHashPointsMap& m, size_t N, float L)
+{
+	auto& rnd = getRandomGenerator();
+	for (size_t i = 0; i < N; i++)
+		m.insertPoint(
+			rnd.drawUniform(-L, L), rnd.drawUniform(-L, L),
+			rnd.drawUniform(-L, L));
+}
+
+TEST(CVoxelHashPointsMapTests, insertAndDownsample)
+{
+	CVoxelHashPointsMap m(0.5);
+	m.insertionOptions.maxPointsPerVoxel = 3;
+	m.insertionOptions.minDistBetweenPoints = 0.1f;
+
+	EXPECT_TRUE(m.isEmpty());
+	EXPECT_TRUE(m.insertPoint(0.1f, 0.1f, 0.1f));
+	// Too close to the existing one:
+	EXPECT_FALSE(m.insertPoint(0.15f, 0.1f, 0.1f));
+	EXPECT_TRUE(m.insertPoint(0.3f, 0.1f, 0.1f));
+	EXPECT_TRUE(m.insertPoint(0.3f, 0.3f, 0.1f));
+	// Voxel full:
+	EXPECT_FALSE(m.insertPoint(0.4f, 0.4f, 0.4f));
+	// Another voxel, also with negative coordinates:
+	EXPECT_TRUE(m.insertPoint(-0.1f, 0.1f, 0.1f));
+
+	EXPECT_EQ(m.size(), 4u);
+	EXPECT_EQ(m.voxelCount(), 2u);
+
+	std::vector<TPoint3Df> pts;
+	m.getAllPoints(pts);
+	EXPECT_EQ(pts.size(), 4u);
+
+	m.clear();
+	EXPECT_TRUE(m.isEmpty());
+	EXPECT_EQ(m.voxelCount(), 0u);
+}
+
+TEST(CVoxelHashPointsMapTests, nearestNeighbors)
+{
+	getRandomGenerator().randomize(1234);
+
+	CVoxelHashPointsMap m(0.25);
+	m.insertionOptions.minDistBetweenPoints = 0;
+	fillRandom(m, 5000, 5.0f);
+	std::vector<TPoint3Df> pts;
+	m.getAllPoints(pts);
+
+	for (int k = 0; k < 200; k++)
+	{
+		const TPoint3Df q(
+			getRandomGenerator().drawUniform(-6.0, 6.0),
+			getRandomGenerator().drawUniform(-6.0, 6.0),
+			getRandomGenerator().drawUniform(-6.0, 6.0));
+		const float maxDist = 0.8f, radius = 0.6f;
+
+		float bestD2 = std::numeric_limits<float>::max();
+		size_t nInRadius = 0;
+		for (const auto& p : pts)
+		{
+			const float d2 =
+				square(p.x - q.x) + square(p.y - q.y) + square(p.z - q.z);
+			bestD2 = std::min(bestD2, d2);
+			if (d2 < square(radius)) nInRadius++;
+		}
+
+		TPoint3Df closest;
+		float d2;
+		const bool found = m.nn_single_search(q, maxDist, closest, d2);
+		EXPECT_EQ(found, bestD2 < square(maxDist));
+		if (found) EXPECT_NEAR(d2, bestD2, 1e-5f);
+
+		std::vector<TPoint3Df> inRadius;
+		std::vector<float> dists;
+		m.nn_radius_search(q, radius, inRadius, dists);
+		EXPECT_EQ(inRadius.size(), nInRadius);
+		for (size_t i = 1; i < dists.size(); i++)
+			EXPECT_LE(dists[i - 1], dists[i]);
+	}
+}
+
+TEST(CVoxelHashPointsMapTests, removeFarVoxels)
+{
+	getRandomGenerator().randomize(4321);
+
+	CVoxelHashPointsMap m(0.5);
+	fillRandom(m, 3000, 10.0f);
+	const size_t N = m.size();
+
+	const TPoint3D center(2.0, 1.0, 0.0);
+	const double R = 4.0;
+	const size_t nRemoved = m.removeVoxelsFartherThan(center, R);
+	EXPECT_GT(nRemoved, 0u);
+	EXPECT_EQ(m.size(), N - nRemoved);
+
+	std::vector<TPoint3Df> pts;
+	m.getAllPoints(pts);
+	EXPECT_EQ(pts.size(), m.size());
+	// Points may be up to half the voxel diagonal away from its center:
+	const double maxDist = R + 0.5 * std::sqrt(3.0) * m.getVoxelSize();
+	for (const auto& p : pts)
+		EXPECT_LE(TPoint3D(p).distanceTo(center), maxDist + 1e-4);
+}
+
+TEST(CVoxelHashPointsMapTests, determineMatching3D)
+{
+	getRandomGenerator().randomize(111);
+
+	CSimplePointsMap local;
+	for (int i = 0; i < 500; i++)
+		local.insertPoint(
+			getRandomGenerator().drawUniform(-3.0, 3.0),
+			getRandomGenerator().drawUniform(-3.0, 3.0),
+			getRandomGenerator().drawUniform(0.0, 2.0));
+
+	const CPose3D pose(1.0, -0.5, 0.2, DEG2RAD(20.0), 0, 0);
+	CVoxelHashPointsMap m(0.3);
+	m.insertionOptions.minDistBetweenPoints = 0;
+	m.insertionOptions.maxPointsPerVoxel = 1000;
+	EXPECT_EQ(m.insertPointsFrom(local, pose), local.size());
+
+	TMatchingPairList corrs;
+	TMatchingParams params;
+	TMatchingExtraResults extra;
+	params.maxDistForCorrespondence = 0.05f;
+	m.determineMatching3D(&local, pose, corrs, params, extra);
+	EXPECT_EQ(corrs.size(), local.size());
+	EXPECT_NEAR(extra.correspondencesRatio, 1.0f, 1e-4f);
+	EXPECT_NEAR(extra.sumSqrDist, 0.0, 1e-6);
+
+	// A wrong pose gives fewer or worse pairings:
+	const CPose3D wrongPose(1.5, -0.5, 0.2, DEG2RAD(20.0), 0, 0);
+	m.determineMatching3D(&local, wrongPose, corrs, params, extra);
+	EXPECT_LT(corrs.size(), local.size());
+}
+
+TEST(CVoxelHashPointsMapTests, createFromConfigFile)
+{
+	const std::string cfg =
+		"[map]\n"
+		"voxelHashPointsMap_count=1\n"
+		"[map_voxelHashPointsMap_00_creationOpts]\n"
+		"voxel_size=0.75\n"
+		"[map_voxelHashPointsMap_00_insertOpts]\n"
+		"maxPointsPerVoxel=7\n";
+
+	TSetOfMetricMapInitializers inits;
+	inits.loadFromConfigFile(CConfigFileMemory(cfg), "map");
+	ASSERT_EQ(inits.size(), 1u);
+
+	CMetricMap* m = mrpt::maps::internal::TMetricMapTypesRegistry::Instance()
+						.factoryMapObjectFromDefinition(*inits.begin()->get());
+	ASSERT_TRUE(m != nullptr);
+	CVoxelHashPointsMap* vm = dynamic_cast<CVoxelHashPointsMap*>(m);
+	ASSERT_TRUE(vm != nullptr);
+	EXPECT_NEAR(vm->getVoxelSize(), 0.75, 1e-9);
+	EXPECT_EQ(vm->insertionOptions.maxPointsPerVoxel, 7u);
+	delete m;
+}
@@ -34,6 +34,7 @@ TEST_CLASS_MOVE_COPY_CTORS(COccupancyGridMap2D);
 TEST_CLASS_MOVE_COPY_CTORS(CSimplePointsMap);
 TEST_CLASS_MOVE_COPY_CTORS(CRandomFieldGridMap3D);
 TEST_CLASS_MOVE_COPY_CTORS(CWeightedPointsMap);
+TEST_CLASS_MOVE_COPY_CTORS(CVoxelHashPointsMap);
 
 MRPT_TODO("liboctomap doesn't work nice with move ctors...");
 // TEST_CLASS_MOVE_COPY_CTORS(COctoMap);
@@ -55,6 +56,7 @@ TEST(SerializeTestMaps, WriteReadToMem)
 		CLASS_ID(CSimplePointsMap),
 		CLASS_ID(CRandomFieldGridMap3D),
 		CLASS_ID(CWeightedPointsMap),
+		CLASS_ID(CVoxelHashPointsMap),
 		CLASS_ID(COctoMap),
 		CLASS_ID(CColouredOctoMap)};
 
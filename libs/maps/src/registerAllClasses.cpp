@@ -28,6 +28,7 @@ MRPT_INITIALIZER(registerAllClasses_mrpt_maps)
 	registerClass(CLASS_ID(CSimplePointsMap));
 	registerClass(CLASS_ID(CColouredPointsMap));
 	registerClass(CLASS_ID(CWeightedPointsMap));
+	registerClass(CLASS_ID(CVoxelHashPointsMap));
 	registerClass(CLASS_ID(COccupancyGridMap2D));
 	registerClass(CLASS_ID(CGasConcentrationGridMap2D));
 	registerClass(CLASS_ID(CWirelessPowerGridMap2D));
@@ -11,10 +11,13 @@
 
 #include <mrpt/graphs/CDirectedTree.h>
 #include <mrpt/utils/traits_map.h>
+#include <mrpt/math/KDTreeCapable.h>
 #include <mrpt/math/wrap2pi.h>
 #include <mrpt/poses/CPose2D.h>
 
 #include <mrpt/nav/tpspace/CParameterizedTrajectoryGenerator.h>
+#include <cmath>
+#include <set>
 
 namespace mrpt
 {
@@ -81,7 +84,19 @@ class TMoveTree : public mrpt::graphs::CDirectedTree<EDGE_TYPE>
 	/** A topological path up-tree */
 	typedef std::list<node_t> path_t;
 
-	/** Finds the nearest node to a given pose, using the given metric */
+	/** Finds the nearest node to a given pose, using the given metric.
+	 *
+	 * Candidate nodes are retrieved in increasing (x,y) Euclidean distance
+	 * from an incrementally-updated KD-tree, and the exact metric is only
+	 * evaluated for them, until the metric guarantees that no farther node
+	 * can be nearer than the best one found so far. The metric must thus
+	 * implement `cannotBeNearerThan(a,b,d)` as a test on `|a.x-b.x|` and
+	 * `|a.y-b.y|` only (as all metrics in this file do). Among nodes at
+	 * the same distance, the one with the lowest ID is returned.
+	 *
+	 * \return INVALID_NODEID if all nodes are in `ignored_nodes`, or if no
+	 * node is reachable (all are at std::numeric_limits<double>::max()).
+	 */
 	template <class NODE_TYPE_FOR_METRIC>
 	mrpt::utils::TNodeID getNearestNode(
 		const NODE_TYPE_FOR_METRIC& query_pt,
@@ -91,25 +106,63 @@ class TMoveTree : public mrpt::graphs::CDirectedTree<EDGE_TYPE>
 	{
 		ASSERT_(!m_nodes.empty())
 
+		const NODE_TYPE_FOR_METRIC ptTo(query_pt.state);
+		const size_t nAlive = m_nodes_index.size();
 		double min_d = std::numeric_limits<double>::max();
 		mrpt::utils::TNodeID min_id = INVALID_NODEID;
-		for (typename node_map_t::const_iterator it = m_nodes.begin();
-			 it != m_nodes.end(); ++it)
+
+		std::vector<size_t> idxs;
+		std::vector<float> dists_sq;
+		float prev_last_dist_sq = -1;
+		for (size_t knn = std::min<size_t>(16, nAlive);;
+			 knn = std::min(4 * knn, nAlive))
 		{
-			if (ignored_nodes &&
-				ignored_nodes->find(it->first) != ignored_nodes->end())
-				continue;  // ignore it
-			const NODE_TYPE_FOR_METRIC ptTo(query_pt.state);
-			const NODE_TYPE_FOR_METRIC ptFrom(it->second.state);
-			if (distanceMetricEvaluator.cannotBeNearerThan(ptFrom, ptTo, min_d))
-				continue;  // Skip the more expensive calculation of exact
-			// distance
-			double d = distanceMetricEvaluator.distance(ptFrom, ptTo);
-			if (d < min_d)
+			m_nodes_index.kdTreeNClosestPoint2DIdx(
+				query_pt.state.x, query_pt.state.y, knn, idxs, dists_sq);
+			for (size_t i = 0; i < knn; i++)
 			{
-				min_d = d;
-				min_id = it->first;
+				// Nodes strictly closer were already evaluated in the
+				// previous round. Those at the same distance are evaluated
+				// again, since their order may have changed:
+				if (dists_sq[i] < prev_last_dist_sq) continue;
+				const mrpt::utils::TNodeID id = m_nodes_index.ids[idxs[i]];
+				if (ignored_nodes &&
+					ignored_nodes->find(id) != ignored_nodes->end())
+					continue;  // ignore it
+				const NODE_TYPE_FOR_METRIC ptFrom(
+					m_nodes.find(id)->second.state);
+				if (distanceMetricEvaluator.cannotBeNearerThan(
+						ptFrom, ptTo, min_d))
+					continue;  // Skip the more expensive calculation of exact
+				// distance
+				const double d = distanceMetricEvaluator.distance(ptFrom, ptTo);
+				// (min_id is only valid once a reachable node was found, so
+				// unreachable nodes never enter the tie-break)
+				if (d < min_d ||
+					(d == min_d && min_id != INVALID_NODEID && id < min_id))
+				{
+					min_d = d;
+					min_id = id;
+				}
 			}
+			if (knn == nAlive) break;  // All nodes have been evaluated
+
+			// All remaining nodes are at a (x,y) distance >= r, so at least
+			// one of |dx|,|dy| is >= r/sqrt(2). Check whether the metric
+			// already discards such nodes, with a margin for the rounding
+			// errors of the (float) KD-tree:
+			prev_last_dist_sq = dists_sq[knn - 1];
+			const double r = std::sqrt(double(prev_last_dist_sq));
+			const double margin = 1e-5 * (1.0 + r + std::abs(ptTo.state.x) +
+										  std::abs(ptTo.state.y));
+			const double c = std::max(0.0, r * M_SQRT1_2 - margin);
+			const NODE_TYPE_FOR_METRIC ptBound(
+				mrpt::math::TPose2D(
+					ptTo.state.x + c, ptTo.state.y + c, ptTo.state.phi));
+			if (min_id != INVALID_NODEID &&
+				distanceMetricEvaluator.cannotBeNearerThan(
+					ptBound, ptTo, min_d))
+				break;
 		}
 		if (out_distance) *out_distance = min_d;
 		return min_id;
@@ -132,6 +185,7 @@ class TMoveTree : public mrpt::graphs::CDirectedTree<EDGE_TYPE>
 		m_nodes[new_child_id] = node_t(
 			new_child_id, parent_id, &edges_of_parent.back().data,
 			new_child_node_data);
+		m_nodes_index.insert(new_child_id, new_child_node_data.state);
 	}
 
 	/** Insert a node without edges (should be used only for a tree root node)
@@ -140,6 +194,7 @@ class TMoveTree : public mrpt::graphs::CDirectedTree<EDGE_TYPE>
 		const mrpt::utils::TNodeID node_id, const NODE_TYPE_DATA& node_data)
 	{
 		m_nodes[node_id] = node_t(node_id, INVALID_NODEID, NULL, node_data);
+		m_nodes_index.insert(node_id, node_data.state);
 	}
 
 	mrpt::utils::TNodeID getNextFreeNodeID() const { return m_nodes.size(); }
@@ -183,6 +238,62 @@ class TMoveTree : public mrpt::graphs::CDirectedTree<EDGE_TYPE>
 	/** Info per node */
 	node_map_t m_nodes;
 
+	/** KD-tree over the (x,y) coordinates of all nodes, for getNearestNode().
+	 * Points are only appended as nodes are inserted, so the tree is updated
+	 * incrementally. A re-inserted node ID leaves a removed point behind. */
+	struct TNodesIndex : public mrpt::math::KDTreeCapable<TNodesIndex>
+	{
+		std::vector<float> xs, ys;
+		/** The node ID of each point */
+		std::vector<mrpt::utils::TNodeID> ids;
+		/** Node ID => index of its point */
+		typename MAPS_IMPLEMENTATION::template map<mrpt::utils::TNodeID,
+												   size_t>
+			point_of_node;
+		/** Number of points not removed */
+		size_t num_alive = 0;
+
+		size_t size() const { return num_alive; }
+		void insert(
+			const mrpt::utils::TNodeID id, const mrpt::math::TPose2D& p)
+		{
+			const auto it = point_of_node.find(id);
+			if (it != point_of_node.end() && it->second < ids.size() &&
+				ids[it->second] == id && !this->kdtree_is_removed(it->second))
+			{
+				this->kdtree_mark_as_removed(it->second);
+				num_alive--;
+			}
+			point_of_node[id] = ids.size();
+			xs.push_back(p.x);
+			ys.push_back(p.y);
+			ids.push_back(id);
+			num_alive++;
+			this->kdtree_mark_as_appended();
+		}
+
+		// KDTreeCapable interface:
+		inline size_t kdtree_get_point_count() const { return xs.size(); }
+		inline float kdtree_get_pt(const size_t idx, int dim) const
+		{
+			return dim == 0 ? xs[idx] : ys[idx];
+		}
+		inline float kdtree_distance(
+			const float* p1, const size_t idx_p2, size_t size) const
+		{
+			MRPT_UNUSED_PARAM(size);
+			return mrpt::math::square(p1[0] - xs[idx_p2]) +
+				   mrpt::math::square(p1[1] - ys[idx_p2]);
+		}
+		template <typename BBOX>
+		bool kdtree_get_bbox(BBOX& bb) const
+		{
+			MRPT_UNUSED_PARAM(bb);
+			return false;
+		}
+	};
+	TNodesIndex m_nodes_index;
+
 };  // end TMoveTree
 
 /** An edge for the move tree used for planning in SE2 and TP-space */
@@ -232,8 +343,9 @@ struct PoseDistanceMetric<TNodeSE2>
 	bool cannotBeNearerThan(
 		const TNodeSE2& a, const TNodeSE2& b, const double d) const
 	{
-		if (std::abs(a.state.x - b.state.x) > d) return true;
-		if (std::abs(a.state.y - b.state.y) > d) return true;
+		// distance() is a squared distance:
+		if (mrpt::math::square(a.state.x - b.state.x) > d) return true;
+		if (mrpt::math::square(a.state.y - b.state.y) > d) return true;
 		return false;
 	}
 
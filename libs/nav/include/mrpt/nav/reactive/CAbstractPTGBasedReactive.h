@@ -17,6 +17,7 @@
 #include <mrpt/nav/reactive/TCandidateMovementPTG.h>
 #include <mrpt/nav/reactive/CMultiObjectiveMotionOptimizerBase.h>
 #include <mrpt/utils/CTimeLogger.h>
+#include <mrpt/utils/CWorkerThreadsPoolHolder.h>
 #include <mrpt/system/datetime.h>
 #include <mrpt/math/filters.h>
 #include <mrpt/math/CPolygon.h>
@@ -222,6 +223,10 @@ class CAbstractPTGBasedReactive : public CWaypointsNavigator
 		/** Max dist [meters] to use time-based path prediction for NOP
 		 * evaluation. */
 		double max_dist_for_timebased_path_prediction;
+		/** Number of threads used to evaluate the PTGs (TP-Obstacles,
+		 * holonomic method and scores) in parallel at each navigation step.
+		 * Results do not depend on this value. (Default: 1, no threads) */
+		unsigned int num_threads;
 
 		virtual void loadFromConfigFile(
 			const mrpt::utils::CConfigFileBase& c,
@@ -339,7 +344,9 @@ class CAbstractPTGBasedReactive : public CWaypointsNavigator
 	  * "out_TPObstacles" is already initialized to the proper length and
 	 * maximum collision-free distance for each "k" trajectory index.
 	  * Distances are in "pseudo-meters". They will be normalized automatically
-	 * to [0,1] upon return. */
+	 * to [0,1] upon return.
+	  * \note If `num_threads>1`, this is called concurrently for different
+	 * PTGs, so it must not modify any state shared among PTGs. */
 	virtual void STEP3_WSpaceToTPSpace(
 		const size_t ptg_idx, std::vector<double>& out_TPObstacles,
 		mrpt::nav::ClearanceDiagram& out_clearance,
@@ -371,7 +378,8 @@ class CAbstractPTGBasedReactive : public CWaypointsNavigator
 		const mrpt::nav::ClearanceDiagram& in_clearance,
 		const std::vector<mrpt::math::TPose2D>& WS_Targets,
 		const std::vector<PTGTarget>& TP_Targets,
-		CLogFileRecord::TInfoPerPTG& log, CLogFileRecord& newLogRec,
+		CLogFileRecord::TInfoPerPTG& log,
+		std::map<std::string, std::string>& log_debug_msgs,
 		const bool this_is_PTG_continuation,
 		const mrpt::math::TPose2D& relPoseVelCmd_NOP,
 		const unsigned int ptg_idx4weights,
@@ -414,12 +422,33 @@ class CAbstractPTGBasedReactive : public CWaypointsNavigator
 		std::vector<double> TP_Obstacles;
 		/** Clearance for each path */
 		ClearanceDiagram clearance;
+		/** Time [s] spent in each stage of build_movement_candidate() */
+		double timeForTPObsTransformation, timeForHolonomicMethod,
+			timeForScores;
+		/** Debug messages of build_movement_candidate(), moved into the log
+		 * record by commit_movement_candidate_log() */
+		std::map<std::string, std::string> debug_msgs;
+
+		TInfoPerPTG()
+			: timeForTPObsTransformation(.0),
+			  timeForHolonomicMethod(.0),
+			  timeForScores(.0)
+		{
+		}
 	};
 
 	/** Temporary buffers for working with each PTG during a navigationStep() */
 	std::vector<TInfoPerPTG> m_infoPerPTG;
 	mrpt::system::TTimeStamp m_infoPerPTG_timestamp;
-
+	/** Persistent worker threads to evaluate PTGs \sa
+	 * TAbstractPTGNavigatorParams::num_threads */
+	mrpt::utils::CWorkerThreadsPoolHolder m_ptg_eval_pool;
+
+	/** Builds the candidate movement for one PTG. It does not touch any
+	 * state shared among PTGs (the log record only in its `infoPerPTG` entry,
+	 * while timings and debug messages are kept in `ipf`), so it can be run
+	 * concurrently for different PTGs.
+	 * \sa commit_movement_candidate_log */
 	void build_movement_candidate(
 		CParameterizedTrajectoryGenerator* ptg, const size_t indexPTG,
 		const std::vector<mrpt::math::TPose2D>& relTargets,
@@ -430,6 +459,10 @@ class CAbstractPTGBasedReactive : public CWaypointsNavigator
 		const mrpt::system::TTimeStamp tim_start_iteration,
 		const TNavigationParams& navp = TNavigationParams(),
 		const mrpt::math::TPose2D& relPoseVelCmd_NOP = mrpt::poses::CPose2D());
+	/** Moves the timings and debug messages left by build_movement_candidate()
+	 * in `ipf` into `newLogRec` and the time logger. */
+	void commit_movement_candidate_log(
+		TInfoPerPTG& ipf, CLogFileRecord& newLogRec);
 
 	struct TSentVelCmd
 	{
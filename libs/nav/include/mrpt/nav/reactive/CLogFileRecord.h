@@ -80,6 +80,11 @@ class CLogFileRecord : public mrpt::utils::CSerializable
 	/** Known values:
 	 *	- "executionTime": The total computation time, excluding sensing.
 	 *	- "estimatedExecutionPeriod": The estimated execution period.
+	 *	- "time_PTGs_eval": Wall-clock time to evaluate all PTGs (possibly in
+	 *parallel, see TAbstractPTGNavigatorParams::num_threads).
+	 *	- "time_STEP3_WSpaceToTPSpace", "time_STEP4_HolonomicMethod",
+	 *"time_calc_move_candidate_scores": Time of each stage, summed over all
+	 *PTGs. See TInfoPerPTG for the times of each PTG.
 	 */
 	std::map<std::string, double> values;
 	/** Known values:
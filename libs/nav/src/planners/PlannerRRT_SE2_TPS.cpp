@@ -21,8 +21,6 @@ using namespace mrpt::math;
 using namespace mrpt::poses;
 using namespace std;
 
-MRPT_TODO("Optimize getNearestNode() with KD-tree!")
-
 PlannerRRT_SE2_TPS::PlannerRRT_SE2_TPS() : m_initialized(false) {}
 /** Load all params from a config file source */
 void PlannerRRT_SE2_TPS::loadConfig(
@@ -0,0 +1,205 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/nav/planners/TMoveTree.h>
+#include <mrpt/random.h>
+#include <mrpt/utils/CConfigFile.h>
+#include <mrpt/system/filesystem.h>
+#include <gtest/gtest.h>
+
+// Defined in tests/test_main.cpp
+namespace mrpt
+{
+namespace utils
+{
+extern std::string MRPT_GLOBAL_UNITTEST_SRC_DIR;
+}
+}
+
+using namespace mrpt;
+using namespace mrpt::nav;
+using namespace mrpt::math;
+using namespace mrpt::utils;
+using namespace std;
+
+// Exhaustive search, without any pruning:
+template <class TREE, class NODE>
+static double bruteForceNearestDistance(
+	const TREE& tree, const NODE& q, const PoseDistanceMetric<NODE>& metric,
+	const std::set<TNodeID>* ignored)
+{
+	double min_d = std::numeric_limits<double>::max();
+	for (const auto& n : tree.getAllNodes())
+	{
+		if (ignored && ignored->count(n.first)) continue;
+		mrpt::utils::keep_min(min_d, metric.distance(NODE(n.second.state), q));
+	}
+	return min_d;
+}
+
+static TPose2D randomPose(double L)
+{
+	auto& rnd = mrpt::random::getRandomGenerator();
+	return TPose2D(
+		rnd.drawUniform(-L, L), rnd.drawUniform(-L, L),
+		rnd.drawUniform(-M_PI, M_PI));
+}
+
+// A node whose metric is the Euclidean (x,y) distance, but only up to 1: any
+// farther node is unreachable, as nodes out of the range of a PTG.
+struct TNodeSE2_Disc : public TNodeSE2
+{
+	TNodeSE2_Disc(const TPose2D& state_) : TNodeSE2(state_) {}
+	TNodeSE2_Disc() {}
+};
+namespace mrpt
+{
+namespace nav
+{
+template <>
+struct PoseDistanceMetric<TNodeSE2_Disc>
+{
+	bool cannotBeNearerThan(
+		const TNodeSE2_Disc& a, const TNodeSE2_Disc& b, const double d) const
+	{
+		return std::abs(a.state.x - b.state.x) > d ||
+			   std::abs(a.state.y - b.state.y) > d;
+	}
+	double distance(const TNodeSE2_Disc& a, const TNodeSE2_Disc& b) const
+	{
+		const double d =
+			std::hypot(a.state.x - b.state.x, a.state.y - b.state.y);
+		return d <= 1.0 ? d : std::numeric_limits<double>::max();
+	}
+};
+}
+}
+
+// Grows a tree RRT-style, checking getNearestNode() against an exhaustive
+// search after each insertion:
+template <class NODE>
+static void testNearestNode(
+	const PoseDistanceMetric<NODE>& metric, const double L,
+	const size_t nNodes)
+{
+	mrpt::random::getRandomGenerator().randomize(1234);
+
+	TMoveTree<NODE, TMoveEdgeSE2_TP> tree;
+	tree.insertNode(0, NODE(TPose2D(0, 0, 0)));
+	std::set<TNodeID> ignored;
+	for (size_t i = 1; i < nNodes; i++)
+	{
+		const NODE q(randomPose(L));
+		const std::set<TNodeID>* ign = (i % 3 == 0) ? &ignored : nullptr;
+
+		double d;
+		const TNodeID id = tree.getNearestNode(q, metric, &d, ign);
+		EXPECT_EQ(d, bruteForceNearestDistance(tree, q, metric, ign))
+			<< "nodes: " << i;
+		if (d == std::numeric_limits<double>::max())
+		{
+			// No node is reachable:
+			EXPECT_EQ(id, INVALID_NODEID) << "nodes: " << i;
+			continue;
+		}
+		ASSERT_NE(id, INVALID_NODEID);
+		EXPECT_FALSE(ign && ign->count(id));
+		EXPECT_EQ(
+			metric.distance(NODE(tree.getAllNodes().find(id)->second.state), q),
+			d);
+
+		const TNodeID new_id = tree.getNextFreeNodeID();
+		tree.insertNodeAndEdge(
+			id, new_id, q, TMoveEdgeSE2_TP(id, q.state));
+		if (i % 7 == 0) ignored.insert(new_id);
+	}
+
+	// All nodes ignored:
+	std::set<TNodeID> all;
+	for (const auto& n : tree.getAllNodes()) all.insert(n.first);
+	EXPECT_EQ(
+		tree.getNearestNode(NODE(TPose2D(0, 0, 0)), metric, nullptr, &all),
+		INVALID_NODEID);
+}
+
+TEST(NavTests, TMoveTree_getNearestNode_SE2)
+{
+	// Squared distances both below and above 1:
+	testNearestNode(PoseDistanceMetric<TNodeSE2>(), 1.0, 1000);
+	testNearestNode(PoseDistanceMetric<TNodeSE2>(), 20.0, 1000);
+}
+
+TEST(NavTests, TMoveTree_getNearestNode_SE2_TP)
+{
+	const string sFil = MRPT_GLOBAL_UNITTEST_SRC_DIR +
+						string("/tests/PTGs_for_tests.ini");
+	if (!mrpt::system::fileExists(sFil))
+	{
+		cerr << "**WARNING* Skipping tests since file cannot be found: '"
+			 << sFil << "'\n";
+		return;
+	}
+	mrpt::utils::CConfigFile cfg(sFil);
+
+	// A holonomic and a diff-driven PTG:
+	for (unsigned int n : {0, 2})
+	{
+		CParameterizedTrajectoryGenerator::Ptr ptg(
+			CParameterizedTrajectoryGenerator::CreatePTG(
+				cfg.read_string(
+					"PTG_UNIT_TESTS", format("PTG%u_Type", n), "", true),
+				cfg, "PTG_UNIT_TESTS", format("PTG%u_", n)));
+		ASSERT_TRUE(ptg);
+		ptg->initialize(string(), false /*verbose */);
+		testNearestNode(
+			PoseDistanceMetric<TNodeSE2_TP>(*ptg), ptg->getRefDistance(),
+			500);
+	}
+}
+
+TEST(NavTests, TMoveTree_getNearestNode_unreachable)
+{
+	const PoseDistanceMetric<TNodeSE2_Disc> metric;
+	testNearestNode(metric, 3.0, 500);
+
+	TMoveTree<TNodeSE2_Disc, TMoveEdgeSE2_TP> tree;
+	for (TNodeID i = 0; i < 50; i++)
+		tree.insertNode(i, TNodeSE2_Disc(TPose2D(0.1 * i, 0, 0)));
+
+	// No node is reachable:
+	double d = 0;
+	EXPECT_EQ(
+		tree.getNearestNode(TNodeSE2_Disc(TPose2D(20, 0, 0)), metric, &d),
+		INVALID_NODEID);
+	EXPECT_EQ(d, std::numeric_limits<double>::max());
+
+	// Only the last nodes are reachable:
+	EXPECT_EQ(
+		tree.getNearestNode(TNodeSE2_Disc(TPose2D(5.5, 0, 0)), metric, &d),
+		49u);
+	EXPECT_NEAR(d, 0.6, 1e-9);
+}
+
+TEST(NavTests, TMoveTree_reinsertNode)
+{
+	TMoveTree<TNodeSE2, TMoveEdgeSE2_TP> tree;
+	const PoseDistanceMetric<TNodeSE2> metric;
+	for (TNodeID i = 0; i < 100; i++)
+		tree.insertNode(i, TNodeSE2(TPose2D(i, 0, 0)));
+	EXPECT_EQ(tree.getNearestNode(TNodeSE2(TPose2D(50, 0, 0)), metric), 50u);
+
+	// Moving a node away must not leave its old position behind:
+	tree.insertNode(50, TNodeSE2(TPose2D(50, 1000, 0)));
+	double d;
+	const TNodeID id =
+		tree.getNearestNode(TNodeSE2(TPose2D(50, 0, 0)), metric, &d);
+	EXPECT_EQ(id, 49u);  // Ties go to the lowest ID
+	EXPECT_DOUBLE_EQ(d, 1.0);
+	EXPECT_EQ(tree.getNearestNode(TNodeSE2(TPose2D(50, 990, 0)), metric), 50u);
+}
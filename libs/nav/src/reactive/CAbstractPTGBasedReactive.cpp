@@ -18,6 +18,7 @@
 #include <mrpt/utils/metaprogramming.h>
 #include <mrpt/utils/CFileGZOutputStream.h>
 #include <mrpt/utils/CMemoryStream.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
 #include <mrpt/maps/CPointCloudFilterByDistance.h>
 #include <limits>
 #include <iomanip>
@@ -511,26 +512,48 @@ void CAbstractPTGBasedReactive::performNavigationStep()
 			nPTGs + 1);  // the last extra one is for the evaluation of "NOP
 		// motion command" choice.
 
-		for (size_t indexPTG = 0; indexPTG < nPTGs; indexPTG++)
-		{
-			CParameterizedTrajectoryGenerator* ptg = getPTG(indexPTG);
-			TInfoPerPTG& ipf = m_infoPerPTG[indexPTG];
+		// Evaluate all PTGs, possibly in parallel: each one only writes into
+		// its own entries of m_infoPerPTG[], candidate_movs[] and
+		// newLogRec.infoPerPTG[], so results do not depend on the number of
+		// threads nor their scheduling.
+		ASSERT_(m_navigationParams);
+		mrpt::utils::CWorkerThreadsPool* pool =
+			nPTGs > 1 ? m_ptg_eval_pool.get(
+							params_abstract_ptg_navigator.num_threads)
+					  : nullptr;
+
+		const auto eval_PTGs = [&](size_t first, size_t last, size_t) {
+			for (size_t indexPTG = first; indexPTG < last; indexPTG++)
+			{
+				CParameterizedTrajectoryGenerator* ptg = getPTG(indexPTG);
+				TInfoPerPTG& ipf = m_infoPerPTG[indexPTG];
 
-			// Ensure the method knows about its associated PTG:
-			m_holonomicMethod[indexPTG]->setAssociatedPTG(
-				this->getPTG(indexPTG));
+				// Ensure the method knows about its associated PTG:
+				m_holonomicMethod[indexPTG]->setAssociatedPTG(ptg);
 
-			// The picked movement in TP-Space (to be determined by holonomic
-			// method below)
-			TCandidateMovementPTG& cm = candidate_movs[indexPTG];
+				// The picked movement in TP-Space (to be determined by
+				// holonomic method below)
+				TCandidateMovementPTG& cm = candidate_movs[indexPTG];
 
-			ASSERT_(m_navigationParams);
-			build_movement_candidate(
-				ptg, indexPTG, relTargets, rel_pose_PTG_origin_wrt_sense, ipf,
-				cm, newLogRec, false /* this is a regular PTG reactive case */,
-				*m_holonomicMethod[indexPTG], tim_start_iteration,
-				*m_navigationParams);
-		}  // end for each PTG
+				build_movement_candidate(
+					ptg, indexPTG, relTargets, rel_pose_PTG_origin_wrt_sense,
+					ipf, cm, newLogRec,
+					false /* this is a regular PTG reactive case */,
+					*m_holonomicMethod[indexPTG], tim_start_iteration,
+					*m_navigationParams);
+			}
+		};
+
+		tictac.Tic();
+		if (pool)
+			pool->parallelChunks(nPTGs, eval_PTGs);
+		else
+			eval_PTGs(0, nPTGs, 0);
+		newLogRec.values["time_PTGs_eval"] = tictac.Tac();
+
+		// Back in this thread, in PTG order:
+		for (size_t indexPTG = 0; indexPTG < nPTGs; indexPTG++)
+			commit_movement_candidate_log(m_infoPerPTG[indexPTG], newLogRec);
 
 		// check for collision, which is reflected by ALL TP-Obstacles being
 		// zero:
@@ -685,6 +708,7 @@ void CAbstractPTGBasedReactive::performNavigationStep()
 					*m_holonomicMethod[m_lastSentVelCmd.ptg_index],
 					tim_start_iteration, *m_navigationParams,
 					rel_cur_pose_wrt_last_vel_cmd_NOP);
+				commit_movement_candidate_log(m_infoPerPTG[nPTGs], newLogRec);
 
 			}  // end valid interpolated origin pose
 			else
@@ -989,7 +1013,8 @@ void CAbstractPTGBasedReactive::calc_move_candidate_scores(
 	const mrpt::nav::ClearanceDiagram& in_clearance,
 	const std::vector<mrpt::math::TPose2D>& WS_Targets,
 	const std::vector<CAbstractPTGBasedReactive::PTGTarget>& TP_Targets,
-	CLogFileRecord::TInfoPerPTG& log, CLogFileRecord& newLogRec,
+	CLogFileRecord::TInfoPerPTG& log,
+	std::map<std::string, std::string>& log_debug_msgs,
 	const bool this_is_PTG_continuation,
 	const mrpt::math::TPose2D& rel_cur_pose_wrt_last_vel_cmd_NOP,
 	const unsigned int ptg_idx4weights,
@@ -1066,7 +1091,7 @@ void CAbstractPTGBasedReactive::calc_move_candidate_scores(
 			Vf + target_WS_d * (1.0 - Vf) / TARGET_SLOW_APPROACHING_DISTANCE);
 		if (f < cm.speed)
 		{
-			newLogRec.additional_debug_msgs["PTG_eval.speed"] = mrpt::format(
+			log_debug_msgs["PTG_eval.speed"] = mrpt::format(
 				"Relative speed reduced %.03f->%.03f based on Euclidean "
 				"nearness to target.",
 				cm.speed, f);
@@ -1140,8 +1165,7 @@ void CAbstractPTGBasedReactive::calc_move_candidate_scores(
 				m_lastSentVelCmd.speed_scale *
 				mrpt::system::timeDifference(
 					m_lastSentVelCmd.tim_send_cmd_vel, tim_start_iteration);
-			newLogRec.additional_debug_msgs["PTG_eval.NOP_At"] =
-				mrpt::format("%.06f s", NOP_At);
+			log_debug_msgs["PTG_eval.NOP_At"] = mrpt::format("%.06f s", NOP_At);
 			cur_k = move_k;
 			cur_ptg_step =
 				mrpt::utils::round(NOP_At / cm.PTG->getPathStepDuration());
@@ -1161,7 +1185,7 @@ void CAbstractPTGBasedReactive::calc_move_candidate_scores(
 			// Don't trust this step: we are not 100% sure of the robot pose in
 			// TP-Space for this "PTG continuation" step:
 			cm.speed = -0.01;  // this enforces a 0 global evaluation score
-			newLogRec.additional_debug_msgs["PTG_eval"] =
+			log_debug_msgs["PTG_eval"] =
 				"PTG-continuation not allowed, cur. pose out of PTG domain.";
 			return;
 		}
@@ -1183,10 +1207,9 @@ void CAbstractPTGBasedReactive::calc_move_candidate_scores(
 				WS_point_is_unique =
 					WS_point_is_unique &&
 					cm.PTG->isBijectiveAt(move_k, predicted_step);
-				newLogRec.additional_debug_msgs["PTG_eval.bijective"] =
-					mrpt::format(
-						"isBijectiveAt(): k=%i step=%i -> %s", (int)cur_k,
-						(int)cur_ptg_step, WS_point_is_unique ? "yes" : "no");
+				log_debug_msgs["PTG_eval.bijective"] = mrpt::format(
+					"isBijectiveAt(): k=%i step=%i -> %s", (int)cur_k,
+					(int)cur_ptg_step, WS_point_is_unique ? "yes" : "no");
 
 				if (!WS_point_is_unique)
 				{
@@ -1212,11 +1235,10 @@ void CAbstractPTGBasedReactive::calc_move_candidate_scores(
 				const double predicted2real_dist = mrpt::math::hypot_fast(
 					predicted_pose_global.x - m_curPoseVel.rawOdometry.x,
 					predicted_pose_global.y - m_curPoseVel.rawOdometry.y);
-				newLogRec.additional_debug_msgs["PTG_eval.lastCmdPose(raw)"] =
+				log_debug_msgs["PTG_eval.lastCmdPose(raw)"] =
 					m_lastSentVelCmd.poseVel.pose.asString();
-				newLogRec.additional_debug_msgs["PTG_eval.PTGcont"] =
-					mrpt::format(
-						"mismatchDistance=%.03f cm", 1e2 * predicted2real_dist);
+				log_debug_msgs["PTG_eval.PTGcont"] = mrpt::format(
+					"mismatchDistance=%.03f cm", 1e2 * predicted2real_dist);
 
 				if (predicted2real_dist >
 						params_abstract_ptg_navigator
@@ -1226,7 +1248,7 @@ void CAbstractPTGBasedReactive::calc_move_candidate_scores(
 				{
 					cm.speed =
 						-0.01;  // this enforces a 0 global evaluation score
-					newLogRec.additional_debug_msgs["PTG_eval"] =
+					log_debug_msgs["PTG_eval"] =
 						"PTG-continuation not allowed, mismatchDistance above "
 						"threshold.";
 					return;
@@ -1235,7 +1257,7 @@ void CAbstractPTGBasedReactive::calc_move_candidate_scores(
 			else
 			{
 				cm.speed = -0.01;  // this enforces a 0 global evaluation score
-				newLogRec.additional_debug_msgs["PTG_eval"] =
+				log_debug_msgs["PTG_eval"] =
 					"PTG-continuation not allowed, couldn't get PTG step for "
 					"cur. robot pose.";
 				return;
@@ -1525,6 +1547,9 @@ void CAbstractPTGBasedReactive::build_movement_candidate(
 	CHolonomicLogFileRecord::Ptr HLFR;
 	cm.PTG = ptg;
 
+	// Not the member `tictac`: this may run concurrently for several PTGs
+	mrpt::utils::CTicTac tictac_ptg;
+
 	// If the user doesn't want to use this PTG, just mark it as invalid:
 	ipf.targets.clear();
 	bool use_this_ptg = true;
@@ -1543,7 +1568,9 @@ void CAbstractPTGBasedReactive::build_movement_candidate(
 		}
 	}
 
-	double timeForTPObsTransformation = .0, timeForHolonomicMethod = .0;
+	ipf.timeForTPObsTransformation = .0;
+	ipf.timeForHolonomicMethod = .0;
+	ipf.timeForScores = .0;
 
 	// Normal PTG validity filter: check if target falls into the PTG domain:
 	bool any_TPTarget_is_valid = false;
@@ -1571,7 +1598,7 @@ void CAbstractPTGBasedReactive::build_movement_candidate(
 
 	if (!any_TPTarget_is_valid)
 	{
-		newLogRec.additional_debug_msgs[mrpt::format(
+		ipf.debug_msgs[mrpt::format(
 			"mov_candidate_%u", static_cast<unsigned int>(indexPTG))] =
 			"PTG discarded since target(s) is(are) out of domain.";
 	}
@@ -1580,7 +1607,7 @@ void CAbstractPTGBasedReactive::build_movement_candidate(
 		//  STEP3(b): Build TP-Obstacles
 		// -----------------------------------------------------------------------------
 		{
-			tictac.Tic();
+			tictac_ptg.Tic();
 
 			// Initialize TP-Obstacles:
 			const size_t Ki = ptg->getAlphaValuesCount();
@@ -1605,18 +1632,14 @@ void CAbstractPTGBasedReactive::build_movement_candidate(
 			const double _refD = 1.0 / ptg->getRefDistance();
 			for (size_t i = 0; i < Ki; i++) ipf.TP_Obstacles[i] *= _refD;
 
-			timeForTPObsTransformation = tictac.Tac();
-			if (m_timelogger.isEnabled())
-				m_timelogger.registerUserMeasure(
-					"navigationStep.STEP3_WSpaceToTPSpace",
-					timeForTPObsTransformation);
+			ipf.timeForTPObsTransformation = tictac_ptg.Tac();
 		}
 
 		//  STEP4: Holonomic navigation method
 		// -----------------------------------------------------------------------------
 		if (!this_is_PTG_continuation)
 		{
-			tictac.Tic();
+			tictac_ptg.Tic();
 
 			// Slow down if we are approaching the final target, etc.
 			holoMethod.enableApproachTargetSlowDown(
@@ -1683,11 +1706,7 @@ void CAbstractPTGBasedReactive::build_movement_candidate(
 			// Scale:
 			cm.speed *= velScale;
 
-			timeForHolonomicMethod = tictac.Tac();
-			if (m_timelogger.isEnabled())
-				m_timelogger.registerUserMeasure(
-					"navigationStep.STEP4_HolonomicMethod",
-					timeForHolonomicMethod);
+			ipf.timeForHolonomicMethod = tictac_ptg.Tac();
 		}
 		else
 		{
@@ -1700,12 +1719,11 @@ void CAbstractPTGBasedReactive::build_movement_candidate(
 		// STEP5: Evaluate each movement to assign them a "evaluation" value.
 		// ---------------------------------------------------------------------
 		{
-			CTimeLoggerEntry tle(
-				m_timelogger, "navigationStep.calc_move_candidate_scores");
+			tictac_ptg.Tic();
 
 			calc_move_candidate_scores(
 				cm, ipf.TP_Obstacles, ipf.clearance, relTargets, ipf.targets,
-				newLogRec.infoPerPTG[idx_in_log_infoPerPTGs], newLogRec,
+				newLogRec.infoPerPTG[idx_in_log_infoPerPTGs], ipf.debug_msgs,
 				this_is_PTG_continuation, rel_cur_pose_wrt_last_vel_cmd_NOP,
 				indexPTG, tim_start_iteration);
 
@@ -1716,6 +1734,8 @@ void CAbstractPTGBasedReactive::build_movement_candidate(
 
 			//  SAVE LOG
 			newLogRec.infoPerPTG[idx_in_log_infoPerPTGs].evalFactors = cm.props;
+
+			ipf.timeForScores = tictac_ptg.Tac();
 		}
 
 	}  // end "valid_TP"
@@ -1745,8 +1765,39 @@ void CAbstractPTGBasedReactive::build_movement_candidate(
 		ipp.HLFR = HLFR;
 		ipp.desiredDirection = cm.direction;
 		ipp.desiredSpeed = cm.speed;
-		ipp.timeForTPObsTransformation = timeForTPObsTransformation;
-		ipp.timeForHolonomicMethod = timeForHolonomicMethod;
+		ipp.timeForTPObsTransformation = ipf.timeForTPObsTransformation;
+		ipp.timeForHolonomicMethod = ipf.timeForHolonomicMethod;
+	}
+}
+
+void CAbstractPTGBasedReactive::commit_movement_candidate_log(
+	TInfoPerPTG& ipf, CLogFileRecord& newLogRec)
+{
+	for (auto& m : ipf.debug_msgs)
+		newLogRec.additional_debug_msgs[m.first] = std::move(m.second);
+	ipf.debug_msgs.clear();
+
+	newLogRec.values["time_STEP3_WSpaceToTPSpace"] +=
+		ipf.timeForTPObsTransformation;
+	newLogRec.values["time_STEP4_HolonomicMethod"] +=
+		ipf.timeForHolonomicMethod;
+	newLogRec.values["time_calc_move_candidate_scores"] += ipf.timeForScores;
+
+	// Only for the stages actually run:
+	if (m_timelogger.isEnabled())
+	{
+		if (ipf.timeForTPObsTransformation > 0)
+			m_timelogger.registerUserMeasure(
+				"navigationStep.STEP3_WSpaceToTPSpace",
+				ipf.timeForTPObsTransformation);
+		if (ipf.timeForHolonomicMethod > 0)
+			m_timelogger.registerUserMeasure(
+				"navigationStep.STEP4_HolonomicMethod",
+				ipf.timeForHolonomicMethod);
+		if (ipf.timeForScores > 0)
+			m_timelogger.registerUserMeasure(
+				"navigationStep.calc_move_candidate_scores",
+				ipf.timeForScores);
 	}
 }
 
@@ -1770,6 +1821,7 @@ void CAbstractPTGBasedReactive::TAbstractPTGNavigatorParams::loadFromConfigFile(
 	MRPT_LOAD_CONFIG_VAR_CS(enable_obstacle_filtering, bool);
 	MRPT_LOAD_CONFIG_VAR_CS(evaluate_clearance, bool);
 	MRPT_LOAD_CONFIG_VAR_CS(max_dist_for_timebased_path_prediction, double);
+	MRPT_LOAD_CONFIG_VAR_CS(num_threads, int);
 
 	MRPT_END;
 }
@@ -1847,6 +1899,9 @@ void CAbstractPTGBasedReactive::TAbstractPTGNavigatorParams::saveToConfigFile(
 		max_dist_for_timebased_path_prediction,
 		"Max dist [meters] to use time-based path prediction for NOP "
 		"evaluation");
+	MRPT_SAVE_CONFIG_VAR_COMMENT(
+		num_threads,
+		"Number of threads to evaluate PTGs in parallel (default=1)");
 }
 
 CAbstractPTGBasedReactive::TAbstractPTGNavigatorParams::
@@ -1863,7 +1918,8 @@ CAbstractPTGBasedReactive::TAbstractPTGNavigatorParams::
 	  robot_absolute_speed_limits(),
 	  enable_obstacle_filtering(true),
 	  evaluate_clearance(false),
-	  max_dist_for_timebased_path_prediction(2.0)
+	  max_dist_for_timebased_path_prediction(2.0),
+	  num_threads(1)
 {
 }
 
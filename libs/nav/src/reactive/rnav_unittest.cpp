@@ -18,13 +18,27 @@
 
 using mrpt::math::TPoint2D;
 
+/** What the navigator decided in one navigation step */
+struct TNavDecision
+{
+	int selectedPTG;
+	std::vector<double> cmd_vel;
+
+	bool operator==(const TNavDecision& o) const
+	{
+		return selectedPTG == o.selectedPTG && cmd_vel == o.cmd_vel;
+	}
+};
+
 template <typename RNAVCLASS>
 void run_rnav_test(
 	const std::string& sFilename, const std::string& sHoloMethod,
 	const TPoint2D& nav_target, const TPoint2D& world_topleft,
 	const TPoint2D& world_rightbottom,
 	const TPoint2D& block_obstacle_topleft = TPoint2D(0, 0),
-	const TPoint2D& block_obstacle_rightbottom = TPoint2D(0, 0))
+	const TPoint2D& block_obstacle_rightbottom = TPoint2D(0, 0),
+	const unsigned int num_threads = 1,
+	std::vector<TNavDecision>* decisions = nullptr)
 {
 	using namespace std;
 	using namespace mrpt;
@@ -43,6 +57,7 @@ void run_rnav_test(
 
 	mrpt::utils::CConfigFile cfg(sFil);
 	cfg.write("CAbstractPTGBasedReactive", "holonomic_method", sHoloMethod);
+	cfg.write("CAbstractPTGBasedReactive", "num_threads", int(num_threads));
 	cfg.discardSavingChanges();
 
 	// Create a grid map with a synthetic test environment with a simple
@@ -131,6 +146,7 @@ void run_rnav_test(
 		// printf("[run_rnav_test] navlog dir: `%s`\n", sTmpDir.c_str());
 		rnav.setLogFileDirectory(sTmpDir);
 		rnav.enableLogFile(true);
+		if (decisions) rnav.enableKeepLogRecords(true);
 	}
 
 	// Load options:
@@ -154,6 +170,18 @@ void run_rnav_test(
 		// Run nav:
 		rnav.navigationStep();
 
+		if (decisions)
+		{
+			mrpt::nav::CLogFileRecord lr;
+			rnav.getLastLogRecord(lr);
+			TNavDecision d;
+			d.selectedPTG = lr.nSelectedPTG;
+			if (lr.cmd_vel)
+				for (size_t k = 0; k < lr.cmd_vel->getVelCmdLength(); k++)
+					d.cmd_vel.push_back(lr.cmd_vel->getVelCmdElement(k));
+			decisions->push_back(d);
+		}
+
 		EXPECT_TRUE(rnav.getCurrentState() != CAbstractNavigator::NAV_ERROR);
 		if (rnav.getCurrentState() == CAbstractNavigator::IDLE) break;
 
@@ -250,3 +278,24 @@ TEST(CReactiveNavigationSystem3D, with_obstacle_nav_FullEval)
 		"reactive3d_config.ini", "CHolonomicFullEval", with_obs_trg,
 		with_obs_topleft, with_obs_bottomright, obs_tl, obs_br);
 }
+
+TEST(CReactiveNavigationSystem, with_obstacle_nav_FullEval_parallel)
+{
+	// The PTGs evaluated in parallel must lead to the same decisions than
+	// evaluated one after the other:
+	std::vector<TNavDecision> serial, parallel;
+	run_rnav_test<mrpt::nav::CReactiveNavigationSystem>(
+		"reactive2d_config.ini", "CHolonomicFullEval", with_obs_trg,
+		with_obs_topleft, with_obs_bottomright, obs_tl, obs_br, 1, &serial);
+	run_rnav_test<mrpt::nav::CReactiveNavigationSystem>(
+		"reactive2d_config.ini", "CHolonomicFullEval", with_obs_trg,
+		with_obs_topleft, with_obs_bottomright, obs_tl, obs_br, 4, &parallel);
+	ASSERT_FALSE(serial.empty());
+	ASSERT_EQ(serial.size(), parallel.size());
+	for (size_t i = 0; i < serial.size(); i++)
+	{
+		EXPECT_EQ(serial[i].selectedPTG, parallel[i].selectedPTG)
+			<< "step: " << i;
+		EXPECT_TRUE(serial[i].cmd_vel == parallel[i].cmd_vel) << "step: " << i;
+	}
+}
@@ -21,9 +21,14 @@
 #include <mrpt/maps/metric_map_types.h>
 #include <mrpt/obs/obs_frwds.h>
 #include <deque>
+#include <vector>
 
 namespace mrpt
 {
+namespace utils
+{
+class CWorkerThreadsPool;
+}
 namespace maps
 {
 /** Declares a virtual base class for all metric maps storage classes.
@@ -57,6 +62,17 @@ class CMetricMap : public mrpt::utils::CSerializable,
 {
 	DEFINE_VIRTUAL_SERIALIZABLE(CMetricMap)
 
+   protected:
+	/** Internal method called by computeObservationLikelihoodBatch(). The
+	 * default implementation just calls internal_computeObservationLikelihood()
+	 * for each pose: derived classes may override it with something smarter.
+	 * `out_logliks` is already resized to the number of poses. */
+	virtual void internal_computeObservationLikelihoodBatch(
+		const mrpt::obs::CObservation* obs,
+		const std::vector<mrpt::math::TPose3D>& takenFrom,
+		std::vector<double>& out_logliks,
+		mrpt::utils::CWorkerThreadsPool* threadPool);
+
    private:
 	/** Internal method called by clear() */
 	virtual void internal_clear() = 0;
@@ -149,6 +165,26 @@ class CMetricMap : public mrpt::utils::CSerializable,
 		const mrpt::obs::CObservation* obs,
 		const mrpt::poses::CPose2D& takenFrom);
 
+	/** Computes the log-likelihood of one observation for each robot pose in
+	 * a set, e.g. all the particles of a particle filter. This is equivalent
+	 * to (but, for some maps, much faster than) calling
+	 * computeObservationLikelihood() for each pose, since the parts of the
+	 * computation that do not depend on the pose (e.g. projecting a laser
+	 * scan into points) are done only once.
+	 *
+	 * \param obs The observation.
+	 * \param takenFrom The robot poses.
+	 * \param out_logliks The log-likelihood for each pose, in the same order.
+	 * \param threadPool If not nullptr, maps supporting it will split the
+	 * poses among the threads of this pool.
+	 * \sa computeObservationsLikelihoodBatch
+	 */
+	void computeObservationLikelihoodBatch(
+		const mrpt::obs::CObservation* obs,
+		const std::vector<mrpt::math::TPose3D>& takenFrom,
+		std::vector<double>& out_logliks,
+		mrpt::utils::CWorkerThreadsPool* threadPool = nullptr);
+
 	/** Returns true if this map is able to compute a sensible likelihood
 	 * function for this observation (i.e. an occupancy grid map cannot with an
 	 * image).  See: \ref maps_observations
@@ -176,6 +212,16 @@ class CMetricMap : public mrpt::utils::CSerializable,
 		const mrpt::obs::CSensoryFrame& sf,
 		const mrpt::poses::CPose2D& takenFrom);
 
+	/** Like computeObservationsLikelihood(), for a set of robot poses at once.
+	 * out_logliks[i] is the sum of the log-likelihoods of each observation in
+	 * `sf` for the pose takenFrom[i].
+	 * \sa computeObservationLikelihoodBatch */
+	void computeObservationsLikelihoodBatch(
+		const mrpt::obs::CSensoryFrame& sf,
+		const std::vector<mrpt::math::TPose3D>& takenFrom,
+		std::vector<double>& out_logliks,
+		mrpt::utils::CWorkerThreadsPool* threadPool = nullptr);
+
 	/** Returns true if this map is able to compute a sensible likelihood
 	 * function for this observation (i.e. an occupancy grid map cannot with an
 	 * image).  See: \ref maps_observations
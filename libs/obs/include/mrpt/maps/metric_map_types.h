@@ -15,6 +15,10 @@
 
 namespace mrpt
 {
+namespace utils
+{
+class CWorkerThreadsPool;
+}
 namespace maps
 {
 /** Parameters for the determination of matchings between point clouds, etc. \sa
@@ -42,6 +46,11 @@ struct TMatchingParams
 	/** The point used to calculate angular distances: e.g. the coordinates of
 	 * the sensor for a 2D laser scanner. */
 	mrpt::math::TPoint3D angularDistPivotPoint;
+	/** If not nullptr, maps which support it (e.g. mrpt::maps::CPointsMap)
+	 * look for the correspondences of chunks of points in parallel in this
+	 * pool of threads. The result is the same than without it.
+	 * (Default=nullptr) */
+	mrpt::utils::CWorkerThreadsPool* threadPool;
 
 	/** Ctor: default values */
 	TMatchingParams()
@@ -51,7 +60,8 @@ struct TMatchingParams
 		  onlyUniqueRobust(false),
 		  decimation_other_map_points(1),
 		  offset_other_map_points(0),
-		  angularDistPivotPoint(0, 0, 0)
+		  angularDistPivotPoint(0, 0, 0),
+		  threadPool(nullptr)
 	{
 	}
 };
@@ -58,8 +58,10 @@ MRPT_WARNING(
 
 // Others:
 #include <mrpt/obs/CRawlog.h>
+#include <mrpt/obs/CChunkedRawlog.h>
 #include <mrpt/obs/carmen_log_tools.h>
 #include <mrpt/obs/obs_utils.h>
+#include <mrpt/obs/range_scan_simulation.h>
 
 // Very basic classes for maps:
 #include <mrpt/maps/CMetricMap.h>
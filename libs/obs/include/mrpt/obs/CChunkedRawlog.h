@@ -0,0 +1,241 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+#ifndef CChunkedRawlog_H
+#define CChunkedRawlog_H
+
+#include <mrpt/utils/CSerializable.h>
+#include <mrpt/utils/CMemoryStream.h>
+#include <mrpt/utils/CFileOutputStream.h>
+#include <mrpt/system/datetime.h>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mrpt
+{
+namespace utils
+{
+class CWorkerThreadsPool;
+}
+namespace obs
+{
+/** One entry in the index of a chunked rawlog file.
+ * \sa CChunkedRawlogReader, CChunkedRawlogWriter
+ * \ingroup mrpt_obs_grp */
+struct TChunkedRawlogEntry
+{
+	TChunkedRawlogEntry()
+		: timestamp(INVALID_TIMESTAMP), block(0), offsetInBlock(0)
+	{
+	}
+	/** Timestamp of the object: that of the observation, or of the first
+	 * observation (action) in a CSensoryFrame (CActionCollection).
+	 * INVALID_TIMESTAMP if unknown. */
+	mrpt::system::TTimeStamp timestamp;
+	/** Sensor label, for observations only (empty otherwise) */
+	std::string sensorLabel;
+	/** The C++ class name of the object, e.g. "CObservation2DRangeScan" */
+	std::string className;
+	/** The compressed block holding the object */
+	uint32_t block;
+	/** Byte offset of the object within the uncompressed block */
+	uint64_t offsetInBlock;
+};
+
+/** Writes a sequence of rawlog objects (observations, sensory frames and
+ * actions) into a chunked rawlog file, to be read with CChunkedRawlogReader.
+ *
+ * As opposed to plain `.rawlog` files (one single gzip stream), a chunked
+ * rawlog is made of independently compressed blocks of objects, followed by
+ * an index with the timestamp, sensor label, class name and location of each
+ * object. This allows random access to any object without decompressing the
+ * whole file. The file layout is:
+ *  - Header: 8 magic bytes ("MRPT-RLC") and a `uint32_t` format version.
+ *  - Blocks: each one the zlib-compressed concatenation of
+ *    CStream::WriteObject() of consecutive objects.
+ *  - Index: zlib-compressed list of blocks (file offset and sizes) and of
+ *    TChunkedRawlogEntry's.
+ *  - Footer: index offset, compressed and uncompressed sizes (`uint64_t`),
+ *    and 8 magic bytes ("MRPT-IDX").
+ *
+ * The index and footer are written by close(), which is also invoked from
+ * the destructor. `rawlog-edit --export-chunked` and `--import-chunked`
+ * convert between this format and plain `.rawlog` files.
+ *
+ * \sa CChunkedRawlogReader, CRawlog
+ * \ingroup mrpt_obs_grp */
+class CChunkedRawlogWriter
+{
+   public:
+	/** Default ctor. Call open() before writing. */
+	CChunkedRawlogWriter();
+	/** Ctor which opens a file \exception std::exception On error */
+	CChunkedRawlogWriter(const std::string& fileName);
+	/** Dtor: calls close() */
+	~CChunkedRawlogWriter();
+	CChunkedRawlogWriter(const CChunkedRawlogWriter&) = delete;
+	CChunkedRawlogWriter& operator=(const CChunkedRawlogWriter&) = delete;
+
+	/** Creates (or truncates) a file and writes its header. Any previously
+	 * open file is closed first. \return false on error */
+	bool open(const std::string& fileName);
+	/** Writes the pending block, the index and the footer, and closes the
+	 * file. Does nothing if there is no open file. */
+	void close();
+	bool is_open() const { return m_is_open; }
+	/** Appends one object (normally a CObservation, CSensoryFrame or
+	 * CActionCollection) at the end of the file */
+	void write(const mrpt::utils::CSerializable& obj);
+	/** \overload */
+	void write(const mrpt::utils::CSerializable::Ptr& obj)
+	{
+		ASSERT_(obj);
+		write(*obj);
+	}
+	/** Number of objects written so far */
+	size_t size() const { return m_entries.size(); }
+
+	/** Approximate size of each block before compression, in bytes
+	 * (default=1MiB). Larger blocks compress better, smaller ones make random
+	 * access cheaper. */
+	uint64_t blockSize;
+
+   protected:
+	struct TBlockInfo
+	{
+		uint64_t fileOffset, compressedSize, uncompressedSize;
+	};
+	mrpt::utils::CFileOutputStream m_f;
+	bool m_is_open;
+	mrpt::utils::CMemoryStream m_block;
+	std::vector<TBlockInfo> m_blocks;
+	std::vector<TChunkedRawlogEntry> m_entries;
+
+	/** Compresses and writes out the current block, if not empty */
+	void flushBlock();
+};
+
+/** Random-access reader of chunked rawlog files written by
+ * CChunkedRawlogWriter.
+ *
+ * Upon open(), the file is memory-mapped (or entirely loaded into memory if
+ * mapping is not possible) and only its index is decoded, so opening is fast
+ * regardless of the dataset size. Objects are then decoded on demand:
+ *  - getObject() decompresses the block holding the requested object, which
+ *    is kept in a small cache (see maxCachedBlocks), so sequential reads only
+ *    decompress each block once.
+ *  - findByTime() locates objects by timestamp with a binary search.
+ *  - getObjects() decodes a range of objects, optionally decompressing and
+ *    deserializing blocks in parallel with a mrpt::utils::CWorkerThreadsPool.
+ *
+ * Usage:
+ * \code
+ * CChunkedRawlogReader rawlog;
+ * if (!rawlog.open("dataset.rawlogc")) ...
+ * // Jump to the first object at or after a given time:
+ * const size_t i = rawlog.findByTime(t);
+ * CObservation::Ptr obs = rawlog.getObjectAs<CObservation>(i);
+ * \endcode
+ *
+ * Calling getObject() and getObjects() from several threads at once is
+ * safe.
+ * \sa CChunkedRawlogWriter, CRawlog
+ * \ingroup mrpt_obs_grp */
+class CChunkedRawlogReader
+{
+   public:
+	/** Default ctor. Call open() before reading. */
+	CChunkedRawlogReader();
+	/** Ctor which opens a file \exception std::exception On error */
+	CChunkedRawlogReader(const std::string& fileName);
+	~CChunkedRawlogReader();
+	CChunkedRawlogReader(const CChunkedRawlogReader&) = delete;
+	CChunkedRawlogReader& operator=(const CChunkedRawlogReader&) = delete;
+
+	/** Opens a chunked rawlog file and loads its index.
+	 * \return false if the file cannot be read.
+	 * \exception std::exception If the file is not a valid chunked rawlog */
+	bool open(const std::string& fileName);
+	void close();
+	bool is_open() const;
+	/** Returns true if the file exists and starts with the chunked rawlog
+	 * magic bytes. */
+	static bool isChunkedRawlogFile(const std::string& fileName);
+
+	/** Number of objects in the file */
+	size_t size() const { return m_entries.size(); }
+	/** Number of compressed blocks in the file */
+	size_t blockCount() const { return m_blocks.size(); }
+	/** Returns the index entry of the i'th object (no decoding involved) */
+	const TChunkedRawlogEntry& getEntry(size_t i) const
+	{
+		ASSERT_BELOW_(i, m_entries.size());
+		return m_entries[i];
+	}
+	/** Whether the file is memory-mapped (true) or had to be loaded into
+	 * memory (false) */
+	bool isMemoryMapped() const;
+
+	/** Returns the index of the object with the smallest timestamp which is
+	 * equal or later than `t` (the lowest index among those with the same
+	 * timestamp), or size() if there is none. Takes O(log(N)) time. */
+	size_t findByTime(const mrpt::system::TTimeStamp t) const;
+
+	/** Decodes the i'th object in the file */
+	mrpt::utils::CSerializable::Ptr getObject(size_t i);
+	/** Like getObject() with a dynamic cast to the given class; returns an
+	 * empty pointer if the object is of a different class. */
+	template <class T>
+	typename T::Ptr getObjectAs(size_t i)
+	{
+		return std::dynamic_pointer_cast<T>(getObject(i));
+	}
+	/** Decodes the objects with indices in the range [first,last) into `out`.
+	 * If a thread pool is given, blocks are decompressed and deserialized in
+	 * parallel. */
+	void getObjects(
+		size_t first, size_t last,
+		std::vector<mrpt::utils::CSerializable::Ptr>& out,
+		mrpt::utils::CWorkerThreadsPool* threadPool = nullptr);
+
+	/** Maximum number of decompressed blocks kept in memory by getObject()
+	 * (default=4) */
+	size_t maxCachedBlocks;
+
+   protected:
+	struct TMappedFile;
+	struct TBlockInfo
+	{
+		uint64_t fileOffset, compressedSize, uncompressedSize;
+	};
+	typedef std::shared_ptr<std::vector<uint8_t>> block_data_t;
+
+	std::unique_ptr<TMappedFile> m_file;
+	std::vector<TBlockInfo> m_blocks;
+	std::vector<TChunkedRawlogEntry> m_entries;
+	/** Indices of m_entries sorted by timestamp */
+	std::vector<uint32_t> m_entries_by_time;
+
+	/** Cache of decompressed blocks, with the most recently used first */
+	std::list<std::pair<uint32_t, block_data_t>> m_cache;
+	std::mutex m_cache_mtx;
+
+	void decompressBlock(uint32_t blockIdx, std::vector<uint8_t>& out) const;
+	block_data_t getBlock(uint32_t blockIdx);
+	mrpt::utils::CSerializable::Ptr decodeObject(
+		const std::vector<uint8_t>& blockData, uint64_t offset) const;
+};
+
+}  // End of namespace
+}  // End of namespace
+
+#endif
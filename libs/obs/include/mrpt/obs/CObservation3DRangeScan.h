@@ -22,9 +22,14 @@
 #include <mrpt/utils/adapters.h>
 #include <mrpt/utils/integer_select.h>
 #include <mrpt/utils/stl_serialization.h>
+#include <limits>
 
 namespace mrpt
 {
+namespace utils
+{
+class CWorkerThreadsPool;
+}
 namespace obs
 {
 /** Used in CObservation3DRangeScan::project3DPointsFromDepthImageInto() */
@@ -48,12 +53,29 @@ struct T3DPointsProjectionParams
 	/** (Default:true) set to false if you want to preserve the organization of
 	 * the point cloud */
 	bool MAKE_DENSE;
+	/** (Default:1) Only one out of each `decimation` rows and columns of the
+	 * range image are projected */
+	unsigned int decimation;
+	/** (Default: the whole image) Region of interest: only pixels with
+	 * columns in [roi_col_min, roi_col_max) and rows in [roi_row_min,
+	 * roi_row_max) of the range image are projected. Limits beyond the image
+	 * size are clamped to it. */
+	unsigned int roi_col_min, roi_col_max, roi_row_min, roi_row_max;
+	/** (Default: nullptr) If provided, rows of the range image are projected
+	 * in parallel with this pool of threads. */
+	mrpt::utils::CWorkerThreadsPool* threadPool;
 	T3DPointsProjectionParams()
 		: takeIntoAccountSensorPoseOnRobot(false),
 		  robotPoseInTheWorld(nullptr),
 		  PROJ3D_USE_LUT(true),
 		  USE_SSE2(true),
-		  MAKE_DENSE(true)
+		  MAKE_DENSE(true),
+		  decimation(1),
+		  roi_col_min(0),
+		  roi_col_max(std::numeric_limits<unsigned int>::max()),
+		  roi_row_min(0),
+		  roi_row_max(std::numeric_limits<unsigned int>::max()),
+		  threadPool(nullptr)
 	{
 	}
 };
@@ -304,6 +326,16 @@ class CObservation3DRangeScan : public CObservation
 	 * takeIntoAccountSensorPoseOnRobot
 	  *  the points are transformed with \a sensorPose. Furthermore, if
 	 * provided, those coordinates are transformed with \a robotPoseInTheWorld
+	  *
+	  *  Filtering (see TRangeImageFilterParams), decimation and the region
+	 * of interest in \a projectParams, the projection, coloring and pose
+	 * transformation are all done in one single pass over the range image,
+	 * writing each point directly into \a dest_pointcloud. Rows can be
+	 * processed in parallel by providing a
+	 * T3DPointsProjectionParams::threadPool.
+	 * The pixel coordinates of the points (\a points3D_idxs_x, \a
+	 * points3D_idxs_y) are only updated when the destination is this
+	 * same observation.
 	  *
 	  * \tparam POINTMAP Supported maps are all those covered by
 	 * mrpt::utils::PointCloudAdapter (mrpt::maps::CPointsMap and derived,
@@ -806,7 +838,7 @@ class CObservation3DRangeScan : public CObservation
 		mrpt::math::CVectorFloat Kzs, Kys;
 		mrpt::utils::TCamera prev_camParams;
 	};
-	/** 3D point cloud projection look-up-table \sa
+	/** 3D point cloud projection look-up-table (one per thread) \sa
 	 * project3DPointsFromDepthImage */
 	static TCached3DProjTables & get_3dproj_lut();
 
@@ -10,6 +10,9 @@
 #define CObservation3DRangeScan_project3D_impl_H
 
 #include <mrpt/utils/round.h>  // round()
+#include <mrpt/utils/CWorkerThreadsPool.h>
+#include <algorithm>
+#include <type_traits>
 
 namespace mrpt
 {
@@ -17,22 +20,240 @@ namespace obs
 {
 namespace detail
 {
-// Auxiliary functions which implement SSE-optimized proyection of 3D point
-// cloud:
-template <class POINTMAP>
-void do_project_3d_pointcloud(
-	const int H, const int W, const float* kys, const float* kzs,
-	const mrpt::math::CMatrix& rangeImage,
-	mrpt::utils::PointCloudAdapter<POINTMAP>& pca,
-	std::vector<uint16_t>& idxs_x, std::vector<uint16_t>& idxs_y,
-	const mrpt::obs::TRangeImageFilterParams& filterParams, bool MAKE_DENSE);
+/** Everything project3DPointsFromDepthImageInto() needs to project one pixel,
+ * computed once per call. */
+struct TProject3DContext
+{
+	/** Range image size */
+	int W, H;
+	/** Decimated region of interest: rows r0+i*decimation (i<nRows) and
+	 * columns c0+j*decimation (j<nCols) */
+	int r0, c0, nRows, nCols, decimation;
+	bool use_sse2;
+	TRangeImageFilterParams fp;
+
+	/** Ky,Kz look-up tables (W*H), or nullptr to compute them */
+	const float *kys, *kzs;
+	float r_cx, r_cy, r_fx_inv, r_fy_inv;
+	bool range_is_depth;
+
+	/** Color: the intensity image, or nullptr */
+	const mrpt::utils::CImage* img;
+	int imgW, imgH;
+	bool img_is_color, img_direct_corresp;
+	float img_cx, img_cy, img_fx, img_fy;
+	/** Pose of the depth camera wrt the intensity one */
+	mrpt::math::CMatrixFixedNumeric<float, 4, 4> T_inv;
+
+	/** Sensor and/or robot pose to transform points with, if `transform` */
+	bool transform;
+	mrpt::math::CMatrixFixedNumeric<float, 4, 4> HM;
+
+	/** Projection of the pixels of one row into local coordinates (wrt the
+	 * depth camera) */
+	struct TLocalProj
+	{
+		TLocalProj(const TProject3DContext& ctx, const int r)
+			: kys(ctx.kys ? ctx.kys + size_t(r) * ctx.W : nullptr),
+			  kzs(ctx.kzs ? ctx.kzs + size_t(r) * ctx.W : nullptr),
+			  cx(ctx.r_cx),
+			  fx_inv(ctx.r_fx_inv),
+			  Kz((ctx.r_cy - r) * ctx.r_fy_inv),
+			  range_is_depth(ctx.range_is_depth)
+		{
+		}
+		const float *kys, *kzs;
+		const float cx, fx_inv, Kz;
+		const bool range_is_depth;
+
+		inline void project(
+			const int c, const float D, float& x, float& y, float& z) const
+		{
+			const float Ky_ = kys ? kys[c] : (cx - c) * fx_inv;
+			const float Kz_ = kys ? kzs[c] : Kz;
+			x = range_is_depth ? D : D / std::sqrt(1 + Ky_ * Ky_ + Kz_ * Kz_);
+			y = Ky_ * x;
+			z = Kz_ * x;
+		}
+	};
+
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/** Calls `f(c, valid, x, y, z, X, Y, Z)` for each pixel (c being its column
+ * in full resolution coordinates) of the decimated region of interest in
+ * row `r` of the range image, where `valid` tells whether its range passes
+ * all the filters (see TRangeImageFilter::do_range_filter()), (x,y,z) are
+ * its local coordinates and (X,Y,Z) the final ones, after applying
+ * TProject3DContext::HM. The coordinates are only computed if `PROJECT` is
+ * true, and are undefined for invalid pixels. */
+template <bool PROJECT, class FUNCTOR>
+inline void project3D_row(
+	const mrpt::math::CMatrix& rangeImage, const TProject3DContext& ctx,
+	const int r, FUNCTOR&& f)
+{
+	const float* D_ptr = &rangeImage.coeffRef(r, 0);
+	int j = 0, c = ctx.c0;
+	// Local copies, since "f" may write through float pointers:
+	const TProject3DContext::TLocalProj lp(ctx, r);
+	const int nCols = ctx.nCols, decimation = ctx.decimation;
+	const bool transform = ctx.transform;
+	float HM[12];
+	std::copy(&ctx.HM(0, 0), &ctx.HM(0, 0) + 12, HM);  // Row-major
+#if MRPT_HAS_SSE2
+	if (ctx.use_sse2 && decimation == 1)
+	{
+		// Four pixels at a time. The same conditions than in
+		// TRangeImageFilter::do_range_filter():
+		const float* Dmin_ptr = ctx.fp.rangeMask_min
+									? &ctx.fp.rangeMask_min->coeffRef(r, 0)
+									: nullptr;
+		const float* Dmax_ptr = ctx.fp.rangeMask_max
+									? &ctx.fp.rangeMask_max->coeffRef(r, 0)
+									: nullptr;
+		const __m128 zeros = _mm_setzero_ps();
+		const __m128 ones = _mm_cmpeq_ps(zeros, zeros);
+		const __m128 invert = ctx.fp.rangeCheckBetween ? zeros : ones;
+		const __m128 c_offsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+		const __m128 cx = _mm_set1_ps(lp.cx), fx_inv = _mm_set1_ps(lp.fx_inv);
+		const __m128 Kz_noLUT = _mm_set1_ps(lp.Kz);
+		__m128 H[12];
+		for (int k = 0; k < 12; k++) H[k] = _mm_set1_ps(HM[k]);
+		alignas(16) float xs[4], ys[4], zs[4], Xs[4], Ys[4], Zs[4];
+		const float* X = transform ? Xs : xs;
+		const float* Y = transform ? Ys : ys;
+		const float* Z = transform ? Zs : zs;
+		for (; j + 4 <= nCols; j += 4, c += 4)
+		{
+			const __m128 D = _mm_loadu_ps(D_ptr + c);
+			__m128 pass_gt = ones, pass_lt = ones, both = zeros;
+			if (Dmin_ptr)
+			{
+				const __m128 Dmin = _mm_loadu_ps(Dmin_ptr + c);
+				const __m128 no_min = _mm_cmpeq_ps(Dmin, zeros);
+				pass_gt = _mm_or_ps(_mm_cmpge_ps(D, Dmin), no_min);
+				both = _mm_andnot_ps(no_min, ones);
+			}
+			if (Dmax_ptr)
+			{
+				const __m128 Dmax = _mm_loadu_ps(Dmax_ptr + c);
+				const __m128 no_max = _mm_cmpeq_ps(Dmax, zeros);
+				pass_lt = _mm_or_ps(_mm_cmple_ps(D, Dmax), no_max);
+				both = _mm_andnot_ps(no_max, both);
+			}
+			else
+				both = zeros;
+			__m128 valid = _mm_and_ps(pass_gt, pass_lt);
+			valid = _mm_xor_ps(valid, _mm_and_ps(both, invert));
+			valid = _mm_and_ps(valid, _mm_cmpnle_ps(D, zeros));
+			const int valid_mask = _mm_movemask_ps(valid);
+
+			if (PROJECT && valid_mask)
+			{
+				__m128 Ky, Kz;
+				if (lp.kys)
+				{
+					Ky = _mm_loadu_ps(lp.kys + c);
+					Kz = _mm_loadu_ps(lp.kzs + c);
+				}
+				else
+				{
+					const __m128 cs =
+						_mm_add_ps(_mm_set1_ps(float(c)), c_offsets);
+					Ky = _mm_mul_ps(_mm_sub_ps(cx, cs), fx_inv);
+					Kz = Kz_noLUT;
+				}
+				__m128 x = D;
+				if (!lp.range_is_depth)
+				{
+					const __m128 n = _mm_add_ps(
+						_mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(Ky, Ky)),
+						_mm_mul_ps(Kz, Kz));
+					x = _mm_div_ps(D, _mm_sqrt_ps(n));
+				}
+				const __m128 y = _mm_mul_ps(Ky, x), z = _mm_mul_ps(Kz, x);
+				_mm_store_ps(xs, x);
+				_mm_store_ps(ys, y);
+				_mm_store_ps(zs, z);
+				if (transform)
+				{
+					float* out[3] = {Xs, Ys, Zs};
+					for (int k = 0; k < 3; k++)
+					{
+						const __m128* Hk = H + 4 * k;
+						__m128 v = _mm_mul_ps(Hk[0], x);
+						v = _mm_add_ps(v, _mm_mul_ps(Hk[1], y));
+						v = _mm_add_ps(v, _mm_mul_ps(Hk[2], z));
+						_mm_store_ps(out[k], _mm_add_ps(v, Hk[3]));
+					}
+				}
+			}
+			for (int q = 0; q < 4; q++)
+				f(c + q, (valid_mask & (1 << q)) != 0, xs[q], ys[q], zs[q],
+				  X[q], Y[q], Z[q]);
+		}
+	}
+#endif
+	// Generic version, and the tail of the SIMD one:
+	const TRangeImageFilter rif(ctx.fp);
+	for (; j < nCols; j++, c += decimation)
+	{
+		const float D = D_ptr[c];
+		const bool valid = rif.do_range_filter(r, c, D);
+		float x = 0, y = 0, z = 0;
+		if (PROJECT && valid) lp.project(c, D, x, y, z);
+		if (PROJECT && valid && transform)
+			f(c, valid, x, y, z,
+			  HM[0] * x + HM[1] * y + HM[2] * z + HM[3],
+			  HM[4] * x + HM[5] * y + HM[6] * z + HM[7],
+			  HM[8] * x + HM[9] * y + HM[10] * z + HM[11]);
+		else
+			f(c, valid, x, y, z, x, y, z);
+	}
+}
+
+/** Sets the color of the idx'th point of `pca`, from the projection of its
+ * local coordinates (x,y,z) into the intensity image */
 template <class POINTMAP>
-void do_project_3d_pointcloud_SSE2(
-	const int H, const int W, const float* kys, const float* kzs,
-	const mrpt::math::CMatrix& rangeImage,
-	mrpt::utils::PointCloudAdapter<POINTMAP>& pca,
-	std::vector<uint16_t>& idxs_x, std::vector<uint16_t>& idxs_y,
-	const mrpt::obs::TRangeImageFilterParams& filterParams, bool MAKE_DENSE);
+inline void project3D_color(
+	const TProject3DContext& ctx, const int r, const int c, const float x,
+	const float y, const float z,
+	mrpt::utils::PointCloudAdapter<POINTMAP>& pca, const size_t idx)
+{
+	int img_idx_x = c, img_idx_y = r;
+	bool pointWithinImage = true;
+	if (!ctx.img_direct_corresp)
+	{
+		pointWithinImage = false;
+		const float xc = ctx.T_inv(0, 0) * x + ctx.T_inv(0, 1) * y +
+						 ctx.T_inv(0, 2) * z + ctx.T_inv(0, 3);
+		const float yc = ctx.T_inv(1, 0) * x + ctx.T_inv(1, 1) * y +
+						 ctx.T_inv(1, 2) * z + ctx.T_inv(1, 3);
+		const float zc = ctx.T_inv(2, 0) * x + ctx.T_inv(2, 1) * y +
+						 ctx.T_inv(2, 2) * z + ctx.T_inv(2, 3);
+		if (zc)
+		{
+			img_idx_x = mrpt::utils::round(ctx.img_cx + ctx.img_fx * xc / zc);
+			img_idx_y = mrpt::utils::round(ctx.img_cy + ctx.img_fy * yc / zc);
+			pointWithinImage = img_idx_x >= 0 && img_idx_x < ctx.imgW &&
+							   img_idx_y >= 0 && img_idx_y < ctx.imgH;
+		}
+	}
+	uint8_t R = 255, G = 255, B = 255;
+	if (pointWithinImage)
+	{
+		const uint8_t* px = ctx.img->get_unsafe(img_idx_x, img_idx_y, 0);
+		if (ctx.img_is_color)
+		{
+			R = px[2];
+			G = px[1];
+			B = px[0];
+		}
+		else
+			R = G = B = px[0];
+	}
+	pca.setPointRGBu8(idx, R, G, B);
+}
 
 template <class POINTMAP>
 void project3DPointsFromDepthImageInto(
@@ -45,269 +266,110 @@ void project3DPointsFromDepthImageInto(
 	if (!src_obs.hasRangeImage) return;
 
 	mrpt::utils::PointCloudAdapter<POINTMAP> pca(dest_pointcloud);
+	// Only if projecting into the observation itself, keep the pixel
+	// coordinates of each point:
+	const bool save_idxs =
+		std::is_same<POINTMAP, mrpt::obs::CObservation3DRangeScan>::value &&
+		static_cast<const void*>(&dest_pointcloud) ==
+			static_cast<const void*>(&src_obs);
+
+	TProject3DContext ctx;
+	ctx.W = src_obs.rangeImage.cols();
+	ctx.H = src_obs.rangeImage.rows();
+	ASSERT_(ctx.W != 0 && ctx.H != 0);
+	const size_t WH = ctx.W * ctx.H;
+
+	// Region of interest & decimation:
+	ASSERT_(projectParams.decimation >= 1);
+	ctx.decimation = projectParams.decimation;
+	ctx.c0 = std::min<unsigned int>(projectParams.roi_col_min, ctx.W);
+	ctx.r0 = std::min<unsigned int>(projectParams.roi_row_min, ctx.H);
+	const int c1 = std::min<unsigned int>(projectParams.roi_col_max, ctx.W);
+	const int r1 = std::min<unsigned int>(projectParams.roi_row_max, ctx.H);
+	ctx.nCols = c1 > ctx.c0 ? 1 + (c1 - ctx.c0 - 1) / ctx.decimation : 0;
+	ctx.nRows = r1 > ctx.r0 ? 1 + (r1 - ctx.r0 - 1) / ctx.decimation : 0;
+	ctx.use_sse2 = projectParams.USE_SSE2;
+
+	// Range filters:
+	ctx.fp = filterParams;
+	if (filterParams.rangeMask_min)
+	{  // sanity check:
+		ASSERT_EQUAL_(
+			filterParams.rangeMask_min->cols(), src_obs.rangeImage.cols());
+		ASSERT_EQUAL_(
+			filterParams.rangeMask_min->rows(), src_obs.rangeImage.rows());
+	}
+	if (filterParams.rangeMask_max)
+	{  // sanity check:
+		ASSERT_EQUAL_(
+			filterParams.rangeMask_max->cols(), src_obs.rangeImage.cols());
+		ASSERT_EQUAL_(
+			filterParams.rangeMask_max->rows(), src_obs.rangeImage.rows());
+	}
 
-	// ------------------------------------------------------------
-	// Stage 1/3: Create 3D point cloud local coordinates
-	// ------------------------------------------------------------
-	const int W = src_obs.rangeImage.cols();
-	const int H = src_obs.rangeImage.rows();
-	ASSERT_(W != 0 && H != 0);
-	const size_t WH = W * H;
-
-	src_obs.resizePoints3DVectors(WH);  // This is to make sure
-	// points3D_idxs_{x,y} have the expected
-	// sizes.
-	pca.resize(WH);  // Reserve memory for 3D points. It will be later resized
-	// again to the actual number of valid points
-
-	if (src_obs.range_is_depth)
+	// Projection: Ky, Kz are the same for depth and range images.
+	ctx.range_is_depth = src_obs.range_is_depth;
+	ctx.r_cx = src_obs.cameraParams.cx();
+	ctx.r_cy = src_obs.cameraParams.cy();
+	ctx.r_fx_inv = 1.0f / src_obs.cameraParams.fx();
+	ctx.r_fy_inv = 1.0f / src_obs.cameraParams.fy();
+	ctx.kys = ctx.kzs = nullptr;
+	if (projectParams.PROJ3D_USE_LUT)
 	{
-		// range_is_depth = true
-
-		// Use cached tables?
-		if (projectParams.PROJ3D_USE_LUT)
-		{
-			// Use LUT:
-			if (src_obs.get_3dproj_lut().prev_camParams != src_obs.cameraParams ||
-				WH != size_t(src_obs.get_3dproj_lut().Kys.size()))
-			{
-				src_obs.get_3dproj_lut().prev_camParams = src_obs.cameraParams;
-				src_obs.get_3dproj_lut().Kys.resize(WH);
-				src_obs.get_3dproj_lut().Kzs.resize(WH);
-
-				const float r_cx = src_obs.cameraParams.cx();
-				const float r_cy = src_obs.cameraParams.cy();
-				const float r_fx_inv = 1.0f / src_obs.cameraParams.fx();
-				const float r_fy_inv = 1.0f / src_obs.cameraParams.fy();
-
-				float* kys = &src_obs.get_3dproj_lut().Kys[0];
-				float* kzs = &src_obs.get_3dproj_lut().Kzs[0];
-				for (int r = 0; r < H; r++)
-					for (int c = 0; c < W; c++)
-					{
-						*kys++ = (r_cx - c) * r_fx_inv;
-						*kzs++ = (r_cy - r) * r_fy_inv;
-					}
-			}  // end update LUT.
-
-			ASSERT_EQUAL_(WH, size_t(src_obs.get_3dproj_lut().Kys.size()))
-			ASSERT_EQUAL_(WH, size_t(src_obs.get_3dproj_lut().Kzs.size()))
-			float* kys = &src_obs.get_3dproj_lut().Kys[0];
-			float* kzs = &src_obs.get_3dproj_lut().Kzs[0];
-
-			if (filterParams.rangeMask_min)
-			{  // sanity check:
-				ASSERT_EQUAL_(
-					filterParams.rangeMask_min->cols(),
-					src_obs.rangeImage.cols());
-				ASSERT_EQUAL_(
-					filterParams.rangeMask_min->rows(),
-					src_obs.rangeImage.rows());
-			}
-			if (filterParams.rangeMask_max)
-			{  // sanity check:
-				ASSERT_EQUAL_(
-					filterParams.rangeMask_max->cols(),
-					src_obs.rangeImage.cols());
-				ASSERT_EQUAL_(
-					filterParams.rangeMask_max->rows(),
-					src_obs.rangeImage.rows());
-			}
-#if MRPT_HAS_SSE2
-			if ((W & 0x07) == 0 && projectParams.USE_SSE2)
-				do_project_3d_pointcloud_SSE2(
-					H, W, kys, kzs, src_obs.rangeImage, pca,
-					src_obs.points3D_idxs_x, src_obs.points3D_idxs_y,
-					filterParams, projectParams.MAKE_DENSE);
-			else
-				do_project_3d_pointcloud(
-					H, W, kys, kzs, src_obs.rangeImage, pca,
-					src_obs.points3D_idxs_x, src_obs.points3D_idxs_y,
-					filterParams, projectParams.MAKE_DENSE);  // if image width
-// is not 8*N, use
-// standard method
-#else
-			do_project_3d_pointcloud(
-				H, W, kys, kzs, src_obs.rangeImage, pca,
-				src_obs.points3D_idxs_x, src_obs.points3D_idxs_y, filterParams,
-				projectParams.MAKE_DENSE);
-#endif
-		}
-		else
+		CObservation3DRangeScan::TCached3DProjTables& lut =
+			src_obs.get_3dproj_lut();
+		if (lut.prev_camParams != src_obs.cameraParams ||
+			WH != size_t(lut.Kys.size()))
 		{
-			// Without LUT:
-			const float r_cx = src_obs.cameraParams.cx();
-			const float r_cy = src_obs.cameraParams.cy();
-			const float r_fx_inv = 1.0f / src_obs.cameraParams.fx();
-			const float r_fy_inv = 1.0f / src_obs.cameraParams.fy();
-			TRangeImageFilter rif(filterParams);
-			size_t idx = 0;
-			for (int r = 0; r < H; r++)
-				for (int c = 0; c < W; c++)
+			lut.prev_camParams = src_obs.cameraParams;
+			lut.Kys.resize(WH);
+			lut.Kzs.resize(WH);
+			float* kys = &lut.Kys[0];
+			float* kzs = &lut.Kzs[0];
+			for (int r = 0; r < ctx.H; r++)
+				for (int c = 0; c < ctx.W; c++)
 				{
-					const float D = src_obs.rangeImage.coeff(r, c);
-					if (rif.do_range_filter(r, c, D))
-					{
-						const float Kz = (r_cy - r) * r_fy_inv;
-						const float Ky = (r_cx - c) * r_fx_inv;
-						pca.setPointXYZ(
-							idx,
-							D,  // x
-							Ky * D,  // y
-							Kz * D  // z
-							);
-						src_obs.points3D_idxs_x[idx] = c;
-						src_obs.points3D_idxs_y[idx] = r;
-						++idx;
-					}
+					*kys++ = (ctx.r_cx - c) * ctx.r_fx_inv;
+					*kzs++ = (ctx.r_cy - r) * ctx.r_fy_inv;
 				}
-			pca.resize(idx);  // Actual number of valid pts
-		}
-	}
-	else
-	{
-		/* range_is_depth = false :
-		  *   Ky = (r_cx - c)/r_fx
-		  *   Kz = (r_cy - r)/r_fy
-		  *
-		  *   x(i) = rangeImage(r,c) / sqrt( 1 + Ky^2 + Kz^2 )
-		  *   y(i) = Ky * x(i)
-		  *   z(i) = Kz * x(i)
-		  */
-		const float r_cx = src_obs.cameraParams.cx();
-		const float r_cy = src_obs.cameraParams.cy();
-		const float r_fx_inv = 1.0f / src_obs.cameraParams.fx();
-		const float r_fy_inv = 1.0f / src_obs.cameraParams.fy();
-		TRangeImageFilter rif(filterParams);
-		size_t idx = 0;
-		for (int r = 0; r < H; r++)
-			for (int c = 0; c < W; c++)
-			{
-				const float D = src_obs.rangeImage.coeff(r, c);
-				if (rif.do_range_filter(r, c, D))
-				{
-					const float Ky = (r_cx - c) * r_fx_inv;
-					const float Kz = (r_cy - r) * r_fy_inv;
-					pca.setPointXYZ(
-						idx,
-						D / std::sqrt(1 + Ky * Ky + Kz * Kz),  // x
-						Ky * D,  // y
-						Kz * D  // z
-						);
-					src_obs.points3D_idxs_x[idx] = c;
-					src_obs.points3D_idxs_y[idx] = r;
-					++idx;
-				}
-			}
-		pca.resize(idx);  // Actual number of valid pts
+		}  // end update LUT.
+		ctx.kys = &lut.Kys[0];
+		ctx.kzs = &lut.Kzs[0];
 	}
 
-	// -------------------------------------------------------------
-	// Stage 2/3: Project local points into RGB image to get colors
-	// -------------------------------------------------------------
+	// Color:
+	ctx.img = nullptr;
 	if (src_obs.hasIntensityImage)
 	{
-		const int imgW = src_obs.intensityImage.getWidth();
-		const int imgH = src_obs.intensityImage.getHeight();
-		const bool hasColorIntensityImg = src_obs.intensityImage.isColor();
-
-		const float cx = src_obs.cameraParamsIntensity.cx();
-		const float cy = src_obs.cameraParamsIntensity.cy();
-		const float fx = src_obs.cameraParamsIntensity.fx();
-		const float fy = src_obs.cameraParamsIntensity.fy();
-
-		// Unless we are in a special case (both depth & RGB images coincide)...
-		const bool isDirectCorresp =
-			src_obs.doDepthAndIntensityCamerasCoincide();
-
-		// ...precompute the inverse of the pose transformation out of the loop,
-		//  store as a 4x4 homogeneous matrix to exploit SSE optimizations
-		//  below:
-		mrpt::math::CMatrixFixedNumeric<float, 4, 4> T_inv;
-		if (!isDirectCorresp)
+		ctx.img = &src_obs.intensityImage;
+		ctx.imgW = src_obs.intensityImage.getWidth();
+		ctx.imgH = src_obs.intensityImage.getHeight();
+		ctx.img_is_color = src_obs.intensityImage.isColor();
+		ctx.img_cx = src_obs.cameraParamsIntensity.cx();
+		ctx.img_cy = src_obs.cameraParamsIntensity.cy();
+		ctx.img_fx = src_obs.cameraParamsIntensity.fx();
+		ctx.img_fy = src_obs.cameraParamsIntensity.fy();
+		// Unless we are in a special case (both depth & RGB images
+		// coincide), precompute the inverse of the pose transformation:
+		ctx.img_direct_corresp = src_obs.doDepthAndIntensityCamerasCoincide();
+		if (!ctx.img_direct_corresp)
 		{
 			mrpt::math::CMatrixFixedNumeric<double, 3, 3> R_inv;
 			mrpt::math::CMatrixFixedNumeric<double, 3, 1> t_inv;
 			mrpt::math::homogeneousMatrixInverse(
 				src_obs.relativePoseIntensityWRTDepth.getRotationMatrix(),
 				src_obs.relativePoseIntensityWRTDepth.m_coords, R_inv, t_inv);
-
-			T_inv(3, 3) = 1;
-			T_inv.block<3, 3>(0, 0) = R_inv.cast<float>();
-			T_inv.block<3, 1>(0, 3) = t_inv.cast<float>();
+			ctx.T_inv.setZero();
+			ctx.T_inv(3, 3) = 1;
+			ctx.T_inv.block<3, 3>(0, 0) = R_inv.cast<float>();
+			ctx.T_inv.block<3, 1>(0, 3) = t_inv.cast<float>();
 		}
+	}
 
-		Eigen::Matrix<float, 4, 1> pt_wrt_color, pt_wrt_depth;
-		pt_wrt_depth[3] = 1;
-
-		mrpt::utils::TColor pCol;
-
-		// For each local point:
-		const size_t nPts = pca.size();
-		for (size_t i = 0; i < nPts; i++)
-		{
-			int img_idx_x, img_idx_y;  // projected pixel coordinates, in the
-			// RGB image plane
-			bool pointWithinImage = false;
-			if (isDirectCorresp)
-			{
-				pointWithinImage = true;
-				img_idx_x = src_obs.points3D_idxs_x[i];
-				img_idx_y = src_obs.points3D_idxs_y[i];
-			}
-			else
-			{
-				// Project point, which is now in "pca" in local coordinates wrt
-				// the depth camera, into the intensity camera:
-				pca.getPointXYZ(
-					i, pt_wrt_depth[0], pt_wrt_depth[1], pt_wrt_depth[2]);
-				pt_wrt_color.noalias() = T_inv * pt_wrt_depth;
-
-				// Project to image plane:
-				if (pt_wrt_color[2])
-				{
-					img_idx_x = mrpt::utils::round(
-						cx + fx * pt_wrt_color[0] / pt_wrt_color[2]);
-					img_idx_y = mrpt::utils::round(
-						cy + fy * pt_wrt_color[1] / pt_wrt_color[2]);
-					pointWithinImage = img_idx_x >= 0 && img_idx_x < imgW &&
-									   img_idx_y >= 0 && img_idx_y < imgH;
-				}
-			}
-
-			if (pointWithinImage)
-			{
-				if (hasColorIntensityImg)
-				{
-					const uint8_t* c = src_obs.intensityImage.get_unsafe(
-						img_idx_x, img_idx_y, 0);
-					pCol.R = c[2];
-					pCol.G = c[1];
-					pCol.B = c[0];
-				}
-				else
-				{
-					uint8_t c = *src_obs.intensityImage.get_unsafe(
-						img_idx_x, img_idx_y, 0);
-					pCol.R = pCol.G = pCol.B = c;
-				}
-			}
-			else
-			{
-				pCol.R = pCol.G = pCol.B = 255;
-			}
-			// Set color:
-			pca.setPointRGBu8(i, pCol.R, pCol.G, pCol.B);
-		}  // end for each point
-	}  // end if src_obs has intensity image
-
-	// ...
-
-	// ------------------------------------------------------------
-	// Stage 3/3: Apply 6D transformations
-	// ------------------------------------------------------------
-	if (projectParams.takeIntoAccountSensorPoseOnRobot ||
-		projectParams.robotPoseInTheWorld)
+	// 6D transformation:
+	ctx.transform = projectParams.takeIntoAccountSensorPoseOnRobot ||
+					projectParams.robotPoseInTheWorld;
+	if (ctx.transform)
 	{
 		mrpt::poses::CPose3D transf_to_apply;  // Either ROBOTPOSE or
 		// ROBOTPOSE(+)SENSORPOSE or
@@ -318,185 +380,79 @@ void project3DPointsFromDepthImageInto(
 			transf_to_apply.composeFrom(
 				*projectParams.robotPoseInTheWorld,
 				mrpt::poses::CPose3D(transf_to_apply));
-
-		const mrpt::math::CMatrixFixedNumeric<float, 4, 4> HM =
-			transf_to_apply.getHomogeneousMatrixVal().cast<float>();
-		Eigen::Matrix<float, 4, 1> pt, pt_transf;
-		pt[3] = 1;
-
-		const size_t nPts = pca.size();
-		for (size_t i = 0; i < nPts; i++)
-		{
-			pca.getPointXYZ(i, pt[0], pt[1], pt[2]);
-			pt_transf.noalias() = HM * pt;
-			pca.setPointXYZ(i, pt_transf[0], pt_transf[1], pt_transf[2]);
-		}
+		ctx.HM = transf_to_apply.getHomogeneousMatrixVal().cast<float>();
 	}
-}  // end of project3DPointsFromDepthImageInto
-
-// Auxiliary functions which implement proyection of 3D point clouds:
-template <class POINTMAP>
-inline void do_project_3d_pointcloud(
-	const int H, const int W, const float* kys, const float* kzs,
-	const mrpt::math::CMatrix& rangeImage,
-	mrpt::utils::PointCloudAdapter<POINTMAP>& pca,
-	std::vector<uint16_t>& idxs_x, std::vector<uint16_t>& idxs_y,
-	const mrpt::obs::TRangeImageFilterParams& fp, bool MAKE_DENSE)
-{
-	TRangeImageFilter rif(fp);
-	// Preconditions: minRangeMask() has the right size
-	size_t idx = 0;
-	for (int r = 0; r < H; r++)
-		for (int c = 0; c < W; c++)
-		{
-			const float D = rangeImage.coeff(r, c);
-			if (!rif.do_range_filter(r, c, D))
-			{
-				if (!MAKE_DENSE)
-				{
-					pca.setInvalidPoint(idx);
-					++idx;
-				}
-				continue;
-			}
-
-			pca.setPointXYZ(idx, D /*x*/, *kys++ * D /*y*/, *kzs++ * D /*z*/);
-			idxs_x[idx] = c;
-			idxs_y[idx] = r;
-			++idx;
-		}
-	pca.resize(idx);
-}
-
-// Auxiliary functions which implement proyection of 3D point clouds:
-template <class POINTMAP>
-inline void do_project_3d_pointcloud_SSE2(
-	const int H, const int W, const float* kys, const float* kzs,
-	const mrpt::math::CMatrix& rangeImage,
-	mrpt::utils::PointCloudAdapter<POINTMAP>& pca,
-	std::vector<uint16_t>& idxs_x, std::vector<uint16_t>& idxs_y,
-	const mrpt::obs::TRangeImageFilterParams& filterParams, bool MAKE_DENSE)
-{
-#if MRPT_HAS_SSE2
-	// Preconditions: minRangeMask() has the right size
-	// Use optimized version:
-	const int W_4 = W >> 2;  // /=4 , since we process 4 values at a time.
-	size_t idx = 0;
-	alignas(16) float xs[4], ys[4], zs[4];
-	const __m128 D_zeros = _mm_set_ps(.0f, .0f, .0f, .0f);
-	const __m128 xormask =
-		(filterParams.rangeCheckBetween)
-			? _mm_cmpneq_ps(D_zeros, D_zeros)
-			:  // want points BETWEEN min and max to be valid
-			_mm_cmpeq_ps(
-				D_zeros,
-				D_zeros);  // want points OUTSIDE of min and max to be valid
-	for (int r = 0; r < H; r++)
-	{
-		const float* D_ptr =
-			&rangeImage.coeffRef(r, 0);  // Matrices are 16-aligned
-		const float* Dgt_ptr =
-			!filterParams.rangeMask_min
-				? nullptr
-				: &filterParams.rangeMask_min->coeffRef(r, 0);
-		const float* Dlt_ptr =
-			!filterParams.rangeMask_max
-				? nullptr
-				: &filterParams.rangeMask_max->coeffRef(r, 0);
-
-		for (int c = 0; c < W_4; c++)
+	else
+		ctx.HM.setIdentity();
+
+	// Project, writing each point straight into its place in the output:
+	const bool MAKE_DENSE = projectParams.MAKE_DENSE;
+	const mrpt::math::CMatrix& rangeImage = src_obs.rangeImage;
+	// Projects rows [first,last), with "idx" the index of its first point.
+	// Returns the index past the last point.
+	auto project_rows = [&](const size_t first, const size_t last, size_t idx) {
+		for (size_t i = first; i < last; i++)
 		{
-			const __m128 D = _mm_load_ps(D_ptr);
-			const __m128 nz_mask = _mm_cmpgt_ps(D, D_zeros);
-			__m128 valid_range_mask;
-			if (!filterParams.rangeMask_min && !filterParams.rangeMask_max)
-			{  // No filter: just skip D=0 points
-				valid_range_mask = nz_mask;
-			}
-			else
-			{
-				if (!filterParams.rangeMask_min || !filterParams.rangeMask_max)
-				{  // Only one filter
-					if (filterParams.rangeMask_min)
+			const int r = ctx.r0 + i * ctx.decimation;
+			project3D_row<true>(
+				rangeImage, ctx, r,
+				[&](int c, bool valid, float x, float y, float z, float X,
+					float Y, float Z) {
+					if (!valid)
 					{
-						const __m128 Dmin = _mm_load_ps(Dgt_ptr);
-						valid_range_mask = _mm_and_ps(
-							_mm_cmpgt_ps(D, Dmin), _mm_cmpgt_ps(Dmin, D_zeros));
+						if (!MAKE_DENSE) pca.setInvalidPoint(idx++);
+						return;
 					}
-					else
+					pca.setPointXYZ(idx, X, Y, Z);
+					if (ctx.img) project3D_color(ctx, r, c, x, y, z, pca, idx);
+					if (save_idxs)
 					{
-						const __m128 Dmax = _mm_load_ps(Dlt_ptr);
-						valid_range_mask = _mm_and_ps(
-							_mm_cmplt_ps(D, Dmax), _mm_cmpgt_ps(Dmax, D_zeros));
+						src_obs.points3D_idxs_x[idx] = c;
+						src_obs.points3D_idxs_y[idx] = r;
 					}
-					valid_range_mask = _mm_and_ps(
-						valid_range_mask, nz_mask);  // Filter out D=0 points
-				}
-				else
-				{
-					// We have both: D>Dmin and D<Dmax conditions, with XOR to
-					// optionally invert the selection:
-					const __m128 Dmin = _mm_load_ps(Dgt_ptr);
-					const __m128 Dmax = _mm_load_ps(Dlt_ptr);
-
-					const __m128 gt_mask = _mm_cmpgt_ps(D, Dmin);
-					const __m128 lt_mask = _mm_and_ps(
-						_mm_cmplt_ps(D, Dmax), nz_mask);  // skip points at zero
-					valid_range_mask =
-						_mm_and_ps(gt_mask, lt_mask);  // (D>Dmin && D<Dmax)
-					valid_range_mask = _mm_xor_ps(valid_range_mask, xormask);
-					// Add the case of D_min & D_max = 0 (no filtering)
-					valid_range_mask = _mm_or_ps(
-						valid_range_mask, _mm_and_ps(
-											  _mm_cmpeq_ps(Dmin, D_zeros),
-											  _mm_cmpeq_ps(Dmax, D_zeros)));
-					// Finally, ensure no invalid ranges get thru:
-					valid_range_mask = _mm_and_ps(valid_range_mask, nz_mask);
-				}
-			}
-			const int valid_range_maski = _mm_movemask_epi8(
-				_mm_castps_si128(valid_range_mask));  // 0x{f|0}{f|0}{f|0}{f|0}
-			if (valid_range_maski != 0)  // Any of the 4 values is valid?
-			{
-				const __m128 KY = _mm_load_ps(kys);
-				const __m128 KZ = _mm_load_ps(kzs);
+					idx++;
+				});
+		}
+		return idx;
+	};
 
-				_mm_storeu_ps(xs, D);
-				_mm_storeu_ps(ys, _mm_mul_ps(KY, D));
-				_mm_storeu_ps(zs, _mm_mul_ps(KZ, D));
+	const size_t nRows = ctx.nRows;
+	if (!projectParams.threadPool)
+	{
+		pca.resize(nRows * ctx.nCols);  // Upper bound
+		pca.resize(project_rows(0, nRows, 0));  // Actual number of points
+		return;
+	}
 
-				for (int q = 0; q < 4; q++)
-					if ((valid_range_maski & (1 << (q * 4))) != 0)
-					{
-						pca.setPointXYZ(idx, xs[q], ys[q], zs[q]);
-						idxs_x[idx] = (c << 2) + q;
-						idxs_y[idx] = r;
-						++idx;
-					}
-					else if (!MAKE_DENSE)
-					{
-						pca.setInvalidPoint(idx);
-						++idx;
-					}
-			}
-			else if (!MAKE_DENSE)
+	// Multithreaded version: split the rows among threads, which requires
+	// counting the valid points of each row first if the output is dense.
+	mrpt::utils::CWorkerThreadsPool& pool = *projectParams.threadPool;
+	// Decode a lazily-read intensity image before the threads need it (which
+	// is thread-safe, but would stall all of them but one):
+	if (ctx.img) ctx.img->forceLoad();
+	std::vector<size_t> row_first_idx(nRows + 1, 0);
+	for (size_t i = 0; i <= nRows; i++) row_first_idx[i] = i * ctx.nCols;
+	if (MAKE_DENSE)
+	{
+		pool.parallelChunks(nRows, [&](size_t first, size_t last, size_t) {
+			for (size_t i = first; i < last; i++)
 			{
-				for (int q = 0; q < 4; q++)
-				{
-					pca.setInvalidPoint(idx);
-					++idx;
-				}
+				size_t n = 0;
+				project3D_row<false>(
+					rangeImage, ctx, ctx.r0 + i * ctx.decimation,
+					[&n](int, bool valid, float, float, float, float, float,
+						 float) { n += valid; });
+				row_first_idx[i + 1] = n;
 			}
-			D_ptr += 4;
-			if (Dgt_ptr) Dgt_ptr += 4;
-			if (Dlt_ptr) Dlt_ptr += 4;
-			kys += 4;
-			kzs += 4;
-		}
+		});
+		for (size_t i = 0; i < nRows; i++)
+			row_first_idx[i + 1] += row_first_idx[i];
 	}
-	pca.resize(idx);
-#endif
-}
+	pca.resize(row_first_idx[nRows]);
+	pool.parallelChunks(nRows, [&](size_t first, size_t last, size_t) {
+		project_rows(first, last, row_first_idx[first]);
+	});
+}  // end of project3DPointsFromDepthImageInto
 
 }  // End of namespace
 }  // End of namespace
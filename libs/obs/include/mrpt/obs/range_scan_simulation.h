@@ -0,0 +1,64 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+#ifndef mrpt_obs_range_scan_simulation_H
+#define mrpt_obs_range_scan_simulation_H
+
+#include <mrpt/obs/CObservation2DRangeScan.h>
+#include <mrpt/obs/CObservation3DRangeScan.h>
+#include <mrpt/opengl/COpenGLScene.h>
+
+namespace mrpt
+{
+namespace utils
+{
+class CWorkerThreadsPool;
+}
+namespace obs
+{
+/** @name Simulation of range sensors in 3D scenes
+	@{ */
+
+/** Simulates a noiseless 2D laser scanner in a 3D scene, by ray tracing the
+ * scene objects (see mrpt::opengl::COpenGLScene::traceRays()).
+ * The input fields \a aperture, \a rightToLeft, \a maxRange and \a
+ * sensorPose of \a inout_scan define the sensor, as in
+ * mrpt::maps::COccupancyGridMap2D::laserScanSimulator(); at output, it
+ * contains \a N ranges, with those rays which don't hit anything within \a
+ * maxRange marked as invalid (and set to maxRange).
+ * \param robotPose The pose of the robot in the scene.
+ * \param threadPool If given, rays are traced in parallel.
+ * \ingroup mrpt_obs_grp
+ */
+void simulateRangeScan(
+	const mrpt::opengl::COpenGLScene& scene,
+	const mrpt::poses::CPose3D& robotPose,
+	mrpt::obs::CObservation2DRangeScan& inout_scan, const size_t N = 361,
+	mrpt::utils::CWorkerThreadsPool* threadPool = nullptr);
+
+/** Simulates a noiseless depth camera in a 3D scene, by ray tracing the
+ * scene objects (see mrpt::opengl::COpenGLScene::traceRays()).
+ * The input fields \a cameraParams (image size and intrinsic parameters),
+ * \a range_is_depth, \a maxRange and \a sensorPose of \a inout_obs define
+ * the sensor; at output, \a rangeImage holds the depth (or range) of each
+ * pixel, with 0 for those which don't hit anything within \a maxRange. The
+ * rest of fields (e.g. 3D points or intensity image) are not modified.
+ * \param robotPose The pose of the robot in the scene.
+ * \param threadPool If given, rays are traced in parallel.
+ * \ingroup mrpt_obs_grp
+ */
+void simulateRangeScan(
+	const mrpt::opengl::COpenGLScene& scene,
+	const mrpt::poses::CPose3D& robotPose,
+	mrpt::obs::CObservation3DRangeScan& inout_obs,
+	mrpt::utils::CWorkerThreadsPool* threadPool = nullptr);
+
+/** @} */
+}
+}
+#endif
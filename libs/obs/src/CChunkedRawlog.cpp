@@ -0,0 +1,484 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include "obs-precomp.h"  // Precompiled headers
+
+#include <mrpt/obs/CChunkedRawlog.h>
+#include <mrpt/obs/CObservation.h>
+#include <mrpt/obs/CSensoryFrame.h>
+#include <mrpt/obs/CActionCollection.h>
+#include <mrpt/compress/zip.h>
+#include <mrpt/utils/CFileInputStream.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#ifdef MRPT_OS_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace mrpt;
+using namespace mrpt::obs;
+using namespace mrpt::utils;
+using namespace mrpt::system;
+
+namespace
+{
+const char HEADER_MAGIC[] = "MRPT-RLC";
+const char INDEX_MAGIC[] = "MRPT-IDX";
+const size_t MAGIC_LEN = 8;
+const uint32_t FORMAT_VERSION = 1;
+const uint64_t HEADER_SIZE = MAGIC_LEN + sizeof(uint32_t);
+const uint64_t FOOTER_SIZE = 3 * sizeof(uint64_t) + MAGIC_LEN;
+
+/** Fills the timestamp and sensor label of an index entry */
+void getEntryTimeAndLabel(const CSerializable& obj, TChunkedRawlogEntry& e)
+{
+	if (const CObservation* o = dynamic_cast<const CObservation*>(&obj))
+	{
+		e.timestamp = o->timestamp;
+		e.sensorLabel = o->sensorLabel;
+	}
+	else if (
+		const CSensoryFrame* sf = dynamic_cast<const CSensoryFrame*>(&obj))
+	{
+		if (sf->size()) e.timestamp = (*sf->begin())->timestamp;
+	}
+	else if (
+		const CActionCollection* acts =
+			dynamic_cast<const CActionCollection*>(&obj))
+	{
+		if (acts->begin() != acts->end())
+			e.timestamp = (*acts->begin())->timestamp;
+	}
+}
+}  // namespace
+
+/*---------------------------------------------------------------
+					CChunkedRawlogWriter
+ ---------------------------------------------------------------*/
+CChunkedRawlogWriter::CChunkedRawlogWriter()
+	: blockSize(1 << 20), m_is_open(false)
+{
+}
+
+CChunkedRawlogWriter::CChunkedRawlogWriter(const std::string& fileName)
+	: blockSize(1 << 20), m_is_open(false)
+{
+	if (!open(fileName))
+		THROW_EXCEPTION_FMT(
+			"Error creating chunked rawlog file: '%s'", fileName.c_str());
+}
+
+CChunkedRawlogWriter::~CChunkedRawlogWriter() { close(); }
+bool CChunkedRawlogWriter::open(const std::string& fileName)
+{
+	close();
+	m_blocks.clear();
+	m_entries.clear();
+	m_block.Clear();
+	if (!m_f.open(fileName)) return false;
+	m_f.WriteBuffer(HEADER_MAGIC, MAGIC_LEN);
+	m_f << FORMAT_VERSION;
+	m_is_open = true;
+	return true;
+}
+
+void CChunkedRawlogWriter::write(const CSerializable& obj)
+{
+	MRPT_START
+	ASSERTMSG_(m_is_open, "write() called without an open file");
+
+	TChunkedRawlogEntry e;
+	e.className = obj.GetRuntimeClass()->className;
+	getEntryTimeAndLabel(obj, e);
+	e.block = static_cast<uint32_t>(m_blocks.size());
+	e.offsetInBlock = m_block.getPosition();
+	m_block.WriteObject(&obj);
+	m_entries.push_back(e);
+
+	if (m_block.getTotalBytesCount() >= blockSize) flushBlock();
+	MRPT_END
+}
+
+void CChunkedRawlogWriter::flushBlock()
+{
+	const uint64_t n = m_block.getTotalBytesCount();
+	if (!n) return;
+
+	std::vector<unsigned char> comp;
+	mrpt::compress::zip::compress(m_block.getRawBufferData(), n, comp);
+
+	TBlockInfo b;
+	b.fileOffset = m_f.getPosition();
+	b.compressedSize = comp.size();
+	b.uncompressedSize = n;
+	m_f.WriteBuffer(&comp[0], comp.size());
+	m_blocks.push_back(b);
+	m_block.Clear();
+}
+
+void CChunkedRawlogWriter::close()
+{
+	if (!m_is_open) return;
+	MRPT_START
+	flushBlock();
+
+	CMemoryStream idx;
+	idx << static_cast<uint64_t>(m_blocks.size());
+	for (const auto& b : m_blocks)
+		idx << b.fileOffset << b.compressedSize << b.uncompressedSize;
+	idx << static_cast<uint64_t>(m_entries.size());
+	for (const auto& e : m_entries)
+		idx << e.timestamp << e.sensorLabel << e.className << e.block
+			<< e.offsetInBlock;
+
+	std::vector<unsigned char> comp;
+	mrpt::compress::zip::compress(
+		idx.getRawBufferData(), idx.getTotalBytesCount(), comp);
+
+	const uint64_t idxOffset = m_f.getPosition();
+	m_f.WriteBuffer(&comp[0], comp.size());
+	m_f << idxOffset << static_cast<uint64_t>(comp.size())
+		<< static_cast<uint64_t>(idx.getTotalBytesCount());
+	m_f.WriteBuffer(INDEX_MAGIC, MAGIC_LEN);
+	m_f.close();
+	m_is_open = false;
+	MRPT_END
+}
+
+/*---------------------------------------------------------------
+				CChunkedRawlogReader::TMappedFile
+ ---------------------------------------------------------------*/
+/** A read-only memory-mapped file, or the file contents loaded into memory if
+ * mapping is not possible. */
+struct CChunkedRawlogReader::TMappedFile
+{
+	const uint8_t* data = nullptr;
+	uint64_t size = 0;
+	bool mmapped = false;
+	/** Only used if the file could not be mapped */
+	std::vector<uint8_t> buf;
+#ifdef MRPT_OS_WINDOWS
+	HANDLE hFile = INVALID_HANDLE_VALUE, hMap = nullptr;
+#endif
+
+	TMappedFile() {}
+	TMappedFile(const TMappedFile&) = delete;
+	TMappedFile& operator=(const TMappedFile&) = delete;
+	~TMappedFile() { unmap(); }
+	bool open(const std::string& fileName)
+	{
+#ifdef MRPT_OS_WINDOWS
+		hFile = CreateFileA(
+			fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (hFile != INVALID_HANDLE_VALUE)
+		{
+			LARGE_INTEGER sz;
+			if (GetFileSizeEx(hFile, &sz) && sz.QuadPart > 0)
+				hMap = CreateFileMappingA(
+					hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (hMap)
+				data = static_cast<const uint8_t*>(
+					MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0));
+			if (data)
+			{
+				size = static_cast<uint64_t>(sz.QuadPart);
+				mmapped = true;
+				return true;
+			}
+			unmap();
+		}
+#else
+		const int fd = ::open(fileName.c_str(), O_RDONLY);
+		if (fd >= 0)
+		{
+			struct stat st;
+			if (::fstat(fd, &st) == 0 && st.st_size > 0)
+			{
+				void* p = ::mmap(
+					nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+					MAP_PRIVATE, fd, 0);
+				if (p != MAP_FAILED)
+				{
+					data = static_cast<const uint8_t*>(p);
+					size = static_cast<uint64_t>(st.st_size);
+					mmapped = true;
+				}
+			}
+			// The mapping remains valid after closing the descriptor:
+			::close(fd);
+			if (mmapped) return true;
+		}
+#endif
+		// Fallback: load the whole file into memory.
+		CFileInputStream f;
+		if (!f.open(fileName)) return false;
+		buf.resize(f.getTotalBytesCount());
+		if (!buf.empty() && f.ReadBuffer(&buf[0], buf.size()) != buf.size())
+			return false;
+		data = buf.empty() ? nullptr : &buf[0];
+		size = buf.size();
+		return true;
+	}
+	void unmap()
+	{
+#ifdef MRPT_OS_WINDOWS
+		if (mmapped) UnmapViewOfFile(data);
+		if (hMap) CloseHandle(hMap);
+		if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
+		hMap = nullptr;
+		hFile = INVALID_HANDLE_VALUE;
+#else
+		if (mmapped) ::munmap(const_cast<uint8_t*>(data), size);
+#endif
+		data = nullptr;
+		size = 0;
+		mmapped = false;
+		buf.clear();
+	}
+};
+
+/*---------------------------------------------------------------
+					CChunkedRawlogReader
+ ---------------------------------------------------------------*/
+CChunkedRawlogReader::CChunkedRawlogReader() : maxCachedBlocks(4) {}
+CChunkedRawlogReader::CChunkedRawlogReader(const std::string& fileName)
+	: maxCachedBlocks(4)
+{
+	if (!open(fileName))
+		THROW_EXCEPTION_FMT(
+			"Error opening chunked rawlog file: '%s'", fileName.c_str());
+}
+
+CChunkedRawlogReader::~CChunkedRawlogReader() { close(); }
+bool CChunkedRawlogReader::is_open() const { return m_file.get() != nullptr; }
+bool CChunkedRawlogReader::isMemoryMapped() const
+{
+	return m_file && m_file->mmapped;
+}
+
+void CChunkedRawlogReader::close()
+{
+	{
+		std::lock_guard<std::mutex> lk(m_cache_mtx);
+		m_cache.clear();
+	}
+	m_blocks.clear();
+	m_entries.clear();
+	m_entries_by_time.clear();
+	m_file.reset();
+}
+
+bool CChunkedRawlogReader::isChunkedRawlogFile(const std::string& fileName)
+{
+	CFileInputStream f;
+	if (!f.open(fileName) || f.getTotalBytesCount() < HEADER_SIZE)
+		return false;
+	char magic[MAGIC_LEN];
+	if (f.ReadBuffer(magic, MAGIC_LEN) != MAGIC_LEN) return false;
+	return 0 == ::memcmp(magic, HEADER_MAGIC, MAGIC_LEN);
+}
+
+bool CChunkedRawlogReader::open(const std::string& fileName)
+{
+	MRPT_START
+	close();
+
+	std::unique_ptr<TMappedFile> f(new TMappedFile);
+	if (!f->open(fileName)) return false;
+	const uint8_t* d = f->data;
+	const uint64_t N = f->size;
+
+	ASSERTMSG_(
+		N >= HEADER_SIZE && 0 == ::memcmp(d, HEADER_MAGIC, MAGIC_LEN),
+		"Not a chunked rawlog file");
+	ASSERTMSG_(
+		N >= HEADER_SIZE + FOOTER_SIZE &&
+			0 == ::memcmp(d + N - MAGIC_LEN, INDEX_MAGIC, MAGIC_LEN),
+		"Truncated chunked rawlog file: missing index");
+
+	CMemoryStream hdr;
+	hdr.assignMemoryNotOwn(d + MAGIC_LEN, sizeof(uint32_t));
+	uint32_t version;
+	hdr >> version;
+	if (version > FORMAT_VERSION)
+		THROW_EXCEPTION_FMT(
+			"Unsupported chunked rawlog format version: %u",
+			static_cast<unsigned int>(version));
+
+	CMemoryStream footer;
+	footer.assignMemoryNotOwn(d + N - FOOTER_SIZE, FOOTER_SIZE);
+	uint64_t idxOffset, idxCompSize, idxSize;
+	footer >> idxOffset >> idxCompSize >> idxSize;
+	ASSERT_(
+		idxOffset >= HEADER_SIZE && idxOffset + idxCompSize <= N - FOOTER_SIZE);
+
+	// Decode the index:
+	std::vector<uint8_t> idxData(idxSize);
+	size_t actualSize = 0;
+	mrpt::compress::zip::decompress(
+		const_cast<uint8_t*>(d + idxOffset), idxCompSize, &idxData[0],
+		idxData.size(), actualSize);
+	ASSERT_EQUAL_(actualSize, idxData.size());
+
+	CMemoryStream idx;
+	idx.assignMemoryNotOwn(&idxData[0], idxData.size());
+	uint64_t nBlocks, nEntries;
+	idx >> nBlocks;
+	m_blocks.resize(nBlocks);
+	for (auto& b : m_blocks)
+	{
+		idx >> b.fileOffset >> b.compressedSize >> b.uncompressedSize;
+		ASSERT_(
+			b.fileOffset >= HEADER_SIZE &&
+			b.fileOffset + b.compressedSize <= idxOffset);
+	}
+	idx >> nEntries;
+	ASSERT_(nEntries <= std::numeric_limits<uint32_t>::max());
+	m_entries.resize(nEntries);
+	for (auto& e : m_entries)
+	{
+		idx >> e.timestamp >> e.sensorLabel >> e.className >> e.block >>
+			e.offsetInBlock;
+		ASSERT_BELOW_(e.block, m_blocks.size());
+		ASSERT_BELOW_(e.offsetInBlock, m_blocks[e.block].uncompressedSize);
+	}
+
+	m_entries_by_time.resize(nEntries);
+	std::iota(m_entries_by_time.begin(), m_entries_by_time.end(), 0);
+	std::stable_sort(
+		m_entries_by_time.begin(), m_entries_by_time.end(),
+		[this](uint32_t a, uint32_t b) {
+			return m_entries[a].timestamp < m_entries[b].timestamp;
+		});
+
+	m_file = std::move(f);
+	return true;
+	MRPT_END_WITH_CLEAN_UP(close(););
+}
+
+size_t CChunkedRawlogReader::findByTime(const TTimeStamp t) const
+{
+	auto it = std::lower_bound(
+		m_entries_by_time.begin(), m_entries_by_time.end(), t,
+		[this](uint32_t i, const TTimeStamp val) {
+			return m_entries[i].timestamp < val;
+		});
+	return it == m_entries_by_time.end() ? m_entries.size() : *it;
+}
+
+void CChunkedRawlogReader::decompressBlock(
+	uint32_t blockIdx, std::vector<uint8_t>& out) const
+{
+	const TBlockInfo& b = m_blocks[blockIdx];
+	out.resize(b.uncompressedSize);
+	size_t actualSize = 0;
+	mrpt::compress::zip::decompress(
+		const_cast<uint8_t*>(m_file->data + b.fileOffset), b.compressedSize,
+		&out[0], out.size(), actualSize);
+	ASSERT_EQUAL_(actualSize, out.size());
+}
+
+CChunkedRawlogReader::block_data_t CChunkedRawlogReader::getBlock(
+	uint32_t blockIdx)
+{
+	auto findInCache = [&]() {
+		for (auto it = m_cache.begin(); it != m_cache.end(); ++it)
+			if (it->first == blockIdx)
+			{
+				m_cache.splice(m_cache.begin(), m_cache, it);
+				return m_cache.front().second;
+			}
+		return block_data_t();
+	};
+	{
+		std::lock_guard<std::mutex> lk(m_cache_mtx);
+		block_data_t data = findInCache();
+		if (data) return data;
+	}
+	// Decompress without holding the lock, so other threads can still use
+	// the cached blocks:
+	block_data_t data = std::make_shared<std::vector<uint8_t>>();
+	decompressBlock(blockIdx, *data);
+
+	std::lock_guard<std::mutex> lk(m_cache_mtx);
+	// Another thread may have decompressed it in the meanwhile:
+	block_data_t other = findInCache();
+	if (other) return other;
+	m_cache.emplace_front(blockIdx, data);
+	while (m_cache.size() > std::max<size_t>(1, maxCachedBlocks))
+		m_cache.pop_back();
+	return data;
+}
+
+CSerializable::Ptr CChunkedRawlogReader::decodeObject(
+	const std::vector<uint8_t>& blockData, uint64_t offset) const
+{
+	ASSERT_BELOW_(offset, blockData.size());
+	CMemoryStream s;
+	s.assignMemoryNotOwn(&blockData[offset], blockData.size() - offset);
+	return s.ReadObject();
+}
+
+CSerializable::Ptr CChunkedRawlogReader::getObject(size_t i)
+{
+	MRPT_START
+	ASSERTMSG_(is_open(), "getObject() called without an open file");
+	ASSERT_BELOW_(i, m_entries.size());
+	const TChunkedRawlogEntry& e = m_entries[i];
+	block_data_t data = getBlock(e.block);
+	return decodeObject(*data, e.offsetInBlock);
+	MRPT_END
+}
+
+void CChunkedRawlogReader::getObjects(
+	size_t first, size_t last, std::vector<CSerializable::Ptr>& out,
+	CWorkerThreadsPool* threadPool)
+{
+	MRPT_START
+	ASSERT_(first <= last && last <= m_entries.size());
+	out.assign(last - first, CSerializable::Ptr());
+	if (first == last) return;
+
+	// Entries are stored in block order, so each range of blocks maps to a
+	// contiguous range of entries:
+	const uint32_t block0 = m_entries[first].block;
+	const size_t nBlocks = m_entries[last - 1].block - block0 + 1;
+
+	auto decodeBlocks = [&](size_t bFirst, size_t bLast, size_t) {
+		auto it = std::lower_bound(
+			m_entries.begin() + first, m_entries.begin() + last,
+			block0 + bFirst,
+			[](const TChunkedRawlogEntry& e, size_t blk) {
+				return e.block < blk;
+			});
+		size_t i = it - m_entries.begin();
+		std::vector<uint8_t> buf;
+		for (size_t b = block0 + bFirst; b < block0 + bLast; b++)
+		{
+			decompressBlock(static_cast<uint32_t>(b), buf);
+			for (; i < last && m_entries[i].block == b; i++)
+				out[i - first] = decodeObject(buf, m_entries[i].offsetInBlock);
+		}
+	};
+	if (threadPool)
+		threadPool->parallelChunks(nBlocks, decodeBlocks);
+	else
+		decodeBlocks(0, nBlocks, 0);
+	MRPT_END
+}
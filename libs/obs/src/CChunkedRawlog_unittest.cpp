@@ -0,0 +1,222 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/obs/CChunkedRawlog.h>
+#include <mrpt/obs/CObservationOdometry.h>
+#include <mrpt/obs/CObservationComment.h>
+#include <mrpt/obs/CSensoryFrame.h>
+#include <mrpt/utils/CFileInputStream.h>
+#include <mrpt/utils/CFileOutputStream.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
+#include <mrpt/system/filesystem.h>
+#include <gtest/gtest.h>
+
+using namespace mrpt;
+using namespace mrpt::obs;
+using namespace mrpt::poses;
+using namespace mrpt::utils;
+using namespace mrpt::system;
+using namespace std;
+
+static const size_t NUM_OBJS = 3000;
+static const TTimeStamp T0 = 131000000000000000ULL;
+
+// Timestamps are not sorted in the file: every 10th object goes back in time.
+static TTimeStamp objTimestamp(size_t i)
+{
+	return T0 + (i % 10 == 9 && i >= 50 ? i - 50 : i) * 10000;
+}
+
+// A mix of odometry observations, comments of varying sizes and sensory
+// frames:
+static CSerializable::Ptr makeObject(size_t i)
+{
+	if (i % 7 == 3)
+	{
+		CObservationComment::Ptr o =
+			mrpt::make_aligned_shared<CObservationComment>();
+		o->timestamp = objTimestamp(i);
+		o->sensorLabel = "COMMENT";
+		o->text = string(i % 200, 'a' + (i % 26));
+		return o;
+	}
+	CObservationOdometry::Ptr o =
+		mrpt::make_aligned_shared<CObservationOdometry>();
+	o->timestamp = objTimestamp(i);
+	o->sensorLabel = (i % 2) ? "ODOM1" : "ODOM2";
+	o->odometry = CPose2D(i * 0.1, -(i * 0.2), i * 1e-3);
+	if (i % 5 != 1) return o;
+
+	CSensoryFrame::Ptr sf = mrpt::make_aligned_shared<CSensoryFrame>();
+	sf->insert(o);
+	return sf;
+}
+
+static void checkObject(size_t i, const CSerializable::Ptr& obj)
+{
+	ASSERT_TRUE(obj);
+	CSerializable::Ptr expected = makeObject(i);
+	EXPECT_EQ(obj->GetRuntimeClass(), expected->GetRuntimeClass());
+	CObservation::Ptr o = std::dynamic_pointer_cast<CObservation>(obj);
+	if (CSensoryFrame::Ptr sf = std::dynamic_pointer_cast<CSensoryFrame>(obj))
+	{
+		ASSERT_EQ(sf->size(), 1u);
+		o = sf->getObservationByIndex(0);
+	}
+	ASSERT_TRUE(o);
+	EXPECT_EQ(o->timestamp, objTimestamp(i));
+	if (CObservationOdometry::Ptr odo =
+			std::dynamic_pointer_cast<CObservationOdometry>(o))
+	{
+		EXPECT_NEAR(odo->odometry.x(), i * 0.1, 1e-9);
+		EXPECT_NEAR(odo->odometry.y(), -(i * 0.2), 1e-9);
+	}
+	else
+	{
+		CObservationComment::Ptr c =
+			std::dynamic_pointer_cast<CObservationComment>(o);
+		ASSERT_TRUE(c);
+		EXPECT_EQ(c->text.size(), i % 200);
+	}
+}
+
+static void writeTestFile(const string& fil)
+{
+	CChunkedRawlogWriter w(fil);
+	// Small blocks, to have many of them:
+	w.blockSize = 4096;
+	for (size_t i = 0; i < NUM_OBJS; i++) w.write(makeObject(i));
+	EXPECT_EQ(w.size(), NUM_OBJS);
+}
+
+TEST(CChunkedRawlog, writeAndRandomAccess)
+{
+	const string fil = getTempFileName();
+	writeTestFile(fil);
+
+	EXPECT_TRUE(CChunkedRawlogReader::isChunkedRawlogFile(fil));
+	CChunkedRawlogReader r(fil);
+	ASSERT_EQ(r.size(), NUM_OBJS);
+	EXPECT_GT(r.blockCount(), 10u);
+
+	// The index:
+	for (size_t i = 0; i < NUM_OBJS; i++)
+	{
+		const TChunkedRawlogEntry& e = r.getEntry(i);
+		EXPECT_EQ(e.timestamp, objTimestamp(i));
+		if (i % 7 == 3)
+		{
+			EXPECT_EQ(e.className, string("CObservationComment"));
+			EXPECT_EQ(e.sensorLabel, string("COMMENT"));
+		}
+		else if (i % 5 == 1)
+		{
+			EXPECT_EQ(e.className, string("CSensoryFrame"));
+			EXPECT_TRUE(e.sensorLabel.empty());
+		}
+		else
+			EXPECT_EQ(e.sensorLabel, string((i % 2) ? "ODOM1" : "ODOM2"));
+	}
+
+	// Random access, in arbitrary order:
+	r.maxCachedBlocks = 2;
+	for (size_t k = 0; k < 500; k++)
+	{
+		const size_t i = (k * 7919) % NUM_OBJS;
+		checkObject(i, r.getObject(i));
+	}
+	// Sequential access:
+	for (size_t i = 0; i < NUM_OBJS; i++) checkObject(i, r.getObject(i));
+
+	EXPECT_TRUE(r.getObjectAs<CObservationOdometry>(0));
+	EXPECT_FALSE(r.getObjectAs<CObservationComment>(0));
+
+	r.close();
+	deleteFile(fil);
+}
+
+TEST(CChunkedRawlog, findByTime)
+{
+	const string fil = getTempFileName();
+	writeTestFile(fil);
+	CChunkedRawlogReader r(fil);
+
+	EXPECT_EQ(r.findByTime(0), 0u);
+	EXPECT_EQ(r.findByTime(T0 + NUM_OBJS * 10000), r.size());
+	for (size_t k = 0; k < 300; k++)
+	{
+		const TTimeStamp t = T0 + (k * 104729) % (NUM_OBJS * 10000);
+		// Brute force search:
+		size_t best = r.size();
+		for (size_t i = 0; i < NUM_OBJS; i++)
+			if (objTimestamp(i) >= t &&
+				(best == r.size() || objTimestamp(i) < objTimestamp(best)))
+				best = i;
+		EXPECT_EQ(r.findByTime(t), best);
+	}
+	r.close();
+	deleteFile(fil);
+}
+
+TEST(CChunkedRawlog, getObjectsInParallel)
+{
+	const string fil = getTempFileName();
+	writeTestFile(fil);
+	CChunkedRawlogReader r(fil);
+
+	CWorkerThreadsPool pool(3);
+	const size_t ranges[][2] = {{0, NUM_OBJS}, {123, 1234}, {500, 501},
+								{NUM_OBJS - 10, NUM_OBJS}, {77, 77}};
+	for (const auto& rng : ranges)
+	{
+		for (int usePool = 0; usePool < 2; usePool++)
+		{
+			std::vector<CSerializable::Ptr> objs;
+			r.getObjects(rng[0], rng[1], objs, usePool ? &pool : nullptr);
+			ASSERT_EQ(objs.size(), rng[1] - rng[0]);
+			for (size_t i = rng[0]; i < rng[1]; i++)
+				checkObject(i, objs[i - rng[0]]);
+		}
+	}
+	r.close();
+	deleteFile(fil);
+}
+
+TEST(CChunkedRawlog, invalidFiles)
+{
+	const string fil = getTempFileName();
+	EXPECT_FALSE(CChunkedRawlogReader::isChunkedRawlogFile(fil + "_none"));
+	CChunkedRawlogReader r;
+	EXPECT_FALSE(r.open(fil + "_none"));
+
+	// A truncated file (e.g. after a crash while recording) has no index:
+	writeTestFile(fil);
+	std::vector<uint8_t> data;
+	{
+		CFileInputStream f(fil);
+		data.resize(f.getTotalBytesCount());
+		f.ReadBuffer(&data[0], data.size());
+	}
+	{
+		CFileOutputStream f(fil);
+		f.WriteBuffer(&data[0], data.size() / 2);
+	}
+	EXPECT_TRUE(CChunkedRawlogReader::isChunkedRawlogFile(fil));
+	EXPECT_THROW(r.open(fil), std::exception);
+	EXPECT_FALSE(r.is_open());
+
+	// Not a chunked rawlog at all:
+	{
+		CFileOutputStream f(fil);
+		f << std::string("This is not a rawlog");
+	}
+	EXPECT_FALSE(CChunkedRawlogReader::isChunkedRawlogFile(fil));
+	EXPECT_THROW(r.open(fil), std::exception);
+	deleteFile(fil);
+}
@@ -74,6 +74,41 @@ double CMetricMap::computeObservationsLikelihood(
 	return lik;
 }
 
+void CMetricMap::computeObservationsLikelihoodBatch(
+	const CSensoryFrame& sf, const std::vector<TPose3D>& takenFrom,
+	std::vector<double>& out_logliks, CWorkerThreadsPool* threadPool)
+{
+	out_logliks.assign(takenFrom.size(), 0.0);
+	std::vector<double> obs_logliks;
+	for (CSensoryFrame::const_iterator it = sf.begin(); it != sf.end(); ++it)
+	{
+		computeObservationLikelihoodBatch(
+			it->get(), takenFrom, obs_logliks, threadPool);
+		for (size_t i = 0; i < out_logliks.size(); i++)
+			out_logliks[i] += obs_logliks[i];
+	}
+}
+
+void CMetricMap::computeObservationLikelihoodBatch(
+	const CObservation* obs, const std::vector<TPose3D>& takenFrom,
+	std::vector<double>& out_logliks, CWorkerThreadsPool* threadPool)
+{
+	out_logliks.assign(takenFrom.size(), 0.0);
+	if (genericMapParams.enableObservationLikelihood && !takenFrom.empty())
+		internal_computeObservationLikelihoodBatch(
+			obs, takenFrom, out_logliks, threadPool);
+}
+
+void CMetricMap::internal_computeObservationLikelihoodBatch(
+	const CObservation* obs, const std::vector<TPose3D>& takenFrom,
+	std::vector<double>& out_logliks, CWorkerThreadsPool* threadPool)
+{
+	MRPT_UNUSED_PARAM(threadPool);
+	for (size_t i = 0; i < takenFrom.size(); i++)
+		out_logliks[i] =
+			internal_computeObservationLikelihood(obs, CPose3D(takenFrom[i]));
+}
+
 double CMetricMap::computeObservationLikelihood(
 	const CObservation* obs, const CPose2D& takenFrom)
 {
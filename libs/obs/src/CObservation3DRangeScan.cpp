@@ -35,10 +35,10 @@ using namespace mrpt::math;
 // This must be added to any CSerializable class implementation file.
 IMPLEMENTS_SERIALIZABLE(CObservation3DRangeScan, CObservation, mrpt::obs)
 
-// Static LUT:
-static CObservation3DRangeScan::TCached3DProjTables lut_3dproj;
+// Static LUT, one per thread so point clouds can be projected in parallel:
 CObservation3DRangeScan::TCached3DProjTables & CObservation3DRangeScan::get_3dproj_lut()
 {
+	static thread_local CObservation3DRangeScan::TCached3DProjTables lut_3dproj;
 	return lut_3dproj;
 }
 
@@ -8,6 +8,13 @@
    +------------------------------------------------------------------------+ */
 
 #include <mrpt/obs/CObservation3DRangeScan.h>
+#include <mrpt/obs/range_scan_simulation.h>
+#include <mrpt/opengl/CTexturedPlane.h>
+#include <mrpt/random.h>
+#include <mrpt/system/filesystem.h>
+#include <mrpt/utils/CFileGZInputStream.h>
+#include <mrpt/utils/CMemoryStream.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
 
 #include <gtest/gtest.h>
 
@@ -192,3 +199,215 @@ TEST(CObservation3DRangeScan, Project3D_filterMax)
 										   << std::endl;
 	}
 }
+
+TEST(CObservation3DRangeScan, Project3D_decimationAndROI)
+{
+	mrpt::obs::T3DPointsProjectionParams pp;
+	mrpt::obs::TRangeImageFilterParams fp;
+
+	for (int i = 0; i < 8; i++)  // test all combinations of flags
+	{
+		mrpt::obs::CObservation3DRangeScan o;
+		fillSampleObs(o, pp, i);
+		// Valid pixels: (r,c) with 10<=c<=r<16
+		pp.decimation = 2;
+		o.project3DPointsFromDepthImageInto(o, pp, fp);
+		EXPECT_EQ(o.points3D_x.size(), 6U) << " testcase flags: i=" << i;
+		for (size_t k = 0; k < o.points3D_x.size(); k++)
+		{
+			EXPECT_EQ(o.points3D_idxs_x[k] % 2, 0);
+			EXPECT_EQ(o.points3D_idxs_y[k] % 2, 0);
+		}
+
+		pp.decimation = 1;
+		pp.roi_row_min = 12;
+		pp.roi_row_max = 15;  // Rows 12,13,14
+		pp.roi_col_min = 11;
+		o.project3DPointsFromDepthImageInto(o, pp, fp);
+		EXPECT_EQ(o.points3D_x.size(), 9U) << " testcase flags: i=" << i;
+
+		pp = mrpt::obs::T3DPointsProjectionParams();
+	}
+}
+
+// Range image with an odd width, invalid pixels and masks, so all the
+// SSE2 blocks and scalar tails are exercised:
+static void fillRandomObs(
+	mrpt::obs::CObservation3DRangeScan& obs, mrpt::math::CMatrix& fMin,
+	mrpt::math::CMatrix& fMax)
+{
+	const int H = 21, W = 37;
+	auto& rnd = mrpt::random::getRandomGenerator();
+	rnd.randomize(123);
+	obs.hasRangeImage = true;
+	obs.rangeImage_setSize(H, W);
+	fMin.setZero(H, W);
+	fMax.setZero(H, W);
+	for (int r = 0; r < H; r++)
+		for (int c = 0; c < W; c++)
+		{
+			obs.rangeImage(r, c) =
+				rnd.drawUniform(0.0, 1.0) < 0.2 ? 0 : rnd.drawUniform(0.5, 5.0);
+			if (rnd.drawUniform(0.0, 1.0) < 0.5) fMin(r, c) = 2.0f;
+			if (rnd.drawUniform(0.0, 1.0) < 0.5) fMax(r, c) = 4.0f;
+		}
+	obs.sensorPose = mrpt::poses::CPose3D(0.1, 0.2, 0.3, 0.4, 0.5, 0.6);
+}
+
+TEST(CObservation3DRangeScan, Project3D_allPathsGiveSameResult)
+{
+	mrpt::math::CMatrix fMin, fMax;
+	mrpt::utils::CWorkerThreadsPool pool(3);
+
+	for (int is_depth = 0; is_depth < 2; is_depth++)
+		for (int f = 0; f < 8; f++)  // masks and rangeCheckBetween
+		{
+			mrpt::obs::TRangeImageFilterParams fp;
+			mrpt::obs::CObservation3DRangeScan ref;
+			fillRandomObs(ref, fMin, fMax);
+			ref.range_is_depth = is_depth != 0;
+			if (f & 1) fp.rangeMask_min = &fMin;
+			if (f & 2) fp.rangeMask_max = &fMax;
+			fp.rangeCheckBetween = (f & 4) != 0;
+
+			mrpt::obs::T3DPointsProjectionParams pp;
+			pp.PROJ3D_USE_LUT = false;
+			pp.USE_SSE2 = false;
+			pp.takeIntoAccountSensorPoseOnRobot = true;
+			ref.project3DPointsFromDepthImageInto(ref, pp, fp);
+
+			// LUT, SSE2 and threads; into itself or another object:
+			for (int i = 0; i < 16; i++)
+			{
+				mrpt::obs::CObservation3DRangeScan o = ref, dest;
+				pp.PROJ3D_USE_LUT = (i & 1) != 0;
+				pp.USE_SSE2 = (i & 2) != 0;
+				pp.threadPool = (i & 4) ? &pool : nullptr;
+				mrpt::obs::CObservation3DRangeScan& out = (i & 8) ? dest : o;
+				o.project3DPointsFromDepthImageInto(out, pp, fp);
+
+				ASSERT_EQ(out.points3D_x.size(), ref.points3D_x.size())
+					<< "f=" << f << " i=" << i;
+				for (size_t k = 0; k < ref.points3D_x.size(); k++)
+				{
+					EXPECT_NEAR(out.points3D_x[k], ref.points3D_x[k], 1e-5f);
+					EXPECT_NEAR(out.points3D_y[k], ref.points3D_y[k], 1e-5f);
+					EXPECT_NEAR(out.points3D_z[k], ref.points3D_z[k], 1e-5f);
+					if (&out == &o)
+					{
+						EXPECT_EQ(
+							out.points3D_idxs_x[k], ref.points3D_idxs_x[k]);
+						EXPECT_EQ(
+							out.points3D_idxs_y[k], ref.points3D_idxs_y[k]);
+					}
+				}
+			}
+		}
+}
+
+TEST(CObservation3DRangeScan, Project3D_rangeIsNotDepth)
+{
+	mrpt::obs::T3DPointsProjectionParams pp;
+	mrpt::obs::TRangeImageFilterParams fp;
+	for (int i = 0; i < 4; i++)
+	{
+		mrpt::obs::CObservation3DRangeScan o;
+		fillSampleObs(o, pp, i);
+		o.range_is_depth = false;
+		o.project3DPointsFromDepthImageInto(o, pp, fp);
+		ASSERT_EQ(o.points3D_x.size(), 21U);
+		for (size_t k = 0; k < o.points3D_x.size(); k++)
+		{
+			// Points must lie at the measured distance from the sensor:
+			const float D = o.rangeImage(
+				o.points3D_idxs_y[k], o.points3D_idxs_x[k]);
+			const float d = std::sqrt(
+				mrpt::utils::square(o.points3D_x[k]) +
+				mrpt::utils::square(o.points3D_y[k]) +
+				mrpt::utils::square(o.points3D_z[k]));
+			EXPECT_NEAR(d, D, 1e-4f) << " testcase flags: i=" << i;
+		}
+	}
+}
+
+// This works also without OpenCV, since images are not decoded:
+TEST(CObservation3DRangeScan, LazyImageDecoding)
+{
+	const string fil = mrpt::utils::MRPT_GLOBAL_UNITTEST_SRC_DIR +
+					   string("/share/mrpt/datasets/tests_rgbd.rawlog");
+	if (!mrpt::system::fileExists(fil))
+	{
+		cerr << "WARNING: Skipping test due to missing file: " << fil << "\n";
+		return;
+	}
+	mrpt::obs::CObservation3DRangeScan o;
+	mrpt::utils::CFileGZInputStream(fil) >> o;
+	ASSERT_TRUE(o.hasIntensityImage);
+	const mrpt::utils::CImage& img = o.intensityImage;
+	EXPECT_TRUE(img.isCompressedResident());
+	EXPECT_EQ(img.getWidth(), size_t(o.rangeImage.cols()));
+	EXPECT_EQ(img.getHeight(), size_t(o.rangeImage.rows()));
+	EXPECT_TRUE(img.isColor());
+
+	// Written again as read:
+	mrpt::utils::CMemoryStream buf1, buf2;
+	buf1 << img;
+	buf1.Seek(0);
+	mrpt::utils::CImage img2;
+	buf1 >> img2;
+	EXPECT_TRUE(img2.isCompressedResident());
+	buf2 << img2;
+	ASSERT_EQ(buf1.getTotalBytesCount(), buf2.getTotalBytesCount());
+	EXPECT_EQ(
+		0, memcmp(
+			   buf1.getRawBufferData(), buf2.getRawBufferData(),
+			   buf1.getTotalBytesCount()));
+}
+
+TEST(CObservation3DRangeScan, SimulateFromScene)
+{
+	// A wall at x=2, in front of the sensor:
+	mrpt::opengl::COpenGLScene scene;
+	mrpt::opengl::CTexturedPlane::Ptr wall =
+		mrpt::opengl::CTexturedPlane::Create(-10, 10, -10, 10);
+	wall->setPose(mrpt::poses::CPose3D(2, 0, 0, 0, mrpt::utils::DEG2RAD(90), 0));
+	scene.insert(wall);
+	const mrpt::poses::CPose3D robotPose(0.5, 0, 0);
+
+	mrpt::obs::CObservation3DRangeScan o;
+	o.cameraParams.ncols = TEST_RANGEIMG_WIDTH;
+	o.cameraParams.nrows = TEST_RANGEIMG_HEIGHT;
+	o.cameraParams.setIntrinsicParamsFromValues(
+		20, 20, TEST_RANGEIMG_WIDTH / 2, TEST_RANGEIMG_HEIGHT / 2);
+	o.maxRange = 10;
+	o.sensorPose = mrpt::poses::CPose3D(0.5, 0, 0);
+	for (int range_is_depth = 0; range_is_depth < 2; range_is_depth++)
+	{
+		o.range_is_depth = range_is_depth != 0;
+		mrpt::obs::simulateRangeScan(scene, robotPose, o);
+		ASSERT_TRUE(o.hasRangeImage);
+		ASSERT_EQ(o.rangeImage.rows(), TEST_RANGEIMG_HEIGHT);
+		ASSERT_EQ(o.rangeImage.cols(), TEST_RANGEIMG_WIDTH);
+		// All points must lie on the wall, 1m ahead of the sensor:
+		o.project3DPointsFromDepthImage();
+		ASSERT_EQ(o.points3D_x.size(), size_t(o.rangeImage.size()));
+		for (size_t k = 0; k < o.points3D_x.size(); k++)
+			EXPECT_NEAR(o.points3D_x[k], 1.0, 1e-4);
+	}
+
+	mrpt::obs::CObservation2DRangeScan scan;
+	scan.aperture = M_PI;
+	scan.maxRange = 10;
+	scan.sensorPose = mrpt::poses::CPose3D(0.5, 0, 0);
+	mrpt::obs::simulateRangeScan(scene, robotPose, scan, 181);
+	ASSERT_EQ(scan.scan.size(), 181u);
+	for (size_t i = 0; i < 181; i++)
+	{
+		// Rays beyond the wall edges or parallel to it are invalid:
+		const double a = mrpt::utils::DEG2RAD(double(i) - 90);
+		const bool valid = std::abs(a) < atan2(10, 1);
+		EXPECT_EQ(valid, scan.getScanRangeValidity(i)) << i;
+		if (valid)
+			EXPECT_NEAR(scan.getScanRange(i), 1.0 / cos(a), 1e-4) << i;
+	}
+}
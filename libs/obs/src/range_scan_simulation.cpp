@@ -0,0 +1,115 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include "obs-precomp.h"  // Precompiled headers
+
+#include <mrpt/obs/range_scan_simulation.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
+
+using namespace mrpt;
+using namespace mrpt::obs;
+using namespace mrpt::math;
+using namespace mrpt::poses;
+using namespace std;
+
+namespace
+{
+/** Rotates a direction from the sensor frame to the world frame */
+inline TPoint3D rotateDirection(
+	const CMatrixDouble33& R, const double x, const double y, const double z)
+{
+	return TPoint3D(
+		R(0, 0) * x + R(0, 1) * y + R(0, 2) * z,
+		R(1, 0) * x + R(1, 1) * y + R(1, 2) * z,
+		R(2, 0) * x + R(2, 1) * y + R(2, 2) * z);
+}
+}
+
+void mrpt::obs::simulateRangeScan(
+	const mrpt::opengl::COpenGLScene& scene, const CPose3D& robotPose,
+	CObservation2DRangeScan& inout_scan, const size_t N,
+	mrpt::utils::CWorkerThreadsPool* threadPool)
+{
+	MRPT_START
+	ASSERT_(N >= 2)
+
+	const CPose3D sensorPose = robotPose + inout_scan.sensorPose;
+	const CMatrixDouble33& R = sensorPose.getRotationMatrix();
+
+	// Same ray angles as COccupancyGridMap2D::laserScanSimulator():
+	const double A0 =
+		(inout_scan.rightToLeft ? -0.5 : +0.5) * inout_scan.aperture;
+	const double AA =
+		(inout_scan.rightToLeft ? 1.0 : -1.0) * (inout_scan.aperture / (N - 1));
+	std::vector<TPoint3D> dirs(N);
+	for (size_t i = 0; i < N; i++)
+	{
+		const double A = A0 + AA * i;
+		dirs[i] = rotateDirection(R, cos(A), sin(A), 0);
+	}
+
+	std::vector<double> dists;
+	scene.traceRays(
+		TPoint3D(sensorPose.x(), sensorPose.y(), sensorPose.z()), dirs, dists,
+		threadPool);
+
+	inout_scan.resizeScan(N);
+	for (size_t i = 0; i < N; i++)
+	{
+		const bool valid = dists[i] <= inout_scan.maxRange;
+		inout_scan.setScanRange(i, valid ? dists[i] : inout_scan.maxRange);
+		inout_scan.setScanRangeValidity(i, valid);
+	}
+	MRPT_END
+}
+
+void mrpt::obs::simulateRangeScan(
+	const mrpt::opengl::COpenGLScene& scene, const CPose3D& robotPose,
+	CObservation3DRangeScan& inout_obs,
+	mrpt::utils::CWorkerThreadsPool* threadPool)
+{
+	MRPT_START
+	const mrpt::utils::TCamera& cam = inout_obs.cameraParams;
+	const int W = cam.ncols, H = cam.nrows;
+	ASSERT_(W > 0 && H > 0)
+
+	const CPose3D sensorPose = robotPose + inout_obs.sensorPose;
+	const CMatrixDouble33& R = sensorPose.getRotationMatrix();
+
+	// Pixel rays, in the sensor frame (+X forward), as in
+	// CObservation3DRangeScan::project3DPointsFromDepthImageInto():
+	const double cx = cam.cx(), cy = cam.cy(), fx_inv = 1.0 / cam.fx(),
+				 fy_inv = 1.0 / cam.fy();
+	std::vector<TPoint3D> dirs(size_t(W) * H);
+	std::vector<double> depthFactor(dirs.size());
+	for (int r = 0, i = 0; r < H; r++)
+		for (int c = 0; c < W; c++, i++)
+		{
+			const double Ky = (cx - c) * fx_inv, Kz = (cy - r) * fy_inv;
+			dirs[i] = rotateDirection(R, 1, Ky, Kz);
+			depthFactor[i] = 1.0 / std::sqrt(1 + Ky * Ky + Kz * Kz);
+		}
+
+	std::vector<double> dists;
+	scene.traceRays(
+		TPoint3D(sensorPose.x(), sensorPose.y(), sensorPose.z()), dirs, dists,
+		threadPool);
+
+	inout_obs.hasRangeImage = true;
+	inout_obs.rangeImage_setSize(H, W);
+	for (int r = 0, i = 0; r < H; r++)
+		for (int c = 0; c < W; c++, i++)
+		{
+			const double D = inout_obs.range_is_depth
+								 ? dists[i] * depthFactor[i]
+								 : dists[i];
+			inout_obs.rangeImage(r, c) = D <= inout_obs.maxRange ? D : 0;
+		}
+	MRPT_END
+}
@@ -16,6 +16,7 @@
 #include <mrpt/opengl/CRenderizableDisplayList.h>
 #include <mrpt/opengl/COpenGLScene.h>
 #include <mrpt/opengl/COpenGLViewport.h>
+#include <mrpt/opengl/CRayTracingBVH.h>
 
 #include <mrpt/opengl/CArrow.h>
 #include <mrpt/opengl/CAxis.h>
@@ -79,6 +79,8 @@ class CBox : public CRenderizableDisplayList
 	  * \sa mrpt::opengl::CRenderizable
 	  */
 	bool traceRay(const mrpt::poses::CPose3D& o, double& dist) const override;
+	bool getTrianglesForRayTracing(
+		std::vector<mrpt::math::TPoint3D>& tris) const override;
 
 	inline void setLineWidth(float width)
 	{
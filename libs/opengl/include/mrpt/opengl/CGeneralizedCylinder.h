@@ -152,6 +152,8 @@ class CGeneralizedCylinder : public CRenderizableDisplayList
 	  * \sa mrpt::opengl::CRenderizable.
 	  */
 	bool traceRay(const mrpt::poses::CPose3D& o, double& dist) const override;
+	bool getTrianglesForRayTracing(
+		std::vector<mrpt::math::TPoint3D>& tris) const override;
 	/**
 	  * Get axis's spatial coordinates.
 	  */
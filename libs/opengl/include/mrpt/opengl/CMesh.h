@@ -252,6 +252,8 @@ class CMesh : public CRenderizableDisplayList
 	/** Trace ray
 	  */
 	bool traceRay(const mrpt::poses::CPose3D& o, double& dist) const override;
+	bool getTrianglesForRayTracing(
+		std::vector<mrpt::math::TPoint3D>& tris) const override;
 
 	/** Constructor  */
 	CMesh(
@@ -11,6 +11,7 @@
 
 #include <mrpt/opengl/CRenderizable.h>
 #include <mrpt/opengl/COpenGLViewport.h>
+#include <mrpt/opengl/CRayTracingBVH.h>
 #include <mrpt/utils/CStringList.h>
 
 namespace mrpt
@@ -206,10 +207,31 @@ class COpenGLScene : public mrpt::utils::CSerializable
 	  */
 	bool loadFromFile(const std::string& fil);
 
-	/** Traces a ray
+	/** Traces a ray: returns true if it hits any object in the scene, and
+	 * the distance to the nearest one in "dist". See CRenderizable::traceRay().
+	 * Unless TRACERAY_USE_BVH is false, the first call builds a bounding
+	 * volume hierarchy (see CRayTracingBVH) which makes the following calls
+	 * much faster, and is kept up to date as the scene changes.
+	 * \sa traceRays
 	  */
 	bool traceRay(const mrpt::poses::CPose3D& o, double& dist) const;
 
+	/** Traces a set of rays from a common origin (e.g. a range sensor) in
+	 * one call, which saves the per-call checks of changes in the scene,
+	 * traces rays in packets and optionally in parallel. See
+	 * CRayTracingBVH::traceRays() for the meaning of the arguments: rays
+	 * which hit nothing get an infinite distance.
+	 */
+	void traceRays(
+		const mrpt::math::TPoint3D& origin,
+		const std::vector<mrpt::math::TPoint3D>& directions,
+		std::vector<double>& dists,
+		mrpt::utils::CWorkerThreadsPool* threadPool = nullptr) const;
+
+	/** If true (default), traceRay() and traceRays() use a bounding volume
+	 * hierarchy; false means testing all the objects for each ray. */
+	static bool TRACERAY_USE_BVH;
+
 	/** Evaluates the bounding box of the scene in the given viewport (default:
 	 * "main"). */
 	void getBoundingBox(
@@ -247,6 +269,8 @@ class COpenGLScene : public mrpt::utils::CSerializable
 	}
 
    protected:
+	friend class CRayTracingBVH;
+
 	bool m_followCamera;
 
 	typedef std::vector<COpenGLViewport::Ptr> TListViewports;
@@ -254,6 +278,9 @@ class COpenGLScene : public mrpt::utils::CSerializable
 	/** The list of viewports, indexed by name. */
 	TListViewports m_viewports;
 
+	/** Built on demand for traceRay() and traceRays() */
+	mutable CRayTracingBVH m_bvh;
+
 	template <typename FUNCTOR>
 	static void internal_visitAllObjects(
 		FUNCTOR functor, const CRenderizable::Ptr& o)
@@ -657,6 +657,8 @@ class CPolyhedron : public CRenderizableDisplayList
 	  * \sa CRenderizable
 	  */
 	bool traceRay(const mrpt::poses::CPose3D& o, double& dist) const override;
+	bool getTrianglesForRayTracing(
+		std::vector<mrpt::math::TPoint3D>& tris) const override;
 	/**
 	  * Gets a list with the polyhedron's vertices.
 	  */
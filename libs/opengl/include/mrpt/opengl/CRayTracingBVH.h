@@ -0,0 +1,163 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+#ifndef opengl_CRayTracingBVH_H
+#define opengl_CRayTracingBVH_H
+
+#include <mrpt/opengl/CRenderizable.h>
+#include <mrpt/utils/aligned_containers.h>
+#include <mutex>
+#include <vector>
+
+namespace mrpt
+{
+namespace utils
+{
+class CWorkerThreadsPool;
+}
+namespace opengl
+{
+class COpenGLScene;
+
+/** A bounding volume hierarchy (BVH) over all the objects of a COpenGLScene,
+ * in world coordinates, which accelerates COpenGLScene::traceRay() and
+ * COpenGLScene::traceRays().
+ *
+ * Objects which expose their geometry as triangles (see
+ * CRenderizable::getTrianglesForRayTracing()) contribute each of their
+ * triangles as a leaf of the tree; any other object becomes one leaf bounded
+ * by its CRenderizable::getBoundingBox(), and its own traceRay() is invoked
+ * for the rays reaching that box. The tree is built with a binned surface area
+ * heuristic (SAH).
+ *
+ * update() keeps the hierarchy in sync with the scene: it is rebuilt if
+ * objects were added, removed or modified (see
+ * CRenderizable::getGeometryVersion()), while the boxes are only refit if
+ * some objects just changed their poses.
+ *
+ * Rays are traced in packets of PACKET_SIZE rays which share the traversal of
+ * the tree, and packets can be distributed among the threads of a
+ * mrpt::utils::CWorkerThreadsPool.
+ *
+ * \note Distances are those of CRenderizable::traceRay(): to the nearest
+ * intersection along the ray, ignoring the scale factors of the objects.
+ * \note The scene must not be modified while tracing rays.
+ * \ingroup mrpt_opengl_grp
+ */
+class CRayTracingBVH
+{
+   public:
+	/** Number of rays traced together by traceRays() */
+	static const size_t PACKET_SIZE = 8;
+
+	CRayTracingBVH();
+	/** Copies are empty, since they would refer to the objects of another
+	 * scene. */
+	CRayTracingBVH(const CRayTracingBVH& o);
+	CRayTracingBVH& operator=(const CRayTracingBVH& o);
+
+	/** Rebuilds or refits the hierarchy if the scene changed since the last
+	 * call. Thread-safe. */
+	void update(const COpenGLScene& scene);
+
+	/** Frees all the memory. The next update() will rebuild the hierarchy. */
+	void clear();
+
+	/** Traces one ray: same interface as CRenderizable::traceRay(), for the
+	 * scene given to the last update(). */
+	bool traceRay(const mrpt::poses::CPose3D& o, double& dist) const;
+
+	/** Traces a set of rays from a common origin. \a directions need not be
+	 * unit vectors. At output, \a dists holds the distance from the origin to
+	 * the nearest intersection of each ray, or
+	 * std::numeric_limits<double>::infinity() if it hits nothing. Packets are
+	 * made of consecutive rays, so they should be ordered such as neighbors
+	 * are close to each other (e.g. in the order of a scan or image rows).
+	 * \param threadPool If given, packets are traced in parallel: then, the
+	 * traceRay() method of the objects not indexed as triangles must be
+	 * thread-safe (as it is in all MRPT classes). */
+	void traceRays(
+		const mrpt::math::TPoint3D& origin,
+		const std::vector<mrpt::math::TPoint3D>& directions,
+		std::vector<double>& dists,
+		mrpt::utils::CWorkerThreadsPool* threadPool = nullptr) const;
+
+	/** Number of triangles indexed in the tree */
+	size_t getTrianglesCount() const { return m_tris.size(); }
+	/** Number of objects traced with their own traceRay() method */
+	size_t getPrimitivesCount() const { return m_prims.size(); }
+	/** Number of nodes in the tree */
+	size_t getNodesCount() const { return m_nodes.size(); }
+
+   private:
+	/** Each non-container object of the scene, in depth-first order */
+	struct TObjectEntry
+	{
+		const CRenderizable* obj;
+		uint64_t version;
+		/** Poses of the parent and the object itself, in world coordinates */
+		mrpt::poses::CPose3D parentPose, pose;
+		/** Range of triangles in m_tris, or index in m_prims for primitives */
+		size_t first, numTris;
+		bool isPrimitive;
+	};
+	/** A triangle: one vertex and two edges, ready for the Moller-Trumbore
+	 * intersection test */
+	struct TTriangle
+	{
+		double v0[3], e1[3], e2[3];
+	};
+	/** An object traced with its own traceRay() */
+	struct TPrimitive
+	{
+		const CRenderizable* obj;
+		/** Inverse of the world pose of its parent */
+		mrpt::poses::CPose3D invParentPose;
+		double bb_min[3], bb_max[3];
+		/** false: the box is unknown and it's tested against all rays */
+		bool bounded;
+	};
+	struct TNode
+	{
+		double bb_min[3], bb_max[3];
+		/** Leaves (count>0): items [first,first+count) of m_items. Inner
+		 * nodes (count=0): children are first and first+1. */
+		uint32_t first, count;
+		/** Split axis of inner nodes, whose first child is the lower one */
+		uint8_t axis;
+	};
+	struct TPacket;
+
+	mrpt::aligned_containers<TObjectEntry>::vector_t m_objects;
+	std::vector<TTriangle> m_tris;
+	mrpt::aligned_containers<TPrimitive>::vector_t m_prims;
+	/** Indices in m_prims of primitives without a bounding box */
+	std::vector<size_t> m_unbounded;
+	/** Leaf items: triangle indices, or m_tris.size()+primitive index */
+	std::vector<uint32_t> m_items;
+	std::vector<TNode> m_nodes;
+	size_t m_treeDepth;
+	std::mutex m_update_mtx;
+
+	void rebuild();
+	/** Updates the objects in \a moved, then the boxes of all nodes.
+	 * \return false if the tree must be rebuilt instead. */
+	bool refit(const std::vector<size_t>& moved);
+	bool setPrimitive(TPrimitive& p, const TObjectEntry& e) const;
+	void setTriangles(
+		const TObjectEntry& e, const std::vector<mrpt::math::TPoint3D>& local);
+	void itemBox(uint32_t item, double bb_min[3], double bb_max[3]) const;
+	void buildTree();
+	void refitTree();
+	void tracePacket(TPacket& pk, std::vector<uint64_t>& stack) const;
+};
+
+}  // end namespace
+}  // End of namespace
+
+#endif
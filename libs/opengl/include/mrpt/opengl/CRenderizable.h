@@ -59,6 +59,8 @@ class CRenderizable : public mrpt::utils::CSerializable
 	float m_scale_x, m_scale_y, m_scale_z;
 	/** Is the object visible? (default=true) */
 	bool m_visible;
+	/** See getGeometryVersion() */
+	mutable uint64_t m_geometryVersion;
 
    public:
 	/** @name Changes the appearance of the object to render
@@ -289,6 +291,25 @@ class CRenderizable : public mrpt::utils::CSerializable
 	  */
 	virtual bool traceRay(const mrpt::poses::CPose3D& o, double& dist) const;
 
+	/** Fills \a tris with the triangles (three consecutive points each, in the
+	 * object local frame) against which traceRay() is evaluated, so ray tracing
+	 * accelerators can index them instead of calling traceRay().
+	 * \return false (the default) if the object has no such representation.
+	 * \sa COpenGLScene::traceRay, CRayTracingBVH */
+	virtual bool getTrianglesForRayTracing(
+		std::vector<mrpt::math::TPoint3D>& tris) const
+	{
+		MRPT_UNUSED_PARAM(tris);
+		return false;
+	}
+
+	/** Returns an identifier of the current geometry of the object: a new,
+	 * globally unique value is assigned on construction and each time the
+	 * object notifies a change (see CRenderizableDisplayList::notifyChange()),
+	 * so that caches of derived data (e.g. CRayTracingBVH) can tell when they
+	 * are outdated. Changes of the object pose are not included. */
+	inline uint64_t getGeometryVersion() const { return m_geometryVersion; }
+
 	/** This method is safe for calling from within ::render() methods \sa
 	 * renderTextBitmap, mrpt::opengl::gl_utils */
 	static void renderTextBitmap(const char* str, void* fontStyle);
@@ -335,6 +356,9 @@ class CRenderizable : public mrpt::utils::CSerializable
 	 * cool).  */
 	static unsigned int getNewTextureNumber();
 	static void releaseTextureName(unsigned int i);
+
+	/** Assigns a new value to the geometry version \sa getGeometryVersion */
+	void newGeometryVersion() const;
 };
 /** A list of objects pointers, automatically managing memory free at
  * destructor, and managing copies correctly. */
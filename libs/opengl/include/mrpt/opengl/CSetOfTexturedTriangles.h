@@ -99,6 +99,8 @@ class CSetOfTexturedTriangles : public CTexturedObject
 
 	virtual bool traceRay(
 		const mrpt::poses::CPose3D& o, double& dist) const override;
+	virtual bool getTrianglesForRayTracing(
+		std::vector<mrpt::math::TPoint3D>& tris) const override;
 
 	/** Constructor
 	  */
@@ -163,6 +163,8 @@ class CSetOfTriangles : public CRenderizableDisplayList
 	/** Ray tracing
 	  */
 	bool traceRay(const mrpt::poses::CPose3D& o, double& dist) const override;
+	bool getTrianglesForRayTracing(
+		std::vector<mrpt::math::TPoint3D>& tris) const override;
 
 	/**
 	  * Gets the polygon cache.
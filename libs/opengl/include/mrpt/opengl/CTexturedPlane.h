@@ -78,6 +78,8 @@ class CTexturedPlane : public CTexturedObject
 
 	virtual bool traceRay(
 		const mrpt::poses::CPose3D& o, double& dist) const override;
+	virtual bool getTrianglesForRayTracing(
+		std::vector<mrpt::math::TPoint3D>& tris) const override;
 	virtual void getBoundingBox(
 		mrpt::math::TPoint3D& bb_min,
 		mrpt::math::TPoint3D& bb_max) const override;
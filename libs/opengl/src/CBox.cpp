@@ -273,6 +273,26 @@ bool CBox::traceRay(const mrpt::poses::CPose3D& o, double& dist) const
 	THROW_EXCEPTION("TO DO")
 }
 
+bool CBox::getTrianglesForRayTracing(
+	std::vector<mrpt::math::TPoint3D>& tris) const
+{
+	// Corner "i" takes its (x,y,z) from the max. corner if bit (0,1,2) is set:
+	mrpt::math::TPoint3D c[8];
+	for (int i = 0; i < 8; i++)
+		c[i] = mrpt::math::TPoint3D(
+			(i & 1) ? m_corner_max.x : m_corner_min.x,
+			(i & 2) ? m_corner_max.y : m_corner_min.y,
+			(i & 4) ? m_corner_max.z : m_corner_min.z);
+	// Two triangles per face:
+	static const int faces[6][4] = {{0, 1, 3, 2}, {4, 5, 7, 6}, {0, 1, 5, 4},
+									{2, 3, 7, 6}, {0, 2, 6, 4}, {1, 3, 7, 5}};
+	tris.clear();
+	for (const auto& f : faces)
+		tris.insert(
+			tris.end(), {c[f[0]], c[f[1]], c[f[2]], c[f[0]], c[f[2]], c[f[3]]});
+	return true;
+}
+
 void CBox::getBoundingBox(
 	mrpt::math::TPoint3D& bb_min, mrpt::math::TPoint3D& bb_max) const
 {
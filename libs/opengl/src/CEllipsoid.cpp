@@ -155,8 +155,9 @@ void CEllipsoid::render_dl() const
 				m_quantiles *
 				std::max(
 					m_eigVal(0, 0), std::max(m_eigVal(1, 1), m_eigVal(2, 2)));
-			m_bb_min = mrpt::math::TPoint3D(-max_radius, -max_radius, 0);
-			m_bb_max = mrpt::math::TPoint3D(max_radius, max_radius, 0);
+			m_bb_min =
+				mrpt::math::TPoint3D(-max_radius, -max_radius, -max_radius);
+			m_bb_max = mrpt::math::TPoint3D(max_radius, max_radius, max_radius);
 			// Convert to coordinates of my parent:
 			m_pose.composePoint(m_bb_min, m_bb_min);
 			m_pose.composePoint(m_bb_max, m_bb_max);
@@ -131,6 +131,20 @@ bool CGeneralizedCylinder::traceRay(const CPose3D& o, double& dist) const
 	return math::traceRay(polys, o - this->m_pose, dist);
 }
 
+bool CGeneralizedCylinder::getTrianglesForRayTracing(
+	std::vector<TPoint3D>& tris) const
+{
+	if (!meshUpToDate) updateMesh();
+	tris.clear();
+	tris.reserve(6 * mesh.size());
+	for (const auto& q : mesh)
+	{
+		const TPoint3D* p = q.points;
+		tris.insert(tris.end(), {p[0], p[1], p[2], p[0], p[2], p[3]});
+	}
+	return true;
+}
+
 void CGeneralizedCylinder::updateMesh() const
 {
 	CRenderizableDisplayList::notifyChange();
@@ -569,6 +569,19 @@ bool CMesh::traceRay(const mrpt::poses::CPose3D& o, double& dist) const
 	return mrpt::math::traceRay(tmpPolys, o - this->m_pose, dist);
 }
 
+bool CMesh::getTrianglesForRayTracing(
+	std::vector<mrpt::math::TPoint3D>& tris) const
+{
+	if (!trianglesUpToDate) updateTriangles();
+	tris.clear();
+	tris.reserve(3 * actualMesh.size());
+	for (const auto& m : actualMesh)
+		for (int i = 0; i < 3; i++)
+			tris.push_back(
+				mrpt::math::TPoint3D(m.first.x[i], m.first.y[i], m.first.z[i]));
+	return true;
+}
+
 static math::TPolygon3D tmpPoly(3);
 mrpt::math::TPolygonWithPlane createPolygonFromTriangle(
 	const std::pair<CSetOfTriangles::TTriangle, CMesh::TTriangleVertexIndices>&
@@ -15,6 +15,7 @@
 #include <mrpt/utils/CStringList.h>
 #include <mrpt/utils/metaprogramming.h>
 #include <mrpt/utils/CStream.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
 
 #include <mrpt/utils/CFileGZOutputStream.h>
 #include <mrpt/utils/CFileGZInputStream.h>
@@ -40,6 +41,8 @@ using namespace std;
 
 IMPLEMENTS_SERIALIZABLE(COpenGLScene, CRenderizableDisplayList, mrpt::opengl)
 
+bool COpenGLScene::TRACERAY_USE_BVH = true;
+
 /*---------------------------------------------------------------
 						Constructor
 ---------------------------------------------------------------*/
@@ -62,6 +65,7 @@ COpenGLScene::~COpenGLScene() { clear(false); }
 void COpenGLScene::clear(bool createMainViewport)
 {
 	m_viewports.clear();
+	m_bvh.clear();
 
 	if (createMainViewport) createViewport("main");
 }
@@ -293,6 +297,12 @@ void COpenGLScene::removeObject(
 
 bool COpenGLScene::traceRay(const mrpt::poses::CPose3D& o, double& dist) const
 {
+	if (TRACERAY_USE_BVH)
+	{
+		m_bvh.update(*this);
+		return m_bvh.traceRay(o, dist);
+	}
+
 	bool found = false;
 	double tmp;
 	for (TListViewports::const_iterator it = m_viewports.begin();
@@ -315,6 +325,34 @@ bool COpenGLScene::traceRay(const mrpt::poses::CPose3D& o, double& dist) const
 	return found;
 }
 
+void COpenGLScene::traceRays(
+	const mrpt::math::TPoint3D& origin, const std::vector<TPoint3D>& directions,
+	std::vector<double>& dists, CWorkerThreadsPool* threadPool) const
+{
+	if (TRACERAY_USE_BVH)
+	{
+		m_bvh.update(*this);
+		m_bvh.traceRays(origin, directions, dists, threadPool);
+		return;
+	}
+
+	dists.resize(directions.size());
+	for (size_t i = 0; i < directions.size(); i++)
+	{
+		const TPoint3D& d = directions[i];
+		double dist;
+		dists[i] =
+			d.norm() > 0 &&
+					traceRay(
+						mrpt::poses::CPose3D(
+							origin.x, origin.y, origin.z, atan2(d.y, d.x),
+							atan2(-d.z, hypot(d.x, d.y)), 0),
+						dist)
+				? dist
+				: std::numeric_limits<double>::infinity();
+	}
+}
+
 bool COpenGLScene::saveToFile(const std::string& fil) const
 {
 	try
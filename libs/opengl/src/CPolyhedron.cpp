@@ -1109,6 +1109,21 @@ bool CPolyhedron::traceRay(const mrpt::poses::CPose3D& o, double& dist) const
 	return math::traceRay(tempPolygons, o - this->m_pose, dist);
 }
 
+bool CPolyhedron::getTrianglesForRayTracing(
+	std::vector<mrpt::math::TPoint3D>& tris) const
+{
+	// Faces are convex, so they can be split as triangle fans:
+	tris.clear();
+	for (const auto& f : mFaces)
+		for (size_t i = 2; i < f.vertices.size(); i++)
+		{
+			tris.push_back(mVertices[f.vertices[0]]);
+			tris.push_back(mVertices[f.vertices[i - 1]]);
+			tris.push_back(mVertices[f.vertices[i]]);
+		}
+	return true;
+}
+
 void CPolyhedron::getEdgesLength(std::vector<double>& lengths) const
 {
 	lengths.resize(mEdges.size());
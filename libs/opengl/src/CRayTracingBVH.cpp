@@ -0,0 +1,668 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include "opengl-precomp.h"  // Precompiled header
+
+#include <mrpt/opengl/CRayTracingBVH.h>
+#include <mrpt/opengl/COpenGLScene.h>
+#include <mrpt/opengl/CSetOfObjects.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <cmath>
+
+using namespace mrpt;
+using namespace mrpt::opengl;
+using namespace mrpt::poses;
+using namespace mrpt::math;
+using namespace std;
+
+namespace
+{
+/** Leaves with up to this number of items are never split */
+const size_t BVH_MIN_LEAF_SIZE = 4;
+/** Leaves with more items than this are always split (if possible) */
+const size_t BVH_MAX_LEAF_SIZE = 16;
+/** Number of bins for evaluating the SAH cost of splits */
+const int BVH_NUM_BINS = 16;
+
+/** Exact comparison (CPose3D::operator== has some tolerance) */
+bool samePose(const CPose3D& a, const CPose3D& b)
+{
+	return a.x() == b.x() && a.y() == b.y() && a.z() == b.z() &&
+		   a.getRotationMatrix() == b.getRotationMatrix();
+}
+
+inline void boxReset(double bb_min[3], double bb_max[3])
+{
+	for (int a = 0; a < 3; a++)
+	{
+		bb_min[a] = std::numeric_limits<double>::max();
+		bb_max[a] = -std::numeric_limits<double>::max();
+	}
+}
+
+inline void boxExtend(
+	double bb_min[3], double bb_max[3], const double o_min[3],
+	const double o_max[3])
+{
+	for (int a = 0; a < 3; a++)
+	{
+		bb_min[a] = std::min(bb_min[a], o_min[a]);
+		bb_max[a] = std::max(bb_max[a], o_max[a]);
+	}
+}
+
+/** Enlarges a box by a tiny margin, so rays grazing its faces, or hitting
+ * flat boxes, are not lost to round-off errors */
+inline void boxPad(double bb_min[3], double bb_max[3])
+{
+	for (int a = 0; a < 3; a++)
+	{
+		bb_min[a] -= 1e-9 * (1.0 + std::abs(bb_min[a]));
+		bb_max[a] += 1e-9 * (1.0 + std::abs(bb_max[a]));
+	}
+}
+
+inline double boxHalfArea(const double bb_min[3], const double bb_max[3])
+{
+	const double dx = bb_max[0] - bb_min[0], dy = bb_max[1] - bb_min[1],
+				 dz = bb_max[2] - bb_min[2];
+	return dx * dy + dy * dz + dz * dx;
+}
+
+inline void cross(const double a[3], const double b[3], double r[3])
+{
+	r[0] = a[1] * b[2] - a[2] * b[1];
+	r[1] = a[2] * b[0] - a[0] * b[2];
+	r[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+inline double dot(const double a[3], const double b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+}  // namespace
+
+struct CRayTracingBVH::TPacket
+{
+	size_t K;
+	double o[3];
+	/** Unit directions and their inverses */
+	double d[PACKET_SIZE][3], inv_d[PACKET_SIZE][3];
+	/** Distance to the nearest hit so far */
+	double best[PACKET_SIZE];
+	/** If not null (only for K=1), the pose given to traceRay() */
+	const CPose3D* rayPose;
+
+	/** Sets the direction of ray k, returning false if it is null */
+	bool setDirection(size_t k, const double dir[3])
+	{
+		const double n = std::sqrt(dot(dir, dir));
+		best[k] = std::numeric_limits<double>::infinity();
+		for (int a = 0; a < 3; a++)
+		{
+			d[k][a] = n > 0 ? dir[a] / n : 0;
+			// Avoid infinities (and NaNs in the slab test) for axis-aligned
+			// rays:
+			const double da = std::abs(d[k][a]) < 1e-15
+								  ? (d[k][a] < 0 ? -1e-15 : 1e-15)
+								  : d[k][a];
+			inv_d[k][a] = 1.0 / da;
+		}
+		return n > 0;
+	}
+
+	/** Slab test of ray k against a box, within [0,best] */
+	inline bool hitsBox(
+		size_t k, const double bb_min[3], const double bb_max[3]) const
+	{
+		double t0 = 0, t1 = best[k];
+		for (int a = 0; a < 3; a++)
+		{
+			double ta = (bb_min[a] - o[a]) * inv_d[k][a];
+			double tb = (bb_max[a] - o[a]) * inv_d[k][a];
+			if (ta > tb) std::swap(ta, tb);
+			if (ta > t0) t0 = ta;
+			if (tb < t1) t1 = tb;
+		}
+		return t0 <= t1;
+	}
+
+	/** Moller-Trumbore intersection test of ray k against a triangle. The
+	 * barycentric coordinates have a small tolerance so rays through a shared
+	 * edge don't slip between both triangles due to round-off errors. */
+	inline void hitTriangle(size_t k, const TTriangle& t)
+	{
+		const double eps = 1e-9;
+		double p[3], q[3], s[3];
+		cross(d[k], t.e2, p);
+		const double det = dot(t.e1, p);
+		if (std::abs(det) < 1e-15) return;  // Parallel to the triangle
+		const double inv_det = 1.0 / det;
+		for (int a = 0; a < 3; a++) s[a] = o[a] - t.v0[a];
+		const double u = dot(s, p) * inv_det;
+		if (u < -eps || u > 1 + eps) return;
+		cross(s, t.e1, q);
+		const double v = dot(d[k], q) * inv_det;
+		if (v < -eps || u + v > 1 + eps) return;
+		const double dist = dot(t.e2, q) * inv_det;
+		if (dist >= 0 && dist < best[k]) best[k] = dist;
+	}
+
+	/** Invokes the traceRay() method of an object for ray k */
+	inline void hitPrimitive(size_t k, const TPrimitive& p)
+	{
+		double dist;
+		const bool hit =
+			rayPose
+				? p.obj->traceRay(p.invParentPose + *rayPose, dist)
+				: p.obj->traceRay(
+					  p.invParentPose +
+						  CPose3D(
+							  o[0], o[1], o[2], std::atan2(d[k][1], d[k][0]),
+							  std::atan2(-d[k][2], std::hypot(d[k][0], d[k][1])),
+							  0),
+					  dist);
+		if (hit && dist < best[k]) best[k] = dist;
+	}
+};
+
+CRayTracingBVH::CRayTracingBVH() : m_treeDepth(0) {}
+CRayTracingBVH::CRayTracingBVH(const CRayTracingBVH&) : m_treeDepth(0) {}
+CRayTracingBVH& CRayTracingBVH::operator=(const CRayTracingBVH& o)
+{
+	if (this != &o) clear();
+	return *this;
+}
+
+void CRayTracingBVH::clear()
+{
+	std::lock_guard<std::mutex> lock(m_update_mtx);
+	m_objects.clear();
+	m_tris.clear();
+	m_prims.clear();
+	m_unbounded.clear();
+	m_items.clear();
+	m_nodes.clear();
+	m_treeDepth = 0;
+}
+
+void CRayTracingBVH::update(const COpenGLScene& scene)
+{
+	std::lock_guard<std::mutex> lock(m_update_mtx);
+
+	// List all objects with their world poses, expanding CSetOfObjects:
+	mrpt::aligned_containers<TObjectEntry>::vector_t objs;
+	objs.reserve(m_objects.size());
+	std::function<void(const CRenderizable::Ptr&, const CPose3D&)> visit =
+		[&](const CRenderizable::Ptr& o, const CPose3D& parentPose) {
+			if (!o) return;
+			if (IS_CLASS(o, CSetOfObjects))
+			{
+				const CPose3D setPose = parentPose + o->getPoseRef();
+				const CSetOfObjects* set =
+					static_cast<const CSetOfObjects*>(o.get());
+				for (const auto& child : *set) visit(child, setPose);
+				return;
+			}
+			TObjectEntry e;
+			e.obj = o.get();
+			e.version = o->getGeometryVersion();
+			e.parentPose = parentPose;
+			e.pose = parentPose + o->getPoseRef();
+			e.first = e.numTris = 0;
+			e.isPrimitive = false;
+			objs.push_back(e);
+		};
+	const CPose3D origin;
+	for (const auto& vp : scene.m_viewports)
+		for (const auto& o : *vp) visit(o, origin);
+
+	bool changed = objs.size() != m_objects.size();
+	std::vector<size_t> moved;
+	for (size_t i = 0; !changed && i < objs.size(); i++)
+	{
+		TObjectEntry& e = m_objects[i];
+		changed = objs[i].obj != e.obj || objs[i].version != e.version;
+		if (!changed && !samePose(objs[i].pose, e.pose))
+		{
+			e.parentPose = objs[i].parentPose;
+			e.pose = objs[i].pose;
+			moved.push_back(i);
+		}
+	}
+	if (changed)
+	{
+		m_objects.swap(objs);
+		rebuild();
+	}
+	else if (!moved.empty() && !refit(moved))
+		rebuild();
+}
+
+bool CRayTracingBVH::setPrimitive(TPrimitive& p, const TObjectEntry& e) const
+{
+	p.obj = e.obj;
+	p.invParentPose = CPose3D() - e.parentPose;
+	p.bounded = false;
+
+	// getBoundingBox() returns two opposite corners of a box in the object
+	// frame, transformed by the object pose: recover the local box, then
+	// bound its 8 corners in world coordinates.
+	TPoint3D bb[2];
+	try
+	{
+		e.obj->getBoundingBox(bb[0], bb[1]);
+	}
+	catch (...)
+	{
+		return false;
+	}
+	const CPose3D& objPose = e.obj->getPoseRef();
+	for (auto& c : bb) objPose.inverseComposePoint(c, c);
+	for (const auto& c : bb)
+		for (int a = 0; a < 3; a++)
+			if (!(std::abs(c[a]) < 1e15)) return false;  // Also rejects NaNs
+	if (bb[0] == bb[1]) return false;  // Unknown (e.g. not rendered yet)
+
+	boxReset(p.bb_min, p.bb_max);
+	for (int i = 0; i < 8; i++)
+	{
+		TPoint3D c(bb[i & 1].x, bb[(i >> 1) & 1].y, bb[(i >> 2) & 1].z);
+		e.pose.composePoint(c, c);
+		const double pt[3] = {c.x, c.y, c.z};
+		boxExtend(p.bb_min, p.bb_max, pt, pt);
+	}
+	// Relative margin for the round-off of the recovered local box:
+	for (int a = 0; a < 3; a++)
+	{
+		const double m = 1e-6 * (p.bb_max[a] - p.bb_min[a]) + 1e-9;
+		p.bb_min[a] -= m;
+		p.bb_max[a] += m;
+	}
+	p.bounded = true;
+	return true;
+}
+
+void CRayTracingBVH::setTriangles(
+	const TObjectEntry& e, const std::vector<TPoint3D>& local)
+{
+	for (size_t i = 0; i < e.numTris; i++)
+	{
+		TPoint3D v[3];
+		for (int j = 0; j < 3; j++) e.pose.composePoint(local[3 * i + j], v[j]);
+		TTriangle& t = m_tris[e.first + i];
+		for (int a = 0; a < 3; a++)
+		{
+			t.v0[a] = v[0][a];
+			t.e1[a] = v[1][a] - v[0][a];
+			t.e2[a] = v[2][a] - v[0][a];
+		}
+	}
+}
+
+void CRayTracingBVH::rebuild()
+{
+	m_tris.clear();
+	m_prims.clear();
+	m_unbounded.clear();
+	std::vector<TPoint3D> local;
+	for (auto& e : m_objects)
+	{
+		local.clear();
+		if (e.obj->getTrianglesForRayTracing(local))
+		{
+			e.isPrimitive = false;
+			e.first = m_tris.size();
+			e.numTris = local.size() / 3;
+			m_tris.resize(e.first + e.numTris);
+			setTriangles(e, local);
+		}
+		else
+		{
+			e.isPrimitive = true;
+			e.first = m_prims.size();
+			e.numTris = 0;
+			m_prims.resize(m_prims.size() + 1);
+			if (!setPrimitive(m_prims.back(), e))
+				m_unbounded.push_back(e.first);
+		}
+		// Read again, since some objects notify a change while updating
+		// their internal caches of triangles:
+		e.version = e.obj->getGeometryVersion();
+	}
+	buildTree();
+}
+
+bool CRayTracingBVH::refit(const std::vector<size_t>& moved)
+{
+	std::vector<TPoint3D> local;
+	for (size_t i : moved)
+	{
+		const TObjectEntry& e = m_objects[i];
+		if (e.isPrimitive)
+		{
+			TPrimitive& p = m_prims[e.first];
+			const bool wasBounded = p.bounded;
+			if (setPrimitive(p, e) != wasBounded) return false;
+		}
+		else if (e.numTris)
+		{
+			local.clear();
+			e.obj->getTrianglesForRayTracing(local);
+			if (local.size() != 3 * e.numTris) return false;
+			setTriangles(e, local);
+		}
+	}
+	refitTree();
+	return true;
+}
+
+void CRayTracingBVH::itemBox(
+	uint32_t item, double bb_min[3], double bb_max[3]) const
+{
+	if (item < m_tris.size())
+	{
+		const TTriangle& t = m_tris[item];
+		for (int a = 0; a < 3; a++)
+		{
+			const double v1 = t.v0[a] + t.e1[a], v2 = t.v0[a] + t.e2[a];
+			bb_min[a] = std::min(t.v0[a], std::min(v1, v2));
+			bb_max[a] = std::max(t.v0[a], std::max(v1, v2));
+		}
+	}
+	else
+	{
+		const TPrimitive& p = m_prims[item - m_tris.size()];
+		for (int a = 0; a < 3; a++)
+		{
+			bb_min[a] = p.bb_min[a];
+			bb_max[a] = p.bb_max[a];
+		}
+	}
+}
+
+void CRayTracingBVH::buildTree()
+{
+	m_items.clear();
+	m_nodes.clear();
+	m_treeDepth = 0;
+	for (uint32_t i = 0; i < m_tris.size(); i++) m_items.push_back(i);
+	for (size_t i = 0; i < m_prims.size(); i++)
+		if (m_prims[i].bounded) m_items.push_back(m_tris.size() + i);
+	const size_t N = m_items.size();
+	if (!N) return;
+
+	// Boxes and centroids of all items, indexed like m_tris & m_prims:
+	struct TItem
+	{
+		double bb_min[3], bb_max[3], c[3];
+	};
+	std::vector<TItem> items(m_tris.size() + m_prims.size());
+	for (uint32_t it : m_items)
+	{
+		TItem& t = items[it];
+		itemBox(it, t.bb_min, t.bb_max);
+		for (int a = 0; a < 3; a++) t.c[a] = 0.5 * (t.bb_min[a] + t.bb_max[a]);
+	}
+
+	struct TBin
+	{
+		double bb_min[3], bb_max[3];
+		size_t n;
+	};
+	m_nodes.reserve(2 * N / BVH_MIN_LEAF_SIZE + 1);
+	m_nodes.resize(1);
+	m_nodes[0].first = 0;
+	m_nodes[0].count = N;
+	std::vector<std::pair<uint32_t, size_t>> pending;  // (node, depth)
+	pending.emplace_back(0, 1);
+	while (!pending.empty())
+	{
+		const uint32_t ni = pending.back().first;
+		const size_t depth = pending.back().second;
+		pending.pop_back();
+		m_treeDepth = std::max(m_treeDepth, depth);
+		const uint32_t first = m_nodes[ni].first, count = m_nodes[ni].count;
+
+		double bb_min[3], bb_max[3], c_min[3], c_max[3];
+		boxReset(bb_min, bb_max);
+		boxReset(c_min, c_max);
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			const TItem& t = items[m_items[i]];
+			boxExtend(bb_min, bb_max, t.bb_min, t.bb_max);
+			boxExtend(c_min, c_max, t.c, t.c);
+		}
+		boxPad(bb_min, bb_max);
+		for (int a = 0; a < 3; a++)
+		{
+			m_nodes[ni].bb_min[a] = bb_min[a];
+			m_nodes[ni].bb_max[a] = bb_max[a];
+		}
+		if (count <= BVH_MIN_LEAF_SIZE) continue;
+
+		int axis = 0;
+		for (int a = 1; a < 3; a++)
+			if (c_max[a] - c_min[a] > c_max[axis] - c_min[axis]) axis = a;
+		const double c0 = c_min[axis], extent = c_max[axis] - c_min[axis];
+		if (!(extent > 0)) continue;  // All centroids coincide
+
+		// Binned SAH: cost of splitting after each bin
+		const double k_bin = BVH_NUM_BINS * (1 - 1e-9) / extent;
+		auto binOf = [&](uint32_t it) {
+			return std::min(
+				BVH_NUM_BINS - 1, int((items[it].c[axis] - c0) * k_bin));
+		};
+		TBin bins[BVH_NUM_BINS];
+		for (auto& b : bins)
+		{
+			boxReset(b.bb_min, b.bb_max);
+			b.n = 0;
+		}
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			TBin& b = bins[binOf(m_items[i])];
+			boxExtend(
+				b.bb_min, b.bb_max, items[m_items[i]].bb_min,
+				items[m_items[i]].bb_max);
+			b.n++;
+		}
+		double costLeft[BVH_NUM_BINS], accMin[3], accMax[3];
+		size_t nLeft[BVH_NUM_BINS], acc = 0;
+		boxReset(accMin, accMax);
+		for (int i = 0; i < BVH_NUM_BINS - 1; i++)
+		{
+			acc += bins[i].n;
+			if (bins[i].n) boxExtend(accMin, accMax, bins[i].bb_min, bins[i].bb_max);
+			nLeft[i] = acc;
+			costLeft[i] = acc ? acc * boxHalfArea(accMin, accMax) : 0;
+		}
+		int bestSplit = -1;
+		double bestCost = std::numeric_limits<double>::max();
+		acc = 0;
+		boxReset(accMin, accMax);
+		for (int i = BVH_NUM_BINS - 1; i > 0; i--)
+		{
+			acc += bins[i].n;
+			if (bins[i].n) boxExtend(accMin, accMax, bins[i].bb_min, bins[i].bb_max);
+			if (!acc || !nLeft[i - 1]) continue;
+			const double cost =
+				costLeft[i - 1] + acc * boxHalfArea(accMin, accMax);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = i - 1;
+			}
+		}
+		// Compare with the cost of a leaf (intersection cost = 1, traversal
+		// cost = 1):
+		const double area = boxHalfArea(bb_min, bb_max);
+		if (bestSplit < 0 ||
+			(count <= BVH_MAX_LEAF_SIZE &&
+			 1 + bestCost / std::max(area, 1e-300) >= count))
+			continue;
+
+		const uint32_t nL = uint32_t(
+			std::partition(
+				m_items.begin() + first, m_items.begin() + first + count,
+				[&](uint32_t it) { return binOf(it) <= bestSplit; }) -
+			(m_items.begin() + first));
+
+		const uint32_t left = m_nodes.size();
+		m_nodes.resize(left + 2);
+		m_nodes[left].first = first;
+		m_nodes[left].count = nL;
+		m_nodes[left + 1].first = first + nL;
+		m_nodes[left + 1].count = count - nL;
+		m_nodes[ni].first = left;
+		m_nodes[ni].count = 0;
+		m_nodes[ni].axis = uint8_t(axis);
+		pending.emplace_back(left, depth + 1);
+		pending.emplace_back(left + 1, depth + 1);
+	}
+}
+
+void CRayTracingBVH::refitTree()
+{
+	// Children are always stored after their parents:
+	for (size_t ni = m_nodes.size(); ni-- > 0;)
+	{
+		TNode& n = m_nodes[ni];
+		boxReset(n.bb_min, n.bb_max);
+		if (n.count)
+		{
+			for (uint32_t i = n.first; i < n.first + n.count; i++)
+			{
+				double bb_min[3], bb_max[3];
+				itemBox(m_items[i], bb_min, bb_max);
+				boxExtend(n.bb_min, n.bb_max, bb_min, bb_max);
+			}
+			boxPad(n.bb_min, n.bb_max);
+		}
+		else
+			for (uint32_t c = n.first; c < n.first + 2; c++)
+				boxExtend(n.bb_min, n.bb_max, m_nodes[c].bb_min, m_nodes[c].bb_max);
+	}
+}
+
+void CRayTracingBVH::tracePacket(
+	TPacket& pk, std::vector<uint64_t>& stack) const
+{
+	const size_t K = pk.K;
+	for (size_t p : m_unbounded)
+		for (size_t k = 0; k < K; k++) pk.hitPrimitive(k, m_prims[p]);
+	if (m_nodes.empty()) return;
+
+	const uint32_t nTris = m_tris.size();
+	// Stack entries: node index in the lower 32 bits, mask of the rays which
+	// hit its parent in the upper ones.
+	stack.clear();
+	stack.push_back((uint64_t((1u << K) - 1) << 32));
+	while (!stack.empty())
+	{
+		const uint64_t top = stack.back();
+		stack.pop_back();
+		const TNode& n = m_nodes[uint32_t(top)];
+		const uint32_t parentMask = uint32_t(top >> 32);
+		uint32_t mask = 0;
+		for (size_t k = 0; k < K; k++)
+			if ((parentMask & (1u << k)) && pk.hitsBox(k, n.bb_min, n.bb_max))
+				mask |= 1u << k;
+		if (!mask) continue;
+
+		if (n.count)
+		{
+			for (uint32_t i = n.first; i < n.first + n.count; i++)
+			{
+				const uint32_t it = m_items[i];
+				for (size_t k = 0; k < K; k++)
+				{
+					if (!(mask & (1u << k))) continue;
+					if (it < nTris)
+						pk.hitTriangle(k, m_tris[it]);
+					else
+						pk.hitPrimitive(k, m_prims[it - nTris]);
+				}
+			}
+		}
+		else
+		{
+			// Visit first the child nearer to the origin along the split axis,
+			// for the first active ray:
+			size_t k0 = 0;
+			while (!(mask & (1u << k0))) k0++;
+			const bool lowFirst = pk.d[k0][n.axis] >= 0;
+			const uint64_t m = uint64_t(mask) << 32;
+			stack.push_back(m | (lowFirst ? n.first + 1 : n.first));
+			stack.push_back(m | (lowFirst ? n.first : n.first + 1));
+		}
+	}
+}
+
+bool CRayTracingBVH::traceRay(const CPose3D& o, double& dist) const
+{
+	TPacket pk;
+	pk.K = 1;
+	pk.rayPose = &o;
+	pk.o[0] = o.x();
+	pk.o[1] = o.y();
+	pk.o[2] = o.z();
+	const double dir[3] = {o.getRotationMatrix()(0, 0),
+						   o.getRotationMatrix()(1, 0),
+						   o.getRotationMatrix()(2, 0)};
+	pk.setDirection(0, dir);
+	std::vector<uint64_t> stack;
+	stack.reserve(m_treeDepth + 2);
+	tracePacket(pk, stack);
+	if (pk.best[0] == std::numeric_limits<double>::infinity()) return false;
+	dist = pk.best[0];
+	return true;
+}
+
+void CRayTracingBVH::traceRays(
+	const TPoint3D& origin, const std::vector<TPoint3D>& directions,
+	std::vector<double>& dists, mrpt::utils::CWorkerThreadsPool* threadPool) const
+{
+	const size_t N = directions.size();
+	const size_t nPackets = (N + PACKET_SIZE - 1) / PACKET_SIZE;
+	dists.resize(N);
+
+	auto traceChunk = [&](size_t firstPk, size_t lastPk, size_t) {
+		TPacket pk;
+		pk.rayPose = nullptr;
+		for (int a = 0; a < 3; a++) pk.o[a] = origin[a];
+		std::vector<uint64_t> stack;
+		stack.reserve(m_treeDepth + 2);
+		for (size_t p = firstPk; p < lastPk; p++)
+		{
+			const size_t i0 = p * PACKET_SIZE;
+			pk.K = std::min(PACKET_SIZE, N - i0);
+			for (size_t k = 0; k < pk.K; k++)
+			{
+				const TPoint3D& d = directions[i0 + k];
+				const double dir[3] = {d.x, d.y, d.z};
+				pk.setDirection(k, dir);
+			}
+			tracePacket(pk, stack);
+			for (size_t k = 0; k < pk.K; k++)
+			{
+				const double nd = directions[i0 + k].norm();
+				dists[i0 + k] =
+					nd > 0 ? pk.best[k] : std::numeric_limits<double>::infinity();
+			}
+		}
+	};
+	if (threadPool)
+		threadPool->parallelChunks(nPackets, traceChunk);
+	else
+		traceChunk(0, nPackets, 0);
+}
@@ -0,0 +1,179 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#define MRPT_NO_WARN_BIG_HDR
+#include <mrpt/opengl.h>
+#include <mrpt/random.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
+
+#include <gtest/gtest.h>
+
+using namespace mrpt;
+using namespace mrpt::opengl;
+using namespace mrpt::math;
+using namespace mrpt::poses;
+using namespace mrpt::random;
+using namespace std;
+
+static CPose3D randomPose(double xyz_range)
+{
+	CRandomGenerator& rnd = getRandomGenerator();
+	return CPose3D(
+		rnd.drawUniform(-xyz_range, xyz_range),
+		rnd.drawUniform(-xyz_range, xyz_range),
+		rnd.drawUniform(-xyz_range, xyz_range), rnd.drawUniform(-M_PI, M_PI),
+		rnd.drawUniform(-M_PI, M_PI), rnd.drawUniform(-M_PI, M_PI));
+}
+
+// Compares the BVH results against tracing each object of the scene:
+static void checkSceneRays(const COpenGLScene& scene, const size_t nRays)
+{
+	for (size_t i = 0; i < nRays; i++)
+	{
+		const CPose3D ray = randomPose(6.0);
+		double d_bvh = 0, d_all = 0;
+		COpenGLScene::TRACERAY_USE_BVH = true;
+		const bool hit_bvh = scene.traceRay(ray, d_bvh);
+		COpenGLScene::TRACERAY_USE_BVH = false;
+		const bool hit_all = scene.traceRay(ray, d_all);
+		COpenGLScene::TRACERAY_USE_BVH = true;
+		EXPECT_EQ(hit_all, hit_bvh) << "ray: " << ray;
+		if (hit_all && hit_bvh) EXPECT_NEAR(d_all, d_bvh, 1e-6) << ray;
+	}
+}
+
+TEST(CRayTracingBVH, compareToBruteForce)
+{
+	getRandomGenerator().randomize(123);
+	CRandomGenerator& rnd = getRandomGenerator();
+
+	COpenGLScene scene;
+
+	// Many small triangles:
+	CSetOfTriangles::Ptr tris = CSetOfTriangles::Create();
+	for (int i = 0; i < 500; i++)
+	{
+		CSetOfTriangles::TTriangle t;
+		const CPose3D c = randomPose(5.0);
+		for (int v = 0; v < 3; v++)
+		{
+			t.x[v] = c.x() + rnd.drawUniform(-0.5, 0.5);
+			t.y[v] = c.y() + rnd.drawUniform(-0.5, 0.5);
+			t.z[v] = c.z() + rnd.drawUniform(-0.5, 0.5);
+		}
+		tris->insertTriangle(t);
+	}
+	tris->setPose(randomPose(1.0));
+	scene.insert(tris);
+
+	// Other meshes, some of them within a rotated set of objects:
+	CSetOfObjects::Ptr set = CSetOfObjects::Create();
+	set->setPose(randomPose(2.0));
+	scene.insert(set);
+
+	CPolyhedron::Ptr poly = CPolyhedron::CreateIcosahedron(1.0);
+	poly->setPose(randomPose(4.0));
+	set->insert(poly);
+
+	CTexturedPlane::Ptr plane = CTexturedPlane::Create(-2, 1, -1, 3);
+	plane->setPose(randomPose(4.0));
+	set->insert(plane);
+
+	std::vector<TPoint3D> axis, generatrix;
+	for (int i = 0; i < 3; i++) axis.push_back(TPoint3D(0.5 * i, 0, 0));
+	for (int i = 0; i < 6; i++)
+		generatrix.push_back(TPoint3D(0, cos(i * M_PI / 3), sin(i * M_PI / 3)));
+	CGeneralizedCylinder::Ptr gcyl =
+		CGeneralizedCylinder::Create(axis, generatrix);
+	gcyl->setClosed(true);
+	gcyl->setPose(randomPose(4.0));
+	set->insert(gcyl);
+
+#if MRPT_HAS_OPENCV  // CMesh needs CImage
+	CMesh::Ptr mesh = CMesh::Create(false, -2, 2, -3, 3);
+	CMatrixFloat Z(8, 10);
+	for (int r = 0; r < 8; r++)
+		for (int c = 0; c < 10; c++) Z(r, c) = rnd.drawUniform(-0.5, 0.5);
+	mesh->setZ(Z);
+	mesh->setPose(randomPose(4.0));
+	scene.insert(mesh);
+#endif
+
+	// Objects traced by their own methods:
+	for (int i = 0; i < 10; i++)
+	{
+		CSphere::Ptr sph = CSphere::Create(rnd.drawUniform(0.2, 1.0));
+		sph->setPose(randomPose(5.0));
+		if (i % 2)
+			scene.insert(sph);
+		else
+			set->insert(sph);
+	}
+	CCylinder::Ptr cyl = CCylinder::Create(0.5, 0.3, 2.0);
+	cyl->setPose(randomPose(4.0));
+	set->insert(cyl);
+	scene.insert(CGridPlaneXY::Create());
+
+	checkSceneRays(scene, 3000);
+
+	// Moving objects refits the tree:
+	set->setPose(randomPose(2.0));
+	tris->setPose(randomPose(1.0));
+	checkSceneRays(scene, 1000);
+
+	// Changing the geometry or the list of objects rebuilds it:
+	tris->clearTriangles();
+	set->removeObject(poly);
+	plane->setPlaneCorners(-1, 1, -1, 1);
+	checkSceneRays(scene, 1000);
+}
+
+TEST(CRayTracingBVH, traceRaysInParallel)
+{
+	getRandomGenerator().randomize(321);
+	COpenGLScene scene;
+	for (int i = 0; i < 50; i++)
+	{
+		const double L = getRandomGenerator().drawUniform(0.1, 2.0);
+		CPolyhedron::Ptr p =
+			CPolyhedron::CreateCubicPrism(0, L, 0, 0.5, 0, 1.0);
+		p->setPose(randomPose(5.0));
+		scene.insert(p);
+	}
+	CSphere::Ptr sph = CSphere::Create(1.0);
+	scene.insert(sph);
+
+	const TPoint3D origin(0.1, -0.2, 0.3);
+	std::vector<TPoint3D> dirs;
+	for (int i = 0; i < 1001; i++)
+		dirs.push_back(TPoint3D(
+			getRandomGenerator().drawUniform(-1.0, 1.0),
+			getRandomGenerator().drawUniform(-1.0, 1.0),
+			getRandomGenerator().drawUniform(-1.0, 1.0)));
+
+	// Origin inside the sphere: all rays must hit.
+	mrpt::utils::CWorkerThreadsPool pool(4);
+	std::vector<double> dists_serial, dists_parallel;
+	scene.traceRays(origin, dirs, dists_serial);
+	scene.traceRays(origin, dirs, dists_parallel, &pool);
+	ASSERT_EQ(dists_serial.size(), dirs.size());
+	EXPECT_TRUE(dists_serial == dists_parallel);
+	for (size_t i = 0; i < dirs.size(); i++)
+	{
+		const TPoint3D& d = dirs[i];
+		double dist;
+		const bool hit = scene.traceRay(
+			CPose3D(
+				origin.x, origin.y, origin.z, atan2(d.y, d.x),
+				atan2(-d.z, hypot(d.x, d.y)), 0),
+			dist);
+		EXPECT_TRUE(hit);
+		EXPECT_NEAR(dist, dists_serial[i], 1e-6);
+	}
+}
@@ -19,6 +19,7 @@
 #include <mrpt/utils/CStream.h>
 
 #include <mutex>
+#include <atomic>
 
 #include "opengl_internals.h"
 
@@ -64,6 +65,7 @@ CRenderizable::CRenderizable()
 	  m_scale_z(1),
 	  m_visible(true)
 {
+	newGeometryVersion();
 }
 
 // Destructor:
@@ -359,6 +361,12 @@ bool CRenderizable::traceRay(const mrpt::poses::CPose3D& o, double& dist) const
 	return false;
 }
 
+void CRenderizable::newGeometryVersion() const
+{
+	static std::atomic<uint64_t> last_version(0);
+	m_geometryVersion = ++last_version;
+}
+
 CRenderizable::Ptr& mrpt::opengl::operator<<(
 	CRenderizable::Ptr& r, const mrpt::poses::CPose3D& p)
 {
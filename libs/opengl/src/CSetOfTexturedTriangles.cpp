@@ -152,6 +152,17 @@ bool CSetOfTexturedTriangles::traceRay(
 		"TODO: TraceRay not implemented in CSetOfTexturedTriangles");
 }
 
+bool CSetOfTexturedTriangles::getTrianglesForRayTracing(
+	std::vector<mrpt::math::TPoint3D>& tris) const
+{
+	tris.clear();
+	tris.reserve(3 * m_triangles.size());
+	for (const auto& t : m_triangles)
+		for (const TVertex* v : {&t.m_v1, &t.m_v2, &t.m_v3})
+			tris.push_back(mrpt::math::TPoint3D(v->m_x, v->m_y, v->m_z));
+	return true;
+}
+
 void CSetOfTexturedTriangles::getBoundingBox(
 	mrpt::math::TPoint3D& bb_min, mrpt::math::TPoint3D& bb_max) const
 {
@@ -163,6 +163,17 @@ bool CSetOfTriangles::traceRay(
 	return mrpt::math::traceRay(tmpPolygons, o - this->m_pose, dist);
 }
 
+bool CSetOfTriangles::getTrianglesForRayTracing(
+	std::vector<mrpt::math::TPoint3D>& tris) const
+{
+	tris.clear();
+	tris.reserve(3 * m_triangles.size());
+	for (const auto& t : m_triangles)
+		for (int i = 0; i < 3; i++)
+			tris.push_back(mrpt::math::TPoint3D(t.x[i], t.y[i], t.z[i]));
+	return true;
+}
+
 // Helper function. Given two 2D points (y1,z1) and (y2,z2), returns three
 // coefficients A, B and C so that both points
 // verify Ay+Bz+C=0
@@ -161,6 +161,15 @@ bool CTexturedPlane::traceRay(const mrpt::poses::CPose3D& o, double& dist) const
 	return math::traceRay(tmpPoly, o - this->m_pose, dist);
 }
 
+bool CTexturedPlane::getTrianglesForRayTracing(
+	std::vector<mrpt::math::TPoint3D>& tris) const
+{
+	const TPoint3D p00(m_xMin, m_yMin, 0), p01(m_xMin, m_yMax, 0),
+		p11(m_xMax, m_yMax, 0), p10(m_xMax, m_yMin, 0);
+	tris = {p00, p01, p11, p00, p11, p10};
+	return true;
+}
+
 void CTexturedPlane::updatePoly() const
 {
 	TPolygon3D poly(4);
@@ -162,6 +162,12 @@ class CMultiMetricMap : public mrpt::maps::CMetricMap
 	double internal_computeObservationLikelihood(
 		const mrpt::obs::CObservation* obs,
 		const mrpt::poses::CPose3D& takenFrom) override;
+	// See docs in base class
+	void internal_computeObservationLikelihoodBatch(
+		const mrpt::obs::CObservation* obs,
+		const std::vector<mrpt::math::TPose3D>& takenFrom,
+		std::vector<double>& out_logliks,
+		mrpt::utils::CWorkerThreadsPool* threadPool) override;
 
    public:
 	/** @name Access to internal list of maps: direct list, iterators, utility
@@ -52,6 +52,12 @@ class CRBPFParticleData : public mrpt::utils::CSerializable
  *   This class is used internally by the map building algorithm in
  * "mrpt::slam::CMetricMapBuilderRBPF"
  *
+ * Particles duplicated at resampling are copies of each other. Occupancy
+ * grids created with `tiledStorage=true` share their unmodified tiles among
+ * those copies (see mrpt::maps::COccupancyGridMap2D::setTiledStorage), so
+ * resampling and memory costs only grow with the areas each particle
+ * actually modifies afterwards.
+ *
  * \sa mrpt::slam::CMetricMapBuilderRBPF
  * \ingroup metric_slam_grp
  */
@@ -274,6 +280,15 @@ class CMultiMetricMapPDF
 		const size_t particleIndexForMap,
 		const mrpt::obs::CSensoryFrame& observation,
 		const mrpt::poses::CPose3D& x) const override;
+	/** Evaluates each run of consecutive poses that share the same particle
+	 * map at once, with
+	 * mrpt::maps::CMetricMap::computeObservationsLikelihoodBatch() */
+	void PF_SLAM_computeObservationLikelihoodForParticles(
+		const mrpt::bayes::CParticleFilter::TParticleFilterOptions& PF_options,
+		const std::vector<size_t>& particleIndexForMap,
+		const mrpt::obs::CSensoryFrame& observation,
+		const std::vector<mrpt::math::TPose3D>& x,
+		std::vector<double>& out_logliks) const override;
 	/** @} */
 
 };  // End of class def.
@@ -12,6 +12,7 @@
 #include <mrpt/slam/CMetricMapsAlignmentAlgorithm.h>
 #include <mrpt/utils/CLoadableOptions.h>
 #include <mrpt/utils/TEnumType.h>
+#include <mrpt/utils/CWorkerThreadsPoolHolder.h>
 
 namespace mrpt
 {
@@ -22,7 +23,13 @@ namespace slam
 enum TICPAlgorithm
 {
 	icpClassic = 0,
-	icpLevenbergMarquardt
+	icpLevenbergMarquardt,
+	/** [ICP-3D only] Gauss-Newton minimization of point-to-plane distances,
+	 * with the normals of the reference map */
+	icpPointToPlane,
+	/** [ICP-3D only] Generalized-ICP (Segal et al., 2009): Gauss-Newton
+	 * minimization of plane-to-plane Mahalanobis distances */
+	icpGICP
 };
 
 /** ICP covariance estimation methods, used in mrpt::slam::CICP::options
@@ -85,7 +92,8 @@ class CICP : public mrpt::slam::CMetricMapsAlignmentAlgorithm
 			@{ */
 		/** The algorithm to use (default: icpClassic). See
 		 * http://www.mrpt.org/tutorials/programming/scan-matching-and-icp/ for
-		 * details */
+		 * details. icpPointToPlane and icpGICP are only available in
+		 * Align3D() and require both maps to be mrpt::maps::CPointsMap's. */
 		TICPAlgorithm ICP_algorithm;
 		/** The method to use for covariance estimation (Default:
 		 * icpCovFiniteDifferences) */
@@ -153,11 +161,18 @@ class CICP : public mrpt::slam::CMetricMapsAlignmentAlgorithm
 		/** @} */
 
 		/** Cauchy kernel rho, for estimating the optimal transformation
-		 * covariance, in meters (default = 0.07m) */
+		 * covariance, in meters (default = 0.07m). In icpPointToPlane and
+		 * icpGICP, the parameter of the pseudo-Huber robust kernel (see
+		 * mrpt::math::RobustKernel), in meters and Mahalanobis units,
+		 * respectively. */
 		float kernel_rho;
 		/** Whether to use kernel_rho to smooth distances, or use distances
 		 * directly (default=true) */
 		bool use_kernel;
+		/** [icpPointToPlane and icpGICP only] Number of nearest neighbors used
+		 * to estimate the normal and covariance of each point (default=10).
+		 * See mrpt::maps::CPointsMap::getPointsNormals() */
+		unsigned int normals_num_neighbors;
 		/** [LM method only] The size of the perturbance in x & y used to
 		 * estimate the Jacobians of the square error (default=0.05) */
 		float Axy_aprox_derivatives;
@@ -179,6 +194,24 @@ class CICP : public mrpt::slam::CMetricMapsAlignmentAlgorithm
 		 * queries,
 		  *  the most expensive step in ICP */
 		uint32_t corresponding_points_decimation;
+
+		/** Number of threads used to look for correspondences between points
+		 * maps (default=1: all KD-tree queries in the caller thread). The
+		 * result does not depend on this value.
+		 * \sa mrpt::maps::TMatchingParams::threadPool */
+		unsigned int numThreads;
+
+		/** Returns the pool of worker threads to be used according to
+		 * numThreads, or nullptr if numThreads<=1. The pool is created on the
+		 * first call and kept alive, but it is not shared with copies of this
+		 * struct. */
+		mrpt::utils::CWorkerThreadsPool* getThreadPool() const
+		{
+			return m_threadPool.get(numThreads);
+		}
+
+	   private:
+		mrpt::utils::CWorkerThreadsPoolHolder m_threadPool;
 	};
 
 	/** The options employed by the ICP align. */
@@ -262,6 +295,9 @@ class CICP : public mrpt::slam::CMetricMapsAlignmentAlgorithm
 		const mrpt::maps::CMetricMap* m1, const mrpt::maps::CMetricMap* m2,
 		const mrpt::poses::CPosePDFGaussian& initialEstimationPDF,
 		TReturnInfo& outInfo);
+	/** Implements icpClassic, icpPointToPlane and icpGICP for ICP-3D, which
+	 * only differ in how the pose is updated from the correspondences on each
+	 * iteration */
 	mrpt::poses::CPose3DPDF::Ptr ICP3D_Method_Classic(
 		const mrpt::maps::CMetricMap* m1, const mrpt::maps::CMetricMap* m2,
 		const mrpt::poses::CPose3DPDFGaussian& initialEstimationPDF,
@@ -280,6 +316,8 @@ struct TEnumTypeFiller<slam::TICPAlgorithm>
 	{
 		m_map.insert(slam::icpClassic, "icpClassic");
 		m_map.insert(slam::icpLevenbergMarquardt, "icpLevenbergMarquardt");
+		m_map.insert(slam::icpPointToPlane, "icpPointToPlane");
+		m_map.insert(slam::icpGICP, "icpGICP");
 	}
 };
 template <>
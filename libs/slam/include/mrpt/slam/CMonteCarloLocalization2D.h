@@ -157,6 +157,14 @@ class CMonteCarloLocalization2D
 		const size_t particleIndexForMap,
 		const mrpt::obs::CSensoryFrame& observation,
 		const mrpt::poses::CPose3D& x) const override;
+	/** Evaluates all the particles at once when they share a single map, via
+	 * mrpt::maps::CMetricMap::computeObservationsLikelihoodBatch() */
+	void PF_SLAM_computeObservationLikelihoodForParticles(
+		const mrpt::bayes::CParticleFilter::TParticleFilterOptions& PF_options,
+		const std::vector<size_t>& particleIndexForMap,
+		const mrpt::obs::CSensoryFrame& observation,
+		const std::vector<mrpt::math::TPose3D>& x,
+		std::vector<double>& out_logliks) const override;
 	/** @} */
 
 };  // End of class def.
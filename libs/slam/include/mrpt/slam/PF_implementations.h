@@ -13,6 +13,7 @@
 #include <mrpt/bayes/CParticleFilterCapable.h>
 #include <mrpt/bayes/CParticleFilterData.h>
 #include <mrpt/random.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
 #include <mrpt/obs/CActionCollection.h>
 #include <mrpt/obs/CActionRobotMovement3D.h>
 #include <mrpt/obs/CActionRobotMovement2D.h>
@@ -236,21 +237,56 @@ void PF_implementation<PARTICLE_TYPE, MYSELF>::
 			// -------------------------------------------------------------
 			// FIXED SAMPLE SIZE
 			// -------------------------------------------------------------
-			mrpt::poses::CPose3D incrPose;
-			for (size_t i = 0; i < M; i++)
+			mrpt::utils::CWorkerThreadsPool* pool = PF_options.getThreadPool();
+			if (!pool)
 			{
-				// Generate gaussian-distributed 2D-pose increments according to
-				// mean-cov:
-				m_movementDrawer.drawSample(incrPose);
-				bool pose_is_valid;
-				const mrpt::poses::CPose3D finalPose =
-					mrpt::poses::CPose3D(getLastPose(i, pose_is_valid)) +
-					incrPose;
-
-				// Update the particle with the new pose: this part is
-				// caller-dependant and must be implemented there:
-				PF_SLAM_implementation_custom_update_particle_with_new_pose(
-					me->m_particles[i].d.get(), mrpt::math::TPose3D(finalPose));
+				mrpt::poses::CPose3D incrPose;
+				for (size_t i = 0; i < M; i++)
+				{
+					// Generate gaussian-distributed 2D-pose increments
+					// according to mean-cov:
+					m_movementDrawer.drawSample(incrPose);
+					bool pose_is_valid;
+					const mrpt::poses::CPose3D finalPose =
+						mrpt::poses::CPose3D(getLastPose(i, pose_is_valid)) +
+						incrPose;
+
+					// Update the particle with the new pose: this part is
+					// caller-dependant and must be implemented there:
+					PF_SLAM_implementation_custom_update_particle_with_new_pose(
+						me->m_particles[i].d.get(),
+						mrpt::math::TPose3D(finalPose));
+				}
+			}
+			else
+			{
+				// Multithreaded version: each chunk of particles draws its
+				// samples from its own random stream, whose seed comes from
+				// the global generator, so the result only depends on the
+				// global seed and the number of threads.
+				const size_t nChunks = pool->numChunksFor(M);
+				std::vector<mrpt::random::CRandomGenerator> rngs(nChunks);
+				for (auto& rng : rngs)
+					rng.randomize(
+						mrpt::random::getRandomGenerator().drawUniform32bit());
+
+				pool->parallelChunks(
+					M, [&](size_t first, size_t last, size_t chunk) {
+						mrpt::random::CRandomGenerator& rng = rngs[chunk];
+						mrpt::poses::CPose3D incrPose;
+						for (size_t i = first; i < last; i++)
+						{
+							m_movementDrawer.drawSample(incrPose, rng);
+							bool pose_is_valid;
+							const mrpt::poses::CPose3D finalPose =
+								mrpt::poses::CPose3D(
+									getLastPose(i, pose_is_valid)) +
+								incrPose;
+							PF_SLAM_implementation_custom_update_particle_with_new_pose(
+								me->m_particles[i].d.get(),
+								mrpt::math::TPose3D(finalPose));
+						}
+					});
 			}
 		}
 		else
@@ -344,19 +380,24 @@ void PF_implementation<PARTICLE_TYPE, MYSELF>::
 		const size_t M = me->m_particles.size();
 		//	UPDATE STAGE
 		// ----------------------------------------------------------------------
-		// Compute all the likelihood values & update particles weight:
+		// Compute all the likelihood values at once:
+		std::vector<mrpt::math::TPose3D> partPoses(M);
+		std::vector<size_t> partIdxs(M);
 		for (size_t i = 0; i < M; i++)
 		{
 			bool pose_is_valid;
-			const mrpt::math::TPose3D partPose =
+			partPoses[i] =
 				getLastPose(i, pose_is_valid);  // Take the particle data:
-			mrpt::poses::CPose3D partPose2 = mrpt::poses::CPose3D(partPose);
-			const double obs_log_likelihood =
-				PF_SLAM_computeObservationLikelihoodForParticle(
-					PF_options, i, *sf, partPose2);
+			partIdxs[i] = i;
+		}
+		std::vector<double> obs_log_likelihoods;
+		PF_SLAM_computeObservationLikelihoodForParticles(
+			PF_options, partIdxs, *sf, partPoses, obs_log_likelihoods);
+
+		// and update particles weight:
+		for (size_t i = 0; i < M; i++)
 			me->m_particles[i].log_w +=
-				obs_log_likelihood * PF_options.powFactor;
-		}  // for each particle "i"
+				obs_log_likelihoods[i] * PF_options.powFactor;
 
 		// Normalization of weights is done outside of this method
 		// automatically.
@@ -427,23 +468,28 @@ double PF_implementation<PARTICLE_TYPE, MYSELF>::
 		mrpt::poses::CPose3D(me->getLastPose(index, pose_is_valid));
 	mrpt::math::CVectorDouble vectLiks(
 		N, 0);  // The vector with the individual log-likelihoods.
-	mrpt::poses::CPose3D drawnSample;
+	// Draw all the samples first, then evaluate them at once:
+	std::vector<mrpt::poses::CPose3D> drawnSamples(N);
+	std::vector<mrpt::math::TPose3D> predictions(N);
 	for (size_t q = 0; q < N; q++)
 	{
-		me->m_movementDrawer.drawSample(drawnSample);
-		mrpt::poses::CPose3D x_predict = oldPose + drawnSample;
-
-		// Estimate the mean...
-		indivLik = me->PF_SLAM_computeObservationLikelihoodForParticle(
-			PF_options, index,
-			*static_cast<const mrpt::obs::CSensoryFrame*>(observation),
-			x_predict);
+		me->m_movementDrawer.drawSample(drawnSamples[q]);
+		predictions[q] = mrpt::math::TPose3D(oldPose + drawnSamples[q]);
+	}
+	std::vector<double> sampleLiks;
+	me->PF_SLAM_computeObservationLikelihoodForParticles(
+		PF_options, std::vector<size_t>(N, index),
+		*static_cast<const mrpt::obs::CSensoryFrame*>(observation),
+		predictions, sampleLiks);
 
+	for (size_t q = 0; q < N; q++)
+	{
+		indivLik = sampleLiks[q];
 		MRPT_CHECK_NORMAL_NUMBER(indivLik);
 		vectLiks[q] = indivLik;
 		if (indivLik > maxLik)
 		{  // Keep the maximum value:
-			maxLikDraw = drawnSample;
+			maxLikDraw = drawnSamples[q];
 			maxLik = indivLik;
 		}
 	}
@@ -530,23 +576,28 @@ double PF_implementation<PARTICLE_TYPE, MYSELF>::
 
 		mrpt::math::CVectorDouble vectLiks(
 			N, 0);  // The vector with the individual log-likelihoods.
-		mrpt::poses::CPose3D drawnSample;
+		// Draw all the samples first, then evaluate them at once:
+		std::vector<mrpt::poses::CPose3D> drawnSamples(N);
+		std::vector<mrpt::math::TPose3D> predictions(N);
 		for (size_t q = 0; q < N; q++)
 		{
-			myObj->m_movementDrawer.drawSample(drawnSample);
-			mrpt::poses::CPose3D x_predict = oldPose + drawnSample;
-
-			// Estimate the mean...
-			indivLik = myObj->PF_SLAM_computeObservationLikelihoodForParticle(
-				PF_options, index,
-				*static_cast<const mrpt::obs::CSensoryFrame*>(observation),
-				x_predict);
+			myObj->m_movementDrawer.drawSample(drawnSamples[q]);
+			predictions[q] = mrpt::math::TPose3D(oldPose + drawnSamples[q]);
+		}
+		std::vector<double> sampleLiks;
+		myObj->PF_SLAM_computeObservationLikelihoodForParticles(
+			PF_options, std::vector<size_t>(N, index),
+			*static_cast<const mrpt::obs::CSensoryFrame*>(observation),
+			predictions, sampleLiks);
 
+		for (size_t q = 0; q < N; q++)
+		{
+			indivLik = sampleLiks[q];
 			MRPT_CHECK_NORMAL_NUMBER(indivLik);
 			vectLiks[q] = indivLik;
 			if (indivLik > maxLik)
 			{  // Keep the maximum value:
-				maxLikDraw = drawnSample;
+				maxLikDraw = drawnSamples[q];
 				maxLik = indivLik;
 			}
 		}
@@ -568,7 +619,7 @@ double PF_implementation<PARTICLE_TYPE, MYSELF>::
 		// and compute the resulting probability of this particle:
 		// ------------------------------------------------------------
 		return cur_logweight +
-			   myObj->m_pfAuxiliaryPFOptimal_estimatedProb[index];
+			   myObj->m_pfAuxiliaryPFStandard_estimatedProb[index];
 	}
 	MRPT_END
 }
@@ -629,9 +680,24 @@ void PF_implementation<PARTICLE_TYPE, MYSELF>::
 	mrpt::bayes::CParticleFilterCapable::TParticleProbabilityEvaluator funcStd =
 		&TMyClass::template PF_SLAM_particlesEvaluator_AuxPFStandard<BINTYPE>;
 
-	me->prepareFastDrawSample(
-		PF_options, USE_OPTIMAL_SAMPLING ? funcOpt : funcStd,
-		&meanRobotMovement, sf);
+	mrpt::utils::CWorkerThreadsPool* pool = PF_options.getThreadPool();
+	if (!pool)
+		me->prepareFastDrawSample(
+			PF_options, USE_OPTIMAL_SAMPLING ? funcOpt : funcStd,
+			&meanRobotMovement, sf);
+	else
+	{
+		// Multithreaded version: the observation likelihoods needed by the
+		// evaluator of all particles are computed in one batch, which
+		// spreads them among the worker threads:
+		std::vector<double> firstStageLogWeights;
+		PF_SLAM_aux_computeFirstStageLogWeights<BINTYPE>(
+			USE_OPTIMAL_SAMPLING, meanRobotMovement, *sf, PF_options,
+			firstStageLogWeights);
+		me->prepareFastDrawSample(
+			PF_options, &TMyClass::PF_SLAM_particlesEvaluator_precomputed,
+			&firstStageLogWeights, sf);
+	}
 
 	// For USE_OPTIMAL_SAMPLING=1,  m_pfAuxiliaryPFOptimal_maxLikelihood is now
 	// computed.
@@ -700,33 +766,49 @@ void PF_implementation<PARTICLE_TYPE, MYSELF>::
 
 		const bool doResample = me->ESS() < PF_options.BETA;
 
-		for (size_t i = 0; i < M; i++)
+		if (pool)
 		{
-			size_t k;
-
-			// Generate a new particle:
-			//   (a) Draw a "t-1" m_particles' index:
-			// ----------------------------------------------------------------
-			if (doResample)
-				k = me->fastDrawSample(
-					PF_options);  // Based on weights of last step only!
-			else
-				k = i;
-
-			// Do one rejection sampling step:
-			// ---------------------------------------------
-			mrpt::poses::CPose3D newPose;
-			double newParticleLogWeight;
-			PF_SLAM_aux_perform_one_rejection_sampling_step<BINTYPE>(
-				USE_OPTIMAL_SAMPLING, doResample, maxMeanLik, k, sf, PF_options,
-				newPose, newParticleLogWeight);
-
-			// Insert the new particle
-			newParticles[i] = newPose;
-			newParticlesDerivedFromIdx[i] = k;
-			newParticlesWeight[i] = newParticleLogWeight;
+			// Multithreaded version: draw all the "t-1" indices first, then
+			// do the rejection sampling of all particles at once.
+			for (size_t i = 0; i < M; i++)
+				newParticlesDerivedFromIdx[i] =
+					doResample ? me->fastDrawSample(PF_options) : i;
 
-		}  // for i
+			PF_SLAM_aux_perform_rejection_sampling_batch<BINTYPE>(
+				USE_OPTIMAL_SAMPLING, doResample, maxMeanLik,
+				newParticlesDerivedFromIdx, sf, PF_options, newParticles,
+				newParticlesWeight);
+		}
+		else
+		{
+			for (size_t i = 0; i < M; i++)
+			{
+				size_t k;
+
+				// Generate a new particle:
+				//   (a) Draw a "t-1" m_particles' index:
+				// ------------------------------------------------------------
+				if (doResample)
+					k = me->fastDrawSample(
+						PF_options);  // Based on weights of last step only!
+				else
+					k = i;
+
+				// Do one rejection sampling step:
+				// ---------------------------------------------
+				mrpt::poses::CPose3D newPose;
+				double newParticleLogWeight;
+				PF_SLAM_aux_perform_one_rejection_sampling_step<BINTYPE>(
+					USE_OPTIMAL_SAMPLING, doResample, maxMeanLik, k, sf,
+					PF_options, newPose, newParticleLogWeight);
+
+				// Insert the new particle
+				newParticles[i] = newPose;
+				newParticlesDerivedFromIdx[i] = k;
+				newParticlesWeight[i] = newParticleLogWeight;
+
+			}  // for i
+		}
 	}  // end fixed sample size
 	else
 	{
@@ -1137,6 +1219,262 @@ void PF_implementation<PARTICLE_TYPE, MYSELF>::
 	// Done.
 }  // end PF_SLAM_aux_perform_one_rejection_sampling_step
 
+/* ------------------------------------------------------------------------
+					PF_SLAM_aux_computeFirstStageLogWeights
+   ------------------------------------------------------------------------ */
+template <class PARTICLE_TYPE, class MYSELF>
+template <class BINTYPE>
+void PF_implementation<PARTICLE_TYPE, MYSELF>::
+	PF_SLAM_aux_computeFirstStageLogWeights(
+		const bool USE_OPTIMAL_SAMPLING,
+		const mrpt::poses::CPose3D& meanRobotMovement,
+		const mrpt::obs::CSensoryFrame& sf,
+		const mrpt::bayes::CParticleFilter::TParticleFilterOptions& PF_options,
+		std::vector<double>& out_logWeights)
+{
+	MRPT_START
+
+	MYSELF* me = static_cast<MYSELF*>(this);
+	const size_t M = me->m_particles.size();
+
+	// Same as PF_SLAM_particlesEvaluator_AuxPFOptimal() and
+	// PF_SLAM_particlesEvaluator_AuxPFStandard(), for all the particles at
+	// once. Samples are drawn in the same order than there.
+	const bool monteCarlo =
+		USE_OPTIMAL_SAMPLING ||
+		PF_options.pfAuxFilterStandard_FirstStageWeightsMonteCarlo;
+	const size_t N =
+		monteCarlo ? PF_options.pfAuxFilterOptimal_MaximumSearchSamples : 1;
+	if (monteCarlo) ASSERT_(N > 1)
+
+	std::vector<mrpt::math::TPose3D> drawnSamples(monteCarlo ? M * N : 0);
+	std::vector<mrpt::math::TPose3D> predictions(M * N);
+	std::vector<size_t> partIdxs(M * N);
+	for (size_t i = 0; i < M; i++)
+	{
+		bool pose_is_valid;
+		const mrpt::poses::CPose3D oldPose =
+			mrpt::poses::CPose3D(me->getLastPose(i, pose_is_valid));
+		for (size_t q = 0; q < N; q++)
+		{
+			mrpt::poses::CPose3D movementDraw;
+			if (monteCarlo)
+			{
+				me->m_movementDrawer.drawSample(movementDraw);
+				drawnSamples[i * N + q] = mrpt::math::TPose3D(movementDraw);
+			}
+			else
+				movementDraw = meanRobotMovement;
+			predictions[i * N + q] =
+				mrpt::math::TPose3D(oldPose + movementDraw);
+			partIdxs[i * N + q] = i;
+		}
+	}
+	std::vector<double> sampleLiks;
+	me->PF_SLAM_computeObservationLikelihoodForParticles(
+		PF_options, partIdxs, sf, predictions, sampleLiks);
+
+	out_logWeights.resize(M);
+	mrpt::math::CVectorDouble& estimatedProb =
+		USE_OPTIMAL_SAMPLING ? m_pfAuxiliaryPFOptimal_estimatedProb
+							 : m_pfAuxiliaryPFStandard_estimatedProb;
+	mrpt::math::CVectorDouble vectLiks(N, 0);
+	for (size_t i = 0; i < M; i++)
+	{
+		if (!monteCarlo)
+			estimatedProb[i] = sampleLiks[i];
+		else
+		{
+			double maxLik = -1e300;
+			size_t maxLikIdx = 0;
+			for (size_t q = 0; q < N; q++)
+			{
+				const double indivLik = sampleLiks[i * N + q];
+				MRPT_CHECK_NORMAL_NUMBER(indivLik);
+				vectLiks[q] = indivLik;
+				if (indivLik > maxLik)
+				{
+					maxLikIdx = q;
+					maxLik = indivLik;
+				}
+			}
+			estimatedProb[i] = math::averageLogLikelihood(vectLiks);
+			m_pfAuxiliaryPFOptimal_maxLikelihood[i] = maxLik;
+			if (PF_options.pfAuxFilterOptimal_MLE)
+				m_pfAuxiliaryPFOptimal_maxLikDrawnMovement[i] =
+					drawnSamples[i * N + maxLikIdx];
+		}
+		out_logWeights[i] = me->m_particles[i].log_w + estimatedProb[i];
+	}
+
+	MRPT_END
+}  // end PF_SLAM_aux_computeFirstStageLogWeights
+
+/* ------------------------------------------------------------------------
+					PF_SLAM_aux_perform_rejection_sampling_batch
+   ------------------------------------------------------------------------ */
+template <class PARTICLE_TYPE, class MYSELF>
+template <class BINTYPE>
+void PF_implementation<PARTICLE_TYPE, MYSELF>::
+	PF_SLAM_aux_perform_rejection_sampling_batch(
+		const bool USE_OPTIMAL_SAMPLING, const bool doResample,
+		const double maxMeanLik, const std::vector<size_t>& drawnIdxs,
+		const mrpt::obs::CSensoryFrame* sf,
+		const mrpt::bayes::CParticleFilter::TParticleFilterOptions& PF_options,
+		std::vector<mrpt::math::TPose3D>& out_newPoses,
+		std::vector<double>& out_newParticleLogWeights)
+{
+	MYSELF* me = static_cast<MYSELF*>(this);
+	const size_t M = drawnIdxs.size();
+	const mrpt::math::CVectorDouble& estimatedProb =
+		USE_OPTIMAL_SAMPLING ? m_pfAuxiliaryPFOptimal_estimatedProb
+							 : m_pfAuxiliaryPFStandard_estimatedProb;
+
+	// Same as PF_SLAM_aux_perform_one_rejection_sampling_step(), for all the
+	// particles at once, so all the observation likelihoods of each round
+	// are evaluated in one batch (spread among the worker threads).
+	// Random samples are drawn from the caller thread in the order of
+	// particles, so the result does not depend on the number of threads.
+	std::vector<size_t> ks(drawnIdxs);
+	std::vector<mrpt::poses::CPose3D> oldPoses(M);
+	for (size_t i = 0; i < M; i++)
+	{
+		size_t& k = ks[i];
+		// Replace very unlikely particles by another one, uniformly:
+		while ((estimatedProb[k] - maxMeanLik) <
+			   -PF_options.max_loglikelihood_dyn_range)
+		{
+			k = mrpt::random::getRandomGenerator().drawUniform32bit() %
+				me->m_particles.size();
+			me->logStr(
+				mrpt::utils::LVL_DEBUG,
+				"[PF_SLAM_aux_perform_rejection_sampling_batch] Warning: "
+				"Discarding very unlikely particle.");
+		}
+		bool pose_is_valid;
+		oldPoses[i] = mrpt::poses::CPose3D(getLastPose(k, pose_is_valid));
+	}
+
+	out_newPoses.resize(M);
+	out_newParticleLogWeights.resize(M);
+	std::vector<double> poseLogLiks(M, 0);
+	if (PF_SLAM_implementation_skipRobotMovement())
+	{
+		for (size_t i = 0; i < M; i++)
+			out_newPoses[i] = mrpt::math::TPose3D(oldPoses[i]);
+	}
+	else if (!USE_OPTIMAL_SAMPLING)
+	{  // APF: one sample per particle
+		mrpt::poses::CPose3D movementDraw;
+		for (size_t i = 0; i < M; i++)
+		{
+			m_movementDrawer.drawSample(movementDraw);
+			out_newPoses[i] = mrpt::math::TPose3D(oldPoses[i] + movementDraw);
+		}
+		PF_SLAM_computeObservationLikelihoodForParticles(
+			PF_options, ks, *sf, out_newPoses, poseLogLiks);
+	}
+	else
+	{  // Optimal APF with rejection sampling, in rounds: a new pose is drawn
+		// for each particle not accepted yet, all of them are evaluated, and
+		// then accepted or rejected in the order of particles.
+		const int maxTries = 10000;
+		std::vector<int> tries(M, 0);
+		std::vector<double> bestTryByNow_loglik(
+			M, -std::numeric_limits<double>::max());
+		std::vector<mrpt::math::TPose3D> bestTryByNow_pose(M);
+
+		std::vector<size_t> pending(M);
+		for (size_t i = 0; i < M; i++) pending[i] = i;
+		std::vector<size_t> pendingKs;
+		std::vector<mrpt::math::TPose3D> draws;
+		std::vector<double> drawLogLiks;
+		while (!pending.empty())
+		{
+			const size_t nPending = pending.size();
+			pendingKs.resize(nPending);
+			draws.resize(nPending);
+			for (size_t j = 0; j < nPending; j++)
+			{
+				const size_t i = pending[j], k = ks[i];
+				mrpt::poses::CPose3D movementDraw;
+				if (PF_options.pfAuxFilterOptimal_MLE &&
+					!m_pfAuxiliaryPFOptimal_maxLikMovementDrawHasBeenUsed[k])
+				{  // First take advantage of a good drawn value, only once:
+					m_pfAuxiliaryPFOptimal_maxLikMovementDrawHasBeenUsed[k] =
+						true;
+					movementDraw = mrpt::poses::CPose3D(
+						m_pfAuxiliaryPFOptimal_maxLikDrawnMovement[k]);
+				}
+				else
+					m_movementDrawer.drawSample(movementDraw);
+				draws[j] = mrpt::math::TPose3D(oldPoses[i] + movementDraw);
+				pendingKs[j] = k;
+			}
+			PF_SLAM_computeObservationLikelihoodForParticles(
+				PF_options, pendingKs, *sf, draws, drawLogLiks);
+
+			size_t nStillPending = 0;
+			for (size_t j = 0; j < nPending; j++)
+			{
+				const size_t i = pending[j], k = ks[i];
+				const double poseLogLik = drawLogLiks[j];
+				out_newPoses[i] = draws[j];
+				poseLogLiks[i] = poseLogLik;
+				if (poseLogLik > bestTryByNow_loglik[i])
+				{
+					bestTryByNow_loglik[i] = poseLogLik;
+					bestTryByNow_pose[i] = draws[j];
+				}
+
+				const double ratioLikLik = std::exp(
+					poseLogLik - m_pfAuxiliaryPFOptimal_maxLikelihood[k]);
+				const double acceptanceProb = std::min(1.0, ratioLikLik);
+				if (ratioLikLik > 1)
+					m_pfAuxiliaryPFOptimal_maxLikelihood[k] = poseLogLik;
+
+				if (++tries[i] >= maxTries)
+				{
+					out_newPoses[i] = bestTryByNow_pose[i];
+					poseLogLiks[i] = bestTryByNow_loglik[i];
+					me->logStr(
+						mrpt::utils::LVL_WARN,
+						"[PF_implementation] Warning: timeout in rejection "
+						"sampling.");
+				}
+				else if (
+					acceptanceProb <
+					mrpt::random::getRandomGenerator().drawUniform(0.0, 0.999))
+					pending[nStillPending++] = i;  // Rejected: try again
+			}
+			pending.resize(nStillPending);
+		}
+	}
+
+	// And their weights:
+	for (size_t i = 0; i < M; i++)
+	{
+		const size_t k = ks[i];
+		if (USE_OPTIMAL_SAMPLING)
+		{  // Optimal PF: all samples have identical weights if resampling
+			out_newParticleLogWeights[i] =
+				doResample ? 0
+						   : me->m_particles[k].log_w +
+								 m_pfAuxiliaryPFOptimal_estimatedProb[k] *
+									 PF_options.powFactor;
+		}
+		else
+		{  // APF:
+			const double weightFact =
+				(poseLogLiks[i] - m_pfAuxiliaryPFStandard_estimatedProb[k]) *
+				PF_options.powFactor;
+			out_newParticleLogWeights[i] =
+				doResample ? weightFact
+						   : weightFact + me->m_particles[k].log_w;
+		}
+	}
+}  // end PF_SLAM_aux_perform_rejection_sampling_batch
+
 }  // end namespace
 }  // end namespace
 
@@ -88,6 +88,20 @@ class PF_implementation : public mrpt::utils::COutputLogger
 		const mrpt::bayes::CParticleFilterCapable* obj, size_t index,
 		const void* action, const void* observation);
 
+	/** Returns the value precomputed for each particle.
+	  * \param action MUST be a "const std::vector<double>*", with one value
+	  * per particle */
+	static double PF_SLAM_particlesEvaluator_precomputed(
+		const mrpt::bayes::CParticleFilter::TParticleFilterOptions& PF_options,
+		const mrpt::bayes::CParticleFilterCapable* obj, size_t index,
+		const void* action, const void* observation)
+	{
+		MRPT_UNUSED_PARAM(PF_options);
+		MRPT_UNUSED_PARAM(obj);
+		MRPT_UNUSED_PARAM(observation);
+		return (*static_cast<const std::vector<double>*>(action))[index];
+	}
+
 	/** @} */
 
 	/** \name The generic PF implementations for localization & SLAM.
@@ -279,6 +293,27 @@ class PF_implementation : public mrpt::utils::COutputLogger
 		const mrpt::obs::CSensoryFrame& observation,
 		const mrpt::poses::CPose3D& x) const = 0;
 
+	/** Evaluate the observation likelihood for a set of particle locations at
+	 * once: `out_logliks[i]` is the log-likelihood of `observation` from pose
+	 * `x[i]`, using the map of particle `particleIndexForMap[i]`. The default
+	 * implementation just calls PF_SLAM_computeObservationLikelihoodForParticle()
+	 * for each pose; reimplement it to take advantage of
+	 * mrpt::maps::CMetricMap::computeObservationsLikelihoodBatch() */
+	virtual void PF_SLAM_computeObservationLikelihoodForParticles(
+		const mrpt::bayes::CParticleFilter::TParticleFilterOptions& PF_options,
+		const std::vector<size_t>& particleIndexForMap,
+		const mrpt::obs::CSensoryFrame& observation,
+		const std::vector<mrpt::math::TPose3D>& x,
+		std::vector<double>& out_logliks) const
+	{
+		ASSERT_EQUAL_(particleIndexForMap.size(), x.size())
+		out_logliks.resize(x.size());
+		for (size_t i = 0; i < x.size(); i++)
+			out_logliks[i] = PF_SLAM_computeObservationLikelihoodForParticle(
+				PF_options, particleIndexForMap[i], observation,
+				mrpt::poses::CPose3D(x[i]));
+	}
+
 	/** @} */
 
 	/** Auxiliary method called by PF implementations: return true if we have
@@ -315,6 +350,32 @@ class PF_implementation : public mrpt::utils::COutputLogger
 		const mrpt::bayes::CParticleFilter::TParticleFilterOptions& PF_options,
 		mrpt::poses::CPose3D& out_newPose, double& out_newParticleLogWeight);
 
+	/** Computes, for all particles at once, the same quantities than
+	 * PF_SLAM_particlesEvaluator_AuxPFOptimal() (or
+	 * PF_SLAM_particlesEvaluator_AuxPFStandard()), returning the first stage
+	 * log-weight of each particle. Used with worker threads, since all the
+	 * observation likelihoods are evaluated in one batch. */
+	template <class BINTYPE>
+	void PF_SLAM_aux_computeFirstStageLogWeights(
+		const bool USE_OPTIMAL_SAMPLING,
+		const mrpt::poses::CPose3D& meanRobotMovement,
+		const mrpt::obs::CSensoryFrame& sf,
+		const mrpt::bayes::CParticleFilter::TParticleFilterOptions& PF_options,
+		std::vector<double>& out_logWeights);
+
+	/** Like PF_SLAM_aux_perform_one_rejection_sampling_step(), for the
+	 * particles derived from each of `drawnIdxs`, evaluating the observation
+	 * likelihoods of all of them in one batch per round of rejection
+	 * sampling. */
+	template <class BINTYPE>
+	void PF_SLAM_aux_perform_rejection_sampling_batch(
+		const bool USE_OPTIMAL_SAMPLING, const bool doResample,
+		const double maxMeanLik, const std::vector<size_t>& drawnIdxs,
+		const mrpt::obs::CSensoryFrame* sf,
+		const mrpt::bayes::CParticleFilter::TParticleFilterOptions& PF_options,
+		std::vector<mrpt::math::TPose3D>& out_newPoses,
+		std::vector<double>& out_newParticleLogWeights);
+
 };  // end PF_implementation
 }
 }
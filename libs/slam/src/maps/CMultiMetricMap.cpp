@@ -89,6 +89,37 @@ struct MapComputeLikelihood
 
 };  // end of MapComputeLikelihood
 
+struct MapComputeLikelihoodBatch
+{
+	const CObservation* obs;
+	const std::vector<mrpt::math::TPose3D>& takenFrom;
+	std::vector<double>& total_log_liks;
+	CWorkerThreadsPool* threadPool;
+	std::vector<double> map_log_liks;
+
+	MapComputeLikelihoodBatch(
+		const CMultiMetricMap& m, const CObservation* _obs,
+		const std::vector<mrpt::math::TPose3D>& _takenFrom,
+		std::vector<double>& _total_log_liks, CWorkerThreadsPool* _threadPool)
+		: obs(_obs),
+		  takenFrom(_takenFrom),
+		  total_log_liks(_total_log_liks),
+		  threadPool(_threadPool)
+	{
+		total_log_liks.assign(takenFrom.size(), 0.0);
+	}
+
+	template <typename PTR>
+	inline void operator()(PTR& ptr)
+	{
+		ptr->computeObservationLikelihoodBatch(
+			obs, takenFrom, map_log_liks, threadPool);
+		for (size_t i = 0; i < total_log_liks.size(); i++)
+			total_log_liks[i] += map_log_liks[i];
+	}
+
+};  // end of MapComputeLikelihoodBatch
+
 struct MapCanComputeLikelihood
 {
 	const CObservation* obs;
@@ -333,6 +364,15 @@ double CMultiMetricMap::internal_computeObservationLikelihood(
 	return ret_log_lik;
 }
 
+void CMultiMetricMap::internal_computeObservationLikelihoodBatch(
+	const CObservation* obs, const std::vector<mrpt::math::TPose3D>& takenFrom,
+	std::vector<double>& out_logliks, CWorkerThreadsPool* threadPool)
+{
+	MapComputeLikelihoodBatch op_likelihood(
+		*this, obs, takenFrom, out_logliks, threadPool);
+	MapExecutor::run(*this, op_likelihood);
+}
+
 // Read docs in base class
 bool CMultiMetricMap::internal_canComputeObservationLikelihood(
 	const CObservation* obs) const
@@ -17,6 +17,8 @@
 #include <mrpt/utils/CConfigFileBase.h>  // MRPT_LOAD_*()
 #include <mrpt/math/wrap2pi.h>
 #include <mrpt/math/ops_containers.h>
+#include <mrpt/math/robust_kernels.h>
+#include <mrpt/maps/CPointsMap.h>
 #include <mrpt/poses/CPose2D.h>
 #include <mrpt/poses/CPosePDF.h>
 #include <mrpt/poses/CPose3DPDF.h>
@@ -77,6 +79,11 @@ CPosePDF::Ptr CICP::AlignPDF(
 		case icpLevenbergMarquardt:
 			resultPDF = ICP_Method_LM(m1, mm2, initialEstimationPDF, outInfo);
 			break;
+		case icpPointToPlane:
+		case icpGICP:
+			THROW_EXCEPTION(
+				"icpPointToPlane and icpGICP are only implemented for ICP-3D")
+			break;
 		default:
 			THROW_EXCEPTION_FMT(
 				"Invalid value for ICP_algorithm: %i",
@@ -123,6 +130,7 @@ CICP::TConfigParams::TConfigParams()
 
 	  kernel_rho(0.07f),
 	  use_kernel(true),
+	  normals_num_neighbors(10),
 	  Axy_aprox_derivatives(0.05f),
 
 	  LM_initial_lambda(1e-4f),
@@ -130,7 +138,8 @@ CICP::TConfigParams::TConfigParams()
 	  skip_cov_calculation(false),
 	  skip_quality_calculation(true),
 
-	  corresponding_points_decimation(5)
+	  corresponding_points_decimation(5),
+	  numThreads(1)
 {
 }
 
@@ -176,6 +185,7 @@ void CICP::TConfigParams::loadFromConfigFile(
 
 	MRPT_LOAD_CONFIG_VAR(kernel_rho, float, iniFile, section);
 	MRPT_LOAD_CONFIG_VAR(use_kernel, bool, iniFile, section);
+	MRPT_LOAD_CONFIG_VAR(normals_num_neighbors, int, iniFile, section);
 	MRPT_LOAD_CONFIG_VAR(Axy_aprox_derivatives, float, iniFile, section);
 	MRPT_LOAD_CONFIG_VAR(LM_initial_lambda, float, iniFile, section);
 
@@ -184,6 +194,7 @@ void CICP::TConfigParams::loadFromConfigFile(
 
 	MRPT_LOAD_CONFIG_VAR(
 		corresponding_points_decimation, int, iniFile, section);
+	MRPT_LOAD_CONFIG_VAR(numThreads, int, iniFile, section);
 }
 
 /*---------------------------------------------------------------
@@ -249,6 +260,9 @@ void CICP::TConfigParams::dumpToTextStream(mrpt::utils::CStream& out) const
 	out.printf(
 		"use_kernel                              = %c\n",
 		use_kernel ? 'Y' : 'N');
+	out.printf(
+		"normals_num_neighbors                   = %u\n",
+		normals_num_neighbors);
 	out.printf(
 		"Axy_aprox_derivatives                   = %f\n",
 		Axy_aprox_derivatives);
@@ -263,6 +277,8 @@ void CICP::TConfigParams::dumpToTextStream(mrpt::utils::CStream& out) const
 	out.printf(
 		"corresponding_points_decimation         = %u\n",
 		(unsigned int)corresponding_points_decimation);
+	out.printf(
+		"numThreads                              = %u\n", numThreads);
 	out.printf("\n");
 }
 
@@ -328,6 +344,7 @@ CPosePDF::Ptr CICP::ICP_Method_Classic(
 	matchParams.onlyUniqueRobust = options.onlyUniqueRobust;
 	matchParams.decimation_other_map_points =
 		options.corresponding_points_decimation;
+	matchParams.threadPool = options.getThreadPool();
 
 	// Asure maps are not empty!
 	// ------------------------------------------------------
@@ -699,6 +716,7 @@ CPosePDF::Ptr CICP::ICP_Method_LM(
 	matchParams.onlyUniqueRobust = onlyUniqueRobust;
 	matchParams.decimation_other_map_points =
 		options.corresponding_points_decimation;
+	matchParams.threadPool = options.getThreadPool();
 
 	// The gaussian PDF to estimate:
 	// ------------------------------------------------------
@@ -1056,11 +1074,14 @@ CPose3DPDF::Ptr CICP::Align3DPDF(
 	switch (options.ICP_algorithm)
 	{
 		case icpClassic:
+		case icpPointToPlane:
+		case icpGICP:
 			resultPDF =
 				ICP3D_Method_Classic(m1, mm2, initialEstimationPDF, outInfo);
 			break;
 		case icpLevenbergMarquardt:
-			THROW_EXCEPTION("Only icpClassic is implemented for ICP-3D")
+			THROW_EXCEPTION(
+				"icpLevenbergMarquardt is not implemented for ICP-3D")
 			break;
 		default:
 			THROW_EXCEPTION_FMT(
@@ -1084,6 +1105,83 @@ CPose3DPDF::Ptr CICP::Align3DPDF(
 	MRPT_END
 }
 
+// One Gauss-Newton step of the point-to-plane (gicp=false) or Generalized-ICP
+// cost of the correspondences between points of m1 ("this") and m2 ("other",
+// in local coordinates), linearized at "pose", which is updated with a
+// left-multiplied SE(3) increment. Returns false if the problem is
+// degenerate.
+static bool ICP3D_GaussNewtonStep(
+	const CPointsMap& m1, const CPointsMap& m2,
+	const TMatchingPairList& correspondences, const bool gicp,
+	const CICP::TConfigParams& options, CPose3D& pose)
+{
+	typedef std::vector<CMatrixFixedNumeric<float, 3, 3>> covs_t;
+	const std::vector<TPoint3Df>& normals1 =
+		m1.getPointsNormals(options.normals_num_neighbors);
+	const covs_t* covs1 =
+		gicp ? &m1.getPointsPlaneCovariances(options.normals_num_neighbors)
+			 : nullptr;
+	const covs_t* covs2 =
+		gicp ? &m2.getPointsPlaneCovariances(options.normals_num_neighbors)
+			 : nullptr;
+
+	RobustKernel<rkPseudoHuber> kernel;
+	kernel.param_sq = square(options.kernel_rho);
+
+	const Eigen::Matrix3d R = pose.getRotationMatrix();
+	Eigen::Matrix<double, 6, 6> H = Eigen::Matrix<double, 6, 6>::Zero();
+	Eigen::Matrix<double, 6, 1> g = Eigen::Matrix<double, 6, 1>::Zero();
+	size_t nUsed = 0;
+
+	for (const TMatchingPair& c : correspondences)
+	{
+		// The transformed point, and its Jacobian wrt the pose increment
+		// [dx dy dz wx wy wz]: dq/deps = [ I | -[q]_x ]
+		Eigen::Vector3d q;
+		pose.composePoint(c.other_x, c.other_y, c.other_z, q[0], q[1], q[2]);
+		const Eigen::Vector3d err =
+			q - Eigen::Vector3d(c.this_x, c.this_y, c.this_z);
+		Eigen::Matrix<double, 3, 6> Jq;
+		Jq.leftCols<3>().setIdentity();
+		Jq.rightCols<3>() << 0, q[2], -q[1], -q[2], 0, q[0], q[1], -q[0], 0;
+
+		double w = 1, w2;
+		if (!gicp)
+		{
+			const TPoint3Df& n = normals1[c.this_idx];
+			const Eigen::Vector3d nv(n.x, n.y, n.z);
+			if (nv.squaredNorm() == 0) continue;  // Unknown normal
+
+			const double r = nv.dot(err);
+			const Eigen::Matrix<double, 1, 6> J = nv.transpose() * Jq;
+			if (options.use_kernel) kernel.eval(r * r, w, w2);
+			H.noalias() += w * J.transpose() * J;
+			g.noalias() += (w * r) * J.transpose();
+		}
+		else
+		{
+			const Eigen::Matrix3d C =
+				(*covs1)[c.this_idx].cast<double>() +
+				R * (*covs2)[c.other_idx].cast<double>() * R.transpose();
+			const Eigen::Matrix3d M = C.inverse();
+			if (options.use_kernel) kernel.eval(err.dot(M * err), w, w2);
+			const Eigen::Matrix<double, 6, 3> JtM = w * Jq.transpose() * M;
+			H.noalias() += JtM * Jq;
+			g.noalias() += JtM * err;
+		}
+		nUsed++;
+	}
+	if (nUsed < 6) return false;
+
+	const Eigen::Matrix<double, 6, 1> delta = H.ldlt().solve(-g);
+	if (!delta.allFinite()) return false;
+
+	CArrayDouble<6> mu;
+	for (int i = 0; i < 6; i++) mu[i] = delta[i];
+	pose = CPose3D::exp(mu) + pose;
+	return true;
+}
+
 CPose3DPDF::Ptr CICP::ICP3D_Method_Classic(
 	const mrpt::maps::CMetricMap* m1, const mrpt::maps::CMetricMap* mm2,
 	const CPose3DPDFGaussian& initialEstimationPDF, TReturnInfo& outInfo)
@@ -1104,6 +1202,14 @@ CPose3DPDF::Ptr CICP::ICP3D_Method_Classic(
 	ASSERT_(mm2->GetRuntimeClass()->derivedFrom(CLASS_ID(CPointsMap)));
 	const CPointsMap* m2 = (CPointsMap*)mm2;
 
+	// Point-to-plane & GICP need the local planes of the reference map:
+	const bool use_gauss_newton = options.ICP_algorithm == icpPointToPlane ||
+								  options.ICP_algorithm == icpGICP;
+	if (use_gauss_newton)
+		ASSERTMSG_(
+			m1->GetRuntimeClass()->derivedFrom(CLASS_ID(CPointsMap)),
+			"icpPointToPlane and icpGICP require a points map as reference");
+
 	// Asserts:
 	// -----------------
 	ASSERT_(options.ALFA > 0 && options.ALFA < 1);
@@ -1133,6 +1239,7 @@ CPose3DPDF::Ptr CICP::ICP3D_Method_Classic(
 	matchParams.onlyUniqueRobust = options.onlyUniqueRobust;
 	matchParams.decimation_other_map_points =
 		options.corresponding_points_decimation;
+	matchParams.threadPool = options.getThreadPool();
 
 	// Asure maps are not empty!
 	// ------------------------------------------------------
@@ -1158,21 +1265,29 @@ CPose3DPDF::Ptr CICP::ICP3D_Method_Classic(
 
 			nCorrespondences = correspondences.size();
 
-			if (!nCorrespondences)
+			if (!nCorrespondences ||
+				(use_gauss_newton &&
+				 !ICP3D_GaussNewtonStep(
+					 *static_cast<const CPointsMap*>(m1), *m2, correspondences,
+					 options.ICP_algorithm == icpGICP, options,
+					 gaussPdf->mean)))
 			{
 				// Nothing we can do !!
 				keepApproaching = false;
 			}
 			else
 			{
-				// Compute the estimated pose, using Horn's method.
-				// ----------------------------------------------------------------------
-				mrpt::poses::CPose3DQuat estPoseQuat;
-				double transf_scale;
-				mrpt::tfest::se3_l2(
-					correspondences, estPoseQuat, transf_scale,
-					false /* dont force unit scale */);
-				gaussPdf->mean = mrpt::poses::CPose3D(estPoseQuat);
+				if (!use_gauss_newton)
+				{
+					// Compute the estimated pose, using Horn's method.
+					// ------------------------------------------------
+					mrpt::poses::CPose3DQuat estPoseQuat;
+					double transf_scale;
+					mrpt::tfest::se3_l2(
+						correspondences, estPoseQuat, transf_scale,
+						false /* dont force unit scale */);
+					gaussPdf->mean = mrpt::poses::CPose3D(estPoseQuat);
+				}
 
 				// If matching has not changed, decrease the thresholds:
 				// --------------------------------------------------------
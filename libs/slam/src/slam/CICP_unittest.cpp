@@ -9,6 +9,7 @@
 
 #include <mrpt/slam/CICP.h>
 #include <mrpt/maps/CSimplePointsMap.h>
+#include <mrpt/maps/CVoxelHashPointsMap.h>
 #include <mrpt/opengl/CAngularObservationMesh.h>
 #include <mrpt/poses/CPosePDF.h>
 #include <mrpt/poses/CPose3DPDF.h>
@@ -383,3 +384,103 @@ TEST_F(ICPTests, RayTracingICP3D)
 		<< "ICP output: mean= " << mean << endl
 		<< "Real displacement: " << SCAN2_POSE_ERROR << endl;
 }
+
+// A synthetic room (floor and two walls) with a box inside:
+static void createSyntheticRoom(CSimplePointsMap& M1)
+{
+	M1.clear();
+	for (float a = -3; a <= 3; a += 0.1f)
+		for (float b = -3; b <= 3; b += 0.1f)
+		{
+			M1.insertPoint(a, b, 0);
+			if (b >= 0)
+			{
+				M1.insertPoint(3, a, b);
+				M1.insertPoint(a, 3, b);
+			}
+		}
+	for (float a = 0; a <= 1; a += 0.05f)
+		for (float b = 0; b <= 1; b += 0.05f)
+		{
+			M1.insertPoint(-1 + a, -1 + b, 1);
+			M1.insertPoint(-1 + a, -1, b);
+			M1.insertPoint(-1, -1 + a, b);
+		}
+}
+
+TEST_F(ICPTests, AlignVoxelHashPointsMap3D)
+{
+	CSimplePointsMap M1;
+	createSyntheticRoom(M1);
+
+	const CPose3D POSE_ERROR(0.15, -0.07, 0.10, -0.03, 0.1, 0.1);
+
+	// The reference map, wrongly-localized, as a voxel map:
+	CVoxelHashPointsMap M2(0.25);
+	M2.insertionOptions.minDistBetweenPoints = 0;
+	M2.insertionOptions.maxPointsPerVoxel = 100;
+	M2.insertPointsFrom(M1, POSE_ERROR);
+
+	CICP icp;
+	CICP::TReturnInfo icp_info;
+	icp.options.thresholdDist = 0.40f;
+	icp.options.thresholdAng = 0;
+
+	CPose3DPDF::Ptr pdf = icp.Align3D(&M2, &M1, CPose3D(), nullptr, &icp_info);
+	const CPose3D mean = pdf->getMeanVal();
+
+	EXPECT_NEAR(
+		0, (mean.getAsVectorVal() - POSE_ERROR.getAsVectorVal())
+			   .array()
+			   .abs()
+			   .mean(),
+		0.02)
+		<< "ICP output: mean= " << mean << endl
+		<< "Real displacement: " << POSE_ERROR << endl;
+}
+
+TEST_F(ICPTests, AlignPointToPlaneAndGICP3D)
+{
+	CSimplePointsMap M1, M2;
+	createSyntheticRoom(M1);
+	const CPose3D POSE_ERROR(0.15, -0.07, 0.10, -0.03, 0.1, 0.1);
+	M2.changeCoordinatesReference(M1, POSE_ERROR);
+
+	const TICPAlgorithm algs[] = {icpClassic, icpPointToPlane, icpGICP};
+	unsigned short nItersClassic = 0;
+	for (const TICPAlgorithm alg : algs)
+	{
+		CICP icp;
+		CICP::TReturnInfo icp_info;
+		icp.options.ICP_algorithm = alg;
+		icp.options.thresholdDist = 0.40f;
+		icp.options.thresholdAng = 0;
+		icp.options.maxIterations = 200;
+
+		CPose3DPDF::Ptr pdf =
+			icp.Align3D(&M2, &M1, CPose3D(), nullptr, &icp_info);
+		const CPose3D mean = pdf->getMeanVal();
+
+		EXPECT_NEAR(
+			0, (mean.getAsVectorVal() - POSE_ERROR.getAsVectorVal())
+				   .array()
+				   .abs()
+				   .mean(),
+			0.01)
+			<< "ICP algorithm: "
+			<< TEnumType<TICPAlgorithm>::value2name(alg) << endl
+			<< "ICP output: mean= " << mean << endl
+			<< "Real displacement: " << POSE_ERROR << endl;
+
+		// Point-to-plane and GICP converge in fewer iterations:
+		if (alg == icpClassic)
+			nItersClassic = icp_info.nIterations;
+		else
+			EXPECT_LT(icp_info.nIterations, nItersClassic);
+	}
+
+	// 2D alignment is not supported:
+	CICP icp;
+	icp.options.ICP_algorithm = icpGICP;
+	EXPECT_THROW(icp.Align(&M2, &M1, CPose2D()), std::exception);
+}
@@ -195,6 +195,32 @@ double
 	return ret;
 }
 
+/*---------------------------------------------------------------
+			PF_SLAM_computeObservationLikelihoodForParticles
+ ---------------------------------------------------------------*/
+void CMonteCarloLocalization2D::
+	PF_SLAM_computeObservationLikelihoodForParticles(
+		const CParticleFilter::TParticleFilterOptions& PF_options,
+		const std::vector<size_t>& particleIndexForMap,
+		const CSensoryFrame& observation, const std::vector<TPose3D>& x,
+		std::vector<double>& out_logliks) const
+{
+	if (!options.metricMap)
+	{
+		// One map per particle: evaluate them one by one.
+		PF_implementation<CPose2D, CMonteCarloLocalization2D>::
+			PF_SLAM_computeObservationLikelihoodForParticles(
+				PF_options, particleIndexForMap, observation, x, out_logliks);
+		return;
+	}
+
+	// All particles, one map:
+	options.metricMap->computeObservationsLikelihoodBatch(
+		observation, x, out_logliks, PF_options.getThreadPool());
+	// Same offset than in PF_SLAM_computeObservationLikelihoodForParticle():
+	for (double& l : out_logliks) l += 1;
+}
+
 // Specialization for my kind of particles:
 void CMonteCarloLocalization2D::
 	PF_SLAM_implementation_custom_update_particle_with_new_pose(
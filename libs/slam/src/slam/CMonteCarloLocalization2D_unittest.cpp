@@ -12,6 +12,9 @@
 #include <mrpt/slam/CMonteCarloLocalization2D.h>
 #include <mrpt/maps/CMultiMetricMap.h>
 #include <mrpt/maps/CSimpleMap.h>
+#include <mrpt/maps/COccupancyGridMap2D.h>
+#include <mrpt/obs/CActionRobotMovement2D.h>
+#include <mrpt/obs/CObservation2DRangeScan.h>
 #include <mrpt/obs/CRawlog.h>
 #include <mrpt/system/filesystem.h>
 #include <mrpt/system/os.h>
@@ -314,3 +317,122 @@ TEST(MonteCarlo2D, RunSampleDataset)
 
 	FAIL() << "Failed to converge after 3 opportunities!!" << endl;
 }
+
+// Runs a few steps of MCL in a synthetic room with the given seed, number of
+// threads and PF algorithm, returning the final particles:
+static void run_test_pf_synthetic_room(
+	const unsigned int numThreads, const uint32_t seed,
+	std::vector<CPose2D>& outPoses, std::vector<double>& outLogWs,
+	const CParticleFilter::TParticleFilterAlgorithm algorithm =
+		CParticleFilter::pfStandardProposal)
+{
+	// A 10x10m room:
+	COccupancyGridMap2D grid(-6, 6, -6, 6, 0.05f);
+	for (float t = -5; t <= 5; t += 0.025f)
+	{
+		grid.setPos(t, -5, 0.01f);
+		grid.setPos(t, 5, 0.01f);
+		grid.setPos(-5, t, 0.01f);
+		grid.setPos(5, t, 0.01f);
+	}
+	// Some obstacle, to break the symmetry:
+	for (float t = 0; t <= 2; t += 0.025f) grid.setPos(1 + t, 2, 0.01f);
+
+	CMultiMetricMap metricMap;
+	metricMap.maps.push_back(
+		CMetricMap::Ptr(COccupancyGridMap2D::Create(grid)));
+
+	getRandomGenerator().randomize(seed);
+
+	CMonteCarloLocalization2D pdf(300);
+	pdf.options.metricMap = &metricMap;
+	pdf.resetUniform(-1, 1, -1, 1, DEG2RAD(-20.0), DEG2RAD(20.0));
+
+	CParticleFilter PF;
+	PF.m_options.PF_algorithm = algorithm;
+	PF.m_options.adaptiveSampleSize = false;
+	PF.m_options.pfAuxFilterOptimal_MaximumSearchSamples = 20;
+	PF.m_options.numThreads = numThreads;
+
+	CPose2D gtPose(0, 0, 0);
+	const CPose2D odoIncr(0.2, 0, DEG2RAD(5.0));
+	for (int step = 0; step < 5; step++)
+	{
+		gtPose = gtPose + odoIncr;
+
+		CActionRobotMovement2D act;
+		act.computeFromOdometry(
+			odoIncr, CActionRobotMovement2D::TMotionModelOptions());
+		CActionCollection acts;
+		acts.insert(act);
+
+		CObservation2DRangeScan::Ptr scan =
+			mrpt::make_aligned_shared<CObservation2DRangeScan>();
+		scan->maxRange = 20;
+		scan->aperture = M_PIf;
+		grid.laserScanSimulator(*scan, gtPose, 0.5f, 181);
+		CSensoryFrame sf;
+		sf.insert(scan);
+
+		PF.executeOn(pdf, &acts, &sf);
+	}
+
+	outPoses.clear();
+	outLogWs.clear();
+	for (const auto& p : pdf.m_particles)
+	{
+		outPoses.push_back(*p.d);
+		outLogWs.push_back(p.log_w);
+	}
+
+	// Sanity check: the filter must track the robot:
+	CPose2D meanPose;
+	pdf.getMean(meanPose);
+	EXPECT_LT((meanPose - gtPose).norm(), 0.25)
+		<< "numThreads=" << numThreads << " algorithm=" << algorithm;
+}
+
+TEST(MonteCarlo2D, MultithreadedIsReproducible)
+{
+	for (unsigned int numThreads : {1u, 3u})
+	{
+		std::vector<CPose2D> poses1, poses2;
+		std::vector<double> ws1, ws2;
+		run_test_pf_synthetic_room(numThreads, 1234, poses1, ws1);
+		run_test_pf_synthetic_room(numThreads, 1234, poses2, ws2);
+
+		ASSERT_EQ(poses1.size(), poses2.size());
+		for (size_t i = 0; i < poses1.size(); i++)
+		{
+			EXPECT_EQ(poses1[i].x(), poses2[i].x());
+			EXPECT_EQ(poses1[i].y(), poses2[i].y());
+			EXPECT_EQ(poses1[i].phi(), poses2[i].phi());
+			EXPECT_EQ(ws1[i], ws2[i]);
+		}
+	}
+}
+
+// The auxiliary PFs evaluate likelihoods in batches, but draw all the
+// samples from the caller thread: same result for any number of threads>1.
+TEST(MonteCarlo2D, AuxiliaryPFMultithreaded)
+{
+	for (auto algorithm : {CParticleFilter::pfAuxiliaryPFStandard,
+						   CParticleFilter::pfAuxiliaryPFOptimal})
+	{
+		std::vector<CPose2D> poses1, poses2, poses4;
+		std::vector<double> ws1, ws2, ws4;
+		run_test_pf_synthetic_room(1, 1234, poses1, ws1, algorithm);
+		run_test_pf_synthetic_room(2, 1234, poses2, ws2, algorithm);
+		run_test_pf_synthetic_room(4, 1234, poses4, ws4, algorithm);
+
+		ASSERT_EQ(poses2.size(), poses4.size());
+		for (size_t i = 0; i < poses2.size(); i++)
+		{
+			EXPECT_EQ(poses2[i].x(), poses4[i].x()) << "algorithm=" << algorithm;
+			EXPECT_EQ(poses2[i].y(), poses4[i].y()) << "algorithm=" << algorithm;
+			EXPECT_EQ(poses2[i].phi(), poses4[i].phi())
+				<< "algorithm=" << algorithm;
+			EXPECT_EQ(ws2[i], ws4[i]) << "algorithm=" << algorithm;
+		}
+	}
+}
@@ -379,8 +379,10 @@ void CMultiMetricMapPDF::rebuildAverageMap()
 
 		// Reserve a float grid-map, add weight all maps
 		// -------------------------------------------------------------------------------------------
+		COccupancyGridMap2D& avrGrid = *averageMap.m_gridMaps[0];
+		const unsigned int size_x = avrGrid.getSizeX();
 		std::vector<float> floatMap;
-		floatMap.resize(averageMap.m_gridMaps[0]->map.size(), 0);
+		floatMap.resize(size_t(size_x) * avrGrid.getSizeY(), 0);
 
 		// For each particle in the RBPF:
 		double sumW = 0;
@@ -389,39 +391,38 @@ void CMultiMetricMapPDF::rebuildAverageMap()
 
 		if (sumW == 0) sumW = 1;
 
+		// Grid cells are accessed row by row, so maps with tiled storage
+		// are supported too:
+		std::vector<COccupancyGridMap2D::cellType> rowBuf;
 		for (part = m_particles.begin(); part != m_particles.end(); ++part)
 		{
-			// Variables:
-			std::vector<COccupancyGridMap2D::cellType>::iterator srcCell;
-			std::vector<COccupancyGridMap2D::cellType>::iterator firstSrcCell =
-				part->d->mapTillNow.m_gridMaps[0]->map.begin();
-			std::vector<COccupancyGridMap2D::cellType>::iterator lastSrcCell =
-				part->d->mapTillNow.m_gridMaps[0]->map.end();
-			std::vector<float>::iterator destCell;
+			const COccupancyGridMap2D& grid =
+				*part->d->mapTillNow.m_gridMaps[0];
 
 			// The weight of particle:
 			float w = exp(part->log_w) / sumW;
 
-			ASSERT_(
-				part->d->mapTillNow.m_gridMaps[0]->map.size() ==
-				floatMap.size());
-
 			// For each cell in individual maps:
-			for (srcCell = firstSrcCell, destCell = floatMap.begin();
-				 srcCell != lastSrcCell; srcCell++, destCell++)
-				(*destCell) += w * (*srcCell);
+			float* destCell = floatMap.data();
+			for (unsigned int cy = 0; cy < grid.getSizeY(); cy++)
+			{
+				const COccupancyGridMap2D::cellType* srcCell =
+					grid.getRowData(cy, rowBuf);
+				for (unsigned int cx = 0; cx < size_x; cx++)
+					(*destCell++) += w * (*srcCell++);
+			}
 		}
 
 		// Copy to fixed point map:
-		std::vector<float>::iterator srcCell;
-		std::vector<COccupancyGridMap2D::cellType>::iterator destCell =
-			averageMap.m_gridMaps[0]->map.begin();
-
-		ASSERT_(averageMap.m_gridMaps[0]->map.size() == floatMap.size());
-
-		for (srcCell = floatMap.begin(); srcCell != floatMap.end();
-			 srcCell++, destCell++)
-			*destCell = static_cast<COccupancyGridMap2D::cellType>(*srcCell);
+		rowBuf.resize(size_x);
+		const float* srcCell = floatMap.data();
+		for (unsigned int cy = 0; cy < avrGrid.getSizeY(); cy++)
+		{
+			for (unsigned int cx = 0; cx < size_x; cx++)
+				rowBuf[cx] =
+					static_cast<COccupancyGridMap2D::cellType>(*srcCell++);
+			avrGrid.setRowData(cy, &rowBuf[0]);
+		}
 
 		MRPT_END
 	}  // End of SSE not supported
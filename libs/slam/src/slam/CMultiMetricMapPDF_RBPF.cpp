@@ -13,6 +13,7 @@
 #include <mrpt/math/utils.h>
 #include <mrpt/utils/CTicTac.h>
 #include <mrpt/utils/CFileStream.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
 
 #include <mrpt/maps/CMultiMetricMapPDF.h>
 #include <mrpt/obs/CActionRobotMovement2D.h>
@@ -1037,3 +1038,61 @@ double CMultiMetricMapPDF::PF_SLAM_computeObservationLikelihoodForParticle(
 		ret += map->computeObservationLikelihood((CObservation*)it->get(), x);
 	return ret;
 }
+
+/*---------------------------------------------------------------
+ Evaluate the observation likelihood for a set of
+   particles at given locations
+ ---------------------------------------------------------------*/
+void CMultiMetricMapPDF::PF_SLAM_computeObservationLikelihoodForParticles(
+	const CParticleFilter::TParticleFilterOptions& PF_options,
+	const std::vector<size_t>& particleIndexForMap,
+	const CSensoryFrame& observation, const std::vector<TPose3D>& x,
+	std::vector<double>& out_logliks) const
+{
+	ASSERT_EQUAL_(particleIndexForMap.size(), x.size())
+	out_logliks.resize(x.size());
+
+	// Each particle has its own map: group consecutive poses evaluated
+	// against the same one (e.g. all the samples drawn for one particle in
+	// the auxiliary PF):
+	std::vector<std::pair<size_t, size_t>> runs;  // [first,last) in "x"
+	for (size_t i = 0; i < x.size();)
+	{
+		size_t j = i + 1;
+		while (j < x.size() && particleIndexForMap[j] == particleIndexForMap[i])
+			j++;
+		runs.emplace_back(i, j);
+		i = j;
+	}
+
+	auto evalRuns = [&](size_t firstRun, size_t lastRun) {
+		std::vector<TPose3D> poses;
+		std::vector<double> logliks;
+		for (size_t r = firstRun; r < lastRun; r++)
+		{
+			const size_t i = runs[r].first, j = runs[r].second;
+			poses.assign(x.begin() + i, x.begin() + j);
+			CMultiMetricMap* map = const_cast<CMultiMetricMap*>(
+				&m_particles[particleIndexForMap[i]].d->mapTillNow);
+			map->computeObservationsLikelihoodBatch(
+				observation, poses, logliks);
+			std::copy(logliks.begin(), logliks.end(), out_logliks.begin() + i);
+		}
+	};
+
+	mrpt::utils::CWorkerThreadsPool* pool = PF_options.getThreadPool();
+	if (!pool || runs.size() < 2)
+	{
+		evalRuns(0, runs.size());
+		return;
+	}
+
+	// Maps of different particles are independent, but the observations
+	// keep lazily-built caches (e.g. their points map), so evaluate the
+	// first run alone to build them, then the rest in parallel:
+	evalRuns(0, 1);
+	const size_t nRemain = runs.size() - 1;
+	pool->parallelChunks(nRemain, [&](size_t first, size_t last, size_t) {
+		evalRuns(first + 1, last + 1);
+	});
+}
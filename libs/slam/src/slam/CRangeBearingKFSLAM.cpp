@@ -141,6 +141,8 @@ void CRangeBearingKFSLAM::getCurrentState(
 {
 	MRPT_START
 
+	makeSureStateIsUpToDate();
+
 	ASSERT_(size_t(m_xkk.size()) >= get_vehicle_size());
 
 	// Copy xyz+quat: (explicitly unroll the loop)
@@ -988,6 +990,8 @@ void CRangeBearingKFSLAM::OnNewLandmarkAddedToMap(
 void CRangeBearingKFSLAM::getAs3DObject(
 	mrpt::opengl::CSetOfObjects::Ptr& outObj) const
 {
+	makeSureStateIsUpToDate();
+
 	outObj->clear();
 
 	// ------------------------------------------------
@@ -1199,6 +1203,8 @@ double CRangeBearingKFSLAM::computeOffDiagonalBlocksApproximationError(
 {
 	MRPT_START
 
+	makeSureStateIsUpToDate();
+
 	// Compute the information matrix:
 	CMatrixTemplateNumeric<kftype> fullCov(m_pkk);
 	size_t i;
@@ -1261,6 +1267,8 @@ void CRangeBearingKFSLAM::saveMapAndPath2DRepresentationAsMATLABFile(
 	const string& fil, float stdCount, const string& styleLandmarks,
 	const string& stylePath, const string& styleRobot) const
 {
+	makeSureStateIsUpToDate();
+
 	FILE* f = os::fopen(fil.c_str(), "wt");
 	if (!f) return;
 
@@ -99,6 +99,8 @@ void CRangeBearingKFSLAM2D::getCurrentState(
 {
 	MRPT_START
 
+	makeSureStateIsUpToDate();
+
 	ASSERT_(m_xkk.size() >= 3);
 
 	// Set 6D pose mean:
@@ -949,6 +951,8 @@ void CRangeBearingKFSLAM2D::OnNewLandmarkAddedToMap(
 void CRangeBearingKFSLAM2D::getAs3DObject(
 	mrpt::opengl::CSetOfObjects::Ptr& outObj) const
 {
+	makeSureStateIsUpToDate();
+
 	outObj->clear();
 
 	// ------------------------------------------------
@@ -1011,6 +1015,8 @@ void CRangeBearingKFSLAM2D::saveMapAndPath2DRepresentationAsMATLABFile(
 	const string& fil, float stdCount, const string& styleLandmarks,
 	const string& stylePath, const string& styleRobot) const
 {
+	makeSureStateIsUpToDate();
+
 	FILE* f = os::fopen(fil.c_str(), "wt");
 	if (!f) return;
 
@@ -0,0 +1,119 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/slam/CRangeBearingKFSLAM2D.h>
+#include <mrpt/obs/CActionRobotMovement2D.h>
+#include <mrpt/obs/CObservationBearingRange.h>
+#include <mrpt/random.h>
+#include <gtest/gtest.h>
+
+using namespace mrpt;
+using namespace mrpt::slam;
+using namespace mrpt::maps;
+using namespace mrpt::obs;
+using namespace mrpt::poses;
+using namespace mrpt::math;
+using namespace mrpt::utils;
+using namespace std;
+
+// A robot driving twice around a circle of landmarks, with noisy odometry and
+// range-bearing observations of the nearby landmarks (with known IDs).
+static void generateDataset(
+	std::vector<CActionCollection::Ptr>& acts,
+	std::vector<CSensoryFrame::Ptr>& SFs)
+{
+	auto& rnd = mrpt::random::getRandomGenerator();
+	rnd.randomize(1234);
+
+	std::vector<TPoint2D> lms;
+	for (int i = 0; i < 36; i++)
+	{
+		const double a = DEG2RAD(10.0 * i);
+		lms.push_back(TPoint2D(8 * cos(a), 8 * sin(a)));
+		lms.push_back(TPoint2D(12 * cos(a + 0.1), 12 * sin(a + 0.1)));
+	}
+
+	const double R = 10, Aa = DEG2RAD(3.0);
+	const CPose2D incr(2 * R * sin(0.5 * Aa), 0, Aa);
+	CPose2D pose(R, 0, M_PI / 2 + 0.5 * Aa);
+	for (int step = 0; step < 240; step++)
+	{
+		pose = pose + incr;
+
+		CActionRobotMovement2D act;
+		CActionRobotMovement2D::TMotionModelOptions opts;
+		const CPose2D odo(
+			incr.x() + rnd.drawGaussian1D(0, 0.01),
+			incr.y() + rnd.drawGaussian1D(0, 0.01),
+			incr.phi() + rnd.drawGaussian1D(0, DEG2RAD(0.2)));
+		act.computeFromOdometry(odo, opts);
+		acts.push_back(mrpt::make_aligned_shared<CActionCollection>());
+		acts.back()->insert(act);
+
+		auto obs = mrpt::make_aligned_shared<CObservationBearingRange>();
+		obs->minSensorDistance = 0;
+		obs->maxSensorDistance = 5;
+		obs->fieldOfView_yaw = 2 * M_PI;
+		obs->fieldOfView_pitch = 0;
+		for (size_t i = 0; i < lms.size(); i++)
+		{
+			TPoint2D p;
+			pose.inverseComposePoint(lms[i], p);
+			const double r = p.norm();
+			if (r > obs->maxSensorDistance) continue;
+			CObservationBearingRange::TMeasurement m;
+			m.range = r + rnd.drawGaussian1D(0, 0.01);
+			m.yaw = atan2(p.y, p.x) + rnd.drawGaussian1D(0, DEG2RAD(0.5));
+			m.pitch = 0;
+			m.landmarkID = i;
+			obs->sensedData.push_back(m);
+		}
+		SFs.push_back(mrpt::make_aligned_shared<CSensoryFrame>());
+		SFs.back()->insert(obs);
+	}
+}
+
+TEST(CRangeBearingKFSLAM2D, CompressedEKFMatchesNaiveEKF)
+{
+	std::vector<CActionCollection::Ptr> acts;
+	std::vector<CSensoryFrame::Ptr> SFs;
+	generateDataset(acts, SFs);
+
+	CRangeBearingKFSLAM2D naive, compressed;
+	naive.KF_options.method = mrpt::bayes::kfEKFNaive;
+	compressed.KF_options.method = mrpt::bayes::kfEKFCompressed;
+	compressed.KF_options.compressed_max_idle_landmarks = 5;
+
+	CPosePDFGaussian pose1, pose2;
+	std::vector<TPoint2D> lms1, lms2;
+	std::map<unsigned int, CLandmark::TLandmarkID> ids1, ids2;
+	CVectorDouble x1, x2;
+	CMatrixDouble P1, P2;
+
+	for (size_t i = 0; i < acts.size(); i++)
+	{
+		naive.processActionObservation(acts[i], SFs[i]);
+		compressed.processActionObservation(acts[i], SFs[i]);
+
+		// Also check intermediate states, which forces the pending global
+		// updates at arbitrary times:
+		if ((i % 50) != 49 && i + 1 != acts.size()) continue;
+
+		naive.getCurrentState(pose1, lms1, ids1, x1, P1);
+		compressed.getCurrentState(pose2, lms2, ids2, x2, P2);
+
+		ASSERT_EQ(x1.size(), x2.size());
+		ASSERT_EQ(P1.rows(), P2.rows());
+		EXPECT_NEAR(0, (x1 - x2).array().abs().maxCoeff(), 1e-6)
+			<< "step: " << i;
+		EXPECT_NEAR(0, (P1 - P2).array().abs().maxCoeff(), 1e-8)
+			<< "step: " << i;
+	}
+	EXPECT_EQ(lms1.size(), 72u);
+}
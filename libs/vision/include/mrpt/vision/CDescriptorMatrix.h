@@ -0,0 +1,143 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#ifndef mrpt_vision_CDescriptorMatrix_H
+#define mrpt_vision_CDescriptorMatrix_H
+
+#include <mrpt/vision/types.h>
+#include <mrpt/vision/CFeature.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
+#include <Eigen/StdVector>  // aligned_allocator
+#include <functional>
+#include <vector>
+
+namespace mrpt
+{
+namespace vision
+{
+/** \addtogroup  mrptvision_features
+	@{ */
+
+/** The descriptors of a set of features packed into one contiguous matrix,
+ * one descriptor per row, for fast brute-force matching with
+ * find_best_two_descriptor_matches() and match_descriptors().
+ *
+ * Binary descriptors (ORB) are stored as 64-bit words and compared by their
+ * Hamming distance (XOR + popcount). Real-valued descriptors (SIFT, SURF)
+ * are stored as floats and compared by their (non-normalized) Euclidean
+ * distance, with SSE2 if available, over 16-byte aligned rows. In both
+ * cases, rows are zero padded, which does not change the distances.
+ *
+ *  Usage example:
+ * \code
+ *  CDescriptorMatrix m1, m2;
+ *  m1.fromFeatureList(feats1, descORB);
+ *  m2.fromFeatureList(feats2, descORB);
+ *  std::vector<std::pair<size_t, size_t>> pairs;
+ *  // Hamming distance below 40, with ratio test:
+ *  match_descriptors(m1, m2, pairs, 40, 0.8f);
+ * \endcode
+ *
+ * \sa mrpt::vision::matchFeatures()
+ */
+class CDescriptorMatrix
+{
+   public:
+	CDescriptorMatrix();
+
+	/** Packs the descriptors of the given type (descSIFT, descSURF or
+	 * descORB) of all features in `list`, in the same order. An exception is
+	 * raised if any feature lacks that descriptor, or their lengths differ.
+	 */
+	void fromFeatureList(const CFeatureList& list, TDescriptorType desc);
+	/** Sets `nRows` binary descriptors of `length` bytes each, stored
+	 * consecutively in `data` */
+	void setBinary(const uint8_t* data, size_t nRows, size_t length);
+	/** Sets `nRows` real-valued descriptors of `length` elements each,
+	 * stored consecutively in `data` */
+	void setReal(const float* data, size_t nRows, size_t length);
+
+	void clear();
+	/** Number of descriptors */
+	size_t rows() const { return m_rows; }
+	/** Descriptor length (bytes for binary ones, elements otherwise) */
+	size_t length() const { return m_length; }
+	bool isBinary() const { return m_binary; }
+	bool empty() const { return m_rows == 0; }
+	/** Distance between the i'th descriptor in this matrix and the j'th one
+	 * in `o`, which must be of the same kind and length */
+	float distance(size_t i, const CDescriptorMatrix& o, size_t j) const;
+
+	/** Row i of a binary matrix, as `stride()` 64-bit words */
+	const uint64_t* binaryRow(size_t i) const
+	{
+		return &m_bin[i * m_stride];
+	}
+	/** Row i of a real-valued matrix, as `stride()` floats */
+	const float* realRow(size_t i) const { return &m_real[i * m_stride]; }
+	/** Number of words (binary) or floats (real-valued) per row */
+	size_t stride() const { return m_stride; }
+
+   private:
+	bool m_binary;
+	size_t m_rows, m_length, m_stride;
+	std::vector<uint64_t> m_bin;
+	std::vector<float, Eigen::aligned_allocator<float>> m_real;
+
+	void resize(bool binary, size_t nRows, size_t length);
+};
+
+/** For each query descriptor, the indices and distances of the two nearest
+ * train descriptors. \sa find_best_two_descriptor_matches */
+struct TDescriptorBestMatches
+{
+	/** Index of the nearest train descriptor, or -1 if none */
+	int32_t best_idx;
+	/** Index of the second nearest train descriptor, or -1 if none */
+	int32_t second_idx;
+	/** Distances to them (Hamming or Euclidean). `max()` if not found. */
+	float best_dist, second_dist;
+
+	TDescriptorBestMatches();
+};
+
+/** Pair filter for find_best_two_descriptor_matches(): only pairs (query
+ * index, train index) for which it returns true are considered */
+using descriptor_pair_filter_t = std::function<bool(size_t, size_t)>;
+
+/** Brute-force search of the two nearest train descriptors for each query
+ * one. The search is split in blocks of query rows run in `pool`, if
+ * provided. The result does not depend on the number of threads: ties are
+ * always resolved in favor of the lowest train index.
+ */
+void find_best_two_descriptor_matches(
+	const CDescriptorMatrix& query, const CDescriptorMatrix& train,
+	std::vector<TDescriptorBestMatches>& out,
+	mrpt::utils::CWorkerThreadsPool* pool = nullptr,
+	const descriptor_pair_filter_t& pair_filter = descriptor_pair_filter_t());
+
+/** Matches query and train descriptors with find_best_two_descriptor_matches()
+ * and returns the pairs (query index, train index) whose best distance is
+ * below `max_distance` and passes the ratio test
+ * `best_dist < max_ratio * second_dist` (use max_ratio>=1 to disable it).
+ * If `cross_check` is true, the pairs must also be the best match of the
+ * train descriptor among the query ones.
+ * \return The number of pairs.
+ */
+size_t match_descriptors(
+	const CDescriptorMatrix& query, const CDescriptorMatrix& train,
+	std::vector<std::pair<size_t, size_t>>& out_pairs,
+	const float max_distance, const float max_ratio = 1.0f,
+	const bool cross_check = false,
+	mrpt::utils::CWorkerThreadsPool* pool = nullptr);
+
+/** @} */  // end of grouping
+}
+}
+#endif
@@ -398,7 +398,7 @@ class CFeatureList : public mrpt::math::KDTreeCapable<CFeatureList>
 
 	inline void push_back(const CFeature::Ptr& f)
 	{
-		mark_kdtree_as_outdated();
+		kdtree_mark_as_appended();
 		m_feats.push_back(f);
 	}
 
@@ -72,6 +72,15 @@ using TBundleAdjustmentFeedbackFunctor = std::function<void(
   *all)
   *		- "profiler": If !=0, displays profiling information to the console at
   *return.
+  *		- "num_threads": Number of threads for the Jacobians and the Schur
+  *complement of the points (default=1; 0: one per CPU core). The result does
+  *not depend on the number of threads.
+  *		- "linear_solver": Solver for the reduced camera system: 0=sparse
+  *Cholesky, whose symbolic analysis is reused across iterations (default); 1=
+  *conjugate gradient with block-Jacobi preconditioner, for large problems.
+  *		- "pcg_max_iterations": Max. iterations of the CG solver (default=500)
+  *		- "pcg_tolerance": Relative residual at which the CG solver stops
+  *(default=1e-8)
   *
   * \note In this function, all coordinates are absolute. Camera frames are such
   *that +Z points forward from the focal point (see the figure in
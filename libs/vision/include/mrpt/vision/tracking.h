@@ -347,6 +347,77 @@ struct CFeatureTracker_KL : public CGenericFeatureTracker
 		FEATLIST& inout_featureList);
 };
 
+/** Track a set of features from old_img -> new_img with a pyramidal
+  *Lucas-Kanade tracker implemented in MRPT, without OpenCV's
+  *cvCalcOpticalFlowPyrLK().
+  *
+  *  Image pyramids are built with SSE2-optimized 2x2 smooth halving, and the
+  *Scharr gradients of each level are computed only once per image. The
+  *pyramid of the last new_img is kept, so it is not built again in the
+  *next call if it becomes the next old_img (the usual case while tracking a
+  *video). Sub-pixel patches are interpolated with fixed-point bilinear
+  *weights and SSE2, and features can be tracked in parallel by a pool of
+  *worker threads. The result does not depend on the number of threads.
+  *
+  *  See CGenericFeatureTracker for a more detailed explanation on how to use
+  *this class.
+  *
+  *   List of additional parameters in "extra_params" (apart from those in
+  *CGenericFeatureTracker) accepted by this class:
+  *		- "window_width"  (Default=15)
+  *		- "window_height" (Default=15)
+  *		- "LK_levels" (Default=3) Number of pyramid levels above the original
+  *image. Less levels are used if the coarsest images would be smaller than
+  *the window.
+  *		- "LK_max_iters" (Default=10) Max. number of iterations in LK tracking.
+  *		- "LK_epsilon" (Default=0.01) Minimum step (in pixels) in
+  *iterations of LK tracking.
+  *		- "LK_max_tracking_error" (Default=150.0) The maximum "tracking
+  *error" (mean absolute intensity difference between the patches) of LK
+  *tracking such as a feature is marked as "lost".
+  *		- "LK_min_eigenvalue" (Default=0.1) Features whose gradient matrix
+  *has a minimum eigenvalue (divided by the number of window pixels) below
+  *this value, in any pyramid level, are marked as "lost".
+  *		- "num_threads" (Default=1) Number of threads to track features and
+  *build pyramids. The pool of threads is kept alive between calls.
+  *
+  *  \sa CFeatureTracker_KL
+  */
+struct CFeatureTracker_PyrLK : public CGenericFeatureTracker
+{
+	/** Default ctor */
+	CFeatureTracker_PyrLK();
+	/** Ctor with extra parameters */
+	CFeatureTracker_PyrLK(mrpt::utils::TParametersDouble extraParams);
+	/** Dtor */
+	virtual ~CFeatureTracker_PyrLK();
+
+	/** Returns the number of calls to trackFeatures() which could reuse the
+	 * pyramid built for the new image in the previous call. */
+	size_t getReusedPyramidsCount() const { return m_reused_pyramids; }
+
+   protected:
+	virtual void trackFeatures_impl(
+		const mrpt::utils::CImage& old_img, const mrpt::utils::CImage& new_img,
+		vision::CFeatureList& inout_featureList) override;
+	virtual void trackFeatures_impl(
+		const mrpt::utils::CImage& old_img, const mrpt::utils::CImage& new_img,
+		TSimpleFeatureList& inout_featureList) override;
+	virtual void trackFeatures_impl(
+		const mrpt::utils::CImage& old_img, const mrpt::utils::CImage& new_img,
+		TSimpleFeaturefList& inout_featureList) override;
+
+   private:
+	struct TImpl;
+	std::unique_ptr<TImpl> m_impl;
+	size_t m_reused_pyramids;
+
+	template <typename FEATLIST>
+	void trackFeatures_impl_templ(
+		const mrpt::utils::CImage& old_img, const mrpt::utils::CImage& new_img,
+		FEATLIST& inout_featureList);
+};
+
 /** Search for correspondences which are not in the same row and deletes them
   * ...
   */
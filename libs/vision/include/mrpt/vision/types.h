@@ -16,6 +16,7 @@
 #include <mrpt/utils/CLoadableOptions.h>
 #include <mrpt/utils/TMatchingPair.h>
 #include <mrpt/utils/TEnumType.h>
+#include <mrpt/utils/CWorkerThreadsPoolHolder.h>
 
 namespace mrpt
 {
@@ -402,8 +403,21 @@ struct TMatchingOptions : public mrpt::utils::CLoadableOptions
 	 * 'min_disp, max_disp' */
 	bool useDisparityLimits;
 	/** Whether or not only permit matches that are consistent from left->right
-	 * and right->left */
+	 * and right->left (only for descriptor-based methods) */
 	bool enable_robust_1to1_match;
+	/** Number of threads for descriptor-based methods (SIFT, SURF, ORB),
+	 * which search the matches of blocks of features in parallel. (Default:
+	 * 1, no threads) */
+	unsigned int numThreads;
+
+	/** Returns the pool of worker threads to be used according to
+	 * numThreads, or nullptr if numThreads<=1. The pool is created on the
+	 * first call and kept alive with these options, but it is not shared
+	 * with their copies. */
+	mrpt::utils::CWorkerThreadsPool* getThreadPool() const
+	{
+		return m_threadPool.get(numThreads);
+	}
 
 	/** Disparity limits, see also 'useDisparityLimits' */
 	float min_disp, max_disp;
@@ -484,7 +498,8 @@ struct TMatchingOptions : public mrpt::utils::CLoadableOptions
 			   CHECK_MEMBER(maxSAD_TH) && CHECK_MEMBER(max_disp) &&
 			   CHECK_MEMBER(minCC_TH) && CHECK_MEMBER(minDCC_TH) &&
 			   CHECK_MEMBER(min_disp) && CHECK_MEMBER(parallelOpticalAxis) &&
-			   CHECK_MEMBER(rCC_TH) && CHECK_MEMBER(SAD_RATIO);
+			   CHECK_MEMBER(rCC_TH) && CHECK_MEMBER(SAD_RATIO) &&
+			   CHECK_MEMBER(numThreads);
 	}
 
 	void operator=(const TMatchingOptions& o)
@@ -513,8 +528,11 @@ struct TMatchingOptions : public mrpt::utils::CLoadableOptions
 		COPY_MEMBER(parallelOpticalAxis)
 		COPY_MEMBER(rCC_TH)
 		COPY_MEMBER(SAD_RATIO)
+		COPY_MEMBER(numThreads)
 	}
 
+   private:
+	mrpt::utils::CWorkerThreadsPoolHolder m_threadPool;
 };  // end struct TMatchingOptions
 
 /** Struct containing the output after matching multi-resolution SIFT-like
@@ -0,0 +1,349 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include "vision-precomp.h"  // Precompiled headers
+
+#include <mrpt/vision/CDescriptorMatrix.h>
+
+#if MRPT_HAS_SSE2
+#include <mrpt/utils/SSE_types.h>
+#endif
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>  // __popcnt64
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace mrpt;
+using namespace mrpt::vision;
+using namespace mrpt::utils;
+using namespace std;
+
+namespace
+{
+/** Number of train rows compared with each query row of a block before
+ * moving to the next ones, so they are still in cache for the next query */
+const size_t TRAIN_BLOCK_ROWS = 256;
+
+inline unsigned int popcount64(uint64_t v)
+{
+#if defined(__GNUC__)
+	return static_cast<unsigned int>(__builtin_popcountll(v));
+#elif defined(_MSC_VER) && defined(_M_X64)
+	return static_cast<unsigned int>(__popcnt64(v));
+#else
+	v = v - ((v >> 1) & 0x5555555555555555ULL);
+	v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+	v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return static_cast<unsigned int>((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+inline unsigned int hamming(const uint64_t* a, const uint64_t* b, size_t n)
+{
+	unsigned int d0 = 0, d1 = 0;
+	size_t k = 0;
+	for (; k + 2 <= n; k += 2)
+	{
+		d0 += popcount64(a[k] ^ b[k]);
+		d1 += popcount64(a[k + 1] ^ b[k + 1]);
+	}
+	if (k < n) d0 += popcount64(a[k] ^ b[k]);
+	return d0 + d1;
+}
+
+/** Squared Euclidean distance. `n` must be a multiple of 4, and both
+ * pointers 16-byte aligned. */
+inline float sqrL2(const float* a, const float* b, size_t n)
+{
+#if MRPT_HAS_SSE2
+	__m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+	size_t k = 0;
+	for (; k + 8 <= n; k += 8)
+	{
+		const __m128 d0 = _mm_sub_ps(_mm_load_ps(a + k), _mm_load_ps(b + k));
+		const __m128 d1 =
+			_mm_sub_ps(_mm_load_ps(a + k + 4), _mm_load_ps(b + k + 4));
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+	}
+	if (k < n)
+	{
+		const __m128 d0 = _mm_sub_ps(_mm_load_ps(a + k), _mm_load_ps(b + k));
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+	}
+	acc0 = _mm_add_ps(acc0, acc1);
+	acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+	acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+	return _mm_cvtss_f32(acc0);
+#else
+	float d[4] = {0, 0, 0, 0};
+	for (size_t k = 0; k < n; k += 4)
+		for (int l = 0; l < 4; l++)
+			d[l] += mrpt::utils::square(a[k + l] - b[k + l]);
+	return (d[0] + d[2]) + (d[1] + d[3]);
+#endif
+}
+
+/** Running search of the two nearest train rows of one query row */
+struct TTop2
+{
+	float best, second;
+	int32_t best_idx, second_idx;
+
+	TTop2()
+		: best(std::numeric_limits<float>::max()),
+		  second(std::numeric_limits<float>::max()),
+		  best_idx(-1),
+		  second_idx(-1)
+	{
+	}
+	inline void update(float d, size_t j)
+	{
+		if (d < best)
+		{
+			second = best;
+			second_idx = best_idx;
+			best = d;
+			best_idx = static_cast<int32_t>(j);
+		}
+		else if (d < second)
+		{
+			second = d;
+			second_idx = static_cast<int32_t>(j);
+		}
+	}
+};
+
+/** Searches the query rows [first,last), comparing them to blocks of train
+ * rows at a time. Train rows are visited in increasing order for each query
+ * row, so ties go to the lowest index as in a plain nested loop. */
+void findBestTwoInRange(
+	const CDescriptorMatrix& query, const CDescriptorMatrix& train,
+	const descriptor_pair_filter_t& pair_filter, size_t first, size_t last,
+	TDescriptorBestMatches* out)
+{
+	const size_t nTrain = train.rows(), n = query.stride();
+	const bool binary = query.isBinary();
+	std::vector<TTop2> top(last - first);
+
+	for (size_t j0 = 0; j0 < nTrain; j0 += TRAIN_BLOCK_ROWS)
+	{
+		const size_t j1 = std::min(nTrain, j0 + TRAIN_BLOCK_ROWS);
+		for (size_t i = first; i < last; i++)
+		{
+			TTop2& t = top[i - first];
+			if (binary)
+			{
+				const uint64_t* q = query.binaryRow(i);
+				for (size_t j = j0; j < j1; j++)
+				{
+					if (pair_filter && !pair_filter(i, j)) continue;
+					t.update(float(hamming(q, train.binaryRow(j), n)), j);
+				}
+			}
+			else
+			{
+				const float* q = query.realRow(i);
+				for (size_t j = j0; j < j1; j++)
+				{
+					if (pair_filter && !pair_filter(i, j)) continue;
+					t.update(sqrL2(q, train.realRow(j), n), j);
+				}
+			}
+		}
+	}
+
+	for (size_t i = first; i < last; i++)
+	{
+		const TTop2& t = top[i - first];
+		TDescriptorBestMatches& o = out[i];
+		o.best_idx = t.best_idx;
+		o.second_idx = t.second_idx;
+		o.best_dist = t.best;
+		o.second_dist = t.second;
+		if (!binary)
+		{
+			if (t.best_idx >= 0) o.best_dist = std::sqrt(t.best);
+			if (t.second_idx >= 0) o.second_dist = std::sqrt(t.second);
+		}
+	}
+}
+}  // end anonymous namespace
+
+CDescriptorMatrix::CDescriptorMatrix()
+	: m_binary(false), m_rows(0), m_length(0), m_stride(0)
+{
+}
+
+void CDescriptorMatrix::clear()
+{
+	m_rows = m_length = m_stride = 0;
+	m_bin.clear();
+	m_real.clear();
+}
+
+void CDescriptorMatrix::resize(bool binary, size_t nRows, size_t length)
+{
+	m_binary = binary;
+	m_rows = nRows;
+	m_length = length;
+	if (binary)
+	{
+		// An even number of 64-bit words, for the unrolled hamming():
+		m_stride = 2 * ((length + 15) / 16);
+		m_bin.assign(m_rows * m_stride, 0);
+		m_real.clear();
+	}
+	else
+	{
+		m_stride = 4 * ((length + 3) / 4);
+		m_real.assign(m_rows * m_stride, .0f);
+		m_bin.clear();
+	}
+}
+
+void CDescriptorMatrix::setBinary(
+	const uint8_t* data, size_t nRows, size_t length)
+{
+	ASSERT_(data || !nRows || !length);
+	resize(true, nRows, length);
+	if (!length) return;
+	for (size_t i = 0; i < nRows; i++)
+		std::memcpy(&m_bin[i * m_stride], data + i * length, length);
+}
+
+void CDescriptorMatrix::setReal(const float* data, size_t nRows, size_t length)
+{
+	ASSERT_(data || !nRows || !length);
+	resize(false, nRows, length);
+	if (!length) return;
+	for (size_t i = 0; i < nRows; i++)
+		std::memcpy(
+			&m_real[i * m_stride], data + i * length, length * sizeof(float));
+}
+
+void CDescriptorMatrix::fromFeatureList(
+	const CFeatureList& list, TDescriptorType desc)
+{
+	MRPT_START
+	ASSERTMSG_(
+		desc == descSIFT || desc == descSURF || desc == descORB,
+		"Only SIFT, SURF and ORB descriptors are supported");
+
+	const size_t N = list.size();
+	size_t len = 0;
+	if (N)
+	{
+		const auto& d0 = list[0]->descriptors;
+		len = desc == descSIFT ? d0.SIFT.size()
+							   : desc == descSURF ? d0.SURF.size()
+												  : d0.ORB.size();
+	}
+	resize(desc == descORB, N, len);
+
+	for (size_t i = 0; i < N; i++)
+	{
+		const auto& d = list[i]->descriptors;
+		switch (desc)
+		{
+			case descSIFT:
+			{
+				ASSERT_(d.hasDescriptorSIFT() && d.SIFT.size() == len);
+				float* r = &m_real[i * m_stride];
+				for (size_t k = 0; k < len; k++) r[k] = d.SIFT[k];
+				break;
+			}
+			case descSURF:
+				ASSERT_(d.hasDescriptorSURF() && d.SURF.size() == len);
+				std::memcpy(
+					&m_real[i * m_stride], &d.SURF[0], len * sizeof(float));
+				break;
+			default:
+				ASSERT_(d.hasDescriptorORB() && d.ORB.size() == len);
+				std::memcpy(&m_bin[i * m_stride], &d.ORB[0], len);
+				break;
+		}
+	}
+	MRPT_END
+}
+
+float CDescriptorMatrix::distance(
+	size_t i, const CDescriptorMatrix& o, size_t j) const
+{
+	ASSERT_(m_binary == o.m_binary && m_length == o.m_length);
+	ASSERT_(i < m_rows && j < o.m_rows);
+	if (m_binary)
+		return float(hamming(binaryRow(i), o.binaryRow(j), m_stride));
+	else
+		return std::sqrt(sqrL2(realRow(i), o.realRow(j), m_stride));
+}
+
+TDescriptorBestMatches::TDescriptorBestMatches()
+	: best_idx(-1),
+	  second_idx(-1),
+	  best_dist(std::numeric_limits<float>::max()),
+	  second_dist(std::numeric_limits<float>::max())
+{
+}
+
+void mrpt::vision::find_best_two_descriptor_matches(
+	const CDescriptorMatrix& query, const CDescriptorMatrix& train,
+	std::vector<TDescriptorBestMatches>& out, CWorkerThreadsPool* pool,
+	const descriptor_pair_filter_t& pair_filter)
+{
+	MRPT_START
+	ASSERTMSG_(
+		query.isBinary() == train.isBinary() &&
+			query.length() == train.length(),
+		"Both descriptor matrices must be of the same kind and length");
+
+	const size_t N = query.rows();
+	out.assign(N, TDescriptorBestMatches());
+	if (!N || train.empty()) return;
+
+	const auto f = [&](size_t first, size_t last, size_t) {
+		findBestTwoInRange(query, train, pair_filter, first, last, &out[0]);
+	};
+	if (pool)
+		pool->parallelChunks(N, f);
+	else
+		f(0, N, 0);
+	MRPT_END
+}
+
+size_t mrpt::vision::match_descriptors(
+	const CDescriptorMatrix& query, const CDescriptorMatrix& train,
+	std::vector<std::pair<size_t, size_t>>& out_pairs,
+	const float max_distance, const float max_ratio, const bool cross_check,
+	CWorkerThreadsPool* pool)
+{
+	MRPT_START
+	out_pairs.clear();
+
+	std::vector<TDescriptorBestMatches> fwd, bwd;
+	find_best_two_descriptor_matches(query, train, fwd, pool);
+	if (cross_check) find_best_two_descriptor_matches(train, query, bwd, pool);
+
+	for (size_t i = 0; i < fwd.size(); i++)
+	{
+		const TDescriptorBestMatches& m = fwd[i];
+		if (m.best_idx < 0 || !(m.best_dist < max_distance)) continue;
+		if (max_ratio < 1.0f && m.second_idx >= 0 &&
+			!(m.best_dist < max_ratio * m.second_dist))
+			continue;
+		if (cross_check && bwd[m.best_idx].best_idx != int32_t(i)) continue;
+		out_pairs.emplace_back(i, size_t(m.best_idx));
+	}
+	return out_pairs.size();
+	MRPT_END
+}
@@ -0,0 +1,288 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/vision/CDescriptorMatrix.h>
+#include <mrpt/random.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+
+using namespace mrpt::vision;
+using namespace mrpt::utils;
+using namespace std;
+
+namespace
+{
+const size_t NQ = 150, NT = 230;
+
+void randomBinary(
+	vector<uint8_t>& d, size_t nRows, size_t len,
+	mrpt::random::CRandomGenerator& rng)
+{
+	d.resize(nRows * len);
+	for (auto& b : d) b = static_cast<uint8_t>(rng.drawUniform32bit() & 0xFF);
+}
+
+void randomReal(
+	vector<float>& d, size_t nRows, size_t len,
+	mrpt::random::CRandomGenerator& rng)
+{
+	d.resize(nRows * len);
+	for (auto& v : d) v = static_cast<float>(rng.drawUniform(0.0, 1.0));
+}
+
+double naiveHamming(const uint8_t* a, const uint8_t* b, size_t len)
+{
+	unsigned n = 0;
+	for (size_t k = 0; k < len; k++)
+		for (uint8_t x = a[k] ^ b[k]; x; x &= x - 1) n++;
+	return n;
+}
+
+double naiveL2(const float* a, const float* b, size_t len)
+{
+	double s = 0;
+	for (size_t k = 0; k < len; k++) s += mrpt::math::square(a[k] - b[k]);
+	return std::sqrt(s);
+}
+
+// Naive distance table between all query (rows) and train (cols) descriptors
+template <typename T, typename DIST>
+vector<vector<double>> naiveDistances(
+	const vector<T>& q, const vector<T>& t, size_t len, DIST dist)
+{
+	const size_t nq = q.size() / len, nt = t.size() / len;
+	vector<vector<double>> D(nq, vector<double>(nt));
+	for (size_t i = 0; i < nq; i++)
+		for (size_t j = 0; j < nt; j++)
+			D[i][j] = dist(&q[i * len], &t[j * len], len);
+	return D;
+}
+
+// Checks find_best_two_descriptor_matches() against the distance table.
+// Distances are compared (not indices) with `tol`, since real-valued
+// descriptors may have near ties summed in a different order.
+void checkBestTwo(
+	const vector<TDescriptorBestMatches>& m, const vector<vector<double>>& D,
+	double tol)
+{
+	ASSERT_EQ(m.size(), D.size());
+	for (size_t i = 0; i < D.size(); i++)
+	{
+		vector<double> row = D[i];
+		std::sort(row.begin(), row.end());
+		ASSERT_GE(m[i].best_idx, 0);
+		ASSERT_GE(m[i].second_idx, 0);
+		EXPECT_NE(m[i].best_idx, m[i].second_idx);
+		EXPECT_NEAR(m[i].best_dist, row[0], tol) << "query: " << i;
+		EXPECT_NEAR(m[i].second_dist, row[1], tol) << "query: " << i;
+		EXPECT_NEAR(D[i][m[i].best_idx], row[0], tol) << "query: " << i;
+		EXPECT_NEAR(D[i][m[i].second_idx], row[1], tol) << "query: " << i;
+		if (tol == 0)
+		{
+			// Exact distances: ties go to the lowest train index.
+			const size_t lowest =
+				std::find(D[i].begin(), D[i].end(), row[0]) - D[i].begin();
+			EXPECT_EQ(size_t(m[i].best_idx), lowest) << "query: " << i;
+		}
+	}
+}
+
+// Naive version of match_descriptors()
+void naiveMatch(
+	const vector<vector<double>>& D, float max_dist, float max_ratio,
+	bool cross_check, vector<pair<size_t, size_t>>& out)
+{
+	out.clear();
+	if (D.empty()) return;
+	const size_t nq = D.size(), nt = D[0].size();
+	for (size_t i = 0; i < nq; i++)
+	{
+		size_t best = 0;
+		for (size_t j = 1; j < nt; j++)
+			if (D[i][j] < D[i][best]) best = j;
+		double second = std::numeric_limits<double>::max();
+		for (size_t j = 0; j < nt; j++)
+			if (j != best) second = std::min(second, D[i][j]);
+		if (!(D[i][best] < max_dist)) continue;
+		if (max_ratio < 1.0f && !(D[i][best] < max_ratio * second)) continue;
+		if (cross_check)
+		{
+			size_t back = 0;
+			for (size_t k = 1; k < nq; k++)
+				if (D[k][best] < D[back][best]) back = k;
+			if (back != i) continue;
+		}
+		out.emplace_back(i, best);
+	}
+}
+
+bool sameMatches(
+	const vector<TDescriptorBestMatches>& a,
+	const vector<TDescriptorBestMatches>& b)
+{
+	if (a.size() != b.size()) return false;
+	for (size_t i = 0; i < a.size(); i++)
+		if (a[i].best_idx != b[i].best_idx ||
+			a[i].second_idx != b[i].second_idx ||
+			a[i].best_dist != b[i].best_dist ||
+			a[i].second_dist != b[i].second_dist)
+			return false;
+	return true;
+}
+}
+
+TEST(CDescriptorMatrix, HammingDistance)
+{
+	mrpt::random::CRandomGenerator rng(1234);
+	// 32 bytes (ORB) and an odd length, to test the padding:
+	for (size_t len : {32u, 13u})
+	{
+		vector<uint8_t> q, t;
+		randomBinary(q, NQ, len, rng);
+		randomBinary(t, NT, len, rng);
+		CDescriptorMatrix mq, mt;
+		mq.setBinary(&q[0], NQ, len);
+		mt.setBinary(&t[0], NT, len);
+		EXPECT_TRUE(mq.isBinary());
+		EXPECT_EQ(mq.rows(), NQ);
+		EXPECT_EQ(mq.length(), len);
+
+		const auto D = naiveDistances(q, t, len, naiveHamming);
+		for (size_t i = 0; i < NQ; i++)
+			for (size_t j = 0; j < NT; j++)
+				EXPECT_EQ(mq.distance(i, mt, j), D[i][j]);
+
+		vector<TDescriptorBestMatches> m;
+		find_best_two_descriptor_matches(mq, mt, m);
+		checkBestTwo(m, D, 0);
+	}
+}
+
+TEST(CDescriptorMatrix, L2Distance)
+{
+	mrpt::random::CRandomGenerator rng(4321);
+	// 64 (SURF), 128 (SIFT) and an odd length, to test the padding:
+	for (size_t len : {64u, 128u, 7u})
+	{
+		vector<float> q, t;
+		randomReal(q, NQ, len, rng);
+		randomReal(t, NT, len, rng);
+		CDescriptorMatrix mq, mt;
+		mq.setReal(&q[0], NQ, len);
+		mt.setReal(&t[0], NT, len);
+		EXPECT_FALSE(mq.isBinary());
+
+		const auto D = naiveDistances(q, t, len, naiveL2);
+		for (size_t i = 0; i < NQ; i++)
+			for (size_t j = 0; j < NT; j++)
+				EXPECT_NEAR(mq.distance(i, mt, j), D[i][j], 1e-4);
+
+		vector<TDescriptorBestMatches> m;
+		find_best_two_descriptor_matches(mq, mt, m);
+		checkBestTwo(m, D, 1e-4);
+	}
+}
+
+TEST(CDescriptorMatrix, PairFilter)
+{
+	mrpt::random::CRandomGenerator rng(99);
+	const size_t len = 32;
+	vector<uint8_t> q, t;
+	randomBinary(q, NQ, len, rng);
+	randomBinary(t, NT, len, rng);
+	CDescriptorMatrix mq, mt;
+	mq.setBinary(&q[0], NQ, len);
+	mt.setBinary(&t[0], NT, len);
+
+	// Only even train indices are allowed:
+	vector<TDescriptorBestMatches> m;
+	find_best_two_descriptor_matches(
+		mq, mt, m, nullptr, [](size_t, size_t j) { return (j % 2) == 0; });
+
+	auto D = naiveDistances(q, t, len, naiveHamming);
+	for (auto& row : D)
+		for (size_t j = 1; j < NT; j += 2)
+			row[j] = std::numeric_limits<double>::max();
+	checkBestTwo(m, D, 0);
+}
+
+TEST(CDescriptorMatrix, MatchRatioAndCrossCheck)
+{
+	mrpt::random::CRandomGenerator rng(555);
+	const size_t len = 32;
+	vector<uint8_t> q, t;
+	randomBinary(t, NT, len, rng);
+	// Query descriptors: noisy copies of some train ones (true matches)
+	// plus random ones:
+	randomBinary(q, NQ, len, rng);
+	for (size_t i = 0; i < NQ / 2; i++)
+	{
+		const size_t j = (i * 7) % NT;
+		for (size_t k = 0; k < len; k++)
+		{
+			q[i * len + k] = t[j * len + k];
+			if (rng.drawUniform(0.0, 1.0) < 0.2)
+				q[i * len + k] ^= static_cast<uint8_t>(1u << (k % 8));
+		}
+	}
+	CDescriptorMatrix mq, mt;
+	mq.setBinary(&q[0], NQ, len);
+	mt.setBinary(&t[0], NT, len);
+	const auto D = naiveDistances(q, t, len, naiveHamming);
+
+	for (float max_dist : {40.f, 300.f})
+		for (float max_ratio : {1.0f, 0.8f})
+			for (bool cross_check : {false, true})
+			{
+				vector<pair<size_t, size_t>> pairs, ref;
+				const size_t n = match_descriptors(
+					mq, mt, pairs, max_dist, max_ratio, cross_check);
+				naiveMatch(D, max_dist, max_ratio, cross_check, ref);
+				EXPECT_EQ(n, pairs.size());
+				EXPECT_EQ(pairs, ref) << "max_dist=" << max_dist
+									  << " max_ratio=" << max_ratio
+									  << " cross_check=" << cross_check;
+			}
+
+	// All the true matches must pass the ratio test and the cross-check:
+	vector<pair<size_t, size_t>> pairs;
+	match_descriptors(mq, mt, pairs, 40, 0.8f, true);
+	EXPECT_GE(pairs.size(), NQ / 2);
+	for (const auto& p : pairs)
+		if (p.first < NQ / 2) EXPECT_EQ(p.second, (p.first * 7) % NT);
+}
+
+TEST(CDescriptorMatrix, ThreadCountInvariance)
+{
+	mrpt::random::CRandomGenerator rng(777);
+	const size_t nq = 1000, len = 64;
+	vector<float> q, t;
+	randomReal(q, nq, len, rng);
+	randomReal(t, NT, len, rng);
+	CDescriptorMatrix mq, mt;
+	mq.setReal(&q[0], nq, len);
+	mt.setReal(&t[0], NT, len);
+
+	vector<TDescriptorBestMatches> ref;
+	vector<pair<size_t, size_t>> ref_pairs;
+	find_best_two_descriptor_matches(mq, mt, ref);
+	match_descriptors(mq, mt, ref_pairs, 2.5f, 0.9f, true);
+
+	for (unsigned nThreads : {1u, 2u, 4u, 7u})
+	{
+		CWorkerThreadsPool pool(nThreads);
+		vector<TDescriptorBestMatches> m;
+		vector<pair<size_t, size_t>> pairs;
+		find_best_two_descriptor_matches(mq, mt, m, &pool);
+		match_descriptors(mq, mt, pairs, 2.5f, 0.9f, true, &pool);
+		EXPECT_TRUE(sameMatches(m, ref)) << "nThreads=" << nThreads;
+		EXPECT_EQ(pairs, ref_pairs) << "nThreads=" << nThreads;
+	}
+}
@@ -11,10 +11,13 @@
 
 #include <mrpt/vision/bundle_adjustment.h>
 #include <mrpt/utils/CTimeLogger.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
 #include <mrpt/math/CSparseMatrix.h>
 #include <mrpt/math/ops_containers.h>
 
+#include <algorithm>
 #include <memory>  // unique_ptr
+#include <thread>
 
 #include "ba_internals.h"
 
@@ -36,6 +39,322 @@ using mrpt::aligned_containers;
 #define INV_POSES_BOOL false
 #endif
 
+namespace
+{
+// Generic BA problem dimension numbers:
+const unsigned int FrameDof = 6;  // Poses: x y z yaw pitch roll
+const unsigned int PointDof = 3;  // Landmarks: x y z
+const unsigned int ObsDim = 2;  // Obs: x y (pixels)
+const size_t BlockLen = FrameDof * FrameDof;
+
+// Typedefs for this specific BA problem:
+typedef JacData<FrameDof, PointDof, ObsDim> MyJacData;
+typedef aligned_containers<MyJacData>::vector_t MyJacDataVec;
+
+typedef std::array<double, ObsDim> Array_O;
+typedef CArrayDouble<FrameDof> Array_F;
+typedef CArrayDouble<PointDof> Array_P;
+typedef CMatrixFixedNumeric<double, FrameDof, FrameDof> Matrix_FxF;
+typedef CMatrixFixedNumeric<double, PointDof, PointDof> Matrix_PxP;
+typedef CMatrixFixedNumeric<double, FrameDof, PointDof> Matrix_FxP;
+// A 6x6 block of the reduced camera system, stored as BlockLen doubles:
+typedef Eigen::Map<Eigen::Matrix<double, FrameDof, FrameDof, Eigen::RowMajor>>
+	BlockMap;
+typedef Eigen::Map<
+	const Eigen::Matrix<double, FrameDof, FrameDof, Eigen::RowMajor>>
+	ConstBlockMap;
+
+/** The structure of a BA problem, which does not change between iterations:
+ * which free points are seen from which free frames, and which 6x6 blocks
+ * of the reduced camera system (the Schur complement of the points in the
+ * Hessian) are not zero. Only the blocks in its upper triangle are kept.
+ */
+struct TBAStructure
+{
+	/** The frames (free frame index) seeing each free point `i`, in
+	 * increasing order, are pair_frame[p] for p in
+	 * [point_pair_start[i], point_pair_start[i+1]) */
+	std::vector<size_t> point_pair_start, pair_frame;
+	/** The observations of each such (point,frame) pair `p` are pair_obs[k]
+	 * for k in [pair_obs_start[p], pair_obs_start[p+1]) */
+	std::vector<size_t> pair_obs_start, pair_obs;
+	/** The free point of each pair `p` is pair_point[p]. The pairs of each
+	 * free frame `j`, in increasing order of point, are frame_pair[q] for q
+	 * in [frame_pair_start[j], frame_pair_start[j+1]) */
+	std::vector<size_t> pair_point, frame_pair_start, frame_pair;
+	/** The blocks in the column of each free frame `j` are `b` in
+	 * [col_blk_start[j], col_blk_start[j+1]), sorted by their row (free frame
+	 * index) blk_row[b]. The last one is always the diagonal block. */
+	std::vector<size_t> col_blk_start, blk_row;
+	/** The block of each pair of frames (a,b), a<=b, seeing each free point
+	 * `i`, in the order (0,0),(0,1),...,(1,1),(1,2),... from
+	 * point_blk[point_blk_start[i]] */
+	std::vector<size_t> point_blk_start;
+	std::vector<uint32_t> point_blk;
+	/** Scalar reduced camera system (upper triangle only), with a fixed
+	 * sparsity pattern so its symbolic Cholesky decomposition can be reused */
+	CSparseMatrix sp_S;
+	/** Index in the values of sp_S of each entry of each block (row-major),
+	 * -1 for the lower half of diagonal blocks */
+	std::vector<int> blk_value_idx;
+
+	size_t nBlocks() const { return blk_row.size(); }
+	size_t nFrames() const { return col_blk_start.size() - 1; }
+	size_t nPoints() const { return point_pair_start.size() - 1; }
+
+	/** The block of the pairs a<=b of the point `i` */
+	size_t pointBlock(const size_t i, const size_t a, const size_t b) const
+	{
+		const size_t p0 = point_pair_start[i];
+		const size_t n = point_pair_start[i + 1] - p0, la = a - p0;
+		return point_blk
+			[point_blk_start[i] + la * (2 * n - la + 1) / 2 + (b - a)];
+	}
+
+	/** Sum of J_frame^T * J_point of the observations of the pair `p` */
+	void computeW(
+		const MyJacDataVec& jac_data_vec, const size_t p, Matrix_FxP& W) const
+	{
+		Matrix_FxP tmp(UNINITIALIZED_MATRIX);
+		W.setZero();
+		for (size_t k = pair_obs_start[p]; k < pair_obs_start[p + 1]; k++)
+		{
+			const MyJacData& D = jac_data_vec[pair_obs[k]];
+			tmp.multiply_AtB(D.J_frame, D.J_point);
+			W += tmp;
+		}
+	}
+
+	void build(
+		const TSequenceFeatureObservations& observations,
+		const size_t num_fix_frames, const size_t num_fix_points,
+		const size_t num_free_frames, const size_t num_free_points);
+};
+
+void TBAStructure::build(
+	const TSequenceFeatureObservations& observations,
+	const size_t num_fix_frames, const size_t num_fix_points,
+	const size_t num_free_frames, const size_t num_free_points)
+{
+	const size_t num_obs = observations.size();
+	const auto isFree = [&](const TFeatureObservation& o) {
+		return o.id_frame >= num_fix_frames && o.id_feature >= num_fix_points;
+	};
+
+	// Observations of free points from free frames, grouped by point and
+	// sorted by frame:
+	std::vector<size_t> point_obs_start(num_free_points + 1, 0);
+	for (size_t k = 0; k < num_obs; k++)
+		if (isFree(observations[k]))
+			point_obs_start[observations[k].id_feature - num_fix_points + 1]++;
+	for (size_t i = 0; i < num_free_points; i++)
+		point_obs_start[i + 1] += point_obs_start[i];
+	pair_obs.resize(point_obs_start.back());
+	{
+		std::vector<size_t> next(
+			point_obs_start.begin(), point_obs_start.end() - 1);
+		for (size_t k = 0; k < num_obs; k++)
+			if (isFree(observations[k]))
+				pair_obs
+					[next[observations[k].id_feature - num_fix_points]++] = k;
+	}
+
+	point_pair_start.assign(num_free_points + 1, 0);
+	pair_frame.clear();
+	pair_obs_start.clear();
+	pair_point.clear();
+	for (size_t i = 0; i < num_free_points; i++)
+	{
+		const auto itFirst = pair_obs.begin() + point_obs_start[i];
+		const auto itLast = pair_obs.begin() + point_obs_start[i + 1];
+		std::sort(itFirst, itLast, [&](size_t k1, size_t k2) {
+			return observations[k1].id_frame < observations[k2].id_frame ||
+				   (observations[k1].id_frame == observations[k2].id_frame &&
+					k1 < k2);
+		});
+		point_pair_start[i] = pair_frame.size();
+		for (auto it = itFirst; it != itLast; ++it)
+		{
+			const size_t j = observations[*it].id_frame - num_fix_frames;
+			if (pair_frame.size() == point_pair_start[i] ||
+				pair_frame.back() != j)
+			{
+				pair_frame.push_back(j);
+				pair_point.push_back(i);
+				pair_obs_start.push_back(it - pair_obs.begin());
+			}
+		}
+	}
+	point_pair_start[num_free_points] = pair_frame.size();
+	pair_obs_start.push_back(pair_obs.size());
+
+	// Pairs of each frame (pairs are already sorted by point):
+	frame_pair_start.assign(num_free_frames + 1, 0);
+	frame_pair.resize(pair_frame.size());
+	for (size_t p = 0; p < pair_frame.size(); p++)
+		frame_pair_start[pair_frame[p] + 1]++;
+	for (size_t j = 0; j < num_free_frames; j++)
+		frame_pair_start[j + 1] += frame_pair_start[j];
+	{
+		std::vector<size_t> next(
+			frame_pair_start.begin(), frame_pair_start.end() - 1);
+		for (size_t p = 0; p < pair_frame.size(); p++)
+			frame_pair[next[pair_frame[p]]++] = p;
+	}
+
+	// Blocks of the upper triangle, column by column: frames j1<=j2 seeing
+	// at least one common point, plus all the diagonal blocks.
+	col_blk_start.assign(num_free_frames + 1, 0);
+	blk_row.clear();
+	{
+		std::vector<size_t> mark(num_free_frames, std::string::npos);
+		std::vector<size_t> rows;
+		for (size_t j2 = 0; j2 < num_free_frames; j2++)
+		{
+			rows.clear();
+			rows.push_back(j2);
+			mark[j2] = j2;
+			for (size_t q = frame_pair_start[j2];
+				 q < frame_pair_start[j2 + 1]; q++)
+			{
+				const size_t i = pair_point[frame_pair[q]];
+				for (size_t p = point_pair_start[i];
+					 p < point_pair_start[i + 1] && pair_frame[p] < j2; p++)
+				{
+					const size_t j1 = pair_frame[p];
+					if (mark[j1] == j2) continue;
+					mark[j1] = j2;
+					rows.push_back(j1);
+				}
+			}
+			std::sort(rows.begin(), rows.end());
+			col_blk_start[j2] = blk_row.size();
+			blk_row.insert(blk_row.end(), rows.begin(), rows.end());
+		}
+		col_blk_start[num_free_frames] = blk_row.size();
+	}
+	ASSERT_(blk_row.size() < std::numeric_limits<uint32_t>::max());
+
+	// Blocks affected by each point:
+	point_blk_start.assign(num_free_points + 1, 0);
+	point_blk.clear();
+	for (size_t i = 0; i < num_free_points; i++)
+	{
+		point_blk_start[i] = point_blk.size();
+		for (size_t a = point_pair_start[i]; a < point_pair_start[i + 1]; a++)
+			for (size_t b = a; b < point_pair_start[i + 1]; b++)
+			{
+				const size_t j1 = pair_frame[a], j2 = pair_frame[b];
+				const auto itFirst = blk_row.begin() + col_blk_start[j2];
+				const auto itLast = blk_row.begin() + col_blk_start[j2 + 1];
+				const auto it = std::lower_bound(itFirst, itLast, j1);
+				ASSERTDEB_(it != itLast && *it == j1)
+				point_blk.push_back(uint32_t(it - blk_row.begin()));
+			}
+	}
+	point_blk_start[num_free_points] = point_blk.size();
+
+	// Scalar sparse matrix with all the entries of those blocks. Entries are
+	// inserted column by column, and compressFromTriplet() keeps that order
+	// within each column, so the index of each one in the values of the
+	// matrix is just the insertion order.
+	const size_t nB = nBlocks();
+	sp_S.clear(num_free_frames * FrameDof, num_free_frames * FrameDof);
+	blk_value_idx.assign(nB * BlockLen, -1);
+	int idx = 0;
+	for (size_t j2 = 0; j2 < num_free_frames; j2++)
+		for (size_t c = 0; c < FrameDof; c++)
+			for (size_t b = col_blk_start[j2]; b < col_blk_start[j2 + 1]; b++)
+			{
+				const size_t j1 = blk_row[b];
+				for (size_t r = 0; r < (j1 == j2 ? c + 1 : FrameDof); r++)
+				{
+					sp_S.insert_entry_fast(
+						j1 * FrameDof + r, j2 * FrameDof + c, 0);
+					blk_value_idx[b * BlockLen + r * FrameDof + c] = idx++;
+				}
+			}
+	sp_S.compressFromTriplet();
+	ASSERTDEB_(
+		!nB ||
+		sp_S.getColumnCompressedIndex(
+			blk_row[nB - 1] * FrameDof + FrameDof - 1,
+			num_free_frames * FrameDof - 1) == idx - 1)
+}
+
+/** Solves S*x=b for the reduced camera system S, given by the blocks of its
+ * upper triangle, with the conjugate gradient method preconditioned with the
+ * inverse of its diagonal blocks (block-Jacobi).
+ * \exception CExceptionNotDefPos If S turns out not to be positive definite.
+ */
+void solveReducedSystemPCG(
+	const TBAStructure& st, const std::vector<double>& S_blocks,
+	const CVectorDouble& b, CVectorDouble& x, const size_t max_iters,
+	const double tolerance)
+{
+	typedef Eigen::Matrix<double, FrameDof, FrameDof> Mat66;
+	const size_t nF = st.nFrames(), n = nF * FrameDof;
+
+	aligned_containers<Mat66>::vector_t M_inv(nF);
+	for (size_t j = 0; j < nF; j++)
+	{
+		const Mat66 D = ConstBlockMap(
+			&S_blocks[(st.col_blk_start[j + 1] - 1) * BlockLen]);
+		const Eigen::LLT<Mat66> llt(D);
+		if (llt.info() != Eigen::Success)
+			throw CExceptionNotDefPos(
+				"solveReducedSystemPCG: Not positive definite matrix.");
+		M_inv[j] = llt.solve(Mat66::Identity());
+	}
+	const auto precond = [&](const CVectorDouble& v, CVectorDouble& out) {
+		out.resize(n);
+		for (size_t j = 0; j < nF; j++)
+			out.segment<FrameDof>(j * FrameDof) =
+				M_inv[j] * v.segment<FrameDof>(j * FrameDof);
+	};
+	const auto multiply = [&](const CVectorDouble& v, CVectorDouble& out) {
+		out.setZero(n);
+		for (size_t j2 = 0; j2 < nF; j2++)
+			for (size_t blk = st.col_blk_start[j2];
+				 blk < st.col_blk_start[j2 + 1]; blk++)
+			{
+				const size_t j1 = st.blk_row[blk];
+				const ConstBlockMap B(&S_blocks[blk * BlockLen]);
+				out.segment<FrameDof>(j1 * FrameDof) +=
+					B * v.segment<FrameDof>(j2 * FrameDof);
+				if (j1 != j2)
+					out.segment<FrameDof>(j2 * FrameDof) +=
+						B.transpose() * v.segment<FrameDof>(j1 * FrameDof);
+			}
+	};
+
+	x.setZero(n);
+	const double b_norm = b.norm();
+	if (b_norm == 0) return;
+
+	CVectorDouble r = b, z, p, Ap;
+	precond(r, z);
+	p = z;
+	double rz = r.dot(z);
+	for (size_t iter = 0; iter < max_iters; iter++)
+	{
+		multiply(p, Ap);
+		const double pAp = p.dot(Ap);
+		if (!(pAp > 0))
+			throw CExceptionNotDefPos(
+				"solveReducedSystemPCG: Not positive definite matrix.");
+		const double alpha = rz / pAp;
+		x += alpha * p;
+		r -= alpha * Ap;
+		if (r.norm() <= tolerance * b_norm) break;
+		precond(r, z);
+		const double rz_new = r.dot(z);
+		p = z + (rz_new / rz) * p;
+		rz = rz_new;
+	}
+}
+}  // end anonymous namespace
+
 /* ----------------------------------------------------------
 					bundle_adj_full
 
@@ -58,22 +377,6 @@ double mrpt::vision::bundle_adj_full(
 {
 	MRPT_START
 
-	// Generic BA problem dimension numbers:
-	static const unsigned int FrameDof = 6;  // Poses: x y z yaw pitch roll
-	static const unsigned int PointDof = 3;  // Landmarks: x y z
-	static const unsigned int ObsDim = 2;  // Obs: x y (pixels)
-
-	// Typedefs for this specific BA problem:
-	typedef JacData<FrameDof, PointDof, ObsDim> MyJacData;
-	typedef aligned_containers<MyJacData>::vector_t MyJacDataVec;
-
-	typedef std::array<double, ObsDim> Array_O;
-	typedef CArrayDouble<FrameDof> Array_F;
-	typedef CArrayDouble<PointDof> Array_P;
-	typedef CMatrixFixedNumeric<double, FrameDof, FrameDof> Matrix_FxF;
-	typedef CMatrixFixedNumeric<double, PointDof, PointDof> Matrix_PxP;
-	typedef CMatrixFixedNumeric<double, FrameDof, PointDof> Matrix_FxP;
-
 	// Extra params:
 	const bool use_robust_kernel =
 		0 != extra_params.getWithDefaultVal("robust_kernel", 1);
@@ -87,6 +390,14 @@ double mrpt::vision::bundle_adj_full(
 		extra_params.getWithDefaultVal("num_fix_points", 0);
 	const double kernel_param =
 		extra_params.getWithDefaultVal("kernel_param", 3.0);
+	size_t num_threads = extra_params.getWithDefaultVal("num_threads", 1);
+	if (!num_threads) num_threads = std::thread::hardware_concurrency();
+	const bool use_pcg =
+		1 == extra_params.getWithDefaultVal("linear_solver", 0);
+	const size_t pcg_max_iters =
+		extra_params.getWithDefaultVal("pcg_max_iterations", 500);
+	const double pcg_tolerance =
+		extra_params.getWithDefaultVal("pcg_tolerance", 1e-8);
 
 	const bool enable_profiler =
 		0 != extra_params.getWithDefaultVal("profiler", 0);
@@ -106,6 +417,16 @@ double mrpt::vision::bundle_adj_full(
 	ASSERT_ABOVEEQ_(num_frames, num_fix_frames);
 	ASSERT_ABOVEEQ_(num_points, num_fix_points);
 
+	std::unique_ptr<CWorkerThreadsPool> pool;
+	if (num_threads > 1) pool.reset(new CWorkerThreadsPool(num_threads));
+	const auto parallel_for = [&pool](
+		size_t N, const std::function<void(size_t, size_t, size_t)>& f) {
+		if (pool)
+			pool->parallelChunks(N, f);
+		else
+			f(0, N, 0);
+	};
+
 #ifdef USE_INVERSE_POSES
 	// *Warning*: This implementation assumes inverse camera poses: inverse them
 	// at the entrance and at exit:
@@ -129,7 +450,7 @@ double mrpt::vision::bundle_adj_full(
 	profiler.enter("compute_Jacobians");
 	ba_compute_Jacobians<INV_POSES_BOOL>(
 		frame_poses, landmark_points, camera_params, jac_data_vec,
-		num_fix_frames, num_fix_points);
+		num_fix_frames, num_fix_points, pool.get());
 	profiler.leave("compute_Jacobians");
 
 	profiler.enter("reprojectionResiduals");
@@ -169,6 +490,18 @@ double mrpt::vision::bundle_adj_full(
 		use_robust_kernel ? &kernel_1st_deriv : nullptr);
 	profiler.leave("build_gradient_Hessians");
 
+	// Which points are seen from which frames does not change, so the block
+	// structure of the reduced camera system is only built once:
+	profiler.enter("build_structure");
+	TBAStructure st;
+	st.build(
+		observations, num_fix_frames, num_fix_points, num_free_frames,
+		num_free_points);
+	profiler.leave("build_structure");
+	const size_t nBlocks = st.nBlocks();
+
+	VERBOSE_COUT << "Blocks in the reduced camera system: " << nBlocks << endl;
+
 	double nu = 2;
 	double eps = 1e-16;  // 0.000000000000001;
 	bool stop = false;
@@ -189,14 +522,22 @@ double mrpt::vision::bundle_adj_full(
 		mu = tau * norm_max_A;
 	}
 
-	Matrix_FxF I_muFrame(UNINITIALIZED_MATRIX);
 	Matrix_PxP I_muPoint(UNINITIALIZED_MATRIX);
 
-	// Cholesky object, as a pointer to reuse it between iterations:
+	// Cholesky object, as a pointer to reuse it between iterations: its
+	// symbolic analysis (fill-reducing ordering) is only done once.
 	typedef std::unique_ptr<CSparseMatrix::CholeskyDecomp> SparseCholDecompPtr;
 
 	SparseCholDecompPtr ptrCh;
 
+	// Buffers kept between iterations: the inverse of the point blocks of
+	// the Hessian (plus mu*I), the frame-point blocks W and Y=W*V^{-1} of
+	// each (point,frame) pair, and the blocks of the reduced camera system
+	aligned_containers<Matrix_PxP>::vector_t V_inv(num_free_points);
+	aligned_containers<Matrix_FxP>::vector_t W_pair(st.pair_frame.size()),
+		Y_pair(st.pair_frame.size());
+	std::vector<double> S_blocks(nBlocks * BlockLen);
+
 	for (size_t iter = 0; iter < max_iters; iter++)
 	{
 		VERBOSE_COUT << "iteration: " << iter << endl;
@@ -214,164 +555,125 @@ double mrpt::vision::bundle_adj_full(
 
 			VERBOSE_COUT << "mu: " << mu << endl;
 
-			I_muFrame.unit(FrameDof, mu);
 			I_muPoint.unit(PointDof, mu);
 
-			aligned_containers<Matrix_FxF>::vector_t U_star(
-				num_free_frames, I_muFrame);
-			aligned_containers<Matrix_PxP>::vector_t V_inv(num_free_points);
-
-			for (size_t i = 0; i < U_star.size(); ++i) U_star[i] += H_f[i];
-
-			for (size_t i = 0; i < H_p.size(); ++i)
-				(H_p[i] + I_muPoint).inv_fast(V_inv[i]);
-
-			typedef aligned_containers<pair<TCameraPoseID, TLandmarkID>,
-									   Matrix_FxP>::map_t WMap;
-			WMap W, Y;
-
-			// For quick look-up of entries in W affecting a given point ID:
-			vector<vector<WMap::iterator>> W_entries(
-				num_points);  // Index is "TLandmarkID"
-
-			MyJacDataVec::const_iterator jac_iter = jac_data_vec.begin();
-			for (TSequenceFeatureObservations::const_iterator it_obs =
-					 observations.begin();
-				 it_obs != observations.end(); ++it_obs)
-			{
-				const TFeatureID feat_id = it_obs->id_feature;
-				const TCameraPoseID frame_id = it_obs->id_frame;
-
-				if (jac_iter->J_frame_valid && jac_iter->J_point_valid)
-				{
-					const CMatrixFixedNumeric<double, ObsDim, FrameDof>&
-						J_frame = jac_iter->J_frame;
-					const CMatrixFixedNumeric<double, ObsDim, PointDof>&
-						J_point = jac_iter->J_point;
-					const pair<TCameraPoseID, TLandmarkID> id_pair =
-						make_pair(frame_id, feat_id);
-
-					Matrix_FxP tmp(UNINITIALIZED_MATRIX);
-					tmp.multiply_AtB(J_frame, J_point);
-
-					// W[ids] = J_f^T * J_p
-					// Was: W[id_pair] = tmp;
-					const pair<WMap::iterator, bool>& retInsert =
-						W.insert(make_pair(id_pair, tmp));
-					ASSERT_(retInsert.second == true)
-					W_entries[feat_id].push_back(
-						retInsert.first);  // Keep the iterator
-
-					// Y[ids] = W[ids] * H_p^{-1}
-					Y[id_pair].multiply_AB(
-						tmp, V_inv[feat_id - num_fix_points]);
-				}
-				++jac_iter;
-			}
-
-			aligned_containers<pair<TCameraPoseID, TLandmarkID>,
-							   Matrix_FxF>::map_t YW_map;
-			for (size_t i = 0; i < H_f.size(); ++i)
-				YW_map[std::pair<TCameraPoseID, TLandmarkID>(i, i)] = U_star[i];
-
 			CVectorDouble delta(
 				len_free_frames + len_free_points);  // The optimal step
 			CVectorDouble e(len_free_frames);
 
+			// Schur complement of the points:
+			//  S = U* - sum_i W_i * V*_i^{-1} * W_i^T
+			//  e = eps_frame - sum_i W_i * V*_i^{-1} * eps_point_i
+			// with U*, V* the frame and point blocks of the Hessian (plus
+			// mu*I) and W_i the blocks between the point "i" and the frames
+			// seeing it. First, W and Y=W*V*^{-1} are computed for all the
+			// pairs, in parallel by points. Then, each column of blocks of S
+			// (and its part of e) is summed up by one thread, always in the
+			// order of points, so the result does not depend on the number
+			// of threads.
 			profiler.enter("Schur.build.reduced.frames");
-			for (size_t j = 0; j < num_free_frames; ++j)
-				::memcpy(
-					&e[j * FrameDof], &eps_frame[j][0],
-					sizeof(e[0]) * FrameDof);  // e.slice(j*FrameDof,FrameDof) =
-			// AT(eps_frame,j);
-
-			for (WMap::iterator Y_ij = Y.begin(); Y_ij != Y.end(); ++Y_ij)
-			{
-				const TLandmarkID point_id = Y_ij->first.second;
-				const size_t i =
-					Y_ij->first.second - num_fix_points;  // point index
-				const size_t j =
-					Y_ij->first.first - num_fix_frames;  // frame index
-
-				const vector<WMap::iterator>& iters =
-					W_entries[point_id];  //->second;
-
-				for (size_t itIdx = 0; itIdx < iters.size(); itIdx++)
-				// for (size_t k=0; k<num_free_frames; ++k)
-				{
-					const WMap::iterator& W_ik = iters[itIdx];
-					const TLandmarkID k = W_ik->first.first - num_fix_frames;
-
-					Matrix_FxF YWt(UNINITIALIZED_MATRIX);  //-(Y_ij->second) *
-					//(W_ik->second).T();
-					YWt.multiply_ABt(Y_ij->second, W_ik->second);
-					// YWt*=-1.0; // The "-" sign is taken into account below:
-
-					const pair<TCameraPoseID, TLandmarkID> ids_jk =
-						pair<TCameraPoseID, TLandmarkID>(j, k);
-
-					aligned_containers<pair<TCameraPoseID, TLandmarkID>,
-									   Matrix_FxF>::map_t::iterator it =
-						YW_map.find(ids_jk);
-					if (it != YW_map.end())
-						it->second -= YWt;  // += (-YWt);
-					else
-						YW_map[ids_jk] = YWt * (-1.0);
-				}
-
-				CArrayDouble<FrameDof> r;
-				Y_ij->second.multiply_Ab(eps_point[i], r);
-				for (size_t k = 0; k < FrameDof; k++)
-					e[j * FrameDof + k] -= r[k];
-			}
+			parallel_for(
+				num_free_points, [&](size_t first, size_t last, size_t) {
+					for (size_t i = first; i < last; i++)
+					{
+						(H_p[i] + I_muPoint).inv_fast(V_inv[i]);
+						for (size_t p = st.point_pair_start[i];
+							 p < st.point_pair_start[i + 1]; p++)
+						{
+							st.computeW(jac_data_vec, p, W_pair[p]);
+							Y_pair[p].multiply_AB(W_pair[p], V_inv[i]);
+						}
+					}
+				});
+			parallel_for(
+				num_free_frames, [&](size_t first, size_t last, size_t) {
+					Array_F e_j, r;
+					for (size_t j2 = first; j2 < last; j2++)
+					{
+						std::fill(
+							S_blocks.begin() +
+								st.col_blk_start[j2] * BlockLen,
+							S_blocks.begin() +
+								st.col_blk_start[j2 + 1] * BlockLen,
+							0.0);
+						e_j = eps_frame[j2];
+						for (size_t q = st.frame_pair_start[j2];
+							 q < st.frame_pair_start[j2 + 1]; q++)
+						{
+							const size_t b = st.frame_pair[q];
+							const size_t i = st.pair_point[b];
+							Y_pair[b].multiply_Ab(eps_point[i], r);
+							e_j -= r;
+							// Blocks (j1,j2) for the frames j1<=j2 seeing
+							// this point:
+							for (size_t a = st.point_pair_start[i]; a <= b;
+								 a++)
+								BlockMap(
+									&S_blocks
+										[BlockLen * st.pointBlock(i, a, b)])
+									.noalias() -=
+									Y_pair[a] * W_pair[b].transpose();
+						}
+						BlockMap D(
+							&S_blocks
+								[(st.col_blk_start[j2 + 1] - 1) * BlockLen]);
+						D += H_f[j2];
+						D.diagonal().array() += mu;
+						for (size_t k = 0; k < FrameDof; k++)
+							e[j2 * FrameDof + k] = e_j[k];
+					}
+				});
 			profiler.leave("Schur.build.reduced.frames");
 
 			profiler.enter("sS:ALL");
-			profiler.enter("sS:fill");
-
-			VERBOSE_COUT << "Entries in YW_map:" << YW_map.size() << endl;
-
-			CSparseMatrix sS(len_free_frames, len_free_frames);
-
-			for (aligned_containers<pair<TCameraPoseID, TLandmarkID>,
-									Matrix_FxF>::map_t::const_iterator it =
-					 YW_map.begin();
-				 it != YW_map.end(); ++it)
-			{
-				const pair<TCameraPoseID, TLandmarkID>& ids = it->first;
-				const Matrix_FxF& YW = it->second;
-				sS.insert_submatrix(
-					ids.first * FrameDof, ids.second * FrameDof, YW);
-			}
-			profiler.leave("sS:fill");
-
-			// Compress the sparse matrix:
-			profiler.enter("sS:compress");
-			sS.compressFromTriplet();
-			profiler.leave("sS:compress");
-
 			try
 			{
-				profiler.enter("sS:chol");
-				if (!ptrCh.get())
-					ptrCh.reset(new CSparseMatrix::CholeskyDecomp(sS));
+				CVectorDouble bck_res;
+				if (!len_free_frames)
+				{
+				}
+				else if (use_pcg)
+				{
+					profiler.enter("sS:pcg");
+					solveReducedSystemPCG(
+						st, S_blocks, e, bck_res, pcg_max_iters,
+						pcg_tolerance);
+					profiler.leave("sS:pcg");
+				}
 				else
-					ptrCh.get()->update(sS);
-				profiler.leave("sS:chol");
+				{
+					// The structure of sS never changes: just refill its
+					// values.
+					profiler.enter("sS:fill");
+					double* sS_values = st.sp_S.getValuesPtr();
+					for (size_t k = 0; k < nBlocks * BlockLen; k++)
+						if (st.blk_value_idx[k] >= 0)
+							sS_values[st.blk_value_idx[k]] = S_blocks[k];
+					profiler.leave("sS:fill");
+
+					profiler.enter("sS:chol");
+					if (!ptrCh.get())
+						ptrCh.reset(new CSparseMatrix::CholeskyDecomp(st.sp_S));
+					else
+						ptrCh.get()->update(st.sp_S);
+					profiler.leave("sS:chol");
 
-				profiler.enter("sS:backsub");
-				CVectorDouble bck_res;
-				ptrCh->backsub(e, bck_res);  // Ax = b -->  delta= x*
-				::memcpy(
-					&delta[0], &bck_res[0],
-					bck_res.size() * sizeof(bck_res[0]));  // delta.slice(0,...)
+					profiler.enter("sS:backsub");
+					ptrCh->backsub(e, bck_res);  // Ax = b -->  delta= x*
+					profiler.leave("sS:backsub");
+				}
+				if (len_free_frames)
+					::memcpy(
+						&delta[0], &bck_res[0],
+						bck_res.size() *
+							sizeof(bck_res[0]));  // delta.slice(0,...)
 				// = Ch.backsub(e);
-				profiler.leave("sS:backsub");
 				profiler.leave("sS:ALL");
 			}
 			catch (CExceptionNotDefPos&)
 			{
 				profiler.leave("sS:ALL");
+				profiler.leave("COMPLETE_ITER");
 				// not positive definite so increase mu and try again
 				mu *= nu;
 				nu *= 2.;
@@ -381,47 +683,38 @@ double mrpt::vision::bundle_adj_full(
 
 			profiler.enter("PostSchur.landmarks");
 
-			CVectorDouble g(len_free_frames + len_free_points);
-			::memcpy(
-				&g[0], &e[0],
-				len_free_frames *
-					sizeof(
-						g[0]));  // g.slice(0,FrameDof*(num_frames-num_fix_frames))
-			// = e;
-
-			for (size_t i = 0; i < num_free_points; ++i)
-			{
-				Array_P tmp =
-					eps_point[i];  // eps_point.slice(PointDof*i,PointDof);
-
-				for (size_t j = 0; j < num_free_frames; ++j)
-				{
-					WMap::iterator W_ij;
-					W_ij = W.find(
-						make_pair(
-							TCameraPoseID(j + num_fix_frames),
-							TLandmarkID(i + num_fix_points)));
-
-					if (W_ij != W.end())
+			// delta_point_i = V*_i^{-1} * (eps_point_i - W_i^T * delta_frames)
+			parallel_for(
+				num_free_points, [&](size_t first, size_t last, size_t) {
+					for (size_t i = first; i < last; ++i)
 					{
-						// tmp -= W_ij->second.T() *
-						// delta.slice(j*FrameDof,FrameDof);
-						const Array_F v(&delta[j * FrameDof]);
-						Array_P r;
-						W_ij->second.multiply_Atb(v, r);  // r= A^t * v
-						tmp -= r;
+						Array_P tmp = eps_point[i];
+						for (size_t p = st.point_pair_start[i];
+							 p < st.point_pair_start[i + 1]; p++)
+						{
+							const Array_F v(
+								&delta[st.pair_frame[p] * FrameDof]);
+							Array_P r;
+							W_pair[p].multiply_Atb(v, r);  // r= A^t * v
+							tmp -= r;
+						}
+						Array_P Vi_tmp;
+						// Vi_tmp = V_inv[i] * tmp
+						V_inv[i].multiply_Ab(tmp, Vi_tmp);
+
+						::memcpy(
+							&delta[len_free_frames + i * PointDof], &Vi_tmp[0],
+							sizeof(Vi_tmp[0]) * PointDof);
 					}
-				}
-				Array_P Vi_tmp;
-				V_inv[i].multiply_Ab(tmp, Vi_tmp);  // Vi_tmp = V_inv[i] * tmp
-
-				::memcpy(
-					&delta[len_free_frames + i * PointDof], &Vi_tmp[0],
-					sizeof(Vi_tmp[0]) * PointDof);
-				::memcpy(
-					&g[len_free_frames + i * PointDof], &eps_point[i][0],
-					sizeof(eps_point[0][0]) * PointDof);
-			}
+				});
+
+			// The gradient, for the stop condition:
+			double g_norm_inf = 0;
+			for (size_t k = 0; k < len_free_frames; k++)
+				keep_max(g_norm_inf, std::abs(e[k]));
+			for (size_t i = 0; i < num_free_points; ++i)
+				for (size_t k = 0; k < PointDof; k++)
+					keep_max(g_norm_inf, std::abs(eps_point[i][k]));
 			profiler.leave("PostSchur.landmarks");
 
 			// Vars for temptative new estimates:
@@ -475,7 +768,7 @@ double mrpt::vision::bundle_adj_full(
 				profiler.enter("compute_Jacobians");
 				ba_compute_Jacobians<INV_POSES_BOOL>(
 					frame_poses, landmark_points, camera_params, jac_data_vec,
-					num_fix_frames, num_fix_points);
+					num_fix_frames, num_fix_points, pool.get());
 				profiler.leave("compute_Jacobians");
 
 				// Reset to zeros:
@@ -491,7 +784,7 @@ double mrpt::vision::bundle_adj_full(
 					use_robust_kernel ? &kernel_1st_deriv : nullptr);
 				profiler.leave("build_gradient_Hessians");
 
-				stop = norm_inf(g) <= eps;
+				stop = g_norm_inf <= eps;
 				// mu *= max(1.0/3.0, 1-std::pow(2*rho-1,3.0) );
 				mu *= 0.1;
 				mu = std::max(mu, 1e-100);
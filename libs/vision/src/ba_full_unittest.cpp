@@ -0,0 +1,180 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/vision/bundle_adjustment.h>
+#include <mrpt/vision/pinhole.h>
+#include <mrpt/random.h>
+#include <gtest/gtest.h>
+#include <cmath>
+
+using namespace mrpt;
+using namespace mrpt::utils;
+using namespace mrpt::math;
+using namespace mrpt::poses;
+using namespace mrpt::vision;
+using namespace std;
+
+namespace
+{
+// A small synthetic problem, similar to the one in bundle_adj_full_demo:
+// a camera moving along a line while looking at a cloud of points.
+struct TSyntheticBA
+{
+	TCamera cam;
+	TSequenceFeatureObservations obs;
+	TFramePosesVec poses_real, poses_noisy;
+	TLandmarkLocationsVec pts_real, pts_noisy;
+
+	TSyntheticBA()
+	{
+		random::CRandomGenerator rg(1234);
+		cam.ncols = 800;
+		cam.nrows = 600;
+		cam.fx(400);
+		cam.fy(400);
+		cam.cx(400);
+		cam.cy(300);
+
+		const size_t nPts = 80;
+		const double L1 = 30, L2 = 5, L3 = 5;
+		pts_real.resize(nPts);
+		for (auto& p : pts_real)
+		{
+			p.x = rg.drawUniform(-L1, L1);
+			p.y = rg.drawUniform(-L2, L2);
+			p.z = rg.drawUniform(-L3, L3);
+		}
+
+		const double pathLen = L1 * 1.2;
+		for (double x = -pathLen; x < pathLen; x += pathLen / 6)
+		{
+			const TPose3D p(
+				x, 4 * L2, 0, DEG2RAD(-90) - DEG2RAD(30) * x / pathLen, 0, 0);
+			// +Z of the camera pointing forward:
+			poses_real.push_back(
+				CPose3D(p) + CPose3D(0, 0, 0, DEG2RAD(-90), 0, DEG2RAD(-90)));
+		}
+
+		for (size_t i = 0; i < poses_real.size(); i++)
+			for (size_t j = 0; j < nPts; j++)
+			{
+				TPixelCoordf px = pinhole::projectPoint_no_distortion<false>(
+					cam, poses_real[i], pts_real[j]);
+				px.x += rg.drawGaussian1D(0, 0.1);
+				px.y += rg.drawGaussian1D(0, 0.1);
+				if (px.x < 0 || px.y < 0 || px.x > cam.ncols ||
+					px.y > cam.nrows)
+					continue;
+				obs.push_back(TFeatureObservation(j, i, px));
+			}
+
+		// Noisy starting point. The first two frames are kept fixed, which
+		// also fixes the scale:
+		poses_noisy = poses_real;
+		pts_noisy = pts_real;
+		for (auto& p : pts_noisy)
+			p += TPoint3D(
+				rg.drawGaussian1D(0, 0.1), rg.drawGaussian1D(0, 0.1),
+				rg.drawGaussian1D(0, 0.1));
+		for (size_t i = 2; i < poses_noisy.size(); i++)
+		{
+			CPose3D& p = poses_noisy[i];
+			p.setFromValues(
+				p.x() + rg.drawGaussian1D(0, 0.05),
+				p.y() + rg.drawGaussian1D(0, 0.05),
+				p.z() + rg.drawGaussian1D(0, 0.05),
+				p.yaw() + rg.drawGaussian1D(0, DEG2RAD(2)),
+				p.pitch() + rg.drawGaussian1D(0, DEG2RAD(2)),
+				p.roll() + rg.drawGaussian1D(0, DEG2RAD(2)));
+		}
+	}
+
+	double solve(
+		int linear_solver, int num_threads, TFramePosesVec& poses,
+		TLandmarkLocationsVec& pts) const
+	{
+		poses = poses_noisy;
+		pts = pts_noisy;
+		TParametersDouble params;
+		params["max_iterations"] = 100;
+		params["robust_kernel"] = 0;
+		params["num_fix_frames"] = 2;
+		params["linear_solver"] = linear_solver;
+		params["num_threads"] = num_threads;
+		return bundle_adj_full(obs, cam, poses, pts, params);
+	}
+};
+
+double maxPoseDiff(const TFramePosesVec& a, const TFramePosesVec& b)
+{
+	double d = 0;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		const CPose3D delta = a[i] - b[i];
+		d = std::max(d, std::abs(delta.x()));
+		d = std::max(d, std::abs(delta.y()));
+		d = std::max(d, std::abs(delta.z()));
+		d = std::max(d, std::abs(delta.yaw()));
+		d = std::max(d, std::abs(delta.pitch()));
+		d = std::max(d, std::abs(delta.roll()));
+	}
+	return d;
+}
+}
+
+TEST(bundle_adj_full, ConvergesWithBothLinearSolvers)
+{
+	const TSyntheticBA ba;
+	ASSERT_GT(ba.obs.size(), 500u);
+
+	std::vector<std::array<double, 2>> residuals;
+	const double err_init = reprojectionResiduals(
+		ba.obs, ba.cam, ba.poses_noisy, ba.pts_noisy, residuals, false, false);
+
+	TFramePosesVec poses_chol, poses_pcg;
+	TLandmarkLocationsVec pts_chol, pts_pcg;
+	const double err_chol = ba.solve(0, 1, poses_chol, pts_chol);
+	const double err_pcg = ba.solve(1, 1, poses_pcg, pts_pcg);
+
+	// The noise of observations is 0.1px in each coordinate, so the RMS
+	// error at the optimum must be close to 0.1*sqrt(2):
+	const double max_rms_px = 0.2;
+	EXPECT_LT(std::sqrt(err_chol / ba.obs.size()), max_rms_px);
+	EXPECT_LT(std::sqrt(err_pcg / ba.obs.size()), max_rms_px);
+	EXPECT_LT(err_chol, 1e-2 * err_init);
+
+	// Both solvers reach the same solution:
+	EXPECT_NEAR(err_chol, err_pcg, 1e-3 * err_chol);
+	EXPECT_LT(maxPoseDiff(poses_chol, poses_pcg), 1e-3);
+	for (size_t i = 0; i < pts_chol.size(); i++)
+		EXPECT_LT(pts_chol[i].distanceTo(pts_pcg[i]), 1e-3);
+
+	// ...which is close to the ground truth:
+	EXPECT_LT(maxPoseDiff(poses_chol, ba.poses_real), 0.05);
+}
+
+TEST(bundle_adj_full, SameResultAnyNumberOfThreads)
+{
+	const TSyntheticBA ba;
+	for (int linear_solver = 0; linear_solver <= 1; linear_solver++)
+	{
+		TFramePosesVec poses1, poses4;
+		TLandmarkLocationsVec pts1, pts4;
+		const double err1 = ba.solve(linear_solver, 1, poses1, pts1);
+		const double err4 = ba.solve(linear_solver, 4, poses4, pts4);
+
+		EXPECT_EQ(err1, err4) << "linear_solver=" << linear_solver;
+		for (size_t i = 0; i < poses1.size(); i++)
+			EXPECT_TRUE(poses1[i] == poses4[i])
+				<< "linear_solver=" << linear_solver << " pose: " << i;
+		for (size_t i = 0; i < pts1.size(); i++)
+			EXPECT_TRUE(pts1[i] == pts4[i])
+				<< "linear_solver=" << linear_solver << " point: " << i;
+	}
+}
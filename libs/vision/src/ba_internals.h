@@ -14,6 +14,7 @@
 #include <mrpt/math/CArrayNumeric.h>
 #include <mrpt/poses/CPose3D.h>
 #include <mrpt/utils/aligned_containers.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
 #include <mrpt/vision/types.h>
 
 #include <array>
@@ -194,13 +195,15 @@ void pointJac(
 // For the case of *inverse* or *normal* frame poses being estimated.
 // Made inline so immediate values in "poses_are_inverses" are propragated by
 // the compiler
+// Observations are split among the threads of `pool`, if provided.
 template <bool POSES_ARE_INVERSE>
 void ba_compute_Jacobians(
 	const TFramePosesVec& frame_poses,
 	const TLandmarkLocationsVec& landmark_points,
 	const mrpt::utils::TCamera& camera_params,
 	mrpt::aligned_containers<JacData<6, 3, 2>>::vector_t& jac_data_vec,
-	const size_t num_fix_frames, const size_t num_fix_points)
+	const size_t num_fix_frames, const size_t num_fix_points,
+	mrpt::utils::CWorkerThreadsPool* pool = nullptr)
 {
 	MRPT_START
 
@@ -210,32 +213,38 @@ void ba_compute_Jacobians(
 
 	const size_t N = jac_data_vec.size();
 
-	for (size_t i = 0; i < N; i++)
-	{
-		JacData<6, 3, 2>& D = jac_data_vec[i];
-
-		const TCameraPoseID i_f = D.frame_id;
-		const TLandmarkID i_p = D.point_id;
-
-		ASSERTDEB_(i_f < frame_poses.size())
-		ASSERTDEB_(i_p < landmark_points.size())
-
-		if (i_f >= num_fix_frames)
+	const auto compute = [&](size_t first, size_t last, size_t) {
+		for (size_t i = first; i < last; i++)
 		{
-			frameJac<POSES_ARE_INVERSE>(
-				camera_params, frame_poses[i_f], landmark_points[i_p],
-				D.J_frame);
-			D.J_frame_valid = true;
+			JacData<6, 3, 2>& D = jac_data_vec[i];
+
+			const TCameraPoseID i_f = D.frame_id;
+			const TLandmarkID i_p = D.point_id;
+
+			ASSERTDEB_(i_f < frame_poses.size())
+			ASSERTDEB_(i_p < landmark_points.size())
+
+			if (i_f >= num_fix_frames)
+			{
+				frameJac<POSES_ARE_INVERSE>(
+					camera_params, frame_poses[i_f], landmark_points[i_p],
+					D.J_frame);
+				D.J_frame_valid = true;
+			}
+
+			if (i_p >= num_fix_points)
+			{
+				pointJac<POSES_ARE_INVERSE>(
+					camera_params, frame_poses[i_f], landmark_points[i_p],
+					D.J_point);
+				D.J_point_valid = true;
+			}
 		}
-
-		if (i_p >= num_fix_points)
-		{
-			pointJac<POSES_ARE_INVERSE>(
-				camera_params, frame_poses[i_f], landmark_points[i_p],
-				D.J_point);
-			D.J_point_valid = true;
-		}
-	}
+	};
+	if (pool)
+		pool->parallelChunks(N, compute);
+	else
+		compute(0, N, 0);
 	MRPT_END
 }
 
@@ -0,0 +1,803 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include "vision-precomp.h"  // Precompiled headers
+
+#include <mrpt/vision/tracking.h>
+#include <mrpt/utils/CWorkerThreadsPool.h>
+#include <mrpt/utils/CWorkerThreadsPoolHolder.h>
+
+// Universal include for all versions of OpenCV
+#include <mrpt/otherlibs/do_opencv_includes.h>
+
+#if MRPT_HAS_SSE2
+#include <mrpt/utils/SSE_types.h>
+#endif
+
+#include <cmath>
+#include <cstring>
+
+using namespace mrpt;
+using namespace mrpt::vision;
+using namespace mrpt::utils;
+using namespace std;
+
+namespace mrpt
+{
+namespace vision
+{
+namespace detail
+{
+/** Fixed-point bits of bilinear interpolation weights */
+const int LK_W_BITS = 14;
+/** Fractional bits of interpolated intensities */
+const int LK_I_BITS = 5;
+
+inline int lk_descale(int v, int n) { return (v + (1 << (n - 1))) >> n; }
+/** One pyramid level: a grayscale image and its Scharr gradients, surrounded
+ * by a border of replicated pixels so windows partly out of the image can
+ * still be interpolated. */
+struct TLKPyramidLevel
+{
+	int width = 0, height = 0, border = 0;
+	/** Row stride (in pixels) of both `img` and `grad` */
+	int stride = 0;
+	std::vector<uint8_t> img;
+	/** Interleaved (Ix,Iy) Scharr derivatives, i.e. 32 times the intensity
+	 * gradient */
+	std::vector<int16_t> grad;
+
+	const uint8_t* pixel(int x, int y) const
+	{
+		return &img[(y + border) * stride + x + border];
+	}
+	uint8_t* pixel(int x, int y)
+	{
+		return &img[(y + border) * stride + x + border];
+	}
+	const int16_t* gradient(int x, int y) const
+	{
+		return &grad[2 * ((y + border) * stride + x + border)];
+	}
+
+	void resize(int w, int h, int b)
+	{
+		width = w;
+		height = h;
+		border = b;
+		stride = (w + 2 * b + 15) & ~15;
+		img.resize(stride * (h + 2 * b));
+		grad.resize(2 * img.size());
+	}
+
+	/** Replicates the outermost image pixels into the border */
+	void fillBorder()
+	{
+		for (int y = 0; y < height; y++)
+		{
+			uint8_t* row = pixel(0, y);
+			std::memset(row - border, row[0], border);
+			std::memset(row + width, row[width - 1], border);
+		}
+		for (int i = 1; i <= border; i++)
+		{
+			std::memcpy(
+				pixel(-border, -i), pixel(-border, 0), width + 2 * border);
+			std::memcpy(
+				pixel(-border, height - 1 + i), pixel(-border, height - 1),
+				width + 2 * border);
+		}
+	}
+
+	/** Scharr gradients of all pixels, border included (zero in the
+	 * outermost ring) */
+	void computeGradients()
+	{
+		const int W = width + 2 * border, H = height + 2 * border;
+		std::fill(grad.begin(), grad.end(), 0);
+		for (int y = 1; y < H - 1; y++)
+		{
+			const uint8_t* r0 = &img[(y - 1) * stride];
+			const uint8_t* r1 = r0 + stride;
+			const uint8_t* r2 = r1 + stride;
+			int16_t* g = &grad[2 * y * stride];
+			int x = 1;
+#if MRPT_HAS_SSE2
+			const __m128i z = _mm_setzero_si128();
+			const __m128i k3 = _mm_set1_epi16(3), k10 = _mm_set1_epi16(10);
+			for (; x + 8 < W; x += 8)
+			{
+#define LK_LOAD8(p) \
+	_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), z)
+				const __m128i a00 = LK_LOAD8(r0 + x - 1);
+				const __m128i a01 = LK_LOAD8(r0 + x);
+				const __m128i a02 = LK_LOAD8(r0 + x + 1);
+				const __m128i a10 = LK_LOAD8(r1 + x - 1);
+				const __m128i a12 = LK_LOAD8(r1 + x + 1);
+				const __m128i a20 = LK_LOAD8(r2 + x - 1);
+				const __m128i a21 = LK_LOAD8(r2 + x);
+				const __m128i a22 = LK_LOAD8(r2 + x + 1);
+#undef LK_LOAD8
+				const __m128i ix = _mm_add_epi16(
+					_mm_mullo_epi16(
+						k3, _mm_add_epi16(
+								_mm_sub_epi16(a02, a00),
+								_mm_sub_epi16(a22, a20))),
+					_mm_mullo_epi16(k10, _mm_sub_epi16(a12, a10)));
+				const __m128i iy = _mm_add_epi16(
+					_mm_mullo_epi16(
+						k3, _mm_add_epi16(
+								_mm_sub_epi16(a20, a00),
+								_mm_sub_epi16(a22, a02))),
+					_mm_mullo_epi16(k10, _mm_sub_epi16(a21, a01)));
+				_mm_storeu_si128(
+					reinterpret_cast<__m128i*>(g + 2 * x),
+					_mm_unpacklo_epi16(ix, iy));
+				_mm_storeu_si128(
+					reinterpret_cast<__m128i*>(g + 2 * x + 8),
+					_mm_unpackhi_epi16(ix, iy));
+			}
+#endif
+			for (; x < W - 1; x++)
+			{
+				g[2 * x] = 3 * (r0[x + 1] - r0[x - 1] + r2[x + 1] - r2[x - 1]) +
+						   10 * (r1[x + 1] - r1[x - 1]);
+				g[2 * x + 1] =
+					3 * (r2[x - 1] - r0[x - 1] + r2[x + 1] - r0[x + 1]) +
+					10 * (r2[x] - r0[x]);
+			}
+		}
+	}
+
+	/** Builds this level as the 2x2 mean of `src` */
+	void halfSmoothFrom(const TLKPyramidLevel& src)
+	{
+		resize(src.width / 2, src.height / 2, src.border);
+		for (int y = 0; y < height; y++)
+		{
+			const uint8_t* s0 = src.pixel(0, 2 * y);
+			const uint8_t* s1 = src.pixel(0, 2 * y + 1);
+			uint8_t* d = pixel(0, y);
+			int x = 0;
+#if MRPT_HAS_SSE2
+			const __m128i mask = _mm_set1_epi16(0x00FF);
+			const __m128i two = _mm_set1_epi16(2);
+			for (; x + 8 <= width; x += 8)
+			{
+				const __m128i a = _mm_loadu_si128(
+					reinterpret_cast<const __m128i*>(s0 + 2 * x));
+				const __m128i b = _mm_loadu_si128(
+					reinterpret_cast<const __m128i*>(s1 + 2 * x));
+				// Sum of even and odd pixels of both rows:
+				__m128i sum = _mm_add_epi16(
+					_mm_add_epi16(
+						_mm_and_si128(a, mask), _mm_srli_epi16(a, 8)),
+					_mm_add_epi16(
+						_mm_and_si128(b, mask), _mm_srli_epi16(b, 8)));
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+				_mm_storel_epi64(
+					reinterpret_cast<__m128i*>(d + x),
+					_mm_packus_epi16(sum, sum));
+			}
+#endif
+			for (; x < width; x++)
+				d[x] = (s0[2 * x] + s0[2 * x + 1] + s1[2 * x] + s1[2 * x + 1] +
+						2) >>
+					   2;
+		}
+	}
+};
+
+/** A pyramid of images for LK tracking, level 0 being the original one */
+struct TLKPyramid
+{
+	std::vector<TLKPyramidLevel> levels;
+
+	void build(
+		const uint8_t* data, int w, int h, size_t rowStride, size_t nLevels,
+		int border)
+	{
+		levels.resize(nLevels);
+		TLKPyramidLevel& l0 = levels[0];
+		l0.resize(w, h, border);
+		for (int y = 0; y < h; y++)
+			std::memcpy(l0.pixel(0, y), data + y * rowStride, w);
+		for (size_t l = 0; l < nLevels; l++)
+		{
+			if (l > 0) levels[l].halfSmoothFrom(levels[l - 1]);
+			levels[l].fillBorder();
+			levels[l].computeGradients();
+		}
+	}
+
+	/** Whether this pyramid was built with these parameters from an image
+	 * with the same contents */
+	bool isBuiltFrom(
+		const uint8_t* data, int w, int h, size_t rowStride, size_t nLevels,
+		int border) const
+	{
+		if (levels.size() != nLevels || levels[0].width != w ||
+			levels[0].height != h || levels[0].border != border)
+			return false;
+		for (int y = 0; y < h; y++)
+			if (std::memcmp(levels[0].pixel(0, y), data + y * rowStride, w))
+				return false;
+		return true;
+	}
+};
+
+struct TLKParams
+{
+	int win_w, win_h;
+	/** win_w rounded up to a multiple of 8 */
+	int win_wpad;
+	int max_iters;
+	float epsilon, min_eigenvalue;
+};
+
+/** Patch buffers of one thread */
+struct TLKWorkspace
+{
+	std::vector<int16_t> I, Ix, Iy;
+};
+
+/** Bilinear weights for the window with top-left corner at (x,y) */
+struct TLKWeights
+{
+	int x0, y0;
+	int w00, w01, w10, w11;
+
+	TLKWeights(float x, float y)
+	{
+		x0 = static_cast<int>(std::floor(x));
+		y0 = static_cast<int>(std::floor(y));
+		const float a = x - x0, b = y - y0;
+		const float S = float(1 << LK_W_BITS);
+		w00 = static_cast<int>((1.f - a) * (1.f - b) * S + 0.5f);
+		w01 = static_cast<int>(a * (1.f - b) * S + 0.5f);
+		w10 = static_cast<int>((1.f - a) * b * S + 0.5f);
+		w11 = (1 << LK_W_BITS) - w00 - w01 - w10;
+	}
+
+	bool isInside(const TLKPyramidLevel& lev, const TLKParams& p) const
+	{
+		return x0 >= -lev.border && y0 >= -lev.border &&
+			   x0 + p.win_wpad < lev.width + lev.border &&
+			   y0 + p.win_h < lev.height + lev.border;
+	}
+
+	int interp(const uint8_t* r0, const uint8_t* r1, int x) const
+	{
+		return lk_descale(
+			r0[x] * w00 + r0[x + 1] * w01 + r1[x] * w10 + r1[x + 1] * w11,
+			LK_W_BITS - LK_I_BITS);
+	}
+
+#if MRPT_HAS_SSE2
+	/** Pairs (w00,w01) and (w10,w11), for _mm_madd_epi16() */
+	__m128i sse_w0() const { return _mm_set1_epi32((w01 << 16) | w00); }
+	__m128i sse_w1() const { return _mm_set1_epi32((w11 << 16) | w10); }
+#endif
+};
+
+#if MRPT_HAS_SSE2
+/** Interpolates 8 consecutive pixels, as TLKWeights::interp() */
+inline __m128i lkInterp8(
+	const uint8_t* r0, const uint8_t* r1, const __m128i w0, const __m128i w1)
+{
+	const __m128i z = _mm_setzero_si128();
+#define LK_LOAD8(p) \
+	_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), z)
+	const __m128i j00 = LK_LOAD8(r0), j01 = LK_LOAD8(r0 + 1);
+	const __m128i j10 = LK_LOAD8(r1), j11 = LK_LOAD8(r1 + 1);
+#undef LK_LOAD8
+	const __m128i delta = _mm_set1_epi32(1 << (LK_W_BITS - LK_I_BITS - 1));
+	__m128i t0 = _mm_add_epi32(
+		_mm_madd_epi16(_mm_unpacklo_epi16(j00, j01), w0),
+		_mm_madd_epi16(_mm_unpacklo_epi16(j10, j11), w1));
+	__m128i t1 = _mm_add_epi32(
+		_mm_madd_epi16(_mm_unpackhi_epi16(j00, j01), w0),
+		_mm_madd_epi16(_mm_unpackhi_epi16(j10, j11), w1));
+	t0 = _mm_srai_epi32(_mm_add_epi32(t0, delta), LK_W_BITS - LK_I_BITS);
+	t1 = _mm_srai_epi32(_mm_add_epi32(t1, delta), LK_W_BITS - LK_I_BITS);
+	return _mm_packs_epi32(t0, t1);
+}
+
+/** Interpolates the interleaved gradients (Ix,Iy) of 2 consecutive pixels
+ * (the first or last two of the 4 pixels starting at g0, according to `hi`),
+ * returned as 32bit integers in the same order */
+inline __m128i lkInterpGrad2(
+	const int16_t* g0, const int16_t* g1, const __m128i w0, const __m128i w1,
+	const bool hi)
+{
+	const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g0));
+	const __m128i a1 =
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(g0 + 2));
+	const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g1));
+	const __m128i b1 =
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(g1 + 2));
+	const __m128i t = _mm_add_epi32(
+		_mm_madd_epi16(
+			hi ? _mm_unpackhi_epi16(a0, a1) : _mm_unpacklo_epi16(a0, a1), w0),
+		_mm_madd_epi16(
+			hi ? _mm_unpackhi_epi16(b0, b1) : _mm_unpacklo_epi16(b0, b1), w1));
+	return _mm_srai_epi32(
+		_mm_add_epi32(t, _mm_set1_epi32(1 << (LK_W_BITS - 1))), LK_W_BITS);
+}
+
+inline float lkHorizontalSum(const __m128 v)
+{
+	float s[4];
+	_mm_storeu_ps(s, v);
+	return (s[0] + s[2]) + (s[1] + s[3]);
+}
+#endif
+
+/** Interpolates the template window of I given by `w` into the workspace,
+ * and returns its gradient matrix [A11 A12; A12 A22]. */
+void lkTemplate(
+	const TLKPyramidLevel& I, const TLKWeights& w, const TLKParams& p,
+	TLKWorkspace& ws, float& A11, float& A12, float& A22)
+{
+	const size_t nPix = p.win_wpad * p.win_h;
+#if MRPT_HAS_SSE2
+	ws.I.resize(nPix);
+	ws.Ix.resize(nPix);
+	ws.Iy.resize(nPix);
+	const __m128i w0 = w.sse_w0(), w1 = w.sse_w1();
+	const __m128i lanes = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+	__m128 q11 = _mm_setzero_ps(), q12 = _mm_setzero_ps(),
+		   q22 = _mm_setzero_ps();
+	for (int r = 0; r < p.win_h; r++)
+	{
+		const uint8_t* s0 = I.pixel(w.x0, w.y0 + r);
+		const uint8_t* s1 = s0 + I.stride;
+		const int16_t* g0 = I.gradient(w.x0, w.y0 + r);
+		const int16_t* g1 = g0 + 2 * I.stride;
+		int16_t* Iw = &ws.I[r * p.win_wpad];
+		int16_t* Ixw = &ws.Ix[r * p.win_wpad];
+		int16_t* Iyw = &ws.Iy[r * p.win_wpad];
+		for (int x = 0; x < p.win_wpad; x += 8)
+		{
+			// Zero out pixels beyond the window width:
+			const __m128i mask =
+				_mm_cmplt_epi16(lanes, _mm_set1_epi16(p.win_w - x));
+			_mm_storeu_si128(
+				reinterpret_cast<__m128i*>(Iw + x),
+				_mm_and_si128(mask, lkInterp8(s0 + x, s1 + x, w0, w1)));
+
+			// (Ix,Iy) of pixels 0-3 and 4-7, as (Ix0 Ix1 Iy0 Iy1 | ...):
+			const int sh = _MM_SHUFFLE(3, 1, 2, 0);
+			const __m128i lo0 = _mm_shuffle_epi32(
+				lkInterpGrad2(g0 + 2 * x, g1 + 2 * x, w0, w1, false), sh);
+			const __m128i lo1 = _mm_shuffle_epi32(
+				lkInterpGrad2(g0 + 2 * x, g1 + 2 * x, w0, w1, true), sh);
+			const __m128i hi0 = _mm_shuffle_epi32(
+				lkInterpGrad2(g0 + 2 * x + 8, g1 + 2 * x + 8, w0, w1, false),
+				sh);
+			const __m128i hi1 = _mm_shuffle_epi32(
+				lkInterpGrad2(g0 + 2 * x + 8, g1 + 2 * x + 8, w0, w1, true),
+				sh);
+			const __m128i ix = _mm_and_si128(
+				mask, _mm_packs_epi32(
+						  _mm_unpacklo_epi64(lo0, lo1),
+						  _mm_unpacklo_epi64(hi0, hi1)));
+			const __m128i iy = _mm_and_si128(
+				mask, _mm_packs_epi32(
+						  _mm_unpackhi_epi64(lo0, lo1),
+						  _mm_unpackhi_epi64(hi0, hi1)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Ixw + x), ix);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Iyw + x), iy);
+
+			q11 = _mm_add_ps(q11, _mm_cvtepi32_ps(_mm_madd_epi16(ix, ix)));
+			q12 = _mm_add_ps(q12, _mm_cvtepi32_ps(_mm_madd_epi16(ix, iy)));
+			q22 = _mm_add_ps(q22, _mm_cvtepi32_ps(_mm_madd_epi16(iy, iy)));
+		}
+	}
+	A11 = lkHorizontalSum(q11);
+	A12 = lkHorizontalSum(q12);
+	A22 = lkHorizontalSum(q22);
+#else
+	ws.I.assign(nPix, 0);
+	ws.Ix.assign(nPix, 0);
+	ws.Iy.assign(nPix, 0);
+	A11 = A12 = A22 = 0;
+	for (int r = 0; r < p.win_h; r++)
+	{
+		const uint8_t* s0 = I.pixel(w.x0, w.y0 + r);
+		const uint8_t* s1 = s0 + I.stride;
+		const int16_t* g0 = I.gradient(w.x0, w.y0 + r);
+		const int16_t* g1 = g0 + 2 * I.stride;
+		int16_t* Iw = &ws.I[r * p.win_wpad];
+		int16_t* Ixw = &ws.Ix[r * p.win_wpad];
+		int16_t* Iyw = &ws.Iy[r * p.win_wpad];
+		for (int x = 0; x < p.win_w; x++)
+		{
+			Iw[x] = static_cast<int16_t>(w.interp(s0, s1, x));
+			const int ix = lk_descale(
+				g0[2 * x] * w.w00 + g0[2 * x + 2] * w.w01 +
+					g1[2 * x] * w.w10 + g1[2 * x + 2] * w.w11,
+				LK_W_BITS);
+			const int iy = lk_descale(
+				g0[2 * x + 1] * w.w00 + g0[2 * x + 3] * w.w01 +
+					g1[2 * x + 1] * w.w10 + g1[2 * x + 3] * w.w11,
+				LK_W_BITS);
+			Ixw[x] = static_cast<int16_t>(ix);
+			Iyw[x] = static_cast<int16_t>(iy);
+			A11 += float(ix * ix);
+			A12 += float(ix * iy);
+			A22 += float(iy * iy);
+		}
+	}
+#endif
+}
+
+/** Returns the LK mismatch vector (sum of intensity differences times the
+ * template gradient) for the window of J given by `w` */
+void lkMismatch(
+	const TLKPyramidLevel& J, const TLKWeights& w, const TLKParams& p,
+	const TLKWorkspace& ws, float& b1, float& b2)
+{
+#if MRPT_HAS_SSE2
+	const __m128i w0 = w.sse_w0(), w1 = w.sse_w1();
+	__m128 qb1 = _mm_setzero_ps(), qb2 = _mm_setzero_ps();
+	for (int r = 0; r < p.win_h; r++)
+	{
+		const uint8_t* J0 = J.pixel(w.x0, w.y0 + r);
+		const uint8_t* J1 = J0 + J.stride;
+		const int16_t* I = &ws.I[r * p.win_wpad];
+		const int16_t* Ix = &ws.Ix[r * p.win_wpad];
+		const int16_t* Iy = &ws.Iy[r * p.win_wpad];
+		for (int x = 0; x < p.win_wpad; x += 8)
+		{
+			// Pixels beyond the window width have null gradients:
+			const __m128i diff = _mm_sub_epi16(
+				lkInterp8(J0 + x, J1 + x, w0, w1),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(I + x)));
+			const __m128i ix =
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(Ix + x));
+			const __m128i iy =
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(Iy + x));
+			qb1 = _mm_add_ps(qb1, _mm_cvtepi32_ps(_mm_madd_epi16(diff, ix)));
+			qb2 = _mm_add_ps(qb2, _mm_cvtepi32_ps(_mm_madd_epi16(diff, iy)));
+		}
+	}
+	b1 = lkHorizontalSum(qb1);
+	b2 = lkHorizontalSum(qb2);
+#else
+	b1 = b2 = 0;
+	for (int r = 0; r < p.win_h; r++)
+	{
+		const uint8_t* J0 = J.pixel(w.x0, w.y0 + r);
+		const uint8_t* J1 = J0 + J.stride;
+		const int16_t* I = &ws.I[r * p.win_wpad];
+		const int16_t* Ix = &ws.Ix[r * p.win_wpad];
+		const int16_t* Iy = &ws.Iy[r * p.win_wpad];
+		for (int x = 0; x < p.win_w; x++)
+		{
+			const int diff = w.interp(J0, J1, x) - I[x];
+			b1 += float(diff * Ix[x]);
+			b2 += float(diff * Iy[x]);
+		}
+	}
+#endif
+}
+
+/** Sum of absolute differences between the template and the window of J
+ * given by `w`, with LK_I_BITS fractional bits */
+int lkResidual(
+	const TLKPyramidLevel& J, const TLKWeights& w, const TLKParams& p,
+	const TLKWorkspace& ws)
+{
+#if MRPT_HAS_SSE2
+	const __m128i w0 = w.sse_w0(), w1 = w.sse_w1();
+	const __m128i lanes = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m128i ones = _mm_set1_epi16(1);
+	__m128i sum = _mm_setzero_si128();
+	for (int r = 0; r < p.win_h; r++)
+	{
+		const uint8_t* J0 = J.pixel(w.x0, w.y0 + r);
+		const uint8_t* J1 = J0 + J.stride;
+		const int16_t* I = &ws.I[r * p.win_wpad];
+		for (int x = 0; x < p.win_wpad; x += 8)
+		{
+			const __m128i diff = _mm_sub_epi16(
+				lkInterp8(J0 + x, J1 + x, w0, w1),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(I + x)));
+			const __m128i absdiff = _mm_and_si128(
+				_mm_cmplt_epi16(lanes, _mm_set1_epi16(p.win_w - x)),
+				_mm_max_epi16(diff, _mm_sub_epi16(_mm_setzero_si128(), diff)));
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(absdiff, ones));
+		}
+	}
+	int s[4];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(s), sum);
+	return s[0] + s[1] + s[2] + s[3];
+#else
+	int sum = 0;
+	for (int r = 0; r < p.win_h; r++)
+	{
+		const uint8_t* J0 = J.pixel(w.x0, w.y0 + r);
+		const uint8_t* J1 = J0 + J.stride;
+		const int16_t* I = &ws.I[r * p.win_wpad];
+		for (int x = 0; x < p.win_w; x++)
+			sum += std::abs(w.interp(J0, J1, x) - I[x]);
+	}
+	return sum;
+#endif
+}
+
+/** Tracks one point from the pyramid I to J, given in level-0 pixel
+ * coordinates. On success, returns status_TRACKED and the new position and
+ * the mean absolute difference of intensities between both windows. */
+TFeatureTrackStatus lkTrackPoint(
+	const TLKPyramid& I, const TLKPyramid& J, const TLKParams& p,
+	TLKWorkspace& ws, const float px, const float py, float& nx, float& ny,
+	float& err)
+{
+	const float hw_x = (p.win_w - 1) * 0.5f, hw_y = (p.win_h - 1) * 0.5f;
+	const int nLevels = static_cast<int>(I.levels.size());
+	const float top_scale = 1.0f / (1 << (nLevels - 1));
+	// Window center in J, in the coordinates of the current level:
+	float cx = px * top_scale, cy = py * top_scale;
+
+	for (int L = nLevels - 1; L >= 0; L--)
+	{
+		const TLKPyramidLevel& IL = I.levels[L];
+		const TLKPyramidLevel& JL = J.levels[L];
+		const float scale = 1.0f / (1 << L);
+
+		// Template window and its gradient matrix:
+		const TLKWeights wi(px * scale - hw_x, py * scale - hw_y);
+		if (!wi.isInside(IL, p))
+		{
+			if (L == 0) return status_OOB;
+			cx *= 2;
+			cy *= 2;
+			continue;
+		}
+		float A11, A12, A22;
+		lkTemplate(IL, wi, p, ws, A11, A12, A22);
+
+		// Derivatives and intensities are both scaled by 32:
+		const float area_scale = 1.0f / (1024.0f * p.win_w * p.win_h);
+		const float minEig =
+			(A22 + A11 -
+			 std::sqrt((A11 - A22) * (A11 - A22) + 4.f * A12 * A12)) *
+			0.5f * area_scale;
+		const float D = A11 * A22 - A12 * A12;
+		if (minEig < p.min_eigenvalue || D <= 0) return status_LOST;
+		const float invD = 1.0f / D;
+
+		// Gauss-Newton iterations:
+		float x = cx - hw_x, y = cy - hw_y;
+		float prev_dx = 0, prev_dy = 0;
+		for (int it = 0; it < p.max_iters; it++)
+		{
+			const TLKWeights wj(x, y);
+			if (!wj.isInside(JL, p)) break;
+			float b1, b2;
+			lkMismatch(JL, wj, p, ws, b1, b2);
+			const float dx = (A12 * b2 - A22 * b1) * invD;
+			const float dy = (A12 * b1 - A11 * b2) * invD;
+			x += dx;
+			y += dy;
+			if (dx * dx + dy * dy <= p.epsilon * p.epsilon) break;
+			if (it > 0 && std::abs(dx + prev_dx) < 0.01f &&
+				std::abs(dy + prev_dy) < 0.01f)
+			{
+				// Oscillating around the solution:
+				x -= dx * 0.5f;
+				y -= dy * 0.5f;
+				break;
+			}
+			prev_dx = dx;
+			prev_dy = dy;
+		}
+		cx = x + hw_x;
+		cy = y + hw_y;
+		if (L > 0)
+		{
+			cx *= 2;
+			cy *= 2;
+		}
+	}
+
+	// Final residual:
+	const TLKPyramidLevel& J0 = J.levels[0];
+	const TLKWeights wj(cx - hw_x, cy - hw_y);
+	if (!wj.isInside(J0, p)) return status_OOB;
+	nx = cx;
+	ny = cy;
+	err = lkResidual(J0, wj, p, ws) /
+		  float((1 << LK_I_BITS) * p.win_w * p.win_h);
+	return status_TRACKED;
+}
+}  // namespace detail
+}  // namespace vision
+}  // namespace mrpt
+
+struct CFeatureTracker_PyrLK::TImpl
+{
+	/** The pyramids of the old and new images. After each call, `prev` holds
+	 * that of the new image, to be reused in the next call. */
+	detail::TLKPyramid prev, cur;
+	mrpt::utils::CWorkerThreadsPoolHolder pool;
+};
+
+CFeatureTracker_PyrLK::CFeatureTracker_PyrLK()
+	: m_impl(new TImpl), m_reused_pyramids(0)
+{
+}
+CFeatureTracker_PyrLK::CFeatureTracker_PyrLK(
+	mrpt::utils::TParametersDouble extraParams)
+	: CGenericFeatureTracker(extraParams),
+	  m_impl(new TImpl),
+	  m_reused_pyramids(0)
+{
+}
+CFeatureTracker_PyrLK::~CFeatureTracker_PyrLK() {}
+template <typename FEATLIST>
+void CFeatureTracker_PyrLK::trackFeatures_impl_templ(
+	const CImage& old_img, const CImage& new_img, FEATLIST& featureList)
+{
+	MRPT_START
+
+#if MRPT_HAS_OPENCV
+	detail::TLKParams p;
+	p.win_w = extra_params.getWithDefaultVal("window_width", 15);
+	p.win_h = extra_params.getWithDefaultVal("window_height", 15);
+	p.win_wpad = (p.win_w + 7) & ~7;
+	p.max_iters = extra_params.getWithDefaultVal("LK_max_iters", 10);
+	p.epsilon = extra_params.getWithDefaultVal("LK_epsilon", 0.01);
+	p.min_eigenvalue = extra_params.getWithDefaultVal("LK_min_eigenvalue", 0.1);
+	const int LK_levels = extra_params.getWithDefaultVal("LK_levels", 3);
+	const float LK_max_tracking_error =
+		extra_params.getWithDefaultVal("LK_max_tracking_error", 150.0f);
+	const unsigned int num_threads =
+		extra_params.getWithDefaultVal("num_threads", 1);
+	ASSERT_(p.win_w > 1 && p.win_h > 1 && LK_levels >= 0);
+
+	// Both images must be of the same size
+	ASSERT_(
+		old_img.getWidth() == new_img.getWidth() &&
+		old_img.getHeight() == new_img.getHeight());
+
+	const int img_width = old_img.getWidth();
+	const int img_height = old_img.getHeight();
+	const size_t nFeatures = featureList.size();
+	if (!nFeatures) return;
+
+	// Grayscale images
+	const CImage prev_gray(old_img, FAST_REF_OR_CONVERT_TO_GRAY);
+	const CImage cur_gray(new_img, FAST_REF_OR_CONVERT_TO_GRAY);
+	const IplImage* prev_ipl = prev_gray.getAs<IplImage>();
+	const IplImage* cur_ipl = cur_gray.getAs<IplImage>();
+	const uint8_t* prev_data =
+		reinterpret_cast<const uint8_t*>(prev_ipl->imageData);
+	const uint8_t* cur_data =
+		reinterpret_cast<const uint8_t*>(cur_ipl->imageData);
+
+	// No level smaller than the window:
+	size_t nLevels = LK_levels + 1;
+	while (nLevels > 1 && ((img_width >> (nLevels - 1)) < p.win_w ||
+						   (img_height >> (nLevels - 1)) < p.win_h))
+		nLevels--;
+	const int border = std::max(p.win_wpad, p.win_h) + 1;
+
+	CWorkerThreadsPool* pool = m_impl->pool.get(num_threads);
+
+	// Pyramids:
+	m_timlog.enter("[CFeatureTracker_PyrLK] build pyramids");
+	if (m_impl->prev.isBuiltFrom(
+			prev_data, img_width, img_height, prev_ipl->widthStep, nLevels,
+			border))
+	{
+		m_reused_pyramids++;
+		m_impl->cur.build(
+			cur_data, img_width, img_height, cur_ipl->widthStep, nLevels,
+			border);
+	}
+	else if (pool)
+	{
+		auto fut = pool->enqueue([&]() {
+			m_impl->prev.build(
+				prev_data, img_width, img_height, prev_ipl->widthStep, nLevels,
+				border);
+		});
+		m_impl->cur.build(
+			cur_data, img_width, img_height, cur_ipl->widthStep, nLevels,
+			border);
+		fut.get();
+	}
+	else
+	{
+		m_impl->prev.build(
+			prev_data, img_width, img_height, prev_ipl->widthStep, nLevels,
+			border);
+		m_impl->cur.build(
+			cur_data, img_width, img_height, cur_ipl->widthStep, nLevels,
+			border);
+	}
+	m_timlog.leave("[CFeatureTracker_PyrLK] build pyramids");
+
+	// Track:
+	m_timlog.enter("[CFeatureTracker_PyrLK] track");
+	std::vector<float> new_x(nFeatures), new_y(nFeatures), errs(nFeatures);
+	std::vector<TFeatureTrackStatus> status(nFeatures);
+	auto track_chunk = [&](size_t first, size_t last, size_t) {
+		detail::TLKWorkspace ws;
+		for (size_t i = first; i < last; i++)
+			status[i] = detail::lkTrackPoint(
+				m_impl->prev, m_impl->cur, p, ws, featureList.getFeatureX(i),
+				featureList.getFeatureY(i), new_x[i], new_y[i], errs[i]);
+	};
+	if (pool)
+		pool->parallelChunks(nFeatures, track_chunk);
+	else
+		track_chunk(0, nFeatures, 0);
+	m_timlog.leave("[CFeatureTracker_PyrLK] track");
+
+	for (size_t i = 0; i < nFeatures; ++i)
+	{
+		if (status[i] == status_TRACKED && errs[i] > LK_max_tracking_error)
+			status[i] = status_LOST;
+		if (status[i] == status_TRACKED &&
+			!(new_x[i] > 0 && new_y[i] > 0 && new_x[i] < img_width &&
+			  new_y[i] < img_height))
+			status[i] = status_OOB;
+
+		if (status[i] == status_TRACKED)
+		{
+			featureList.setFeatureXf(i, new_x[i]);
+			featureList.setFeatureYf(i, new_y[i]);
+		}
+		else
+		{
+			featureList.setFeatureX(i, -1);
+			featureList.setFeatureY(i, -1);
+		}
+		featureList.setTrackStatus(i, status[i]);
+	}
+
+	// The pyramid of new_img may be reused in the next call:
+	std::swap(m_impl->prev, m_impl->cur);
+
+	// In case it needs to rebuild a kd-tree or whatever
+	featureList.mark_as_outdated();
+#else
+	MRPT_UNUSED_PARAM(old_img);
+	MRPT_UNUSED_PARAM(new_img);
+	MRPT_UNUSED_PARAM(featureList);
+	THROW_EXCEPTION("The MRPT has been compiled with MRPT_HAS_OPENCV=0 !");
+#endif
+
+	MRPT_END
+}
+
+void CFeatureTracker_PyrLK::trackFeatures_impl(
+	const CImage& old_img, const CImage& new_img, CFeatureList& featureList)
+{
+	trackFeatures_impl_templ<CFeatureList>(old_img, new_img, featureList);
+}
+
+void CFeatureTracker_PyrLK::trackFeatures_impl(
+	const CImage& old_img, const CImage& new_img,
+	TSimpleFeatureList& featureList)
+{
+	trackFeatures_impl_templ<TSimpleFeatureList>(old_img, new_img, featureList);
+}
+
+void CFeatureTracker_PyrLK::trackFeatures_impl(
+	const CImage& old_img, const CImage& new_img,
+	TSimpleFeaturefList& featureList)
+{
+	trackFeatures_impl_templ<TSimpleFeaturefList>(
+		old_img, new_img, featureList);
+}
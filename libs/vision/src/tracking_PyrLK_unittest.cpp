@@ -0,0 +1,116 @@
+/* +------------------------------------------------------------------------+
+   |                     Mobile Robot Programming Toolkit (MRPT)            |
+   |                          http://www.mrpt.org/                          |
+   |                                                                        |
+   | Copyright (c) 2005-2017, Individual contributors, see AUTHORS file     |
+   | See: http://www.mrpt.org/Authors - All rights reserved.                |
+   | Released under BSD License. See details in http://www.mrpt.org/License |
+   +------------------------------------------------------------------------+ */
+
+#include <mrpt/vision/tracking.h>
+#include <mrpt/utils/CImage.h>
+#include <gtest/gtest.h>
+#include <cmath>
+
+using namespace mrpt::vision;
+using namespace mrpt::utils;
+using namespace std;
+
+#if MRPT_HAS_OPENCV
+
+namespace
+{
+const int W = 320, H = 240;
+
+// A smooth, textured intensity pattern:
+double pattern(double x, double y)
+{
+	return 128 + 50 * std::sin(0.21 * x) * std::cos(0.17 * y) +
+		   40 * std::sin(0.07 * x + 0.11 * y + 1.0) +
+		   25 * std::cos(0.31 * y - 0.05 * x);
+}
+
+// The pattern shifted by (dx,dy) pixels: img(x,y) = pattern(x-dx,y-dy)
+void makeImage(CImage& img, double dx, double dy)
+{
+	img.resize(W, H, CH_GRAY, true);
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++)
+			*img(x, y) = static_cast<unsigned char>(
+				std::round(pattern(x - dx, y - dy)));
+}
+
+// A grid of features, far enough from the image borders:
+void makeFeatures(TSimpleFeaturefList& feats)
+{
+	feats.clear();
+	TFeatureID id = 0;
+	for (int y = 30; y < H - 30; y += 20)
+		for (int x = 30; x < W - 30; x += 20)
+		{
+			TSimpleFeaturef f(float(x), float(y));
+			f.ID = id++;
+			f.track_status = status_IDLE;
+			f.response = 0;
+			f.octave = 0;
+			f.user_flags = 0;
+			feats.push_back(f);
+		}
+}
+
+void trackShift(
+	double dx, double dy, unsigned int num_threads, TSimpleFeaturefList& feats)
+{
+	CImage img1, img2;
+	makeImage(img1, 0, 0);
+	makeImage(img2, dx, dy);
+	makeFeatures(feats);
+
+	CFeatureTracker_PyrLK tracker;
+	tracker.extra_params["num_threads"] = num_threads;
+	tracker.trackFeatures(img1, img2, feats);
+}
+}
+
+TEST(CFeatureTracker_PyrLK, SubPixelShift)
+{
+	const double shifts[][2] = {
+		{0.0, 0.0}, {0.35, -0.6}, {2.25, 1.7}, {-4.8, 3.15}};
+	for (const auto& s : shifts)
+	{
+		TSimpleFeaturefList ref, feats;
+		makeFeatures(ref);
+		trackShift(s[0], s[1], 1, feats);
+		ASSERT_EQ(feats.size(), ref.size());
+		for (size_t i = 0; i < feats.size(); i++)
+		{
+			EXPECT_EQ(feats[i].track_status, status_TRACKED)
+				<< "feature: " << i;
+			EXPECT_NEAR(feats[i].pt.x, ref[i].pt.x + s[0], 0.1)
+				<< "feature: " << i << " shift: " << s[0] << "," << s[1];
+			EXPECT_NEAR(feats[i].pt.y, ref[i].pt.y + s[1], 0.1)
+				<< "feature: " << i << " shift: " << s[0] << "," << s[1];
+		}
+	}
+}
+
+TEST(CFeatureTracker_PyrLK, SameResultAnyNumberOfThreads)
+{
+	TSimpleFeaturefList ref;
+	trackShift(1.65, -2.4, 1, ref);
+
+	for (unsigned int nThreads : {2u, 4u, 7u})
+	{
+		TSimpleFeaturefList feats;
+		trackShift(1.65, -2.4, nThreads, feats);
+		ASSERT_EQ(feats.size(), ref.size());
+		for (size_t i = 0; i < feats.size(); i++)
+		{
+			EXPECT_EQ(feats[i].track_status, ref[i].track_status);
+			EXPECT_EQ(feats[i].pt.x, ref[i].pt.x) << "nThreads=" << nThreads;
+			EXPECT_EQ(feats[i].pt.y, ref[i].pt.y) << "nThreads=" << nThreads;
+		}
+	}
+}
+
+#endif
@@ -13,6 +13,7 @@
 #include <mrpt/vision/pinhole.h>
 #include <mrpt/vision/CFeatureExtraction.h>
 #include <mrpt/vision/CFeature.h>
+#include <mrpt/vision/CDescriptorMatrix.h>
 
 #include <mrpt/poses/CPoint3D.h>
 #include <mrpt/maps/CLandmarksMap.h>
@@ -451,6 +452,96 @@ void vision::normalizeImage(const CImage& image, CImage& nimage)
 	nimage.setFromMatrix(nim);
 }  // end normalizeImage
 
+// For each feature in list1, the two nearest ones in list2 (and vice versa,
+// if best21 is not null) by their descriptors, only among the pairs allowed
+// by the epipolar and x-coordinate restrictions in `options`. Distances are
+// normalized as in CFeature::descriptor*DistanceTo().
+static void matchFeaturesBestTwoByDescriptor(
+	const CFeatureList& list1, const CFeatureList& list2,
+	const TMatchingOptions& options, const TStereoSystemParams& params,
+	std::vector<TDescriptorBestMatches>& best12,
+	std::vector<TDescriptorBestMatches>* best21)
+{
+	TDescriptorType desc;
+	switch (options.matching_method)
+	{
+		case TMatchingOptions::mmDescriptorSIFT:
+			desc = descSIFT;
+			break;
+		case TMatchingOptions::mmDescriptorSURF:
+			desc = descSURF;
+			break;
+		default:
+			desc = descORB;
+			break;
+	}
+
+	CDescriptorMatrix m1, m2;
+	m1.fromFeatureList(list1, desc);
+	m2.fromFeatureList(list2, desc);
+	ASSERT_EQUAL_(m1.length(), m2.length());
+
+	// Epipolar lines Ax + By + C = 0 of the features in list1:
+	std::vector<TLine2D> epiLines;
+	if (options.useEpipolarRestriction && !options.parallelOpticalAxis)
+	{
+		ASSERT_(options.hasFundamentalMatrix);
+		epiLines.resize(list1.size());
+		for (size_t i = 0; i < list1.size(); i++)
+		{
+			CMatrixDouble31 l, p;
+			p(0, 0) = list1[i]->x;
+			p(1, 0) = list1[i]->y;
+			p(2, 0) = 1;
+			l = params.F * p;
+			for (int k = 0; k < 3; k++) epiLines[i].coefs[k] = l(k, 0);
+		}
+	}
+	const auto allowed = [&](size_t i1, size_t i2) {
+		const CFeature &f1 = *list1[i1], &f2 = *list2[i2];
+		if (options.useEpipolarRestriction)
+		{
+			const double d = options.parallelOpticalAxis
+								 ? f1.y - f2.y
+								 : epiLines[i1].distance(TPoint2D(f2.x, f2.y));
+			if (!(fabs(d) < options.epipolar_TH)) return false;
+		}
+		if (options.useXRestriction && !((f1.x - f2.x) > 0)) return false;
+		return true;
+	};
+	const bool use_filter =
+		options.useEpipolarRestriction || options.useXRestriction;
+
+	CWorkerThreadsPool* p = options.getThreadPool();
+
+	find_best_two_descriptor_matches(
+		m1, m2, best12, p,
+		use_filter ? descriptor_pair_filter_t(allowed)
+				   : descriptor_pair_filter_t());
+	if (best21)
+		find_best_two_descriptor_matches(
+			m2, m1, *best21, p,
+			use_filter
+				? descriptor_pair_filter_t(
+					  [&](size_t i2, size_t i1) { return allowed(i1, i2); })
+				: descriptor_pair_filter_t());
+
+	// Same normalization than CFeature::descriptorSIFTDistanceTo() and
+	// CFeature::descriptorSURFDistanceTo():
+	if (desc == descORB) return;
+	const float k = 1.0f / (std::sqrt(float(m1.length())) *
+							(desc == descSIFT ? 64.0f : 0.20f));
+	for (auto* v : {&best12, best21})
+	{
+		if (!v) continue;
+		for (auto& m : *v)
+		{
+			if (m.best_idx >= 0) m.best_dist *= k;
+			if (m.second_idx >= 0) m.second_dist *= k;
+		}
+	}
+}
+
 /*-------------------------------------------------------------
 						matchFeatures
 -------------------------------------------------------------*/
@@ -473,8 +564,7 @@ size_t vision::matchFeatures(
 
 	CFeatureList::const_iterator itList1, itList2;  // Iterators for the lists
 
-	// For SIFT & SURF
-	float distDesc;  // EDD or EDSD
+	// For SIFT, SURF & ORB
 	float minDist1;  // Minimum EDD or EDSD
 	float minDist2;  // Second minimum EDD or EDSD
 
@@ -493,6 +583,20 @@ size_t vision::matchFeatures(
 	int minLeftIdx = 0, minRightIdx;
 	int nMatches = 0;
 
+	// Descriptor-based methods: brute-force search over packed descriptors
+	// (see CDescriptorMatrix) instead of the generic loop below.
+	const bool by_descriptor =
+		options.matching_method == TMatchingOptions::mmDescriptorSIFT ||
+		options.matching_method == TMatchingOptions::mmDescriptorSURF ||
+		options.matching_method == TMatchingOptions::mmDescriptorORB;
+	std::vector<TDescriptorBestMatches> best12, best21;
+	if (by_descriptor)
+		matchFeaturesBestTwoByDescriptor(
+			list1, list2, options, params, best12,
+			options.enable_robust_1to1_match ? &best21 : nullptr);
+	const CFeatureList::const_iterator itList2End =
+		by_descriptor ? list2.begin() : list2.end();
+
 	// For each feature in list1 ...
 	for (lFeat = 0, itList1 = list1.begin(); itList1 != list1.end();
 		 ++itList1, ++lFeat)
@@ -512,7 +616,22 @@ size_t vision::matchFeatures(
 		// For all the cases
 		minRightIdx = 0;
 
-		for (rFeat = 0, itList2 = list2.begin(); itList2 != list2.end();
+		if (by_descriptor)
+		{
+			const TDescriptorBestMatches& m = best12[lFeat];
+			// Only if consistent from right to left too, if so requested:
+			if (m.best_idx >= 0 &&
+				(!options.enable_robust_1to1_match ||
+				 best21[m.best_idx].best_idx == lFeat))
+			{
+				minDist1 = m.best_dist;
+				if (m.second_idx >= 0) minDist2 = m.second_dist;
+				minLeftIdx = lFeat;
+				minRightIdx = m.best_idx;
+			}
+		}
+
+		for (rFeat = 0, itList2 = list2.begin(); itList2 != itList2End;
 			 ++itList2, ++rFeat)  // ... compare with all the features in list2.
 		{
 			// Filter out by epipolar constraint
@@ -555,31 +674,6 @@ size_t vision::matchFeatures(
 			{
 				switch (options.matching_method)
 				{
-					case TMatchingOptions::mmDescriptorSIFT:
-					{
-						// Ensure that both features have SIFT descriptors
-						ASSERT_(
-							(*itList1)->descriptors.hasDescriptorSIFT() &&
-							(*itList2)->descriptors.hasDescriptorSIFT());
-
-						// Compute the Euclidean distance between descriptors
-						distDesc =
-							(*itList1)->descriptorSIFTDistanceTo(*(*itList2));
-
-						// Search for the two minimum values
-						if (distDesc < minDist1)
-						{
-							minDist2 = minDist1;
-							minDist1 = distDesc;
-							minLeftIdx = lFeat;
-							minRightIdx = rFeat;
-						}
-						else if (distDesc < minDist2)
-							minDist2 = distDesc;
-
-						break;
-					}  // end mmDescriptorSIFT
-
 					case TMatchingOptions::mmCorrelation:
 					{
 						size_t u, v;  // Coordinates of the peak
@@ -606,54 +700,6 @@ size_t vision::matchFeatures(
 						break;
 					}  // end mmCorrelation
 
-					case TMatchingOptions::mmDescriptorSURF:
-					{
-						// Ensure that both features have SURF descriptors
-						ASSERT_(
-							(*itList1)->descriptors.hasDescriptorSURF() &&
-							(*itList2)->descriptors.hasDescriptorSURF());
-
-						// Compute the Euclidean distance between descriptors
-						distDesc =
-							(*itList1)->descriptorSURFDistanceTo(*(*itList2));
-
-						// Search for the two minimum values
-						if (distDesc < minDist1)
-						{
-							minDist2 = minDist1;
-							minDist1 = distDesc;
-							minLeftIdx = lFeat;
-							minRightIdx = rFeat;
-						}
-						else if (distDesc < minDist2)
-							minDist2 = distDesc;
-
-						break;  // end case featSURF
-					}  // end mmDescriptorSURF
-
-					case TMatchingOptions::mmDescriptorORB:
-					{
-						// Ensure that both features have SURF descriptors
-						ASSERT_(
-							(*itList1)->descriptors.hasDescriptorORB() &&
-							(*itList2)->descriptors.hasDescriptorORB());
-						distDesc =
-							(*itList1)->descriptorORBDistanceTo(*(*itList2));
-
-						// Search for the two minimum values
-						if (distDesc < minDist1)
-						{
-							minDist2 = minDist1;
-							minDist1 = distDesc;
-							minLeftIdx = lFeat;
-							minRightIdx = rFeat;
-						}
-						else if (distDesc < minDist2)
-							minDist2 = distDesc;
-
-						break;
-					}  // end mmDescriptorORB
-
 					case TMatchingOptions::mmSAD:
 					{
 						// Ensure that both features have patches
@@ -737,6 +783,9 @@ size_t vision::matchFeatures(
 #endif
 						break;
 					}  // end mmSAD
+					default:
+						// Descriptor-based methods: already searched above
+						break;
 				}  // end switch
 			}  // end if
 		}  // end for 'list2' (right features)
@@ -2412,6 +2461,8 @@ TMatchingOptions::TMatchingOptions()
 	  // for example)
 	  addMatches(false),
 	  useDisparityLimits(false),
+	  enable_robust_1to1_match(false),
+	  numThreads(1),
 
 	  min_disp(1.0f),
 	  max_disp(1e4f),
@@ -2437,6 +2488,9 @@ TMatchingOptions::TMatchingOptions()
 	  maxSAD_TH(0.4),
 	  SAD_RATIO(0.5),
 
+	  // ORB
+	  maxORB_dist(30.0),  // Maximum Hamming distance between ORB descriptors
+
 	  // For estimating depth
 	  estimateDepth(false),
 	  maxDepthThreshold(15.0)
@@ -2481,6 +2535,9 @@ void TMatchingOptions::loadFromConfigFile(
 	addMatches = iniFile.read_bool(section.c_str(), "addMatches", addMatches);
 	useDisparityLimits = iniFile.read_bool(
 		section.c_str(), "useDisparityLimits", useDisparityLimits);
+	enable_robust_1to1_match = iniFile.read_bool(
+		section.c_str(), "enable_robust_1to1_match", enable_robust_1to1_match);
+	numThreads = iniFile.read_int(section.c_str(), "numThreads", numThreads);
 
 	min_disp = iniFile.read_float(section.c_str(), "min_disp", min_disp);
 	max_disp = iniFile.read_float(section.c_str(), "max_disp", max_disp);
@@ -2573,5 +2630,8 @@ void TMatchingOptions::dumpToTextStream(CStream& out) const
 	}
 	out.printf("Add matches to list?:           ");
 	out.printf(addMatches ? "Yes\n" : "No\n");
+	out.printf("Robust 1-to-1 matches?:         ");
+	out.printf(enable_robust_1to1_match ? "Yes\n" : "No\n");
+	out.printf("Number of threads:              %u\n", numThreads);
 	out.printf("-------------------------------------------------------- \n");
 }  // end TMatchingOptions::dumpToTextStream